@@ -19,16 +19,352 @@
 
 using namespace ATG;
 
-size_t WriteCallback(void *contents, size_t size, size_t count, void *context)
+namespace
 {
-    size_t numbytes = size * count;
-    Bytes* bytes = static_cast<Bytes*>(context);
+    struct ProbeResult
+    {
+        bool acceptRanges;
+        uint64_t size;
+    };
+
+    // One ranged request of a streamed download
+    struct DownloadSegment
+    {
+        CURL* curl;
+        bool added;
+        IDownloadSink* sink;
+        const std::atomic<bool>* cancelled;
+        uint64_t start;
+        uint64_t next;          // next offset to write
+        uint64_t end;           // one past the last byte, or IDownloadSink::c_unknownSize
+        bool ranged;
+        bool checkedResponse;
+        uint32_t retries;
+        HRESULT result;
+#if (_GXDK_VER < 0x4A611B35 /* GXDK Edition 210600 */)
+        bool checkedHeader;
+        size_t headerBytesToSkip;
+#endif
+    };
+
+    size_t DiscardCallback(void*, size_t size, size_t count, void*)
+    {
+        return size * count;
+    }
+
+    size_t ProbeHeaderCallback(char* buffer, size_t size, size_t count, void* context)
+    {
+        size_t numbytes = size * count;
+        ProbeResult* probe = static_cast<ProbeResult*>(context);
+
+        std::string header(buffer, numbytes);
+        std::transform(header.begin(), header.end(), header.begin(), [](char c) { return static_cast<char>(tolower(static_cast<unsigned char>(c))); });
+
+        if (header.compare(0, 14, "accept-ranges:") == 0 && header.find("bytes", 14) != std::string::npos)
+        {
+            probe->acceptRanges = true;
+        }
+
+        return numbytes;
+    }
+
+    size_t SegmentWriteCallback(void* contents, size_t size, size_t count, void* context)
+    {
+        size_t numbytes = size * count;
+        DownloadSegment* segment = static_cast<DownloadSegment*>(context);
+
+        if (*segment->cancelled)
+        {
+            segment->result = E_ABORT;
+            return 0;
+        }
+
+        if (!segment->checkedResponse)
+        {
+            segment->checkedResponse = true;
+
+            // A server that ignores the range sends the whole file, which cannot be written at this offset
+            long responseCode = 0;
+            curl_easy_getinfo(segment->curl, CURLINFO_RESPONSE_CODE, &responseCode);
 
-    uint8_t* b = static_cast<uint8_t*>(contents);
-    uint8_t* e = b + numbytes;
-    std::copy(b, e, std::back_inserter(*bytes));
+            if (segment->ranged && responseCode != 206)
+            {
+                segment->result = E_FAIL;
+                return 0;
+            }
+        }
+
+        const uint8_t* data = static_cast<const uint8_t*>(contents);
+        size_t length = numbytes;
+
+#if (_GXDK_VER < 0x4A611B35 /* GXDK Edition 210600 */)
+        // In one or more versions of xcurl prior to 2106, there was a bug where the header was returned regardless of other settings
+        // To work around, skip the header if the body of a transfer starts with a status line
+        if (!segment->checkedHeader)
+        {
+            segment->checkedHeader = true;
+
+            if (length >= 5 && memcmp(data, "HTTP/", 5) == 0)
+            {
+                long headerSize = 0;
+                curl_easy_getinfo(segment->curl, CURLINFO_HEADER_SIZE, &headerSize);
+                segment->headerBytesToSkip = static_cast<size_t>(headerSize);
+            }
+        }
+
+        if (segment->headerBytesToSkip > 0)
+        {
+            size_t skip = std::min(length, segment->headerBytesToSkip);
+            data += skip;
+            length -= skip;
+            segment->headerBytesToSkip -= skip;
+        }
+#endif
+
+        if (segment->end != IDownloadSink::c_unknownSize)
+        {
+            length = static_cast<size_t>(std::min<uint64_t>(length, segment->end - segment->next));
+        }
+
+        if (length > 0)
+        {
+            HRESULT hr = segment->sink->Write(segment->next, data, length);
+            if (FAILED(hr))
+            {
+                segment->result = hr;
+                return 0;
+            }
+
+            segment->next += length;
+        }
+
+        return numbytes;
+    }
+
+    ProbeResult ProbeFile(const char* uri)
+    {
+        ProbeResult probe = { false, IDownloadSink::c_unknownSize };
+
+        CURL* curl = curl_easy_init();
+        if (curl)
+        {
+            curl_easy_setopt(curl, CURLOPT_URL, uri);
+            curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+            curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+            curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, ProbeHeaderCallback);
+            curl_easy_setopt(curl, CURLOPT_HEADERDATA, static_cast<void*>(&probe));
+            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardCallback);
+
+            if (curl_easy_perform(curl) == CURLE_OK)
+            {
+                curl_off_t contentLength = -1;
+                curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+
+                if (contentLength >= 0)
+                {
+                    probe.size = static_cast<uint64_t>(contentLength);
+                }
+            }
+            else
+            {
+                // Fall back to a single GET that cannot be resumed
+                probe.acceptRanges = false;
+            }
+
+            curl_easy_cleanup(curl);
+        }
+
+        return probe;
+    }
+
+    HRESULT StartSegment(CURLM* multi, DownloadSegment& segment, const char* uri, uint32_t receiveBufferSize)
+    {
+        if (segment.curl == nullptr)
+        {
+            segment.curl = curl_easy_init();
+            if (segment.curl == nullptr)
+            {
+                return E_OUTOFMEMORY;
+            }
+
+            curl_easy_setopt(segment.curl, CURLOPT_URL, uri);
+            curl_easy_setopt(segment.curl, CURLOPT_HEADER, false);
+            curl_easy_setopt(segment.curl, CURLOPT_FAILONERROR, 1L);
+            curl_easy_setopt(segment.curl, CURLOPT_BUFFERSIZE, static_cast<long>(receiveBufferSize));
+            curl_easy_setopt(segment.curl, CURLOPT_WRITEFUNCTION, SegmentWriteCallback);
+            curl_easy_setopt(segment.curl, CURLOPT_WRITEDATA, static_cast<void*>(&segment));
+            curl_easy_setopt(segment.curl, CURLOPT_PRIVATE, static_cast<void*>(&segment));
+        }
+
+        segment.checkedResponse = false;
+#if (_GXDK_VER < 0x4A611B35 /* GXDK Edition 210600 */)
+        segment.checkedHeader = false;
+        segment.headerBytesToSkip = 0;
+#endif
+
+        if (segment.ranged)
+        {
+            // Retries continue from the last byte that reached the sink
+            char range[64] = {};
+            if (segment.end != IDownloadSink::c_unknownSize)
+            {
+                sprintf_s(range, "%llu-%llu", static_cast<unsigned long long>(segment.next), static_cast<unsigned long long>(segment.end - 1));
+            }
+            else
+            {
+                sprintf_s(range, "%llu-", static_cast<unsigned long long>(segment.next));
+            }
 
-    return numbytes;
+            curl_easy_setopt(segment.curl, CURLOPT_RANGE, range);
+        }
+
+        if (curl_multi_add_handle(multi, segment.curl) != CURLM_OK)
+        {
+            return E_FAIL;
+        }
+
+        segment.added = true;
+
+        return S_OK;
+    }
+}
+
+HRESULT MemoryDownloadSink::Begin(uint64_t totalSize, uint64_t resumeOffset)
+{
+    if (resumeOffset > m_bytes.size())
+    {
+        // There is nothing to resume from
+        return E_INVALIDARG;
+    }
+
+    m_sizeKnown = (totalSize != c_unknownSize);
+
+    if (m_sizeKnown)
+    {
+        if (totalSize > SIZE_MAX)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        m_bytes.resize(static_cast<size_t>(totalSize));
+    }
+    else
+    {
+        // Keep the bytes being resumed from, so the first Write() continues right after them
+        m_bytes.resize(static_cast<size_t>(resumeOffset));
+    }
+
+    return S_OK;
+}
+
+HRESULT MemoryDownloadSink::Write(uint64_t offset, const uint8_t* data, size_t size)
+{
+    if (m_sizeKnown)
+    {
+        if (offset > m_bytes.size() || size > m_bytes.size() - offset)
+        {
+            return E_BOUNDS;
+        }
+
+        memcpy(m_bytes.data() + offset, data, size);
+    }
+    else
+    {
+        // Unknown sizes are always downloaded as a single sequential segment
+        if (offset != m_bytes.size())
+        {
+            return E_UNEXPECTED;
+        }
+
+        m_bytes.insert(m_bytes.end(), data, data + size);
+    }
+
+    return S_OK;
+}
+
+FileDownloadSink::FileDownloadSink(const wchar_t* path) :
+    m_sizeKnown(false),
+    m_end(0)
+{
+    m_file = CreateFile2(path, GENERIC_WRITE, 0, OPEN_ALWAYS, nullptr);
+}
+
+FileDownloadSink::~FileDownloadSink()
+{
+    if (m_file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_file);
+    }
+}
+
+HRESULT FileDownloadSink::Begin(uint64_t totalSize, uint64_t resumeOffset)
+{
+    if (m_file == INVALID_HANDLE_VALUE)
+    {
+        return E_HANDLE;
+    }
+
+    m_sizeKnown = (totalSize != c_unknownSize);
+    m_end = resumeOffset;
+
+    if (m_sizeKnown)
+    {
+        // Reserve the whole file so concurrent segments never extend it
+        LARGE_INTEGER size = {};
+        size.QuadPart = static_cast<LONGLONG>(totalSize);
+
+        if (!SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT FileDownloadSink::Write(uint64_t offset, const uint8_t* data, size_t size)
+{
+    const uint64_t end = offset + size;
+
+    while (size > 0)
+    {
+        // Positioned writes do not share a file pointer, so segments can write concurrently
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+        DWORD written = 0;
+        DWORD toWrite = static_cast<DWORD>(std::min<size_t>(size, UINT32_MAX));
+        if (!WriteFile(m_file, data, toWrite, &written, &overlapped))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        offset += written;
+        data += written;
+        size -= written;
+    }
+
+    uint64_t current = m_end;
+    while (current < end && !m_end.compare_exchange_weak(current, end))
+    {
+    }
+
+    return S_OK;
+}
+
+void FileDownloadSink::End(HRESULT result)
+{
+    if (SUCCEEDED(result) && !m_sizeKnown)
+    {
+        LARGE_INTEGER size = {};
+        size.QuadPart = static_cast<LONGLONG>(m_end.load());
+
+        if (SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN))
+        {
+            SetEndOfFile(m_file);
+        }
+    }
 }
 
 FileDownloader::FileDownloader()
@@ -41,43 +377,181 @@ FileDownloader::~FileDownloader()
     curl_global_cleanup();
 }
 
-FileHandle FileDownloader::DownloadFile(const char* uri, const char* key)
+HRESULT FileDownloader::StreamFile(const char* uri, IDownloadSink& sink, const DownloadOptions& options, const std::atomic<bool>& cancelled, uint64_t& bytesWritten)
 {
-    CURL *curl;
+    bytesWritten = 0;
 
-    Bytes bytes;
+    const ProbeResult probe = ProbeFile(uri);
 
-    CURLcode res;
-    curl = curl_easy_init();
-    if (curl)
+    // Dynamic endpoints often answer HEAD with a zero length, so only a non-zero size is trusted
+    const bool sizeKnown = (probe.size != IDownloadSink::c_unknownSize) && (probe.size > 0);
+    const uint64_t totalSize = sizeKnown ? probe.size : IDownloadSink::c_unknownSize;
+
+    if (options.resumeOffset > 0 && (!probe.acceptRanges || (sizeKnown && options.resumeOffset > totalSize)))
     {
-        curl_easy_setopt(curl, CURLOPT_URL, uri);
-        curl_easy_setopt(curl, CURLOPT_HEADER, false);
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, static_cast<void*>(&bytes));
-        res = curl_easy_perform(curl);
+        return E_INVALIDARG;
+    }
 
-#if (_GXDK_VER < 0x4A611B35 /* GXDK Edition 210600 */)
-        // In one or more versions of xcurl prior to 2106, there was a bug where the header was returned regardless of other settings
-        // To work around, check if the downloaded length is larger than the content size and trim the beginning if necessary
-        curl_off_t contentLength;
-        curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &contentLength);
+    if (cancelled)
+    {
+        return E_ABORT;
+    }
+
+    HRESULT hr = sink.Begin(totalSize, options.resumeOffset);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    // Split the remainder of the file into ranged segments that are downloaded concurrently
+    uint64_t segmentCount = 1;
+    uint64_t remaining = sizeKnown ? totalSize - options.resumeOffset : IDownloadSink::c_unknownSize;
+
+    if (probe.acceptRanges && sizeKnown && sink.SupportsOutOfOrderWrites() && options.minSegmentSize > 0)
+    {
+        segmentCount = std::max<uint64_t>(1, std::min<uint64_t>(remaining / options.minSegmentSize, std::max(1u, options.maxSegments)));
+    }
+
+    std::vector<DownloadSegment> segments(sizeKnown && remaining == 0 ? 0 : static_cast<size_t>(segmentCount));
+
+    for (size_t index = 0; index < segments.size(); ++index)
+    {
+        auto& segment = segments[index];
+        segment = {};
+        segment.sink = &sink;
+        segment.cancelled = &cancelled;
+        // A single download of the whole file is a plain GET, so a 200 response is fine
+        segment.ranged = probe.acceptRanges && (segments.size() > 1 || options.resumeOffset > 0);
+        segment.result = S_OK;
+        segment.start = options.resumeOffset + index * (sizeKnown ? remaining / segmentCount : 0);
+        segment.next = segment.start;
+        segment.end = !sizeKnown ? IDownloadSink::c_unknownSize
+            : (index + 1 == segments.size()) ? totalSize : segment.start + remaining / segmentCount;
+    }
+
+    CURLM* multi = segments.empty() ? nullptr : curl_multi_init();
+    if (!segments.empty() && multi == nullptr)
+    {
+        hr = E_OUTOFMEMORY;
+    }
 
-        if (bytes.size() > static_cast<size_t>(contentLength))
+    size_t activeSegments = 0;
+
+    for (size_t index = 0; index < segments.size() && SUCCEEDED(hr); ++index)
+    {
+        hr = StartSegment(multi, segments[index], uri, options.receiveBufferSize);
+        if (SUCCEEDED(hr))
         {
-            uint32_t headersize;
-            curl_easy_getinfo(curl, CURLINFO_HEADER_SIZE, &headersize);
-            bytes.erase(bytes.begin(), bytes.begin() + headersize);
+            ++activeSegments;
         }
-#endif
-        
+    }
 
-        curl_easy_cleanup(curl);
+    while (SUCCEEDED(hr) && activeSegments > 0)
+    {
+        int running = 0;
+        if (curl_multi_perform(multi, &running) != CURLM_OK)
+        {
+            hr = E_FAIL;
+            break;
+        }
 
-        if (res == CURLE_OK)
+        CURLMsg* message;
+        int messagesLeft = 0;
+        while (SUCCEEDED(hr) && (message = curl_multi_info_read(multi, &messagesLeft)) != nullptr)
         {
-            m_files[key] = bytes;
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            DownloadSegment* segment = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &segment);
+            CURLcode result = message->data.result;
+
+            curl_multi_remove_handle(multi, segment->curl);
+            segment->added = false;
+            --activeSegments;
+
+            if (result == CURLE_OK && (segment->end == IDownloadSink::c_unknownSize || segment->next == segment->end))
+            {
+                continue;
+            }
+
+            if (FAILED(segment->result))
+            {
+                hr = segment->result;
+            }
+            else if (cancelled)
+            {
+                hr = E_ABORT;
+            }
+            else if (probe.acceptRanges && segment->retries < options.maxRetriesPerSegment)
+            {
+                // Resume the segment from where the transfer stopped
+                ++segment->retries;
+                segment->ranged = true;
+                hr = StartSegment(multi, *segment, uri, options.receiveBufferSize);
+                if (SUCCEEDED(hr))
+                {
+                    ++activeSegments;
+                }
+            }
+            else
+            {
+                hr = E_FAIL;
+            }
         }
+
+        if (SUCCEEDED(hr) && cancelled)
+        {
+            hr = E_ABORT;
+        }
+
+        if (SUCCEEDED(hr) && activeSegments > 0)
+        {
+            curl_multi_wait(multi, nullptr, 0, 100, nullptr);
+        }
+    }
+
+    for (auto& segment : segments)
+    {
+        if (segment.curl)
+        {
+            if (segment.added)
+            {
+                curl_multi_remove_handle(multi, segment.curl);
+            }
+
+            curl_easy_cleanup(segment.curl);
+        }
+
+        bytesWritten += segment.next - segment.start;
+    }
+
+    if (multi)
+    {
+        curl_multi_cleanup(multi);
+    }
+
+    sink.End(hr);
+
+    return hr;
+}
+
+FileHandle FileDownloader::DownloadFile(const char* uri, const char* key)
+{
+    Bytes bytes;
+    MemoryDownloadSink sink(bytes);
+
+    std::atomic<bool> cancelled(false);
+    uint64_t bytesWritten = 0;
+    HRESULT hr = StreamFile(uri, sink, DownloadOptions(), cancelled, bytesWritten);
+
+    std::lock_guard<std::mutex> lock(m_filesLock);
+
+    if (SUCCEEDED(hr))
+    {
+        m_files[key] = std::move(bytes);
     }
 
     auto it = m_files.find(key);
@@ -87,6 +561,8 @@ FileHandle FileDownloader::DownloadFile(const char* uri, const char* key)
 
 FileHandle FileDownloader::GetFile(const std::string& key)
 {
+    std::lock_guard<std::mutex> lock(m_filesLock);
+
     auto it = m_files.find(key);
     return (it != m_files.end()) ? &(it->second) : nullptr;
 };
@@ -146,3 +622,76 @@ HRESULT FileDownloader::DownloadFileAsyncResult(XAsyncBlock* async, _Out_ FileHa
 
     return XAsyncGetResult(async, nullptr, sizeof(FileHandle), fileHandle, nullptr);
 }
+
+HRESULT FileDownloader::StreamFileAsync(const std::string& uri, IDownloadSink* sink, const DownloadOptions& options, XAsyncBlock* async)
+{
+    if (sink == nullptr || async == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    struct CallData
+    {
+        std::string uri;
+        IDownloadSink* sink;
+        DownloadOptions options;
+        std::atomic<bool> cancelled;
+        uint64_t bytesWritten;
+    };
+
+    CallData* callData = new CallData{ uri, sink, options, false, 0 };
+
+    return XAsyncBegin(async, callData, nullptr, __FUNCTION__,
+        [](XAsyncOp op, const XAsyncProviderData* providerData)
+    {
+        CallData* callData = reinterpret_cast<CallData*>(providerData->context);
+
+        switch (op)
+        {
+        case XAsyncOp::Begin:
+            return XAsyncSchedule(providerData->async, 0);
+
+        case XAsyncOp::Cleanup:
+            delete callData;
+            break;
+
+        case XAsyncOp::GetResult:
+            memcpy_s(providerData->buffer, sizeof(uint64_t), &callData->bytesWritten, sizeof(uint64_t));
+            break;
+
+        case XAsyncOp::DoWork:
+        {
+            // The whole transfer runs on this work item; completion is delivered through the async block
+            HRESULT result = StreamFile(callData->uri.c_str(), *callData->sink, callData->options, callData->cancelled, callData->bytesWritten);
+
+            XAsyncComplete(providerData->async, result, SUCCEEDED(result) ? sizeof(uint64_t) : 0);
+            break;
+        }
+
+        case XAsyncOp::Cancel:
+            // The transfer notices the flag in its next write or wait and completes with E_ABORT
+            callData->cancelled = true;
+            break;
+        }
+
+        return S_OK;
+    });
+}
+
+HRESULT FileDownloader::StreamFileAsyncResult(XAsyncBlock* async, _Out_opt_ uint64_t* bytesWritten)
+{
+    if (async == nullptr)
+    {
+        return E_INVALIDARG;
+    }
+
+    uint64_t result = 0;
+    HRESULT hr = XAsyncGetResult(async, nullptr, sizeof(uint64_t), &result, nullptr);
+
+    if (bytesWritten)
+    {
+        *bytesWritten = result;
+    }
+
+    return hr;
+}
@@ -13,11 +13,101 @@
 
 #pragma once
 
+#include <atomic>
+
 using Bytes = std::vector<uint8_t>;
 using FileHandle = Bytes * ;
 
 namespace ATG
 {
+    // Receives the body of a streamed download as it arrives, so that the download never has
+    // to be held in memory as a whole.
+    //
+    // Write() is called from the download's worker thread. Blocking in Write() throttles the
+    // download, which is how a ring buffer or decompressor sink can apply back pressure.
+    class IDownloadSink
+    {
+    public:
+        static constexpr uint64_t c_unknownSize = UINT64_MAX;
+
+        virtual ~IDownloadSink() = default;
+
+        // Return true if Write() can take offsets in any order, which allows a download to be
+        // split into concurrent ranged segments. Sequential sinks receive a single segment
+        // with increasing offsets.
+        virtual bool SupportsOutOfOrderWrites() const = 0;
+
+        // Called once before any data with the size of the whole file, or c_unknownSize, and
+        // DownloadOptions::resumeOffset. The sink must keep the first resumeOffset bytes it
+        // already holds, since they are not downloaded again.
+        virtual HRESULT Begin(uint64_t totalSize, uint64_t resumeOffset) = 0;
+
+        // Called with disjoint byte ranges of the file. Returning a failure aborts the download.
+        virtual HRESULT Write(uint64_t offset, const uint8_t* data, size_t size) = 0;
+
+        // Called once after a successful Begin() when the download completes, fails or is cancelled.
+        virtual void End(HRESULT result) = 0;
+    };
+
+    // Writes into a Bytes buffer, which is sized up front when the file size is known. To resume,
+    // the buffer must already hold at least resumeOffset bytes.
+    class MemoryDownloadSink : public IDownloadSink
+    {
+    public:
+        explicit MemoryDownloadSink(Bytes& bytes) : m_bytes(bytes), m_sizeKnown(false) {}
+
+        bool SupportsOutOfOrderWrites() const override { return true; }
+        HRESULT Begin(uint64_t totalSize, uint64_t resumeOffset) override;
+        HRESULT Write(uint64_t offset, const uint8_t* data, size_t size) override;
+        void End(HRESULT) override {}
+
+    private:
+        Bytes& m_bytes;
+        bool m_sizeKnown;
+    };
+
+    // Writes into a file with positioned writes. The file is opened without truncation so an
+    // interrupted download can be resumed with DownloadOptions::resumeOffset.
+    class FileDownloadSink : public IDownloadSink
+    {
+    public:
+        explicit FileDownloadSink(const wchar_t* path);
+        ~FileDownloadSink();
+
+        FileDownloadSink(FileDownloadSink const&) = delete;
+        FileDownloadSink& operator= (FileDownloadSink const&) = delete;
+
+        bool SupportsOutOfOrderWrites() const override { return true; }
+        HRESULT Begin(uint64_t totalSize, uint64_t resumeOffset) override;
+        HRESULT Write(uint64_t offset, const uint8_t* data, size_t size) override;
+        void End(HRESULT result) override;
+
+    private:
+        HANDLE m_file;
+        bool m_sizeKnown;
+        std::atomic<uint64_t> m_end;
+    };
+
+    struct DownloadOptions
+    {
+        // Largest number of ranged requests used for one file. Memory use is bounded by
+        // maxSegments * receiveBufferSize regardless of the file size.
+        uint32_t maxSegments = 4;
+
+        // Files are only split when every segment gets at least this many bytes.
+        uint64_t minSegmentSize = 8 * 1024 * 1024;
+
+        // Size of the receive buffer of each segment, i.e. the largest Write() call.
+        uint32_t receiveBufferSize = 64 * 1024;
+
+        // Number of times a segment is resumed from its last written byte after a transfer
+        // error. Only used when the server accepts range requests.
+        uint32_t maxRetriesPerSegment = 3;
+
+        // Bytes at the start of the file that the sink already holds from an earlier attempt.
+        uint64_t resumeOffset = 0;
+    };
+
     class FileDownloader
     {
     public:
@@ -30,17 +120,24 @@ namespace ATG
         FileDownloader(FileDownloader const&) = delete;
         FileDownloader& operator= (FileDownloader const&) = delete;
 
+        // Downloads into memory and caches the result under key
         HRESULT DownloadFileAsync(const std::string& uri, const std::string& key, XAsyncBlock* async);
         HRESULT DownloadFileAsyncResult(XAsyncBlock* async, _Out_ FileHandle* fileHandle);
 
         FileHandle GetFile(const std::string& tag);
 
-    private:
-        
+        // Streams the body into sink without caching it. The sink must outlive the async
+        // operation, which can be cancelled with XAsyncCancel.
+        HRESULT StreamFileAsync(const std::string& uri, IDownloadSink* sink, const DownloadOptions& options, XAsyncBlock* async);
+        HRESULT StreamFileAsyncResult(XAsyncBlock* async, _Out_opt_ uint64_t* bytesWritten);
 
+    private:
         FileHandle DownloadFile(const char* uri, const char* key);
 
+        static HRESULT StreamFile(const char* uri, IDownloadSink& sink, const DownloadOptions& options, const std::atomic<bool>& cancelled, uint64_t& bytesWritten);
+
+        // Only guards the cache; transfers never run under it
         std::map<std::string, Bytes> m_files;
-        std::mutex m_curlLock;
+        std::mutex m_filesLock;
     };
 }
@@ -8,6 +8,8 @@
 #include "pch.h"
 #include "HttpManager.h"
 
+#include <mutex>
+
 #pragma warning( disable : 4100 )
 
 namespace 
@@ -83,6 +85,41 @@ namespace
         return std::string(curl_easy_strerror(res));
     }
 
+    // curl_global_init and curl_global_cleanup are not thread-safe, so every HttpManager in the
+    // process shares one reference-counted initialization. Only the first manager initializes
+    // XCurl and only the last one cleans it up, whichever threads they are created on.
+    std::mutex s_curlGlobalMutex;
+    uint32_t s_curlGlobalRefCount = 0;
+
+    CURLcode AcquireCurlGlobal()
+    {
+        std::lock_guard<std::mutex> lock(s_curlGlobalMutex);
+
+        if (s_curlGlobalRefCount == 0)
+        {
+            // Use xcurl_global_init_mem if you want to hook into your own memory manager
+            // You can still use curl_global_init if you don't want to use your own memory hooks
+            CURLcode res = xcurl_global_init_mem(CURL_GLOBAL_DEFAULT, XCurl_Malloc, XCurl_Free, XCurl_Realloc, Curl_Strdup, XCurl_Calloc);
+            if (res != CURLE_OK)
+            {
+                return res;
+            }
+        }
+
+        ++s_curlGlobalRefCount;
+        return CURLE_OK;
+    }
+
+    void ReleaseCurlGlobal()
+    {
+        std::lock_guard<std::mutex> lock(s_curlGlobalMutex);
+
+        if (s_curlGlobalRefCount > 0 && --s_curlGlobalRefCount == 0)
+        {
+            curl_global_cleanup();
+        }
+    }
+
     std::string GetCurlMultiErrorString(CURLMcode res)
     {
         return std::string(curl_multi_strerror(res));
@@ -164,7 +201,7 @@ namespace
         {
         case CURLINFO_TEXT:
         {
-            text = "== Info: " + std::string(data);
+            text = "== Info: " + std::string(data, size);
             break;
         }
         case CURLINFO_HEADER_OUT:   text = "=> Send header (" + std::to_string(size) + " bytes)";   break;
@@ -215,11 +252,7 @@ void HttpManager::Initialize()
 
     if (m_initialized == false)
     {
-        CURLcode res;
-
-        // Use xcurl_global_init_mem if you want to hook into your own memory manager
-        // You can still use curl_global_init if you don't want to use your own memory hooks
-        res = xcurl_global_init_mem(CURL_GLOBAL_DEFAULT, XCurl_Malloc, XCurl_Free, XCurl_Realloc, Curl_Strdup, XCurl_Calloc);
+        CURLcode res = AcquireCurlGlobal();
         if (res != CURLE_OK)
         {
             HttpManagerLog("HttpManager::Initialize: xcurl_global_init_mem failed with error: " + GetCurlErrorString(res));
@@ -233,8 +266,23 @@ void HttpManager::Initialize()
             if (m_curlMultiHandle == nullptr)
             {
                 HttpManagerLog("HttpManager::Initialize: curl_multi_init failed");
+                ReleaseCurlGlobal();
                 return;
             }
+
+            // Multiplex requests to the same host over a single HTTP/2 connection where possible
+            // and cap the connections per host; requests beyond the cap are queued by the multi handle.
+            CURLMcode resMulti = curl_multi_setopt(m_curlMultiHandle, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+            if (resMulti != CURLM_OK)
+            {
+                HttpManagerLog("HttpManager::Initialize: curl_multi_setopt CURLMOPT_PIPELINING failed with error: " + GetCurlMultiErrorString(resMulti));
+            }
+
+            resMulti = curl_multi_setopt(m_curlMultiHandle, CURLMOPT_MAX_HOST_CONNECTIONS, m_maxConnectionsPerHost);
+            if (resMulti != CURLM_OK)
+            {
+                HttpManagerLog("HttpManager::Initialize: curl_multi_setopt CURLMOPT_MAX_HOST_CONNECTIONS failed with error: " + GetCurlMultiErrorString(resMulti));
+            }
         }
 
         m_initialized = true;
@@ -247,6 +295,15 @@ void HttpManager::CleanUp()
 
     if (m_initialized == true)
     {
+        for (auto& idleHandles : m_idleEasyHandles)
+        {
+            for (CURL* curlEasyHandle : idleHandles.second)
+            {
+                curl_easy_cleanup(curlEasyHandle);
+            }
+        }
+        m_idleEasyHandles.clear();
+
         if (m_curlMultiHandle)
         {
             CURLMcode res;
@@ -261,7 +318,7 @@ void HttpManager::CleanUp()
             m_curlMultiHandle = nullptr;
         }
 
-        curl_global_cleanup();
+        ReleaseCurlGlobal();
 
         m_initialized = false;
     }
@@ -281,15 +338,24 @@ HRESULT HttpManager::MakeHttpRequestAsync(XUserHandle user, const std::string& v
     HttpRequestContext* context = new HttpRequestContext(this, user, verb, uri, headers, bodyBytes, bodyLen, OnCompleted);
     if (context)
     {
+        HRESULT hr;
         if (context->authUser)
         {
-            return BeginAuthorization(context);
+            hr = BeginAuthorization(context);
         }
         else
         {
             // Skip directly to sending the request
-            return SendHttpRequest(context);
+            hr = SendHttpRequest(context);
+        }
+
+        // The request never started, so nothing else will free the context
+        if (FAILED(hr) && hr != E_PENDING)
+        {
+            delete context;
         }
+
+        return hr;
     }
 
     return E_FAIL;
@@ -309,15 +375,24 @@ HRESULT HttpManager::MakeHttpRequestAsync(XUserHandle user, const std::string& v
     HttpRequestContext* context = new HttpRequestContext(this, user, verb, uri, headers, bodyString, bodyLen, OnCompleted);
     if (context)
     {
+        HRESULT hr;
         if (context->authUser)
         {
-            return BeginAuthorization(context);
+            hr = BeginAuthorization(context);
         }
         else
         {
             // Skip directly to sending the request
-            return SendHttpRequest(context);
+            hr = SendHttpRequest(context);
+        }
+
+        // The request never started, so nothing else will free the context
+        if (FAILED(hr) && hr != E_PENDING)
+        {
+            delete context;
         }
+
+        return hr;
     }
 
     return E_FAIL;
@@ -454,205 +529,245 @@ HRESULT HttpManager::SendHttpRequest(HttpRequestContext* context)
         return E_FAIL;
     }
 
-    if (CURL* curlEasyHandle = curl_easy_init())
+    CURL* curlEasyHandle = AcquireEasyHandle(context->url);
+    if (curlEasyHandle == nullptr)
     {
-        CURLcode resEasy;
+        HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_init failed");
+        return E_FAIL;
+    }
 
-        if (m_useDebugFunction)
-        {
-            // Optional debugging features
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_DEBUGFUNCTION, Curl_DebugFunction);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_DEBUGFUNCTION failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
+    if (FAILED(SetupEasyHandle(curlEasyHandle, context)))
+    {
+        ReleaseEasyHandle(curlEasyHandle, context->url);
+        return E_FAIL;
+    }
 
-            // Optional debugging features - DEBUGFUNCTION has no effect until we enable VERBOSE
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_VERBOSE, 1L);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_VERBOSE failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
-        }
+    // Treat curl_multi_add_handle like StartRequest() that once you call it the request is in flight.
+    CURLMcode resMulti = curl_multi_add_handle(m_curlMultiHandle, curlEasyHandle);
+    if (resMulti != CURLM_OK)
+    {
+        HttpManagerLog("HttpManager::SendHttpRequest: curl_multi_add_handle failed with error: " + GetCurlMultiErrorString(resMulti));
+        ReleaseEasyHandle(curlEasyHandle, context->url);
+        return E_FAIL;
+    }
+
+    return E_PENDING;
+}
 
-        // URL
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_URL, context->url.c_str());
+HRESULT HttpManager::SetupEasyHandle(CURL* curlEasyHandle, HttpRequestContext* context)
+{
+    CURLcode resEasy;
+
+    if (m_useDebugFunction)
+    {
+        // Optional debugging features
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_DEBUGFUNCTION, Curl_DebugFunction);
         if (resEasy != CURLE_OK)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_URL failed with error: " + GetCurlErrorString(resEasy));
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_DEBUGFUNCTION failed with error: " + GetCurlErrorString(resEasy));
             return E_FAIL;
         }
 
-        // VERB
-        if (context->verb == "POST")
+        // Optional debugging features - DEBUGFUNCTION has no effect until we enable VERBOSE
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_VERBOSE, 1L);
+        if (resEasy != CURLE_OK)
         {
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POST, 1);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_POST failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
-
-            if (!context->requestBodyString.empty())
-            {
-                resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POSTFIELDS, context->requestBodyString.c_str());
-                if (resEasy != CURLE_OK)
-                {
-                    HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_POSTFIELDS with requestBodyString failed with error: " + GetCurlErrorString(resEasy));
-                    return E_FAIL;
-                }
-            }
-            else
-            {
-                // Default to what is in the requestBytes structure by setting the PostFields to Null and using the CURLOPT_READDATA and
-                // CURLOPT_READFUNCTION code below.
-                resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POSTFIELDS, NULL);
-                if (resEasy != CURLE_OK)
-                {
-                    HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_POSTFIELDS NULL failed with error: " + GetCurlErrorString(resEasy));
-                    return E_FAIL;
-                }
-            }
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_VERBOSE failed with error: " + GetCurlErrorString(resEasy));
+            return E_FAIL;
         }
-        else if (context->verb == "PUT")
-        {
-            //  Not tested
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_UPLOAD, 1);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_PUT failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
+    }
 
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_INFILESIZE_LARGE, context->bodySize);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_INFILESIZE_LARGE failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
+    // URL
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_URL, context->url.c_str());
+    if (resEasy != CURLE_OK)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_URL failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
+    }
 
-        }
-        else  // Default to GET
+    // Prefer HTTP/2 over TLS and wait for a connection that can be multiplexed rather than
+    // opening another one. Both are hints, so a failure only loses the multiplexing.
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+    if (resEasy != CURLE_OK && m_useDebugFunction)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_HTTP_VERSION failed with error: " + GetCurlErrorString(resEasy));
+    }
+
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_PIPEWAIT, 1L);
+    if (resEasy != CURLE_OK && m_useDebugFunction)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_PIPEWAIT failed with error: " + GetCurlErrorString(resEasy));
+    }
+
+    // VERB
+    if (context->verb == "POST")
+    {
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POST, 1);
+        if (resEasy != CURLE_OK)
         {
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HTTPGET, 1);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_HTTPGET failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_POST failed with error: " + GetCurlErrorString(resEasy));
+            return E_FAIL;
         }
 
-        if (context->requestBodyBytes && context->bodySize != 0)
+        if (!context->requestBodyString.empty())
         {
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_READDATA, context);
+            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POSTFIELDS, context->requestBodyString.c_str());
             if (resEasy != CURLE_OK)
             {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_READDATA failed with error: " + GetCurlErrorString(resEasy));
+                HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_POSTFIELDS with requestBodyString failed with error: " + GetCurlErrorString(resEasy));
                 return E_FAIL;
             }
-
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_READFUNCTION, Curl_ReadFunc);
+        }
+        else
+        {
+            // Default to what is in the requestBytes structure by setting the PostFields to Null and using the CURLOPT_READDATA and
+            // CURLOPT_READFUNCTION code below.
+            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_POSTFIELDS, NULL);
             if (resEasy != CURLE_OK)
             {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_READFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+                HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_POSTFIELDS NULL failed with error: " + GetCurlErrorString(resEasy));
                 return E_FAIL;
             }
         }
-
-        // Receive response headers (tell curl where the data will go)
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HEADERDATA, context);
+    }
+    else if (context->verb == "PUT")
+    {
+        //  Not tested
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_UPLOAD, 1);
         if (resEasy != CURLE_OK)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_HEADERDATA failed with error: " + GetCurlErrorString(resEasy));
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_PUT failed with error: " + GetCurlErrorString(resEasy));
             return E_FAIL;
         }
 
-        // Receive response headers (tell curl which function to use to write the data)
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HEADERFUNCTION, Curl_ReceiveResponseHeadersFunc);
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_INFILESIZE_LARGE, context->bodySize);
         if (resEasy != CURLE_OK)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_HEADERFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_INFILESIZE_LARGE failed with error: " + GetCurlErrorString(resEasy));
             return E_FAIL;
         }
 
-        // Receive response body (tell curl where the data will go)
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_WRITEDATA, context);
+    }
+    else  // Default to GET
+    {
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HTTPGET, 1);
         if (resEasy != CURLE_OK)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_WRITEDATA failed with error: " + GetCurlErrorString(resEasy));
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_HTTPGET failed with error: " + GetCurlErrorString(resEasy));
             return E_FAIL;
         }
+    }
 
-        // Receive response body (tell curl which function to use to write the data)
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_WRITEFUNCTION, Curl_ReceiveResponseBodyFunc);
+    if (context->requestBodyBytes && context->bodySize != 0)
+    {
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_READDATA, context);
         if (resEasy != CURLE_OK)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_WRITEFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_READDATA failed with error: " + GetCurlErrorString(resEasy));
             return E_FAIL;
         }
 
-        // Add the token and signature if present
-        if (context->tokenAndSignature != nullptr)
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_READFUNCTION, Curl_ReadFunc);
+        if (resEasy != CURLE_OK)
         {
-            context->requestHeaders.emplace_back(HttpHeader("Authorization", context->tokenAndSignature->token));
-
-            //  If there is no signature policy this value will be null
-            if (context->tokenAndSignature->signature != nullptr)
-            {
-                context->requestHeaders.emplace_back(HttpHeader("Signature", context->tokenAndSignature->signature));
-            }
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_READFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+            return E_FAIL;
         }
+    }
 
-        if (context->requestHeaders.empty() == false)
-        {
-            for (const HttpHeader& header : context->requestHeaders)
-            {
-                if (header.IsValid())
-                {
-                    std::string formattedHeaderString = header.ToString();
+    // Receive response headers (tell curl where the data will go)
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HEADERDATA, context);
+    if (resEasy != CURLE_OK)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_HEADERDATA failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
+    }
 
-                    HttpManagerLog("HttpManager::SendHttpRequest: appending header: " + formattedHeaderString);
+    // Receive response headers (tell curl which function to use to write the data)
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HEADERFUNCTION, Curl_ReceiveResponseHeadersFunc);
+    if (resEasy != CURLE_OK)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_HEADERFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
+    }
 
-                    // This list must remain valid for the full lifetime of the request
-                    context->curlHeaderList = curl_slist_append(context->curlHeaderList, formattedHeaderString.c_str());
-                }
-            }
+    // Receive response body (tell curl where the data will go)
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_WRITEDATA, context);
+    if (resEasy != CURLE_OK)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_WRITEDATA failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
+    }
 
-            // Headers
-            resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HTTPHEADER, context->curlHeaderList);
-            if (resEasy != CURLE_OK)
-            {
-                HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_HTTPHEADER failed with error: " + GetCurlErrorString(resEasy));
-                return E_FAIL;
-            }
+    // Receive response body (tell curl which function to use to write the data)
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_WRITEFUNCTION, Curl_ReceiveResponseBodyFunc);
+    if (resEasy != CURLE_OK)
+    {
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_WRITEFUNCTION failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
+    }
+
+    // A retry rebuilds the list since the token and signature may have been refreshed
+    if (context->curlHeaderList != nullptr)
+    {
+        curl_slist_free_all(context->curlHeaderList);
+        context->curlHeaderList = nullptr;
+    }
+
+    std::string formattedHeaderString;
+    auto appendHeader = [&](const char* name, const char* value)
+    {
+        formattedHeaderString.assign(name).append(": ").append(value);
+
+        if (m_useDebugFunction)
+        {
+            HttpManagerLog("HttpManager::SetupEasyHandle: appending header: " + formattedHeaderString);
         }
 
-        // Context
-        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_PRIVATE, context);
-        if (resEasy != CURLE_OK)
+        // This list must remain valid for the full lifetime of the request
+        context->curlHeaderList = curl_slist_append(context->curlHeaderList, formattedHeaderString.c_str());
+    };
+
+    for (const HttpHeader& header : context->requestHeaders)
+    {
+        if (header.IsValid())
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_setopt CURLOPT_PRIVATE failed with error: " + GetCurlErrorString(resEasy));
-            return E_FAIL;
+            appendHeader(header.name.c_str(), header.value.c_str());
         }
+    }
+
+    // Add the token and signature if present
+    if (context->tokenAndSignature != nullptr)
+    {
+        appendHeader("Authorization", context->tokenAndSignature->token);
 
-        // Treat curl_multi_add_handle like StartRequest() that once you call it the request is in flight.
-        CURLMcode resMulti = curl_multi_add_handle(m_curlMultiHandle, curlEasyHandle);
-        if (resMulti != CURLM_OK)
+        //  If there is no signature policy this value will be null
+        if (context->tokenAndSignature->signature != nullptr)
         {
-            HttpManagerLog("HttpManager::SendHttpRequest: curl_multi_add_handle failed with error: " + GetCurlMultiErrorString(resMulti));
-            return E_FAIL;
+            appendHeader("Signature", context->tokenAndSignature->signature);
         }
+    }
 
-        return E_PENDING;
+    if (context->curlHeaderList != nullptr)
+    {
+        // Headers
+        resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_HTTPHEADER, context->curlHeaderList);
+        if (resEasy != CURLE_OK)
+        {
+            HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_HTTPHEADER failed with error: " + GetCurlErrorString(resEasy));
+            return E_FAIL;
+        }
     }
-    else
+
+    // Context
+    resEasy = curl_easy_setopt(curlEasyHandle, CURLOPT_PRIVATE, context);
+    if (resEasy != CURLE_OK)
     {
-    HttpManagerLog("HttpManager::SendHttpRequest: curl_easy_init failed");
+        HttpManagerLog("HttpManager::SetupEasyHandle: curl_easy_setopt CURLOPT_PRIVATE failed with error: " + GetCurlErrorString(resEasy));
+        return E_FAIL;
     }
 
-    return E_FAIL;
+    return S_OK;
 }
 
 void HttpManager::Update()
@@ -683,48 +798,48 @@ void HttpManager::Update()
         if (curlMsg->msg == CURLMSG_DONE)
         {
             CURL* completedHandle = curlMsg->easy_handle;
+            CURLcode transferResult = curlMsg->data.result;
+
             resMulti = curl_multi_remove_handle(m_curlMultiHandle, completedHandle);
             if (resMulti != CURLM_OK)
             {
                 HttpManagerLog("HttpManager::Update: curl_multi_remove_handle failed with error: " + GetCurlMultiErrorString(resMulti));
-                return;
+                continue;
             }
 
             // Context
             HttpRequestContext* context = nullptr;
             CURLcode resEasy = curl_easy_getinfo(completedHandle, CURLINFO_PRIVATE, &context);
-            if (resEasy != CURLE_OK)
+            if (resEasy != CURLE_OK || context == nullptr)
             {
-                HttpManagerLog("HttpManager::Update: curl_easy_getinfo CURLINFO_PRIVATE failed with error: " + GetCurlErrorString(resEasy));
-                return;
+                HttpManagerLog("Could not find mapping for completed request");
+                curl_easy_cleanup(completedHandle);
+                continue;
             }
 
-            if(context)
+            if (transferResult != CURLE_OK)
             {
-                resEasy = curlMsg->data.result;
-
-                if (resEasy != CURLE_OK)
+                HRESULT hr;
+                CURLcode getInfoResult = curl_easy_getinfo(completedHandle, CURLINFO_OS_ERRNO, &hr);
+                if (getInfoResult != CURLE_OK)
                 {
-                    HRESULT hr;
-                    CURLcode getInfoResult = curl_easy_getinfo(completedHandle, CURLINFO_OS_ERRNO, &hr);
-                    if (getInfoResult != CURLE_OK)
-                    {
-                        HttpManagerLog("HttpManager::Update: request failed with error: " + GetCurlErrorString(resEasy));
-                    }
-                    else
-                    {
-                        HttpManagerLog("HttpManager::Update: request failed with error: CURLcode= " + GetCurlErrorString(resEasy) + " HRESULT= " + std::to_string(hr));
-                    }
-                    
-                    return;
+                    HttpManagerLog("HttpManager::Update: request failed with error: " + GetCurlErrorString(transferResult));
+                }
+                else
+                {
+                    HttpManagerLog("HttpManager::Update: request failed with error: CURLcode= " + GetCurlErrorString(transferResult) + " HRESULT= " + std::to_string(hr));
                 }
 
+                // Completes with a status code of 0 so the caller still gets its callback
+                context->responseStatusCode = 0;
+            }
+            else
+            {
                 // Response code
                 resEasy = curl_easy_getinfo(completedHandle, CURLINFO_RESPONSE_CODE, &context->responseStatusCode);
                 if (resEasy != CURLE_OK)
                 {
                     HttpManagerLog("HttpManager::Update: curl_easy_getinfo CURLINFO_RESPONSE_CODE failed with error: " + GetCurlErrorString(resEasy));
-                    return;
                 }
 
                 // Response Size
@@ -732,19 +847,70 @@ void HttpManager::Update()
                 if (resEasy != CURLE_OK)
                 {
                     HttpManagerLog("HttpManager::Update: curl_easy_getinfo CURLINFO_SIZE_DOWNLOAD_T failed with error: " + GetCurlErrorString(resEasy));
-                    return;
                 }
-
-                CompleteHttpRequest(context);
-            }
-            else
-            {
-                HttpManagerLog("Could not find mapping for completed request");
             }
+
+            // Return the handle before completing, since a retry or the completion callback may
+            // start another request to the same host.
+            ReleaseEasyHandle(completedHandle, context->url);
+
+            CompleteHttpRequest(context);
         }
     }
 }
 
+void HttpManager::WaitForActivity(int timeoutMs)
+{
+    if (m_initialized == false)
+    {
+        return;
+    }
+
+    CURLMcode resMulti = curl_multi_wait(m_curlMultiHandle, nullptr, 0, timeoutMs, nullptr);
+    if (resMulti != CURLM_OK)
+    {
+        HttpManagerLog("HttpManager::WaitForActivity: curl_multi_wait failed with error: " + GetCurlMultiErrorString(resMulti));
+    }
+}
+
+CURL* HttpManager::AcquireEasyHandle(const std::string& url)
+{
+    auto idleHandles = m_idleEasyHandles.find(GetHostKey(url));
+    if (idleHandles != m_idleEasyHandles.end() && idleHandles->second.empty() == false)
+    {
+        CURL* curlEasyHandle = idleHandles->second.back();
+        idleHandles->second.pop_back();
+        return curlEasyHandle;
+    }
+
+    return curl_easy_init();
+}
+
+void HttpManager::ReleaseEasyHandle(CURL* curlEasyHandle, const std::string& url)
+{
+    auto& idleHandles = m_idleEasyHandles[GetHostKey(url)];
+    if (idleHandles.size() < m_maxIdleHandlesPerHost)
+    {
+        // Resetting clears the options but keeps the handle's caches
+        curl_easy_reset(curlEasyHandle);
+        idleHandles.push_back(curlEasyHandle);
+    }
+    else
+    {
+        curl_easy_cleanup(curlEasyHandle);
+    }
+}
+
+std::string HttpManager::GetHostKey(const std::string& url)
+{
+    // scheme://[user@]host[:port] -- everything up to the start of the path or query
+    auto hostStart = url.find("://");
+    hostStart = (hostStart == std::string::npos) ? 0 : hostStart + 3;
+
+    auto hostEnd = url.find_first_of("/?#", hostStart);
+    return url.substr(0, hostEnd);
+}
+
 HRESULT HttpManager::CompleteHttpRequest(HttpRequestContext* context)
 {
     HttpManagerLog("HttpManager::CompleteHttpRequest:");
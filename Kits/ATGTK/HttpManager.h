@@ -12,6 +12,9 @@ struct HttpRequestContext;
 
 #include <XCurl.h>
 #include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 class HttpManager
 {
@@ -22,8 +25,16 @@ public:
 
     void Update();
 
+    // Blocks until there is activity on a request in flight or the timeout elapses, so that
+    // a thread dedicated to HTTP traffic can call Update() without spinning.
+    void WaitForActivity(int timeoutMs);
+
     void HttpManagerLog(std::string message);
 
+    // Verbose XCurl tracing of every request. Off by default since it adds logging cost to
+    // each request.
+    void SetVerboseTracing(bool enabled) { m_useDebugFunction = enabled; }
+
     HRESULT MakeHttpRequestAsync(XUserHandle user, const std::string& verb, const std::string& uri, const std::vector<HttpHeader>& headers, uint8_t* bodyBytes, size_t bodyLen, std::function<void(HttpRequestContext*)> OnCompleted);
     HRESULT MakeHttpRequestAsync(XUserHandle user, const std::string& verb, const std::string& uri, const std::vector<HttpHeader>& headers, std::string bodyString, size_t bodyLen, std::function<void(HttpRequestContext*)> OnCompleted);
 
@@ -33,13 +44,24 @@ private:
 
     HRESULT BeginAuthorization(HttpRequestContext* context);
     HRESULT SendHttpRequest(HttpRequestContext* context);
+    HRESULT SetupEasyHandle(CURL* curlEasyHandle, HttpRequestContext* context);
     HRESULT CompleteHttpRequest(HttpRequestContext* context);
     HRESULT RetryHttpRequest(HttpRequestContext* context);
 
+    // Easy handles are pooled per host rather than created for every request. The multi
+    // handle keeps the connections, so requests to the same host also reuse connections,
+    // TLS sessions and HTTP/2 streams where the server supports them.
+    CURL* AcquireEasyHandle(const std::string& url);
+    void ReleaseEasyHandle(CURL* curlEasyHandle, const std::string& url);
+    static std::string GetHostKey(const std::string& url);
+
     bool m_initialized = false;
     const uint32_t m_maxRequestRetries = 4;
+    const long m_maxConnectionsPerHost = 6;
+    const size_t m_maxIdleHandlesPerHost = 8;
 
     CURLM* m_curlMultiHandle = nullptr;
+    std::unordered_map<std::string, std::vector<CURL*>> m_idleEasyHandles;
 
     bool m_useDebugFunction = false;
 
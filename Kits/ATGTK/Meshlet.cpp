@@ -6,6 +6,7 @@
 //--------------------------------------------------------------------------------------
 #include "pch.h"
 #include "Meshlet.h"
+#include "MeshletFormat.h"
 
 #include <algorithm>
 #include <fstream>
@@ -30,22 +31,25 @@ namespace
         const size_t alignedSize = (size + alignment - 1) & ~(alignment - 1);
         return alignedSize;
     }
-    
-    struct MeshletFileHeader
+
+    struct handle_closer { void operator()(HANDLE h) { if (h) CloseHandle(h); } };
+
+    using ScopedHandle = std::unique_ptr<void, handle_closer>;
+
+    inline HANDLE safe_handle(HANDLE h) { return (h == INVALID_HANDLE_VALUE) ? nullptr : h; }
+
+    template <typename T>
+    MeshletSpan<T> MapArray(const uint8_t* setBase, const MeshletSetHeader& header, uint64_t offset, uint64_t count)
     {
-        enum
+        if ((offset % c_meshletDataAlignment) != 0
+            || offset > header.Size
+            || count > (header.Size - offset) / sizeof(T))
         {
-            MESHLET_VERSION_INITIAL = 0x0,
-            MESHLET_VERSION_CULLDATA = 0x1,
-            MESHLET_VERSION_CULLDATA_UPDATE = 0x2,
-            MESHLET_VERSION_GEN_UPDATE = 0x3,
-            MESHLET_VERSION_CURRENT = MESHLET_VERSION_GEN_UPDATE
-        };
-
-        uint32_t Prolog;
-        uint32_t Version;
-        uint32_t Count;
-    };
+            throw std::exception("Meshlet file is corrupt.");
+        }
+
+        return MeshletSpan<T>(reinterpret_cast<const T*>(setBase + offset), size_t(count));
+    }
 }
 
 namespace ATG 
@@ -72,19 +76,19 @@ uint32_t MeshletSet::GetIndexCount() const
     return static_cast<uint32_t>(m_uniqueIndexData.size() / BytesPerIndex());
 }
 
-uint32_t MeshletSet::GetVertexIndex(uint32_t index)
+uint32_t MeshletSet::GetVertexIndex(uint32_t index) const
 {
     if (m_indexFormat == DXGI_FORMAT_R32_UINT)
     {
-        return *(reinterpret_cast<uint32_t*>(m_uniqueIndexData.data()) + index);
+        return *(reinterpret_cast<const uint32_t*>(m_uniqueIndexData.data()) + index);
     }
     else
     {
-        return *(reinterpret_cast<uint16_t*>(m_uniqueIndexData.data()) + index);
+        return *(reinterpret_cast<const uint16_t*>(m_uniqueIndexData.data()) + index);
     }
 }
 
-void MeshletSet::GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2)
+void MeshletSet::GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2) const
 {
     auto prim = m_primitiveData[index];
     v0 = prim.indices.i0;
@@ -246,6 +250,8 @@ void MeshletSet::CreateResources(ID3D12Device* device, DirectX::ResourceUploadBa
 
 void MeshletSet::Read(std::istream& stream)
 {
+    auto storage = std::make_shared<MeshletStorage<Submesh, Meshlet, CullData, PackedTriangle>>();
+
     stream.read(reinterpret_cast<char*>(&m_maxVerts), sizeof(m_maxVerts));
     stream.read(reinterpret_cast<char*>(&m_maxPrims), sizeof(m_maxPrims));
 
@@ -253,19 +259,19 @@ void MeshletSet::Read(std::istream& stream)
         uint32_t meshletCount;
         stream.read(reinterpret_cast<char*>(&meshletCount), 4);
 
-        m_meshletData.resize(meshletCount);
-        stream.read(reinterpret_cast<char*>(m_meshletData.data()), std::streamsize(meshletCount * sizeof(m_meshletData[0])));
+        storage->meshlets.resize(meshletCount);
+        stream.read(reinterpret_cast<char*>(storage->meshlets.data()), std::streamsize(meshletCount * sizeof(Meshlet)));
 
-        m_cullData.resize(meshletCount);
-        stream.read(reinterpret_cast<char*>(m_cullData.data()), std::streamsize(meshletCount * sizeof(m_cullData[0])));
+        storage->cullData.resize(meshletCount);
+        stream.read(reinterpret_cast<char*>(storage->cullData.data()), std::streamsize(meshletCount * sizeof(CullData)));
     }
 
     {
         uint32_t submeshCount;
         stream.read(reinterpret_cast<char*>(&submeshCount), 4);
 
-        m_submeshes.resize(submeshCount);
-        stream.read(reinterpret_cast<char*>(m_submeshes.data()), std::streamsize(submeshCount * sizeof(m_submeshes[0])));
+        storage->submeshes.resize(submeshCount);
+        stream.read(reinterpret_cast<char*>(storage->submeshes.data()), std::streamsize(submeshCount * sizeof(Submesh)));
     }
 
     {
@@ -273,8 +279,8 @@ void MeshletSet::Read(std::istream& stream)
         stream.read(reinterpret_cast<char*>(&indexBytes), 4);
         stream.read(reinterpret_cast<char*>(&indexCount), 4);
 
-        m_uniqueIndexData.resize(indexCount * indexBytes);
-        stream.read(reinterpret_cast<char*>(m_uniqueIndexData.data()), indexCount * indexBytes);
+        storage->uniqueIndices.resize(indexCount * indexBytes);
+        stream.read(reinterpret_cast<char*>(storage->uniqueIndices.data()), indexCount * indexBytes);
 
         m_indexFormat = indexBytes == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
     }
@@ -283,34 +289,111 @@ void MeshletSet::Read(std::istream& stream)
         uint32_t primCount;
         stream.read(reinterpret_cast<char*>(&primCount), 4);
 
-        m_primitiveData.resize(primCount);
-        stream.read(reinterpret_cast<char*>(m_primitiveData.data()), std::streamsize(primCount * sizeof(m_primitiveData[0])));
+        storage->primitives.resize(primCount);
+        stream.read(reinterpret_cast<char*>(storage->primitives.data()), std::streamsize(primCount * sizeof(PackedTriangle)));
     }
+
+    m_submeshes = MeshletSpan<Submesh>(storage->submeshes.data(), storage->submeshes.size());
+    m_meshletData = MeshletSpan<Meshlet>(storage->meshlets.data(), storage->meshlets.size());
+    m_cullData = MeshletSpan<CullData>(storage->cullData.data(), storage->cullData.size());
+    m_uniqueIndexData = MeshletSpan<uint8_t>(storage->uniqueIndices.data(), storage->uniqueIndices.size());
+    m_primitiveData = MeshletSpan<PackedTriangle>(storage->primitives.data(), storage->primitives.size());
+    m_storage = std::move(storage);
 }
 
 std::vector<MeshletSet> MeshletSet::Read(const wchar_t* filePath)
 {
-    auto file = std::ifstream(filePath, std::ios::in | std::ios::binary);
-    if (!file.is_open())
+    ScopedHandle hFile(safe_handle(CreateFile2(filePath, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+    if (!hFile)
     {
         return std::vector<MeshletSet>();
     }
 
-    MeshletFileHeader header;
-    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    FILE_STANDARD_INFO fileInfo = {};
+    if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        throw std::exception("GetFileInformationByHandleEx");
+
+    const uint64_t fileSize = uint64_t(fileInfo.EndOfFile.QuadPart);
+    if (fileSize < sizeof(MeshletFileHeader))
+        throw std::exception("Opened file is not of the meshlet file format.");
+
+    ScopedHandle hFileMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+    if (!hFileMapping)
+        throw std::exception("CreateFileMappingW");
 
-    if (header.Prolog != 'MSHL')
+    auto fileBase = static_cast<const uint8_t*>(MapViewOfFile(hFileMapping.get(), FILE_MAP_READ, 0, 0, 0));
+    if (!fileBase)
+        throw std::exception("MapViewOfFile");
+
+    // The view remains valid after the handles are closed.
+    std::shared_ptr<const void> view(fileBase, [](const void* p) { UnmapViewOfFile(p); });
+
+    const MeshletFileHeader header = *reinterpret_cast<const MeshletFileHeader*>(fileBase);
+
+    if (header.Prolog != c_meshletFileProlog)
         throw std::exception("Opened file is not of the meshlet file format.");
 
+    if (header.Version == MeshletFileHeader::MESHLET_VERSION_GEN_UPDATE)
+    {
+        // The older layout isn't aligned for in-place use, so copy it out through a stream.
+        view.reset();
+        hFileMapping.reset();
+        hFile.reset();
+
+        auto file = std::ifstream(filePath, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+        {
+            return std::vector<MeshletSet>();
+        }
+
+        file.seekg(sizeof(MeshletFileHeader));
+
+        std::vector<MeshletSet> meshlets;
+        meshlets.resize(header.Count);
+
+        for (auto& m : meshlets)
+        {
+            m.Read(file);
+        }
+
+        return meshlets;
+    }
+
     if (header.Version != MeshletFileHeader::MESHLET_VERSION_CURRENT)
         throw std::exception("Meshlet version is out of date! Please update meshlet runtime code.");
 
     std::vector<MeshletSet> meshlets;
     meshlets.resize(header.Count);
 
+    uint64_t offset = c_meshletDataAlignment;
     for (auto& m : meshlets)
     {
-        m.Read(file);
+        if (offset > fileSize || fileSize - offset < sizeof(MeshletSetHeader))
+            throw std::exception("Meshlet file is corrupt.");
+
+        const uint8_t* setBase = fileBase + offset;
+        auto& setHeader = *reinterpret_cast<const MeshletSetHeader*>(setBase);
+
+        if (setHeader.Size < sizeof(MeshletSetHeader)
+            || setHeader.Size > fileSize - offset
+            || (setHeader.Size % c_meshletDataAlignment) != 0
+            || (setHeader.IndexBytes != 2 && setHeader.IndexBytes != 4))
+        {
+            throw std::exception("Meshlet file is corrupt.");
+        }
+
+        m.m_maxVerts = setHeader.MaxVerts;
+        m.m_maxPrims = setHeader.MaxPrims;
+        m.m_indexFormat = setHeader.IndexBytes == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+
+        m.m_meshletData = MapArray<Meshlet>(setBase, setHeader, sizeof(MeshletSetHeader), setHeader.MeshletCount);
+        m.m_cullData = MapArray<CullData>(setBase, setHeader, setHeader.CullDataOffset, setHeader.MeshletCount);
+        m.m_submeshes = MapArray<Submesh>(setBase, setHeader, setHeader.SubmeshOffset, setHeader.SubmeshCount);
+        m.m_uniqueIndexData = MapArray<uint8_t>(setBase, setHeader, setHeader.UniqueIndexOffset, uint64_t(setHeader.IndexCount) * setHeader.IndexBytes);
+        m.m_primitiveData = MapArray<PackedTriangle>(setBase, setHeader, setHeader.PrimitiveOffset, setHeader.PrimitiveCount);
+        m.m_storage = view;
+
+        offset += setHeader.Size;
     }
 
     return meshlets;
@@ -7,7 +7,9 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <ostream>
+#include <vector>
 
 namespace ATG
 {
@@ -44,6 +46,30 @@ namespace ATG
         uint32_t packed;
     };
 
+    // Read-only view of an array owned by a MeshletSet, pointing either into a memory-mapped
+    // meshlet file or into arrays read from a stream.
+    template <typename T>
+    class MeshletSpan
+    {
+    public:
+        MeshletSpan() noexcept : m_data(nullptr), m_size(0) {}
+        MeshletSpan(const T* data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+        const T*        data() const noexcept { return m_data; }
+        size_t          size() const noexcept { return m_size; }
+        bool            empty() const noexcept { return m_size == 0; }
+
+        const T*        begin() const noexcept { return m_data; }
+        const T*        end() const noexcept { return m_data + m_size; }
+
+        const T&        operator[](size_t index) const noexcept { return m_data[index]; }
+        const T&        back() const noexcept { return m_data[m_size - 1]; }
+
+    private:
+        const T*        m_data;
+        size_t          m_size;
+    };
+
     struct MeshInfo
     {
         uint32_t IndexBytes;
@@ -61,8 +87,8 @@ namespace ATG
             m_maxPrims(0),
             m_indexFormat(DXGI_FORMAT_UNKNOWN) {}
         // Accessors for vertex index & primitive data
-        uint32_t        GetVertexIndex(uint32_t index);
-        void            GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2);
+        uint32_t        GetVertexIndex(uint32_t index) const;
+        void            GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2) const;
 
         DXGI_FORMAT     IndexFormat() const { return m_indexFormat; }
         uint32_t        BytesPerIndex() const { return m_indexFormat == DXGI_FORMAT_R32_UINT ? 4u : 2u; }
@@ -102,7 +128,12 @@ namespace ATG
         ID3D12Resource*	GetMeshInfoResource() const { return m_meshInfoResource.Get(); }
 
         // File Loading
+        // Reads a set in the unaligned layout used up to MESHLET_VERSION_GEN_UPDATE into owned arrays.
         void Read(std::istream& stream);
+
+        // Current files are memory-mapped and the raw meshlet data points straight into the
+        // mapping, which stays open until the last MeshletSet referencing it is destroyed.
+        // Older files are read through a stream.
         static std::vector<MeshletSet> Read(const wchar_t* filePath);
 
     private:
@@ -112,11 +143,13 @@ namespace ATG
         uint32_t                    m_maxPrims;
         DXGI_FORMAT                 m_indexFormat;
 
-        std::vector<Submesh>        m_submeshes;
-        std::vector<Meshlet>        m_meshletData;
-        std::vector<CullData>       m_cullData;
-        std::vector<uint8_t>        m_uniqueIndexData;
-        std::vector<PackedTriangle> m_primitiveData;
+        std::shared_ptr<const void> m_storage;      // Keeps the arrays below alive
+
+        MeshletSpan<Submesh>        m_submeshes;
+        MeshletSpan<Meshlet>        m_meshletData;
+        MeshletSpan<CullData>       m_cullData;
+        MeshletSpan<uint8_t>        m_uniqueIndexData;
+        MeshletSpan<PackedTriangle> m_primitiveData;
 
         Microsoft::WRL::ComPtr<ID3D12Resource> 	m_meshletResource;
         Microsoft::WRL::ComPtr<ID3D12Resource> 	m_cullDataResource;
@@ -0,0 +1,75 @@
+//--------------------------------------------------------------------------------------
+// MeshletFormat.h
+//
+// Layout of the meshlet (.bin) files written by MeshletConverter. This is shared by the
+// converter and both readers so the on-disk format is only defined once.
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ATG
+{
+    struct MeshletFileHeader
+    {
+        enum
+        {
+            MESHLET_VERSION_INITIAL = 0x0,
+            MESHLET_VERSION_CULLDATA = 0x1,
+            MESHLET_VERSION_CULLDATA_UPDATE = 0x2,
+            MESHLET_VERSION_GEN_UPDATE = 0x3,
+            MESHLET_VERSION_ALIGNED = 0x4,
+            MESHLET_VERSION_CURRENT = MESHLET_VERSION_ALIGNED
+        };
+
+        uint32_t Prolog;
+        uint32_t Version;
+        uint32_t Count;
+    };
+
+    constexpr uint32_t c_meshletFileProlog = 'MSHL';
+
+    // From MESHLET_VERSION_ALIGNED on, the file header is padded to this alignment. Each meshlet
+    // set then starts with a MeshletSetHeader, and each of its arrays begins on this alignment so
+    // that a runtime can use them in place from a memory-mapped file.
+    constexpr size_t c_meshletDataAlignment = 64;
+
+    struct MeshletSetHeader
+    {
+        uint32_t MaxVerts;
+        uint32_t MaxPrims;
+        uint32_t IndexBytes;
+        uint32_t MeshletCount;
+        uint32_t SubmeshCount;
+        uint32_t IndexCount;
+        uint32_t PrimitiveCount;
+        uint32_t _reserved0;
+
+        // Byte offsets from the start of this header. Meshlets immediately follow the header.
+        uint32_t CullDataOffset;
+        uint32_t SubmeshOffset;
+        uint32_t UniqueIndexOffset;
+        uint32_t PrimitiveOffset;
+
+        uint64_t Size;          // Size of the whole set, including this header
+        uint64_t _reserved1;
+    };
+    static_assert(sizeof(MeshletSetHeader) == c_meshletDataAlignment, "Structure misalignment.");
+
+    // Arrays read from streams in the older, unaligned layout. The element types come from the
+    // reader, since the kit and the converter runtime each declare their own.
+    template <typename TSubmesh, typename TMeshlet, typename TCullData, typename TPrimitive>
+    struct MeshletStorage
+    {
+        std::vector<TSubmesh>   submeshes;
+        std::vector<TMeshlet>   meshlets;
+        std::vector<TCullData>  cullData;
+        std::vector<uint8_t>    uniqueIndices;
+        std::vector<TPrimitive> primitives;
+    };
+}
@@ -15,8 +15,12 @@
 
 #include "DirectXHelpers.h"
 
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <exception>
 #include <stdexcept>
+#include <tuple>
 
 using namespace DirectX;
 using namespace DX;
@@ -62,11 +66,338 @@ namespace
 // CPUTimer
 //======================================================================================
 
+// Each recording thread only ever writes to its own ring, and Update is the only reader, so the rings are
+// single-producer/single-consumer queues and recording a zone never takes a lock. The per-thread zone trees
+// and the trace capture are only touched by Update.
+
+struct CPUTimer::ZoneProfiler
+{
+    // Zone events each thread can buffer between Updates; zones that don't fit are dropped
+    static constexpr uint32_t c_ringSize = 8192;
+    static constexpr uint32_t c_noNode = UINT32_MAX;
+
+    struct ZoneEvent
+    {
+        int64_t     ticks;
+        const char* name;       // nullptr for the end of a zone
+    };
+
+    struct Node
+    {
+        const char* name;
+        uint32_t    parent;
+        uint32_t    firstChild;
+        uint32_t    nextSibling;
+        uint32_t    callCount;
+        int64_t     totalTicks;
+        int64_t     childTicks;
+        float       averageTotalMS;
+        float       averageSelfMS;
+    };
+
+    struct OpenZone
+    {
+        uint32_t    node;
+        int64_t     startTicks;
+        bool        traced;
+    };
+
+    struct TraceEvent
+    {
+        int64_t     ticks;
+        const char* name;
+        DWORD       threadId;
+        bool        begin;
+    };
+
+    struct ThreadRing
+    {
+        explicit ThreadRing(DWORD id) :
+            threadId(id),
+            next(nullptr),
+            head(0),
+            depth(0),
+            droppedDepth(UINT32_MAX),
+            tail(0),
+            events(new ZoneEvent[c_ringSize]),
+            firstRoot(c_noNode)
+        {}
+
+        const DWORD                     threadId;
+        ThreadRing*                     next;
+
+        // Written by the recording thread
+        std::atomic<uint32_t>           head;
+        uint32_t                        depth;
+        uint32_t                        droppedDepth;   // depth of the outermost dropped zone still open
+
+        // Written by Update
+        std::atomic<uint32_t>           tail;
+
+        std::unique_ptr<ZoneEvent[]>    events;
+
+        // Aggregation state, only used by Update
+        std::vector<Node>               nodes;
+        std::vector<OpenZone>           openZones;
+        uint32_t                        firstRoot;
+    };
+
+    ZoneProfiler() :
+        generation(NextGeneration()),
+        threads(nullptr),
+        captureFramesRemaining(0)
+    {}
+
+    ~ZoneProfiler()
+    {
+        ThreadRing* ring = threads.load(std::memory_order_acquire);
+        while (ring)
+        {
+            ThreadRing* next = ring->next;
+            delete ring;
+            ring = next;
+        }
+    }
+
+    ZoneProfiler(const ZoneProfiler&) = delete;
+    ZoneProfiler& operator=(const ZoneProfiler&) = delete;
+
+    static uint64_t NextGeneration() noexcept
+    {
+        static std::atomic<uint64_t> s_generation(0);
+        return ++s_generation;
+    }
+
+    static int64_t GetTicks()
+    {
+        LARGE_INTEGER ticks;
+        std::ignore = QueryPerformanceCounter(&ticks);
+        return ticks.QuadPart;
+    }
+
+    ThreadRing* GetThreadRing()
+    {
+        // Profilers get unique generations, so a cached ring can't be mistaken for one belonging to another
+        // profiler at the same address
+        struct LocalCache
+        {
+            uint64_t    generation;
+            ThreadRing* ring;
+        };
+        static thread_local LocalCache s_cache = {};
+
+        if (s_cache.generation == generation)
+        {
+            return s_cache.ring;
+        }
+
+        const DWORD threadId = GetCurrentThreadId();
+        ThreadRing* head = threads.load(std::memory_order_acquire);
+        ThreadRing* ring = head;
+        while (ring && ring->threadId != threadId)
+        {
+            ring = ring->next;
+        }
+
+        if (!ring)
+        {
+            ring = new ThreadRing(threadId);
+            ring->next = head;
+            while (!threads.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_acquire))
+            {
+            }
+        }
+
+        s_cache.generation = generation;
+        s_cache.ring = ring;
+        return ring;
+    }
+
+    void BeginZone(const char* name)
+    {
+        ThreadRing* ring = GetThreadRing();
+        const uint32_t depth = ring->depth++;
+        if (ring->droppedDepth < depth)
+        {
+            // Zones nested in a dropped zone are dropped too, rather than showing up under the wrong parent
+            return;
+        }
+
+        // Keep room for this zone's end and the ends of all the zones open around it, so that every recorded
+        // begin is matched by a recorded end
+        const uint32_t head = ring->head.load(std::memory_order_relaxed);
+        const uint32_t tail = ring->tail.load(std::memory_order_acquire);
+        if (head - tail + depth + 2 > c_ringSize)
+        {
+            ring->droppedDepth = depth;
+            return;
+        }
+
+        ring->events[head & (c_ringSize - 1)] = { GetTicks(), name };
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    void EndZone()
+    {
+        const int64_t ticks = GetTicks();
+
+        ThreadRing* ring = GetThreadRing();
+        if (ring->depth == 0)
+        {
+#if defined(_DEBUG)
+            OutputDebugStringA("ERROR: Zone ended but not begun\n");
+#endif
+            return;
+        }
+
+        const uint32_t depth = --ring->depth;
+        if (ring->droppedDepth <= depth)
+        {
+            if (ring->droppedDepth == depth)
+            {
+                ring->droppedDepth = UINT32_MAX;
+            }
+            return;
+        }
+
+        const uint32_t head = ring->head.load(std::memory_order_relaxed);
+        ring->events[head & (c_ringSize - 1)] = { ticks, nullptr };
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    static uint32_t FindOrAddChild(ThreadRing& ring, uint32_t parent, const char* name)
+    {
+        uint32_t* link = (parent == c_noNode) ? &ring.firstRoot : &ring.nodes[parent].firstChild;
+        while (*link != c_noNode)
+        {
+            const Node& node = ring.nodes[*link];
+            if (node.name == name || strcmp(node.name, name) == 0)
+            {
+                return *link;
+            }
+            link = &ring.nodes[*link].nextSibling;
+        }
+
+        // The link may point into the vector, so grab the index before it can grow
+        const auto index = static_cast<uint32_t>(ring.nodes.size());
+        *link = index;
+        ring.nodes.push_back({ name, parent, c_noNode, c_noNode, 0, 0, 0, 0.f, 0.f });
+        return index;
+    }
+
+    void Update(double qpfFreqInv)
+    {
+        const bool capturing = captureFramesRemaining > 0;
+
+        zones.clear();
+        for (ThreadRing* ring = threads.load(std::memory_order_acquire); ring; ring = ring->next)
+        {
+            const uint32_t head = ring->head.load(std::memory_order_acquire);
+            for (uint32_t j = ring->tail.load(std::memory_order_relaxed); j != head; ++j)
+            {
+                const ZoneEvent& event = ring->events[j & (c_ringSize - 1)];
+                if (event.name)
+                {
+                    const uint32_t parent = ring->openZones.empty() ? c_noNode : ring->openZones.back().node;
+                    ring->openZones.push_back({ FindOrAddChild(*ring, parent, event.name), event.ticks, capturing });
+                    if (capturing)
+                    {
+                        trace.push_back({ event.ticks, event.name, ring->threadId, true });
+                    }
+                }
+                else if (!ring->openZones.empty())
+                {
+                    const OpenZone zone = ring->openZones.back();
+                    ring->openZones.pop_back();
+
+                    Node& node = ring->nodes[zone.node];
+                    const int64_t elapsed = event.ticks - zone.startTicks;
+                    ++node.callCount;
+                    node.totalTicks += elapsed;
+                    if (node.parent != c_noNode)
+                    {
+                        ring->nodes[node.parent].childTicks += elapsed;
+                    }
+
+                    // Skip the end of zones whose beginning predates the capture
+                    if (zone.traced && capturing)
+                    {
+                        trace.push_back({ event.ticks, node.name, ring->threadId, false });
+                    }
+                }
+            }
+            ring->tail.store(head, std::memory_order_release);
+
+            for (auto& node : ring->nodes)
+            {
+                const double totalMS = double(node.totalTicks) * qpfFreqInv;
+                const double selfMS = double(node.totalTicks - node.childTicks) * qpfFreqInv;
+                node.averageTotalMS = UpdateRunningAverage(node.averageTotalMS, float(totalMS));
+                node.averageSelfMS = UpdateRunningAverage(node.averageSelfMS, float(selfMS));
+            }
+
+            AppendZones(*ring, ring->firstRoot, 0, qpfFreqInv);
+
+            for (auto& node : ring->nodes)
+            {
+                node.callCount = 0;
+                node.totalTicks = 0;
+                node.childTicks = 0;
+            }
+        }
+
+        if (capturing)
+        {
+            --captureFramesRemaining;
+        }
+    }
+
+    void AppendZones(const ThreadRing& ring, uint32_t first, uint32_t depth, double qpfFreqInv)
+    {
+        for (uint32_t index = first; index != c_noNode; index = ring.nodes[index].nextSibling)
+        {
+            const Node& node = ring.nodes[index];
+
+            ZoneStats stats = {};
+            stats.name = node.name;
+            stats.threadId = ring.threadId;
+            stats.depth = depth;
+            stats.callCount = node.callCount;
+            stats.totalMS = double(node.totalTicks) * qpfFreqInv;
+            stats.selfMS = double(node.totalTicks - node.childTicks) * qpfFreqInv;
+            stats.averageTotalMS = node.averageTotalMS;
+            stats.averageSelfMS = node.averageSelfMS;
+            zones.push_back(stats);
+
+            AppendZones(ring, node.firstChild, depth + 1, qpfFreqInv);
+        }
+    }
+
+    void Reset()
+    {
+        for (ThreadRing* ring = threads.load(std::memory_order_acquire); ring; ring = ring->next)
+        {
+            for (auto& node : ring->nodes)
+            {
+                node.averageTotalMS = node.averageSelfMS = 0.f;
+            }
+        }
+    }
+
+    const uint64_t              generation;
+    std::atomic<ThreadRing*>    threads;
+    std::vector<ZoneStats>      zones;
+    std::vector<TraceEvent>     trace;
+    uint32_t                    captureFramesRemaining;
+};
+
+
 CPUTimer::CPUTimer() :
     m_qpfFreqInv(1.f),
     m_start{},
     m_end{},
-    m_avg{}
+    m_avg{},
+    m_zones(std::make_unique<ZoneProfiler>())
 {
     LARGE_INTEGER qpfFreq;
     if (!QueryPerformanceFrequency(&qpfFreq))
@@ -77,6 +408,11 @@ CPUTimer::CPUTimer() :
     m_qpfFreqInv = 1000.0 / double(qpfFreq.QuadPart);
 }
 
+CPUTimer::~CPUTimer() = default;
+
+CPUTimer::CPUTimer(CPUTimer&&) noexcept = default;
+CPUTimer& CPUTimer::operator=(CPUTimer&&) noexcept = default;
+
 void CPUTimer::Start(uint32_t timerid)
 {
     if (timerid >= c_maxTimers)
@@ -111,11 +447,14 @@ void CPUTimer::Update()
         const float value = float(double(end - start) * m_qpfFreqInv);
         m_avg[j] = UpdateRunningAverage(m_avg[j], value);
     }
+
+    m_zones->Update(m_qpfFreqInv);
 }
 
 void CPUTimer::Reset()
 {
     memset(m_avg, 0, sizeof(m_avg));
+    m_zones->Reset();
 }
 
 double CPUTimer::GetElapsedMS(uint32_t timerid) const
@@ -129,6 +468,76 @@ double CPUTimer::GetElapsedMS(uint32_t timerid) const
     return double(end - start) * m_qpfFreqInv;
 }
 
+void CPUTimer::BeginZone(const char* name)
+{
+    m_zones->BeginZone(name);
+}
+
+void CPUTimer::EndZone()
+{
+    m_zones->EndZone();
+}
+
+const std::vector<CPUTimer::ZoneStats>& CPUTimer::GetZones() const
+{
+    return m_zones->zones;
+}
+
+void CPUTimer::CaptureTrace(uint32_t frameCount)
+{
+    m_zones->trace.clear();
+    m_zones->captureFramesRemaining = frameCount;
+}
+
+bool CPUTimer::IsCapturingTrace() const
+{
+    return m_zones->captureFramesRemaining > 0;
+}
+
+bool CPUTimer::SaveTrace(const wchar_t* fileName) const
+{
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, fileName, L"wb") != 0 || !file)
+    {
+        return false;
+    }
+
+    const auto& trace = m_zones->trace;
+    const int64_t baseTicks = trace.empty() ? 0 : trace.front().ticks;
+    const double ticksToUS = m_qpfFreqInv * 1000.0;
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", file);
+    for (size_t j = 0; j < trace.size(); ++j)
+    {
+        const ZoneProfiler::TraceEvent& event = trace[j];
+
+        // Zone names are identifiers in practice, but keep the JSON valid regardless
+        char name[256] = {};
+        size_t length = 0;
+        for (const char* c = event.name; *c && length < sizeof(name) - 2; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                name[length++] = '\\';
+            }
+            name[length++] = (static_cast<unsigned char>(*c) < 0x20) ? ' ' : *c;
+        }
+
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lu,\"tid\":%lu}%s\n",
+            name,
+            event.begin ? 'B' : 'E',
+            double(event.ticks - baseTicks) * ticksToUS,
+            GetCurrentProcessId(),
+            event.threadId,
+            (j + 1 < trace.size()) ? "," : "");
+    }
+    fputs("]}\n", file);
+
+    const bool result = (ferror(file) == 0);
+    fclose(file);
+    return result;
+}
+
 
 //======================================================================================
 // GPUTimer (DirectX 12)
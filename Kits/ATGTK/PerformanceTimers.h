@@ -9,28 +9,70 @@
 
 #pragma once
 
+#include <cstdint>
+#include <memory>
+#include <vector>
+
 
 namespace DX
 {
     //----------------------------------------------------------------------------------
     // CPU performance timer
+    //
+    // Besides the indexed timers, CPUTimer profiles named zones, which may nest and may be recorded from
+    // any number of threads. Each thread writes its zone events to its own lock-free ring buffer, and
+    // Update() turns them into a call tree per thread with total and self times. Zones can also be
+    // captured over several frames and saved in the Chrome trace event format (chrome://tracing, Perfetto).
     class CPUTimer
     {
     public:
         static constexpr size_t c_maxTimers = 8;
 
+        // Results for one node of a thread's zone tree
+        struct ZoneStats
+        {
+            const char* name;
+            uint32_t    threadId;
+            uint32_t    depth;              // 0 for zones with no parent on their thread
+            uint32_t    callCount;          // calls completed in the last frame
+            double      totalMS;            // time spent in the zone in the last frame
+            double      selfMS;             // totalMS minus the time spent in child zones
+            float       averageTotalMS;     // running averages
+            float       averageSelfMS;
+        };
+
+        // Profiles the enclosing scope as a zone
+        class ScopedZone
+        {
+        public:
+            ScopedZone(CPUTimer& timer, const char* name) : m_timer(&timer) { timer.BeginZone(name); }
+            ~ScopedZone() { m_timer->EndZone(); }
+
+            ScopedZone(const ScopedZone&) = delete;
+            ScopedZone& operator=(const ScopedZone&) = delete;
+
+        private:
+            CPUTimer* m_timer;
+        };
+
         CPUTimer();
+        ~CPUTimer();
 
         CPUTimer(const CPUTimer&) = delete;
         CPUTimer& operator=(const CPUTimer&) = delete;
 
-        CPUTimer(CPUTimer&&) = default;
-        CPUTimer& operator=(CPUTimer&&) = default;
+        CPUTimer(CPUTimer&&) noexcept;
+        CPUTimer& operator=(CPUTimer&&) noexcept;
 
         // Start/stop a particular performance timer (don't start same index more than once in a single frame)
         void Start(uint32_t timerid = 0);
         void Stop(uint32_t timerid = 0);
 
+        // Begin/end a named zone on the calling thread. Zones must be ended in the reverse order they were begun,
+        // on the same thread. The name is stored by pointer, so it must outlive the timer (a string literal is ideal).
+        void BeginZone(_In_z_ const char* name);
+        void EndZone();
+
         // Should Update once per frame to compute timer results
         void Update();
 
@@ -46,11 +88,25 @@ namespace DX
             return (timerid < c_maxTimers) ? m_avg[timerid] : 0.f;
         }
 
+        // Returns the zone tree as of the last Update, depth-first and grouped by thread.
+        // A zone still open at Update is counted in the frame it ends.
+        const std::vector<ZoneStats>& GetZones() const;
+
+        // Records all zone events from the next frameCount calls to Update for SaveTrace
+        void CaptureTrace(uint32_t frameCount);
+        bool IsCapturingTrace() const;
+
+        // Writes the last capture as Chrome trace event JSON
+        bool SaveTrace(_In_z_ const wchar_t* fileName) const;
+
     private:
-        double          m_qpfFreqInv;
-        LARGE_INTEGER   m_start[c_maxTimers];
-        LARGE_INTEGER   m_end[c_maxTimers];
-        float           m_avg[c_maxTimers];
+        struct ZoneProfiler;
+
+        double                          m_qpfFreqInv;
+        LARGE_INTEGER                   m_start[c_maxTimers];
+        LARGE_INTEGER                   m_end[c_maxTimers];
+        float                           m_avg[c_maxTimers];
+        std::unique_ptr<ZoneProfiler>   m_zones;
     };
 
 
@@ -11,12 +11,16 @@
 #include "pch.h"
 #include "ReadCompressedData.h"
 
-#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <exception>
-#include <fstream>
 #include <memory>
 #include <stdexcept>
+#include <system_error>
+#include <thread>
 
+#ifdef _WIN32
 #ifndef NTDDI_WIN10_FE
 #undef WINAPI_FAMILY_PARTITION
 #define WINAPI_FAMILY_PARTITION(Partitions) 1
@@ -28,11 +32,19 @@
 #undef WINAPI_FAMILY_PARTITION
 #define WINAPI_FAMILY_PARTITION(Partitions) (Partitions)
 #endif
+#endif
 
 namespace
 {
     constexpr uint8_t c_CFileSignatureLen = 8;
-    constexpr uint8_t c_CFileVersion = 0x41;
+    constexpr uint8_t c_CFileVersion = 0x41;        // Single Compression API buffer
+    constexpr uint8_t c_CFileVersionChunked = 0x42; // Independently compressed chunks with an offset table
+
+    constexpr uint8_t c_ModeStored = 0;             // Chunks are stored without compression
+
+    // Starting a thread and its decompressor costs more than decoding a few small chunks, so a
+    // read only fans out once every thread has at least this much uncompressed data to produce.
+    constexpr size_t c_MinBytesPerThread = 4 * 1024 * 1024;
 
     const uint8_t c_Signature[c_CFileSignatureLen] = { 0x41, 0x46, 0x43, 0x57, 0x47, 0x50, 0x53, 0x4d };
 
@@ -42,13 +54,23 @@ namespace
         uint8_t     magic[c_CFileSignatureLen]; // Must match c_Signature below
         uint8_t     mode;                       // COMPRESS_ALGORITHM_x enum
         uint8_t     version;
-        wchar_t     lastChar;
+        uint16_t    lastChar;                   // UTF-16LE, so the layout matches on non-Windows hosts
         uint32_t    uncompressedSized;
     };
+
+    // Follows CFileHeader in version 'B' files, and is followed by chunkCount + 1 offsets
+    // of the compressed chunks relative to the end of the offset table.
+    struct CChunkHeader
+    {
+        uint32_t    chunkSize;                  // Uncompressed size of every chunk but the last
+        uint32_t    chunkCount;
+    };
 #pragma pack(pop)
 
     static_assert(sizeof(CFileHeader) == 16, "File header size mismatch");
+    static_assert(sizeof(CChunkHeader) == 8, "Chunk header size mismatch");
 
+#ifdef _WIN32
     PVOID SimpleAlloc(PVOID, SIZE_T Size)
     {
         return malloc(Size);
@@ -59,104 +81,85 @@ namespace
         free(Memory);
     }
 
-    struct decompressor_closer { void operator()(void* h) { if (h) CloseDecompressor(static_cast<DECOMPRESSOR_HANDLE>(h)); } };
-
-    HRESULT DecompressFile(
-        _In_reads_bytes_(dataLen) const void* data,
-        size_t dataLen,
-        std::vector<uint8_t>& blob)
-    {
-        if (!data || !dataLen)
-            return E_INVALIDARG;
+    COMPRESS_ALLOCATION_ROUTINES s_allocData = { SimpleAlloc, SimpleFree, nullptr };
 
-        if (dataLen <= sizeof(CFileHeader))
-            return E_FAIL;
+    struct decompressor_closer { void operator()(void* h) { if (h) CloseDecompressor(static_cast<DECOMPRESSOR_HANDLE>(h)); } };
+#endif
+}
 
-        auto hdr = reinterpret_cast<const CFileHeader*>(data);
-        if (memcmp(hdr, c_Signature, c_CFileSignatureLen) != 0)
-            return E_FAIL;
+//--------------------------------------------------------------------------------------
+// Chunk codecs
+//--------------------------------------------------------------------------------------
 
-        if (hdr->version != c_CFileVersion)
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+DX::ChunkDecoder DX::StoredChunkCodec(uint8_t mode)
+{
+    if (mode != c_ModeStored)
+        return {};
 
-        switch (hdr->mode)
+    return [](const void* src, size_t srcLen, void* dest, size_t destLen) -> bool
         {
-        case COMPRESS_ALGORITHM_MSZIP:
-        case COMPRESS_ALGORITHM_LZMS:
-            break;
+            if (srcLen != destLen)
+                return false;
 
-        default:
-            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
-        }
+            memcpy(dest, src, destLen);
+            return true;
+        };
+}
 
-        COMPRESS_ALLOCATION_ROUTINES allocData = { SimpleAlloc, SimpleFree, nullptr };
+DX::ChunkDecoder DX::DefaultChunkCodec(uint8_t mode)
+{
+#ifdef _WIN32
+    switch (mode)
+    {
+    case COMPRESS_ALGORITHM_MSZIP:
+    case COMPRESS_ALGORITHM_LZMS:
+        break;
 
-        std::unique_ptr<void, decompressor_closer> decompressor;
-        {
-            DECOMPRESSOR_HANDLE h = nullptr;
-            if (!CreateDecompressor(
-                static_cast<DWORD>(hdr->mode),
-                &allocData,
-                &h))
-            {
-                return HRESULT_FROM_WIN32(GetLastError());
-            }
+    default:
+        return StoredChunkCodec(mode);
+    }
 
-            decompressor.reset(h);
-        }
+    DECOMPRESSOR_HANDLE h = nullptr;
+    if (!CreateDecompressor(static_cast<DWORD>(mode), &s_allocData, &h))
+        return {};
 
-        // Query decompressed buffer size.
-        auto payload = reinterpret_cast<const void*>(reinterpret_cast<const uint8_t*>(data) + sizeof(CFileHeader));
-        const size_t payloadLen = dataLen - sizeof(CFileHeader);
-
-        SIZE_T bufferSize;
-        if (!Decompress(
-            static_cast<DECOMPRESSOR_HANDLE>(decompressor.get()),
-            payload,
-            payloadLen,
-            nullptr,
-            0,
-            &bufferSize))
+    std::shared_ptr<void> decompressor(h, decompressor_closer());
+
+    return [decompressor](const void* src, size_t srcLen, void* dest, size_t destLen) -> bool
         {
-            const DWORD errorCode = GetLastError();
-            if (errorCode != ERROR_INSUFFICIENT_BUFFER)
+            SIZE_T outLen = 0;
+            if (!Decompress(
+                static_cast<DECOMPRESSOR_HANDLE>(decompressor.get()),
+                src,
+                srcLen,
+                dest,
+                destLen,
+                &outLen))
             {
-                return HRESULT_FROM_WIN32(GetLastError());
+                return false;
             }
-        }
-
-        if (SIZE_T(hdr->uncompressedSized) != bufferSize)
-            return E_FAIL;
 
-        blob.resize(bufferSize);
-
-        SIZE_T blobSize;
-        if (!Decompress(
-            static_cast<DECOMPRESSOR_HANDLE>(decompressor.get()),
-            payload,
-            payloadLen,
-            blob.data(),
-            bufferSize,
-            &blobSize))
-        {
-            return HRESULT_FROM_WIN32(GetLastError());
-        }
-
-        if (blobSize > UINT32_MAX)
-        {
-            return E_FAIL;
-        }
-
-        blob.resize(blobSize);
-
-        return S_OK;
-    }
+            return outLen == destLen;
+        };
+#else
+    return StoredChunkCodec(mode);
+#endif
 }
 
-std::vector<uint8_t> DX::ReadCompressedData(_In_z_ const wchar_t* name)
+//--------------------------------------------------------------------------------------
+// CompressedFile
+//--------------------------------------------------------------------------------------
+
+DX::CompressedFile::CompressedFile(_In_z_ const wchar_t* name, ChunkCodec codec) :
+    m_file(name, std::ios::in | std::ios::binary | std::ios::ate),
+    m_codec(std::move(codec)),
+    m_payloadOffset(0),
+    m_size(0),
+    m_chunkSize(0),
+    m_mode(0),
+    m_legacy(false)
 {
-    std::ifstream inFile(name, std::ios::in | std::ios::binary | std::ios::ate);
-    if (!inFile)
+    if (!m_file)
     {
 #ifdef _DEBUG
         wchar_t errorMessage[1024] = {};
@@ -166,28 +169,273 @@ std::vector<uint8_t> DX::ReadCompressedData(_In_z_ const wchar_t* name)
         throw std::runtime_error("ReadCompressedData");
     }
 
-    const std::streampos compressedLen = inFile.tellg();
-    if (!inFile)
+    if (!m_codec)
+        throw std::invalid_argument("ReadCompressedData");
+
+    const std::streamoff fileLen = m_file.tellg();
+    if (!m_file || fileLen <= static_cast<std::streamoff>(sizeof(CFileHeader)))
         throw std::runtime_error("ReadCompressedData");
 
-    auto compressedData = std::make_unique<uint8_t[]>(static_cast<size_t>(compressedLen));
+    m_file.seekg(0, std::ios::beg);
 
-    inFile.seekg(0, std::ios::beg);
-    if (!inFile)
+    CFileHeader hdr = {};
+    m_file.read(reinterpret_cast<char*>(&hdr), sizeof(hdr));
+    if (!m_file)
         throw std::runtime_error("ReadCompressedData");
 
-    inFile.read(reinterpret_cast<char*>(compressedData.get()), compressedLen);
-    if (!inFile)
+    if (memcmp(hdr.magic, c_Signature, c_CFileSignatureLen) != 0)
         throw std::runtime_error("ReadCompressedData");
 
-    inFile.close();
+    m_mode = hdr.mode;
+    m_size = hdr.uncompressedSized;
+    if (!m_size)
+        throw std::runtime_error("ReadCompressedData");
 
-    std::vector<uint8_t> blob;
+    switch (hdr.version)
+    {
+    case c_CFileVersion:
+        // The whole file is one chunk which is never stored uncompressed.
+        m_legacy = true;
+        m_chunkSize = m_size;
+        m_payloadOffset = sizeof(CFileHeader);
+        if (fileLen - m_payloadOffset > UINT32_MAX)
+            throw std::runtime_error("ReadCompressedData");
+
+        m_chunkOffsets = { 0, static_cast<uint32_t>(fileLen - m_payloadOffset) };
+        break;
+
+    case c_CFileVersionChunked:
+    {
+        CChunkHeader chunkHdr = {};
+        m_file.read(reinterpret_cast<char*>(&chunkHdr), sizeof(chunkHdr));
+        if (!m_file || !chunkHdr.chunkSize)
+            throw std::runtime_error("ReadCompressedData");
+
+        m_chunkSize = chunkHdr.chunkSize;
+        if (chunkHdr.chunkCount != (m_size + m_chunkSize - 1) / m_chunkSize)
+            throw std::runtime_error("ReadCompressedData");
+
+        m_chunkOffsets.resize(size_t(chunkHdr.chunkCount) + 1);
+        m_file.read(reinterpret_cast<char*>(m_chunkOffsets.data()),
+            static_cast<std::streamsize>(m_chunkOffsets.size() * sizeof(uint32_t)));
+        if (!m_file)
+            throw std::runtime_error("ReadCompressedData");
+
+        m_payloadOffset = m_file.tellg();
+        if (m_chunkOffsets.front() != 0
+            || !std::is_sorted(m_chunkOffsets.cbegin(), m_chunkOffsets.cend())
+            || m_chunkOffsets.back() > static_cast<uint64_t>(fileLen - m_payloadOffset))
+        {
+            throw std::runtime_error("ReadCompressedData");
+        }
+        break;
+    }
 
-    if (FAILED(DecompressFile(compressedData.get(), static_cast<size_t>(compressedLen), blob)))
+    default:
+#ifdef _DEBUG
+        OutputDebugStringW(L"ERROR: ReadCompressedData unknown file version\n");
+#endif
+        throw std::runtime_error("ReadCompressedData");
+    }
+
+    // Fail early rather than on the first read if the codec can't handle this file. The decoder is
+    // kept, so opening the file doesn't cost an extra one.
+    m_decoder = m_codec(m_mode);
+    if (!m_decoder)
+        throw std::runtime_error("ReadCompressedData");
+}
+
+void DX::CompressedFile::Read(size_t offset, size_t size, _Out_writes_bytes_(size) void* dest)
+{
+    if (offset > m_size || size > (m_size - offset))
+        throw std::out_of_range("ReadCompressedData");
+
+    if (!size)
+        return;
+
+    if (!dest)
+        throw std::invalid_argument("ReadCompressedData");
+
+    const size_t firstChunk = offset / m_chunkSize;
+    const size_t lastChunk = (offset + size - 1) / m_chunkSize;
+
+    // The chunks overlapping the range are contiguous on disk, so they are fetched with one read.
+    const size_t compressedLen = m_chunkOffsets[lastChunk + 1] - m_chunkOffsets[firstChunk];
+    auto compressed = std::make_unique<uint8_t[]>(compressedLen);
+
+    {
+        std::lock_guard<std::mutex> lock(m_fileLock);
+
+        m_file.clear();
+        m_file.seekg(m_payloadOffset + static_cast<std::streamoff>(m_chunkOffsets[firstChunk]), std::ios::beg);
+        m_file.read(reinterpret_cast<char*>(compressed.get()), static_cast<std::streamsize>(compressedLen));
+        if (!m_file)
+            throw std::runtime_error("ReadCompressedData");
+    }
+
+    DecodeChunks(firstChunk, lastChunk, compressed.get(), offset, size, static_cast<uint8_t*>(dest));
+}
+
+void DX::CompressedFile::DecodeChunks(
+    size_t firstChunk,
+    size_t lastChunk,
+    const uint8_t* compressed,
+    size_t offset,
+    size_t size,
+    uint8_t* dest)
+{
+    std::atomic<size_t> nextChunk(firstChunk);
+    std::atomic<bool> failed(false);
+
+    auto worker = [&]()
+        {
+            try
+            {
+                ChunkDecoder decoder;
+                std::unique_ptr<uint8_t[]> scratch;
+
+                for (;;)
+                {
+                    const size_t chunk = nextChunk.fetch_add(1);
+                    if (chunk > lastChunk || failed.load(std::memory_order_relaxed))
+                        break;
+
+                    const size_t chunkBegin = chunk * m_chunkSize;
+                    const size_t chunkLen = std::min(m_chunkSize, m_size - chunkBegin);
+
+                    const uint8_t* src = compressed + (m_chunkOffsets[chunk] - m_chunkOffsets[firstChunk]);
+                    const size_t srcLen = m_chunkOffsets[chunk + 1] - m_chunkOffsets[chunk];
+
+                    // Portion of this chunk which lies inside the requested range
+                    const size_t copyBegin = std::max(chunkBegin, offset);
+                    const size_t copyEnd = std::min(chunkBegin + chunkLen, offset + size);
+                    uint8_t* target = dest + (copyBegin - offset);
+
+                    if (!m_legacy && srcLen == chunkLen)
+                    {
+                        // Chunks which didn't shrink are written as-is.
+                        memcpy(target, src + (copyBegin - chunkBegin), copyEnd - copyBegin);
+                        continue;
+                    }
+
+                    if (!decoder)
+                    {
+                        decoder = AcquireDecoder();
+                        if (!decoder)
+                        {
+                            failed = true;
+                            break;
+                        }
+                    }
+
+                    if (copyBegin == chunkBegin && copyEnd == chunkBegin + chunkLen)
+                    {
+                        // Whole chunk requested, so decompress straight into the caller's buffer.
+                        if (!decoder(src, srcLen, target, chunkLen))
+                        {
+                            failed = true;
+                            break;
+                        }
+                    }
+                    else
+                    {
+                        if (!scratch)
+                            scratch = std::make_unique<uint8_t[]>(m_chunkSize);
+
+                        if (!decoder(src, srcLen, scratch.get(), chunkLen))
+                        {
+                            failed = true;
+                            break;
+                        }
+
+                        memcpy(target, scratch.get() + (copyBegin - chunkBegin), copyEnd - copyBegin);
+                    }
+                }
+
+                ReleaseDecoder(decoder);
+            }
+            catch (...)
+            {
+                failed = true;
+            }
+        };
+
+    // The calling thread decodes as well, so small reads never start a thread.
+    const size_t chunkCount = lastChunk - firstChunk + 1;
+    const size_t chunksPerThread = std::max<size_t>(1, c_MinBytesPerThread / m_chunkSize);
+    const size_t threadCount = std::min<size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        (chunkCount + chunksPerThread - 1) / chunksPerThread);
+
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount - 1);
+    for (size_t j = 1; j < threadCount; ++j)
+    {
+        try
+        {
+            threads.emplace_back(worker);
+        }
+        catch (const std::system_error&)
+        {
+            break;
+        }
+    }
+
+    worker();
+
+    for (auto& t : threads)
     {
+        t.join();
+    }
+
+    if (failed)
         throw std::runtime_error("ReadCompressedData");
+}
+
+// One decoder is kept between reads and handed to the first worker which needs it. Any other
+// worker creates its own.
+DX::ChunkDecoder DX::CompressedFile::AcquireDecoder()
+{
+    ChunkDecoder decoder;
+    {
+        std::lock_guard<std::mutex> lock(m_decoderLock);
+        decoder.swap(m_decoder);
     }
 
+    if (!decoder)
+        decoder = m_codec(m_mode);
+
+    return decoder;
+}
+
+void DX::CompressedFile::ReleaseDecoder(ChunkDecoder& decoder)
+{
+    if (!decoder)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_decoderLock);
+    if (!m_decoder)
+        m_decoder.swap(decoder);
+}
+
+//--------------------------------------------------------------------------------------
+
+std::vector<uint8_t> DX::ReadCompressedData(_In_z_ const wchar_t* name)
+{
+    CompressedFile file(name);
+
+    std::vector<uint8_t> blob(file.GetSize());
+    file.Read(0, blob.size(), blob.data());
+
     return blob;
 }
+
+void DX::ReadCompressedData(_In_z_ const wchar_t* name, _Out_writes_bytes_(size) void* dest, size_t size)
+{
+    CompressedFile file(name);
+
+    if (size != file.GetSize())
+        throw std::invalid_argument("ReadCompressedData");
+
+    file.Read(0, size, dest);
+}
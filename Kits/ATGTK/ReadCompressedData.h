@@ -9,7 +9,11 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
 #include <vector>
 
 #ifdef _GAMING_DESKTOP
@@ -19,5 +23,63 @@
 
 namespace DX
 {
+    // Decompresses one chunk of srcLen bytes into exactly destLen bytes. Returns false on failure.
+    using ChunkDecoder = std::function<bool(const void* src, size_t srcLen, void* dest, size_t destLen)>;
+
+    // Returns a decoder for the file's compression mode, or an empty function if the mode is not
+    // supported. A decoder is only used by one thread at a time, so it may hold per-thread state.
+    using ChunkCodec = std::function<ChunkDecoder(uint8_t mode)>;
+
+    // Portable codec which only accepts files written with 'xbcompress -s' (chunks stored as-is)
+    ChunkDecoder StoredChunkCodec(uint8_t mode);
+
+    // Compression API codec for LZMS and MSZIP, which falls back to StoredChunkCodec
+    ChunkDecoder DefaultChunkCodec(uint8_t mode);
+
+    // Random-access reader for 'xbcompress' files. Version 'B' files are split into independently
+    // compressed chunks, so only the chunks overlapping a requested byte range are read from disk,
+    // and large ranges are decompressed in parallel directly into the caller's buffer. Version 'A' files
+    // are handled as a single chunk.
+    class CompressedFile
+    {
+    public:
+        explicit CompressedFile(_In_z_ const wchar_t* name, ChunkCodec codec = DefaultChunkCodec);
+
+        CompressedFile(CompressedFile&&) = delete;
+        CompressedFile& operator= (CompressedFile&&) = delete;
+
+        CompressedFile(CompressedFile const&) = delete;
+        CompressedFile& operator= (CompressedFile const&) = delete;
+
+        // Size in bytes of the uncompressed data
+        size_t GetSize() const noexcept { return m_size; }
+
+        // Uncompressed size of each chunk (the last chunk may be smaller)
+        size_t GetChunkSize() const noexcept { return m_chunkSize; }
+
+        // Decompresses bytes [offset, offset + size) of the original data into dest
+        void Read(size_t offset, size_t size, _Out_writes_bytes_(size) void* dest);
+
+    private:
+        void DecodeChunks(size_t firstChunk, size_t lastChunk, const uint8_t* compressed, size_t offset, size_t size, uint8_t* dest);
+        ChunkDecoder AcquireDecoder();
+        void ReleaseDecoder(ChunkDecoder& decoder);
+
+        std::ifstream           m_file;
+        std::mutex              m_fileLock;
+        ChunkCodec              m_codec;
+        ChunkDecoder            m_decoder;      // Kept between reads; see AcquireDecoder
+        std::mutex              m_decoderLock;
+        std::vector<uint32_t>   m_chunkOffsets;
+        std::streamoff          m_payloadOffset;
+        size_t                  m_size;
+        size_t                  m_chunkSize;
+        uint8_t                 m_mode;
+        bool                    m_legacy;
+    };
+
     std::vector<uint8_t> ReadCompressedData(_In_z_ const wchar_t* name);
+
+    // Decompresses the whole file into a caller-provided buffer, which must be exactly GetSize() bytes
+    void ReadCompressedData(_In_z_ const wchar_t* name, _Out_writes_bytes_(size) void* dest, size_t size);
 }
@@ -21,12 +21,17 @@
 #include <assert.h>
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <exception>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 // DirectXTK12 dependencies
@@ -229,9 +234,112 @@ namespace
 
 #pragma warning(pop)
 
+    // Bounded multi-producer, multi-consumer queue (Dmitry Vyukov's algorithm). Every cell carries a sequence
+    // number that tells producers and consumers whose turn it is, so neither TryPush nor TryPop takes a lock.
+    template<typename T>
+    class RequestQueue
+    {
+    public:
+        // capacity must be a power of two
+        explicit RequestQueue(size_t capacity)
+            : m_cells(new Cell[capacity])
+            , m_mask(capacity - 1)
+            , m_enqueuePos(0)
+            , m_dequeuePos(0)
+        {
+            assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+
+            for (size_t index = 0; index < capacity; ++index)
+            {
+                m_cells[index].m_sequence.store(index, std::memory_order_relaxed);
+            }
+        }
+
+        RequestQueue(const RequestQueue&) = delete;
+        RequestQueue& operator=(const RequestQueue&) = delete;
+
+        // Returns false if the queue is full.
+        bool TryPush(T&& value)
+        {
+            size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = m_cells[pos & m_mask];
+                const size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+                const intptr_t difference = intptr_t(sequence) - intptr_t(pos);
+
+                if (difference == 0)
+                {
+                    if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        cell.m_value = std::move(value);
+                        cell.m_sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Returns false if the queue is empty.
+        bool TryPop(T& value)
+        {
+            size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                Cell& cell = m_cells[pos & m_mask];
+                const size_t sequence = cell.m_sequence.load(std::memory_order_acquire);
+                const intptr_t difference = intptr_t(sequence) - intptr_t(pos + 1);
+
+                if (difference == 0)
+                {
+                    if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        value = std::move(cell.m_value);
+                        cell.m_sequence.store(pos + m_mask + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    pos = m_dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> m_sequence;
+            T                   m_value;
+        };
+
+        std::unique_ptr<Cell[]>             m_cells;
+        size_t                              m_mask;
+        alignas(64) std::atomic<size_t>     m_enqueuePos;
+        alignas(64) std::atomic<size_t>     m_dequeuePos;
+    };
 }
 
+
 // Internal GlyphCache implementation class.
+//
+// Threading: strings are shaped on the calling thread, with the shaped string cache split into shards that each
+// have their own lock. Glyphs that are not cached yet are pushed onto a lock-free request queue and rasterized by
+// a pool of worker threads, which place them in the atlas and queue their texture uploads. Draws skip glyphs that
+// are still in flight, so a cache miss never blocks the caller; the glyph simply appears a frame or so later.
+// The glyph table, atlas and pending uploads share one lock that is only held for short lookups and updates.
 class GlyphCache::Impl
 {
 public:
@@ -247,27 +355,22 @@ public:
                 m_size == other.m_size;
         }
 
-        bool operator<(const GlyphKey& other) const
-        {
-            if (m_face != other.m_face)
-            {
-                return m_face < other.m_face;
-            }
-            else if (m_glyphIndex != other.m_glyphIndex)
-            {
-                return m_glyphIndex < other.m_glyphIndex;
-            }
-            else
-            {
-                return m_size < other.m_size;
-            }
-        }
-
         std::shared_ptr<Face>   m_face;
         FT_UInt                 m_glyphIndex;
         int                     m_size;
     };
 
+    struct GlyphKeyHash
+    {
+        size_t operator()(const GlyphKey& key) const
+        {
+            size_t hash = std::hash<Face*>()(key.m_face.get());
+            hash ^= std::hash<FT_UInt>()(key.m_glyphIndex) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            hash ^= std::hash<int>()(key.m_size) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+            return hash;
+        }
+    };
+
     struct ShapedStringKey
     {
         bool operator==(const ShapedStringKey& other) const
@@ -276,27 +379,23 @@ public:
                 m_string == other.m_string;
         }
 
-        bool operator<(const ShapedStringKey& other) const
-        {
-            if (m_fontSize != other.m_fontSize)
-            {
-                return m_fontSize < other.m_fontSize;
-            }
-            else
-            {
-                return m_string < other.m_string;
-            }
-        }
-
         std::u32string  m_string;
         int             m_fontSize;
     };
 
+    struct ShapedStringKeyHash
+    {
+        size_t operator()(const ShapedStringKey& key) const
+        {
+            return std::hash<std::u32string>()(key.m_string) ^ (std::hash<int>()(key.m_fontSize) << 1);
+        }
+    };
 
     struct ShapedString
     {
         ShapedString(std::shared_ptr<Face> face, hb_font_t* hbFont, const std::u32string& str, hb_script_t hbScript, const char* language)
-            : m_face(face)
+            : m_hbFont(hbFont)
+            , m_face(face)
         {
             m_hbBuffer = hb_buffer_create();
             hb_buffer_add_utf32(m_hbBuffer, reinterpret_cast<const uint32_t*>(str.c_str()), -1, 0, -1);
@@ -323,13 +422,32 @@ public:
         hb_buffer_t*            m_hbBuffer;
         hb_glyph_info_t*        m_hbGlyphInfos;
         hb_glyph_position_t*    m_hbGlyphPositions;
+        hb_font_t*              m_hbFont;   // owned by the face, sized for this string
         std::shared_ptr<Face>   m_face;
     };
 
     struct ShapedStringCacheInfo
     {
-        std::shared_ptr<ShapedString>       m_shapedString;
-        std::list<ShapedStringKey>::iterator m_usageFrequencyIter;
+        std::shared_ptr<ShapedString>           m_shapedString;
+        std::list<ShapedStringKey>::iterator    m_usageFrequencyIter;
+    };
+
+    // One slice of the shaped string cache. Strings are spread over the shards by hash, so threads shaping
+    // different strings rarely contend for the same lock.
+    struct ShapedStringShard
+    {
+        std::mutex                                                                          m_lock;
+        std::unordered_map<ShapedStringKey, ShapedStringCacheInfo, ShapedStringKeyHash>     m_cache;
+        std::list<ShapedStringKey>                                                          m_usageFrequency;
+    };
+
+    // A glyph rendered by FreeType, copied out of the face's glyph slot.
+    struct RenderedGlyph
+    {
+        FT_Glyph_Metrics        m_metrics;
+        unsigned int            m_width;
+        unsigned int            m_rows;
+        std::vector<uint8_t>    m_pixels;   // m_width * m_rows, tightly packed
     };
 
     struct Face : std::enable_shared_from_this<Face>
@@ -342,7 +460,15 @@ public:
             , m_lpCritSection(lpCritSection)
         {
             m_hbFace = hb_face_create(hbBlob, (unsigned int)faceIndex);
-            m_hbFont = hb_font_create(m_hbFace);
+
+            // Record the face's character map up front, so finding a face for a character never touches
+            // FreeType (whose faces must only be used by one thread at a time).
+            FT_UInt glyphIndex = 0;
+            for (FT_ULong charCode = FT_Get_First_Char(m_ftFace, &glyphIndex); glyphIndex != 0; charCode = FT_Get_Next_Char(m_ftFace, charCode, &glyphIndex))
+            {
+                m_characters.push_back(static_cast<char32_t>(charCode));
+            }
+            std::sort(m_characters.begin(), m_characters.end());
         }
 
         ~Face()
@@ -351,137 +477,115 @@ public:
             FT_Done_Face(m_ftFace);
             LeaveCriticalSection(m_lpCritSection);
 
-            hb_font_destroy(m_hbFont);
+            for (auto& hbFont : m_hbFonts)
+            {
+                hb_font_destroy(hbFont.second);
+            }
             hb_face_destroy(m_hbFace);
             hb_blob_destroy(m_hbBlob);
         }
 
-        void SetCharSize(int size);
-        std::shared_ptr<ShapedString> GetShapedString(const std::u32string& str, int size);
-
-        FT_Face             m_ftFace;
-        hb_blob_t*          m_hbBlob;
-        hb_face_t*          m_hbFace;
-        hb_font_t*          m_hbFont;
-        int                 m_priority;
-        int                 m_lastSize;
-        LPCRITICAL_SECTION  m_lpCritSection;
-    };
-
-    struct TextureCachePartitionRow;
-
-    struct TextureCachePartition : std::enable_shared_from_this<TextureCachePartition>
-    {
-        TextureCachePartition(RECT rect, std::weak_ptr<TextureCachePartitionRow> parent)
-            : m_rect(rect)
-            , m_glyphRect{0, 0, 0, 0}
-            , m_parent(parent)
-            , m_inUse(false)
+        bool HasCharacter(char32_t character) const
         {
-            ResetToUnused();
+            return std::binary_search(m_characters.begin(), m_characters.end(), character);
         }
 
-        void ResetToUnused();
-
-        void MarkInUse(int width, int height);
-        void ClearInUse();
-        bool IsInUse() const { return m_inUse; }
-        int GetWidth() const { return (m_rect.right - m_rect.left) + 1; }
-        int GetHeight() const { return (m_rect.bottom - m_rect.top) + 1; }
-        void SetNewRect(RECT newRect);
-        RECT GetRect() const { return m_rect; }
-        bool CouldInsertGlyph(int width, int height) const;
-        void TryCombiningWithNeighbors();
-
-        RECT                                    m_rect;
-        RECT                                    m_glyphRect;
-        std::weak_ptr<TextureCachePartitionRow> m_parent;
-        bool                                    m_inUse;
+        hb_font_t* GetHBFont(int size);
+        std::shared_ptr<ShapedString> GetShapedString(const std::u32string& str, int size);
+        bool RenderGlyph(FT_UInt glyphIndex, int size, RenderedGlyph& output);
+
+        FT_Face                     m_ftFace;
+        hb_blob_t*                  m_hbBlob;
+        hb_face_t*                  m_hbFace;
+        int                         m_priority;
+        int                         m_lastSize;
+        LPCRITICAL_SECTION          m_lpCritSection;
+        std::vector<char32_t>       m_characters;
+
+        // FreeType state (m_ftFace, m_lastSize) is only used by the rasterization workers, under this lock
+        std::mutex                  m_ftLock;
+
+        // HarfBuzz fonts are immutable once scaled, so each size gets its own and can be shaped on any thread
+        std::mutex                  m_hbFontLock;
+        std::map<int, hb_font_t*>   m_hbFonts;
     };
 
-    struct TextureCacheInfo;
-
-    struct TextureCachePartitionRow : std::enable_shared_from_this<TextureCachePartitionRow>
+    // A horizontal strip of an atlas texture. Glyphs are packed left to right, and the whole shelf is evicted at
+    // once when space is needed. A shelf is only evicted once every glyph on it has gone unused for a frame.
+    struct AtlasShelf
     {
-        TextureCachePartitionRow(RECT rect, std::weak_ptr<TextureCacheInfo> parent)
-            : m_rect(rect)
-            , m_maxChildHeight(0)
-            , m_parent(parent)
-        {
-        }
-
-        void ResetToUnused();
-
-        void TryCombiningChildren(std::shared_ptr<TextureCachePartition> hint);
-        std::shared_ptr<TextureCachePartition> TryAddingChildGlyph(int width, int height);
-
-        bool CouldFitGlyph(int width, int height) const;
-        void SetMaxChildHeight(int maxHeight) { m_maxChildHeight = maxHeight; }
-        int GetMaxChildHeight() const { return m_maxChildHeight; }
-        int GetWidth() const { return (m_rect.right - m_rect.left) + 1; }
-        int GetHeight() const { return (m_rect.bottom - m_rect.top) + 1; }
-        void SetNewRect(RECT newRect);
-        RECT GetRect() const { return m_rect; }
-
-        RECT                                                m_rect;
-        int                                                 m_maxChildHeight;
-        std::weak_ptr<TextureCacheInfo>                     m_parent;
-        std::list<std::shared_ptr<TextureCachePartition>>   m_children;
+        LONG                    m_top;
+        LONG                    m_height;
+        LONG                    m_cursor;
+        uint64_t                m_lastUsedFrame;
+        std::vector<GlyphKey>   m_glyphs;
     };
 
-    struct TextureCacheInfo : std::enable_shared_from_this<TextureCacheInfo>
+    struct AtlasTexture
     {
-        TextureCacheInfo(LONG dimension, int textureIndex)
-            : m_textureSize(RECT{ 0, 0, dimension - 1, dimension - 1 })
-            , m_textureIndex(textureIndex)
-        {
-        }
-
-        void TryCombiningChildren(std::shared_ptr<TextureCachePartitionRow> hint);
-        std::shared_ptr<TextureCachePartition> TryInsertNewPartition(int width, int height);
-        void ResetToUnused();
-        int GetWidth() const { return (m_textureSize.right - m_textureSize.left) + 1; }
-        int GetHeight() const { return (m_textureSize.bottom - m_textureSize.top) + 1; }
+        LONG                    m_nextShelfTop;
+        std::vector<AtlasShelf> m_shelves;
+    };
 
-        RECT                                                    m_textureSize;
-        std::list<std::shared_ptr<TextureCachePartitionRow>>    m_partitionRows;
-        int                                                     m_textureIndex;
+    struct AtlasLocation
+    {
+        size_t  m_textureIndex;
+        size_t  m_shelfIndex;
+        RECT    m_rect;     // includes a 1 pixel border
     };
 
     struct GlyphCacheInfo
     {
         GlyphCacheInfo()
-            : m_metrics{}
+            : m_ready(false)
+            , m_printable(false)
+            , m_uploaded(false)
+            , m_allocationId(0)
+            , m_requestedFrame(0)
+            , m_location{}
+            , m_metrics{}
         {
         }
 
-        std::list<GlyphKey>::iterator           m_usageFrequencyIter;
-        std::shared_ptr<TextureCacheInfo>       m_textureCacheInfo;
-        std::shared_ptr<TextureCachePartition>  m_textureCachePartition;
-        FT_Glyph_Metrics                        m_metrics;
-        std::shared_ptr<Face>                   m_face;
+        bool                m_ready;        // false while waiting for a worker
+        bool                m_printable;    // has pixels in the atlas
+        bool                m_uploaded;     // the atlas upload has been recorded
+        uint64_t            m_allocationId;
+        uint64_t            m_requestedFrame;   // when a worker was last asked to render it
+        AtlasLocation       m_location;
+        FT_Glyph_Metrics    m_metrics;
+    };
+
+    struct GlyphRequest
+    {
+        GlyphKey    m_glyph;
+        uint64_t    m_cacheEpoch;
     };
 
     struct PendingUpload
     {
-        PendingUpload(FT_Library& ftLibrary, const FT_Bitmap& originalBitmap, GlyphKey glyph)
-            : m_ftLibrary(ftLibrary)
-            , m_bitmap{}
-            , m_glyph(glyph)
+        PendingUpload(const GlyphKey& glyph, uint64_t allocationId, const AtlasLocation& location, RenderedGlyph&& rendered)
+            : m_glyph(glyph)
+            , m_allocationId(allocationId)
+            , m_location(location)
+            , m_width(rendered.m_width)
+            , m_rows(rendered.m_rows)
+            , m_pixels(std::move(rendered.m_pixels))
         {
-            FT_Bitmap_Copy(m_ftLibrary, &originalBitmap, &m_bitmap);
         }
 
         ~PendingUpload()
         {
-            FT_Bitmap_Done(m_ftLibrary, &m_bitmap);
             m_uploadMemoryHandle.Reset();
         }
 
-        FT_Library&         m_ftLibrary;
-        FT_Bitmap           m_bitmap;
-        GlyphKey            m_glyph;
-        GraphicsResource    m_uploadMemoryHandle;
+        GlyphKey                m_glyph;
+        uint64_t                m_allocationId;
+        AtlasLocation           m_location;
+        unsigned int            m_width;
+        unsigned int            m_rows;
+        std::vector<uint8_t>    m_pixels;
+        GraphicsResource        m_uploadMemoryHandle;
     };
 
     struct PendingDraw
@@ -496,7 +600,7 @@ public:
         }
 
         ~PendingDraw() = default;
-       
+
         DirectX::SimpleMath::Color                  m_color;
         std::list<std::shared_ptr<ShapedString>>    m_shapedStrings;
         int                                         m_size;
@@ -504,6 +608,16 @@ public:
         float                                       m_y;
     };
 
+    // A glyph draw resolved against the atlas, ready to hand to SpriteBatch.
+    struct ResolvedSprite
+    {
+        size_t                      m_textureIndex;
+        RECT                        m_sourceRect;
+        DirectX::XMFLOAT2           m_position;
+        DirectX::XMFLOAT2           m_origin;
+        DirectX::SimpleMath::Color  m_color;
+    };
+
 public:
 
     Impl(size_t maxTextures, LONG textureDimension, size_t maxCachedShapedStrings, _In_ ID3D12Device* d3dDevice);
@@ -514,7 +628,7 @@ public:
 
     size_t GetTextureCount();
     void CreateTextures(_In_ ID3D12CommandQueue* commandQueue, _In_ DescriptorHeap* descriptorHeap, size_t descriptorHeapOffset);
-    void CreateDeviceDependentResources(_In_ ID3D12CommandQueue* commandQueue, DXGI_FORMAT backBufferFormat, DXGI_FORMAT depthBufferFormat);    
+    void CreateDeviceDependentResources(_In_ ID3D12CommandQueue* commandQueue, DXGI_FORMAT backBufferFormat, DXGI_FORMAT depthBufferFormat);
     void CreateWindowSizeDependentResources(D3D12_VIEWPORT viewport);
 
     void Render(_In_ ID3D12GraphicsCommandList* commandList);
@@ -522,7 +636,7 @@ public:
 
     void RenderPendingUploads(_In_ ID3D12GraphicsCommandList* commandList);
     void RenderPendingDraws(_In_ ID3D12GraphicsCommandList* commandList);
-    void DrawTextureBatch(_In_ SpriteBatch* spriteBatch);
+    void DrawTextureBatch(_In_ SpriteBatch* spriteBatch, const std::vector<std::shared_ptr<PendingDraw>>& draws);
     void ClearCacheTextures(_In_ ID3D12GraphicsCommandList* commandList);
 
     void XM_CALLCONV DrawString(_In_ ID3D12GraphicsCommandList* commandList,
@@ -545,77 +659,99 @@ public:
 
     std::shared_ptr<Face> GetPreferredFace(char32_t unicodeCodepoint, UnicodeRange currentStringRange);
 
-    bool IsGlyphCached(const GlyphKey& glyph) const;
-    void UpdateGlyphUsageFrequency(const GlyphKey& glyph);
-
     void ClearCache();
 
     void XM_CALLCONV DrawText(const char* str, int size, float x, float y, DirectX::FXMVECTOR color = Colors::White);
 
     void MeasureText(const char* str, int size, int* outDrawWidth, int* outDrawHeight);
-   
+
 protected:
 
-    void RenderGlyphToCache(const GlyphKey& glyph, bool useMissingGlyphSymbol = false);
-    void ClearGlyphFromCache(const GlyphKey& glyph);
+    static constexpr size_t c_shapedStringShardCount = 16;
+    static constexpr size_t c_requestQueueSize = 4096;
+    static constexpr uint64_t c_requestRetryFrames = 60;
+
+    // Glyph table and atlas; called with m_glyphLock held
+    GlyphCacheInfo* FindOrRequestGlyph(const GlyphKey& glyph, std::vector<GlyphRequest>& newRequests);
+    bool AllocateAtlasSpace(int width, int height, AtlasLocation& location);
+    void EvictShelf(size_t textureIndex, size_t shelfIndex);
+
+    void SubmitGlyphRequests(std::vector<GlyphRequest>& requests);
+    void WorkerThread();
+    void PublishGlyph(const GlyphRequest& request, bool rendered, RenderedGlyph& glyph);
 
     void BeginTextureBatch(_In_ ID3D12GraphicsCommandList* commandList);
     void EndTextureBatch();
 
-    std::shared_ptr<TextureCachePartition> TryInsertNewPartition(int width, int height, int* outTextureIndex);
-    bool EjectOldGlyph();
-
 protected:
 
     // Basic
     FT_Library                                                  m_ftLibrary;
     CRITICAL_SECTION                                            m_ftCritSection;
-    CRITICAL_SECTION                                            m_threadSafetyLock;
+    CRITICAL_SECTION                                            m_threadSafetyLock;     // serializes rendering and setup
     ID3D12Device*                                               m_d3dDevice;
 
     // Fonts/Faces
+    std::shared_mutex                                           m_facesLock;
     std::list<std::shared_ptr<Face>>                            m_allFaces;
     std::map<UnicodeRange, std::list<std::shared_ptr<Face>>>    m_preferredFaces;
     std::map<UnicodeRange, std::list<std::shared_ptr<Face>>>    m_fallbackFaces;
 
-    // Glyphs
-    std::map<GlyphKey, GlyphCacheInfo>                          m_glyphCacheInfo;
-    std::map<GlyphKey, GlyphCacheInfo>                          m_glyphCacheInfo_NonPrintable;
-    std::list<GlyphKey>                                         m_glyphUsageFrequency;
+    // Glyphs and atlas, guarded by m_glyphLock
+    std::mutex                                                  m_glyphLock;
+    std::unordered_map<GlyphKey, GlyphCacheInfo, GlyphKeyHash>  m_glyphCacheInfo;
+    std::vector<AtlasTexture>                                   m_atlasTextures;
+    LONG                                                        m_textureDimension;
+    uint64_t                                                    m_cacheEpoch;
+    uint64_t                                                    m_nextAllocationId;
+    uint64_t                                                    m_atlasFullReportedFrame;
+    std::vector<std::shared_ptr<PendingUpload>>                 m_pendingUploads;
+    std::atomic<uint64_t>                                       m_frame;
 
     // Shaped Strings
-    std::map<ShapedStringKey, ShapedStringCacheInfo>            m_shapedStringCache;
-    std::list<ShapedStringKey>                                  m_shapedStringUsageFrequency;
-    size_t                                                      m_maxCachedShapedStrings;
+    std::array<ShapedStringShard, c_shapedStringShardCount>     m_shapedStringShards;
+    size_t                                                      m_maxCachedShapedStringsPerShard;
+
+    // Rasterization workers
+    RequestQueue<GlyphRequest>                                  m_requests;
+    HANDLE                                                      m_requestsAvailable;
+    std::atomic<bool>                                           m_shutdown;
+    std::vector<std::thread>                                    m_workers;
 
     // Textures
-    std::vector<std::shared_ptr<TextureCacheInfo>>              m_textureCacheInfos;
     std::unique_ptr<DirectX::DescriptorHeap>                    m_textureDescriptorHeap;
     std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>>         m_textureResources;
     std::unique_ptr<DirectX::SpriteBatch>                       m_textureBatch;
-    bool                                                        m_clearCacheTextures;    
+    bool                                                        m_clearCacheTextures;
 
     std::vector<D3D12_GPU_DESCRIPTOR_HANDLE>                    m_GpuDescriptorHandles;
 
     // Pending Actions
-    std::vector<std::shared_ptr<PendingUpload>>                 m_pendingUploads;
+    std::mutex                                                  m_drawLock;
     std::vector<std::shared_ptr<PendingDraw>>                   m_pendingDraws;
     std::vector<std::shared_ptr<PendingUpload>>                 m_delayedFreeUploads;
     std::vector<std::shared_ptr<PendingUpload>>                 m_currentUploads;
+    std::vector<ResolvedSprite>                                 m_resolvedSprites;
 };
 
-void GlyphCache::Impl::Face::SetCharSize(int size)
+hb_font_t* GlyphCache::Impl::Face::GetHBFont(int size)
 {
-    if (m_lastSize != size && size > 0)
+    std::lock_guard<std::mutex> lock(m_hbFontLock);
+
+    auto iter = m_hbFonts.find(size);
+    if (iter != m_hbFonts.end())
     {
-        FT_Error error = FT_Set_Char_Size(m_ftFace, 0, size * 64, 0, 0);
-        if (error == FT_Err_Ok)
-        {
-            m_lastSize = size;
-        }
+        return iter->second;
+    }
 
-        hb_font_set_scale(m_hbFont, size * 64, size * 64);
+    hb_font_t* hbFont = hb_font_create(m_hbFace);
+    if (size > 0)
+    {
+        hb_font_set_scale(hbFont, size * 64, size * 64);
     }
+    m_hbFonts[size] = hbFont;
+
+    return hbFont;
 }
 
 std::shared_ptr<GlyphCache::Impl::ShapedString> GlyphCache::Impl::Face::GetShapedString(const std::u32string& str, int size)
@@ -625,258 +761,81 @@ std::shared_ptr<GlyphCache::Impl::ShapedString> GlyphCache::Impl::Face::GetShape
         return {};
     }
 
-    SetCharSize(size);
     UnicodeRange assumedRange = GetRangeForUTF32Character(str[0]);
-    return std::make_shared<ShapedString>(shared_from_this(), m_hbFont, str,
+    return std::make_shared<ShapedString>(shared_from_this(), GetHBFont(size), str,
         GetHBScriptForUnicodeRange(assumedRange),
         GetLanguageCodeForUnicodeRange(assumedRange));
 }
 
-void GlyphCache::Impl::TextureCachePartition::ResetToUnused()
+bool GlyphCache::Impl::Face::RenderGlyph(FT_UInt glyphIndex, int size, RenderedGlyph& output)
 {
-    ClearInUse();
-}
-
-void GlyphCache::Impl::TextureCachePartition::MarkInUse(int width, int height)
-{
-    assert(!m_inUse);
-
-    m_inUse = true;
-    m_glyphRect = m_rect;
-    m_glyphRect.right = m_glyphRect.left + (width - 1);
-    m_glyphRect.bottom = m_glyphRect.top + (height - 1);
-}
-
-void GlyphCache::Impl::TextureCachePartition::ClearInUse()
-{
-    m_inUse = false;
-    m_glyphRect = { 0, 0, 0, 0 };
-}
+    std::lock_guard<std::mutex> lock(m_ftLock);
 
-bool GlyphCache::Impl::TextureCachePartition::CouldInsertGlyph(int width, int height) const
-{
-    return m_inUse == false &&
-        width <= GetWidth() &&
-        height <= GetHeight();
-}
-
-void GlyphCache::Impl::TextureCachePartition::SetNewRect(RECT newRect)
-{
-    assert(!m_inUse);
-
-    m_rect = newRect;
-}
-
-void GlyphCache::Impl::TextureCachePartition::TryCombiningWithNeighbors()
-{
-    auto parentPtr = m_parent.lock();
-    if (parentPtr)
-    {
-        parentPtr->TryCombiningChildren(shared_from_this());
-    }
-}
-
-void GlyphCache::Impl::TextureCachePartitionRow::ResetToUnused()
-{
-    m_children.clear();
-    m_children.push_back(std::make_shared<GlyphCache::Impl::TextureCachePartition>(m_rect, shared_from_this()));
-    m_children.back()->ResetToUnused();
-}
-
-void GlyphCache::Impl::TextureCachePartitionRow::TryCombiningChildren(std::shared_ptr<TextureCachePartition> /*hint*/)
-{
-    auto iter = m_children.begin();
-    while (iter != m_children.end())
+    if (m_lastSize != size && size > 0)
     {
-        auto lastElementIter = iter;
-        ++iter;
-        if (iter == m_children.end())
-        {
-            break;
-        }
-
-        if (lastElementIter->get()->IsInUse() && iter->get()->IsInUse())
+        FT_Error error = FT_Set_Char_Size(m_ftFace, 0, size * 64, 0, 0);
+        if (error == FT_Err_Ok)
         {
-            // Combine into later iter
-            RECT combinedRect = lastElementIter->get()->GetRect();
-            combinedRect.right = iter->get()->GetRect().right;
-            iter->get()->SetNewRect(combinedRect);
-
-            // Remove old iter
-            m_children.erase(lastElementIter);
+            m_lastSize = size;
         }
     }
 
-    // Tell parent to try combining its children too
-    if (m_children.size() == 1 && !m_children.front()->IsInUse())
-    {
-        SetMaxChildHeight(0);
-        m_parent.lock()->TryCombiningChildren(shared_from_this());
-    }
-}
+    // Load glyph
+    // Don't load bitmap from the font directly so we can always get anti-aliased 8bpp images from the following render.
+    FT_Error error = FT_Load_Glyph(m_ftFace, glyphIndex, FT_LOAD_NO_BITMAP);
+    const char* failedCall = "FT_Load_Glyph";
 
-std::shared_ptr<GlyphCache::Impl::TextureCachePartition> GlyphCache::Impl::TextureCachePartitionRow::TryAddingChildGlyph(int width, int height)
-{
-    // Tried to add a new child glyph to the row. If it succeeds, then a pointer to the new glyph is added and children are split/updated
-    // as needed. Updates internal data as well.
-    auto partitionIter = m_children.begin();
-    while (partitionIter != m_children.end())
+    if (error == FT_Err_Ok)
     {
-        auto oldPartition = *partitionIter;
-
-        if (oldPartition->CouldInsertGlyph(width, height))
-        {
-            bool needsSplit = oldPartition->GetWidth() > width;
-            if (needsSplit)
-            {
-                RECT oldRect = oldPartition->GetRect();
-
-                // Create new partition to go before the old partition
-                RECT newRect = oldRect;
-                newRect.right = newRect.left + (width - 1);
-                auto newPartition = std::make_shared<GlyphCache::Impl::TextureCachePartition>(newRect, shared_from_this());
-                newPartition->ResetToUnused();
-                m_children.insert(partitionIter, newPartition);
-
-                // Update the old partition
-                RECT updatedOldRect = oldRect;
-                updatedOldRect.left = newRect.right + 1;
-                oldPartition->SetNewRect(updatedOldRect);
-
-                // Use the new rect and return it
-                newPartition->MarkInUse(width, height);
-                return newPartition;
-            }
-            else
-            {
-                oldPartition->MarkInUse(width, height);
-                return oldPartition;
-            }
-        }
-
-        ++partitionIter;
+        // CPU render glyph to bitmap buffer
+        error = FT_Render_Glyph(m_ftFace->glyph, FT_RENDER_MODE_NORMAL);
+        failedCall = "FT_Render_Glyph";
     }
 
-    return {};
-}
-
-bool GlyphCache::Impl::TextureCachePartitionRow::CouldFitGlyph(int width, int height) const
-{
-    return width <= ((m_rect.right - m_rect.left) + 1) &&
-        height <= ((m_rect.bottom - m_rect.top) + 1);
-}
-
-void GlyphCache::Impl::TextureCachePartitionRow::SetNewRect(RECT newRect)
-{
-    assert(m_children.size() == 1 && !m_children.front()->m_inUse);
-
-    m_rect = newRect;
-    m_children.front()->SetNewRect(newRect);
-}
-
-void GlyphCache::Impl::TextureCacheInfo::TryCombiningChildren(std::shared_ptr<TextureCachePartitionRow> /*hint*/)
-{
-    auto iter = m_partitionRows.begin();
-    while (iter != m_partitionRows.end())
+    if (error != FT_Err_Ok)
     {
-        auto lastElementIter = iter;
-        ++iter;
-        if (iter == m_partitionRows.end())
-        {
-            break;
-        }
-
-        if (lastElementIter->get()->GetMaxChildHeight() == 0 && iter->get()->GetMaxChildHeight() == 0)
-        {
-            // Combine into later iter
-            RECT combinedRect = lastElementIter->get()->GetRect();
-            combinedRect.bottom = iter->get()->GetRect().bottom;
-            iter->get()->SetNewRect(combinedRect);
+        char buf[256] = { 0 };
+        sprintf_s(buf, 256, "%s failed. GlyphIndex:%d FamilyName:%s Size:%d Error:%d\n",
+            failedCall,
+            glyphIndex,
+            m_ftFace->family_name ? m_ftFace->family_name : "",
+            size,
+            error);
+        OutputDebugStringA(buf);
 
-            // Remove old iter
-            m_partitionRows.erase(lastElementIter);
-        }
+        return false;
     }
-}
 
-std::shared_ptr<GlyphCache::Impl::TextureCachePartition> GlyphCache::Impl::TextureCacheInfo::TryInsertNewPartition(int width, int height)
-{
-    assert(width > 0 && height > 0);
-
-    auto rowIterator = m_partitionRows.begin();
-    while (rowIterator != m_partitionRows.end())
-    {
-        // Check if it's possible for the row to fit the glyph
-        if (rowIterator->get()->CouldFitGlyph(width, height))
-        {
-            auto oldRow = *rowIterator;
+    const FT_Bitmap& bitmap = m_ftFace->glyph->bitmap;
 
-            LONG potentialNewRowHeight = AlignUp(height, 4);
+    output.m_metrics = m_ftFace->glyph->metrics;
+    output.m_width = bitmap.width;
+    output.m_rows = bitmap.rows;
+    output.m_pixels.resize(size_t(bitmap.width) * size_t(bitmap.rows));
 
-            bool unassignedMaxHeight = rowIterator->get()->GetMaxChildHeight() == 0;
-            bool rowTallerThanGlyph = rowIterator->get()->GetHeight() > height;
-            bool needsSplit = unassignedMaxHeight &&
-                rowTallerThanGlyph &&
-                potentialNewRowHeight < rowIterator->get()->GetHeight();
-
-            if (needsSplit)
-            {
-                RECT originalRowRect = rowIterator->get()->GetRect();
-
-                // Split row into multiple
-                // New row it the top
-                // Old row moves to the bottom
-                RECT newRowRect = originalRowRect;
-                newRowRect.bottom = newRowRect.top + (potentialNewRowHeight - 1);
-                std::shared_ptr<GlyphCache::Impl::TextureCachePartitionRow> newRow =
-                    std::make_shared<GlyphCache::Impl::TextureCachePartitionRow>(newRowRect, shared_from_this());
-                newRow->ResetToUnused();
-                m_partitionRows.insert(rowIterator, newRow);
-
-                // Fixup old row's max height in the rect
-                RECT oldRowFixedRect = originalRowRect;
-                oldRowFixedRect.top = newRowRect.bottom + 1;
-                oldRow->SetNewRect(oldRowFixedRect);
-
-                // Place glyph within new row
-                // This should not fail
-                newRow->SetMaxChildHeight(height);
-                return newRow->TryAddingChildGlyph(width, height);
-            }
-            else
-            {
-                if (unassignedMaxHeight)
-                {
-                    oldRow->SetMaxChildHeight(height);
-                }
-
-                // Check if there is an open spot in the row
-                auto newChild = oldRow->TryAddingChildGlyph(width, height);
-                if (newChild)
-                {
-                    return newChild;
-                }
-                }
-            }
-
-        ++rowIterator;
-        }
-
-    return {};
+    for (unsigned int row = 0; row < bitmap.rows; ++row)
+    {
+        memcpy(output.m_pixels.data() + size_t(row) * size_t(bitmap.width),
+            bitmap.buffer + ptrdiff_t(row) * ptrdiff_t(bitmap.pitch),
+            bitmap.width);
     }
 
-void GlyphCache::Impl::TextureCacheInfo::ResetToUnused()
-{
-    m_partitionRows.clear();
-    m_partitionRows.push_back(std::make_shared<TextureCachePartitionRow>(m_textureSize, shared_from_this()));
-    m_partitionRows.back()->ResetToUnused();
+    return true;
 }
 
 _Use_decl_annotations_
 GlyphCache::Impl::Impl(size_t maxTextures, LONG textureDimension, size_t maxCachedShapedStrings, ID3D12Device* d3dDevice)
     : m_ftLibrary(nullptr)
     , m_d3dDevice(d3dDevice)
-    , m_maxCachedShapedStrings(maxCachedShapedStrings)
+    , m_textureDimension(textureDimension)
+    , m_cacheEpoch(0)
+    , m_nextAllocationId(0)
+    , m_atlasFullReportedFrame(UINT64_MAX)
+    , m_frame(0)
+    , m_maxCachedShapedStringsPerShard(std::max<size_t>(1, (maxCachedShapedStrings + c_shapedStringShardCount - 1) / c_shapedStringShardCount))
+    , m_requests(c_requestQueueSize)
+    , m_requestsAvailable(nullptr)
+    , m_shutdown(false)
 #ifdef _DEBUG
     , m_clearCacheTextures(true)
 #else
@@ -899,25 +858,53 @@ GlyphCache::Impl::Impl(size_t maxTextures, LONG textureDimension, size_t maxCach
     InitializeCriticalSection(&m_ftCritSection);
     InitializeCriticalSection(&m_threadSafetyLock);
 
-    m_textureCacheInfos.reserve(maxTextures);
-    for (size_t textureIndex = 0; textureIndex < maxTextures; ++textureIndex)
+    m_atlasTextures.resize(maxTextures);
+    for (auto& atlasTexture : m_atlasTextures)
+    {
+        atlasTexture.m_nextShelfTop = 0;
+    }
+
+    m_requestsAvailable = CreateSemaphoreEx(nullptr, 0, LONG_MAX, nullptr, 0, SEMAPHORE_MODIFY_STATE | SYNCHRONIZE);
+    if (!m_requestsAvailable)
+    {
+        throw std::exception("Failed to create the GlyphCache request semaphore");
+    }
+
+    // Rasterization is bursty (a new screen of text), so a few workers are enough
+    const unsigned int workerCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+    for (unsigned int index = 0; index < workerCount; ++index)
     {
-        m_textureCacheInfos.push_back(std::make_shared<TextureCacheInfo>(textureDimension, static_cast<int>(textureIndex)));
-        m_textureCacheInfos[textureIndex]->ResetToUnused();
+        m_workers.emplace_back(&GlyphCache::Impl::WorkerThread, this);
     }
 }
 
 GlyphCache::Impl::~Impl()
 {
+    m_shutdown = true;
+    ReleaseSemaphore(m_requestsAvailable, static_cast<LONG>(m_workers.size()), nullptr);
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+    CloseHandle(m_requestsAvailable);
+
     ClearCache();
 
     m_delayedFreeUploads.clear();
     m_currentUploads.clear();
 
+    // Drop any requests that were never picked up, along with their references to faces
+    {
+        GlyphRequest request;
+        while (m_requests.TryPop(request))
+        {
+        }
+    }
+
     m_allFaces.clear();
     m_preferredFaces.clear();
     m_fallbackFaces.clear();
-    
+
     if (m_ftLibrary)
     {
         FT_Done_FreeType(m_ftLibrary);
@@ -990,7 +977,7 @@ HRESULT CreateTextureResource(
 
 size_t GlyphCache::Impl::GetTextureCount()
 {
-    return m_textureCacheInfos.size();
+    return m_atlasTextures.size();
 }
 
 _Use_decl_annotations_
@@ -1001,14 +988,13 @@ void GlyphCache::Impl::CreateTextures(ID3D12CommandQueue* commandQueue, Descript
     upload.Begin();
    
     // Create textures for texture cache
-    RECT dimensionRect = m_textureCacheInfos[0]->m_textureSize;
-    m_textureResources.resize(m_textureCacheInfos.size());
-    for (size_t index = 0; index < m_textureCacheInfos.size(); ++index)
+    m_textureResources.resize(m_atlasTextures.size());
+    for (size_t index = 0; index < m_atlasTextures.size(); ++index)
     {
         HRESULT result = CreateTextureResource(m_d3dDevice,
             D3D12_RESOURCE_DIMENSION_TEXTURE2D,
-            size_t(dimensionRect.right) - size_t(dimensionRect.left) + 1,
-            size_t(dimensionRect.bottom) - size_t(dimensionRect.top) + 1,
+            size_t(m_textureDimension),
+            size_t(m_textureDimension),
             1, 1, 1, DXGI_FORMAT_R8_UNORM, D3D12_RESOURCE_FLAG_NONE,
             D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
             m_textureResources[index].ReleaseAndGetAddressOf());
@@ -1018,10 +1004,11 @@ void GlyphCache::Impl::CreateTextures(ID3D12CommandQueue* commandQueue, Descript
         }
     }
 
-    upload.End(commandQueue);
+    auto uploadResourcesFinished = upload.End(commandQueue);
+    uploadResourcesFinished.wait();
 
     // SRVs
-    for (size_t index = 0; index < m_textureCacheInfos.size(); ++index)
+    for (size_t index = 0; index < m_atlasTextures.size(); ++index)
     {
         const auto desc = m_textureResources[index].Get()->GetDesc();
         D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
@@ -1041,7 +1028,7 @@ void GlyphCache::Impl::CreateDeviceDependentResources(ID3D12CommandQueue* comman
     // Init texture descriptor heap
     m_textureDescriptorHeap = std::make_unique<DescriptorHeap>(m_d3dDevice,
         D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
-        D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, m_textureCacheInfos.size());
+        D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, m_atlasTextures.size());
 
     RenderTargetState rtState(backBufferFormat, depthBufferFormat);
     SpriteBatchPipelineStateDescription spritePsoDesc(rtState, &CommonStates::AlphaBlend);
@@ -1052,7 +1039,8 @@ void GlyphCache::Impl::CreateDeviceDependentResources(ID3D12CommandQueue* comman
     // Init texture batch
     m_textureBatch = std::make_unique<SpriteBatch>(m_d3dDevice, upload, spritePsoDesc);
 
-    upload.End(commandQueue);
+    auto uploadResourcesFinished = upload.End(commandQueue);
+    uploadResourcesFinished.wait();
 
     CreateTextures(commandQueue, m_textureDescriptorHeap.get(), 0);    
 }
@@ -1062,6 +1050,7 @@ void GlyphCache::Impl::CreateWindowSizeDependentResources(D3D12_VIEWPORT viewpor
     m_textureBatch->SetViewport(viewport);
 }
 
+
 _Use_decl_annotations_
 void GlyphCache::Impl::Render(ID3D12GraphicsCommandList* commandList)
 {
@@ -1083,43 +1072,75 @@ void GlyphCache::Impl::RenderFrameAdvance()
 {
     m_delayedFreeUploads.clear();
     std::swap(m_delayedFreeUploads, m_currentUploads);
+
+    m_frame.fetch_add(1, std::memory_order_relaxed);
 }
 
 _Use_decl_annotations_
 void GlyphCache::Impl::RenderPendingUploads(ID3D12GraphicsCommandList* commandList)
 {
-    if (m_pendingUploads.size() == 0)
+    std::vector<std::shared_ptr<PendingUpload>> uploads;
     {
-        return;
-    }
+        std::lock_guard<std::mutex> lock(m_glyphLock);
 
-    for (std::shared_ptr<PendingUpload> pendingUpload : m_pendingUploads)
-    {
-        // Non-printable characters don't queue an upload, so don't bother checking that map
-        auto glyphCacheInfoIter = m_glyphCacheInfo.find(pendingUpload->m_glyph);
-        if (glyphCacheInfoIter == m_glyphCacheInfo.end())
+        if (m_pendingUploads.size() == 0)
         {
-            throw std::exception("Failed to find glyph cache info for a pending upload. "
-                "The cache likely churned through more glyphs than it can cache in a frame. "
-                "Increase the glyph cache size to resolve.");
+            return;
         }
-        auto& glyphCacheInfo = glyphCacheInfoIter->second;
-        auto texturePartition = glyphCacheInfo.m_textureCachePartition;
 
-        // NOTE: D3D12_TEXTURE_DATA_PITCH_ALIGNMENT isn't in the Xbox headers?
+        // Skip glyphs that were evicted again before they were ever drawn. The rest are marked as uploaded now,
+        // since their copies are recorded below, ahead of any draw that is resolved after this point.
+        uploads.reserve(m_pendingUploads.size());
+        for (auto& pendingUpload : m_pendingUploads)
+        {
+            auto glyphCacheInfoIter = m_glyphCacheInfo.find(pendingUpload->m_glyph);
+            if (glyphCacheInfoIter != m_glyphCacheInfo.end() && glyphCacheInfoIter->second.m_allocationId == pendingUpload->m_allocationId)
+            {
+                glyphCacheInfoIter->second.m_uploaded = true;
+                uploads.push_back(pendingUpload);
+            }
+        }
+        m_pendingUploads.clear();
+    }
+
+    // NOTE: D3D12_TEXTURE_DATA_PITCH_ALIGNMENT isn't in the Xbox headers?
 #ifdef _GAMING_XBOX_SCARLETT
-        size_t d3d12TextureDataPitchAlignment = D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT;
+    size_t d3d12TextureDataPitchAlignment = D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT;
 #elif (defined(_XBOX_ONE) && defined(_TITLE)) || defined(_GAMING_XBOX)
-        size_t d3d12TextureDataPitchAlignment = D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT;
+    size_t d3d12TextureDataPitchAlignment = D3D12XBOX_TEXTURE_DATA_PITCH_ALIGNMENT;
 #else
-        size_t d3d12TextureDataPitchAlignment = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
+    size_t d3d12TextureDataPitchAlignment = D3D12_TEXTURE_DATA_PITCH_ALIGNMENT;
 #endif
 
+    // Transition every target texture to writable once, rather than around each glyph
+    std::vector<D3D12_RESOURCE_BARRIER> barriers;
+    std::vector<bool> textureWritten(m_textureResources.size(), false);
+    for (auto& pendingUpload : uploads)
+    {
+        const size_t targetTextureIndex = pendingUpload->m_location.m_textureIndex;
+        if (!textureWritten[targetTextureIndex])
+        {
+            textureWritten[targetTextureIndex] = true;
+            barriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(m_textureResources[targetTextureIndex].Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST));
+        }
+    }
+
+    if (barriers.empty())
+    {
+        return;
+    }
+
+    commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
+
+    for (auto& pendingUpload : uploads)
+    {
+        const RECT& glyphRect = pendingUpload->m_location.m_rect;
+
         // Describe Upload Buffer
         D3D12_SUBRESOURCE_FOOTPRINT uploadDesc;
         uploadDesc.Format = DXGI_FORMAT_R8_UNORM;
-        uploadDesc.Width = (UINT)texturePartition->GetWidth();
-        uploadDesc.Height = (UINT)texturePartition->GetHeight();
+        uploadDesc.Width = UINT(glyphRect.right - glyphRect.left) + 1;
+        uploadDesc.Height = UINT(glyphRect.bottom - glyphRect.top) + 1;
         uploadDesc.Depth = 1;
         uploadDesc.RowPitch = (UINT)AlignUp(uploadDesc.Width, d3d12TextureDataPitchAlignment);
 
@@ -1133,135 +1154,130 @@ void GlyphCache::Impl::RenderPendingUploads(ID3D12GraphicsCommandList* commandLi
         placedTexture2D.Footprint = uploadDesc;
 
         // Fill buffer
-        // Since source comes as a single color, this has to manually fill out RGBA values
         // The actual glyph is 2 pixels less in each dimension.
         // Fill out the 1-pixel border when copying data
         for (UINT row = 0; row < uploadDesc.Height; ++row)
         {
             UINT8* rowWrite = reinterpret_cast<UINT8*>(pendingUpload->m_uploadMemoryHandle.Memory()) + (size_t(row) * size_t(uploadDesc.RowPitch));
-            if (row == 0 || row == uploadDesc.Height - 1)
+            memset(rowWrite, 0, uploadDesc.Width);
+
+            if (row != 0 && (row - 1) < pendingUpload->m_rows)
             {
-                memset(rowWrite, 0, uploadDesc.Width);
-            }
-            else
-            {
-                for (unsigned int col = 0; col < pendingUpload->m_bitmap.width + 2; ++col)
-                {
-                    if (col == 0 || col == (pendingUpload->m_bitmap.width + 1))
-                    {
-                        *(rowWrite + col) = 0;
-                    }
-                    else if((row - 1) < pendingUpload->m_bitmap.rows)
-                    {
-                        const unsigned char* bitmapSource = pendingUpload->m_bitmap.buffer + (size_t(row - 1) * size_t(pendingUpload->m_bitmap.pitch));
-                        *(rowWrite + col) = bitmapSource[col - 1];
-                    }
-                    else
-                    {
-                        *(rowWrite + col) = 0;
-                    }
-                }
+                memcpy(rowWrite + 1, pendingUpload->m_pixels.data() + (size_t(row - 1) * size_t(pendingUpload->m_width)), pendingUpload->m_width);
             }
         }
 
-        // Transition target to writable
-        int targetTextureIndex = glyphCacheInfo.m_textureCacheInfo->m_textureIndex;
-        CD3DX12_RESOURCE_BARRIER barrierToCopyDest = CD3DX12_RESOURCE_BARRIER::Transition(m_textureResources[(size_t)targetTextureIndex].Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
-        commandList->ResourceBarrier(1, &barrierToCopyDest);
-
         // Copy data from buffer to texture
-        auto texturePartitionInfo = glyphCacheInfo.m_textureCachePartition;
-        CD3DX12_TEXTURE_COPY_LOCATION destCopyLoc = CD3DX12_TEXTURE_COPY_LOCATION(m_textureResources[(size_t)targetTextureIndex].Get(), 0);
+        CD3DX12_TEXTURE_COPY_LOCATION destCopyLoc = CD3DX12_TEXTURE_COPY_LOCATION(m_textureResources[pendingUpload->m_location.m_textureIndex].Get(), 0);
         CD3DX12_TEXTURE_COPY_LOCATION sourceCopyLoc = CD3DX12_TEXTURE_COPY_LOCATION(pendingUpload->m_uploadMemoryHandle.Resource(), placedTexture2D);
         commandList->CopyTextureRegion(
             &destCopyLoc,
-            (UINT)texturePartitionInfo->GetRect().left, (UINT)texturePartitionInfo->GetRect().top, 0,
+            (UINT)glyphRect.left, (UINT)glyphRect.top, 0,
             &sourceCopyLoc,
             nullptr
         );
+    }
 
-        // Transition target to usable
-        CD3DX12_RESOURCE_BARRIER barrierToResource = CD3DX12_RESOURCE_BARRIER::Transition(m_textureResources[(size_t)targetTextureIndex].Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
-        commandList->ResourceBarrier(1, &barrierToResource);
+    // Transition targets to usable
+    for (auto& barrier : barriers)
+    {
+        std::swap(barrier.Transition.StateBefore, barrier.Transition.StateAfter);
     }
+    commandList->ResourceBarrier(static_cast<UINT>(barriers.size()), barriers.data());
 
     // Don't free until next frame so that rendering can perform its uploads
-    m_currentUploads.insert(m_currentUploads.end(), m_pendingUploads.begin(), m_pendingUploads.end());
-    m_pendingUploads.clear();
+    m_currentUploads.insert(m_currentUploads.end(), uploads.begin(), uploads.end());
 }
 
 _Use_decl_annotations_
 void GlyphCache::Impl::RenderPendingDraws(ID3D12GraphicsCommandList* commandList)
 {
-    if (m_pendingDraws.size() == 0)
+    std::vector<std::shared_ptr<PendingDraw>> draws;
+    {
+        std::lock_guard<std::mutex> lock(m_drawLock);
+        draws.swap(m_pendingDraws);
+    }
+
+    if (draws.size() == 0)
     {
         return;
     }
-    
-    BeginTextureBatch(commandList);    
-    DrawTextureBatch(m_textureBatch.get());
-    EndTextureBatch();    
-    m_pendingDraws.clear();
+
+    BeginTextureBatch(commandList);
+    DrawTextureBatch(m_textureBatch.get(), draws);
+    EndTextureBatch();
 }
 
 _Use_decl_annotations_
-void GlyphCache::Impl::DrawTextureBatch(SpriteBatch* spriteBatch)
+void GlyphCache::Impl::DrawTextureBatch(SpriteBatch* spriteBatch, const std::vector<std::shared_ptr<PendingDraw>>& draws)
 {
-    for (std::shared_ptr<PendingDraw> pendingDraw : m_pendingDraws)
+    // Resolve every glyph against the atlas under one short lock, then submit the sprites without it
+    m_resolvedSprites.clear();
+    std::vector<GlyphRequest> newRequests;
     {
-        float currentX = pendingDraw->m_x;
-        float currentY = pendingDraw->m_y;
-        for (auto shapedString : pendingDraw->m_shapedStrings)
+        std::lock_guard<std::mutex> lock(m_glyphLock);
+
+        for (const auto& pendingDraw : draws)
         {
-            for(unsigned int glyphIndex = 0; glyphIndex < shapedString->m_glyphCount; ++glyphIndex)
+            float currentX = pendingDraw->m_x;
+            float currentY = pendingDraw->m_y;
+            for (const auto& shapedString : pendingDraw->m_shapedStrings)
             {
-                GlyphKey glyph = { shapedString->m_face, shapedString->m_hbGlyphInfos[glyphIndex].codepoint, pendingDraw->m_size };
-
-                // Non-printable
-                auto glyphCacheInfoIter = m_glyphCacheInfo_NonPrintable.find(glyph);
-                if (glyphCacheInfoIter != m_glyphCacheInfo_NonPrintable.end())
+                for (unsigned int glyphIndex = 0; glyphIndex < shapedString->m_glyphCount; ++glyphIndex)
                 {
-                    currentX += float(shapedString->m_hbGlyphPositions[glyphIndex].x_advance) / 64.0f;
-                    continue;
-                }
+                    GlyphKey glyph = { shapedString->m_face, shapedString->m_hbGlyphInfos[glyphIndex].codepoint, pendingDraw->m_size };
+                    const hb_glyph_position_t& glyphPosition = shapedString->m_hbGlyphPositions[glyphIndex];
 
-                // Printable
-                glyphCacheInfoIter = m_glyphCacheInfo.find(glyph);
-                if (glyphCacheInfoIter == m_glyphCacheInfo.end())
-                {
-                    throw std::exception("Failed to find cached glyph for a string draw. "
-                        "This likely means that there were too many draws this frame to fit all glyphs in the cache. "
-                        "Increase the glyph cache size or reduce the number of draws to resolve.");
+                    // Glyphs that were evicted since the draw was queued are requested again
+                    const GlyphCacheInfo* glyphCacheInfo = FindOrRequestGlyph(glyph, newRequests);
+
+                    // Non-printable
+                    if (glyphCacheInfo && glyphCacheInfo->m_ready && !glyphCacheInfo->m_printable)
+                    {
+                        currentX += float(glyphPosition.x_advance) / 64.0f;
+                        continue;
+                    }
+
+                    // Printable. Glyphs still being rasterized are left out until they are ready.
+                    if (glyphCacheInfo && glyphCacheInfo->m_ready && glyphCacheInfo->m_uploaded)
+                    {
+                        ResolvedSprite sprite;
+                        sprite.m_textureIndex = glyphCacheInfo->m_location.m_textureIndex;
+                        sprite.m_sourceRect = glyphCacheInfo->m_location.m_rect;
+                        sprite.m_sourceRect.left += 1;
+                        sprite.m_sourceRect.top += 1;
+                        sprite.m_position = XMFLOAT2(currentX, currentY);
+                        sprite.m_origin = XMFLOAT2(-float(glyphCacheInfo->m_metrics.horiBearingX / 64), float((glyphCacheInfo->m_metrics.horiBearingY / 64) - pendingDraw->m_size));
+                        sprite.m_origin.x += float(glyphPosition.x_offset) / 64.0f;
+                        sprite.m_origin.y += float(glyphPosition.y_offset) / 64.0f;
+                        sprite.m_color = pendingDraw->m_color;
+                        m_resolvedSprites.push_back(sprite);
+                    }
+
+                    currentX += float(glyphPosition.x_advance / 64);
                 }
-                auto& glyphCacheInfo = glyphCacheInfoIter->second;
-                auto textureCacheInfo = glyphCacheInfo.m_textureCacheInfo;
-                auto texturePartitionInfo = glyphCacheInfo.m_textureCachePartition;
-
-                XMFLOAT2 position(currentX, currentY);
-                XMFLOAT2 offset(-float(glyphCacheInfo.m_metrics.horiBearingX / 64), float((glyphCacheInfo.m_metrics.horiBearingY / 64) - pendingDraw->m_size));
-                offset.x += float(shapedString->m_hbGlyphPositions[glyphIndex].x_offset) / 64.0f;
-                offset.y += float(shapedString->m_hbGlyphPositions[glyphIndex].y_offset) / 64.0f;
-
-                RECT drawGlyphRect = texturePartitionInfo->m_glyphRect;
-                drawGlyphRect.left += 1;
-                drawGlyphRect.top += 1;
-                spriteBatch->Draw(
-                    /*SRV*/m_GpuDescriptorHandles[(size_t)textureCacheInfo->m_textureIndex],
-                    /*TextureSize*/XMUINT2((uint32_t)textureCacheInfo->GetWidth(), (uint32_t)textureCacheInfo->GetHeight()),
-                    /*Position*/XMLoadFloat2(&position),
-                    /*SourceRect*/&drawGlyphRect,
-                    /*Color*/pendingDraw->m_color,
-                    /*Rotation*/0.0f,
-                    /*Origin*/XMLoadFloat2(&offset),
-                    /*Scale*/1.0f,
-                    /*Effects*/SpriteEffects_None,
-                    /*LayerDepth*/0
-                );
-
-                currentX += float(shapedString->m_hbGlyphPositions[glyphIndex].x_advance / 64);
             }
         }
     }
+
+    SubmitGlyphRequests(newRequests);
+
+    const XMUINT2 textureSize((uint32_t)m_textureDimension, (uint32_t)m_textureDimension);
+    for (const auto& sprite : m_resolvedSprites)
+    {
+        spriteBatch->Draw(
+            /*SRV*/m_GpuDescriptorHandles[sprite.m_textureIndex],
+            /*TextureSize*/textureSize,
+            /*Position*/XMLoadFloat2(&sprite.m_position),
+            /*SourceRect*/&sprite.m_sourceRect,
+            /*Color*/sprite.m_color,
+            /*Rotation*/0.0f,
+            /*Origin*/XMLoadFloat2(&sprite.m_origin),
+            /*Scale*/1.0f,
+            /*Effects*/SpriteEffects_None,
+            /*LayerDepth*/0
+        );
+    }
 }
 
 _Use_decl_annotations_
@@ -1277,11 +1293,10 @@ void GlyphCache::Impl::ClearCacheTextures(ID3D12GraphicsCommandList* commandList
 #endif
 
     // Describe Upload Buffer
-    RECT dimensionRect = m_textureCacheInfos[0]->m_textureSize;
     D3D12_SUBRESOURCE_FOOTPRINT uploadDesc;
     uploadDesc.Format = DXGI_FORMAT_R8_UNORM;
-    uploadDesc.Width = UINT(dimensionRect.right - dimensionRect.left) + 1;
-    uploadDesc.Height = UINT(dimensionRect.bottom - dimensionRect.top) + 1;
+    uploadDesc.Width = UINT(m_textureDimension);
+    uploadDesc.Height = UINT(m_textureDimension);
     uploadDesc.Depth = 1;
     uploadDesc.RowPitch = (UINT)AlignUp(uploadDesc.Width, d3d12TextureDataPitchAlignment);
 
@@ -1297,7 +1312,7 @@ void GlyphCache::Impl::ClearCacheTextures(ID3D12GraphicsCommandList* commandList
     // Fill buffer
     memset(uploadMemoryHandle.Memory(), 0, size_t(uploadDesc.Width) * size_t(uploadDesc.RowPitch));
 
-    for (size_t index = 0; index < m_textureCacheInfos.size(); ++index)
+    for (size_t index = 0; index < m_atlasTextures.size(); ++index)
     {
         // Transition target to writable
         CD3DX12_RESOURCE_BARRIER barrierToCopyDest = CD3DX12_RESOURCE_BARRIER::Transition(m_textureResources[index].Get(), D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
@@ -1319,6 +1334,7 @@ void GlyphCache::Impl::ClearCacheTextures(ID3D12GraphicsCommandList* commandList
     }
 }
 
+
 _Use_decl_annotations_
 void XM_CALLCONV GlyphCache::Impl::DrawString(ID3D12GraphicsCommandList* commandList,
     DirectX::SpriteBatch* spriteBatch,
@@ -1331,7 +1347,15 @@ void XM_CALLCONV GlyphCache::Impl::DrawString(ID3D12GraphicsCommandList* command
     DirectX::SpriteEffects,
     float)
 {
-    DrawText(utf8String, static_cast<int>(fontSize), position.x, position.y, color);
+    std::vector<std::shared_ptr<PendingDraw>> draws;
+    if (utf8String != nullptr && strlen(utf8String) != 0)
+    {
+        const int size = static_cast<int>(fontSize);
+        auto shapedStrings = CalculateShapedStrings(utf8String, size);
+        PrecacheGlyphs(shapedStrings, size);
+
+        draws.push_back(std::make_shared<PendingDraw>(shapedStrings, size, position.x, position.y, color));
+    }
 
     if (m_clearCacheTextures)
     {
@@ -1341,12 +1365,11 @@ void XM_CALLCONV GlyphCache::Impl::DrawString(ID3D12GraphicsCommandList* command
 
     RenderPendingUploads(commandList);
 
-    if (m_pendingDraws.size() == 0)
+    if (draws.size() == 0)
     {
         return;
     }
-    DrawTextureBatch(spriteBatch);
-    m_pendingDraws.clear();
+    DrawTextureBatch(spriteBatch, draws);
 }
 
 static std::vector<UnicodeRange> s_allUnicodeRanges =
@@ -1394,6 +1417,8 @@ bool GlyphCache::Impl::LoadFont(const std::string& fontPath, const std::vector<U
         return false;
     }
     std::shared_ptr<Face> face = std::make_shared<Face>(newFace, hbBlob, faceIndex, priority, &m_ftCritSection);
+
+    std::unique_lock<std::shared_mutex> lock(m_facesLock);
     {
         auto iter = m_allFaces.begin();
         while (iter != m_allFaces.end())
@@ -1450,6 +1475,7 @@ bool GlyphCache::Impl::LoadFont(const std::string& fontPath, const std::vector<U
     return true;
 }
 
+
 std::list<std::shared_ptr<GlyphCache::Impl::ShapedString>> GlyphCache::Impl::CalculateShapedStrings(const char* str, int size)
 {
     if (str == nullptr || strlen(str) == 0)
@@ -1457,6 +1483,8 @@ std::list<std::shared_ptr<GlyphCache::Impl::ShapedString>> GlyphCache::Impl::Cal
         return {};
     }
 
+    std::shared_lock<std::shared_mutex> facesLock(m_facesLock);
+
     // Split string by ranges
     std::u32string utf32String = DX::Utf8ToUtf32(str);
     std::list<std::shared_ptr<ShapedString>> shapedStrings;
@@ -1490,44 +1518,59 @@ std::list<std::shared_ptr<GlyphCache::Impl::ShapedString>> GlyphCache::Impl::Cal
 std::shared_ptr<GlyphCache::Impl::ShapedString> GlyphCache::Impl::GetShapedString(std::shared_ptr<Face> face, std::u32string& str, int size)
 {
     ShapedStringKey shapedStringKey = { str, size };
+    ShapedStringShard& shard = m_shapedStringShards[ShapedStringKeyHash()(shapedStringKey) % c_shapedStringShardCount];
 
     // Look in cache first
-    auto iter = m_shapedStringCache.find(shapedStringKey);
-    if (iter != m_shapedStringCache.end())
     {
-        // Bring usage to front
-        m_shapedStringUsageFrequency.erase(iter->second.m_usageFrequencyIter);
-        m_shapedStringUsageFrequency.push_front(shapedStringKey);
-        iter->second.m_usageFrequencyIter = m_shapedStringUsageFrequency.begin();
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+
+        auto iter = shard.m_cache.find(shapedStringKey);
+        if (iter != shard.m_cache.end())
+        {
+            // Bring usage to front
+            shard.m_usageFrequency.splice(shard.m_usageFrequency.begin(), shard.m_usageFrequency, iter->second.m_usageFrequencyIter);
+
+            return iter->second.m_shapedString;
+        }
+    }
+
+    // Create a new shaped string. Shaping is the expensive part, so it is done without holding the shard.
+    auto shapedString = face->GetShapedString(str, size);
+
+    std::lock_guard<std::mutex> lock(shard.m_lock);
 
+    // Another thread may have shaped the same string in the meantime
+    auto iter = shard.m_cache.find(shapedStringKey);
+    if (iter != shard.m_cache.end())
+    {
         return iter->second.m_shapedString;
     }
 
     // Remove old cache value if needed
-    if (m_shapedStringUsageFrequency.size() == m_maxCachedShapedStrings)
+    if (shard.m_usageFrequency.size() >= m_maxCachedShapedStringsPerShard)
     {
-        m_shapedStringCache.erase(m_shapedStringUsageFrequency.back());
-        m_shapedStringUsageFrequency.pop_back();
+        shard.m_cache.erase(shard.m_usageFrequency.back());
+        shard.m_usageFrequency.pop_back();
     }
 
-    // Create a new shaped string
-    auto shapedString = face->GetShapedString(str, size);
-
     // Cache it
-    m_shapedStringUsageFrequency.push_front(shapedStringKey);
+    shard.m_usageFrequency.push_front(shapedStringKey);
     ShapedStringCacheInfo cacheInfo;
     cacheInfo.m_shapedString = shapedString;
-    cacheInfo.m_usageFrequencyIter = m_shapedStringUsageFrequency.begin();
-    m_shapedStringCache[shapedStringKey] = cacheInfo;
+    cacheInfo.m_usageFrequencyIter = shard.m_usageFrequency.begin();
+    shard.m_cache.emplace(std::move(shapedStringKey), std::move(cacheInfo));
 
     return shapedString;
 }
 
 void GlyphCache::Impl::PrecacheGlyphs(const char* str, int size)
 {
-    if (m_allFaces.size() == 0)
     {
-        throw std::exception("Cannot precache glyphs for a string if no fonts have been loaded.");
+        std::shared_lock<std::shared_mutex> facesLock(m_facesLock);
+        if (m_allFaces.size() == 0)
+        {
+            throw std::exception("Cannot precache glyphs for a string if no fonts have been loaded.");
+        }
     }
 
     auto shapedStrings = CalculateShapedStrings(str, size);
@@ -1536,85 +1579,105 @@ void GlyphCache::Impl::PrecacheGlyphs(const char* str, int size)
 
 void GlyphCache::Impl::PrecacheGlyphs(const std::list<std::shared_ptr<ShapedString>>& shapedStrings, int size)
 {
-    for (std::shared_ptr<ShapedString> shapedString : shapedStrings)
+    std::vector<GlyphRequest> newRequests;
     {
-        for (unsigned int glyphIndex = 0; glyphIndex < shapedString->m_glyphCount; ++glyphIndex)
+        std::lock_guard<std::mutex> lock(m_glyphLock);
+
+        for (const auto& shapedString : shapedStrings)
         {
-            GlyphKey glyph = { shapedString->m_face, shapedString->m_hbGlyphInfos[glyphIndex].codepoint, size };
-            if (!IsGlyphCached(glyph))
+            for (unsigned int glyphIndex = 0; glyphIndex < shapedString->m_glyphCount; ++glyphIndex)
             {
-                RenderGlyphToCache(glyph);
+                GlyphKey glyph = { shapedString->m_face, shapedString->m_hbGlyphInfos[glyphIndex].codepoint, size };
+                FindOrRequestGlyph(glyph, newRequests);
             }
         }
     }
+
+    SubmitGlyphRequests(newRequests);
 }
 
 
 std::shared_ptr<GlyphCache::Impl::Face> GlyphCache::Impl::GetPreferredFace(char32_t unicodeCodepoint, UnicodeRange currentStringRange)
 {
+    // Called with m_facesLock held for reading, so the face maps must not be modified here
     UnicodeRange preferredRange = GetRangeForUTF32Character(unicodeCodepoint);
     if (preferredRange == UnicodeRange::LatinSymbols || preferredRange == UnicodeRange::LatinSupplementalExtended || unicodeCodepoint == U' ')
     {
         preferredRange = currentStringRange;
     }
-    std::list<std::shared_ptr<Face>>& preferredFaces = preferredRange == UnicodeRange::Other ? m_allFaces : m_preferredFaces[preferredRange];
-    std::list<std::shared_ptr<Face>>& fallbackFaces = m_fallbackFaces[preferredRange];
 
-    for (auto face : preferredFaces)
+    if (preferredRange == UnicodeRange::Other)
     {
-        if (FT_Get_Char_Index(face->m_ftFace, unicodeCodepoint) != 0)
+        for (auto& face : m_allFaces)
         {
-            return face;
+            if (face->HasCharacter(unicodeCodepoint))
+            {
+                return face;
+            }
         }
     }
-    for (auto face : fallbackFaces)
+    else
     {
-        if (FT_Get_Char_Index(face->m_ftFace, unicodeCodepoint) != 0)
+        auto preferredFaces = m_preferredFaces.find(preferredRange);
+        if (preferredFaces != m_preferredFaces.end())
         {
-            return face;
+            for (auto& face : preferredFaces->second)
+            {
+                if (face->HasCharacter(unicodeCodepoint))
+                {
+                    return face;
+                }
+            }
         }
     }
 
-    return m_allFaces.front();
-}
-
-bool GlyphCache::Impl::IsGlyphCached(const GlyphKey& glyph) const
-{
-    return
-        (m_glyphCacheInfo.find(glyph) != m_glyphCacheInfo.end()) ||
-        (m_glyphCacheInfo_NonPrintable.find(glyph) != m_glyphCacheInfo_NonPrintable.end());
-}
-
-void GlyphCache::Impl::UpdateGlyphUsageFrequency(const GlyphKey& glyph)
-{
-    // Only have to update for printable characters.
-    // Non-printable characters can be cached indefinitely
-    auto iter = m_glyphCacheInfo.find(glyph);
-    if (iter != m_glyphCacheInfo.end())
+    auto fallbackFaces = m_fallbackFaces.find(preferredRange);
+    if (fallbackFaces != m_fallbackFaces.end())
     {
-        m_glyphUsageFrequency.erase(iter->second.m_usageFrequencyIter);
-        m_glyphUsageFrequency.push_front(glyph);
-        iter->second.m_usageFrequencyIter = m_glyphUsageFrequency.begin();
+        for (auto& face : fallbackFaces->second)
+        {
+            if (face->HasCharacter(unicodeCodepoint))
+            {
+                return face;
+            }
+        }
     }
+
+    return m_allFaces.front();
 }
 
 void GlyphCache::Impl::ClearCache()
 {
     // Clearing the cache simply gets rid of all meta data so that the textures can be used anew.
     // No actual rendering needs to be done.
-    m_glyphCacheInfo.clear();
-    m_glyphCacheInfo_NonPrintable.clear();
-    m_glyphUsageFrequency.clear();
-    m_shapedStringCache.clear();
-    m_shapedStringUsageFrequency.clear();
-    for (auto& textureCacheInfo : m_textureCacheInfos)
     {
-        textureCacheInfo->ResetToUnused();
+        std::lock_guard<std::mutex> lock(m_glyphLock);
+
+        // Glyphs still being rendered for the old cache are discarded when they come back
+        ++m_cacheEpoch;
+
+        m_glyphCacheInfo.clear();
+        for (auto& atlasTexture : m_atlasTextures)
+        {
+            atlasTexture.m_nextShelfTop = 0;
+            atlasTexture.m_shelves.clear();
+        }
+
+        // Clear any pending uploads and draws too, since those depend upon cached data.
+        m_pendingUploads.clear();
+    }
+
+    for (auto& shard : m_shapedStringShards)
+    {
+        std::lock_guard<std::mutex> lock(shard.m_lock);
+        shard.m_cache.clear();
+        shard.m_usageFrequency.clear();
     }
 
-    // Clear any pending uploads and draws too, since those depend upon cached data.
-    m_pendingUploads.clear();
-    m_pendingDraws.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_drawLock);
+        m_pendingDraws.clear();
+    }
 }
 
 void XM_CALLCONV GlyphCache::Impl::DrawText(const char* str, int size, float x, float y, FXMVECTOR color)
@@ -1628,6 +1691,8 @@ void XM_CALLCONV GlyphCache::Impl::DrawText(const char* str, int size, float x,
     PrecacheGlyphs(shapedStrings, size);
 
     std::shared_ptr<PendingDraw> newDraw = std::make_shared<PendingDraw>(shapedStrings, size, x, y, color);
+
+    std::lock_guard<std::mutex> lock(m_drawLock);
     m_pendingDraws.push_back(newDraw);
 }
 
@@ -1647,38 +1712,33 @@ void GlyphCache::Impl::MeasureText(const char* str, int size, int* outDrawWidth,
     }
 
     auto shapedStrings = CalculateShapedStrings(str, size);
+
+    // Measured text is usually drawn soon after, so start rendering its glyphs now
     PrecacheGlyphs(shapedStrings, size);
 
     int drawWidth = 0;
     int drawHeight = 0;
-    for (auto shapedString : shapedStrings)
+    for (const auto& shapedString : shapedStrings)
     {
         for (unsigned int index = 0; index < shapedString->m_glyphCount; ++index)
         {
-            GlyphKey glyph = { shapedString->m_face, shapedString->m_hbGlyphInfos[index].codepoint, size };
-
-            auto iter = m_glyphCacheInfo.find(glyph);
-            if (iter == m_glyphCacheInfo.end())
-            {
-                iter = m_glyphCacheInfo_NonPrintable.find(glyph);
-                if (iter == m_glyphCacheInfo_NonPrintable.end())
-                {
-                    throw std::exception("MeasureText failed to find a glyph in the cache. "
-                        "This is likely due to the cache being too small. "
-                        "Please increase the number of textures and/or increase texture size.");
-                }
-            }
-
             drawWidth += shapedString->m_hbGlyphPositions[index].x_advance;
 
+            // Use the outline extents from HarfBuzz rather than the rendered glyph, so measuring never waits
+            // on the workers. These are in the same 26.6 units as the FreeType metrics, with y pointing up.
+            hb_glyph_extents_t extents = {};
+            hb_font_get_glyph_extents(shapedString->m_hbFont, shapedString->m_hbGlyphInfos[index].codepoint, &extents);
+            const int bearingY = extents.y_bearing;
+            const int height = -extents.height;
+
             int glyphDrawHeight = 0;
-            if (iter->second.m_metrics.horiBearingY >= iter->second.m_metrics.height)
+            if (bearingY >= height)
             {
-                glyphDrawHeight = iter->second.m_metrics.horiBearingY;
+                glyphDrawHeight = bearingY;
             }
             else
             {
-                glyphDrawHeight = iter->second.m_metrics.height + (iter->second.m_metrics.height - iter->second.m_metrics.horiBearingY);
+                glyphDrawHeight = height + (height - bearingY);
             }
 
             drawHeight = glyphDrawHeight > drawHeight ? glyphDrawHeight : drawHeight;
@@ -1695,164 +1755,319 @@ void GlyphCache::Impl::MeasureText(const char* str, int size, int* outDrawWidth,
     }
 }
 
-void GlyphCache::Impl::RenderGlyphToCache(const GlyphKey& glyph, bool useMissingGlyphSymbol)
+GlyphCache::Impl::GlyphCacheInfo* GlyphCache::Impl::FindOrRequestGlyph(const GlyphKey& glyph, std::vector<GlyphRequest>& newRequests)
 {
-    glyph.m_face->SetCharSize(glyph.m_size);
+    const uint64_t frame = m_frame.load(std::memory_order_relaxed);
 
-    // Load glyph
-    // Don't load bitmap from the font directly so we can always get anti-aliased 8bpp images from the following render.
-    FT_Error error = FT_Load_Glyph(glyph.m_face->m_ftFace, useMissingGlyphSymbol ? 0 : glyph.m_glyphIndex, FT_LOAD_NO_BITMAP);
-    if (error != FT_Err_Ok)
-    {
-        char buf[256] = { 0 };
-        sprintf_s(buf, 256, "FT_Load_Glyph failed. GlyphIndex:%d FamilyName:%s Size:%d Error:%d\n",
-            useMissingGlyphSymbol ? 0 : glyph.m_glyphIndex,
-            glyph.m_face->m_ftFace->family_name ? glyph.m_face->m_ftFace->family_name : "",
-            glyph.m_size,
-            error);
-        OutputDebugStringA(buf);
+    auto iter = m_glyphCacheInfo.find(glyph);
+    if (iter == m_glyphCacheInfo.end())
+    {
+        // Add a placeholder so the glyph is only requested once while a worker renders it
+        GlyphCacheInfo placeholder;
+        placeholder.m_requestedFrame = frame;
+        m_glyphCacheInfo.emplace(glyph, placeholder);
+        newRequests.push_back({ glyph, m_cacheEpoch });
+        return nullptr;
+    }
 
-        if (glyph.m_glyphIndex != 0 && !useMissingGlyphSymbol)
+    GlyphCacheInfo& glyphCacheInfo = iter->second;
+    if (!glyphCacheInfo.m_ready)
+    {
+        // Ask again if the placeholder has waited too long, in case its request never reached a worker.
+        // Whichever copy is rendered first is published and the other is ignored.
+        if (frame - glyphCacheInfo.m_requestedFrame >= c_requestRetryFrames)
         {
-            RenderGlyphToCache(glyph, true);
+            glyphCacheInfo.m_requestedFrame = frame;
+            newRequests.push_back({ glyph, m_cacheEpoch });
         }
 
-        return;
+        return &glyphCacheInfo;
     }
 
-    // CPU render glyph to bitmap buffer
-    error = FT_Render_Glyph(glyph.m_face->m_ftFace->glyph, FT_RENDER_MODE_NORMAL);
-    if (error != FT_Err_Ok)
+    if (glyphCacheInfo.m_ready && glyphCacheInfo.m_printable)
     {
-        char buf[256] = { 0 };
-        sprintf_s(buf, 256, "FT_Load_Glyph failed. GlyphIndex:%d FamilyName:%s Size:%d Error:%d\n",
-            useMissingGlyphSymbol ? 0 : glyph.m_glyphIndex,
-            glyph.m_face->m_ftFace->family_name ? glyph.m_face->m_ftFace->family_name : "",
-            glyph.m_size,
-            error);
-        OutputDebugStringA(buf);
+        // Keep the glyph's shelf from being evicted this frame
+        const AtlasLocation& location = glyphCacheInfo.m_location;
+        m_atlasTextures[location.m_textureIndex].m_shelves[location.m_shelfIndex].m_lastUsedFrame = m_frame.load(std::memory_order_relaxed);
+    }
+
+    return &glyphCacheInfo;
+}
+
+bool GlyphCache::Impl::AllocateAtlasSpace(int width, int height, AtlasLocation& location)
+{
+    const uint64_t frame = m_frame.load(std::memory_order_relaxed);
+    const LONG shelfHeight = std::min<LONG>(AlignUp(LONG(height), 4), m_textureDimension);
+
+    auto placeOnShelf = [&](size_t textureIndex, size_t shelfIndex)
+    {
+        AtlasShelf& shelf = m_atlasTextures[textureIndex].m_shelves[shelfIndex];
+
+        location.m_textureIndex = textureIndex;
+        location.m_shelfIndex = shelfIndex;
+        location.m_rect.left = shelf.m_cursor;
+        location.m_rect.top = shelf.m_top;
+        location.m_rect.right = shelf.m_cursor + width - 1;
+        location.m_rect.bottom = shelf.m_top + height - 1;
 
-        if (glyph.m_glyphIndex != 0 && !useMissingGlyphSymbol)
+        shelf.m_cursor += width;
+        shelf.m_lastUsedFrame = frame;
+    };
+
+    // Best fit among the shelves with room, optionally ignoring shelves much taller than the glyph
+    auto findShelf = [&](LONG maxShelfHeight, size_t& outTextureIndex, size_t& outShelfIndex)
+    {
+        LONG bestHeight = LONG_MAX;
+        for (size_t textureIndex = 0; textureIndex < m_atlasTextures.size(); ++textureIndex)
         {
-            RenderGlyphToCache(glyph, true);
+            const auto& shelves = m_atlasTextures[textureIndex].m_shelves;
+            for (size_t shelfIndex = 0; shelfIndex < shelves.size(); ++shelfIndex)
+            {
+                const AtlasShelf& shelf = shelves[shelfIndex];
+                if (shelf.m_height >= height && shelf.m_height <= maxShelfHeight && shelf.m_height < bestHeight &&
+                    shelf.m_cursor + width <= m_textureDimension)
+                {
+                    bestHeight = shelf.m_height;
+                    outTextureIndex = textureIndex;
+                    outShelfIndex = shelfIndex;
+                }
+            }
         }
+        return bestHeight != LONG_MAX;
+    };
 
-        return;
-    }
-
-    bool printable = !(glyph.m_face->m_ftFace->glyph->bitmap.width == 0 && glyph.m_face->m_ftFace->glyph->bitmap.rows == 0);
+    size_t textureIndex = 0;
+    size_t shelfIndex = 0;
 
-    // Get a new partition from a texture
-    // Increase width and height by 2 pixel for a border
-    if (printable)
-    {
-        int textureIndex = 0;
-        std::shared_ptr<TextureCachePartition> newPartition =
-            TryInsertNewPartition(static_cast<int>(glyph.m_face->m_ftFace->glyph->bitmap.width + 2), static_cast<int>(glyph.m_face->m_ftFace->glyph->bitmap.rows + 2), &textureIndex);
-        if (!newPartition)
-        {
-            char buf[256] = { 0 };
-            sprintf_s(buf, 256, "Failed to insert glyph into cache. GlyphIndex:%d FamilyName:%s Size:%d\nLikely cause is size being too large for any single texture. Is the size a sane value?",
-                useMissingGlyphSymbol ? 0 : glyph.m_glyphIndex,
-                glyph.m_face->m_ftFace->family_name ? glyph.m_face->m_ftFace->family_name : "",
-                glyph.m_size);
-            throw std::exception(buf);
-        }
-
-        // Update glyph cache info
-        m_glyphUsageFrequency.push_front(glyph);
-        GlyphCacheInfo newCacheInfo;
-        newCacheInfo.m_usageFrequencyIter = m_glyphUsageFrequency.begin();
-        newCacheInfo.m_textureCacheInfo = m_textureCacheInfos[(size_t)textureIndex];
-        newCacheInfo.m_textureCachePartition = newPartition;
-        newCacheInfo.m_metrics = glyph.m_face->m_ftFace->glyph->metrics;
-        newCacheInfo.m_face = glyph.m_face;
-        m_glyphCacheInfo[glyph] = newCacheInfo;
-
-        //Setup upload to the texture for the next render call
-        std::shared_ptr<PendingUpload> newUpload = std::make_shared<PendingUpload>(m_ftLibrary, glyph.m_face->m_ftFace->glyph->bitmap, glyph);
-        m_pendingUploads.push_back(newUpload);
-    }
-    else
+    // A shelf already sized for glyphs like this one
+    if (findShelf(shelfHeight + shelfHeight / 2, textureIndex, shelfIndex))
     {
-        // Update glyph cache info for non-printable character
-        GlyphCacheInfo newCacheInfo;
-        newCacheInfo.m_metrics = glyph.m_face->m_ftFace->glyph->metrics;
-        m_glyphCacheInfo_NonPrintable[glyph] = newCacheInfo;
+        placeOnShelf(textureIndex, shelfIndex);
+        return true;
     }
-}
 
-void GlyphCache::Impl::ClearGlyphFromCache(const GlyphKey& glyph)
-{
-    auto glyphCacheInfoIter = m_glyphCacheInfo.find(glyph);
-    auto nonPrintableGlyphCacheInfoIter = m_glyphCacheInfo_NonPrintable.find(glyph);
-
-    if (glyphCacheInfoIter != m_glyphCacheInfo.end())
+    // A new shelf in the unused space at the bottom of a texture
+    for (textureIndex = 0; textureIndex < m_atlasTextures.size(); ++textureIndex)
     {
-        // Remove usage entry
-        m_glyphUsageFrequency.erase(glyphCacheInfoIter->second.m_usageFrequencyIter);
+        AtlasTexture& atlasTexture = m_atlasTextures[textureIndex];
+        if (atlasTexture.m_nextShelfTop + shelfHeight <= m_textureDimension)
+        {
+            AtlasShelf shelf = {};
+            shelf.m_top = atlasTexture.m_nextShelfTop;
+            shelf.m_height = shelfHeight;
+            atlasTexture.m_shelves.push_back(std::move(shelf));
+            atlasTexture.m_nextShelfTop += shelfHeight;
+
+            placeOnShelf(textureIndex, atlasTexture.m_shelves.size() - 1);
+            return true;
+        }
+    }
 
-        // Remove texture partition entry
-        glyphCacheInfoIter->second.m_textureCachePartition->ClearInUse();
-        glyphCacheInfoIter->second.m_textureCachePartition->TryCombiningWithNeighbors();
+    // Any shelf with room, however tall
+    if (findShelf(LONG_MAX - 1, textureIndex, shelfIndex))
+    {
+        placeOnShelf(textureIndex, shelfIndex);
+        return true;
+    }
 
-        // Remove info entry
-        m_glyphCacheInfo.erase(glyphCacheInfoIter);
+    // Evict the least recently used shelf that fits, as long as nothing on it was used this frame
+    uint64_t oldestFrame = frame;
+    bool found = false;
+    for (size_t candidateTexture = 0; candidateTexture < m_atlasTextures.size(); ++candidateTexture)
+    {
+        const auto& shelves = m_atlasTextures[candidateTexture].m_shelves;
+        for (size_t candidateShelf = 0; candidateShelf < shelves.size(); ++candidateShelf)
+        {
+            const AtlasShelf& shelf = shelves[candidateShelf];
+            if (shelf.m_height >= height && shelf.m_lastUsedFrame < oldestFrame)
+            {
+                oldestFrame = shelf.m_lastUsedFrame;
+                textureIndex = candidateTexture;
+                shelfIndex = candidateShelf;
+                found = true;
+            }
+        }
     }
-    else if (nonPrintableGlyphCacheInfoIter != m_glyphCacheInfo_NonPrintable.end())
+
+    if (!found)
     {
-        // Remove info entry
-        m_glyphCacheInfo_NonPrintable.erase(nonPrintableGlyphCacheInfoIter);
+        return false;
     }
+
+    EvictShelf(textureIndex, shelfIndex);
+    placeOnShelf(textureIndex, shelfIndex);
+    return true;
 }
 
-_Use_decl_annotations_
-void GlyphCache::Impl::BeginTextureBatch(ID3D12GraphicsCommandList* commandList)
+void GlyphCache::Impl::EvictShelf(size_t textureIndex, size_t shelfIndex)
 {
-    auto heap = m_textureDescriptorHeap->Heap();
-    commandList->SetDescriptorHeaps(1, &heap);
+    AtlasShelf& shelf = m_atlasTextures[textureIndex].m_shelves[shelfIndex];
 
-    m_textureBatch->Begin(commandList);
-}
+    for (const auto& glyph : shelf.m_glyphs)
+    {
+        auto iter = m_glyphCacheInfo.find(glyph);
+        if (iter != m_glyphCacheInfo.end() &&
+            iter->second.m_printable &&
+            iter->second.m_location.m_textureIndex == textureIndex &&
+            iter->second.m_location.m_shelfIndex == shelfIndex)
+        {
+            m_glyphCacheInfo.erase(iter);
+        }
+    }
 
-void GlyphCache::Impl::EndTextureBatch()
-{
-    m_textureBatch->End();
+    shelf.m_glyphs.clear();
+    shelf.m_cursor = 0;
 }
 
-std::shared_ptr<GlyphCache::Impl::TextureCachePartition> GlyphCache::Impl::TryInsertNewPartition(int width, int height, int* outTextureIndex)
+void GlyphCache::Impl::SubmitGlyphRequests(std::vector<GlyphRequest>& requests)
 {
-    do
+    LONG submitted = 0;
+    for (auto iter = requests.begin(); iter != requests.end(); ++iter)
     {
-        for (size_t index = 0; index < m_textureCacheInfos.size(); ++index)
+        if (!m_requests.TryPush(std::move(*iter)))
         {
-            auto newPartition = m_textureCacheInfos[index]->TryInsertNewPartition(width, height);
-            if (newPartition)
+            // The queue is full. Forget the remaining placeholders so these glyphs are requested again next time
+            // they are used.
+            std::lock_guard<std::mutex> lock(m_glyphLock);
+            for (; iter != requests.end(); ++iter)
             {
-                if (outTextureIndex)
+                auto glyphCacheInfoIter = m_glyphCacheInfo.find(iter->m_glyph);
+                if (glyphCacheInfoIter != m_glyphCacheInfo.end() && !glyphCacheInfoIter->second.m_ready)
                 {
-                    (*outTextureIndex) = static_cast<int>(index);
+                    m_glyphCacheInfo.erase(glyphCacheInfoIter);
                 }
-                return newPartition;
             }
+            break;
         }
 
+        ++submitted;
+    }
 
-    } while (EjectOldGlyph());
+    if (submitted > 0)
+    {
+        ReleaseSemaphore(m_requestsAvailable, submitted, nullptr);
+    }
 
-    return {};
+    requests.clear();
 }
 
-bool GlyphCache::Impl::EjectOldGlyph()
+void GlyphCache::Impl::WorkerThread()
 {
-    if (m_glyphUsageFrequency.size() == 0)
+    for (;;)
     {
-        return false;
+        WaitForSingleObject(m_requestsAvailable, INFINITE);
+        if (m_shutdown)
+        {
+            return;
+        }
+
+        // Each count on the semaphore stands for a pushed request, but the producer of an earlier cell may not
+        // have published it yet. Retry rather than wait again, which would lose the count and strand the request.
+        GlyphRequest request;
+        while (!m_requests.TryPop(request))
+        {
+            std::this_thread::yield();
+        }
+
+        const GlyphKey& glyph = request.m_glyph;
+        RenderedGlyph renderedGlyph = {};
+        bool rendered = false;
+        try
+        {
+            rendered = glyph.m_face->RenderGlyph(glyph.m_glyphIndex, glyph.m_size, renderedGlyph);
+            if (!rendered && glyph.m_glyphIndex != 0)
+            {
+                // Fall back to the font's missing glyph symbol
+                rendered = glyph.m_face->RenderGlyph(0, glyph.m_size, renderedGlyph);
+            }
+        }
+        catch (const std::exception&)
+        {
+            OutputDebugStringA("GlyphCache failed to render a glyph\n");
+            rendered = false;
+        }
+
+        PublishGlyph(request, rendered, renderedGlyph);
     }
+}
 
-    ClearGlyphFromCache(m_glyphUsageFrequency.back());
+void GlyphCache::Impl::PublishGlyph(const GlyphRequest& request, bool rendered, RenderedGlyph& glyph)
+{
+    std::lock_guard<std::mutex> lock(m_glyphLock);
 
-    return true;
+    // The cache was cleared since this glyph was requested
+    if (request.m_cacheEpoch != m_cacheEpoch)
+    {
+        return;
+    }
+
+    auto iter = m_glyphCacheInfo.find(request.m_glyph);
+    if (iter == m_glyphCacheInfo.end() || iter->second.m_ready)
+    {
+        return;
+    }
+
+    // Glyphs that fail to render, or have no pixels (such as spaces), are cached as non-printable
+    GlyphCacheInfo& glyphCacheInfo = iter->second;
+    glyphCacheInfo.m_ready = true;
+    if (!rendered)
+    {
+        return;
+    }
+
+    glyphCacheInfo.m_metrics = glyph.m_metrics;
+    if (glyph.m_width == 0 || glyph.m_rows == 0)
+    {
+        return;
+    }
+
+    // Increase width and height by 2 pixel for a border
+    const int width = int(glyph.m_width) + 2;
+    const int height = int(glyph.m_rows) + 2;
+    if (width > m_textureDimension || height > m_textureDimension)
+    {
+        char buf[128] = { 0 };
+        sprintf_s(buf, 128, "GlyphCache glyph (%d x %d) does not fit in a %d pixel texture\n", width, height, int(m_textureDimension));
+        OutputDebugStringA(buf);
+        return;
+    }
+
+    AtlasLocation location;
+    if (!AllocateAtlasSpace(width, height, location))
+    {
+        // Everything in the atlas was used this frame. Drop the glyph; it is requested again the next time it is drawn.
+        const uint64_t frame = m_frame.load(std::memory_order_relaxed);
+        if (m_atlasFullReportedFrame != frame)
+        {
+            m_atlasFullReportedFrame = frame;
+            OutputDebugStringA("GlyphCache textures are full. Please increase the number of textures and/or increase texture size.\n");
+        }
+
+        m_glyphCacheInfo.erase(iter);
+        return;
+    }
+
+    glyphCacheInfo.m_printable = true;
+    glyphCacheInfo.m_uploaded = false;
+    glyphCacheInfo.m_allocationId = ++m_nextAllocationId;
+    glyphCacheInfo.m_location = location;
+
+    m_atlasTextures[location.m_textureIndex].m_shelves[location.m_shelfIndex].m_glyphs.push_back(request.m_glyph);
+    m_pendingUploads.push_back(std::make_shared<PendingUpload>(request.m_glyph, glyphCacheInfo.m_allocationId, location, std::move(glyph)));
+}
+
+_Use_decl_annotations_
+void GlyphCache::Impl::BeginTextureBatch(ID3D12GraphicsCommandList* commandList)
+{
+    auto heap = m_textureDescriptorHeap->Heap();
+    commandList->SetDescriptorHeaps(1, &heap);
+
+    m_textureBatch->Begin(commandList);
+}
+
+void GlyphCache::Impl::EndTextureBatch()
+{
+    m_textureBatch->End();
 }
 
 _Use_decl_annotations_
@@ -1934,23 +2149,17 @@ bool GlyphCache::LoadNotoFonts(const std::string& optSubDir)
 
 void GlyphCache::PrecacheGlyphs(const char* utf8String, int fontSize)
 {
-    pImpl->Lock();
     pImpl->PrecacheGlyphs(utf8String, fontSize);
-    pImpl->Unlock();
 }
 
 void XM_CALLCONV GlyphCache::EnqueueDrawText(const char* utf8String, int fontSize, float xPos, float yPos, FXMVECTOR color)
 {
-    pImpl->Lock();
     pImpl->DrawText(utf8String, fontSize, xPos, yPos, color);
-    pImpl->Unlock();
 }
 
 void GlyphCache::MeasureText(const char* utf8String, int fontSize, int* outDrawWidth, int* outDrawHeight)
 {
-    pImpl->Lock();
     pImpl->MeasureText(utf8String, fontSize, outDrawWidth, outDrawHeight);
-    pImpl->Unlock();
 }
 
 void GlyphCache::ClearCache()
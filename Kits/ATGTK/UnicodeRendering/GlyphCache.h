@@ -50,13 +50,15 @@ namespace ATG
 
     // The glyph cache provides functionality to cache Unicode glyphs to texture atlases based on loaded fonts using the FreeType2 open-source library.
     // In addition, this class can render Unicode strings and provide measuring and string conversions between UTF8 and UTF32.
-    // The GlyphCache is thread-safe, however it's not efficient when used simultaneously on multiple threads. The safety is provided via naive locking of methods.
+    // The GlyphCache is thread-safe. Strings can be queued, measured and precached from any number of threads at once; glyphs that are not cached yet are
+    // rendered by background worker threads and drawn once they are ready, so these calls never wait on glyph rendering. Render(), RenderFrameAdvance(),
+    // DrawString() and the resource creation methods are meant to be called from the rendering thread.
     class GlyphCache
     {
     public:
 
         // The maximum number of cached glyphs is based on the maximum textures this cache can have.
-        // Once those textures fill up, old glyphs will be emptied and overwritten based on usage.
+        // Once those textures fill up, the least recently used rows of glyphs will be emptied and overwritten. Glyphs used during the current frame are never evicted.
         // Using one texture causes the most efficient string rendering, but can churn glyph upload/cache if a lot of different glyphs are used.
         // Using multiple textures causes a more efficient cache with less glyph upload/churn, but less efficient individual string draws.
         // A shaped string is the final render representation of glyph positions, glyph reordering, etc. A single input string may have multiple
@@ -96,16 +98,18 @@ namespace ATG
         bool LoadNotoFonts(const std::string& optSubDir = "");
 
         // Precaches the glyphs present within the string at the specified size for optimization purposes. This action is performed automatically if needed by the EnqueueDrawText method.
+        // The glyphs are rendered asynchronously; this method only queues them and returns immediately.
         void PrecacheGlyphs(const char* utf8String, int fontSize);
 
         // Queues the specified string to draw with the next Render() call. The glyphs within are precached as needed. Strings do not persist, so this method should be called whenever
         // a draw is desired. Draw location uses screen pixel coordinates with the origin being the top-left of screen and top-left of glyph run.
+        // Glyphs that are still being rendered are skipped, so a newly used glyph may appear a frame or two after the first draw that needs it.
         // NOTE: Provides no support for wrapping/clipping/newlines. Instead, a consumer of this cache can implement it themselves using the conversion and
         // measurement methods below.
         void XM_CALLCONV EnqueueDrawText(const char* utf8String, int fontSize, float xPos, float yPos, DirectX::FXMVECTOR color = ATG::Colors::White);
 
-        // Measures how tall and wide a particular string would be if it were to be drawn. Measurement information for a glyph is only known after it is
-        // rendered, so this method caches all glyphs within the string.
+        // Measures how tall and wide a particular string would be if it were to be drawn. Measurement comes from the font outlines, so this method does not wait
+        // for the glyphs to be rendered. It does queue them, since a measured string is usually drawn soon after.
         // Note: the draw height includes drawing above or below "standard" characters, such as diacritics. It's best to use custom heights for layout based on
         // draw size instead of the measured height since the measured height can change a lot based on the string.        
         void MeasureText(const char* utf8String, int fontSize, int* outDrawWidth, int* outDrawHeight);
@@ -159,8 +159,26 @@ namespace DirectX
     };
 
 
+    //------------------------------------------------------------------------------
+    struct DescriptorPileStatistics
+    {
+        size_t capacity;            // Total descriptors in the pile
+        size_t reserved;            // Descriptors reserved at creation, never allocated
+        size_t allocated;           // Descriptors currently handed out
+        size_t free;                // Descriptors available for allocation
+        size_t pendingFree;         // Freed descriptors waiting on a GPU fence
+        size_t freeRangeCount;      // Runs of contiguous free descriptors
+        size_t largestFreeRange;    // Longest run of contiguous free descriptors
+        float  fragmentation;       // 1 - largestFreeRange / free
+    };
+
     // Helper class for dynamically allocating descriptor indices.
     // The pile is statically sized and will throw an exception if it becomes full.
+    //
+    // Descriptors can be returned with Free, or with FreeDeferred when the GPU may still
+    // reference them. Allocating and freeing is thread-safe; single descriptors are recycled
+    // through a lock-free list, while contiguous ranges are taken from coalesced free ranges
+    // under a lock.
     class DescriptorPile : public DescriptorHeap
     {
     public:
@@ -170,26 +188,18 @@ namespace DirectX
         DIRECTX_TOOLKIT_API inline DescriptorPile(
             _In_ ID3D12DescriptorHeap* pExistingHeap,
             size_t reserve = 0)
-            : DescriptorHeap(pExistingHeap),
-            m_top(reserve)
+            : DescriptorHeap(pExistingHeap)
         {
-            if (reserve > 0 && m_top >= Count())
-            {
-                throw std::out_of_range("Reserve descriptor range is too large");
-            }
+            Initialize(reserve);
         }
 
         DIRECTX_TOOLKIT_API inline DescriptorPile(
             _In_ ID3D12Device* device,
             _In_ const D3D12_DESCRIPTOR_HEAP_DESC* pDesc,
             size_t reserve = 0)
-            : DescriptorHeap(device, pDesc),
-            m_top(reserve)
+            : DescriptorHeap(device, pDesc)
         {
-            if (reserve > 0 && m_top >= Count())
-            {
-                throw std::out_of_range("Reserve descriptor range is too large");
-            }
+            Initialize(reserve);
         }
 
         DIRECTX_TOOLKIT_API inline DescriptorPile(
@@ -198,13 +208,9 @@ namespace DirectX
             D3D12_DESCRIPTOR_HEAP_FLAGS flags,
             size_t capacity,
             size_t reserve = 0)
-            : DescriptorHeap(device, type, flags, capacity),
-            m_top(reserve)
+            : DescriptorHeap(device, type, flags, capacity)
         {
-            if (reserve > 0 && m_top >= Count())
-            {
-                throw std::out_of_range("Reserve descriptor range is too large");
-            }
+            Initialize(reserve);
         }
 
         DIRECTX_TOOLKIT_API inline DescriptorPile(
@@ -216,12 +222,14 @@ namespace DirectX
                 D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE, count, reserve)
         {}
 
-        DescriptorPile(DescriptorPile&&) = default;
-        DescriptorPile& operator=(DescriptorPile&&) = default;
+        DIRECTX_TOOLKIT_API DescriptorPile(DescriptorPile&&) noexcept;
+        DIRECTX_TOOLKIT_API DescriptorPile& operator=(DescriptorPile&&) noexcept;
 
         DescriptorPile(const DescriptorPile&) = delete;
         DescriptorPile& operator=(const DescriptorPile&) = delete;
 
+        DIRECTX_TOOLKIT_API ~DescriptorPile();
+
         DIRECTX_TOOLKIT_API inline IndexType Allocate()
         {
             IndexType start, end;
@@ -232,7 +240,34 @@ namespace DirectX
 
         DIRECTX_TOOLKIT_API void AllocateRange(size_t numDescriptors, _Out_ IndexType& start, _Out_ IndexType& end);
 
+        // Returns descriptors for immediate reuse. Only free descriptors the GPU no longer references.
+        DIRECTX_TOOLKIT_API inline void Free(IndexType index)
+        {
+            FreeRange(index, index + 1);
+        }
+
+        DIRECTX_TOOLKIT_API void FreeRange(IndexType start, IndexType end);
+
+        // Returns descriptors for reuse once fence reaches fenceValue, e.g. after signaling it on
+        // the queue that executes the last command list that uses them.
+        DIRECTX_TOOLKIT_API inline void FreeDeferred(IndexType index, _In_ ID3D12Fence* fence, uint64_t fenceValue)
+        {
+            FreeRangeDeferred(index, index + 1, fence, fenceValue);
+        }
+
+        DIRECTX_TOOLKIT_API void FreeRangeDeferred(IndexType start, IndexType end, _In_ ID3D12Fence* fence, uint64_t fenceValue);
+
+        // Recycles deferred frees whose fence has completed, returning the number of descriptors.
+        // This also happens automatically when an allocation would otherwise fail.
+        DIRECTX_TOOLKIT_API size_t ReclaimDeferred();
+
+        DIRECTX_TOOLKIT_API DescriptorPileStatistics GetStatistics() const;
+
     private:
-        IndexType m_top;
+        class Impl;
+
+        DIRECTX_TOOLKIT_API void Initialize(size_t reserve);
+
+        std::unique_ptr<Impl> pImpl;
     };
 }
@@ -23,6 +23,7 @@
 #endif
 
 #include <cstdint>
+#include <functional>
 #include <future>
 #include <memory>
 
@@ -90,9 +91,20 @@ namespace DirectX
 
         // Submits all the uploads to the driver.
         // No more uploads can happen after this call until Begin is called again.
-        // This returns a handle to an event that can be waited on.
+        // This returns a future that can be waited on. Unlike a std::async future, destroying it
+        // does not block, so call wait() if the CPU needs the upload to have finished.
         DIRECTX_TOOLKIT_API std::future<void> __cdecl End(_In_ ID3D12CommandQueue* commandQueue);
 
+        // Submits all the uploads to the driver, and calls onComplete with S_OK once the GPU has
+        // finished them, or with a failure code if waiting for the GPU failed. The callback runs
+        // on the shared upload completion thread, so it must be quick and must not throw.
+        DIRECTX_TOOLKIT_API void __cdecl End(
+            _In_ ID3D12CommandQueue* commandQueue,
+            std::function<void(HRESULT)> onComplete);
+
+        // Polls whether the GPU has finished the most recently submitted batch, without blocking.
+        DIRECTX_TOOLKIT_API bool __cdecl IsComplete() const noexcept;
+
         // Validates if the given DXGI format is supported for autogen mipmaps
         DIRECTX_TOOLKIT_API bool __cdecl IsSupportedForGenerateMips(DXGI_FORMAT format) noexcept;
 
@@ -129,6 +129,9 @@ namespace DirectX
             DIRECTX_TOOLKIT_API virtual ~SpriteBatch();
 
             // Begin/End a batch of sprite drawing operations.
+            // Unless the sort mode is Immediate, Draw may be called from several threads at once between
+            // Begin and End. Each thread's sprites keep their order; sprites from different threads are
+            // merged at End in the order those threads first called Draw.
             DIRECTX_TOOLKIT_API void XM_CALLCONV Begin(
                 _In_ ID3D12GraphicsCommandList* commandList,
                 SpriteSortMode sortMode = SpriteSortMode_Deferred,
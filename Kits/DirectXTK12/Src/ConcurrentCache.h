@@ -0,0 +1,309 @@
+//--------------------------------------------------------------------------------------
+// File: ConcurrentCache.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cwchar>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace DirectX
+{
+    // Name-keyed cache used by the effect and texture factories, which are hit from many threads
+    // at once while models load in parallel.
+    //
+    // Lookups are lock-free: entries are never modified once published, and the bucket table is
+    // replaced rather than resized in place, with retired tables kept until Clear. Inserts take a
+    // mutex, and concurrent requests for the same missing key share a single call to the creation
+    // function.
+    //
+    // Clear must not be called while other threads are using the cache.
+    template<typename TValue>
+    class ConcurrentCache
+    {
+    public:
+        // A lookup key: the name plus two optional integers (such as effect flags and a pipeline
+        // state hash), with the hash of all three computed once up front.
+        struct Key
+        {
+            const wchar_t*  name;
+            size_t          length;
+            uint32_t        flags;
+            uint32_t        stateHash;
+            size_t          hash;
+
+            Key(_In_reads_(nameLength) const wchar_t* keyName, size_t nameLength, uint32_t keyFlags = 0, uint32_t keyStateHash = 0) noexcept
+                : name(keyName),
+                length(nameLength),
+                flags(keyFlags),
+                stateHash(keyStateHash),
+                hash(ComputeHash(keyName, nameLength, keyFlags, keyStateHash))
+            {}
+
+            explicit Key(const std::wstring& keyName, uint32_t keyFlags = 0, uint32_t keyStateHash = 0) noexcept
+                : Key(keyName.c_str(), keyName.length(), keyFlags, keyStateHash)
+            {}
+        };
+
+        ConcurrentCache() noexcept(false)
+            : mCount(0)
+        {
+            auto table = std::make_unique<Table>();
+            mTable.store(table.get(), std::memory_order_release);
+            mTables.push_back(std::move(table));
+        }
+
+        ConcurrentCache(ConcurrentCache const&) = delete;
+        ConcurrentCache& operator= (ConcurrentCache const&) = delete;
+
+        // Returns true and copies out the cached value if the key is present. Never blocks.
+        bool TryGet(const Key& key, TValue& value) const
+        {
+            const Node* node = Find(mTable.load(std::memory_order_acquire), key);
+            if (!node)
+                return false;
+
+            value = node->value;
+            return true;
+        }
+
+        // Returns the cached value, calling create() to make it if the key is missing. If several
+        // threads miss on the same key, one of them creates the value and the others wait for it.
+        // Exceptions thrown by create() propagate to every waiting caller and nothing is cached.
+        template<typename TCreate>
+        TValue GetOrCreate(const Key& key, TCreate&& create)
+        {
+            TValue value;
+            if (TryGet(key, value))
+                return value;
+
+            std::unique_lock<std::mutex> lock(mMutex);
+
+            // Someone may have finished creating it since the lock-free lookup
+            const Node* node = Find(mTable.load(std::memory_order_relaxed), key);
+            if (node)
+                return node->value;
+
+            for (const auto& inflight : mInFlight)
+            {
+                if (inflight.first->Matches(key))
+                {
+                    std::shared_future<TValue> pending = inflight.second;
+                    lock.unlock();
+                    return pending.get();
+                }
+            }
+
+            std::promise<TValue> promise;
+            mInFlight.emplace_back(std::make_unique<Node>(key, TValue()), promise.get_future().share());
+            lock.unlock();
+
+            try
+            {
+                value = create();
+            }
+            catch (...)
+            {
+                lock.lock();
+                RemoveInFlight(key);
+                promise.set_exception(std::current_exception());
+                throw;
+            }
+
+            lock.lock();
+            RemoveInFlight(key);
+            promise.set_value(value);
+            Publish(key, value);
+
+            return value;
+        }
+
+        // Removes every entry.
+        void Clear()
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            auto table = std::make_unique<Table>();
+            mTable.store(table.get(), std::memory_order_release);
+
+            mTables.clear();
+            mTables.push_back(std::move(table));
+            mCount = 0;
+        }
+
+    private:
+        static constexpr size_t InitialBucketCount = 64;
+        static constexpr size_t MaxLoadFactor = 2;
+
+        static size_t ComputeHash(_In_reads_(length) const wchar_t* name, size_t length, uint32_t flags, uint32_t stateHash) noexcept
+        {
+            // 64-bit FNV-1a
+            uint64_t hash = 14695981039346656037ULL;
+            const auto mix = [&hash](uint64_t v) noexcept
+            {
+                hash ^= v;
+                hash *= 1099511628211ULL;
+            };
+
+            for (size_t j = 0; j < length; ++j)
+            {
+                mix(static_cast<uint64_t>(name[j]));
+            }
+
+            mix(flags);
+            mix(stateHash);
+
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+
+        struct Node
+        {
+            size_t          hash;
+            std::wstring    name;
+            uint32_t        flags;
+            uint32_t        stateHash;
+            TValue          value;
+            const Node*     next;
+
+            Node(const Key& key, const TValue& nodeValue)
+                : hash(key.hash),
+                name(key.name, key.length),
+                flags(key.flags),
+                stateHash(key.stateHash),
+                value(nodeValue),
+                next(nullptr)
+            {}
+
+            // Copies the entry but not its bucket link
+            Node(const Node& other)
+                : hash(other.hash),
+                name(other.name),
+                flags(other.flags),
+                stateHash(other.stateHash),
+                value(other.value),
+                next(nullptr)
+            {}
+
+            Node& operator= (const Node&) = delete;
+
+            bool Matches(const Key& key) const noexcept
+            {
+                return hash == key.hash
+                    && flags == key.flags
+                    && stateHash == key.stateHash
+                    && name.length() == key.length
+                    && std::wmemcmp(name.c_str(), key.name, key.length) == 0;
+            }
+        };
+
+        // Bucket heads are atomic; everything reachable from them is immutable.
+        struct Table
+        {
+            explicit Table(size_t bucketCount = InitialBucketCount)
+                : mask(bucketCount - 1),
+                buckets(new std::atomic<const Node*>[bucketCount]())
+            {}
+
+            ~Table()
+            {
+                for (size_t j = 0; j <= mask; ++j)
+                {
+                    const Node* node = buckets[j].load(std::memory_order_relaxed);
+                    while (node)
+                    {
+                        const Node* next = node->next;
+                        delete node;
+                        node = next;
+                    }
+                }
+            }
+
+            Table(Table const&) = delete;
+            Table& operator= (Table const&) = delete;
+
+            // Publishes a fully constructed node. Only called with the cache mutex held.
+            void Insert(Node* node) noexcept
+            {
+                auto& bucket = buckets[node->hash & mask];
+                node->next = bucket.load(std::memory_order_relaxed);
+                bucket.store(node, std::memory_order_release);
+            }
+
+            size_t                                      mask;
+            std::unique_ptr<std::atomic<const Node*>[]> buckets;
+        };
+
+        static const Node* Find(const Table* table, const Key& key) noexcept
+        {
+            const Node* node = table->buckets[key.hash & table->mask].load(std::memory_order_acquire);
+            while (node && !node->Matches(key))
+            {
+                node = node->next;
+            }
+            return node;
+        }
+
+        void Publish(const Key& key, const TValue& value)
+        {
+            Table* table = mTable.load(std::memory_order_relaxed);
+
+            if (mCount + 1 > (table->mask + 1) * MaxLoadFactor)
+            {
+                // Readers may still be walking the old table, so build a new one from copies of
+                // the nodes and keep the old one until Clear.
+                auto grown = std::make_unique<Table>((table->mask + 1) * 4);
+                for (size_t j = 0; j <= table->mask; ++j)
+                {
+                    for (const Node* node = table->buckets[j].load(std::memory_order_relaxed); node; node = node->next)
+                    {
+                        grown->Insert(new Node(*node));
+                    }
+                }
+
+                mTables.reserve(mTables.size() + 1);
+                table = grown.get();
+                mTables.push_back(std::move(grown));
+            }
+
+            table->Insert(new Node(key, value));
+            ++mCount;
+
+            mTable.store(table, std::memory_order_release);
+        }
+
+        void RemoveInFlight(const Key& key) noexcept
+        {
+            for (auto it = mInFlight.begin(); it != mInFlight.end(); ++it)
+            {
+                if (it->first->Matches(key))
+                {
+                    mInFlight.erase(it);
+                    break;
+                }
+            }
+        }
+
+        using InFlightEntry = std::pair<std::unique_ptr<Node>, std::shared_future<TValue>>;
+
+        std::atomic<Table*>                 mTable;
+        std::mutex                          mMutex;
+        std::vector<std::unique_ptr<Table>> mTables;    // current table last, older ones are retired
+        std::vector<InFlightEntry>          mInFlight;
+        size_t                              mCount;
+    };
+}
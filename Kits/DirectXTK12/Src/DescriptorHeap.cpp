@@ -212,6 +212,319 @@ void DescriptorHeap::DefaultDesc(
 // DescriptorPile
 //======================================================================================
 
+namespace
+{
+    constexpr uint32_t c_EmptyList = UINT32_MAX;
+}
+
+class DescriptorPile::Impl
+{
+public:
+    Impl(size_t count, size_t reserve) :
+        mCount(count),
+        mReserve(reserve),
+        mTop(reserve),
+        mNext(new std::atomic<uint32_t>[count]),
+        mSingleHead(c_EmptyList),
+        mSingleCount(0),
+        mAllocated(0)
+    {
+    }
+
+    Impl(Impl&&) = delete;
+    Impl& operator= (Impl&&) = delete;
+
+    Impl(Impl const&) = delete;
+    Impl& operator= (Impl const&) = delete;
+
+    bool TryAllocate(size_t numDescriptors, IndexType& start)
+    {
+        if (numDescriptors == 1 && PopSingle(start))
+        {
+            mAllocated += 1;
+            return true;
+        }
+
+        if (BumpTop(numDescriptors, start))
+        {
+            mAllocated += numDescriptors;
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        if (!TakeRangeLocked(numDescriptors, start))
+        {
+            // Recycle what we can, merge freed singles into ranges and try again
+            ReclaimLocked();
+            DrainSinglesLocked();
+
+            if (!TakeRangeLocked(numDescriptors, start) && !BumpTop(numDescriptors, start))
+            {
+                return false;
+            }
+        }
+
+        mAllocated += numDescriptors;
+        return true;
+    }
+
+    void Free(IndexType start, IndexType end)
+    {
+        Validate(start, end);
+
+        mAllocated -= end - start;
+
+        if (end - start == 1)
+        {
+            PushSingle(start);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            InsertRangeLocked(start, end);
+        }
+    }
+
+    void FreeDeferred(IndexType start, IndexType end, ID3D12Fence* fence, uint64_t fenceValue)
+    {
+        Validate(start, end);
+
+        if (!fence)
+        {
+            throw std::invalid_argument("Fence is null");
+        }
+
+        mAllocated -= end - start;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        PendingFree pending = { start, end, fence, fenceValue };
+        mPending.emplace_back(std::move(pending));
+    }
+
+    size_t Reclaim()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        return ReclaimLocked();
+    }
+
+    DescriptorPileStatistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        // Descriptors above the top form one more free range
+        const size_t top = mTop.load();
+        const size_t tail = mCount - top;
+        const size_t singles = mSingleCount.load();
+
+        DescriptorPileStatistics stats = {};
+        stats.capacity = mCount;
+        stats.reserved = mReserve;
+        stats.allocated = mAllocated.load();
+        stats.freeRangeCount = mRangesByStart.size() + singles + (tail > 0 ? 1 : 0);
+        stats.largestFreeRange = std::max<size_t>(tail, singles > 0 ? 1 : 0);
+
+        for (auto& range : mRangesByStart)
+        {
+            stats.free += range.second - range.first;
+        }
+
+        if (!mRangesBySize.empty())
+        {
+            stats.largestFreeRange = std::max(stats.largestFreeRange, mRangesBySize.rbegin()->first);
+        }
+
+        stats.free += singles + tail;
+
+        for (auto& pending : mPending)
+        {
+            stats.pendingFree += pending.end - pending.start;
+        }
+
+        stats.fragmentation = (stats.free > 0) ? 1.f - float(stats.largestFreeRange) / float(stats.free) : 0.f;
+
+        return stats;
+    }
+
+private:
+    struct PendingFree
+    {
+        IndexType                                   start;
+        IndexType                                   end;
+        Microsoft::WRL::ComPtr<ID3D12Fence>         fence;
+        uint64_t                                    fenceValue;
+    };
+
+    void Validate(IndexType start, IndexType end) const
+    {
+        if (start >= end || start < mReserve || end > mTop.load())
+        {
+            throw std::out_of_range("Descriptor range was not allocated from this pile");
+        }
+    }
+
+    bool BumpTop(size_t numDescriptors, IndexType& start) noexcept
+    {
+        size_t top = mTop.load();
+        do
+        {
+            if (numDescriptors > mCount - top)
+                return false;
+        }
+        while (!mTop.compare_exchange_weak(top, top + numDescriptors));
+
+        start = top;
+        return true;
+    }
+
+    // Treiber stack of single descriptors; the head carries a tag in its upper half to avoid ABA
+    bool PopSingle(IndexType& index) noexcept
+    {
+        uint64_t head = mSingleHead.load(std::memory_order_acquire);
+        for (;;)
+        {
+            const uint32_t first = static_cast<uint32_t>(head);
+            if (first == c_EmptyList)
+                return false;
+
+            const uint64_t next = mNext[first].load(std::memory_order_relaxed);
+            const uint64_t newHead = (((head >> 32) + 1) << 32) | next;
+            if (mSingleHead.compare_exchange_weak(head, newHead, std::memory_order_acquire, std::memory_order_acquire))
+            {
+                mSingleCount -= 1;
+                index = first;
+                return true;
+            }
+        }
+    }
+
+    void PushSingle(IndexType index) noexcept
+    {
+        uint64_t head = mSingleHead.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do
+        {
+            mNext[index].store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            newHead = (((head >> 32) + 1) << 32) | index;
+        }
+        while (!mSingleHead.compare_exchange_weak(head, newHead, std::memory_order_release, std::memory_order_relaxed));
+
+        mSingleCount += 1;
+    }
+
+    // Best fit from the free ranges, returning the remainder to the free ranges
+    bool TakeRangeLocked(size_t numDescriptors, IndexType& start)
+    {
+        auto it = mRangesBySize.lower_bound(std::make_pair(numDescriptors, IndexType(0)));
+        if (it == mRangesBySize.end())
+            return false;
+
+        const size_t size = it->first;
+        start = it->second;
+
+        mRangesBySize.erase(it);
+        mRangesByStart.erase(start);
+
+        if (size > numDescriptors)
+        {
+            mRangesByStart[start + numDescriptors] = start + size;
+            mRangesBySize.emplace(size - numDescriptors, start + numDescriptors);
+        }
+
+        return true;
+    }
+
+    void InsertRangeLocked(IndexType start, IndexType end)
+    {
+        // Coalesce with the neighboring free ranges
+        auto next = mRangesByStart.lower_bound(start);
+        if (next != mRangesByStart.end() && next->first == end)
+        {
+            end = next->second;
+            mRangesBySize.erase(std::make_pair(next->second - next->first, next->first));
+            next = mRangesByStart.erase(next);
+        }
+
+        if (next != mRangesByStart.begin())
+        {
+            auto prev = std::prev(next);
+            if (prev->second == start)
+            {
+                start = prev->first;
+                mRangesBySize.erase(std::make_pair(prev->second - prev->first, prev->first));
+                mRangesByStart.erase(prev);
+            }
+        }
+
+        // A range ending at the top goes back to the unallocated tail
+        size_t top = end;
+        if (mTop.compare_exchange_strong(top, start))
+            return;
+
+        mRangesByStart[start] = end;
+        mRangesBySize.emplace(end - start, start);
+    }
+
+    void DrainSinglesLocked()
+    {
+        IndexType index;
+        while (PopSingle(index))
+        {
+            InsertRangeLocked(index, index + 1);
+        }
+    }
+
+    size_t ReclaimLocked()
+    {
+        size_t reclaimed = 0;
+
+        for (auto it = mPending.begin(); it != mPending.end(); )
+        {
+            if (it->fence->GetCompletedValue() >= it->fenceValue)
+            {
+                reclaimed += it->end - it->start;
+                InsertRangeLocked(it->start, it->end);
+                it = mPending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        return reclaimed;
+    }
+
+    const size_t                                mCount;
+    const size_t                                mReserve;
+    std::atomic<size_t>                         mTop;
+    std::unique_ptr<std::atomic<uint32_t>[]>    mNext;
+    std::atomic<uint64_t>                       mSingleHead;
+    std::atomic<size_t>                         mSingleCount;
+    std::atomic<size_t>                         mAllocated;
+
+    mutable std::mutex                          mMutex;
+    std::map<IndexType, IndexType>              mRangesByStart;     // start -> end
+    std::set<std::pair<size_t, IndexType>>      mRangesBySize;      // (size, start)
+    std::vector<PendingFree>                    mPending;
+};
+
+void DescriptorPile::Initialize(size_t reserve)
+{
+    if (reserve > 0 && reserve >= Count())
+    {
+        throw std::out_of_range("Reserve descriptor range is too large");
+    }
+
+    pImpl = std::make_unique<Impl>(Count(), reserve);
+}
+
+DescriptorPile::DescriptorPile(DescriptorPile&&) noexcept = default;
+DescriptorPile& DescriptorPile::operator=(DescriptorPile&&) noexcept = default;
+DescriptorPile::~DescriptorPile() = default;
+
 void DescriptorPile::AllocateRange(size_t numDescriptors, _Out_ IndexType& start, _Out_ IndexType& end)
 {
     // make sure we didn't allocate zero
@@ -220,17 +533,43 @@ void DescriptorPile::AllocateRange(size_t numDescriptors, _Out_ IndexType& start
         throw std::invalid_argument("Can't allocate zero descriptors");
     }
 
-    // get the current top
-    start = m_top;
-
-    // increment top with new request
-    m_top += numDescriptors;
-    end = m_top;
+    assert(pImpl != nullptr);
 
     // make sure we have enough room
-    if (m_top > Count())
+    if (!pImpl->TryAllocate(numDescriptors, start))
     {
-        DebugTrace("DescriptorPile has %zu of %zu descriptors; failed request for %zu more\n", start, Count(), numDescriptors);
+        start = end = INVALID_INDEX;
+
+        const auto stats = pImpl->GetStatistics();
+        DebugTrace("DescriptorPile has %zu of %zu descriptors allocated (%zu free in %zu ranges, %zu pending); failed request for %zu more\n",
+            stats.allocated, stats.capacity, stats.free, stats.freeRangeCount, stats.pendingFree, numDescriptors);
         throw std::runtime_error("Can't allocate more descriptors");
     }
+
+    end = start + numDescriptors;
+}
+
+void DescriptorPile::FreeRange(IndexType start, IndexType end)
+{
+    assert(pImpl != nullptr);
+    pImpl->Free(start, end);
+}
+
+_Use_decl_annotations_
+void DescriptorPile::FreeRangeDeferred(IndexType start, IndexType end, ID3D12Fence* fence, uint64_t fenceValue)
+{
+    assert(pImpl != nullptr);
+    pImpl->FreeDeferred(start, end, fence, fenceValue);
+}
+
+size_t DescriptorPile::ReclaimDeferred()
+{
+    assert(pImpl != nullptr);
+    return pImpl->Reclaim();
+}
+
+DescriptorPileStatistics DescriptorPile::GetStatistics() const
+{
+    assert(pImpl != nullptr);
+    return pImpl->GetStatistics();
 }
@@ -13,8 +13,7 @@
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
 #include "DescriptorHeap.h"
-
-#include <mutex>
+#include "ConcurrentCache.h"
 
 
 using namespace DirectX;
@@ -107,15 +106,13 @@ public:
 private:
     ComPtr<ID3D12Device> mDevice;
 
-    using EffectCache = std::map< std::wstring, std::shared_ptr<IEffect> >;
+    using EffectCache = ConcurrentCache< std::shared_ptr<IEffect> >;
 
     EffectCache  mEffectCache;
     EffectCache  mEffectCacheSkinning;
     EffectCache  mEffectCacheDualTexture;
     EffectCache  mEffectCacheNormalMap;
     EffectCache  mEffectCacheNormalMapSkinned;
-
-    std::mutex mutex;
 };
 
 
@@ -166,7 +163,6 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(
     EffectPipelineStateDescription derivedPSD = (info.alphaValue < 1.0f) ? alphaPipelineState : opaquePipelineState;
     derivedPSD.inputLayout = inputLayoutDesc;
 
-    std::wstring cacheName;
     if (info.enableSkinning)
     {
         int effectflags = (mEnablePerPixelLighting) ? EffectFlags::PerPixelLighting : EffectFlags::Lighting;
@@ -189,82 +185,66 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(
                 effectflags |= EffectFlags::Specular;
             }
 
-            if (mSharing && !info.name.empty())
+            auto create = [&]() -> std::shared_ptr<IEffect>
             {
-                const uint32_t hash = derivedPSD.ComputeHash();
-                cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
+                auto effect = std::make_shared<SkinnedNormalMapEffect>(mDevice.Get(), effectflags, derivedPSD);
+
+                SetMaterialProperties(effect.get(), info);
 
-                auto it = mEffectCacheNormalMapSkinned.find(cacheName);
-                if (mSharing && it != mEffectCacheNormalMapSkinned.end())
+                if (diffuseTextureIndex != -1)
                 {
-                    return it->second;
+                    effect->SetTexture(
+                        mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
+                        mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
                 }
-            }
-
-            auto effect = std::make_shared<SkinnedNormalMapEffect>(mDevice.Get(), effectflags, derivedPSD);
-
-            SetMaterialProperties(effect.get(), info);
 
-            if (diffuseTextureIndex != -1)
-            {
-                effect->SetTexture(
-                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
-                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
-            }
+                if (specularTextureIndex != -1)
+                {
+                    effect->SetSpecularTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)));
+                }
 
-            if (specularTextureIndex != -1)
-            {
-                effect->SetSpecularTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)));
-            }
+                if (normalTextureIndex != -1)
+                {
+                    effect->SetNormalTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(normalTextureIndex)));
+                }
 
-            if (normalTextureIndex != -1)
-            {
-                effect->SetNormalTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(normalTextureIndex)));
-            }
+                return std::move(effect);
+            };
 
             if (mSharing && !info.name.empty())
             {
-                std::lock_guard<std::mutex> lock(mutex);
-                EffectCache::value_type v(cacheName, effect);
-                mEffectCacheNormalMapSkinned.insert(v);
+                const EffectCache::Key key(info.name, static_cast<uint32_t>(effectflags), derivedPSD.ComputeHash());
+                return mEffectCacheNormalMapSkinned.GetOrCreate(key, create);
             }
 
-            return std::move(effect);
+            return create();
         }
         else
         {
             // SkinnedEffect
-            if (mSharing && !info.name.empty())
+            auto create = [&]() -> std::shared_ptr<IEffect>
             {
-                const uint32_t hash = derivedPSD.ComputeHash();
-                cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
+                auto effect = std::make_shared<SkinnedEffect>(mDevice.Get(), effectflags, derivedPSD);
 
-                auto it = mEffectCacheSkinning.find(cacheName);
-                if (mSharing && it != mEffectCacheSkinning.end())
+                SetMaterialProperties(effect.get(), info);
+
+                if (diffuseTextureIndex != -1)
                 {
-                    return it->second;
+                    effect->SetTexture(
+                        mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
+                        mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
                 }
-            }
 
-            auto effect = std::make_shared<SkinnedEffect>(mDevice.Get(), effectflags, derivedPSD);
-
-            SetMaterialProperties(effect.get(), info);
-
-            if (diffuseTextureIndex != -1)
-            {
-                effect->SetTexture(
-                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
-                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
-            }
+                return std::move(effect);
+            };
 
             if (mSharing && !info.name.empty())
             {
-                std::lock_guard<std::mutex> lock(mutex);
-                EffectCache::value_type v(cacheName, effect);
-                mEffectCacheSkinning.insert(v);
+                const EffectCache::Key key(info.name, static_cast<uint32_t>(effectflags), derivedPSD.ComputeHash());
+                return mEffectCacheSkinning.GetOrCreate(key, create);
             }
 
-            return std::move(effect);
+            return create();
         }
     }
     else if (info.enableDualTexture)
@@ -277,72 +257,66 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(
             effectflags |= EffectFlags::Fog;
         }
 
-        if (mSharing && !info.name.empty())
-        {
-            const uint32_t hash = derivedPSD.ComputeHash();
-            cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
-
-            auto it = mEffectCacheDualTexture.find(cacheName);
-            if (mSharing && it != mEffectCacheDualTexture.end())
-            {
-                return it->second;
-            }
-        }
+        const uint32_t cacheFlags = static_cast<uint32_t>(effectflags);
 
         if (info.perVertexColor)
         {
             effectflags |= EffectFlags::VertexColor;
         }
 
-        auto effect = std::make_shared<DualTextureEffect>(mDevice.Get(), effectflags, derivedPSD);
-
-        // Dual texture effect doesn't support lighting (usually it's lightmaps)
-        effect->SetAlpha(info.alphaValue);
+        auto create = [&]() -> std::shared_ptr<IEffect>
+        {
+            auto effect = std::make_shared<DualTextureEffect>(mDevice.Get(), effectflags, derivedPSD);
 
-        const XMVECTOR color = XMLoadFloat3(&info.diffuseColor);
-        effect->SetDiffuseColor(color);
+            // Dual texture effect doesn't support lighting (usually it's lightmaps)
+            effect->SetAlpha(info.alphaValue);
 
-        if (diffuseTextureIndex != -1)
-        {
-            effect->SetTexture(
-                mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
-                mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
-        }
+            const XMVECTOR color = XMLoadFloat3(&info.diffuseColor);
+            effect->SetDiffuseColor(color);
 
-        if (emissiveTextureIndex != -1)
-        {
-            if (samplerIndex2 == -1)
+            if (diffuseTextureIndex != -1)
             {
-                DebugTrace("ERROR: Dual-texture requires a second sampler (emissive %d)\n", emissiveTextureIndex);
-                throw std::runtime_error("EffectFactory");
+                effect->SetTexture(
+                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
+                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
             }
 
-            effect->SetTexture2(
-                mTextureDescriptors->GetGpuHandle(static_cast<size_t>(emissiveTextureIndex)),
-                mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex2)));
-        }
-        else if (specularTextureIndex != -1)
-        {
-            // If there's no emissive texture specified, use the specular texture as the second texture
-            if (samplerIndex2 == -1)
+            if (emissiveTextureIndex != -1)
+            {
+                if (samplerIndex2 == -1)
+                {
+                    DebugTrace("ERROR: Dual-texture requires a second sampler (emissive %d)\n", emissiveTextureIndex);
+                    throw std::runtime_error("EffectFactory");
+                }
+
+                effect->SetTexture2(
+                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(emissiveTextureIndex)),
+                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex2)));
+            }
+            else if (specularTextureIndex != -1)
             {
-                DebugTrace("ERROR: Dual-texture requires a second sampler (specular %d)\n", specularTextureIndex);
-                throw std::runtime_error("EffectFactory");
+                // If there's no emissive texture specified, use the specular texture as the second texture
+                if (samplerIndex2 == -1)
+                {
+                    DebugTrace("ERROR: Dual-texture requires a second sampler (specular %d)\n", specularTextureIndex);
+                    throw std::runtime_error("EffectFactory");
+                }
+
+                effect->SetTexture2(
+                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)),
+                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex2)));
             }
 
-            effect->SetTexture2(
-                mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)),
-                mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex2)));
-        }
+            return std::move(effect);
+        };
 
         if (mSharing && !info.name.empty())
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            EffectCache::value_type v(cacheName, effect);
-            mEffectCacheDualTexture.insert(v);
+            const EffectCache::Key key(info.name, cacheFlags, derivedPSD.ComputeHash());
+            return mEffectCacheDualTexture.GetOrCreate(key, create);
         }
 
-        return std::move(effect);
+        return create();
     }
     else if (info.enableNormalMaps && mUseNormalMapEffect)
     {
@@ -374,47 +348,39 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(
             effectflags |= EffectFlags::Specular;
         }
 
-        if (mSharing && !info.name.empty())
+        auto create = [&]() -> std::shared_ptr<IEffect>
         {
-            const uint32_t hash = derivedPSD.ComputeHash();
-            cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
+            auto effect = std::make_shared<NormalMapEffect>(mDevice.Get(), effectflags, derivedPSD);
+
+            SetMaterialProperties(effect.get(), info);
 
-            auto it = mEffectCacheNormalMap.find(cacheName);
-            if (mSharing && it != mEffectCacheNormalMap.end())
+            if (diffuseTextureIndex != -1)
             {
-                return it->second;
+                effect->SetTexture(
+                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
+                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
             }
-        }
-
-        auto effect = std::make_shared<NormalMapEffect>(mDevice.Get(), effectflags, derivedPSD);
 
-        SetMaterialProperties(effect.get(), info);
-
-        if (diffuseTextureIndex != -1)
-        {
-            effect->SetTexture(
-                mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
-                mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
-        }
+            if (specularTextureIndex != -1)
+            {
+                effect->SetSpecularTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)));
+            }
 
-        if (specularTextureIndex != -1)
-        {
-            effect->SetSpecularTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(specularTextureIndex)));
-        }
+            if (normalTextureIndex != -1)
+            {
+                effect->SetNormalTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(normalTextureIndex)));
+            }
 
-        if (normalTextureIndex != -1)
-        {
-            effect->SetNormalTexture(mTextureDescriptors->GetGpuHandle(static_cast<size_t>(normalTextureIndex)));
-        }
+            return std::move(effect);
+        };
 
         if (mSharing && !info.name.empty())
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            EffectCache::value_type v(cacheName, effect);
-            mEffectCacheNormalMap.insert(v);
+            const EffectCache::Key key(info.name, static_cast<uint32_t>(effectflags), derivedPSD.ComputeHash());
+            return mEffectCacheNormalMap.GetOrCreate(key, create);
         }
 
-        return std::move(effect);
+        return create();
     }
     else
     {
@@ -447,48 +413,39 @@ std::shared_ptr<IEffect> EffectFactory::Impl::CreateEffect(
         }
 
         // BasicEffect
-        if (mSharing && !info.name.empty())
+        auto create = [&]() -> std::shared_ptr<IEffect>
         {
-            const uint32_t hash = derivedPSD.ComputeHash();
-            cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
+            auto effect = std::make_shared<BasicEffect>(mDevice.Get(), effectflags, derivedPSD);
 
-            auto it = mEffectCache.find(cacheName);
-            if (mSharing && it != mEffectCache.end())
+            SetMaterialProperties(effect.get(), info);
+
+            if (diffuseTextureIndex != -1)
             {
-                return it->second;
+                effect->SetTexture(
+                    mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
+                    mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
             }
-        }
 
-        auto effect = std::make_shared<BasicEffect>(mDevice.Get(), effectflags, derivedPSD);
-
-        SetMaterialProperties(effect.get(), info);
-
-        if (diffuseTextureIndex != -1)
-        {
-            effect->SetTexture(
-                mTextureDescriptors->GetGpuHandle(static_cast<size_t>(diffuseTextureIndex)),
-                mSamplerDescriptors->GetGpuHandle(static_cast<size_t>(samplerIndex)));
-        }
+            return std::move(effect);
+        };
 
         if (mSharing && !info.name.empty())
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            EffectCache::value_type v(cacheName, effect);
-            mEffectCache.insert(v);
+            const EffectCache::Key key(info.name, static_cast<uint32_t>(effectflags), derivedPSD.ComputeHash());
+            return mEffectCache.GetOrCreate(key, create);
         }
 
-        return std::move(effect);
+        return create();
     }
 }
 
 void EffectFactory::Impl::ReleaseCache()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    mEffectCache.clear();
-    mEffectCacheSkinning.clear();
-    mEffectCacheDualTexture.clear();
-    mEffectCacheNormalMap.clear();
-    mEffectCacheNormalMapSkinned.clear();
+    mEffectCache.Clear();
+    mEffectCacheSkinning.Clear();
+    mEffectCacheDualTexture.Clear();
+    mEffectCacheNormalMap.Clear();
+    mEffectCacheNormalMapSkinned.Clear();
 }
 
 
@@ -16,6 +16,7 @@
 #include "PlatformHelpers.h"
 #include "ResourceUploadBatch.h"
 #include "WICTextureLoader.h"
+#include "ConcurrentCache.h"
 
 #include <mutex>
 
@@ -36,7 +37,7 @@ public:
         TextureCacheEntry() noexcept : mIsCubeMap(false), slot(0) {}
     };
 
-    using TextureCache = std::map< std::wstring, TextureCacheEntry >;
+    using TextureCache = ConcurrentCache< TextureCacheEntry >;
 
     Impl(
         _In_ ID3D12Device* device,
@@ -100,7 +101,7 @@ private:
     bool                           mForceSRGB;
     bool                           mAutoGenMips;
 
-    std::mutex                     mutex;
+    std::mutex                     mutex; // guards mResources
 };
 
 
@@ -110,16 +111,10 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
     if (!name)
         throw std::invalid_argument("name required for CreateTexture");
 
-    auto it = mTextureCache.find(name);
-
-    TextureCacheEntry textureEntry = {};
-
-    if (mSharing && it != mTextureCache.end())
-    {
-        textureEntry = it->second;
-    }
-    else
+    auto create = [&]() -> TextureCacheEntry
     {
+        TextureCacheEntry textureEntry = {};
+
         wchar_t fullName[MAX_PATH] = {};
         wcscpy_s(fullName, mPath);
         wcscat_s(fullName, name);
@@ -192,13 +187,14 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
 
         std::lock_guard<std::mutex> lock(mutex);
         textureEntry.slot = mResources.size();
-        if (mSharing)
-        {
-            TextureCache::value_type v(name, textureEntry);
-            mTextureCache.insert(v);
-        }
         mResources.push_back(textureEntry);
-    }
+
+        return textureEntry;
+    };
+
+    const TextureCacheEntry textureEntry = mSharing
+        ? mTextureCache.GetOrCreate(TextureCache::Key(name, wcslen(name)), create)
+        : create();
 
     assert(textureEntry.mResource != nullptr);
 
@@ -211,8 +207,7 @@ size_t EffectTextureFactory::Impl::CreateTexture(_In_z_ const wchar_t* name, int
 
 void EffectTextureFactory::Impl::ReleaseCache()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    mTextureCache.clear();
+    mTextureCache.Clear();
 }
 
 
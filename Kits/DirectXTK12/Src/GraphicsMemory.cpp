@@ -87,14 +87,159 @@ namespace
         return std::max<size_t>(MinPageSize, size_t(1) << (x + AllocatorIndexShift));
     }
 
+    //--------------------------------------------------------------------------------------
+    // ThreadPageCache : the page each pool last handed to a thread. The thread holds a
+    // reference on these pages, so they cannot be fenced while it bump allocates from them.
+    //--------------------------------------------------------------------------------------
+    struct ThreadPageCache
+    {
+        std::array<LinearAllocatorPage*, AllocatorPoolCount> pages;
+        uint64_t epoch;
+
+        ThreadPageCache() noexcept : pages{}, epoch(0) {}
+
+        void ReleasePages() noexcept
+        {
+            for (auto& page : pages)
+            {
+                if (page)
+                {
+                    page->Release();
+                    page = nullptr;
+                }
+            }
+        }
+    };
+
+    class ThreadPageCacheTable : public std::enable_shared_from_this<ThreadPageCacheTable>
+    {
+    public:
+        ThreadPageCacheTable() noexcept : mEpoch(0) {}
+
+        ThreadPageCacheTable(ThreadPageCacheTable&&) = delete;
+        ThreadPageCacheTable& operator= (ThreadPageCacheTable&&) = delete;
+
+        ThreadPageCacheTable(ThreadPageCacheTable const&) = delete;
+        ThreadPageCacheTable& operator= (ThreadPageCacheTable const&) = delete;
+
+        // Returns the calling thread's cache, creating it on first use
+        ThreadPageCache* GetCache()
+        {
+            auto& entries = GetThreadEntries().entries;
+
+            for (auto it = entries.begin(); it != entries.end(); )
+            {
+                if (it->owner.expired())
+                {
+                    // A destroyed table, which may share its address with this one
+                    it = entries.erase(it);
+                }
+                else if (it->table == this)
+                {
+                    return it->cache;
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            ThreadPageCache* cache = nullptr;
+            {
+                const ScopedLock lock(mMutex);
+
+                if (mFreeCaches.empty())
+                {
+                    mCaches.emplace_back(std::make_unique<ThreadPageCache>());
+                    cache = mCaches.back().get();
+                }
+                else
+                {
+                    cache = mFreeCaches.back();
+                    mFreeCaches.pop_back();
+                }
+            }
+
+            ThreadEntry entry = { this, shared_from_this(), cache };
+            entries.push_back(entry);
+
+            return cache;
+        }
+
+        // Makes every thread drop its cached pages on its next allocation
+        void AdvanceEpoch() noexcept { mEpoch.fetch_add(1); }
+        uint64_t Epoch() const noexcept { return mEpoch.load(); }
+
+        // No thread may be allocating while this is called
+        void ReleaseAll() noexcept
+        {
+            const ScopedLock lock(mMutex);
+
+            for (auto& cache : mCaches)
+            {
+                cache->ReleasePages();
+            }
+        }
+
+    private:
+        struct ThreadEntry
+        {
+            ThreadPageCacheTable*               table;
+            std::weak_ptr<ThreadPageCacheTable> owner;
+            ThreadPageCache*                    cache;
+        };
+
+        // Hands the caches of an exiting thread back to the tables that are still alive
+        struct ThreadEntries
+        {
+            std::vector<ThreadEntry> entries;
+
+            ~ThreadEntries()
+            {
+                for (auto& entry : entries)
+                {
+                    auto table = entry.owner.lock();
+                    if (table)
+                    {
+                        table->ReturnCache(entry.cache);
+                    }
+                }
+            }
+        };
+
+        static ThreadEntries& GetThreadEntries()
+        {
+            static thread_local ThreadEntries s_entries;
+            return s_entries;
+        }
+
+        void ReturnCache(ThreadPageCache* cache) noexcept
+        {
+            const ScopedLock lock(mMutex);
+
+            cache->ReleasePages();
+            cache->epoch = 0;
+            mFreeCaches.push_back(cache);
+        }
+
+        std::atomic<uint64_t>                           mEpoch;
+        std::mutex                                      mMutex;
+        std::vector<std::unique_ptr<ThreadPageCache>>   mCaches;
+        std::vector<ThreadPageCache*>                   mFreeCaches;
+    };
+
     //--------------------------------------------------------------------------------------
     // DeviceAllocator : honors memory requests associated with a particular device
+    //
+    // Allocations smaller than a page are bump allocated from a page cached by the calling
+    // thread, so threads recording in parallel only take the lock to hand over a new page.
     //--------------------------------------------------------------------------------------
     class DeviceAllocator
     {
     public:
         DeviceAllocator(_In_ ID3D12Device* device) noexcept(false)
             : mDevice(device)
+            , mThreadCaches(std::make_shared<ThreadPageCacheTable>())
         {
             if (!device)
                 throw std::invalid_argument("Invalid device parameter");
@@ -117,6 +262,8 @@ namespace
         // Explicitly destroy LinearAllocators inside a critical section
         ~DeviceAllocator()
         {
+            mThreadCaches->ReleaseAll();
+
             const ScopedLock lock(mMutex);
 
             for (auto& allocator : mPools)
@@ -127,35 +274,53 @@ namespace
 
         GraphicsResource Alloc(_In_ size_t size, _In_ size_t alignment)
         {
-            ScopedLock lock(mMutex);
-
             // Which memory pool does it live in?
             const size_t poolSize = NextPow2((alignment + size) * PoolIndexScale);
             const size_t poolIndex = GetPoolIndexFromSize(poolSize);
             assert(poolIndex < mPools.size());
 
-            // If the allocator isn't initialized yet, do so now
             auto& allocator = mPools[poolIndex];
             assert(allocator != nullptr);
             assert(poolSize < MinPageSize || poolSize == allocator->PageSize());
 
-            auto page = allocator->FindPageForAlloc(size, alignment);
-            if (!page)
+            size_t offset = 0;
+
+            if (size >= allocator->PageSize())
             {
-                DebugTrace("GraphicsMemory failed to allocate page (%zu requested bytes, %zu alignment)\n", size, alignment);
-                throw std::bad_alloc();
+                // Whole pages are never cached; the resource must take its reference under the lock
+                ScopedLock lock(mMutex);
+
+                auto page = FindPageAndSuballocate(*allocator, size, alignment, offset);
+                return CreateResource(page, offset, size);
             }
 
-            size_t offset = page->Suballocate(size, alignment);
+            ThreadPageCache* cache = mThreadCaches->GetCache();
 
-            // Return the information to the user
-            return GraphicsResource(
-                page,
-                page->GpuAddress() + offset,
-                page->UploadResource(),
-                static_cast<BYTE*>(page->BaseMemory()) + offset,
-                offset,
-                size);
+            const uint64_t epoch = mThreadCaches->Epoch();
+            if (cache->epoch != epoch)
+            {
+                // Pages cached before the last Commit can now be fenced once their resources are released
+                cache->ReleasePages();
+                cache->epoch = epoch;
+            }
+
+            auto page = cache->pages[poolIndex];
+            if (!page || !page->TrySuballocate(size, alignment, offset))
+            {
+                if (page)
+                {
+                    cache->pages[poolIndex] = nullptr;
+                    page->Release();
+                }
+
+                ScopedLock lock(mMutex);
+
+                page = FindPageAndSuballocate(*allocator, size, alignment, offset);
+                page->AddRef();
+                cache->pages[poolIndex] = page;
+            }
+
+            return CreateResource(page, offset, size);
         }
 
         // Submit page fences to the command queue
@@ -171,6 +336,8 @@ namespace
                     i->FenceCommittedPages(commandQueue);
                 }
             }
+
+            mThreadCaches->AdvanceEpoch();
         }
 
         void GarbageCollect()
@@ -213,9 +380,42 @@ namespace
         ID3D12Device* GetDevice() const noexcept { return mDevice.Get(); }
 
     private:
+        // Must be called with mMutex held. Other threads may be bump allocating from the same
+        // pages, so keep looking until the sub-allocation succeeds; a clean page always does.
+        static LinearAllocatorPage* FindPageAndSuballocate(LinearAllocator& allocator, size_t size, size_t alignment, size_t& offset)
+        {
+            for (;;)
+            {
+                auto page = allocator.FindPageForAlloc(size, alignment);
+                if (!page)
+                {
+                    DebugTrace("GraphicsMemory failed to allocate page (%zu requested bytes, %zu alignment)\n", size, alignment);
+                    throw std::bad_alloc();
+                }
+
+                if (page->TrySuballocate(size, alignment, offset))
+                {
+                    return page;
+                }
+            }
+        }
+
+        static GraphicsResource CreateResource(LinearAllocatorPage* page, size_t offset, size_t size)
+        {
+            // Return the information to the user
+            return GraphicsResource(
+                page,
+                page->GpuAddress() + offset,
+                page->UploadResource(),
+                static_cast<BYTE*>(page->BaseMemory()) + offset,
+                offset,
+                size);
+        }
+
         ComPtr<ID3D12Device> mDevice;
         std::array<std::unique_ptr<LinearAllocator>, AllocatorPoolCount> mPools;
         mutable std::mutex mMutex;
+        std::shared_ptr<ThreadPageCacheTable> mThreadCaches;
     };
 
 #ifdef USING_PIX_CUSTOM_MEMORY_EVENTS
@@ -35,17 +35,30 @@ LinearAllocatorPage::LinearAllocatorPage() noexcept
 
 size_t LinearAllocatorPage::Suballocate(_In_ size_t size, _In_ size_t alignment)
 {
-    const size_t offset = AlignUp(mOffset, alignment);
-    if (offset + size > mSize)
+    size_t offset = 0;
+    if (!TrySuballocate(size, alignment, offset))
     {
         // Use of suballocate should be limited to pages with free space,
         // so really shouldn't happen.
         throw std::runtime_error("LinearAllocatorPage::Suballocate");
     }
-    mOffset = offset + size;
     return offset;
 }
 
+bool LinearAllocatorPage::TrySuballocate(_In_ size_t size, _In_ size_t alignment, _Out_ size_t& offset) noexcept
+{
+    size_t current = mOffset.load(std::memory_order_relaxed);
+    do
+    {
+        offset = AlignUp(current, alignment);
+        if (offset + size > mSize)
+            return false;
+    }
+    while (!mOffset.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+    return true;
+}
+
 void LinearAllocatorPage::Release() noexcept
 {
     assert(mRefCount > 0);
@@ -275,7 +288,7 @@ LinearAllocatorPage* LinearAllocator::FindPageForAlloc(
 {
     for (auto page = list; page != nullptr; page = page->pNextPage)
     {
-        const size_t offset = AlignUp(page->mOffset, alignment);
+        const size_t offset = AlignUp(page->mOffset.load(), alignment);
         if (offset + sizeBytes <= m_increment)
             return page;
     }
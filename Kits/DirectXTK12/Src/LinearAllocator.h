@@ -15,7 +15,9 @@
 // preallocate two pages by default.
 //
 // This class is NOT thread safe. You should protect this with the appropriate sync
-// primitives or, even better, use one linear allocator per thread.
+// primitives or, even better, use one linear allocator per thread. Pages themselves can
+// be sub-allocated from several threads at once with TrySuballocate, as long as each
+// thread holds a reference on the page.
 //
 // Pages are freed once the GPU is done with them. As such, you need to specify when a
 // page is in use and when it is no longer in use. Use RetirePages to prompt the
@@ -60,10 +62,13 @@ namespace DirectX
 
         size_t Suballocate(_In_ size_t size, _In_ size_t alignment);
 
+        // Lock-free bump allocation; returns false if the page does not have enough space left.
+        bool TrySuballocate(_In_ size_t size, _In_ size_t alignment, _Out_ size_t& offset) noexcept;
+
         void* BaseMemory() const noexcept { return mMemory; }
         ID3D12Resource* UploadResource() const noexcept { return mUploadResource.Get(); }
         D3D12_GPU_VIRTUAL_ADDRESS GpuAddress() const noexcept { return mGpuAddress; }
-        size_t BytesUsed() const noexcept { return mOffset; }
+        size_t BytesUsed() const noexcept { return mOffset.load(); }
         size_t Size() const noexcept { return mSize; }
 
         void AddRef() noexcept { mRefCount.fetch_add(1); }
@@ -79,7 +84,7 @@ namespace DirectX
         void*                                   mMemory;
         uint64_t                                mPendingFence;
         D3D12_GPU_VIRTUAL_ADDRESS               mGpuAddress;
-        size_t                                  mOffset;
+        std::atomic<size_t>                     mOffset;
         size_t                                  mSize;
         Microsoft::WRL::ComPtr<ID3D12Resource>  mUploadResource;
 
@@ -13,8 +13,7 @@
 #include "DirectXHelpers.h"
 #include "PlatformHelpers.h"
 #include "DescriptorHeap.h"
-
-#include <mutex>
+#include "ConcurrentCache.h"
 
 
 using namespace DirectX;
@@ -122,12 +121,10 @@ public:
 private:
     ComPtr<ID3D12Device> mDevice;
 
-    using EffectCache = std::map< std::wstring, std::shared_ptr<IEffect> >;
+    using EffectCache = ConcurrentCache< std::shared_ptr<IEffect> >;
 
     EffectCache  mEffectCache;
     EffectCache  mEffectCacheSkinning;
-
-    std::mutex mutex;
 };
 
 
@@ -172,33 +169,24 @@ std::shared_ptr<IEffect> PBREffectFactory::Impl::CreateEffect(
     if (info.enableSkinning)
     {
         // SkinnedPBREffect
-        std::wstring cacheName;
-        if (mSharing && !info.name.empty())
+            auto create = [&]() -> std::shared_ptr<IEffect>
         {
-            const uint32_t hash = derivedPSD.ComputeHash();
-            cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
-
-            auto it = mEffectCacheSkinning.find(cacheName);
-            if (mSharing && it != mEffectCacheSkinning.end())
-            {
-                return it->second;
-            }
-        }
+            auto effect = std::make_shared<SkinnedPBREffect>(mDevice.Get(), effectflags, derivedPSD);
 
-        auto effect = std::make_shared<SkinnedPBREffect>(mDevice.Get(), effectflags, derivedPSD);
+            SetPBRProperties(effect.get(), info,
+                mTextureDescriptors.get(), textureDescriptorOffset,
+                mSamplerDescriptors.get(), samplerDescriptorOffset);
 
-        SetPBRProperties(effect.get(), info,
-            mTextureDescriptors.get(), textureDescriptorOffset,
-            mSamplerDescriptors.get(), samplerDescriptorOffset);
+            return std::move(effect);
+        };
 
         if (mSharing && !info.name.empty())
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            EffectCache::value_type v(cacheName, effect);
-            mEffectCacheSkinning.insert(v);
+            const EffectCache::Key key(info.name, effectflags, derivedPSD.ComputeHash());
+            return mEffectCacheSkinning.GetOrCreate(key, create);
         }
 
-        return std::move(effect);
+        return create();
     }
     else
     {
@@ -208,41 +196,31 @@ std::shared_ptr<IEffect> PBREffectFactory::Impl::CreateEffect(
             effectflags |= EffectFlags::Instancing;
         }
 
-        std::wstring cacheName;
-        if (mSharing && !info.name.empty())
+            auto create = [&]() -> std::shared_ptr<IEffect>
         {
-            const uint32_t hash = derivedPSD.ComputeHash();
-            cacheName = std::to_wstring(effectflags) + info.name + std::to_wstring(hash);
-
-            auto it = mEffectCache.find(cacheName);
-            if (mSharing && it != mEffectCache.end())
-            {
-                return it->second;
-            }
-        }
+            auto effect = std::make_shared<PBREffect>(mDevice.Get(), effectflags, derivedPSD);
 
-        auto effect = std::make_shared<PBREffect>(mDevice.Get(), effectflags, derivedPSD);
+            SetPBRProperties(effect.get(), info,
+                mTextureDescriptors.get(), textureDescriptorOffset,
+                mSamplerDescriptors.get(), samplerDescriptorOffset);
 
-        SetPBRProperties(effect.get(), info,
-            mTextureDescriptors.get(), textureDescriptorOffset,
-            mSamplerDescriptors.get(), samplerDescriptorOffset);
+            return std::move(effect);
+        };
 
         if (mSharing && !info.name.empty())
         {
-            std::lock_guard<std::mutex> lock(mutex);
-            EffectCache::value_type v(cacheName, effect);
-            mEffectCache.insert(v);
+            const EffectCache::Key key(info.name, effectflags, derivedPSD.ComputeHash());
+            return mEffectCache.GetOrCreate(key, create);
         }
 
-        return std::move(effect);
+        return create();
     }
 }
 
 void PBREffectFactory::Impl::ReleaseCache()
 {
-    std::lock_guard<std::mutex> lock(mutex);
-    mEffectCache.clear();
-    mEffectCacheSkinning.clear();
+    mEffectCache.Clear();
+    mEffectCacheSkinning.Clear();
 }
 
 
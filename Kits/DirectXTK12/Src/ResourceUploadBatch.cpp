@@ -296,6 +296,251 @@ namespace
             return pso;
         }
     };
+
+    // Everything that has to stay alive until the GPU has finished executing an upload batch.
+    struct UploadBatch
+    {
+        std::vector<ComPtr<ID3D12DeviceChild>>  TrackedObjects;
+        std::vector<SharedGraphicsResource>     TrackedMemoryResources;
+        ComPtr<ID3D12GraphicsCommandList>       CommandList;
+        ComPtr<ID3D12Fence>                     Fence;
+        uint64_t                                FenceValue;
+        HANDLE                                  GpuCompleteEvent;
+        std::promise<void>                      Completed;
+        std::function<void(HRESULT)>            OnComplete;
+
+        UploadBatch() noexcept : FenceValue(0), GpuCompleteEvent(nullptr) {}
+    };
+
+    // A single worker thread shared by every ResourceUploadBatch in the process. It waits on the
+    // completion events of all pending batches at once, then releases every batch whose fence has
+    // been reached together before fulfilling their futures and callbacks.
+    //
+    // The thread is started on demand and exits after it has been idle for a while, so a title
+    // that only uploads at load time does not keep it around.
+    class UploadCompletionReactor : public std::enable_shared_from_this<UploadCompletionReactor>
+    {
+    public:
+        UploadCompletionReactor() noexcept(false)
+            : mThreadRunning(false)
+        {
+            mWakeEvent.reset(CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE));
+            if (!mWakeEvent)
+                throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+        }
+
+        UploadCompletionReactor(const UploadCompletionReactor&) = delete;
+        UploadCompletionReactor& operator=(const UploadCompletionReactor&) = delete;
+
+        static std::shared_ptr<UploadCompletionReactor> Get()
+        {
+            static std::shared_ptr<UploadCompletionReactor> s_reactor = std::make_shared<UploadCompletionReactor>();
+            return s_reactor;
+        }
+
+        void Submit(std::unique_ptr<UploadBatch> batch)
+        {
+            assert(batch && batch->Fence);
+
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            if (!mThreadRunning)
+            {
+                // The thread holds a reference to the reactor, so it can finish any pending work
+                // even if this is the last ResourceUploadBatch to go away.
+                std::thread worker(&UploadCompletionReactor::Run, shared_from_this());
+                worker.detach();
+                mThreadRunning = true;
+            }
+
+            HANDLE gpuCompletedEvent = nullptr;
+            if (!mFreeEvents.empty())
+            {
+                gpuCompletedEvent = mFreeEvents.back().release();
+                mFreeEvents.pop_back();
+            }
+            else
+            {
+                gpuCompletedEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE);
+                if (!gpuCompletedEvent)
+                    throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+            }
+
+            const HRESULT hr = batch->Fence->SetEventOnCompletion(batch->FenceValue, gpuCompletedEvent);
+            if (FAILED(hr))
+            {
+                mFreeEvents.emplace_back(gpuCompletedEvent);
+                throw com_exception(hr);
+            }
+
+            batch->GpuCompleteEvent = gpuCompletedEvent;
+            mPending.emplace_back(std::move(batch));
+
+            std::ignore = SetEvent(mWakeEvent.get());
+        }
+
+    private:
+        // How long the worker waits for new batches before exiting.
+        static constexpr DWORD IdleTimeoutMilliseconds = 1000;
+
+        // How long the worker waits on one set of events when there are too many fences to wait on at once.
+        static constexpr DWORD RotateTimeoutMilliseconds = 1;
+
+        using UploadBatchList = std::vector<std::unique_ptr<UploadBatch>>;
+
+        void Run()
+        {
+            std::vector<HANDLE> handles;
+            handles.reserve(MAXIMUM_WAIT_OBJECTS);
+
+            std::vector<ID3D12Fence*> fences;
+            std::vector<HANDLE> oldest;
+            size_t rotation = 0;
+
+            UploadBatchList retired;
+
+            bool idle = false;
+            for (;;)
+            {
+                DWORD timeout = INFINITE;
+
+                handles.clear();
+                handles.push_back(mWakeEvent.get());
+
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+
+                    if (mPending.empty())
+                    {
+                        if (idle)
+                        {
+                            mThreadRunning = false;
+                            return;
+                        }
+
+                        idle = true;
+                        timeout = IdleTimeoutMilliseconds;
+                    }
+                    else
+                    {
+                        // Batches that share a fence complete in order, so waiting on the oldest pending
+                        // batch of each fence is enough. Any batch signaled meanwhile is found by the fence
+                        // scan below.
+                        idle = false;
+
+                        fences.clear();
+                        oldest.clear();
+                        for (const auto& batch : mPending)
+                        {
+                            if (std::find(fences.cbegin(), fences.cend(), batch->Fence.Get()) == fences.cend())
+                            {
+                                fences.push_back(batch->Fence.Get());
+                                oldest.push_back(batch->GpuCompleteEvent);
+                            }
+                        }
+
+                        if (oldest.size() < MAXIMUM_WAIT_OBJECTS)
+                        {
+                            handles.insert(handles.end(), oldest.cbegin(), oldest.cend());
+                        }
+                        else
+                        {
+                            // More fences than one wait can take, so take turns waiting on each set of them
+                            rotation %= oldest.size();
+                            for (size_t j = 0; j < MAXIMUM_WAIT_OBJECTS - 1; ++j)
+                            {
+                                handles.push_back(oldest[(rotation + j) % oldest.size()]);
+                            }
+                            rotation += MAXIMUM_WAIT_OBJECTS - 1;
+                            timeout = RotateTimeoutMilliseconds;
+                        }
+                    }
+                }
+
+                const DWORD wr = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, timeout);
+                if (wr == WAIT_TIMEOUT)
+                    continue;
+
+                if (wr == WAIT_FAILED)
+                {
+                    FailPending(GetLastError());
+                    continue;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mMutex);
+
+                    auto it = std::stable_partition(mPending.begin(), mPending.end(),
+                        [](const std::unique_ptr<UploadBatch>& batch)
+                        {
+                            return batch->Fence->GetCompletedValue() < batch->FenceValue;
+                        });
+
+                    for (auto retire = it; retire != mPending.end(); ++retire)
+                    {
+                        // Recycle the event for a later batch
+                        std::ignore = ResetEvent((*retire)->GpuCompleteEvent);
+                        mFreeEvents.emplace_back((*retire)->GpuCompleteEvent);
+                        (*retire)->GpuCompleteEvent = nullptr;
+
+                        retired.emplace_back(std::move(*retire));
+                    }
+
+                    mPending.erase(it, mPending.end());
+                }
+
+                // Release the tracked resources of every completed batch before any waiter is woken,
+                // so a caller never observes a completed upload that still holds its memory.
+                for (auto& batch : retired)
+                {
+                    batch->TrackedObjects.clear();
+                    batch->TrackedMemoryResources.clear();
+                    batch->CommandList.Reset();
+                    batch->Fence.Reset();
+                }
+
+                for (auto& batch : retired)
+                {
+                    if (batch->OnComplete)
+                        batch->OnComplete(S_OK);
+
+                    batch->Completed.set_value();
+                }
+
+                retired.clear();
+            }
+        }
+
+        void FailPending(DWORD error)
+        {
+            DebugTrace("ERROR: ResourceUploadBatch failed waiting for GPU completion (%08X)\n", static_cast<unsigned int>(error));
+
+            UploadBatchList failed;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                std::swap(failed, mPending);
+            }
+
+            const std::system_error ex(std::error_code(static_cast<int>(error), std::system_category()), "WaitForMultipleObjects");
+
+            for (auto& batch : failed)
+            {
+                if (batch->OnComplete)
+                    batch->OnComplete(HRESULT_FROM_WIN32(error));
+
+                batch->Completed.set_exception(std::make_exception_ptr(ex));
+
+                // The GPU may still be using these resources, so they are intentionally leaked.
+                std::ignore = batch.release();
+            }
+        }
+
+        std::mutex                  mMutex;
+        UploadBatchList             mPending;
+        std::vector<ScopedHandle>   mFreeEvents;
+        ScopedHandle                mWakeEvent;
+        bool                        mThreadRunning;
+    };
 } // anonymous namespace
 
 class ResourceUploadBatch::Impl
@@ -304,6 +549,8 @@ public:
     Impl(
         _In_ ID3D12Device* device)
         : mDevice(device)
+        , mFenceQueue(nullptr)
+        , mFenceValue(0)
         , mCommandType(D3D12_COMMAND_LIST_TYPE_DIRECT)
         , mInBeginEndBlock(false)
         , mTypedUAVLoadAdditionalFormats(false)
@@ -321,6 +568,8 @@ public:
             mTypedUAVLoadAdditionalFormats = options.TypedUAVLoadAdditionalFormats != 0;
             mStandardSwizzle64KBSupported = options.StandardSwizzle64KBSupported != 0;
         }
+
+        mReactor = UploadCompletionReactor::Get();
     }
 
     Impl(const Impl&) = delete;
@@ -553,9 +802,11 @@ public:
 
     // Submits all the uploads to the driver.
     // No more uploads can happen after this call until Begin is called again.
-    // This returns a handle to an event that can be waited on.
+    // This returns a future that is satisfied once the GPU has finished the uploads, and
+    // optionally calls onComplete from the completion thread at the same point.
     std::future<void> End(
-        _In_ ID3D12CommandQueue* commandQueue)
+        _In_ ID3D12CommandQueue* commandQueue,
+        std::function<void(HRESULT)> onComplete)
     {
         if (!mInBeginEndBlock)
             throw std::logic_error("ResourceUploadBatch already closed.");
@@ -568,52 +819,38 @@ public:
         // Submit the job to the GPU
         commandQueue->ExecuteCommandLists(1, CommandListCast(mList.GetAddressOf()));
 
-        // Set an event so we get notified when the GPU has completed all its work
-        ComPtr<ID3D12Fence> fence;
-        ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(fence.GetAddressOf())));
+        // Signal a fence so we get notified when the GPU has completed all its work. The fence is
+        // reused while uploads go to the same queue, as signals from one queue can't complete out of order.
+        if (!mFence || mFenceQueue != commandQueue)
+        {
+            ComPtr<ID3D12Fence> fence;
+            ThrowIfFailed(mDevice->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(fence.GetAddressOf())));
 
-        SetDebugObjectName(fence.Get(), L"ResourceUploadBatch");
+            SetDebugObjectName(fence.Get(), L"ResourceUploadBatch");
 
-        HANDLE gpuCompletedEvent = CreateEventEx(nullptr, nullptr, 0, EVENT_MODIFY_STATE | SYNCHRONIZE);
-        if (!gpuCompletedEvent)
-            throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
+            mFence.Swap(fence);
+            mFenceQueue = commandQueue;
+            mFenceValue = 0;
+        }
 
-        ThrowIfFailed(commandQueue->Signal(fence.Get(), 1ULL));
-        ThrowIfFailed(fence->SetEventOnCompletion(1ULL, gpuCompletedEvent));
+        ThrowIfFailed(commandQueue->Signal(mFence.Get(), mFenceValue + 1));
+        ++mFenceValue;
 
-        // Create a packet of data that'll be passed to our waiting upload thread
-        auto uploadBatch = new UploadBatch();
+        // Create a packet of data that'll be passed to the completion thread
+        auto uploadBatch = std::make_unique<UploadBatch>();
         uploadBatch->CommandList = mList;
-        uploadBatch->Fence = fence;
-        uploadBatch->GpuCompleteEvent.reset(gpuCompletedEvent);
+        uploadBatch->Fence = mFence;
+        uploadBatch->FenceValue = mFenceValue;
+        uploadBatch->OnComplete = std::move(onComplete);
         std::swap(mTrackedObjects, uploadBatch->TrackedObjects);
         std::swap(mTrackedMemoryResources, uploadBatch->TrackedMemoryResources);
 
-        // Kick off a thread that waits for the upload to complete on the GPU timeline.
-        // Let the thread run autonomously, but provide a future the user can wait on.
-        std::future<void> future = std::async(std::launch::async, [uploadBatch]()
-            {
-                // Wait on the GPU-complete notification
-                const DWORD wr = WaitForSingleObject(uploadBatch->GpuCompleteEvent.get(), INFINITE);
-                if (wr != WAIT_OBJECT_0)
-                {
-                    if (wr == WAIT_FAILED)
-                    {
-                        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "WaitForSingleObject");
-                    }
-                    else
-                    {
-                        throw std::runtime_error("WaitForSingleObject");
-                    }
-                }
+        std::future<void> future = uploadBatch->Completed.get_future();
 
-                // Delete the batch
-                // Because the vectors contain smart-pointers, their destructors will
-                // fire and the resources will be released.
-                delete uploadBatch;
-            });
+        // Hand the batch to the shared completion thread, which releases it once the fence is reached.
+        mReactor->Submit(std::move(uploadBatch));
 
-            // Reset our state
+        // Reset our state
         mCommandType = D3D12_COMMAND_LIST_TYPE_DIRECT;
         mInBeginEndBlock = false;
         mList.Reset();
@@ -626,6 +863,15 @@ public:
         return future;
     }
 
+    // Non-blocking check of whether the GPU has finished the most recently submitted batch.
+    bool IsComplete() const noexcept
+    {
+        if (!mFence)
+            return true;
+
+        return mFence->GetCompletedValue() >= mFenceValue;
+    }
+
     bool IsSupportedForGenerateMips(DXGI_FORMAT format) noexcept
     {
         if (mCommandType == D3D12_COMMAND_LIST_TYPE_COPY)
@@ -1058,21 +1304,16 @@ private:
         mTrackedObjects.push_back(resource);
     }
 
-    struct UploadBatch
-    {
-        std::vector<ComPtr<ID3D12DeviceChild>>  TrackedObjects;
-        std::vector<SharedGraphicsResource>     TrackedMemoryResources;
-        ComPtr<ID3D12GraphicsCommandList>       CommandList;
-        ComPtr<ID3D12Fence>                     Fence;
-        ScopedHandle                            GpuCompleteEvent;
-
-        UploadBatch() noexcept {}
-    };
-
     ComPtr<ID3D12Device>                        mDevice;
     ComPtr<ID3D12CommandAllocator>              mCmdAlloc;
     ComPtr<ID3D12GraphicsCommandList>           mList;
     std::unique_ptr<GenerateMipsResources>      mGenMipsResources;
+    std::shared_ptr<UploadCompletionReactor>    mReactor;
+
+    // Signaled with an increasing value by each End on the same queue
+    ComPtr<ID3D12Fence>                         mFence;
+    ID3D12CommandQueue*                         mFenceQueue;
+    uint64_t                                    mFenceValue;
 
     std::vector<ComPtr<ID3D12DeviceChild>>      mTrackedObjects;
     std::vector<SharedGraphicsResource>         mTrackedMemoryResources;
@@ -1142,7 +1383,22 @@ void ResourceUploadBatch::Transition(
 
 std::future<void> ResourceUploadBatch::End(_In_ ID3D12CommandQueue* commandQueue)
 {
-    return pImpl->End(commandQueue);
+    return pImpl->End(commandQueue, nullptr);
+}
+
+
+_Use_decl_annotations_
+void ResourceUploadBatch::End(
+    ID3D12CommandQueue* commandQueue,
+    std::function<void(HRESULT)> onComplete)
+{
+    std::ignore = pImpl->End(commandQueue, std::move(onComplete));
+}
+
+
+bool ResourceUploadBatch::IsComplete() const noexcept
+{
+    return pImpl->IsComplete();
 }
 
 
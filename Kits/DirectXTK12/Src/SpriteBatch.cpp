@@ -17,6 +17,7 @@
 #include "PlatformHelpers.h"
 #include "ResourceUploadBatch.h"
 #include "SharedResourcePool.h"
+#include "SpriteQueue.h"
 #include "VertexTypes.h"
 
 using namespace DirectX;
@@ -51,10 +52,6 @@ namespace
     {
         return a.ptr != b.ptr;
     }
-    inline bool operator < (D3D12_GPU_DESCRIPTOR_HANDLE a, D3D12_GPU_DESCRIPTOR_HANDLE b) noexcept
-    {
-        return a.ptr < b.ptr;
-    }
 
     // Helper converts a RECT to XMVECTOR.
     inline XMVECTOR LoadRect(_In_ RECT const* rect) noexcept
@@ -126,11 +123,9 @@ public:
 
 private:
     // Implementation helper methods.
-    void GrowSpriteQueue();
     void PrepareForRendering();
     void FlushBatch();
     void SortSprites();
-    void GrowSortedSprites();
 
     void RenderBatch(
         D3D12_GPU_DESCRIPTOR_HANDLE texture,
@@ -148,7 +143,6 @@ private:
     // Constants.
     static constexpr size_t MaxBatchSize = 2048;
     static constexpr size_t MinBatchSize = 128;
-    static constexpr size_t InitialQueueSize = 64;
     static constexpr size_t VerticesPerSprite = 4;
     static constexpr size_t IndicesPerSprite = 6;
 
@@ -162,18 +156,18 @@ private:
     static const D3D12_INPUT_LAYOUT_DESC s_DefaultInputLayoutDesc;
 
 
-    // Queue of sprites waiting to be drawn.
-    std::unique_ptr<SpriteInfo[]> mSpriteQueue;
-
-    size_t mSpriteQueueCount;
-    size_t mSpriteQueueArraySize;
+    // Queues of sprites waiting to be drawn, one per thread that has called Draw since Begin.
+    // The queues are chunked, so growing them never moves a sprite that is already queued.
+    PerThreadQueues<SpriteInfo> mSpriteQueues;
 
 
     // To avoid needlessly copying around bulky SpriteInfo structures, we leave that
-    // actual data alone and just sort this array of pointers instead. But we want contiguous
-    // memory for cache efficiency, so these pointers are just shortcuts into the single
-    // mSpriteQueue array, and we take care to keep them in order when sorting is disabled.
+    // actual data alone and just sort this array of pointers into the queues instead.
+    // Sorting radix sorts packed keys, and then permutes these pointers via the scratch array.
     std::vector<SpriteInfo const*> mSortedSprites;
+    std::vector<SpriteInfo const*> mSortedSpritesScratch;
+    std::vector<SortKeyIndex> mSortKeys;
+    std::vector<SortKeyIndex> mSortKeysScratch;
 
 
     // Mode settings from the last Begin call.
@@ -436,8 +430,6 @@ SpriteBatch::Impl::Impl(ID3D12Device* device,
     mSetViewport(false),
     mViewPort{},
     mSampler{},
-    mSpriteQueueCount(0),
-    mSpriteQueueArraySize(0),
     mInBeginEndPair(false),
     mSortMode(SpriteSortMode_Deferred),
     mTransformMatrix(MatrixIdentity),
@@ -530,6 +522,8 @@ void XM_CALLCONV SpriteBatch::Impl::Begin(
     mCommandList = commandList;
     mSpriteCount = 0;
 
+    mSpriteQueues.Reset();
+
     if (sortMode == SpriteSortMode_Immediate)
     {
         PrepareForRendering();
@@ -582,13 +576,12 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(D3D12_GPU_DESCRIPTOR_HANDLE texture,
     if (!texture.ptr)
         throw std::invalid_argument("Invalid texture for Draw");
 
-    // Get a pointer to the output sprite.
-    if (mSpriteQueueCount >= mSpriteQueueArraySize)
-    {
-        GrowSpriteQueue();
-    }
-
-    SpriteInfo* sprite = &mSpriteQueue[mSpriteQueueCount];
+    // Get a pointer to the output sprite. In immediate mode it is drawn straight away, so it
+    // doesn't need to be queued.
+    SpriteInfo immediateSprite;
+    SpriteInfo* sprite = (mSortMode == SpriteSortMode_Immediate)
+        ? &immediateSprite
+        : mSpriteQueues.Local().Append();
 
     XMVECTOR dest = destination;
 
@@ -632,35 +625,6 @@ void XM_CALLCONV SpriteBatch::Impl::Draw(D3D12_GPU_DESCRIPTOR_HANDLE texture,
         // If we are in immediate mode, draw this sprite straight away.
         RenderBatch(texture, textureSizeV, &sprite, 1);
     }
-    else
-    {
-        // Queue this sprite for later sorting and batched rendering.
-        mSpriteQueueCount++;
-    }
-}
-
-
-// Dynamically expands the array used to store pending sprite information.
-void SpriteBatch::Impl::GrowSpriteQueue()
-{
-    // Grow by a factor of 2.
-    const size_t newSize = std::max(InitialQueueSize, mSpriteQueueArraySize * 2);
-
-    // Allocate the new array.
-    auto newArray = std::make_unique<SpriteInfo[]>(newSize);
-
-    // Copy over any existing sprites.
-    for (size_t i = 0; i < mSpriteQueueCount; i++)
-    {
-        newArray[i] = mSpriteQueue[i];
-    }
-
-    // Replace the previous array with the new one.
-    mSpriteQueue = std::move(newArray);
-    mSpriteQueueArraySize = newSize;
-
-    // Clear any dangling SpriteInfo pointers left over from previous rendering.
-    mSortedSprites.clear();
 }
 
 
@@ -692,7 +656,15 @@ void SpriteBatch::Impl::PrepareForRendering()
 // Sends queued sprites to the graphics device.
 void SpriteBatch::Impl::FlushBatch()
 {
-    if (!mSpriteQueueCount)
+    // Merge the per-thread queues, in the order the threads first drew into them.
+    mSortedSprites.clear();
+    mSpriteQueues.ForEach([this](const ChunkedQueue<SpriteInfo>& queue)
+        {
+            queue.Gather(mSortedSprites);
+        });
+
+    const size_t spriteQueueCount = mSortedSprites.size();
+    if (!spriteQueueCount)
         return;
 
     SortSprites();
@@ -702,7 +674,7 @@ void SpriteBatch::Impl::FlushBatch()
     XMVECTOR batchTextureSize = {};
     size_t batchStart = 0;
 
-    for (size_t pos = 0; pos < mSpriteQueueCount; pos++)
+    for (size_t pos = 0; pos < spriteQueueCount; pos++)
     {
         const D3D12_GPU_DESCRIPTOR_HANDLE texture = mSortedSprites[pos]->texture;
         assert(texture.ptr != 0);
@@ -723,79 +695,68 @@ void SpriteBatch::Impl::FlushBatch()
     }
 
     // Flush the final batch.
-    RenderBatch(batchTexture, batchTextureSize, &mSortedSprites[batchStart], mSpriteQueueCount - batchStart);
-
-    // Reset the queue.
-    mSpriteQueueCount = 0;
+    RenderBatch(batchTexture, batchTextureSize, &mSortedSprites[batchStart], spriteQueueCount - batchStart);
 
-    // When sorting is disabled, we persist mSortedSprites data from one batch to the next, to avoid
-    // uneccessary work in GrowSortedSprites. But we never reuse these when sorting, because re-sorting
-    // previously sorted items gives unstable ordering if some sprites have identical sort keys.
-    if (mSortMode != SpriteSortMode_Deferred)
-    {
-        mSortedSprites.clear();
-    }
+    // Reset the queues, keeping their memory for the next batch.
+    mSpriteQueues.Reset();
 }
 
 
 // Sorts the array of queued sprites.
 void SpriteBatch::Impl::SortSprites()
 {
-    // Fill the mSortedSprites vector.
-    if (mSortedSprites.size() < mSpriteQueueCount)
+    const size_t count = mSortedSprites.size();
+
+    if (mSortMode != SpriteSortMode_Texture
+        && mSortMode != SpriteSortMode_BackToFront
+        && mSortMode != SpriteSortMode_FrontToBack)
     {
-        GrowSortedSprites();
+        return;
     }
 
-    switch (mSortMode)
-    {
-    case SpriteSortMode_Texture:
-        // Sort by texture.
-        std::sort(mSortedSprites.begin(),
-            mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-            [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-            {
-                return x->texture < y->texture;
-            });
-        break;
-
-    case SpriteSortMode_BackToFront:
-        // Sort back to front.
-        std::sort(mSortedSprites.begin(),
-            mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-            [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-            {
-                return x->originRotationDepth.w > y->originRotationDepth.w;
-            });
-        break;
-
-    case SpriteSortMode_FrontToBack:
-        // Sort front to back.
-        std::sort(mSortedSprites.begin(),
-            mSortedSprites.begin() + static_cast<int>(mSpriteQueueCount),
-            [](SpriteInfo const* x, SpriteInfo const* y) noexcept -> bool
-            {
-                return x->originRotationDepth.w < y->originRotationDepth.w;
-            });
-        break;
+    if (count > UINT32_MAX)
+        throw std::overflow_error("Too many sprites to sort");
 
-    default:
-        break;
-    }
-}
+    mSortKeys.resize(count);
+    mSortKeysScratch.resize(count);
 
+    for (size_t i = 0; i < count; i++)
+    {
+        SpriteInfo const* sprite = mSortedSprites[i];
+        uint64_t key;
 
-// Populates the mSortedSprites vector with pointers to individual elements of the mSpriteQueue array.
-void SpriteBatch::Impl::GrowSortedSprites()
-{
-    const size_t previousSize = mSortedSprites.size();
+        switch (mSortMode)
+        {
+        case SpriteSortMode_Texture:
+            // Sort by texture.
+            key = sprite->texture.ptr;
+            break;
+
+        case SpriteSortMode_BackToFront:
+            // Sort back to front.
+            key = ~FloatToSortKey(sprite->originRotationDepth.w);
+            break;
+
+        default:
+            // Sort front to back.
+            key = FloatToSortKey(sprite->originRotationDepth.w);
+            break;
+        }
 
-    mSortedSprites.resize(mSpriteQueueCount);
+        mSortKeys[i].key = key;
+        mSortKeys[i].index = static_cast<uint32_t>(i);
+    }
 
-    for (size_t i = previousSize; i < mSpriteQueueCount; i++)
+    // The sort is stable, so sprites with equal keys keep the order they were drawn in.
+    SortKeyIndex const* sortedKeys = RadixSort(mSortKeys.data(), mSortKeysScratch.data(), count);
+
+    mSortedSpritesScratch.resize(count);
+    for (size_t i = 0; i < count; i++)
     {
-        mSortedSprites[i] = &mSpriteQueue[i];
+        mSortedSpritesScratch[i] = mSortedSprites[sortedKeys[i].index];
     }
+
+    std::swap(mSortedSprites, mSortedSpritesScratch);
 }
 
 
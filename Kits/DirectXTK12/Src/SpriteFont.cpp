@@ -45,13 +45,19 @@ public:
     Impl(Impl&&) = default;
     Impl& operator=(Impl&&) = default;
 
+    static constexpr uint32_t NoGlyph = UINT32_MAX;
+
+    uint32_t FindGlyphIndex(uint32_t character) const noexcept;
     Glyph const* FindGlyph(wchar_t character) const;
 
     void SetDefaultCharacter(wchar_t character);
+    void SetLineSpacing(float spacing) noexcept;
 
     template<typename TAction>
     void ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const;
 
+    XMVECTOR XM_CALLCONV MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const;
+
     const wchar_t* ConvertUTF8(_In_z_ const char *text) noexcept(false);
 
     // Fields.
@@ -59,12 +65,67 @@ public:
     D3D12_GPU_DESCRIPTOR_HANDLE texture;
     XMUINT2 textureSize;
     std::vector<Glyph> glyphs;
-    std::vector<uint32_t> glyphsIndex;
     Glyph const* defaultGlyph;
     float lineSpacing;
     bool pixelAlignment;
 
 private:
+    // A glyph positioned by the layout pass.
+    struct GlyphPlacement
+    {
+        Glyph const* glyph;
+        float x;
+        float y;
+        float advance;
+        bool isBlank;   // whitespace with no visible pixels, skipped when ignoring whitespace
+    };
+
+    // The positioned glyphs for a whole string, plus its size as returned by MeasureString.
+    struct Layout
+    {
+        std::vector<GlyphPlacement> glyphs;
+        XMFLOAT2 size;
+        XMFLOAT2 sizeWithWhitespace;
+    };
+
+    // Recently laid out strings. UI text tends to be drawn and measured every frame, so long
+    // strings are only laid out once; short ones are cheaper to lay out again than to look up.
+    class LayoutCache
+    {
+    public:
+        static constexpr size_t MinLength = 32;
+        static constexpr size_t MaxLength = 4096;
+        static constexpr size_t MaxEntries = 64;
+
+        LayoutCache() noexcept : mClock(0) {}
+
+        std::shared_ptr<const Layout> Find(size_t hash, _In_reads_(length) wchar_t const* text, size_t length, uint32_t generation);
+        void Insert(size_t hash, _In_reads_(length) wchar_t const* text, size_t length, uint32_t generation, std::shared_ptr<const Layout> const& layout);
+
+    private:
+        struct Entry
+        {
+            size_t hash;
+            uint32_t generation;
+            uint64_t lastUse;
+            std::wstring text;
+            std::shared_ptr<const Layout> layout;
+        };
+
+        std::mutex mMutex;
+        std::vector<Entry> mEntries;
+        uint64_t mClock;
+    };
+
+    void BuildGlyphTable();
+
+    template<typename TEmit>
+    void LayoutGlyphs(_In_reads_(length) wchar_t const* text, size_t length, TEmit emit) const;
+
+    std::shared_ptr<const Layout> GetLayout(_In_reads_(length) wchar_t const* text, size_t length) const;
+
+    XMVECTOR XM_CALLCONV MeasureGlyph(GlyphPlacement const& placement) const noexcept;
+
     void CreateTextureResource(_In_ ID3D12Device* device,
         ResourceUploadBatch& upload,
         uint32_t width, uint32_t height,
@@ -74,31 +135,49 @@ private:
 
     size_t utfBufferSize;
     std::unique_ptr<wchar_t[]> utfBuffer;
+
+    // Glyph lookup table for the Basic Multilingual Plane, split into 256-entry pages indexed by
+    // the high byte of the codepoint. Page 0 is all NoGlyph and is shared by every block the font
+    // doesn't use, so a lookup is two loads with no branches. Glyphs outside the BMP start at
+    // firstExtendedGlyph.
+    uint16_t glyphPageMap[256];
+    std::vector<uint32_t> glyphPages;
+    size_t firstExtendedGlyph;
+
+    std::unique_ptr<LayoutCache> layoutCache;
+    uint32_t layoutGeneration;
 };
 
 
 // Constants.
 const XMFLOAT2 SpriteFont::Float2Zero(0, 0);
 
+constexpr uint32_t SpriteFont::Impl::NoGlyph;
+
 static const char spriteFontMagic[] = "DXTKfont";
 
 
-// Comparison operators make our sorted glyph vector work with std::binary_search and lower_bound.
+// Comparison operator used to validate that user provided glyphs are sorted.
 namespace DirectX
 {
     static inline bool operator< (SpriteFont::Glyph const& left, SpriteFont::Glyph const& right) noexcept
     {
         return left.Character < right.Character;
     }
+}
 
-    static inline bool operator< (wchar_t left, SpriteFont::Glyph const& right) noexcept
-    {
-        return left < right.Character;
-    }
-
-    static inline bool operator< (SpriteFont::Glyph const& left, wchar_t right) noexcept
+namespace
+{
+    inline size_t HashString(_In_reads_(length) wchar_t const* text, size_t length) noexcept
     {
-        return left.Character < right;
+        // 64-bit FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t j = 0; j < length; ++j)
+        {
+            hash ^= static_cast<uint64_t>(text[j]);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
     }
 }
 
@@ -117,7 +196,11 @@ SpriteFont::Impl::Impl(
     defaultGlyph(nullptr),
     lineSpacing(0),
     pixelAlignment(false),
-    utfBufferSize(0)
+    utfBufferSize(0),
+    glyphPageMap{},
+    firstExtendedGlyph(0),
+    layoutCache(std::make_unique<LayoutCache>()),
+    layoutGeneration(0)
 {
     if (!device || !reader)
         throw std::invalid_argument("Direct3D device is null");
@@ -137,12 +220,8 @@ SpriteFont::Impl::Impl(
     auto glyphData = reader->ReadArray<Glyph>(glyphCount);
 
     glyphs.assign(glyphData, glyphData + glyphCount);
-    glyphsIndex.reserve(glyphs.size());
 
-    for (auto& glyph : glyphs)
-    {
-        glyphsIndex.emplace_back(glyph.Character);
-    }
+    BuildGlyphTable();
 
     // Read font properties.
     lineSpacing = reader->Read<float>();
@@ -216,7 +295,11 @@ SpriteFont::Impl::Impl(
     defaultGlyph(nullptr),
     lineSpacing(ilineSpacing),
     pixelAlignment(false),
-    utfBufferSize(0)
+    utfBufferSize(0),
+    glyphPageMap{},
+    firstExtendedGlyph(0),
+    layoutCache(std::make_unique<LayoutCache>()),
+    layoutGeneration(0)
 {
     if (!itexture.ptr)
     {
@@ -228,51 +311,87 @@ SpriteFont::Impl::Impl(
         throw std::runtime_error("Glyphs must be in ascending codepoint order");
     }
 
-    glyphsIndex.reserve(glyphs.size());
+    BuildGlyphTable();
+}
+
+
+// Builds the page table used by FindGlyphIndex. Glyphs are in ascending codepoint order.
+void SpriteFont::Impl::BuildGlyphTable()
+{
+    if (glyphs.size() >= NoGlyph)
+    {
+        throw std::overflow_error("Too many glyphs");
+    }
+
+    glyphPages.assign(256, NoGlyph);
+
+    firstExtendedGlyph = glyphs.size();
 
-    for (auto& glyph : glyphs)
+    for (size_t index = 0; index < glyphs.size(); ++index)
     {
-        glyphsIndex.emplace_back(glyph.Character);
+        const uint32_t character = glyphs[index].Character;
+        if (character > 0xFFFF)
+        {
+            firstExtendedGlyph = index;
+            break;
+        }
+
+        auto& page = glyphPageMap[character >> 8];
+        if (!page)
+        {
+            page = static_cast<uint16_t>(glyphPages.size() >> 8);
+            glyphPages.resize(glyphPages.size() + 256, NoGlyph);
+        }
+
+        auto& slot = glyphPages[(size_t(page) << 8) | (character & 0xFF)];
+        if (slot == NoGlyph)
+        {
+            slot = static_cast<uint32_t>(index);
+        }
     }
 }
 
 
-// Looks up the requested glyph, falling back to the default character if it is not in the font.
-SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+// Returns the index of the glyph for a codepoint, or NoGlyph if it is not in the font.
+uint32_t SpriteFont::Impl::FindGlyphIndex(uint32_t character) const noexcept
 {
-    // Rather than use std::lower_bound (which includes a slow debug path when built for _DEBUG),
-    // we implement a binary search inline to ensure sufficient Debug build performance to be useful
-    // for text-heavy applications.
+    if (character <= 0xFFFF)
+    {
+        return glyphPages[(size_t(glyphPageMap[character >> 8]) << 8) | (character & 0xFF)];
+    }
 
-    size_t lower = 0;
-    size_t higher = glyphs.size() - 1;
-    size_t index = higher / 2;
-    const size_t size = glyphs.size();
+    // Codepoints beyond the BMP are rare in fonts, so these use a binary search over the end of
+    // the sorted glyph list. It is written out rather than using std::lower_bound to keep Debug
+    // builds fast.
+    size_t lower = firstExtendedGlyph;
+    size_t upper = glyphs.size();
 
-    while (index < size)
+    while (lower < upper)
     {
-        const auto curChar = glyphsIndex[index];
-        if (curChar == character) { return &glyphs[index]; }
+        const size_t index = lower + ((upper - lower) / 2);
+        const uint32_t curChar = glyphs[index].Character;
+        if (curChar == character) { return static_cast<uint32_t>(index); }
         if (curChar < character)
         {
             lower = index + 1;
         }
         else
         {
-            higher = index - 1;
-        }
-        if (higher < lower) { break; }
-        else if (higher - lower <= 4)
-        {
-            for (index = lower; index <= higher; index++)
-            {
-                if (glyphsIndex[index] == character)
-                {
-                    return &glyphs[index];
-                }
-            }
+            upper = index;
         }
-        index = lower + ((higher - lower) / 2);
+    }
+
+    return NoGlyph;
+}
+
+
+// Looks up the requested glyph, falling back to the default character if it is not in the font.
+SpriteFont::Glyph const* SpriteFont::Impl::FindGlyph(wchar_t character) const
+{
+    const uint32_t index = FindGlyphIndex(static_cast<uint32_t>(character));
+    if (index != NoGlyph)
+    {
+        return &glyphs[index];
     }
 
     if (defaultGlyph)
@@ -294,19 +413,29 @@ void SpriteFont::Impl::SetDefaultCharacter(wchar_t character)
     {
         defaultGlyph = FindGlyph(character);
     }
+
+    ++layoutGeneration;
 }
 
 
-// The core glyph layout algorithm, shared between DrawString and MeasureString.
-template<typename TAction>
-void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const
+void SpriteFont::Impl::SetLineSpacing(float spacing) noexcept
+{
+    lineSpacing = spacing;
+
+    ++layoutGeneration;
+}
+
+
+// The core glyph layout algorithm. Emits every glyph in the string along with its position.
+template<typename TEmit>
+void SpriteFont::Impl::LayoutGlyphs(_In_reads_(length) wchar_t const* text, size_t length, TEmit emit) const
 {
     float x = 0;
     float y = 0;
 
-    for (; *text; text++)
+    for (size_t j = 0; j < length; ++j)
     {
-        const wchar_t character = *text;
+        const wchar_t character = text[j];
 
         switch (character)
         {
@@ -331,13 +460,11 @@ void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action,
 
             const float advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
 
-            if (!ignoreWhitespace
-                || !iswspace(character)
-                || ((glyph->Subrect.right - glyph->Subrect.left) > 1)
-                || ((glyph->Subrect.bottom - glyph->Subrect.top) > 1))
-            {
-                action(glyph, x, y, advance);
-            }
+            const bool isBlank = ((glyph->Subrect.right - glyph->Subrect.left) <= 1)
+                && ((glyph->Subrect.bottom - glyph->Subrect.top) <= 1)
+                && iswspace(character);
+
+            emit(GlyphPlacement{ glyph, x, y, advance, isBlank });
 
             x += advance;
             break;
@@ -346,6 +473,174 @@ void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action,
 }
 
 
+// Visits each glyph of the string, shared between DrawString, MeasureString and MeasureDrawBounds.
+template<typename TAction>
+void SpriteFont::Impl::ForEachGlyph(_In_z_ wchar_t const* text, TAction action, bool ignoreWhitespace) const
+{
+    auto visit = [&](GlyphPlacement const& placement)
+        {
+            if (!ignoreWhitespace || !placement.isBlank)
+            {
+                action(placement.glyph, placement.x, placement.y, placement.advance);
+            }
+        };
+
+    const size_t length = wcslen(text);
+
+    if (length >= LayoutCache::MinLength && length <= LayoutCache::MaxLength)
+    {
+        auto layout = GetLayout(text, length);
+
+        for (auto const& placement : layout->glyphs)
+        {
+            visit(placement);
+        }
+    }
+    else
+    {
+        LayoutGlyphs(text, length, visit);
+    }
+}
+
+
+XMVECTOR XM_CALLCONV SpriteFont::Impl::MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const
+{
+    const size_t length = wcslen(text);
+
+    if (length >= LayoutCache::MinLength && length <= LayoutCache::MaxLength)
+    {
+        auto layout = GetLayout(text, length);
+
+        return XMLoadFloat2(ignoreWhitespace ? &layout->size : &layout->sizeWithWhitespace);
+    }
+
+    XMVECTOR result = XMVectorZero();
+
+    LayoutGlyphs(text, length, [&](GlyphPlacement const& placement)
+        {
+            if (!ignoreWhitespace || !placement.isBlank)
+            {
+                result = XMVectorMax(result, MeasureGlyph(placement));
+            }
+        });
+
+    return result;
+}
+
+
+// Returns the bottom right corner of a placed glyph, as used by MeasureString.
+XMVECTOR XM_CALLCONV SpriteFont::Impl::MeasureGlyph(GlyphPlacement const& placement) const noexcept
+{
+    auto glyph = placement.glyph;
+
+    const auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
+    auto h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top) + glyph->YOffset;
+
+    h = iswspace(wchar_t(glyph->Character)) ?
+        lineSpacing :
+        std::max(h, lineSpacing);
+
+    return XMVectorSet(placement.x + w, placement.y + h, 0, 0);
+}
+
+
+// Returns the cached layout for a string, laying it out if needed. The layout depends only on
+// the text and the font, since position, scale and rotation are applied by SpriteBatch.
+_Use_decl_annotations_
+std::shared_ptr<const SpriteFont::Impl::Layout> SpriteFont::Impl::GetLayout(wchar_t const* text, size_t length) const
+{
+    const size_t hash = HashString(text, length);
+    const uint32_t generation = layoutGeneration;
+
+    auto layout = layoutCache->Find(hash, text, length, generation);
+    if (layout)
+        return layout;
+
+    auto newLayout = std::make_shared<Layout>();
+    newLayout->glyphs.reserve(length);
+
+    XMVECTOR size = XMVectorZero();
+    XMVECTOR sizeWithWhitespace = XMVectorZero();
+
+    LayoutGlyphs(text, length, [&](GlyphPlacement const& placement)
+        {
+            newLayout->glyphs.push_back(placement);
+
+            const XMVECTOR extent = MeasureGlyph(placement);
+
+            sizeWithWhitespace = XMVectorMax(sizeWithWhitespace, extent);
+
+            if (!placement.isBlank)
+            {
+                size = XMVectorMax(size, extent);
+            }
+        });
+
+    XMStoreFloat2(&newLayout->size, size);
+    XMStoreFloat2(&newLayout->sizeWithWhitespace, sizeWithWhitespace);
+
+    layoutCache->Insert(hash, text, length, generation, newLayout);
+
+    return newLayout;
+}
+
+
+_Use_decl_annotations_
+std::shared_ptr<const SpriteFont::Impl::Layout> SpriteFont::Impl::LayoutCache::Find(size_t hash, wchar_t const* text, size_t length, uint32_t generation)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    for (auto& entry : mEntries)
+    {
+        if (entry.hash == hash
+            && entry.generation == generation
+            && entry.text.length() == length
+            && wmemcmp(entry.text.c_str(), text, length) == 0)
+        {
+            entry.lastUse = ++mClock;
+            return entry.layout;
+        }
+    }
+
+    return nullptr;
+}
+
+
+_Use_decl_annotations_
+void SpriteFont::Impl::LayoutCache::Insert(size_t hash, wchar_t const* text, size_t length, uint32_t generation, std::shared_ptr<const Layout> const& layout)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // Replace the least recently used entry once full. Entries from before a change to the line
+    // spacing or default character never match again, so they go first.
+    Entry* target = nullptr;
+
+    if (mEntries.size() < MaxEntries)
+    {
+        mEntries.emplace_back();
+        target = &mEntries.back();
+    }
+    else
+    {
+        for (auto& entry : mEntries)
+        {
+            if (!target
+                || (entry.generation != generation && target->generation == generation)
+                || ((entry.generation != generation) == (target->generation != generation) && entry.lastUse < target->lastUse))
+            {
+                target = &entry;
+            }
+        }
+    }
+
+    target->hash = hash;
+    target->generation = generation;
+    target->lastUse = ++mClock;
+    target->text.assign(text, length);
+    target->layout = layout;
+}
+
+
 _Use_decl_annotations_
 void SpriteFont::Impl::CreateTextureResource(
     ID3D12Device* device,
@@ -542,23 +837,7 @@ void XM_CALLCONV SpriteFont::DrawString(_In_ SpriteBatch* spriteBatch, _In_z_ wc
 
 XMVECTOR XM_CALLCONV SpriteFont::MeasureString(_In_z_ wchar_t const* text, bool ignoreWhitespace) const
 {
-    XMVECTOR result = XMVectorZero();
-
-    pImpl->ForEachGlyph(text, [&](Glyph const* glyph, float x, float y, float advance)
-        {
-            UNREFERENCED_PARAMETER(advance);
-
-            const auto w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
-            auto h = static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top) + glyph->YOffset;
-
-            h = iswspace(wchar_t(glyph->Character)) ?
-                pImpl->lineSpacing :
-                std::max(h, pImpl->lineSpacing);
-
-            result = XMVectorMax(result, XMVectorSet(x + w, y + h, 0, 0));
-        }, ignoreWhitespace);
-
-    return result;
+    return pImpl->MeasureString(text, ignoreWhitespace);
 }
 
 
@@ -667,7 +946,7 @@ float SpriteFont::GetLineSpacing() const noexcept
 
 void SpriteFont::SetLineSpacing(float spacing) noexcept
 {
-    pImpl->lineSpacing = spacing;
+    pImpl->SetLineSpacing(spacing);
 }
 
 
@@ -692,7 +971,7 @@ void SpriteFont::SetDefaultCharacter(wchar_t character)
 
 bool SpriteFont::ContainsCharacter(wchar_t character) const
 {
-    return std::binary_search(pImpl->glyphs.begin(), pImpl->glyphs.end(), character);
+    return pImpl->FindGlyphIndex(static_cast<uint32_t>(character)) != Impl::NoGlyph;
 }
 
 
@@ -0,0 +1,285 @@
+//--------------------------------------------------------------------------------------
+// File: SpriteQueue.h
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// https://go.microsoft.com/fwlink/?LinkId=248929
+// https://go.microsoft.com/fwlink/?LinkID=615561
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// Sprite queueing and sorting helpers used by SpriteBatch. These have no Direct3D dependencies,
+// so they can be exercised and benchmarked without a GPU.
+namespace DirectX
+{
+    // Append-only queue stored as a list of chunks. Growing adds a chunk instead of moving the
+    // existing elements, so pointers to queued items stay valid until Clear, and the chunks are
+    // kept for reuse so a steady workload stops allocating after the first few frames.
+    template<typename T>
+    class ChunkedQueue
+    {
+    public:
+        ChunkedQueue() noexcept
+            : mCount(0),
+            mChunkIndex(0),
+            mChunkUsed(0)
+        {}
+
+        ChunkedQueue(ChunkedQueue&&) = default;
+        ChunkedQueue& operator= (ChunkedQueue&&) = default;
+
+        ChunkedQueue(ChunkedQueue const&) = delete;
+        ChunkedQueue& operator= (ChunkedQueue const&) = delete;
+
+        // Returns storage for one more item.
+        T* Append()
+        {
+            if (mChunkIndex == mChunks.size() || mChunkUsed == mChunks[mChunkIndex].capacity)
+            {
+                if (mChunkIndex < mChunks.size())
+                {
+                    ++mChunkIndex;
+                }
+
+                if (mChunkIndex == mChunks.size())
+                {
+                    // Each chunk doubles in size, up to a limit
+                    const size_t capacity = mChunks.empty()
+                        ? InitialChunkSize
+                        : std::min(mChunks.back().capacity * 2, size_t(MaxChunkSize));
+
+                    Chunk chunk;
+                    chunk.items.reset(new T[capacity]);
+                    chunk.capacity = capacity;
+                    mChunks.push_back(std::move(chunk));
+                }
+
+                mChunkUsed = 0;
+            }
+
+            ++mCount;
+            return &mChunks[mChunkIndex].items[mChunkUsed++];
+        }
+
+        size_t Count() const noexcept { return mCount; }
+
+        // Empties the queue but keeps its memory.
+        void Clear() noexcept
+        {
+            mCount = 0;
+            mChunkIndex = 0;
+            mChunkUsed = 0;
+        }
+
+        // Appends a pointer to each queued item, in queue order.
+        void Gather(std::vector<T const*>& items) const
+        {
+            size_t remaining = mCount;
+            for (size_t j = 0; remaining > 0; ++j)
+            {
+                const size_t count = std::min(remaining, mChunks[j].capacity);
+                const T* chunkItems = mChunks[j].items.get();
+                for (size_t i = 0; i < count; ++i)
+                {
+                    items.push_back(chunkItems + i);
+                }
+                remaining -= count;
+            }
+        }
+
+    private:
+        static constexpr size_t InitialChunkSize = 64;
+        static constexpr size_t MaxChunkSize = 4096;
+
+        struct Chunk
+        {
+            std::unique_ptr<T[]>    items;
+            size_t                  capacity;
+        };
+
+        std::vector<Chunk>  mChunks;
+        size_t              mCount;
+        size_t              mChunkIndex;
+        size_t              mChunkUsed;
+    };
+
+
+    // One ChunkedQueue per recording thread. Any number of threads may call Local at the same
+    // time; Reset and ForEach must not run concurrently with anything else.
+    template<typename T>
+    class PerThreadQueues
+    {
+    public:
+        PerThreadQueues() noexcept
+            : mGeneration(0)
+        {}
+
+        PerThreadQueues(PerThreadQueues const&) = delete;
+        PerThreadQueues& operator= (PerThreadQueues const&) = delete;
+
+        // Empties every queue and starts a new recording pass.
+        void Reset() noexcept
+        {
+            for (auto& queue : mQueues)
+            {
+                queue->items.Clear();
+            }
+
+            mGeneration = NextGeneration();
+        }
+
+        // Returns the calling thread's queue. After the first call in a recording pass this is a
+        // thread-local lookup, so the common single-threaded case never takes the lock.
+        ChunkedQueue<T>& Local()
+        {
+            struct LocalCache
+            {
+                uint64_t            generation;
+                ChunkedQueue<T>*    queue;
+            };
+
+            static thread_local LocalCache s_cache = {};
+
+            if (s_cache.generation != mGeneration || !s_cache.queue)
+            {
+                s_cache.queue = &FindOrAddQueue(std::this_thread::get_id());
+                s_cache.generation = mGeneration;
+            }
+
+            return *s_cache.queue;
+        }
+
+        // Visits each queue in the order the threads first recorded into it.
+        template<typename TFunc>
+        void ForEach(TFunc&& func) const
+        {
+            for (const auto& queue : mQueues)
+            {
+                func(queue->items);
+            }
+        }
+
+    private:
+        struct ThreadQueue
+        {
+            std::thread::id     thread;
+            ChunkedQueue<T>     items;
+        };
+
+        // Generations are unique across all instances, so a thread's cached queue can never be
+        // mistaken for one belonging to another object at the same address.
+        static uint64_t NextGeneration() noexcept
+        {
+            static std::atomic<uint64_t> s_generation(0);
+            return ++s_generation;
+        }
+
+        ChunkedQueue<T>& FindOrAddQueue(std::thread::id thread)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            for (auto& queue : mQueues)
+            {
+                if (queue->thread == thread)
+                    return queue->items;
+            }
+
+            auto queue = std::make_unique<ThreadQueue>();
+            queue->thread = thread;
+            mQueues.push_back(std::move(queue));
+
+            return mQueues.back()->items;
+        }
+
+        uint64_t                                    mGeneration;
+        std::mutex                                  mMutex;
+        std::vector<std::unique_ptr<ThreadQueue>>   mQueues;
+    };
+
+
+    // A sort key paired with the position of the item it was computed from.
+    struct SortKeyIndex
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+
+    // Maps a float to an unsigned integer with the same ordering.
+    inline uint32_t FloatToSortKey(float value) noexcept
+    {
+        // Treat -0 as +0 so they compare equal, as they do for floats
+        if (value == 0.f)
+            value = 0.f;
+
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    // Stable LSD radix sort by key, one byte per pass. Passes over bytes that are the same in
+    // every key are skipped, so narrow keys, such as depths or descriptor handles from a single
+    // heap, only pay for the bytes that differ. Returns whichever buffer holds the result.
+    inline SortKeyIndex* RadixSort(
+        _Inout_updates_(count) SortKeyIndex* keys,
+        _Out_writes_(count) SortKeyIndex* scratch,
+        size_t count) noexcept
+    {
+        if (count < 2)
+            return keys;
+
+        size_t histogram[8][256] = {};
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint64_t key = keys[i].key;
+            for (size_t b = 0; b < 8; ++b)
+            {
+                ++histogram[b][(key >> (b * 8)) & 0xFF];
+            }
+        }
+
+        SortKeyIndex* src = keys;
+        SortKeyIndex* dst = scratch;
+
+        for (size_t b = 0; b < 8; ++b)
+        {
+            auto& counts = histogram[b];
+            const size_t shift = b * 8;
+
+            if (counts[(src[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            size_t offset = 0;
+            for (size_t d = 0; d < 256; ++d)
+            {
+                const size_t n = counts[d];
+                counts[d] = offset;
+                offset += n;
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                dst[counts[(src[i].key >> shift) & 0xFF]++] = src[i];
+            }
+
+            std::swap(src, dst);
+        }
+
+        return src;
+    }
+}
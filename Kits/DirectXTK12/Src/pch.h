@@ -221,6 +221,8 @@
 #include <future>
 #pragma warning(pop)
 
+#include <thread>
+
 #pragma warning(push)
 #pragma warning(disable : 4702)
 #include <functional>
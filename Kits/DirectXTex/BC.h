@@ -22,6 +22,7 @@ namespace DirectX
 
 // Because these are used in SAL annotations, they need to remain macros rather than const values
 #define NUM_PIXELS_PER_BLOCK 16
+#define BC7_BATCH_SIZE 4
 
 //-------------------------------------------------------------------------------------
 // Constants
@@ -45,6 +46,9 @@ namespace DirectX
 
         BC_FLAGS_FORCE_BC7_MODE6 = 0x100000,
         // BC7 should only use mode 6; skip other modes
+
+        BC_FLAGS_BC7_BATCH = 0x200000,
+        // BC7 blocks are gathered and encoded BC7_BATCH_SIZE at a time with D3DXEncodeBC7Batch
     };
 
     //-------------------------------------------------------------------------------------
@@ -341,5 +345,8 @@ namespace DirectX
     void D3DXEncodeBC6HU(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ uint32_t flags) noexcept;
     void D3DXEncodeBC6HS(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ uint32_t flags) noexcept;
     void D3DXEncodeBC7(_Out_writes_(16) uint8_t *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK) const XMVECTOR *pColor, _In_ uint32_t flags) noexcept;
+    void D3DXEncodeBC7Batch(_In_reads_(count) uint8_t* const *pBC, _In_reads_(NUM_PIXELS_PER_BLOCK * count) const XMVECTOR *pColor,
+        _In_range_(1, BC7_BATCH_SIZE) size_t count, _In_ uint32_t flags) noexcept;
+        // Encodes several blocks at once; output is identical to calling D3DXEncodeBC7 for each block
 
 } // namespace
@@ -776,6 +776,11 @@ namespace
         void Decode(_Out_writes_(NUM_PIXELS_PER_BLOCK) HDRColorA* pOut) const noexcept;
         void Encode(uint32_t flags, _In_reads_(NUM_PIXELS_PER_BLOCK) const HDRColorA* const pIn) noexcept;
 
+        static void EncodeBatch(uint32_t flags,
+            _In_reads_(count) D3DX_BC7* const aBlocks[],
+            _In_reads_(count) const HDRColorA* const aIn[],
+            _In_range_(1, BC7_BATCH_SIZE) size_t count) noexcept;
+
     private:
         struct ModeInfo
         {
@@ -867,6 +872,9 @@ namespace
         float MapColors(_In_ const EncodeParams* pEP, _In_reads_(np) const LDRColorA aColors[], _In_ size_t np, _In_ size_t uIndexMode,
             _In_ const LDREndPntPair& endPts, _In_ float fMinErr) const noexcept;
         static float RoughMSE(_Inout_ EncodeParams* pEP, _In_ size_t uShape, _In_ size_t uIndexMode) noexcept;
+        static void RoughEndPoints(_Inout_ EncodeParams* pEP, _In_ size_t uShape, _In_ size_t uIndexMode) noexcept;
+        static void RoughMSEBatch(_In_reads_(BC7_BATCH_SIZE) EncodeParams* const aEP[], _In_ size_t uShape, _In_ size_t uIndexMode,
+            _Out_writes_(BC7_BATCH_SIZE) float afErr[]) noexcept;
 
     private:
         static constexpr uint8_t c_NumModes = 8;
@@ -2889,6 +2897,201 @@ void D3DX_BC7::Encode(uint32_t flags, const HDRColorA* const pIn) noexcept
 }
 
 
+//-------------------------------------------------------------------------------------
+// Encodes up to BC7_BATCH_SIZE blocks together. The mode/shape/rotation search is the same
+// as Encode, but the rough error of every candidate shape is evaluated for all the blocks
+// at once. Refinement of the best candidates is still done per block, so the output is
+// bit-identical to calling Encode on each block.
+_Use_decl_annotations_
+void D3DX_BC7::EncodeBatch(uint32_t flags, D3DX_BC7* const aBlocks[], const HDRColorA* const aIn[], size_t count) noexcept
+{
+    assert(aBlocks && aIn);
+    assert(count > 0 && count <= BC7_BATCH_SIZE);
+    _Analysis_assume_(count > 0 && count <= BC7_BATCH_SIZE);
+
+    static_assert(BC7_BATCH_SIZE == 4, "EncodeBatch assumes a batch of four blocks");
+
+    // Unused lanes duplicate the first block so the vector kernel always has valid data
+    EncodeParams aEP[BC7_BATCH_SIZE] =
+    {
+        EncodeParams(aIn[0]),
+        EncodeParams(aIn[std::min<size_t>(1, count - 1)]),
+        EncodeParams(aIn[std::min<size_t>(2, count - 1)]),
+        EncodeParams(aIn[std::min<size_t>(3, count - 1)]),
+    };
+
+    D3DX_BC7 aFinal[BC7_BATCH_SIZE];
+    float afMSEBest[BC7_BATCH_SIZE];
+    bool abHasAlpha[BC7_BATCH_SIZE];
+
+    for (size_t b = 0; b < BC7_BATCH_SIZE; ++b)
+    {
+        const HDRColorA* const pIn = aEP[b].aHDRPixels;
+        assert(pIn);
+
+        uint32_t alphaMask = 0xFF;
+        for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; ++i)
+        {
+            aEP[b].aLDRPixels[i].r = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].r * 255.0f + 0.01f)));
+            aEP[b].aLDRPixels[i].g = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].g * 255.0f + 0.01f)));
+            aEP[b].aLDRPixels[i].b = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].b * 255.0f + 0.01f)));
+            aEP[b].aLDRPixels[i].a = uint8_t(std::max<float>(0.0f, std::min<float>(255.0f, pIn[i].a * 255.0f + 0.01f)));
+            alphaMask &= aEP[b].aLDRPixels[i].a;
+        }
+
+        abHasAlpha[b] = (alphaMask != 0xFF);
+        afMSEBest[b] = (b < count) ? FLT_MAX : 0.0f;
+        if (b < count)
+        {
+            aFinal[b] = *aBlocks[b];
+        }
+    }
+
+    for (uint8_t uMode = 0; uMode < 8; ++uMode)
+    {
+        if (!(flags & BC_FLAGS_USE_3SUBSETS) && (uMode == 0 || uMode == 2))
+        {
+            // 3 subset modes tend to be used rarely and add significant compression time
+            continue;
+        }
+
+        if ((flags & TEX_COMPRESS_BC7_QUICK) && (uMode != 6))
+        {
+            // Use only mode 6
+            continue;
+        }
+
+        for (size_t b = 0; b < BC7_BATCH_SIZE; ++b)
+            aEP[b].uMode = uMode;
+
+        const size_t uShapes = size_t(1) << ms_aInfo[uMode].uPartitionBits;
+        assert(uShapes <= BC7_MAX_SHAPES);
+        _Analysis_assume_(uShapes <= BC7_MAX_SHAPES);
+
+        const size_t uNumRots = size_t(1) << ms_aInfo[uMode].uRotationBits;
+        const size_t uNumIdxMode = size_t(1) << ms_aInfo[uMode].uIndexModeBits;
+        const size_t uItems = std::max<size_t>(1, uShapes >> 2);
+        float afRoughMSE[BC7_BATCH_SIZE][BC7_MAX_SHAPES];
+
+        for (size_t r = 0; r < uNumRots; ++r)
+        {
+            // A block takes part in this pass unless it already has an exact encoding, or
+            // it is fully opaque and this is mode 7
+            bool abActive[BC7_BATCH_SIZE];
+            bool bAnyActive = false;
+            for (size_t b = 0; b < count; ++b)
+            {
+                abActive[b] = (afMSEBest[b] > 0) && (abHasAlpha[b] || uMode != 7);
+                bAnyActive |= abActive[b];
+            }
+            for (size_t b = count; b < BC7_BATCH_SIZE; ++b)
+            {
+                abActive[b] = false;
+            }
+
+            if (!bAnyActive)
+                break;
+
+            for (size_t b = 0; b < BC7_BATCH_SIZE; ++b)
+            {
+                LDRColorA* aLDRPixels = aEP[b].aLDRPixels;
+                switch (r)
+                {
+                case 1: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].r, aLDRPixels[i].a); break;
+                case 2: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].g, aLDRPixels[i].a); break;
+                case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].b, aLDRPixels[i].a); break;
+                default: break;
+                }
+            }
+
+            for (size_t im = 0; im < uNumIdxMode; ++im)
+            {
+                EncodeParams* aLanes[BC7_BATCH_SIZE];
+                size_t nLanes = 0;
+                for (size_t b = 0; b < count; ++b)
+                {
+                    if (abActive[b] && afMSEBest[b] > 0)
+                    {
+                        aLanes[nLanes++] = &aEP[b];
+                    }
+                    else
+                    {
+                        abActive[b] = false;
+                    }
+                }
+
+                if (!nLanes)
+                    break;
+
+                for (size_t b = nLanes; b < BC7_BATCH_SIZE; ++b)
+                    aLanes[b] = aLanes[0];
+
+                for (size_t s = 0; s < uShapes; s++)
+                {
+                    for (size_t lane = 0; lane < nLanes; ++lane)
+                        RoughEndPoints(aLanes[lane], s, im);
+
+                    float afErr[BC7_BATCH_SIZE];
+                    RoughMSEBatch(aLanes, s, im, afErr);
+
+                    for (size_t lane = 0; lane < nLanes; ++lane)
+                        afRoughMSE[lane][s] = afErr[lane];
+                }
+
+                for (size_t lane = 0; lane < nLanes; ++lane)
+                {
+                    const size_t b = static_cast<size_t>(aLanes[lane] - aEP);
+
+                    size_t auShape[BC7_MAX_SHAPES];
+                    for (size_t s = 0; s < uShapes; s++)
+                        auShape[s] = s;
+
+                    // Bubble up the first uItems items
+                    float* afRough = afRoughMSE[lane];
+                    for (size_t i = 0; i < uItems; i++)
+                    {
+                        for (size_t j = i + 1; j < uShapes; j++)
+                        {
+                            if (afRough[i] > afRough[j])
+                            {
+                                std::swap(afRough[i], afRough[j]);
+                                std::swap(auShape[i], auShape[j]);
+                            }
+                        }
+                    }
+
+                    for (size_t i = 0; i < uItems && afMSEBest[b] > 0; i++)
+                    {
+                        const float fMSE = aBlocks[b]->Refine(&aEP[b], auShape[i], r, im);
+                        if (fMSE < afMSEBest[b])
+                        {
+                            aFinal[b] = *aBlocks[b];
+                            afMSEBest[b] = fMSE;
+                        }
+                    }
+                }
+            }
+
+            for (size_t b = 0; b < BC7_BATCH_SIZE; ++b)
+            {
+                LDRColorA* aLDRPixels = aEP[b].aLDRPixels;
+                switch (r)
+                {
+                case 1: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].r, aLDRPixels[i].a); break;
+                case 2: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].g, aLDRPixels[i].a); break;
+                case 3: for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++) std::swap(aLDRPixels[i].b, aLDRPixels[i].a); break;
+                default: break;
+                }
+            }
+        }
+    }
+
+    for (size_t b = 0; b < count; ++b)
+    {
+        *aBlocks[b] = aFinal[b];
+    }
+}
+
 //-------------------------------------------------------------------------------------
 _Use_decl_annotations_
 void D3DX_BC7::GeneratePaletteQuantized(const EncodeParams* pEP, size_t uIndexMode, const LDREndPntPair& endPts, LDRColorA aPalette[]) const noexcept
@@ -3497,7 +3700,9 @@ float D3DX_BC7::RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode) no
     assert(pEP->uMode < c_NumModes);
     _Analysis_assume_(pEP->uMode < c_NumModes);
 
-    LDREndPntPair* aEndPts = pEP->aEndPts[uShape];
+    RoughEndPoints(pEP, uShape, uIndexMode);
+
+    const LDREndPntPair* aEndPts = pEP->aEndPts[uShape];
 
     const uint8_t uPartitions = ms_aInfo[pEP->uMode].uPartitions;
     assert(uPartitions < BC7_MAX_REGIONS);
@@ -3507,9 +3712,53 @@ float D3DX_BC7::RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode) no
     const uint8_t uIndexPrec2 = uIndexMode ? ms_aInfo[pEP->uMode].uIndexPrec : ms_aInfo[pEP->uMode].uIndexPrec2;
     const auto uNumIndices = static_cast<const uint8_t>(1u << uIndexPrec);
     const auto uNumIndices2 = static_cast<const uint8_t>(1u << uIndexPrec2);
-    size_t auPixIdx[NUM_PIXELS_PER_BLOCK];
     LDRColorA aPalette[BC7_MAX_REGIONS][BC7_MAX_INDICES];
 
+    if (uIndexPrec2 == 0)
+    {
+        for (size_t p = 0; p <= uPartitions; p++)
+            for (size_t i = 0; i < uNumIndices; i++)
+                LDRColorA::Interpolate(aEndPts[p].A, aEndPts[p].B, i, i, uIndexPrec, uIndexPrec, aPalette[p][i]);
+    }
+    else
+    {
+        for (size_t p = 0; p <= uPartitions; p++)
+        {
+            for (size_t i = 0; i < uNumIndices; i++)
+                LDRColorA::InterpolateRGB(aEndPts[p].A, aEndPts[p].B, i, uIndexPrec, aPalette[p][i]);
+            for (size_t i = 0; i < uNumIndices2; i++)
+                LDRColorA::InterpolateA(aEndPts[p].A, aEndPts[p].B, i, uIndexPrec2, aPalette[p][i]);
+        }
+    }
+
+    float fTotalErr = 0;
+    for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
+    {
+        const uint8_t uRegion = g_aPartitionTable[uPartitions][uShape][i];
+        fTotalErr += ComputeError(pEP->aLDRPixels[i], aPalette[uRegion], uIndexPrec, uIndexPrec2);
+    }
+
+    return fTotalErr;
+}
+
+_Use_decl_annotations_
+void D3DX_BC7::RoughEndPoints(EncodeParams* pEP, size_t uShape, size_t uIndexMode) noexcept
+{
+    assert(pEP);
+    assert(uShape < BC7_MAX_SHAPES);
+    _Analysis_assume_(uShape < BC7_MAX_SHAPES);
+    assert(pEP->uMode < c_NumModes);
+    _Analysis_assume_(pEP->uMode < c_NumModes);
+
+    LDREndPntPair* aEndPts = pEP->aEndPts[uShape];
+
+    const uint8_t uPartitions = ms_aInfo[pEP->uMode].uPartitions;
+    assert(uPartitions < BC7_MAX_REGIONS);
+    _Analysis_assume_(uPartitions < BC7_MAX_REGIONS);
+
+    const uint8_t uIndexPrec2 = uIndexMode ? ms_aInfo[pEP->uMode].uIndexPrec : ms_aInfo[pEP->uMode].uIndexPrec2;
+    size_t auPixIdx[NUM_PIXELS_PER_BLOCK];
+
     for (size_t p = 0; p <= uPartitions; p++)
     {
         size_t np = 0;
@@ -3568,32 +3817,142 @@ float D3DX_BC7::RoughMSE(EncodeParams* pEP, size_t uShape, size_t uIndexMode) no
             aEndPts[p].B.a = uMaxAlpha;
         }
     }
+}
 
-    if (uIndexPrec2 == 0)
-    {
-        for (size_t p = 0; p <= uPartitions; p++)
-            for (size_t i = 0; i < uNumIndices; i++)
-                LDRColorA::Interpolate(aEndPts[p].A, aEndPts[p].B, i, i, uIndexPrec, uIndexPrec, aPalette[p][i]);
-    }
-    else
+// Evaluates the same error as RoughMSE for BC7_BATCH_SIZE blocks at once, one block per
+// vector lane. The errors are sums of squared 8-bit differences, which are exactly
+// representable as floats, so the results are bit-identical to the scalar version.
+_Use_decl_annotations_
+void D3DX_BC7::RoughMSEBatch(EncodeParams* const aEP[], size_t uShape, size_t uIndexMode, float afErr[]) noexcept
+{
+    static_assert(BC7_BATCH_SIZE == 4, "RoughMSEBatch assumes one block per XMVECTOR lane");
+
+    assert(aEP);
+    assert(uShape < BC7_MAX_SHAPES);
+    _Analysis_assume_(uShape < BC7_MAX_SHAPES);
+
+    const uint8_t uMode = aEP[0]->uMode;
+    assert(uMode < c_NumModes);
+    _Analysis_assume_(uMode < c_NumModes);
+
+    const uint8_t uPartitions = ms_aInfo[uMode].uPartitions;
+    assert(uPartitions < BC7_MAX_REGIONS);
+    _Analysis_assume_(uPartitions < BC7_MAX_REGIONS);
+
+    const uint8_t uIndexPrec = uIndexMode ? ms_aInfo[uMode].uIndexPrec2 : ms_aInfo[uMode].uIndexPrec;
+    const uint8_t uIndexPrec2 = uIndexMode ? ms_aInfo[uMode].uIndexPrec : ms_aInfo[uMode].uIndexPrec2;
+    const size_t uNumIndices = size_t(1) << uIndexPrec;
+    const size_t uNumIndices2 = size_t(1) << uIndexPrec2;
+
+    // Palettes in structure-of-arrays form: one vector per channel per entry, one lane per block
+    XMVECTOR aPalette[BC7_MAX_REGIONS][BC7_MAX_INDICES][4];
+
+    for (size_t p = 0; p <= uPartitions; p++)
     {
-        for (size_t p = 0; p <= uPartitions; p++)
+        LDRColorA aLanes[BC7_BATCH_SIZE][BC7_MAX_INDICES];
+        for (size_t lane = 0; lane < BC7_BATCH_SIZE; ++lane)
+        {
+            assert(aEP[lane]->uMode == uMode);
+            const LDREndPntPair& endPts = aEP[lane]->aEndPts[uShape][p];
+            if (uIndexPrec2 == 0)
+            {
+                for (size_t i = 0; i < uNumIndices; i++)
+                    LDRColorA::Interpolate(endPts.A, endPts.B, i, i, uIndexPrec, uIndexPrec, aLanes[lane][i]);
+            }
+            else
+            {
+                for (size_t i = 0; i < uNumIndices; i++)
+                    LDRColorA::InterpolateRGB(endPts.A, endPts.B, i, uIndexPrec, aLanes[lane][i]);
+                for (size_t i = 0; i < uNumIndices2; i++)
+                    LDRColorA::InterpolateA(endPts.A, endPts.B, i, uIndexPrec2, aLanes[lane][i]);
+            }
+        }
+
+        // With separate alpha indices, RGB and alpha can have a different number of entries
+        const size_t uColorChannels = (uIndexPrec2 == 0) ? 4u : 3u;
+        for (size_t i = 0; i < uNumIndices; i++)
+        {
+            for (size_t ch = 0; ch < uColorChannels; ++ch)
+            {
+                aPalette[p][i][ch] = XMVectorSet(
+                    float(aLanes[0][i][ch]), float(aLanes[1][i][ch]), float(aLanes[2][i][ch]), float(aLanes[3][i][ch]));
+            }
+        }
+
+        if (uIndexPrec2 != 0)
         {
-            for (size_t i = 0; i < uNumIndices; i++)
-                LDRColorA::InterpolateRGB(aEndPts[p].A, aEndPts[p].B, i, uIndexPrec, aPalette[p][i]);
             for (size_t i = 0; i < uNumIndices2; i++)
-                LDRColorA::InterpolateA(aEndPts[p].A, aEndPts[p].B, i, uIndexPrec2, aPalette[p][i]);
+            {
+                aPalette[p][i][3] = XMVectorSet(
+                    float(aLanes[0][i].a), float(aLanes[1][i].a), float(aLanes[2][i].a), float(aLanes[3][i].a));
+            }
         }
     }
 
-    float fTotalErr = 0;
+    const XMVECTOR vMax = XMVectorReplicate(FLT_MAX);
+    const XMVECTOR vZero = XMVectorZero();
+
+    XMVECTOR vTotalErr = vZero;
     for (size_t i = 0; i < NUM_PIXELS_PER_BLOCK; i++)
     {
         const uint8_t uRegion = g_aPartitionTable[uPartitions][uShape][i];
-        fTotalErr += ComputeError(pEP->aLDRPixels[i], aPalette[uRegion], uIndexPrec, uIndexPrec2);
+
+        XMVECTOR vPixel[4];
+        for (size_t ch = 0; ch < 4; ++ch)
+        {
+            vPixel[ch] = XMVectorSet(
+                float(aEP[0]->aLDRPixels[i][ch]), float(aEP[1]->aLDRPixels[i][ch]),
+                float(aEP[2]->aLDRPixels[i][ch]), float(aEP[3]->aLDRPixels[i][ch]));
+        }
+
+        // Mirrors ComputeError: each lane stops at its first increase in error or on an exact match
+        const size_t uColorChannels = (uIndexPrec2 == 0) ? 4u : 3u;
+        XMVECTOR vBest = vMax;
+        XMVECTOR vDone = XMVectorFalseInt();
+        for (size_t j = 0; j < uNumIndices; j++)
+        {
+            XMVECTOR vErr = vZero;
+            for (size_t ch = 0; ch < uColorChannels; ++ch)
+            {
+                const XMVECTOR vDiff = XMVectorSubtract(vPixel[ch], aPalette[uRegion][j][ch]);
+                vErr = XMVectorMultiplyAdd(vDiff, vDiff, vErr);
+            }
+
+            vDone = XMVectorOrInt(vDone, XMVectorGreater(vErr, vBest));
+            vBest = XMVectorSelect(vBest, vErr, XMVectorAndCInt(XMVectorLess(vErr, vBest), vDone));
+            vDone = XMVectorOrInt(vDone, XMVectorLessOrEqual(vBest, vZero));
+
+            if (XMVector4EqualInt(vDone, XMVectorTrueInt()))
+                break;
+        }
+        vTotalErr = XMVectorAdd(vTotalErr, vBest);
+
+        if (uIndexPrec2 != 0)
+        {
+            vBest = vMax;
+            vDone = XMVectorFalseInt();
+            for (size_t j = 0; j < uNumIndices2; j++)
+            {
+                const XMVECTOR vDiff = XMVectorSubtract(vPixel[3], aPalette[uRegion][j][3]);
+                const XMVECTOR vErr = XMVectorMultiply(vDiff, vDiff);
+
+                vDone = XMVectorOrInt(vDone, XMVectorGreater(vErr, vBest));
+                vBest = XMVectorSelect(vBest, vErr, XMVectorAndCInt(XMVectorLess(vErr, vBest), vDone));
+                vDone = XMVectorOrInt(vDone, XMVectorLessOrEqual(vBest, vZero));
+
+                if (XMVector4EqualInt(vDone, XMVectorTrueInt()))
+                    break;
+            }
+            vTotalErr = XMVectorAdd(vTotalErr, vBest);
+        }
     }
 
-    return fTotalErr;
+    XMFLOAT4 err;
+    XMStoreFloat4(&err, vTotalErr);
+    afErr[0] = err.x;
+    afErr[1] = err.y;
+    afErr[2] = err.z;
+    afErr[3] = err.w;
 }
 
 
@@ -3657,3 +4016,22 @@ void DirectX::D3DXEncodeBC7(uint8_t *pBC, const XMVECTOR *pColor, uint32_t flags
     static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
     reinterpret_cast<D3DX_BC7*>(pBC)->Encode(flags, reinterpret_cast<const HDRColorA*>(pColor));
 }
+
+_Use_decl_annotations_
+void DirectX::D3DXEncodeBC7Batch(uint8_t* const *pBC, const XMVECTOR *pColor, size_t count, uint32_t flags) noexcept
+{
+    assert(pBC && pColor);
+    assert(count > 0 && count <= BC7_BATCH_SIZE);
+    static_assert(sizeof(D3DX_BC7) == 16, "D3DX_BC7 should be 16 bytes");
+
+    D3DX_BC7* aBlocks[BC7_BATCH_SIZE] = {};
+    const HDRColorA* aIn[BC7_BATCH_SIZE] = {};
+    for (size_t b = 0; b < count; ++b)
+    {
+        assert(pBC[b]);
+        aBlocks[b] = reinterpret_cast<D3DX_BC7*>(pBC[b]);
+        aIn[b] = reinterpret_cast<const HDRColorA*>(pColor + b * NUM_PIXELS_PER_BLOCK);
+    }
+
+    D3DX_BC7::EncodeBatch(flags, aBlocks, aIn, count);
+}
@@ -603,6 +603,51 @@ namespace DirectX
         _Out_opt_ DDSMetaData* ddPixelFormat,
         _Out_ ScratchImage& image) noexcept;
 
+    // DDS file mapped into memory instead of read into a ScratchImage. When the pixel data
+    // can be used as stored (IsDirect), GetImages returns read-only views into the mapping
+    // and nothing is copied. Legacy formats that need expanding or swizzling can be read
+    // one subresource at a time with ReadImage, or all at once with Load.
+    class DIRECTX_TEX_API MappedDDSFile
+    {
+    public:
+        MappedDDSFile() noexcept : m_impl(nullptr) {}
+        MappedDDSFile(MappedDDSFile&& moveFrom) noexcept : m_impl(nullptr) { *this = std::move(moveFrom); }
+        ~MappedDDSFile() { Release(); }
+
+        MappedDDSFile& __cdecl operator= (MappedDDSFile&& moveFrom) noexcept;
+
+        MappedDDSFile(const MappedDDSFile&) = delete;
+        MappedDDSFile& operator=(const MappedDDSFile&) = delete;
+
+        HRESULT __cdecl Open(
+            _In_z_ const wchar_t* szFile,
+            _In_ DDS_FLAGS flags,
+            _Out_opt_ DDSMetaData* ddPixelFormat = nullptr) noexcept;
+
+        void __cdecl Release() noexcept;
+
+        const TexMetadata& __cdecl GetMetadata() const noexcept;
+            // Describes the images as loaded, which is the same as LoadFromDDSFileEx
+
+        bool __cdecl IsDirect() const noexcept;
+
+        const Image* __cdecl GetImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice) const noexcept;
+        const Image* __cdecl GetImages() const noexcept;
+        size_t __cdecl GetImageCount() const noexcept;
+            // Only available if IsDirect; the views must not be written and are valid until Release.
+            // With DDS_FLAGS_LEGACY_DWORD, the row pitch is the one used in the file.
+
+        HRESULT __cdecl ReadImage(_In_ size_t mip, _In_ size_t item, _In_ size_t slice, _In_ const Image& destImage) const noexcept;
+            // destImage must match the format and size of the subresource, and can have any row pitch
+
+        HRESULT __cdecl Load(_Out_ ScratchImage& image) const noexcept;
+
+    private:
+        struct Impl;
+
+        Impl* m_impl;
+    };
+
     DIRECTX_TEX_API HRESULT __cdecl SaveToDDSMemory(
         _In_ const Image& image,
         _In_ DDS_FLAGS flags,
@@ -776,7 +821,10 @@ namespace DirectX
         TEX_FILTER_BOX = 0x400000,
         TEX_FILTER_FANT = 0x400000, // Equiv to Box filtering for mipmap generation
         TEX_FILTER_TRIANGLE = 0x500000,
+        TEX_FILTER_LANCZOS = 0x600000,
+        TEX_FILTER_KAISER = 0x700000,
         // Filtering mode to use for any required image resizing
+        // LANCZOS and KAISER are only implemented by Resize and 2D mipmap generation (never uses WIC)
 
         TEX_FILTER_SRGB_IN = 0x1000000,
         TEX_FILTER_SRGB_OUT = 0x2000000,
@@ -906,6 +954,9 @@ namespace DirectX
         TEX_COMPRESS_BC7_QUICK = 0x100000,
         // Minimal modes (usually mode 6) for BC7 compression
 
+        TEX_COMPRESS_BC7_BATCH = 0x200000,
+        // Encodes several BC7 blocks at once using SIMD; output is bit-identical to the default CPU encoder
+
         TEX_COMPRESS_SRGB_IN = 0x1000000,
         TEX_COMPRESS_SRGB_OUT = 0x2000000,
         TEX_COMPRESS_SRGB = (TEX_COMPRESS_SRGB_IN | TEX_COMPRESS_SRGB_OUT),
@@ -914,6 +965,7 @@ namespace DirectX
 
         TEX_COMPRESS_PARALLEL = 0x10000000,
         // Compress is free to use multithreading to improve performance (by default it does not use multithreading)
+        // All images passed to a single call are scheduled together using a work-stealing thread pool
     };
 
     constexpr float TEX_ALPHA_WEIGHT_DEFAULT = 1.0f;
@@ -1058,6 +1110,66 @@ namespace DirectX
             _In_reads_(width) const XMVECTOR* inPixels, size_t width, size_t y)> pixelFunc,
         ScratchImage& result);
 
+    //---------------------------------------------------------------------------------
+    // Fused image pipeline
+    //
+    // Records a chain of operations and runs them together: the output is produced in
+    // tiles on worker threads, each tile pulls just the source texels it needs through
+    // every stage, and only the result is allocated. Pixels are converted to float once
+    // on the way in and once on the way out, and per-pixel operations are applied to each
+    // row while it is in cache.
+    //
+    // Image operations run in the order they are added. Convert, GenerateMipMaps and
+    // Compress describe the result, so they come after the image operations and in that
+    // order; adding anything out of order returns E_UNEXPECTED. The sRGB flags of all the
+    // operations apply to the pipeline as a whole: SRGB_IN to the source, SRGB_OUT to the
+    // result.
+    class DIRECTX_TEX_API ImagePipeline
+    {
+    public:
+        ImagePipeline() noexcept : m_impl(nullptr) {}
+        ImagePipeline(ImagePipeline&& moveFrom) noexcept : m_impl(nullptr) { *this = std::move(moveFrom); }
+        ~ImagePipeline() { Release(); }
+
+        ImagePipeline& __cdecl operator= (ImagePipeline&& moveFrom) noexcept;
+
+        ImagePipeline(const ImagePipeline&) = delete;
+        ImagePipeline& operator=(const ImagePipeline&) = delete;
+
+        HRESULT __cdecl PremultiplyAlpha(_In_ TEX_PMALPHA_FLAGS flags) noexcept;
+        HRESULT __cdecl FlipRotate(_In_ TEX_FR_FLAGS flags) noexcept;
+            // The rotation is applied before the flips
+        HRESULT __cdecl Resize(_In_ size_t width, _In_ size_t height, _In_ TEX_FILTER_FLAGS filter) noexcept;
+        HRESULT __cdecl ComputeNormalMap(_In_ CNMAP_FLAGS flags, _In_ float amplitude) noexcept;
+        HRESULT __cdecl Transform(
+            _In_ std::function<void __cdecl(_Inout_updates_(width) XMVECTOR* pixels, size_t width, size_t x, size_t y)> pixelFunc) noexcept;
+            // pixelFunc updates a run of pixels starting at (x, y) in place, with sRGB already
+            // converted to linear. It is called from worker threads in no particular order,
+            // and must not throw.
+
+        HRESULT __cdecl Convert(_In_ DXGI_FORMAT format, _In_ TEX_FILTER_FLAGS filter, _In_ float threshold) noexcept;
+        HRESULT __cdecl GenerateMipMaps(_In_ TEX_FILTER_FLAGS filter, _In_ size_t levels) noexcept;
+        HRESULT __cdecl Compress(_In_ DXGI_FORMAT format, _In_ TEX_COMPRESS_FLAGS compress, _In_ float threshold) noexcept;
+            // Without Convert or Compress the result has the source format
+
+        HRESULT __cdecl Execute(
+            _In_ const Image& srcImage, _Out_ ScratchImage& result,
+            _In_ std::function<bool __cdecl(size_t, size_t)> statusCallback = nullptr) const;
+        HRESULT __cdecl Execute(
+            _In_reads_(nimages) const Image* srcImages, _In_ size_t nimages, _In_ const TexMetadata& metadata,
+            _Out_ ScratchImage& result,
+            _In_ std::function<bool __cdecl(size_t, size_t)> statusCallback = nullptr) const;
+            // Uses the top level of each item, or every slice of the top level of a volume
+
+        void __cdecl Release() noexcept;
+            // Removes all the operations
+
+    private:
+        struct Impl;
+
+        Impl* m_impl;
+    };
+
     //---------------------------------------------------------------------------------
     // WIC utility code
 #ifdef _WIN32
@@ -11,28 +11,24 @@
 
 #include "DirectXTexP.h"
 
-#ifdef _OPENMP
-#include <omp.h>
-#pragma warning(disable : 4616 6993)
-#endif
-
 #include "BC.h"
+#include "scheduler.h"
+
+#include <atomic>
 
 using namespace DirectX;
 using namespace DirectX::Internal;
 
 namespace
 {
-    constexpr uint32_t GetBCFlags(_In_ TEX_COMPRESS_FLAGS compress) noexcept
-    {
-        static_assert(static_cast<int>(TEX_COMPRESS_RGB_DITHER) == static_cast<int>(BC_FLAGS_DITHER_RGB), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        static_assert(static_cast<int>(TEX_COMPRESS_A_DITHER) == static_cast<int>(BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        static_assert(static_cast<int>(TEX_COMPRESS_DITHER) == static_cast<int>(BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        static_assert(static_cast<int>(TEX_COMPRESS_UNIFORM) == static_cast<int>(BC_FLAGS_UNIFORM), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        static_assert(static_cast<int>(TEX_COMPRESS_BC7_USE_3SUBSETS) == static_cast<int>(BC_FLAGS_USE_3SUBSETS), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        static_assert(static_cast<int>(TEX_COMPRESS_BC7_QUICK) == static_cast<int>(BC_FLAGS_FORCE_BC7_MODE6), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
-        return (compress & (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6));
-    }
+    static_assert(static_cast<int>(TEX_COMPRESS_RGB_DITHER) == static_cast<int>(BC_FLAGS_DITHER_RGB), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_A_DITHER) == static_cast<int>(BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_DITHER) == static_cast<int>(BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_UNIFORM) == static_cast<int>(BC_FLAGS_UNIFORM), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_BC7_USE_3SUBSETS) == static_cast<int>(BC_FLAGS_USE_3SUBSETS), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_BC7_QUICK) == static_cast<int>(BC_FLAGS_FORCE_BC7_MODE6), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(static_cast<int>(TEX_COMPRESS_BC7_BATCH) == static_cast<int>(BC_FLAGS_BC7_BATCH), "TEX_COMPRESS_* flags should match BC_FLAGS_*");
+    static_assert(GetBCFlags(static_cast<TEX_COMPRESS_FLAGS>(UINT32_MAX)) == (BC_FLAGS_DITHER_RGB | BC_FLAGS_DITHER_A | BC_FLAGS_UNIFORM | BC_FLAGS_USE_3SUBSETS | BC_FLAGS_FORCE_BC7_MODE6 | BC_FLAGS_BC7_BATCH), "GetBCFlags should pass every BC_FLAGS_* option");
 
     constexpr TEX_FILTER_FLAGS GetSRGBFlags(_In_ TEX_COMPRESS_FLAGS compress) noexcept
     {
@@ -106,7 +102,12 @@ namespace
         if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
             return HRESULT_E_NOT_SUPPORTED;
 
-        XM_ALIGNED_DATA(16) XMVECTOR temp[16];
+        // BC7 blocks can optionally be gathered and encoded as a batch
+        const bool batch = (pfEncode == D3DXEncodeBC7) && (bcflags & BC_FLAGS_BC7_BATCH);
+        uint8_t* batchDest[BC7_BATCH_SIZE] = {};
+        size_t nbatch = 0;
+
+        XM_ALIGNED_DATA(16) XMVECTOR batchTemp[NUM_PIXELS_PER_BLOCK * BC7_BATCH_SIZE];
         const uint8_t *pSrc = image.pixels;
         const uint8_t *pEnd = image.pixels + image.slicePitch;
         const size_t rowPitch = image.rowPitch;
@@ -129,6 +130,8 @@ namespace
                 const size_t pw = std::min<size_t>(4, image.width - w);
                 assert(pw > 0 && ph > 0);
 
+                XMVECTOR* temp = &batchTemp[nbatch * NUM_PIXELS_PER_BLOCK];
+
                 const ptrdiff_t bytesLeft = pEnd - sptr;
                 assert(bytesLeft > 0);
                 size_t bytesToRead = std::min<size_t>(rowPitch, static_cast<size_t>(bytesLeft));
@@ -188,7 +191,16 @@ namespace
 
                 ConvertScanline(temp, 16, result.format, format, cflags | srgb);
 
-                if (pfEncode)
+                if (batch)
+                {
+                    batchDest[nbatch++] = dptr;
+                    if (nbatch == BC7_BATCH_SIZE)
+                    {
+                        D3DXEncodeBC7Batch(batchDest, batchTemp, nbatch, bcflags);
+                        nbatch = 0;
+                    }
+                }
+                else if (pfEncode)
                     pfEncode(dptr, temp, bcflags);
                 else
                     D3DXEncodeBC1(dptr, temp, threshold, bcflags);
@@ -201,176 +213,236 @@ namespace
             pDest += result.rowPitch;
         }
 
+        if (nbatch > 0)
+        {
+            D3DXEncodeBC7Batch(batchDest, batchTemp, nbatch, bcflags);
+        }
+
         return S_OK;
     }
 
 
     //-------------------------------------------------------------------------------------
-#ifdef _OPENMP
-    HRESULT CompressBC_Parallel(
+    // Loads the 4x4 block at (x, y), replicating edge pixels for partial blocks
+    inline bool LoadBlock(
         const Image& image,
-        const Image& result,
-        uint32_t bcflags,
-        TEX_FILTER_FLAGS srgb,
-        float threshold,
-        const std::function<bool __cdecl(size_t, size_t)>& statusCallback) noexcept
+        DXGI_FORMAT outFormat,
+        size_t x,
+        size_t y,
+        size_t sbpp,
+        TEX_FILTER_FLAGS cflags,
+        _Out_writes_(NUM_PIXELS_PER_BLOCK) XMVECTOR* temp) noexcept
     {
-        if (!image.pixels || !result.pixels)
-            return E_POINTER;
+        assert(x < image.width);
+        assert(y < image.height);
 
-        assert(image.width == result.width);
-        assert(image.height == result.height);
+        const size_t rowPitch = image.rowPitch;
+        const uint8_t *pSrc = image.pixels + (y * rowPitch) + (x * sbpp);
+        const uint8_t *pEnd = image.pixels + image.slicePitch;
 
-        const DXGI_FORMAT format = image.format;
-        size_t sbpp = BitsPerPixel(format);
-        if (!sbpp)
-            return E_FAIL;
+        const size_t ph = std::min<size_t>(4, image.height - y);
+        const size_t pw = std::min<size_t>(4, image.width - x);
+        assert(pw > 0 && ph > 0);
 
-        if (sbpp < 8)
+        const ptrdiff_t bytesLeft = pEnd - pSrc;
+        assert(bytesLeft > 0);
+        size_t bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft));
+
+        if (!LoadScanline(&temp[0], pw, pSrc, bytesToRead, image.format))
+            return false;
+
+        if (ph > 1)
         {
-            // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
-            return HRESULT_E_NOT_SUPPORTED;
+            bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch);
+            if (!LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, image.format))
+                return false;
+
+            if (ph > 2)
+            {
+                bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 2);
+                if (!LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, image.format))
+                    return false;
+
+                if (ph > 3)
+                {
+                    bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 3);
+                    if (!LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, image.format))
+                        return false;
+                }
+            }
         }
 
-        // Round to bytes
-        sbpp = (sbpp + 7) / 8;
+        if (pw != 4 || ph != 4)
+        {
+            // Replicate pixels for partial block
+            static const size_t uSrc[] = { 0, 0, 0, 1 };
 
-        const uint8_t *pEnd = image.pixels + image.slicePitch;
+            if (pw < 4)
+            {
+                for (size_t t = 0; t < ph && t < 4; ++t)
+                {
+                    for (size_t s = pw; s < 4; ++s)
+                    {
+                        temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                    }
+                }
+            }
+
+            if (ph < 4)
+            {
+                for (size_t t = ph; t < 4; ++t)
+                {
+                    for (size_t s = 0; s < 4; ++s)
+                    {
+                        temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
+                    }
+                }
+            }
+        }
+
+        ConvertScanline(temp, NUM_PIXELS_PER_BLOCK, outFormat, image.format, cflags);
+
+        return true;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Compresses the blocks of all the images as a single work-stealing job, so that an
+    // entire mip chain or array is processed at once rather than one image at a time.
+    // The status callback receives the number of completed blocks across all images.
+    HRESULT CompressBC_Parallel(
+        const Image* images,
+        const Image* results,
+        size_t nimages,
+        uint32_t bcflags,
+        TEX_FILTER_FLAGS srgb,
+        float threshold,
+        const std::function<bool __cdecl(size_t, size_t)>& statusCallback) noexcept
+    {
+        if (!images || !results || !nimages)
+            return E_INVALIDARG;
 
         // Determine BC format encoder
         BC_ENCODE pfEncode;
         size_t blocksize;
         TEX_FILTER_FLAGS cflags;
-        if (!DetermineEncoderSettings(result.format, pfEncode, blocksize, cflags))
+        if (!DetermineEncoderSettings(results[0].format, pfEncode, blocksize, cflags))
             return HRESULT_E_NOT_SUPPORTED;
 
-        // Refactored version of loop to support parallel independance
-        const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+        cflags |= srgb;
 
-        bool fail = false;
+        size_t sbpp = 0;
+        std::unique_ptr<size_t[]> blockStart(new (std::nothrow) size_t[nimages + 1]);
+        if (!blockStart)
+            return E_OUTOFMEMORY;
 
-        size_t progress = 0;
-        bool abort = false;
+        blockStart[0] = 0;
+        for (size_t index = 0; index < nimages; ++index)
+        {
+            const Image& image = images[index];
+            const Image& result = results[index];
 
-        const size_t progressTotal = std::max<size_t>(1, (image.height + 3) / 4);
+            if (!image.pixels || !result.pixels)
+                return E_POINTER;
 
-    #pragma omp parallel for shared(progress)
-        for (int nb = 0; nb < static_cast<int>(nBlocks); ++nb)
-        {
-        #pragma omp flush (abort)
-            if (abort)
+            assert(image.width == result.width);
+            assert(image.height == result.height);
+            assert(result.format == results[0].format);
+
+            const size_t bpp = BitsPerPixel(image.format);
+            if (!bpp)
+                return E_FAIL;
+
+            if (bpp < 8)
             {
-                // Short circuit the loop body if an abort is requested.
-                // OpenMP 2.0 does not support cancellation of a 'parallel for' loop.
-                continue;
+                // We don't support compressing from monochrome (DXGI_FORMAT_R1_UNORM)
+                return HRESULT_E_NOT_SUPPORTED;
             }
 
-            const int nbWidth = std::max<int>(1, int((image.width + 3) / 4));
+            if (!index)
+            {
+                // Round to bytes
+                sbpp = (bpp + 7) / 8;
+            }
+            else if (sbpp != (bpp + 7) / 8)
+            {
+                return E_FAIL;
+            }
 
-            int y = nb / nbWidth;
-            const int x = (nb - (y*nbWidth)) * 4;
-            y *= 4;
+            const size_t nBlocks = std::max<size_t>(1, (image.width + 3) / 4) * std::max<size_t>(1, (image.height + 3) / 4);
+            blockStart[index + 1] = blockStart[index] + nBlocks;
+        }
 
-            assert((x >= 0) && (x < int(image.width)));
-            assert((y >= 0) && (y < int(image.height)));
+        const size_t totalBlocks = blockStart[nimages];
 
-            const size_t rowPitch = image.rowPitch;
-            const uint8_t *pSrc = image.pixels + (size_t(y)*rowPitch) + (size_t(x)*sbpp);
+        // BC6H and BC7 blocks are orders of magnitude more expensive than the other formats,
+        // so hand them out in smaller tiles to keep all of the cores busy.
+        const size_t grain = (pfEncode == D3DXEncodeBC6HU || pfEncode == D3DXEncodeBC6HS || pfEncode == D3DXEncodeBC7) ? 4u : 64u;
 
-            uint8_t *pDest = result.pixels + (size_t(nb)*blocksize);
+        const bool batch = (pfEncode == D3DXEncodeBC7) && (bcflags & BC_FLAGS_BC7_BATCH);
 
-            const size_t ph = std::min<size_t>(4, image.height - size_t(y));
-            const size_t pw = std::min<size_t>(4, image.width - size_t(x));
-            assert(pw > 0 && ph > 0);
+        std::atomic<bool> fail(false);
 
-            const ptrdiff_t bytesLeft = pEnd - pSrc;
-            assert(bytesLeft > 0);
-            size_t bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft));
+        HRESULT hr = TaskScheduler::ParallelFor(totalBlocks, batch ? BC7_BATCH_SIZE : grain,
+            [&](size_t begin, size_t end) -> bool
+            {
+                const size_t* starts = blockStart.get();
+                size_t index = static_cast<size_t>(std::upper_bound(starts, starts + nimages + 1, begin) - starts) - 1;
 
-            XM_ALIGNED_DATA(16) XMVECTOR temp[16];
-            if (!LoadScanline(&temp[0], pw, pSrc, bytesToRead, format))
-                fail = true;
+                uint8_t* batchDest[BC7_BATCH_SIZE] = {};
+                size_t nbatch = 0;
 
-            if (ph > 1)
-            {
-                bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch);
-                if (!LoadScanline(&temp[4], pw, pSrc + rowPitch, bytesToRead, format))
-                    fail = true;
+                XM_ALIGNED_DATA(16) XMVECTOR temp[NUM_PIXELS_PER_BLOCK * BC7_BATCH_SIZE];
 
-                if (ph > 2)
+                for (size_t nb = begin; nb < end; ++nb)
                 {
-                    bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 2);
-                    if (!LoadScanline(&temp[8], pw, pSrc + rowPitch * 2, bytesToRead, format))
-                        fail = true;
-
-                    if (ph > 3)
+                    while (nb >= blockStart[index + 1])
+                        ++index;
+
+                    const Image& image = images[index];
+                    const Image& result = results[index];
+                    const size_t nbWidth = std::max<size_t>(1, (image.width + 3) / 4);
+                    const size_t local = nb - blockStart[index];
+                    const size_t y = (local / nbWidth) * 4;
+                    const size_t x = (local % nbWidth) * 4;
+
+                    XMVECTOR* block = &temp[nbatch * NUM_PIXELS_PER_BLOCK];
+                    if (!LoadBlock(image, result.format, x, y, sbpp, cflags, block))
                     {
-                        bytesToRead = std::min<size_t>(rowPitch, size_t(bytesLeft) - rowPitch * 3);
-                        if (!LoadScanline(&temp[12], pw, pSrc + rowPitch * 3, bytesToRead, format))
-                            fail = true;
+                        fail = true;
+                        return false;
                     }
-                }
-            }
 
-            if (pw != 4 || ph != 4)
-            {
-                // Replicate pixels for partial block
-                static const size_t uSrc[] = { 0, 0, 0, 1 };
+                    uint8_t *pDest = result.pixels + ((y >> 2) * result.rowPitch) + ((x >> 2) * blocksize);
 
-                if (pw < 4)
-                {
-                    for (size_t t = 0; t < ph && t < 4; ++t)
+                    if (batch)
                     {
-                        for (size_t s = pw; s < 4; ++s)
+                        batchDest[nbatch++] = pDest;
+                        if (nbatch == BC7_BATCH_SIZE)
                         {
-                            temp[(t << 2) | s] = temp[(t << 2) | uSrc[s]];
+                            D3DXEncodeBC7Batch(batchDest, temp, nbatch, bcflags);
+                            nbatch = 0;
                         }
                     }
+                    else if (pfEncode)
+                        pfEncode(pDest, block, bcflags);
+                    else
+                        D3DXEncodeBC1(pDest, block, threshold, bcflags);
                 }
 
-                if (ph < 4)
+                if (nbatch > 0)
                 {
-                    for (size_t t = ph; t < 4; ++t)
-                    {
-                        for (size_t s = 0; s < 4; ++s)
-                        {
-                            temp[(t << 2) | s] = temp[(uSrc[t] << 2) | s];
-                        }
-                    }
+                    D3DXEncodeBC7Batch(batchDest, temp, nbatch, bcflags);
                 }
-            }
-
-            ConvertScanline(temp, 16, result.format, format, cflags | srgb);
 
-            if (pfEncode)
-                pfEncode(pDest, temp, bcflags);
-            else
-                D3DXEncodeBC1(pDest, temp, threshold, bcflags);
-
-            // Report progress when a new row is reached.
-            if (x == 0 && statusCallback)
-            {
-            #pragma omp atomic
-                progress += 4;
+                return true;
+            },
+            statusCallback);
 
-                if (!statusCallback(progress, progressTotal))
-                {
-                    abort = true;
-                #pragma omp flush (abort)
-                }
-            }
-        }
+        if (fail)
+            return E_FAIL;
 
-        if (abort)
-        {
-            return E_ABORT;
-        }
-        else
-        {
-            return (fail) ? E_FAIL : S_OK;
-        }
+        return hr;
     }
-#endif // _OPENMP
 
 
     //-------------------------------------------------------------------------------------
@@ -699,11 +771,18 @@ HRESULT DirectX::CompressEx(
     // Compress single image
     if (options.flags & TEX_COMPRESS_PARALLEL)
     {
-    #ifndef _OPENMP
-        hr = E_NOTIMPL;
-    #else
-        hr = CompressBC_Parallel(srcImage, *img, GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, statusCallback);
-    #endif // _OPENMP
+        std::function<bool __cdecl(size_t, size_t)> blockCallback;
+        if (statusCallback)
+        {
+            // Report progress in rows to match the serial codepath
+            const size_t height = img->height;
+            blockCallback = [&statusCallback, height](size_t completed, size_t total) -> bool
+                {
+                    return statusCallback(static_cast<size_t>(uint64_t(completed) * height / total), height);
+                };
+        }
+
+        hr = CompressBC_Parallel(&srcImage, img, 1, GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, blockCallback);
     }
     else
     {
@@ -802,32 +881,45 @@ HRESULT DirectX::CompressEx(
             cImages.Release();
             return E_FAIL;
         }
+    }
 
-        if (options.flags & TEX_COMPRESS_PARALLEL)
-        {
-        #ifndef _OPENMP
-            hr = E_NOTIMPL;
-        #else
-            hr = CompressBC_Parallel(src, dest[index], GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, nullptr);
-        #endif // _OPENMP
-        }
-        else
+    if (options.flags & TEX_COMPRESS_PARALLEL)
+    {
+        // All images are compressed together so a whole mip chain or array keeps every core busy
+        std::function<bool __cdecl(size_t, size_t)> blockCallback;
+        if (statusCallback)
         {
-            hr = CompressBC(src, dest[index], GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, nullptr);
+            blockCallback = [&statusCallback, nimages](size_t completed, size_t total) -> bool
+                {
+                    return statusCallback(static_cast<size_t>(uint64_t(completed) * nimages / total), nimages);
+                };
         }
 
+        hr = CompressBC_Parallel(srcImages, dest, nimages, GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, blockCallback);
         if (FAILED(hr))
         {
             cImages.Release();
             return hr;
         }
-
-        if (statusCallback)
+    }
+    else
+    {
+        for (size_t index = 0; index < nimages; ++index)
         {
-            if (!statusCallback(index, nimages))
+            hr = CompressBC(srcImages[index], dest[index], GetBCFlags(options.flags), GetSRGBFlags(options.flags), options.threshold, nullptr);
+            if (FAILED(hr))
             {
                 cImages.Release();
-                return E_ABORT;
+                return hr;
+            }
+
+            if (statusCallback)
+            {
+                if (!statusCallback(index, nimages))
+                {
+                    cImages.Release();
+                    return E_ABORT;
+                }
             }
         }
     }
@@ -2556,10 +2556,17 @@ HRESULT DirectX::Internal::ConvertToR32G32B32A32(const Image& srcImage, ScratchI
         return E_POINTER;
     }
 
+    ScanlineConverter direct;
+    const bool useDirect = direct.Initialize(DXGI_FORMAT_R32G32B32A32_FLOAT, srcImage.format, TEX_FILTER_DEFAULT, false);
+
     const uint8_t *pSrc = srcImage.pixels;
     for (size_t h = 0; h < srcImage.height; ++h)
     {
-        if (!LoadScanline(reinterpret_cast<XMVECTOR*>(pDest), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format))
+        if (useDirect)
+        {
+            direct.Convert(pDest, pSrc, srcImage.width);
+        }
+        else if (!LoadScanline(reinterpret_cast<XMVECTOR*>(pDest), srcImage.width, pSrc, srcImage.rowPitch, srcImage.format))
         {
             image.Release();
             return E_FAIL;
@@ -2583,12 +2590,19 @@ HRESULT DirectX::Internal::ConvertFromR32G32B32A32(const Image& srcImage, const
     if (srcImage.width != destImage.width || srcImage.height != destImage.height)
         return E_FAIL;
 
+    ScanlineConverter direct;
+    const bool useDirect = direct.Initialize(destImage.format, DXGI_FORMAT_R32G32B32A32_FLOAT, TEX_FILTER_DEFAULT, false);
+
     const uint8_t *pSrc = srcImage.pixels;
     uint8_t* pDest = destImage.pixels;
 
     for (size_t h = 0; h < srcImage.height; ++h)
     {
-        if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, reinterpret_cast<const XMVECTOR*>(pSrc), srcImage.width))
+        if (useDirect)
+        {
+            direct.Convert(pDest, pSrc, srcImage.width);
+        }
+        else if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, reinterpret_cast<const XMVECTOR*>(pSrc), srcImage.width))
             return E_FAIL;
 
         pSrc += srcImage.rowPitch;
@@ -2662,6 +2676,9 @@ HRESULT DirectX::Internal::ConvertFromR32G32B32A32(
         return E_POINTER;
     }
 
+    ScanlineConverter direct;
+    const bool useDirect = direct.Initialize(format, DXGI_FORMAT_R32G32B32A32_FLOAT, TEX_FILTER_DEFAULT, false);
+
     for (size_t index = 0; index < nimages; ++index)
     {
         const Image& src = srcImages[index];
@@ -2686,7 +2703,11 @@ HRESULT DirectX::Internal::ConvertFromR32G32B32A32(
 
         for (size_t h = 0; h < src.height; ++h)
         {
-            if (!StoreScanline(pDest, dst.rowPitch, format, reinterpret_cast<const XMVECTOR*>(pSrc), src.width))
+            if (useDirect)
+            {
+                direct.Convert(pDest, pSrc, src.width);
+            }
+            else if (!StoreScanline(pDest, dst.rowPitch, format, reinterpret_cast<const XMVECTOR*>(pSrc), src.width))
             {
                 result.Release();
                 return E_FAIL;
@@ -3854,6 +3875,555 @@ void DirectX::Internal::ConvertScanline(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Direct scanline conversion
+//-------------------------------------------------------------------------------------
+struct DirectX::Internal::ScanlineTables
+{
+    uint32_t                    shift[4];       // Bit offset of each source channel, in memory order
+    uint32_t                    mask[4];
+    uint32_t                    element[4];     // Destination element of each source channel
+    uint32_t                    keep;           // Swizzle: destination bits taken from the same source bits
+    uint32_t                    move;           // Swizzle: source bits exchanged between bytes 0 and 2
+    uint32_t                    fill;           // Swizzle: destination bits that are constant
+    size_t                      lutSize;
+    std::unique_ptr<uint32_t[]> lut;            // lutSize entries per source channel
+};
+
+namespace
+{
+    struct ScanlineLayout
+    {
+        DXGI_FORMAT format;
+        size_t      bytesPerPixel;
+        bool        packed;         // Channels are bit fields of one 32-bit value, otherwise one element each in RGBA order
+        uint32_t    bits[4];        // Width of each channel, in memory order
+        uint32_t    channel[4];     // Logical channel (R = 0, G = 1, B = 2, A = 3) of each channel, in memory order
+    };
+
+    const ScanlineLayout g_ScanlineLayouts[] =
+    {
+        { DXGI_FORMAT_R32G32B32A32_FLOAT,   16, false, { 32, 32, 32, 32 },  { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_R16G16B16A16_FLOAT,   8,  false, { 16, 16, 16, 16 },  { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_R16G16B16A16_UNORM,   8,  false, { 16, 16, 16, 16 },  { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_R10G10B10A2_UNORM,    4,  true,  { 10, 10, 10, 2 },   { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_R8G8B8A8_UNORM,       4,  true,  { 8, 8, 8, 8 },      { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  4,  true,  { 8, 8, 8, 8 },      { 0, 1, 2, 3 } },
+        { DXGI_FORMAT_B8G8R8A8_UNORM,       4,  true,  { 8, 8, 8, 8 },      { 2, 1, 0, 3 } },
+        { DXGI_FORMAT_B8G8R8X8_UNORM,       4,  true,  { 8, 8, 8, 8 },      { 2, 1, 0, 3 } },
+        { DXGI_FORMAT_B8G8R8A8_UNORM_SRGB,  4,  true,  { 8, 8, 8, 8 },      { 2, 1, 0, 3 } },
+        { DXGI_FORMAT_B8G8R8X8_UNORM_SRGB,  4,  true,  { 8, 8, 8, 8 },      { 2, 1, 0, 3 } },
+    };
+
+    const ScanlineLayout* FindScanlineLayout(DXGI_FORMAT format) noexcept
+    {
+        for (const auto& layout : g_ScanlineLayouts)
+        {
+            if (layout.format == format)
+                return &layout;
+        }
+        return nullptr;
+    }
+
+    uint32_t FieldShift(const ScanlineLayout& layout, size_t index) noexcept
+    {
+        uint32_t shift = 0;
+        for (size_t j = 0; j < index; ++j)
+        {
+            shift += layout.bits[j];
+        }
+        return shift;
+    }
+
+    uint32_t FieldMask(const ScanlineLayout& layout, size_t index) noexcept
+    {
+        return (layout.bits[index] >= 32) ? UINT32_MAX : ((1u << layout.bits[index]) - 1u);
+    }
+
+    size_t FieldIndex(const ScanlineLayout& layout, uint32_t channel) noexcept
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            if (layout.channel[j] == channel)
+                return j;
+        }
+        return 0;
+    }
+
+    // The path every kernel has to match
+    bool ConvertScanlineGeneric(
+        _Out_writes_bytes_(count * out.bytesPerPixel) void* pDestination, const ScanlineLayout& out,
+        _In_reads_bytes_(count * in.bytesPerPixel) const void* pSource, const ScanlineLayout& in,
+        _Out_writes_(count) XMVECTOR* pScanline, size_t count,
+        TEX_FILTER_FLAGS flags, bool convert) noexcept
+    {
+        if (!LoadScanline(pScanline, count, pSource, count * in.bytesPerPixel, in.format))
+            return false;
+
+        if (convert)
+        {
+            ConvertScanline(pScanline, count, out.format, in.format, flags);
+        }
+
+        return StoreScanline(pDestination, count * out.bytesPerPixel, out.format, pScanline, count);
+    }
+
+    //---------------------------------------------------------------------------------
+    // Table-driven kernels for packed 32-bit sources
+    void LUTPackedKernel(void* pDestination, const void* pSource, size_t count, const ScanlineTables* tables) noexcept
+    {
+        const size_t lutSize = tables->lutSize;
+        const uint32_t* lut0 = tables->lut.get();
+        const uint32_t* lut1 = lut0 + lutSize;
+        const uint32_t* lut2 = lut1 + lutSize;
+        const uint32_t* lut3 = lut2 + lutSize;
+
+        const uint32_t s0 = tables->shift[0];
+        const uint32_t s1 = tables->shift[1];
+        const uint32_t s2 = tables->shift[2];
+        const uint32_t s3 = tables->shift[3];
+        const uint32_t m0 = tables->mask[0];
+        const uint32_t m1 = tables->mask[1];
+        const uint32_t m2 = tables->mask[2];
+        const uint32_t m3 = tables->mask[3];
+
+        const uint32_t * __restrict sPtr = static_cast<const uint32_t*>(pSource);
+        uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const uint32_t p = *sPtr++;
+            *dPtr++ = lut0[(p >> s0) & m0] | lut1[(p >> s1) & m1] | lut2[(p >> s2) & m2] | lut3[(p >> s3) & m3];
+        }
+    }
+
+    template<typename T>
+    void LUTElementKernel(void* pDestination, const void* pSource, size_t count, const ScanlineTables* tables) noexcept
+    {
+        const size_t lutSize = tables->lutSize;
+        const uint32_t* lut0 = tables->lut.get();
+        const uint32_t* lut1 = lut0 + lutSize;
+        const uint32_t* lut2 = lut1 + lutSize;
+        const uint32_t* lut3 = lut2 + lutSize;
+
+        const uint32_t s0 = tables->shift[0];
+        const uint32_t s1 = tables->shift[1];
+        const uint32_t s2 = tables->shift[2];
+        const uint32_t s3 = tables->shift[3];
+        const uint32_t m0 = tables->mask[0];
+        const uint32_t m1 = tables->mask[1];
+        const uint32_t m2 = tables->mask[2];
+        const uint32_t m3 = tables->mask[3];
+        const size_t e0 = tables->element[0];
+        const size_t e1 = tables->element[1];
+        const size_t e2 = tables->element[2];
+        const size_t e3 = tables->element[3];
+
+        const uint32_t * __restrict sPtr = static_cast<const uint32_t*>(pSource);
+        T * __restrict dPtr = static_cast<T*>(pDestination);
+        for (size_t i = 0; i < count; ++i, dPtr += 4)
+        {
+            const uint32_t p = *sPtr++;
+            dPtr[e0] = static_cast<T>(lut0[(p >> s0) & m0]);
+            dPtr[e1] = static_cast<T>(lut1[(p >> s1) & m1]);
+            dPtr[e2] = static_cast<T>(lut2[(p >> s2) & m2]);
+            dPtr[e3] = static_cast<T>(lut3[(p >> s3) & m3]);
+        }
+    }
+
+    // 8-bit layouts that only differ in channel order and/or an opaque X channel
+    void SwizzleKernel(void* pDestination, const void* pSource, size_t count, const ScanlineTables* tables) noexcept
+    {
+        const uint32_t keep = tables->keep;
+        const uint32_t move = tables->move;
+        const uint32_t fill = tables->fill;
+
+        const uint32_t * __restrict sPtr = static_cast<const uint32_t*>(pSource);
+        uint32_t * __restrict dPtr = static_cast<uint32_t*>(pDestination);
+
+        size_t i = 0;
+    #if defined(_XM_SSE_INTRINSICS_)
+        const __m128i keepV = _mm_set1_epi32(static_cast<int>(keep));
+        const __m128i moveV = _mm_set1_epi32(static_cast<int>(move));
+        const __m128i fillV = _mm_set1_epi32(static_cast<int>(fill));
+        for (; i + 4 <= count; i += 4)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sPtr + i));
+            const __m128i m = _mm_and_si128(v, moveV);
+            __m128i r = _mm_or_si128(_mm_slli_epi32(m, 16), _mm_srli_epi32(m, 16));
+            r = _mm_or_si128(r, _mm_and_si128(v, keepV));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dPtr + i), _mm_or_si128(r, fillV));
+        }
+    #elif defined(_XM_ARM_NEON_INTRINSICS_)
+        const uint32x4_t keepV = vdupq_n_u32(keep);
+        const uint32x4_t moveV = vdupq_n_u32(move);
+        const uint32x4_t fillV = vdupq_n_u32(fill);
+        for (; i + 4 <= count; i += 4)
+        {
+            const uint32x4_t v = vld1q_u32(sPtr + i);
+            const uint32x4_t m = vandq_u32(v, moveV);
+            uint32x4_t r = vorrq_u32(vshlq_n_u32(m, 16), vshrq_n_u32(m, 16));
+            r = vorrq_u32(r, vandq_u32(v, keepV));
+            vst1q_u32(dPtr + i, vorrq_u32(r, fillV));
+        }
+    #endif
+        for (; i < count; ++i)
+        {
+            const uint32_t v = sPtr[i];
+            const uint32_t m = v & move;
+            dPtr[i] = (m << 16) | (m >> 16) | (v & keep) | fill;
+        }
+    }
+
+    //---------------------------------------------------------------------------------
+    // Fused kernels for float sources, one XMVECTOR per pixel with the same operations
+    // LoadScanline, ConvertScanline and StoreScanline apply
+    void HalfToFloatKernel(void* pDestination, const void* pSource, size_t count, const ScanlineTables*) noexcept
+    {
+        std::ignore = XMConvertHalfToFloatStream(
+            static_cast<float*>(pDestination), sizeof(float),
+            static_cast<const HALF*>(pSource), sizeof(HALF), count * 4);
+    }
+
+    struct LoadFloat4
+    {
+        using type = XMFLOAT4;
+        static XMVECTOR Load(const XMFLOAT4* p) noexcept { return XMLoadFloat4(p); }
+    };
+
+    struct LoadHalf4
+    {
+        using type = XMHALF4;
+        static XMVECTOR Load(const XMHALF4* p) noexcept { return XMLoadHalf4(p); }
+    };
+
+    struct NoSaturate
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) noexcept { return v; }
+    };
+
+    // ConvertScanline for FLOAT -> UNORM
+    struct Saturate
+    {
+        static XMVECTOR XM_CALLCONV Apply(FXMVECTOR v) noexcept { return XMVectorSaturate(v); }
+    };
+
+    struct StoreFloat4
+    {
+        using type = XMFLOAT4;
+        static void XM_CALLCONV Store(XMFLOAT4* p, FXMVECTOR v) noexcept { XMStoreFloat4(p, v); }
+    };
+
+    struct StoreHalf4
+    {
+        using type = XMHALF4;
+        static void XM_CALLCONV Store(XMHALF4* p, FXMVECTOR v) noexcept { XMStoreHalf4(p, XMVectorClamp(v, g_HalfMin, g_HalfMax)); }
+    };
+
+    struct StoreUShortN4
+    {
+        using type = XMUSHORTN4;
+        static void XM_CALLCONV Store(XMUSHORTN4* p, FXMVECTOR v) noexcept { XMStoreUShortN4(p, v); }
+    };
+
+    struct StoreUDecN4
+    {
+        using type = XMUDECN4;
+        static void XM_CALLCONV Store(XMUDECN4* p, FXMVECTOR v) noexcept { XMStoreUDecN4(p, v); }
+    };
+
+    struct StoreRGBA8
+    {
+        using type = XMUBYTEN4;
+        static void XM_CALLCONV Store(XMUBYTEN4* p, FXMVECTOR v) noexcept { XMStoreUByteN4(p, XMVectorAdd(v, g_8BitBiasV)); }
+    };
+
+    struct StoreBGRA8
+    {
+        using type = XMUBYTEN4;
+        static void XM_CALLCONV Store(XMUBYTEN4* p, FXMVECTOR v) noexcept
+        {
+            const XMVECTOR t = XMVectorSwizzle<2, 1, 0, 3>(v);
+            XMStoreUByteN4(p, XMVectorAdd(t, g_8BitBiasV));
+        }
+    };
+
+    struct StoreBGRX8
+    {
+        using type = XMUBYTEN4;
+        static void XM_CALLCONV Store(XMUBYTEN4* p, FXMVECTOR v) noexcept
+        {
+            const XMVECTOR t = XMVectorPermute<2, 1, 0, 7>(v, g_XMIdentityR3);
+            XMStoreUByteN4(p, XMVectorAdd(t, g_8BitBiasV));
+        }
+    };
+
+    template<class TLoad, class TConvert, class TStore>
+    void FusedKernel(void* pDestination, const void* pSource, size_t count, const ScanlineTables*) noexcept
+    {
+        const typename TLoad::type * __restrict sPtr = static_cast<const typename TLoad::type*>(pSource);
+        typename TStore::type * __restrict dPtr = static_cast<typename TStore::type*>(pDestination);
+        for (size_t i = 0; i < count; ++i)
+        {
+            TStore::Store(dPtr++, TConvert::Apply(TLoad::Load(sPtr++)));
+        }
+    }
+
+    template<class TLoad, class TConvert>
+    ScanlineConverter::Kernel SelectFusedKernel(DXGI_FORMAT outFormat) noexcept
+    {
+        switch (outFormat)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return FusedKernel<TLoad, TConvert, StoreFloat4>;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            return FusedKernel<TLoad, TConvert, StoreHalf4>;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            return FusedKernel<TLoad, TConvert, StoreUShortN4>;
+
+        case DXGI_FORMAT_R10G10B10A2_UNORM:
+            return FusedKernel<TLoad, TConvert, StoreUDecN4>;
+
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+            return FusedKernel<TLoad, TConvert, StoreRGBA8>;
+
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+            return FusedKernel<TLoad, TConvert, StoreBGRA8>;
+
+        case DXGI_FORMAT_B8G8R8X8_UNORM:
+        case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+            return FusedKernel<TLoad, TConvert, StoreBGRX8>;
+
+        default:
+            return nullptr;
+        }
+    }
+}
+
+DirectX::Internal::ScanlineConverter::ScanlineConverter() noexcept :
+    m_kernel(nullptr)
+{
+}
+
+DirectX::Internal::ScanlineConverter::~ScanlineConverter() = default;
+
+_Use_decl_annotations_
+bool DirectX::Internal::ScanlineConverter::Initialize(
+    DXGI_FORMAT outFormat,
+    DXGI_FORMAT inFormat,
+    TEX_FILTER_FLAGS flags,
+    bool convert) noexcept
+{
+    m_kernel = nullptr;
+    m_tables.reset();
+
+    if (flags & TEX_FILTER_DITHER_MASK)
+        return false;
+
+    const ScanlineLayout* in = FindScanlineLayout(inFormat);
+    const ScanlineLayout* out = FindScanlineLayout(outFormat);
+    if (!in || !out || in == out)
+        return false;
+
+    if (!in->packed)
+    {
+        // For float sources ConvertScanline only saturates UNORM targets, as long as there is
+        // no sRGB or x2 bias handling to do
+        if (convert && ((flags & (TEX_FILTER_SRGB | TEX_FILTER_FLOAT_X2BIAS)) || IsSRGB(outFormat)))
+            return false;
+
+        const bool saturate = convert
+            && (outFormat != DXGI_FORMAT_R32G32B32A32_FLOAT)
+            && (outFormat != DXGI_FORMAT_R16G16B16A16_FLOAT);
+
+        switch (inFormat)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            m_kernel = (saturate) ? SelectFusedKernel<LoadFloat4, Saturate>(outFormat)
+                : SelectFusedKernel<LoadFloat4, NoSaturate>(outFormat);
+            break;
+
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            if (outFormat == DXGI_FORMAT_R32G32B32A32_FLOAT)
+            {
+                m_kernel = HalfToFloatKernel;
+            }
+            else
+            {
+                m_kernel = (saturate) ? SelectFusedKernel<LoadHalf4, Saturate>(outFormat)
+                    : SelectFusedKernel<LoadHalf4, NoSaturate>(outFormat);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        return (m_kernel != nullptr);
+    }
+
+    // Packed sources have at most 10 bits per channel, and with four channels in and out every
+    // channel converts independently, so a table per channel built by running the generic path
+    // over a ramp gives the same result
+    uint32_t maxBits = 0;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        maxBits = std::max(maxBits, in->bits[c]);
+    }
+
+    const size_t lutSize = size_t(1) << maxBits;
+    const size_t outRowPitch = lutSize * out->bytesPerPixel;
+
+    std::unique_ptr<ScanlineTables> tables(new (std::nothrow) ScanlineTables);
+    if (!tables)
+        return false;
+
+    tables->lut.reset(new (std::nothrow) uint32_t[lutSize * 4]);
+    std::unique_ptr<uint32_t[]> source(new (std::nothrow) uint32_t[lutSize]);
+    std::unique_ptr<uint8_t[]> dest(new (std::nothrow) uint8_t[outRowPitch * 2]);
+    auto scanline = make_AlignedArrayXMVECTOR(lutSize);
+    if (!tables->lut || !source || !dest || !scanline)
+        return false;
+
+    tables->lutSize = lutSize;
+    tables->keep = tables->move = tables->fill = 0;
+    for (size_t c = 0; c < 4; ++c)
+    {
+        tables->shift[c] = FieldShift(*in, c);
+        tables->mask[c] = FieldMask(*in, c);
+        tables->element[c] = in->channel[c];
+    }
+
+    for (uint32_t v = 0; v < lutSize; ++v)
+    {
+        uint32_t p = 0;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            p |= (v & tables->mask[c]) << tables->shift[c];
+        }
+        source[v] = p;
+    }
+
+    if (!ConvertScanlineGeneric(dest.get(), *out, source.get(), *in, scanline.get(), lutSize, flags, convert))
+        return false;
+
+    for (size_t c = 0; c < 4; ++c)
+    {
+        uint32_t* lut = tables->lut.get() + c * lutSize;
+        if (out->packed)
+        {
+            const size_t j = FieldIndex(*out, in->channel[c]);
+            const uint32_t fieldMask = FieldMask(*out, j) << FieldShift(*out, j);
+            auto pixels = reinterpret_cast<const uint32_t*>(dest.get());
+            for (size_t v = 0; v < lutSize; ++v)
+            {
+                lut[v] = pixels[v] & fieldMask;
+            }
+        }
+        else if (out->bytesPerPixel == sizeof(uint16_t) * 4)
+        {
+            auto elements = reinterpret_cast<const uint16_t*>(dest.get());
+            for (size_t v = 0; v < lutSize; ++v)
+            {
+                lut[v] = elements[v * 4 + in->channel[c]];
+            }
+        }
+        else
+        {
+            auto elements = reinterpret_cast<const uint32_t*>(dest.get());
+            for (size_t v = 0; v < lutSize; ++v)
+            {
+                lut[v] = elements[v * 4 + in->channel[c]];
+            }
+        }
+    }
+
+    if (!out->packed)
+    {
+        m_kernel = (out->bytesPerPixel == sizeof(uint16_t) * 4) ? LUTElementKernel<uint16_t> : LUTElementKernel<uint32_t>;
+    }
+    else
+    {
+        m_kernel = LUTPackedKernel;
+
+        if (maxBits == 8 && out->bits[0] == 8)
+        {
+            // Channels that come through unchanged need no table: a byte shuffle will do
+            bool shuffle = true;
+            for (size_t c = 0; c < 4 && shuffle; ++c)
+            {
+                const uint32_t* lut = tables->lut.get() + c * lutSize;
+                const uint32_t from = tables->shift[c];
+                const uint32_t to = FieldShift(*out, FieldIndex(*out, in->channel[c]));
+
+                bool copied = true;
+                bool constant = true;
+                for (uint32_t v = 0; v < lutSize; ++v)
+                {
+                    copied = copied && (lut[v] == (v << to));
+                    constant = constant && (lut[v] == lut[0]);
+                }
+
+                if (copied && from == to)
+                {
+                    tables->keep |= 0xFFu << to;
+                }
+                else if (copied && (from + to) == 16)
+                {
+                    tables->move |= 0xFFu << from;
+                }
+                else if (constant)
+                {
+                    tables->fill |= lut[0];
+                }
+                else
+                {
+                    shuffle = false;
+                }
+            }
+
+            if (shuffle && (!tables->move || tables->move == 0x00FF00FF))
+            {
+                m_kernel = SwizzleKernel;
+            }
+        }
+    }
+
+    // The tables rely on no channel affecting another; check that against the generic path
+    // with pixels whose channels all differ
+    for (uint32_t v = 0; v < lutSize; ++v)
+    {
+        uint32_t p = 0;
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            p |= ((v * (2 * c + 3) + c * 0x35) & tables->mask[c]) << tables->shift[c];
+        }
+        source[v] = p;
+    }
+
+    uint8_t* expected = dest.get();
+    uint8_t* actual = expected + outRowPitch;
+    if (!ConvertScanlineGeneric(expected, *out, source.get(), *in, scanline.get(), lutSize, flags, convert))
+    {
+        m_kernel = nullptr;
+        return false;
+    }
+
+    m_kernel(actual, source.get(), lutSize, tables.get());
+    if (memcmp(expected, actual, outRowPitch) != 0)
+    {
+        m_kernel = nullptr;
+        return false;
+    }
+
+    m_tables = std::move(tables);
+    return true;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Dithering
 //-------------------------------------------------------------------------------------
@@ -4885,6 +5455,9 @@ namespace
             else
             {
                 // No dithering
+                ScanlineConverter direct;
+                const bool useDirect = direct.Initialize(destImage.format, srcImage.format, filter);
+
                 for (size_t h = 0; h < srcImage.height; ++h)
                 {
                     if (statusCallback)
@@ -4895,13 +5468,20 @@ namespace
                         }
                     }
 
-                    if (!LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
-                        return E_FAIL;
+                    if (useDirect)
+                    {
+                        direct.Convert(pDest, pSrc, width);
+                    }
+                    else
+                    {
+                        if (!LoadScanline(scanline.get(), width, pSrc, srcImage.rowPitch, srcImage.format))
+                            return E_FAIL;
 
-                    ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
+                        ConvertScanline(scanline.get(), width, destImage.format, srcImage.format, filter);
 
-                    if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold))
-                        return E_FAIL;
+                        if (!StoreScanline(pDest, destImage.rowPitch, destImage.format, scanline.get(), width, threshold))
+                            return E_FAIL;
+                    }
 
                     pSrc += srcImage.rowPitch;
                     pDest += destImage.rowPitch;
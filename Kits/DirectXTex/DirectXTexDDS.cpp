@@ -1514,6 +1514,170 @@ namespace
         }
     }
 
+    //-------------------------------------------------------------------------------------
+    // Adds the source pitch rules for legacy formats that are expanded on load
+    //-------------------------------------------------------------------------------------
+    CP_FLAGS GetSourcePitchFlags(CP_FLAGS cpFlags, uint32_t convFlags) noexcept
+    {
+        if (convFlags & CONV_FLAGS_EXPAND)
+        {
+            if (convFlags & CONV_FLAGS_888)
+                cpFlags |= CP_FLAGS_24BPP;
+            else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8 | CONV_FLAGS_L6V5U5))
+                cpFlags |= CP_FLAGS_16BPP;
+            else if (convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8))
+                cpFlags |= CP_FLAGS_8BPP;
+        }
+
+        return cpFlags;
+    }
+
+    //-------------------------------------------------------------------------------------
+    // Converts or copies one subresource, which can have a different row pitch from the
+    // source. For DDS_FLAGS_BAD_DXTN_TAILS, tail is the source image of the last mip level
+    // that was at least 4x4, which replaces the data of levels smaller than a block.
+    //-------------------------------------------------------------------------------------
+    HRESULT CopySubresource(
+        _In_ const Image& src,
+        _In_ const Image& dest,
+        _In_opt_ const Image* tail,
+        _In_ const TexMetadata& metadata,
+        _In_ uint32_t convFlags,
+        _In_ uint32_t tflags,
+        _In_reads_opt_(256) const uint32_t *pal8) noexcept
+    {
+        if (dest.height != src.height)
+            return E_FAIL;
+
+        const size_t dpitch = dest.rowPitch;
+        const size_t spitch = src.rowPitch;
+
+        const uint8_t *pSrc = src.pixels;
+        if (!pSrc)
+            return E_POINTER;
+
+        uint8_t *pDest = dest.pixels;
+        if (!pDest)
+            return E_POINTER;
+
+        if (IsCompressed(metadata.format))
+        {
+            size_t spitchBlocks = spitch;
+            size_t sslice = src.slicePitch;
+            if (tail)
+            {
+                // The start of the tail level is read as if it were packed at this level's size
+                size_t slicePitch;
+                HRESULT hr = ComputePitch(metadata.format, dest.width, dest.height, spitchBlocks, slicePitch, CP_FLAGS_NONE);
+                if (FAILED(hr))
+                    return hr;
+
+                pSrc = tail->pixels;
+                sslice = tail->slicePitch;
+            }
+
+            if (dpitch == spitchBlocks)
+            {
+                memcpy(pDest, pSrc, std::min<size_t>(dest.slicePitch, sslice));
+            }
+            else
+            {
+                const size_t count = ComputeScanlines(metadata.format, dest.height);
+                if (!count || (count * spitchBlocks) > sslice)
+                    return E_UNEXPECTED;
+
+                const size_t csize = std::min<size_t>(dpitch, spitchBlocks);
+                for (size_t h = 0; h < count; ++h)
+                {
+                    memcpy(pDest, pSrc, csize);
+                    pSrc += spitchBlocks;
+                    pDest += dpitch;
+                }
+            }
+        }
+        else if (IsPlanar(metadata.format))
+        {
+            if (metadata.dimension == TEX_DIMENSION_TEXTURE3D)
+            {
+                // Direct3D does not support any planar formats for Texture3D
+                return HRESULT_E_NOT_SUPPORTED;
+            }
+
+            const size_t count = ComputeScanlines(metadata.format, dest.height);
+            if (!count)
+                return E_UNEXPECTED;
+
+            const size_t csize = std::min<size_t>(dpitch, spitch);
+            for (size_t h = 0; h < count; ++h)
+            {
+                memcpy(pDest, pSrc, csize);
+                pSrc += spitch;
+                pDest += dpitch;
+            }
+        }
+        else
+        {
+            for (size_t h = 0; h < dest.height; ++h)
+            {
+                if (convFlags & CONV_FLAGS_EXPAND)
+                {
+                    if (convFlags & CONV_FLAGS_4444)
+                    {
+                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
+                            pSrc, spitch,
+                            (convFlags & CONF_FLAGS_11ON12) ? WIN11_DXGI_FORMAT_A4B4G4R4_UNORM : DXGI_FORMAT_B4G4R4A4_UNORM,
+                            tflags))
+                            return E_FAIL;
+                    }
+                    else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551))
+                    {
+                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
+                            pSrc, spitch,
+                            (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
+                            tflags))
+                            return E_FAIL;
+                    }
+                    else
+                    {
+                        const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
+                        if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
+                            pSrc, spitch, lformat, pal8,
+                            tflags))
+                            return E_FAIL;
+                    }
+                }
+                else if (convFlags & CONV_FLAGS_SWIZZLE)
+                {
+                    SwizzleScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
+                }
+                else if (convFlags & (CONV_FLAGS_L8U8V8 | CONV_FLAGS_WUV10))
+                {
+                    const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
+                    if (!LegacyConvertScanline(pDest, dpitch, metadata.format,
+                        pSrc, spitch, lformat, tflags))
+                        return E_FAIL;
+                }
+                else
+                {
+                    CopyScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
+                }
+
+                pSrc += spitch;
+                pDest += dpitch;
+            }
+        }
+
+        return S_OK;
+    }
+
+    uint32_t GetScanlineFlags(uint32_t convFlags) noexcept
+    {
+        uint32_t tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0u;
+        if (convFlags & CONV_FLAGS_SWIZZLE)
+            tflags |= TEXP_SCANLINE_LEGACY;
+        return tflags;
+    }
+
     //-------------------------------------------------------------------------------------
     // Converts or copies image data from pPixels into scratch image data
     //-------------------------------------------------------------------------------------
@@ -1532,15 +1696,7 @@ namespace
         if (!size)
             return E_FAIL;
 
-        if (convFlags & CONV_FLAGS_EXPAND)
-        {
-            if (convFlags & CONV_FLAGS_888)
-                cpFlags |= CP_FLAGS_24BPP;
-            else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551 | CONV_FLAGS_4444 | CONV_FLAGS_8332 | CONV_FLAGS_A8P8 | CONV_FLAGS_L16 | CONV_FLAGS_A8L8 | CONV_FLAGS_L6V5U5))
-                cpFlags |= CP_FLAGS_16BPP;
-            else if (convFlags & (CONV_FLAGS_44 | CONV_FLAGS_332 | CONV_FLAGS_PAL8 | CONV_FLAGS_L8))
-                cpFlags |= CP_FLAGS_8BPP;
-        }
+        cpFlags = GetSourcePitchFlags(cpFlags, convFlags);
 
         size_t pixelSize, nimages;
         HRESULT hr = DetermineImageArray(metadata, cpFlags, nimages, pixelSize);
@@ -1585,9 +1741,8 @@ namespace
             return E_FAIL;
         }
 
-        uint32_t tflags = (convFlags & CONV_FLAGS_NOALPHA) ? TEXP_SCANLINE_SETALPHA : 0u;
-        if (convFlags & CONV_FLAGS_SWIZZLE)
-            tflags |= TEXP_SCANLINE_LEGACY;
+        const uint32_t tflags = GetScanlineFlags(convFlags);
+        const bool badTails = (cpFlags & CP_FLAGS_BAD_DXTN_TAILS) && IsCompressed(metadata.format);
 
         switch (metadata.dimension)
         {
@@ -1603,103 +1758,18 @@ namespace
                         if (index >= nimages)
                             return E_FAIL;
 
-                        if (images[index].height != timages[index].height)
-                            return E_FAIL;
-
-                        size_t dpitch = images[index].rowPitch;
-                        const size_t spitch = timages[index].rowPitch;
-
-                        const uint8_t *pSrc = timages[index].pixels;
-                        if (!pSrc)
-                            return E_POINTER;
-
-                        uint8_t *pDest = images[index].pixels;
-                        if (!pDest)
-                            return E_POINTER;
-
-                        if (IsCompressed(metadata.format))
+                        const Image* tail = nullptr;
+                        if (badTails)
                         {
-                            size_t csize = std::min<size_t>(images[index].slicePitch, timages[index].slicePitch);
-                            memcpy(pDest, pSrc, csize);
-
-                            if (cpFlags & CP_FLAGS_BAD_DXTN_TAILS)
-                            {
-                                if (images[index].width < 4 || images[index].height < 4)
-                                {
-                                    csize = std::min<size_t>(images[index].slicePitch, timages[lastgood].slicePitch);
-                                    memcpy(pDest, timages[lastgood].pixels, csize);
-                                }
-                                else
-                                {
-                                    lastgood = index;
-                                }
-                            }
+                            if (images[index].width < 4 || images[index].height < 4)
+                                tail = &timages[lastgood];
+                            else
+                                lastgood = index;
                         }
-                        else if (IsPlanar(metadata.format))
-                        {
-                            const size_t count = ComputeScanlines(metadata.format, images[index].height);
-                            if (!count)
-                                return E_UNEXPECTED;
 
-                            const size_t csize = std::min<size_t>(dpitch, spitch);
-                            for (size_t h = 0; h < count; ++h)
-                            {
-                                memcpy(pDest, pSrc, csize);
-                                pSrc += spitch;
-                                pDest += dpitch;
-                            }
-                        }
-                        else
-                        {
-                            for (size_t h = 0; h < images[index].height; ++h)
-                            {
-                                if (convFlags & CONV_FLAGS_EXPAND)
-                                {
-                                    if (convFlags & CONV_FLAGS_4444)
-                                    {
-                                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                            pSrc, spitch,
-                                            (convFlags & CONF_FLAGS_11ON12) ? WIN11_DXGI_FORMAT_A4B4G4R4_UNORM : DXGI_FORMAT_B4G4R4A4_UNORM,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                    else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551))
-                                    {
-                                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                            pSrc, spitch,
-                                            (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                    else
-                                    {
-                                        const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
-                                        if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                            pSrc, spitch, lformat, pal8,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                }
-                                else if (convFlags & CONV_FLAGS_SWIZZLE)
-                                {
-                                    SwizzleScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                                }
-                                else if (convFlags & (CONV_FLAGS_L8U8V8 | CONV_FLAGS_WUV10))
-                                {
-                                    const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
-                                    if (!LegacyConvertScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    CopyScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                                }
-
-                                pSrc += spitch;
-                                pDest += dpitch;
-                            }
-                        }
+                        hr = CopySubresource(timages[index], images[index], tail, metadata, convFlags, tflags, pal8);
+                        if (FAILED(hr))
+                            return hr;
                     }
                 }
             }
@@ -1718,94 +1788,18 @@ namespace
                         if (index >= nimages)
                             return E_FAIL;
 
-                        if (images[index].height != timages[index].height)
-                            return E_FAIL;
-
-                        size_t dpitch = images[index].rowPitch;
-                        const size_t spitch = timages[index].rowPitch;
-
-                        const uint8_t *pSrc = timages[index].pixels;
-                        if (!pSrc)
-                            return E_POINTER;
-
-                        uint8_t *pDest = images[index].pixels;
-                        if (!pDest)
-                            return E_POINTER;
-
-                        if (IsCompressed(metadata.format))
-                        {
-                            size_t csize = std::min<size_t>(images[index].slicePitch, timages[index].slicePitch);
-                            memcpy(pDest, pSrc, csize);
-
-                            if (cpFlags & CP_FLAGS_BAD_DXTN_TAILS)
-                            {
-                                if (images[index].width < 4 || images[index].height < 4)
-                                {
-                                    csize = std::min<size_t>(images[index].slicePitch, timages[lastgood + slice].slicePitch);
-                                    memcpy(pDest, timages[lastgood + slice].pixels, csize);
-                                }
-                                else if (!slice)
-                                {
-                                    lastgood = index;
-                                }
-                            }
-                        }
-                        else if (IsPlanar(metadata.format))
-                        {
-                            // Direct3D does not support any planar formats for Texture3D
-                            return HRESULT_E_NOT_SUPPORTED;
-                        }
-                        else
+                        const Image* tail = nullptr;
+                        if (badTails)
                         {
-                            for (size_t h = 0; h < images[index].height; ++h)
-                            {
-                                if (convFlags & CONV_FLAGS_EXPAND)
-                                {
-                                    if (convFlags & CONV_FLAGS_4444)
-                                    {
-                                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                            pSrc, spitch,
-                                            (convFlags & CONF_FLAGS_11ON12) ? WIN11_DXGI_FORMAT_A4B4G4R4_UNORM : DXGI_FORMAT_B4G4R4A4_UNORM,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                    else if (convFlags & (CONV_FLAGS_565 | CONV_FLAGS_5551))
-                                    {
-                                        if (!ExpandScanline(pDest, dpitch, DXGI_FORMAT_R8G8B8A8_UNORM,
-                                            pSrc, spitch,
-                                            (convFlags & CONV_FLAGS_565) ? DXGI_FORMAT_B5G6R5_UNORM : DXGI_FORMAT_B5G5R5A1_UNORM,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                    else
-                                    {
-                                        const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
-                                        if (!LegacyExpandScanline(pDest, dpitch, metadata.format,
-                                            pSrc, spitch, lformat, pal8,
-                                            tflags))
-                                            return E_FAIL;
-                                    }
-                                }
-                                else if (convFlags & CONV_FLAGS_SWIZZLE)
-                                {
-                                    SwizzleScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                                }
-                                else if (convFlags & (CONV_FLAGS_L8U8V8 | CONV_FLAGS_WUV10))
-                                {
-                                    const TEXP_LEGACY_FORMAT lformat = FindLegacyFormat(convFlags);
-                                    if (!LegacyConvertScanline(pDest, dpitch, metadata.format,
-                                        pSrc, spitch, lformat, tflags))
-                                        return E_FAIL;
-                                }
-                                else
-                                {
-                                    CopyScanline(pDest, dpitch, pSrc, spitch, metadata.format, tflags);
-                                }
-
-                                pSrc += spitch;
-                                pDest += dpitch;
-                            }
+                            if (images[index].width < 4 || images[index].height < 4)
+                                tail = &timages[lastgood + slice];
+                            else if (!slice)
+                                lastgood = index;
                         }
+
+                        hr = CopySubresource(timages[index], images[index], tail, metadata, convFlags, tflags, pal8);
+                        if (FAILED(hr))
+                            return hr;
                     }
 
                     if (d > 1)
@@ -2396,6 +2390,374 @@ HRESULT DirectX::LoadFromDDSFileEx(
 }
 
 
+//-------------------------------------------------------------------------------------
+// Memory-mapped DDS file
+//-------------------------------------------------------------------------------------
+struct MappedDDSFile::Impl
+{
+    TexMetadata                 metadata;
+    DDS_FLAGS                   flags;
+    uint32_t                    convFlags;
+    CP_FLAGS                    cpFlags;
+
+    const uint8_t*              pixels;         // Pixel data following the headers and palette
+    size_t                      pixelSize;
+    const uint32_t*             pal8;
+
+    size_t                      nimages;
+    std::unique_ptr<Image[]>    source;         // Views of the pixel data as stored in the file
+    bool                        direct;
+
+    // Reading a page of the view fails with an access violation (SIGBUS on POSIX) if the
+    // file is truncated by another process while it is mapped, so the file is opened
+    // without write sharing.
+    void*                       view;
+    size_t                      viewSize;
+
+    Impl() noexcept :
+        metadata{},
+        flags(DDS_FLAGS_NONE),
+        convFlags(0),
+        cpFlags(CP_FLAGS_NONE),
+        pixels(nullptr),
+        pixelSize(0),
+        pal8(nullptr),
+        nimages(0),
+        direct(false),
+        view(nullptr),
+        viewSize(0) {}
+
+    ~Impl()
+    {
+        if (view)
+        {
+        #ifdef _WIN32
+            std::ignore = UnmapViewOfFile(view);
+        #else
+            std::ignore = munmap(view, viewSize);
+        #endif
+        }
+    }
+
+    Impl(const Impl&) = delete;
+    Impl& operator=(const Impl&) = delete;
+
+    HRESULT Map(_In_z_ const wchar_t* szFile) noexcept
+    {
+    #ifdef _WIN32
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            szFile,
+            GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+            nullptr)));
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        FILE_STANDARD_INFO fileInfo;
+        if (!GetFileInformationByHandleEx(hFile.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        // Same limit as LoadFromDDSFile (4 GB should be plenty large enough for a valid DDS file)
+        if (fileInfo.EndOfFile.HighPart > 0)
+            return HRESULT_E_FILE_TOO_LARGE;
+
+        const size_t len = fileInfo.EndOfFile.LowPart;
+        if (len < DDS_MIN_HEADER_SIZE)
+            return E_FAIL;
+
+        // The view keeps the mapping and the file open, so both handles are closed on return
+        ScopedHandle hMapping(CreateFileMappingW(hFile.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!hMapping)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        view = MapViewOfFile(hMapping.get(), FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+    #else // !WIN32
+        const int fd = open(std::filesystem::path(szFile).c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            return E_FAIL;
+
+        struct stat st = {};
+        if (fstat(fd, &st) != 0)
+        {
+            std::ignore = close(fd);
+            return E_FAIL;
+        }
+
+        if (static_cast<uint64_t>(st.st_size) > UINT32_MAX)
+        {
+            std::ignore = close(fd);
+            return HRESULT_E_FILE_TOO_LARGE;
+        }
+
+        const auto len = static_cast<size_t>(st.st_size);
+        if (len < DDS_MIN_HEADER_SIZE)
+        {
+            std::ignore = close(fd);
+            return E_FAIL;
+        }
+
+        void* ptr = mmap(nullptr, len, PROT_READ, MAP_PRIVATE, fd, 0);
+        std::ignore = close(fd);
+        if (ptr == MAP_FAILED)
+            return E_FAIL;
+
+        view = ptr;
+    #endif
+
+        viewSize = len;
+        return S_OK;
+    }
+
+    HRESULT Initialize(DDS_FLAGS ddsFlags, _Out_opt_ DDSMetaData* ddPixelFormat) noexcept
+    {
+        auto pSource = static_cast<const uint8_t*>(view);
+
+        flags = ddsFlags;
+        HRESULT hr = DecodeDDSHeader(pSource, viewSize, flags, metadata, ddPixelFormat, convFlags);
+        if (FAILED(hr))
+            return hr;
+
+        size_t offset = DDS_MIN_HEADER_SIZE;
+        if (convFlags & CONV_FLAGS_DX10)
+            offset += sizeof(DDS_HEADER_DXT10);
+
+        if (convFlags & CONV_FLAGS_PAL8)
+        {
+            pal8 = reinterpret_cast<const uint32_t*>(pSource + offset);
+            offset += (256 * sizeof(uint32_t));
+        }
+
+        if (viewSize <= offset)
+            return E_FAIL;
+
+        pixels = pSource + offset;
+        pixelSize = viewSize - offset;
+
+        if (flags & DDS_FLAGS_LEGACY_DWORD)
+        {
+            cpFlags |= CP_FLAGS_LEGACY_DWORD;
+        }
+        if (flags & DDS_FLAGS_BAD_DXTN_TAILS)
+        {
+            cpFlags |= CP_FLAGS_BAD_DXTN_TAILS;
+        }
+
+        size_t loadedSize;
+        hr = DetermineImageArray(metadata, CP_FLAGS_NONE, nimages, loadedSize);
+        if (FAILED(hr))
+            return hr;
+
+        if (flags & DDS_FLAGS_PERMISSIVE)
+        {
+            // Cubemap arraySize written as 6*numCubes, as handled by LoadFromDDSFile
+            if ((metadata.miscFlags & TEX_MISC_TEXTURECUBE)
+                && (convFlags & CONV_FLAGS_DX10)
+                && (loadedSize > pixelSize)
+                && ((metadata.arraySize % 6) == 0))
+            {
+                metadata.arraySize = metadata.arraySize / 6;
+            }
+        }
+
+        const CP_FLAGS sourceFlags = GetSourcePitchFlags(cpFlags, convFlags);
+
+        size_t sourceSize;
+        hr = DetermineImageArray(metadata, sourceFlags, nimages, sourceSize);
+        if (FAILED(hr))
+            return hr;
+
+        if (!nimages)
+            return E_FAIL;
+
+        if (sourceSize > pixelSize)
+            return HRESULT_E_HANDLE_EOF;
+
+        source.reset(new (std::nothrow) Image[nimages]);
+        if (!source)
+            return E_OUTOFMEMORY;
+
+        if (!SetupImageArray(
+            const_cast<uint8_t*>(pixels),
+            sourceSize,
+            metadata,
+            sourceFlags,
+            source.get(),
+            nimages))
+        {
+            return E_FAIL;
+        }
+
+        direct = !(convFlags & (CONV_FLAGS_EXPAND | CONV_FLAGS_SWIZZLE | CONV_FLAGS_NOALPHA | CONV_FLAGS_L8U8V8 | CONV_FLAGS_WUV10))
+            && !((cpFlags & CP_FLAGS_BAD_DXTN_TAILS) && IsCompressed(metadata.format));
+
+        return S_OK;
+    }
+};
+
+MappedDDSFile& MappedDDSFile::operator= (MappedDDSFile&& moveFrom) noexcept
+{
+    if (this != &moveFrom)
+    {
+        Release();
+
+        m_impl = moveFrom.m_impl;
+        moveFrom.m_impl = nullptr;
+    }
+    return *this;
+}
+
+void MappedDDSFile::Release() noexcept
+{
+    delete m_impl;
+    m_impl = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT MappedDDSFile::Open(
+    const wchar_t* szFile,
+    DDS_FLAGS flags,
+    DDSMetaData* ddPixelFormat) noexcept
+{
+    if (!szFile)
+        return E_INVALIDARG;
+
+    Release();
+
+    std::unique_ptr<Impl> impl(new (std::nothrow) Impl);
+    if (!impl)
+        return E_OUTOFMEMORY;
+
+    HRESULT hr = impl->Map(szFile);
+    if (FAILED(hr))
+        return hr;
+
+    hr = impl->Initialize(flags, ddPixelFormat);
+    if (FAILED(hr))
+        return hr;
+
+    m_impl = impl.release();
+    return S_OK;
+}
+
+const TexMetadata& MappedDDSFile::GetMetadata() const noexcept
+{
+    static const TexMetadata s_empty = {};
+    return (m_impl) ? m_impl->metadata : s_empty;
+}
+
+bool MappedDDSFile::IsDirect() const noexcept
+{
+    return m_impl && m_impl->direct;
+}
+
+_Use_decl_annotations_
+const Image* MappedDDSFile::GetImage(size_t mip, size_t item, size_t slice) const noexcept
+{
+    if (!IsDirect())
+        return nullptr;
+
+    const size_t index = m_impl->metadata.ComputeIndex(mip, item, slice);
+    if (index >= m_impl->nimages)
+        return nullptr;
+
+    return &m_impl->source[index];
+}
+
+const Image* MappedDDSFile::GetImages() const noexcept
+{
+    return (IsDirect()) ? m_impl->source.get() : nullptr;
+}
+
+size_t MappedDDSFile::GetImageCount() const noexcept
+{
+    return (IsDirect()) ? m_impl->nimages : 0;
+}
+
+_Use_decl_annotations_
+HRESULT MappedDDSFile::ReadImage(size_t mip, size_t item, size_t slice, const Image& destImage) const noexcept
+{
+    if (!m_impl)
+        return E_UNEXPECTED;
+
+    if (!destImage.pixels)
+        return E_POINTER;
+
+    const TexMetadata& metadata = m_impl->metadata;
+
+    const size_t index = metadata.ComputeIndex(mip, item, slice);
+    if (index >= m_impl->nimages)
+        return E_INVALIDARG;
+
+    const Image& src = m_impl->source[index];
+    if (destImage.format != metadata.format || destImage.width != src.width || destImage.height != src.height)
+        return E_INVALIDARG;
+
+    size_t rowPitch, slicePitch;
+    HRESULT hr = ComputePitch(metadata.format, src.width, src.height, rowPitch, slicePitch, CP_FLAGS_NONE);
+    if (FAILED(hr))
+        return hr;
+
+    if (destImage.rowPitch < rowPitch || destImage.slicePitch < (slicePitch / rowPitch) * destImage.rowPitch)
+        return E_INVALIDARG;
+
+    // Replays CopyImage's tracking of the last level that was at least a block in size
+    const Image* tail = nullptr;
+    if ((m_impl->cpFlags & CP_FLAGS_BAD_DXTN_TAILS)
+        && IsCompressed(metadata.format)
+        && (src.width < 4 || src.height < 4))
+    {
+        size_t lastgood = 0;
+        for (size_t level = 0; level < mip; ++level)
+        {
+            const size_t first = metadata.ComputeIndex(level, item, 0);
+            if (m_impl->source[first].width >= 4 && m_impl->source[first].height >= 4)
+                lastgood = first;
+        }
+
+        tail = &m_impl->source[lastgood + slice];
+    }
+
+    return CopySubresource(src, destImage, tail, metadata, m_impl->convFlags, GetScanlineFlags(m_impl->convFlags), m_impl->pal8);
+}
+
+_Use_decl_annotations_
+HRESULT MappedDDSFile::Load(ScratchImage& image) const noexcept
+{
+    image.Release();
+
+    if (!m_impl)
+        return E_UNEXPECTED;
+
+    HRESULT hr = image.Initialize(m_impl->metadata);
+    if (FAILED(hr))
+        return hr;
+
+    hr = CopyImage(m_impl->pixels,
+        m_impl->pixelSize,
+        m_impl->metadata,
+        m_impl->cpFlags,
+        m_impl->convFlags,
+        m_impl->pal8,
+        image);
+    if (FAILED(hr))
+    {
+        image.Release();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+
 //-------------------------------------------------------------------------------------
 // Save a DDS file to memory
 //-------------------------------------------------------------------------------------
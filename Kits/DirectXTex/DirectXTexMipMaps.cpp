@@ -12,6 +12,7 @@
 #include "DirectXTexP.h"
 
 #include "filters.h"
+#include "resample.h"
 
 using namespace DirectX;
 using namespace DirectX::Internal;
@@ -683,7 +684,9 @@ namespace
             break;
 
         case TEX_FILTER_TRIANGLE:
-            // WIC does not implement this filter
+        case TEX_FILTER_LANCZOS:
+        case TEX_FILTER_KAISER:
+            // WIC does not implement these filters
             return false;
 
         default:
@@ -1083,525 +1086,6 @@ namespace
     }
 
 
-    //--- 2D Linear Filter ---
-    HRESULT Generate2DMipsLinearFilter(size_t levels, TEX_FILTER_FLAGS filter, const ScratchImage& mipChain, size_t item) noexcept
-    {
-        using namespace DirectX::Filters;
-
-        if (!mipChain.GetImages())
-            return E_INVALIDARG;
-
-        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
-
-        assert(levels > 1);
-
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
-
-        // Allocate temporary space (3 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 3);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<LinearFilter[]> lf(new (std::nothrow) LinearFilter[width + height]);
-        if (!lf)
-            return E_OUTOFMEMORY;
-
-        LinearFilter* lfX = lf.get();
-        LinearFilter* lfY = lf.get() + width;
-
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
-
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
-        {
-            // 2D linear filter
-            const Image* src = mipChain.GetImage(level - 1, item, 0);
-            const Image* dest = mipChain.GetImage(level, item, 0);
-
-            if (!src || !dest)
-                return E_POINTER;
-
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
-            const size_t rowPitch = src->rowPitch;
-
-            const size_t nwidth = (width > 1) ? (width >> 1) : 1;
-            CreateLinearFilter(width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, lfX);
-
-            const size_t nheight = (height > 1) ? (height >> 1) : 1;
-            CreateLinearFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, lfY);
-
-        #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
-        #endif
-
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
-
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                const auto& toY = lfY[y];
-
-                if (toY.u0 != u0)
-                {
-                    if (toY.u0 != u1)
-                    {
-                        u0 = toY.u0;
-
-                        if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else
-                    {
-                        u0 = u1;
-                        u1 = size_t(-1);
-
-                        std::swap(row0, row1);
-                    }
-                }
-
-                if (toY.u1 != u1)
-                {
-                    u1 = toY.u1;
-
-                    if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
-                        return E_FAIL;
-                }
-
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    const auto& toX = lfX[x];
-
-                    BILINEAR_INTERPOLATE(target[x], toX, toY, row0, row1)
-                }
-
-                if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
-
-            if (height > 1)
-                height >>= 1;
-
-            if (width > 1)
-                width >>= 1;
-        }
-
-        return S_OK;
-    }
-
-    //--- 2D Cubic Filter ---
-#ifdef __clang__
-#pragma clang diagnostic ignored "-Wextra-semi-stmt"
-#endif
-
-    HRESULT Generate2DMipsCubicFilter(size_t levels, TEX_FILTER_FLAGS filter, const ScratchImage& mipChain, size_t item) noexcept
-    {
-        using namespace DirectX::Filters;
-
-        if (!mipChain.GetImages())
-            return E_INVALIDARG;
-
-        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
-
-        assert(levels > 1);
-
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
-
-        // Allocate temporary space (5 scanlines, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * 5);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<CubicFilter[]> cf(new (std::nothrow) CubicFilter[width + height]);
-        if (!cf)
-            return E_OUTOFMEMORY;
-
-        CubicFilter* cfX = cf.get();
-        CubicFilter* cfY = cf.get() + width;
-
-        XMVECTOR* target = scanline.get();
-
-        XMVECTOR* row0 = target + width;
-        XMVECTOR* row1 = target + width * 2;
-        XMVECTOR* row2 = target + width * 3;
-        XMVECTOR* row3 = target + width * 4;
-
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
-        {
-            // 2D cubic filter
-            const Image* src = mipChain.GetImage(level - 1, item, 0);
-            const Image* dest = mipChain.GetImage(level, item, 0);
-
-            if (!src || !dest)
-                return E_POINTER;
-
-            const uint8_t* pSrc = src->pixels;
-            uint8_t* pDest = dest->pixels;
-
-            const size_t rowPitch = src->rowPitch;
-
-            const size_t nwidth = (width > 1) ? (width >> 1) : 1;
-            CreateCubicFilter(width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, (filter & TEX_FILTER_MIRROR_U) != 0, cfX);
-
-            const size_t nheight = (height > 1) ? (height >> 1) : 1;
-            CreateCubicFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, (filter & TEX_FILTER_MIRROR_V) != 0, cfY);
-
-        #ifdef _DEBUG
-            memset(row0, 0xCD, sizeof(XMVECTOR)*width);
-            memset(row1, 0xDD, sizeof(XMVECTOR)*width);
-            memset(row2, 0xED, sizeof(XMVECTOR)*width);
-            memset(row3, 0xFD, sizeof(XMVECTOR)*width);
-        #endif
-
-            size_t u0 = size_t(-1);
-            size_t u1 = size_t(-1);
-            size_t u2 = size_t(-1);
-            size_t u3 = size_t(-1);
-
-            for (size_t y = 0; y < nheight; ++y)
-            {
-                const auto& toY = cfY[y];
-
-                // Scanline 1
-                if (toY.u0 != u0)
-                {
-                    if (toY.u0 != u1 && toY.u0 != u2 && toY.u0 != u3)
-                    {
-                        u0 = toY.u0;
-
-                        if (!LoadScanlineLinear(row0, width, pSrc + (rowPitch * u0), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u0 == u1)
-                    {
-                        u0 = u1;
-                        u1 = size_t(-1);
-
-                        std::swap(row0, row1);
-                    }
-                    else if (toY.u0 == u2)
-                    {
-                        u0 = u2;
-                        u2 = size_t(-1);
-
-                        std::swap(row0, row2);
-                    }
-                    else if (toY.u0 == u3)
-                    {
-                        u0 = u3;
-                        u3 = size_t(-1);
-
-                        std::swap(row0, row3);
-                    }
-                }
-
-                // Scanline 2
-                if (toY.u1 != u1)
-                {
-                    if (toY.u1 != u2 && toY.u1 != u3)
-                    {
-                        u1 = toY.u1;
-
-                        if (!LoadScanlineLinear(row1, width, pSrc + (rowPitch * u1), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else if (toY.u1 == u2)
-                    {
-                        u1 = u2;
-                        u2 = size_t(-1);
-
-                        std::swap(row1, row2);
-                    }
-                    else if (toY.u1 == u3)
-                    {
-                        u1 = u3;
-                        u3 = size_t(-1);
-
-                        std::swap(row1, row3);
-                    }
-                }
-
-                // Scanline 3
-                if (toY.u2 != u2)
-                {
-                    if (toY.u2 != u3)
-                    {
-                        u2 = toY.u2;
-
-                        if (!LoadScanlineLinear(row2, width, pSrc + (rowPitch * u2), rowPitch, src->format, filter))
-                            return E_FAIL;
-                    }
-                    else
-                    {
-                        u2 = u3;
-                        u3 = size_t(-1);
-
-                        std::swap(row2, row3);
-                    }
-                }
-
-                // Scanline 4
-                if (toY.u3 != u3)
-                {
-                    u3 = toY.u3;
-
-                    if (!LoadScanlineLinear(row3, width, pSrc + (rowPitch * u3), rowPitch, src->format, filter))
-                        return E_FAIL;
-                }
-
-                for (size_t x = 0; x < nwidth; ++x)
-                {
-                    const auto& toX = cfX[x];
-
-                    XMVECTOR C0, C1, C2, C3;
-
-                    CUBIC_INTERPOLATE(C0, toX.x, row0[toX.u0], row0[toX.u1], row0[toX.u2], row0[toX.u3]);
-                    CUBIC_INTERPOLATE(C1, toX.x, row1[toX.u0], row1[toX.u1], row1[toX.u2], row1[toX.u3]);
-                    CUBIC_INTERPOLATE(C2, toX.x, row2[toX.u0], row2[toX.u1], row2[toX.u2], row2[toX.u3]);
-                    CUBIC_INTERPOLATE(C3, toX.x, row3[toX.u0], row3[toX.u1], row3[toX.u2], row3[toX.u3]);
-
-                    CUBIC_INTERPOLATE(target[x], toY.x, C0, C1, C2, C3);
-                }
-
-                if (!StoreScanlineLinear(pDest, dest->rowPitch, dest->format, target, nwidth, filter))
-                    return E_FAIL;
-                pDest += dest->rowPitch;
-            }
-
-            if (height > 1)
-                height >>= 1;
-
-            if (width > 1)
-                width >>= 1;
-        }
-
-        return S_OK;
-    }
-
-
-    //--- 2D Triangle Filter ---
-    HRESULT Generate2DMipsTriangleFilter(size_t levels, TEX_FILTER_FLAGS filter, const ScratchImage& mipChain, size_t item) noexcept
-    {
-        using namespace DirectX::Filters;
-
-        if (!mipChain.GetImages())
-            return E_INVALIDARG;
-
-        // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
-
-        assert(levels > 1);
-
-        size_t width = mipChain.GetMetadata().width;
-        size_t height = mipChain.GetMetadata().height;
-
-        // Allocate initial temporary space (1 scanline, accumulation rows, plus X and Y filters)
-        auto scanline = make_AlignedArrayXMVECTOR(width);
-        if (!scanline)
-            return E_OUTOFMEMORY;
-
-        std::unique_ptr<TriangleRow[]> rowActive(new (std::nothrow) TriangleRow[height]);
-        if (!rowActive)
-            return E_OUTOFMEMORY;
-
-        TriangleRow * rowFree = nullptr;
-
-        std::unique_ptr<Filter> tfX, tfY;
-
-        XMVECTOR* row = scanline.get();
-
-        // Resize base image to each target mip level
-        for (size_t level = 1; level < levels; ++level)
-        {
-            // 2D triangle filter
-            const Image* src = mipChain.GetImage(level - 1, item, 0);
-            const Image* dest = mipChain.GetImage(level, item, 0);
-
-            if (!src || !dest)
-                return E_POINTER;
-
-            const uint8_t* pSrc = src->pixels;
-            const size_t rowPitch = src->rowPitch;
-            const uint8_t* pEndSrc = pSrc + rowPitch * height;
-
-            uint8_t* pDest = dest->pixels;
-
-            const size_t nwidth = (width > 1) ? (width >> 1) : 1;
-            HRESULT hr = CreateTriangleFilter(width, nwidth, (filter & TEX_FILTER_WRAP_U) != 0, tfX);
-            if (FAILED(hr))
-                return hr;
-
-            const size_t nheight = (height > 1) ? (height >> 1) : 1;
-            hr = CreateTriangleFilter(height, nheight, (filter & TEX_FILTER_WRAP_V) != 0, tfY);
-            if (FAILED(hr))
-                return hr;
-
-        #ifdef _DEBUG
-            memset(row, 0xCD, sizeof(XMVECTOR)*width);
-        #endif
-
-            auto xFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfX.get()) + tfX->sizeInBytes);
-            auto yFromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tfY.get()) + tfY->sizeInBytes);
-
-            // Count times rows get written (and clear out any leftover accumulation rows from last miplevel)
-            for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-            {
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    const size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    ++rowAcc->remaining;
-
-                    if (rowAcc->scanline)
-                    {
-                        memset(rowAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth);
-                    }
-                }
-
-                yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-            }
-
-            // Filter image
-            for (FilterFrom* yFrom = tfY->from; yFrom < yFromEnd; )
-            {
-                // Create accumulation rows as needed
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    const size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    if (!rowAcc->scanline)
-                    {
-                        if (rowFree)
-                        {
-                            // Steal and reuse scanline from 'free row' list
-                            // (it will always be at least as wide as nwidth due to loop decending order)
-                            assert(rowFree->scanline != nullptr);
-                            rowAcc->scanline.reset(rowFree->scanline.release());
-                            rowFree = rowFree->next;
-                        }
-                        else
-                        {
-                            auto nscanline = make_AlignedArrayXMVECTOR(nwidth);
-                            if (!nscanline)
-                                return E_OUTOFMEMORY;
-                            rowAcc->scanline.swap(nscanline);
-                        }
-
-                        memset(rowAcc->scanline.get(), 0, sizeof(XMVECTOR) * nwidth);
-                    }
-                }
-
-                // Load source scanline
-                if ((pSrc + rowPitch) > pEndSrc)
-                    return E_FAIL;
-
-                if (!LoadScanlineLinear(row, width, pSrc, rowPitch, src->format, filter))
-                    return E_FAIL;
-
-                pSrc += rowPitch;
-
-                // Process row
-                size_t x = 0;
-                for (FilterFrom* xFrom = tfX->from; xFrom < xFromEnd; ++x)
-                {
-                    for (size_t j = 0; j < yFrom->count; ++j)
-                    {
-                        const size_t v = yFrom->to[j].u;
-                        assert(v < nheight);
-                        const float yweight = yFrom->to[j].weight;
-
-                        XMVECTOR* accPtr = rowActive[v].scanline.get();
-                        if (!accPtr)
-                            return E_POINTER;
-
-                        for (size_t k = 0; k < xFrom->count; ++k)
-                        {
-                            size_t u = xFrom->to[k].u;
-                            assert(u < nwidth);
-
-                            const XMVECTOR weight = XMVectorReplicate(yweight * xFrom->to[k].weight);
-
-                            assert(x < width);
-                            accPtr[u] = XMVectorMultiplyAdd(row[x], weight, accPtr[u]);
-                        }
-                    }
-
-                    xFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(xFrom) + xFrom->sizeInBytes);
-                }
-
-                // Write completed accumulation rows
-                for (size_t j = 0; j < yFrom->count; ++j)
-                {
-                    size_t v = yFrom->to[j].u;
-                    assert(v < nheight);
-                    TriangleRow* rowAcc = &rowActive[v];
-
-                    assert(rowAcc->remaining > 0);
-                    --rowAcc->remaining;
-
-                    if (!rowAcc->remaining)
-                    {
-                        XMVECTOR* pAccSrc = rowAcc->scanline.get();
-                        if (!pAccSrc)
-                            return E_POINTER;
-
-                        switch (dest->format)
-                        {
-                        case DXGI_FORMAT_R10G10B10A2_UNORM:
-                        case DXGI_FORMAT_R10G10B10A2_UINT:
-                            {
-                                // Need to slightly bias results for floating-point error accumulation which can
-                                // be visible with harshly quantized values
-                                static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
-
-                                XMVECTOR* ptr = pAccSrc;
-                                for (size_t i = 0; i < dest->width; ++i, ++ptr)
-                                {
-                                    *ptr = XMVectorAdd(*ptr, Bias);
-                                }
-                            }
-                            break;
-
-                        default:
-                            break;
-                        }
-
-                        // This performs any required clamping
-                        if (!StoreScanlineLinear(pDest + (dest->rowPitch * v), dest->rowPitch, dest->format, pAccSrc, dest->width, filter))
-                            return E_FAIL;
-
-                        // Put row on freelist to reuse it's allocated scanline
-                        rowAcc->next = rowFree;
-                        rowFree = rowAcc;
-                    }
-                }
-
-                yFrom = reinterpret_cast<FilterFrom*>(reinterpret_cast<uint8_t*>(yFrom) + yFrom->sizeInBytes);
-            }
-
-            if (height > 1)
-                height >>= 1;
-
-            if (width > 1)
-                width >>= 1;
-        }
-
-        return S_OK;
-    }
-
-
     //-------------------------------------------------------------------------------------
     // Generate volume mip-map helpers
     //-------------------------------------------------------------------------------------
@@ -2187,6 +1671,10 @@ namespace
 
 
     //--- 3D Cubic Filter ---
+#ifdef __clang__
+#pragma clang diagnostic ignored "-Wextra-semi-stmt"
+#endif
+
     HRESULT Generate3DMipsCubicFilter(size_t depth, size_t levels, TEX_FILTER_FLAGS filter, const ScratchImage& mipChain) noexcept
     {
         using namespace DirectX::Filters;
@@ -2981,31 +2469,15 @@ HRESULT DirectX::GenerateMipMaps(
             return hr;
 
         case TEX_FILTER_LINEAR:
-            hr = Setup2DMips(&baseImage, 1, mdata, mipChain);
-            if (FAILED(hr))
-                return hr;
-
-            hr = Generate2DMipsLinearFilter(levels, filter, mipChain, 0);
-            if (FAILED(hr))
-                mipChain.Release();
-            return hr;
-
         case TEX_FILTER_CUBIC:
-            hr = Setup2DMips(&baseImage, 1, mdata, mipChain);
-            if (FAILED(hr))
-                return hr;
-
-            hr = Generate2DMipsCubicFilter(levels, filter, mipChain, 0);
-            if (FAILED(hr))
-                mipChain.Release();
-            return hr;
-
         case TEX_FILTER_TRIANGLE:
+        case TEX_FILTER_LANCZOS:
+        case TEX_FILTER_KAISER:
             hr = Setup2DMips(&baseImage, 1, mdata, mipChain);
             if (FAILED(hr))
                 return hr;
 
-            hr = Generate2DMipsTriangleFilter(levels, filter, mipChain, 0);
+            hr = ResampleMipChain(levels, static_cast<TEX_FILTER_FLAGS>((filter & ~TEX_FILTER_MODE_MASK) | filter_select), mipChain, 0);
             if (FAILED(hr))
                 mipChain.Release();
             return hr;
@@ -3202,41 +2674,22 @@ HRESULT DirectX::GenerateMipMaps(
             return hr;
 
         case TEX_FILTER_LINEAR:
-            hr = Setup2DMips(&baseImages[0], metadata.arraySize, mdata2, mipChain);
-            if (FAILED(hr))
-                return hr;
-
-            for (size_t item = 0; item < metadata.arraySize; ++item)
-            {
-                hr = Generate2DMipsLinearFilter(levels, filter, mipChain, item);
-                if (FAILED(hr))
-                    mipChain.Release();
-            }
-            return hr;
-
         case TEX_FILTER_CUBIC:
-            hr = Setup2DMips(&baseImages[0], metadata.arraySize, mdata2, mipChain);
-            if (FAILED(hr))
-                return hr;
-
-            for (size_t item = 0; item < metadata.arraySize; ++item)
-            {
-                hr = Generate2DMipsCubicFilter(levels, filter, mipChain, item);
-                if (FAILED(hr))
-                    mipChain.Release();
-            }
-            return hr;
-
         case TEX_FILTER_TRIANGLE:
+        case TEX_FILTER_LANCZOS:
+        case TEX_FILTER_KAISER:
             hr = Setup2DMips(&baseImages[0], metadata.arraySize, mdata2, mipChain);
             if (FAILED(hr))
                 return hr;
 
             for (size_t item = 0; item < metadata.arraySize; ++item)
             {
-                hr = Generate2DMipsTriangleFilter(levels, filter, mipChain, item);
+                hr = ResampleMipChain(levels, static_cast<TEX_FILTER_FLAGS>((filter & ~TEX_FILTER_MODE_MASK) | filter_select), mipChain, item);
                 if (FAILED(hr))
+                {
                     mipChain.Release();
+                    break;
+                }
             }
             return hr;
 
@@ -156,6 +156,11 @@
 #include <fstream>
 #include <filesystem>
 #include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #define _XM_NO_XMVECTOR_OVERLOADS_
@@ -439,6 +444,56 @@ namespace DirectX
             _Inout_updates_all_(count) XMVECTOR* pBuffer, _In_ size_t count,
             _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat, _In_ TEX_FILTER_FLAGS flags) noexcept;
 
+        //---------------------------------------------------------------------------------
+        // Direct scanline conversion for common format pairs. Initialize picks a kernel once
+        // per image; Convert then produces exactly what LoadScanline, ConvertScanline (when
+        // convert is true) and StoreScanline would, without the XMVECTOR round trip.
+        struct ScanlineTables;
+
+        class ScanlineConverter
+        {
+        public:
+            ScanlineConverter() noexcept;
+            ~ScanlineConverter();
+
+            ScanlineConverter(const ScanlineConverter&) = delete;
+            ScanlineConverter& operator=(const ScanlineConverter&) = delete;
+
+            // Returns false if there is no kernel for the pair (or flags include dithering)
+            bool __cdecl Initialize(
+                _In_ DXGI_FORMAT outFormat, _In_ DXGI_FORMAT inFormat,
+                _In_ TEX_FILTER_FLAGS flags, _In_ bool convert = true) noexcept;
+
+            void __cdecl Convert(
+                _Out_writes_(_Inexpressible_("count pixels")) void* pDestination,
+                _In_reads_(_Inexpressible_("count pixels")) const void* pSource,
+                _In_ size_t count) const noexcept
+            {
+                assert(m_kernel != nullptr);
+                m_kernel(pDestination, pSource, count, m_tables.get());
+            }
+
+            using Kernel = void(*)(void*, const void*, size_t, const ScanlineTables*);
+
+        private:
+            Kernel                          m_kernel;
+            std::unique_ptr<ScanlineTables> m_tables;
+        };
+
+        //---------------------------------------------------------------------------------
+        // Compression helper functions
+
+        // Codec options passed on to the BC encoders (DirectXTexCompress.cpp checks that these
+        // TEX_COMPRESS_* flags have the same values as the BC_FLAGS_* ones)
+        constexpr uint32_t GetBCFlags(_In_ TEX_COMPRESS_FLAGS compress) noexcept
+        {
+            return static_cast<uint32_t>(compress) & (static_cast<uint32_t>(TEX_COMPRESS_DITHER)
+                | static_cast<uint32_t>(TEX_COMPRESS_UNIFORM)
+                | static_cast<uint32_t>(TEX_COMPRESS_BC7_USE_3SUBSETS)
+                | static_cast<uint32_t>(TEX_COMPRESS_BC7_QUICK)
+                | static_cast<uint32_t>(TEX_COMPRESS_BC7_BATCH));
+        }
+
         //---------------------------------------------------------------------------------
         // Misc helper functions
         bool __cdecl IsAlphaAllOpaqueBC(_In_ const Image& cImage) noexcept;
@@ -0,0 +1,1799 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexPipeline.cpp
+//
+// DirectX Texture Library - Fused tile-based image pipeline
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#include "BC.h"
+#include "resample.h"
+#include "scheduler.h"
+
+#include <atomic>
+
+using namespace DirectX;
+using namespace DirectX::Internal;
+
+namespace
+{
+    // The output is produced in tiles of this size. Both are multiples of the 4x4 BC block
+    // and of the ordered dither pattern, so tiles line up with both.
+    constexpr size_t c_tileWidth = 256;
+    constexpr size_t c_tileHeight = 64;
+
+    // Error diffusion runs over full-width bands of this many rows
+    constexpr size_t c_bandRows = 16;
+
+    // Resize splits a request so the source texels each piece pulls stay around this many bytes
+    constexpr size_t c_maxFootprint = 4 * 1024 * 1024;
+
+    enum class OpType : uint32_t
+    {
+        PremultiplyAlpha,
+        FlipRotate,
+        Resize,
+        NormalMap,
+        Transform,
+    };
+
+    using PixelFunc = std::function<void __cdecl(XMVECTOR* pixels, size_t width, size_t x, size_t y)>;
+
+    struct Operation
+    {
+        OpType      type;
+        uint32_t    flags;
+        size_t      width;
+        size_t      height;
+        float       amplitude;
+        PixelFunc   pixelFunc;
+    };
+
+
+    //-------------------------------------------------------------------------------------
+    // Formats
+    //-------------------------------------------------------------------------------------
+
+    // The format whose values the pipeline works with for a given source: the linear
+    // equivalent, with BC formats standing in for what they decompress to
+    DXGI_FORMAT GetWorkFormat(DXGI_FORMAT format) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            return DXGI_FORMAT_R8G8B8A8_UNORM;
+
+        case DXGI_FORMAT_BC4_UNORM:     return DXGI_FORMAT_R8_UNORM;
+        case DXGI_FORMAT_BC4_SNORM:     return DXGI_FORMAT_R8_SNORM;
+        case DXGI_FORMAT_BC5_UNORM:     return DXGI_FORMAT_R8G8_UNORM;
+        case DXGI_FORMAT_BC5_SNORM:     return DXGI_FORMAT_R8G8_SNORM;
+
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+            return DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+        default:
+            return MakeLinear(format);
+        }
+    }
+
+    // The uncompressed format a source or a block-compressed result is stored as
+    DXGI_FORMAT GetUncompressedFormat(DXGI_FORMAT format) noexcept
+    {
+        if (!IsCompressed(format))
+            return format;
+
+        switch (format)
+        {
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+            // BC6H only holds half-precision values
+            return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+        default:
+            break;
+        }
+
+        const DXGI_FORMAT work = GetWorkFormat(format);
+        return (IsSRGB(format)) ? MakeSRGB(work) : work;
+    }
+
+    // True if loading 'format' with these flags converts sRGB values to linear (see ConvertScanline)
+    bool IsDecoded(DXGI_FORMAT format, TEX_FILTER_FLAGS srgb) noexcept
+    {
+        if (format == DXGI_FORMAT_A8_UNORM || format == DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM)
+            return false;
+
+        if (IsSRGB(format))
+            return true;
+
+        if (!(srgb & TEX_FILTER_SRGB_IN))
+            return false;
+
+        const uint32_t convFlags = GetConvertFlags(format);
+        return !(convFlags & CONVF_DEPTH) && (convFlags & (CONVF_FLOAT | CONVF_UNORM));
+    }
+
+    // Bytes per pixel if a run of pixels can be loaded or stored on its own, otherwise 0
+    size_t GetRunBytes(DXGI_FORMAT format) noexcept
+    {
+        if (IsPacked(format))
+            return 0;
+
+        const size_t bpp = BitsPerPixel(format);
+        return (bpp % 8) ? 0 : (bpp / 8);
+    }
+
+    bool GetDecoder(DXGI_FORMAT format, BC_DECODE& pfDecode, size_t& blocksize) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfDecode = D3DXDecodeBC1;   blocksize = 8;   break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfDecode = D3DXDecodeBC2;   blocksize = 16;  break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfDecode = D3DXDecodeBC3;   blocksize = 16;  break;
+        case DXGI_FORMAT_BC4_UNORM:         pfDecode = D3DXDecodeBC4U;  blocksize = 8;   break;
+        case DXGI_FORMAT_BC4_SNORM:         pfDecode = D3DXDecodeBC4S;  blocksize = 8;   break;
+        case DXGI_FORMAT_BC5_UNORM:         pfDecode = D3DXDecodeBC5U;  blocksize = 16;  break;
+        case DXGI_FORMAT_BC5_SNORM:         pfDecode = D3DXDecodeBC5S;  blocksize = 16;  break;
+        case DXGI_FORMAT_BC6H_UF16:         pfDecode = D3DXDecodeBC6HU; blocksize = 16;  break;
+        case DXGI_FORMAT_BC6H_SF16:         pfDecode = D3DXDecodeBC6HS; blocksize = 16;  break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfDecode = D3DXDecodeBC7;   blocksize = 16;  break;
+        default:                            pfDecode = nullptr;         blocksize = 0;   return false;
+        }
+
+        return true;
+    }
+
+    bool GetEncoder(DXGI_FORMAT format, BC_ENCODE& pfEncode, size_t& blocksize, TEX_FILTER_FLAGS& cflags) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:    pfEncode = nullptr;         blocksize = 8;   cflags = TEX_FILTER_DEFAULT; break;
+        case DXGI_FORMAT_BC2_UNORM:
+        case DXGI_FORMAT_BC2_UNORM_SRGB:    pfEncode = D3DXEncodeBC2;   blocksize = 16;  cflags = TEX_FILTER_DEFAULT; break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:    pfEncode = D3DXEncodeBC3;   blocksize = 16;  cflags = TEX_FILTER_DEFAULT; break;
+        case DXGI_FORMAT_BC4_UNORM:         pfEncode = D3DXEncodeBC4U;  blocksize = 8;   cflags = TEX_FILTER_RGB_COPY_RED; break;
+        case DXGI_FORMAT_BC4_SNORM:         pfEncode = D3DXEncodeBC4S;  blocksize = 8;   cflags = TEX_FILTER_RGB_COPY_RED; break;
+        case DXGI_FORMAT_BC5_UNORM:         pfEncode = D3DXEncodeBC5U;  blocksize = 16;  cflags = TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN; break;
+        case DXGI_FORMAT_BC5_SNORM:         pfEncode = D3DXEncodeBC5S;  blocksize = 16;  cflags = TEX_FILTER_RGB_COPY_RED | TEX_FILTER_RGB_COPY_GREEN; break;
+        case DXGI_FORMAT_BC6H_UF16:         pfEncode = D3DXEncodeBC6HU; blocksize = 16;  cflags = TEX_FILTER_DEFAULT; break;
+        case DXGI_FORMAT_BC6H_SF16:         pfEncode = D3DXEncodeBC6HS; blocksize = 16;  cflags = TEX_FILTER_DEFAULT; break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:    pfEncode = D3DXEncodeBC7;   blocksize = 16;  cflags = TEX_FILTER_DEFAULT; break;
+        default:                            pfEncode = nullptr;         blocksize = 0;   cflags = TEX_FILTER_DEFAULT; return false;
+        }
+
+        return true;
+    }
+
+    inline TEX_FILTER_FLAGS GetResizeFilter(TEX_FILTER_FLAGS filter, size_t srcWidth, size_t srcHeight, size_t width, size_t height) noexcept
+    {
+        if (filter & TEX_FILTER_MODE_MASK)
+            return filter;
+
+        // Same default as Resize
+        const bool half = ((width << 1) == srcWidth) && ((height << 1) == srcHeight);
+        return static_cast<TEX_FILTER_FLAGS>(filter | ((half) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR));
+    }
+
+    inline TEX_FILTER_FLAGS GetMipFilter(TEX_FILTER_FLAGS filter, size_t width, size_t height) noexcept
+    {
+        if (filter & TEX_FILTER_MODE_MASK)
+            return filter;
+
+        // Same default as GenerateMipMaps
+        return static_cast<TEX_FILTER_FLAGS>(filter | ((ispow2(width) && ispow2(height)) ? TEX_FILTER_BOX : TEX_FILTER_LINEAR));
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Stages
+    //-------------------------------------------------------------------------------------
+
+    // A stage produces any rectangle of its output on demand, pulling what it needs from
+    // the stage before it. Read is called from many threads at once, so stages keep no
+    // per-call state. 'pitch' is in pixels.
+    class Stage
+    {
+    public:
+        Stage(size_t width, size_t height) noexcept : m_width(width), m_height(height) {}
+        virtual ~Stage() = default;
+
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+        virtual HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const = 0;
+
+        size_t GetWidth() const noexcept { return m_width; }
+        size_t GetHeight() const noexcept { return m_height; }
+
+    private:
+        size_t m_width;
+        size_t m_height;
+    };
+
+    // Sorts and removes duplicates from a list of texel indices, and records where each of
+    // the original entries ended up in the sorted list
+    std::unique_ptr<uint32_t[]> GetFootprint(
+        const uint32_t* indices,
+        size_t count,
+        size_t& unique,
+        std::unique_ptr<uint32_t[]>& position) noexcept
+    {
+        std::unique_ptr<uint32_t[]> sorted(new (std::nothrow) uint32_t[count]);
+        position.reset(new (std::nothrow) uint32_t[count]);
+        if (!sorted || !position)
+            return nullptr;
+
+        memcpy(sorted.get(), indices, sizeof(uint32_t) * count);
+        std::sort(sorted.get(), sorted.get() + count);
+        unique = static_cast<size_t>(std::unique(sorted.get(), sorted.get() + count) - sorted.get());
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            position[j] = static_cast<uint32_t>(std::lower_bound(sorted.get(), sorted.get() + unique, indices[j]) - sorted.get());
+        }
+
+        return sorted;
+    }
+
+    // Reads the texels at every (cols[i], rows[j]) into an ncols x nrows block, issuing one
+    // Read for each run of consecutive columns and rows
+    HRESULT Gather(
+        const Stage& stage,
+        const uint32_t* cols,
+        size_t ncols,
+        const uint32_t* rows,
+        size_t nrows,
+        XMVECTOR* pDest)
+    {
+        for (size_t j = 0; j < nrows; )
+        {
+            size_t jEnd = j + 1;
+            while (jEnd < nrows && rows[jEnd] == rows[jEnd - 1] + 1)
+                ++jEnd;
+
+            for (size_t i = 0; i < ncols; )
+            {
+                size_t iEnd = i + 1;
+                while (iEnd < ncols && cols[iEnd] == cols[iEnd - 1] + 1)
+                    ++iEnd;
+
+                const HRESULT hr = stage.Read(Rect(cols[i], rows[j], iEnd - i, jEnd - j), pDest + ncols * j + i, ncols);
+                if (FAILED(hr))
+                    return hr;
+
+                i = iEnd;
+            }
+
+            j = jEnd;
+        }
+
+        return S_OK;
+    }
+
+    //--- Source image ---
+    class SourceStage : public Stage
+    {
+    public:
+        SourceStage(const Image& image, DXGI_FORMAT workFormat, TEX_FILTER_FLAGS srgb) noexcept :
+            Stage(image.width, image.height),
+            m_image(image),
+            m_workFormat(workFormat),
+            m_filter(static_cast<TEX_FILTER_FLAGS>(srgb & TEX_FILTER_SRGB_IN)),
+            m_convert((workFormat != image.format) || (srgb & TEX_FILTER_SRGB_IN)),
+            m_runBytes(0),
+            m_pfDecode(nullptr),
+            m_blocksize(0)
+        {
+            if (!GetDecoder(image.format, m_pfDecode, m_blocksize))
+            {
+                m_runBytes = GetRunBytes(image.format);
+            }
+        }
+
+        HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const override
+        {
+            assert((rect.x + rect.w) <= m_image.width && (rect.y + rect.h) <= m_image.height);
+
+            if (m_pfDecode)
+            {
+                ReadBlocks(rect, pDest, pitch);
+            }
+            else if (m_runBytes)
+            {
+                const uint8_t* pSrc = m_image.pixels + m_image.rowPitch * rect.y + m_runBytes * rect.x;
+                for (size_t y = 0; y < rect.h; ++y)
+                {
+                    if (!LoadScanline(pDest + pitch * y, rect.w, pSrc, m_runBytes * rect.w, m_image.format))
+                        return E_FAIL;
+
+                    pSrc += m_image.rowPitch;
+                }
+            }
+            else
+            {
+                // Packed and sub-byte formats are loaded a whole row at a time
+                auto scanline = make_AlignedArrayXMVECTOR(m_image.width);
+                if (!scanline)
+                    return E_OUTOFMEMORY;
+
+                const uint8_t* pSrc = m_image.pixels + m_image.rowPitch * rect.y;
+                for (size_t y = 0; y < rect.h; ++y)
+                {
+                    if (!LoadScanline(scanline.get(), m_image.width, pSrc, m_image.rowPitch, m_image.format))
+                        return E_FAIL;
+
+                    memcpy(pDest + pitch * y, scanline.get() + rect.x, sizeof(XMVECTOR) * rect.w);
+                    pSrc += m_image.rowPitch;
+                }
+            }
+
+            if (m_convert)
+            {
+                for (size_t y = 0; y < rect.h; ++y)
+                {
+                    ConvertScanline(pDest + pitch * y, rect.w, m_workFormat, m_image.format, m_filter);
+                }
+            }
+
+            return S_OK;
+        }
+
+    private:
+        // Decodes the blocks the rectangle touches
+        void ReadBlocks(const Rect& rect, XMVECTOR* pDest, size_t pitch) const noexcept
+        {
+            XM_ALIGNED_DATA(16) XMVECTOR temp[NUM_PIXELS_PER_BLOCK];
+
+            const size_t right = rect.x + rect.w;
+            const size_t bottom = rect.y + rect.h;
+
+            for (size_t by = (rect.y & ~size_t(3)); by < bottom; by += 4)
+            {
+                const uint8_t* pBlock = m_image.pixels + m_image.rowPitch * (by >> 2) + m_blocksize * (rect.x >> 2);
+
+                const size_t y0 = std::max(by, rect.y);
+                const size_t y1 = std::min(by + 4, bottom);
+
+                for (size_t bx = (rect.x & ~size_t(3)); bx < right; bx += 4, pBlock += m_blocksize)
+                {
+                    m_pfDecode(temp, pBlock);
+
+                    const size_t x0 = std::max(bx, rect.x);
+                    const size_t x1 = std::min(bx + 4, right);
+
+                    for (size_t y = y0; y < y1; ++y)
+                    {
+                        XMVECTOR* dptr = pDest + pitch * (y - rect.y) - rect.x;
+                        for (size_t x = x0; x < x1; ++x)
+                        {
+                            dptr[x] = temp[((y & 3) << 2) | (x & 3)];
+                        }
+                    }
+                }
+            }
+        }
+
+        Image               m_image;
+        DXGI_FORMAT         m_workFormat;
+        TEX_FILTER_FLAGS    m_filter;
+        bool                m_convert;
+        size_t              m_runBytes;
+        BC_DECODE           m_pfDecode;
+        size_t              m_blocksize;
+    };
+
+    //--- Per-pixel operations ---
+    // Consecutive per-pixel operations share a stage, which applies all of them to each row
+    // while it is in cache
+    class PointStage : public Stage
+    {
+    public:
+        explicit PointStage(const Stage& source) noexcept :
+            Stage(source.GetWidth(), source.GetHeight()),
+            m_source(source)
+        {}
+
+        // 'encode' applies the operation to sRGB values the pipeline has converted to linear
+        void Add(const Operation& op, bool encode)
+        {
+            m_ops.push_back(PointOp{ &op, encode });
+        }
+
+        HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const override
+        {
+            const HRESULT hr = m_source.Read(rect, pDest, pitch);
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t y = 0; y < rect.h; ++y)
+            {
+                XMVECTOR* row = pDest + pitch * y;
+
+                for (const auto& it : m_ops)
+                {
+                    switch (it.op->type)
+                    {
+                    case OpType::PremultiplyAlpha:
+                        PremultiplyRow(row, rect.w, it.op->flags, it.encode);
+                        break;
+
+                    case OpType::Transform:
+                        it.op->pixelFunc(row, rect.w, rect.x, rect.y + y);
+                        break;
+
+                    default:
+                        return E_UNEXPECTED;
+                    }
+                }
+            }
+
+            return S_OK;
+        }
+
+    private:
+        struct PointOp
+        {
+            const Operation*    op;
+            bool                encode;
+        };
+
+        static void PremultiplyRow(XMVECTOR* pixels, size_t count, uint32_t flags, bool encode) noexcept
+        {
+            for (size_t x = 0; x < count; ++x)
+            {
+                XMVECTOR v = pixels[x];
+                if (encode)
+                    v = XMColorRGBToSRGB(v);
+
+                const XMVECTOR alpha = XMVectorSplatW(v);
+                if (!(flags & TEX_PMALPHA_REVERSE))
+                {
+                    v = XMVectorSelect(v, XMVectorMultiply(v, alpha), g_XMSelect1110);
+                }
+                else if (XMVectorGetX(alpha) > 0)
+                {
+                    v = XMVectorSelect(v, XMVectorDivide(v, alpha), g_XMSelect1110);
+                }
+
+                if (encode)
+                    v = XMColorSRGBToRGB(v);
+
+                pixels[x] = v;
+            }
+        }
+
+        const Stage&            m_source;
+        std::vector<PointOp>    m_ops;
+    };
+
+    //--- Flip and rotate ---
+    class FlipRotateStage : public Stage
+    {
+    public:
+        FlipRotateStage(const Stage& source, uint32_t flags) noexcept :
+            Stage(IsSideways(flags) ? source.GetHeight() : source.GetWidth(), IsSideways(flags) ? source.GetWidth() : source.GetHeight()),
+            m_source(source),
+            m_sxx(1), m_sxy(0), m_sx0(0),
+            m_syx(0), m_syy(1), m_sy0(0)
+        {
+            const auto w = static_cast<ptrdiff_t>(source.GetWidth());
+            const auto h = static_cast<ptrdiff_t>(source.GetHeight());
+
+            // Rotated (but not yet flipped) coordinates (u, v) map to source texels as follows
+            ptrdiff_t sxu = 1, sxv = 0, sx0 = 0;
+            ptrdiff_t syu = 0, syv = 1, sy0 = 0;
+            switch (flags & 0x3)
+            {
+            case TEX_FR_ROTATE90:   sxu = 0;  sxv = 1; sx0 = 0;     syu = -1; syv = 0;  sy0 = h - 1; break;
+            case TEX_FR_ROTATE180:  sxu = -1; sxv = 0; sx0 = w - 1; syu = 0;  syv = -1; sy0 = h - 1; break;
+            case TEX_FR_ROTATE270:  sxu = 0;  sxv = -1; sx0 = w - 1; syu = 1; syv = 0;  sy0 = 0;     break;
+            default: break;
+            }
+
+            // The flips then mirror the output coordinates
+            const auto ow = static_cast<ptrdiff_t>(GetWidth());
+            const auto oh = static_cast<ptrdiff_t>(GetHeight());
+            const ptrdiff_t ux = (flags & TEX_FR_FLIP_HORIZONTAL) ? -1 : 1;
+            const ptrdiff_t u0 = (flags & TEX_FR_FLIP_HORIZONTAL) ? ow - 1 : 0;
+            const ptrdiff_t vy = (flags & TEX_FR_FLIP_VERTICAL) ? -1 : 1;
+            const ptrdiff_t v0 = (flags & TEX_FR_FLIP_VERTICAL) ? oh - 1 : 0;
+
+            m_sxx = sxu * ux;   m_sxy = sxv * vy;   m_sx0 = sx0 + sxu * u0 + sxv * v0;
+            m_syx = syu * ux;   m_syy = syv * vy;   m_sy0 = sy0 + syu * u0 + syv * v0;
+        }
+
+        HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const override
+        {
+            if (m_sxx == 1 && m_syy == 1 && !m_sx0 && !m_sy0)
+                return m_source.Read(rect, pDest, pitch);
+
+            // The source rectangle is spanned by the images of two opposite corners
+            const auto x0 = static_cast<ptrdiff_t>(rect.x);
+            const auto y0 = static_cast<ptrdiff_t>(rect.y);
+            const auto x1 = static_cast<ptrdiff_t>(rect.x + rect.w - 1);
+            const auto y1 = static_cast<ptrdiff_t>(rect.y + rect.h - 1);
+
+            const ptrdiff_t ax = SourceX(x0, y0), bx = SourceX(x1, y1);
+            const ptrdiff_t ay = SourceY(x0, y0), by = SourceY(x1, y1);
+            const Rect srcRect(size_t(std::min(ax, bx)), size_t(std::min(ay, by)),
+                size_t(std::abs(bx - ax) + 1), size_t(std::abs(by - ay) + 1));
+
+            auto temp = make_AlignedArrayXMVECTOR(uint64_t(srcRect.w) * srcRect.h);
+            if (!temp)
+                return E_OUTOFMEMORY;
+
+            const HRESULT hr = m_source.Read(srcRect, temp.get(), srcRect.w);
+            if (FAILED(hr))
+                return hr;
+
+            const auto sw = static_cast<ptrdiff_t>(srcRect.w);
+            const ptrdiff_t stepX = m_sxx + m_syx * sw;
+            for (size_t y = 0; y < rect.h; ++y)
+            {
+                const ptrdiff_t sx = SourceX(x0, y0 + ptrdiff_t(y)) - ptrdiff_t(srcRect.x);
+                const ptrdiff_t sy = SourceY(x0, y0 + ptrdiff_t(y)) - ptrdiff_t(srcRect.y);
+
+                const XMVECTOR* sptr = temp.get() + sy * sw + sx;
+                XMVECTOR* dptr = pDest + pitch * y;
+                for (size_t x = 0; x < rect.w; ++x, sptr += stepX)
+                {
+                    dptr[x] = *sptr;
+                }
+            }
+
+            return S_OK;
+        }
+
+    private:
+        static constexpr bool IsSideways(uint32_t flags) noexcept
+        {
+            return ((flags & 0x3) == TEX_FR_ROTATE90) || ((flags & 0x3) == TEX_FR_ROTATE270);
+        }
+
+        ptrdiff_t SourceX(ptrdiff_t x, ptrdiff_t y) const noexcept { return m_sxx * x + m_sxy * y + m_sx0; }
+        ptrdiff_t SourceY(ptrdiff_t x, ptrdiff_t y) const noexcept { return m_syx * x + m_syy * y + m_sy0; }
+
+        const Stage&    m_source;
+        ptrdiff_t       m_sxx, m_sxy, m_sx0;
+        ptrdiff_t       m_syx, m_syy, m_sy0;
+    };
+
+    //--- Resize ---
+    // Uses the same weights as ResampleImage, so the result matches Resize
+    class ResizeStage : public Stage
+    {
+    public:
+        ResizeStage(const Stage& source, size_t width, size_t height) noexcept :
+            Stage(width, height),
+            m_source(source)
+        {}
+
+        HRESULT Initialize(TEX_FILTER_FLAGS filter) noexcept
+        {
+            const HRESULT hr = CreateResampleAxis(m_source.GetWidth(), GetWidth(), filter, false, m_fx);
+            if (FAILED(hr))
+                return hr;
+
+            return CreateResampleAxis(m_source.GetHeight(), GetHeight(), filter, true, m_fy);
+        }
+
+        HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const override
+        {
+            // Large reductions pull a lot of source for each destination texel, so split the
+            // request until the pieces' footprints are a modest size
+            const double scaleX = double(m_source.GetWidth()) / double(GetWidth());
+            const double scaleY = double(m_source.GetHeight()) / double(GetHeight());
+
+            auto footprint = [&](size_t w, size_t h) noexcept
+            {
+                return (double(w) * scaleX + double(m_fx.maxTaps)) * (double(h) * scaleY + double(m_fy.maxTaps)) * sizeof(XMVECTOR);
+            };
+
+            size_t pieceWidth = rect.w;
+            size_t pieceHeight = rect.h;
+            while (footprint(pieceWidth, pieceHeight) > double(c_maxFootprint) && (pieceWidth > 1 || pieceHeight > 1))
+            {
+                if (pieceWidth >= pieceHeight)
+                    pieceWidth = (pieceWidth + 1) >> 1;
+                else
+                    pieceHeight = (pieceHeight + 1) >> 1;
+            }
+
+            for (size_t y = 0; y < rect.h; y += pieceHeight)
+            {
+                for (size_t x = 0; x < rect.w; x += pieceWidth)
+                {
+                    const Rect piece(rect.x + x, rect.y + y, std::min(pieceWidth, rect.w - x), std::min(pieceHeight, rect.h - y));
+
+                    const HRESULT hr = ReadPiece(piece, pDest + pitch * y + x, pitch);
+                    if (FAILED(hr))
+                        return hr;
+                }
+            }
+
+            return S_OK;
+        }
+
+    private:
+        HRESULT ReadPiece(const Rect& rect, XMVECTOR* pDest, size_t pitch) const
+        {
+            const size_t tapX0 = m_fx.first[rect.x];
+            const size_t tapY0 = m_fy.first[rect.y];
+
+            size_t ncols = 0;
+            size_t nrows = 0;
+            std::unique_ptr<uint32_t[]> colPos;
+            std::unique_ptr<uint32_t[]> rowPos;
+            auto cols = GetFootprint(m_fx.index.get() + tapX0, m_fx.first[rect.x + rect.w] - tapX0, ncols, colPos);
+            auto rows = GetFootprint(m_fy.index.get() + tapY0, m_fy.first[rect.y + rect.h] - tapY0, nrows, rowPos);
+            if (!cols || !rows)
+                return E_OUTOFMEMORY;
+
+            // Source texels, then each source row filtered horizontally
+            auto temp = make_AlignedArrayXMVECTOR(uint64_t(ncols) * nrows + uint64_t(rect.w) * nrows);
+            if (!temp)
+                return E_OUTOFMEMORY;
+
+            XMVECTOR* source = temp.get();
+            XMVECTOR* filtered = source + ncols * nrows;
+
+            const HRESULT hr = Gather(m_source, cols.get(), ncols, rows.get(), nrows, source);
+            if (FAILED(hr))
+                return hr;
+
+            const XMVECTOR zero = XMVectorZero();
+
+            for (size_t r = 0; r < nrows; ++r)
+            {
+                const XMVECTOR* sptr = source + ncols * r;
+                XMVECTOR* dptr = filtered + rect.w * r;
+
+                for (size_t x = 0; x < rect.w; ++x)
+                {
+                    XMVECTOR v = zero;
+                    for (size_t t = m_fx.first[rect.x + x]; t < m_fx.first[rect.x + x + 1]; ++t)
+                    {
+                        v = XMVectorMultiplyAdd(sptr[colPos[t - tapX0]], XMVectorReplicate(m_fx.weight[t]), v);
+                    }
+                    dptr[x] = v;
+                }
+            }
+
+            for (size_t y = 0; y < rect.h; ++y)
+            {
+                XMVECTOR* dptr = pDest + pitch * y;
+                for (size_t x = 0; x < rect.w; ++x)
+                    dptr[x] = zero;
+
+                for (size_t t = m_fy.first[rect.y + y]; t < m_fy.first[rect.y + y + 1]; ++t)
+                {
+                    const XMVECTOR w = XMVectorReplicate(m_fy.weight[t]);
+                    const XMVECTOR* sptr = filtered + rect.w * rowPos[t - tapY0];
+
+                    for (size_t x = 0; x < rect.w; ++x)
+                    {
+                        dptr[x] = XMVectorMultiplyAdd(sptr[x], w, dptr[x]);
+                    }
+                }
+            }
+
+            return S_OK;
+        }
+
+        const Stage&    m_source;
+        AxisFilter      m_fx;
+        AxisFilter      m_fy;
+    };
+
+    //--- Normal map from a height map ---
+    // Same central differencing and occlusion term as ComputeNormalMap
+    class NormalMapStage : public Stage
+    {
+    public:
+        NormalMapStage(const Stage& source, uint32_t flags, float amplitude, bool unorm) noexcept :
+            Stage(source.GetWidth(), source.GetHeight()),
+            m_source(source),
+            m_flags(flags),
+            m_amplitude(amplitude),
+            m_unorm(unorm)
+        {}
+
+        HRESULT Read(const Rect& rect, XMVECTOR* pDest, size_t pitch) const override
+        {
+            // Each texel uses its eight neighbours, wrapped or mirrored at the edges
+            std::unique_ptr<uint32_t[]> xs(new (std::nothrow) uint32_t[rect.w + 2]);
+            std::unique_ptr<uint32_t[]> ys(new (std::nothrow) uint32_t[rect.h + 2]);
+            if (!xs || !ys)
+                return E_OUTOFMEMORY;
+
+            for (size_t j = 0; j < rect.w + 2; ++j)
+                xs[j] = Neighbour(rect.x + j, GetWidth(), (m_flags & CNMAP_MIRROR_U) != 0);
+
+            for (size_t j = 0; j < rect.h + 2; ++j)
+                ys[j] = Neighbour(rect.y + j, GetHeight(), (m_flags & CNMAP_MIRROR_V) != 0);
+
+            size_t ncols = 0;
+            size_t nrows = 0;
+            std::unique_ptr<uint32_t[]> colPos;
+            std::unique_ptr<uint32_t[]> rowPos;
+            auto cols = GetFootprint(xs.get(), rect.w + 2, ncols, colPos);
+            auto rows = GetFootprint(ys.get(), rect.h + 2, nrows, rowPos);
+            if (!cols || !rows)
+                return E_OUTOFMEMORY;
+
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(ncols) * nrows);
+            auto buffer = make_AlignedArrayFloat(uint64_t(ncols) * nrows);
+            if (!scanline || !buffer)
+                return E_OUTOFMEMORY;
+
+            const HRESULT hr = Gather(m_source, cols.get(), ncols, rows.get(), nrows, scanline.get());
+            if (FAILED(hr))
+                return hr;
+
+            for (size_t j = 0; j < ncols * nrows; ++j)
+            {
+                buffer[j] = EvaluateColor(scanline[j]);
+            }
+
+            const float amplitude = m_amplitude;
+
+            for (size_t y = 0; y < rect.h; ++y)
+            {
+                const float* val0 = buffer.get() + ncols * rowPos[y];
+                const float* val1 = buffer.get() + ncols * rowPos[y + 1];
+                const float* val2 = buffer.get() + ncols * rowPos[y + 2];
+
+                XMVECTOR* dptr = pDest + pitch * y;
+                for (size_t x = 0; x < rect.w; ++x)
+                {
+                    const size_t l = colPos[x];
+                    const size_t c = colPos[x + 1];
+                    const size_t r = colPos[x + 2];
+
+                    // Compute normal via central differencing
+                    float totDelta = (val0[l] - val0[r]) + (val1[l] - val1[r]) + (val2[l] - val2[r]);
+                    const float deltaZX = totDelta * amplitude / 6.f;
+
+                    totDelta = (val0[l] - val2[l]) + (val0[c] - val2[c]) + (val0[r] - val2[r]);
+                    const float deltaZY = totDelta * amplitude / 6.f;
+
+                    const XMVECTOR vx = XMVectorSetZ(g_XMNegIdentityR0, deltaZX);   // (-1.0f, 0.0f, deltaZX)
+                    const XMVECTOR vy = XMVectorSetZ(g_XMNegIdentityR1, deltaZY);   // (0.0f, -1.0f, deltaZY)
+
+                    const XMVECTOR normal = XMVector3Normalize(XMVector3Cross(vx, vy));
+
+                    // Compute alpha (1.0 or an occlusion term)
+                    float alpha = 1.f;
+
+                    if (m_flags & CNMAP_COMPUTE_OCCLUSION)
+                    {
+                        float delta = 0.f;
+                        const float h = val1[c];
+
+                        float t = val0[l] - h;  if (t > 0.f) delta += t;
+                        t = val0[c] - h;        if (t > 0.f) delta += t;
+                        t = val0[r] - h;        if (t > 0.f) delta += t;
+                        t = val1[l] - h;        if (t > 0.f) delta += t;
+                        // Skip current pixel
+                        t = val1[r] - h;        if (t > 0.f) delta += t;
+                        t = val2[l] - h;        if (t > 0.f) delta += t;
+                        t = val2[c] - h;        if (t > 0.f) delta += t;
+                        t = val2[r] - h;        if (t > 0.f) delta += t;
+
+                        // Average delta (divide by 8, scale by amplitude factor)
+                        delta *= 0.125f * amplitude;
+                        if (delta > 0.f)
+                        {
+                            // If < 0, then no occlusion
+                            const float rd = sqrtf(1.f + delta * delta);
+                            alpha = (rd - delta) / rd;
+                        }
+                    }
+
+                    // Encode based on target format
+                    if (m_unorm)
+                    {
+                        // 0.5f*normal + 0.5f -or- invert sign case: -0.5f*normal + 0.5f
+                        const XMVECTOR n1 = XMVectorMultiplyAdd((m_flags & CNMAP_INVERT_SIGN) ? g_XMNegativeOneHalf : g_XMOneHalf, normal, g_XMOneHalf);
+                        dptr[x] = XMVectorSetW(n1, alpha);
+                    }
+                    else if (m_flags & CNMAP_INVERT_SIGN)
+                    {
+                        dptr[x] = XMVectorSetW(XMVectorNegate(normal), alpha);
+                    }
+                    else
+                    {
+                        dptr[x] = XMVectorSetW(normal, alpha);
+                    }
+                }
+            }
+
+            return S_OK;
+        }
+
+    private:
+        // Texel 'u - 1' of an axis of 'size' texels
+        static uint32_t Neighbour(size_t u, size_t size, bool mirror) noexcept
+        {
+            if (!u)
+                return static_cast<uint32_t>((mirror) ? 0 : size - 1);
+
+            if (u > size)
+                return static_cast<uint32_t>((mirror) ? size - 1 : 0);
+
+            return static_cast<uint32_t>(u - 1);
+        }
+
+        float EvaluateColor(FXMVECTOR val) const noexcept
+        {
+            static const XMVECTORF32 lScale = { { { 0.2125f, 0.7154f, 0.0721f, 1.f } } };
+
+            switch (m_flags & 0xf)
+            {
+            case CNMAP_CHANNEL_GREEN:   return XMVectorGetY(val);
+            case CNMAP_CHANNEL_BLUE:    return XMVectorGetZ(val);
+            case CNMAP_CHANNEL_ALPHA:   return XMVectorGetW(val);
+
+            case CNMAP_CHANNEL_LUMINANCE:
+                {
+                    XMFLOAT4A f;
+                    XMStoreFloat4A(&f, XMVectorMultiply(val, lScale));
+                    return f.x + f.y + f.z;
+                }
+
+            default:
+                return XMVectorGetX(val);
+            }
+        }
+
+        const Stage&    m_source;
+        uint32_t        m_flags;
+        float           m_amplitude;
+        bool            m_unorm;
+    };
+
+
+    //-------------------------------------------------------------------------------------
+    // Output
+    //-------------------------------------------------------------------------------------
+
+    struct OutputInfo
+    {
+        DXGI_FORMAT         workFormat;     // Format the final stage's values are in
+        TEX_FILTER_FLAGS    filter;         // ConvertScanline and dither flags
+        float               threshold;
+        size_t              z;              // Slice for the ordered dither pattern
+    };
+
+    // Calls func(rect, buffer) for every tile of a width x height image, in parallel. The
+    // buffer holds one tile.
+    template<typename Func>
+    HRESULT ForEachTile(
+        size_t width,
+        size_t height,
+        size_t tileWidth,
+        size_t tileHeight,
+        const std::function<bool __cdecl(size_t, size_t)>& statusCallback,
+        Func func)
+    {
+        const size_t tilesX = (width + tileWidth - 1) / tileWidth;
+        const size_t tilesY = (height + tileHeight - 1) / tileHeight;
+
+        std::atomic<HRESULT> tileResult(S_OK);
+
+        TaskScheduler::ProgressFunc progress;
+        if (statusCallback)
+        {
+            progress = [&](size_t completed, size_t count) -> bool { return statusCallback(completed, count); };
+        }
+
+        const HRESULT hr = TaskScheduler::ParallelFor(tilesX * tilesY, 1,
+            [&](size_t begin, size_t end) -> bool
+            {
+                auto buffer = make_AlignedArrayXMVECTOR(uint64_t(tileWidth) * tileHeight);
+                if (!buffer)
+                {
+                    tileResult = E_OUTOFMEMORY;
+                    return false;
+                }
+
+                for (size_t t = begin; t < end; ++t)
+                {
+                    const size_t x = (t % tilesX) * tileWidth;
+                    const size_t y = (t / tilesX) * tileHeight;
+
+                    const HRESULT hrTile = func(Rect(x, y, std::min(tileWidth, width - x), std::min(tileHeight, height - y)), buffer.get());
+                    if (FAILED(hrTile))
+                    {
+                        tileResult = hrTile;
+                        return false;
+                    }
+                }
+
+                return true;
+            }, progress);
+
+        if (FAILED(tileResult.load()))
+            return tileResult.load();
+
+        return hr;
+    }
+
+    // Converts a row from the pipeline's values and stores it at (x, y)
+    inline bool StoreRow(const Image& dest, const OutputInfo& info, size_t runBytes, XMVECTOR* row, size_t count, size_t x, size_t y) noexcept
+    {
+        ConvertScanline(row, count, dest.format, info.workFormat, info.filter);
+
+        uint8_t* pDest = dest.pixels + dest.rowPitch * y + runBytes * x;
+        const size_t size = (runBytes) ? runBytes * count : dest.rowPitch;
+
+        if (info.filter & TEX_FILTER_DITHER)
+            return StoreScanlineDither(pDest, size, dest.format, row, count, info.threshold, y, info.z, nullptr);
+
+        return StoreScanline(pDest, size, dest.format, row, count, info.threshold);
+    }
+
+    HRESULT StoreImage(
+        const Stage& root,
+        const OutputInfo& info,
+        const Image& dest,
+        const std::function<bool __cdecl(size_t, size_t)>& statusCallback)
+    {
+        assert(root.GetWidth() == dest.width && root.GetHeight() == dest.height);
+
+        const size_t width = dest.width;
+
+        if (info.filter & TEX_FILTER_DITHER_DIFFUSION)
+        {
+            // Each row's error goes into the next, so bands are computed in parallel a batch
+            // at a time and then stored in order
+            const size_t height = dest.height;
+            const size_t bands = (height + c_bandRows - 1) / c_bandRows;
+            const size_t batch = std::min(bands, TaskScheduler::GetConcurrency() * 2);
+
+            auto scanline = make_AlignedArrayXMVECTOR(uint64_t(width) * c_bandRows * batch + width + 2);
+            if (!scanline)
+                return E_OUTOFMEMORY;
+
+            XMVECTOR* pDiffusionErrors = scanline.get() + width * c_bandRows * batch;
+            memset(pDiffusionErrors, 0, sizeof(XMVECTOR) * (width + 2));
+
+            for (size_t band = 0; band < bands; band += batch)
+            {
+                if (statusCallback)
+                {
+                    if (!statusCallback(band, bands))
+                        return E_ABORT;
+                }
+
+                const size_t count = std::min(batch, bands - band);
+
+                std::atomic<HRESULT> bandResult(S_OK);
+                const HRESULT hr = TaskScheduler::ParallelFor(count, 1,
+                    [&](size_t begin, size_t end) -> bool
+                    {
+                        for (size_t j = begin; j < end; ++j)
+                        {
+                            const size_t y = (band + j) * c_bandRows;
+                            const HRESULT hrBand = root.Read(Rect(0, y, width, std::min(c_bandRows, height - y)), scanline.get() + width * c_bandRows * j, width);
+                            if (FAILED(hrBand))
+                            {
+                                bandResult = hrBand;
+                                return false;
+                            }
+                        }
+                        return true;
+                    });
+                if (FAILED(bandResult.load()))
+                    return bandResult.load();
+                if (FAILED(hr))
+                    return hr;
+
+                const size_t y0 = band * c_bandRows;
+                const size_t y1 = std::min(height, (band + count) * c_bandRows);
+                for (size_t y = y0; y < y1; ++y)
+                {
+                    XMVECTOR* row = scanline.get() + width * (y - y0);
+                    ConvertScanline(row, width, dest.format, info.workFormat, info.filter);
+
+                    if (!StoreScanlineDither(dest.pixels + dest.rowPitch * y, dest.rowPitch, dest.format, row, width, info.threshold, y, info.z, pDiffusionErrors))
+                        return E_FAIL;
+                }
+            }
+
+            return S_OK;
+        }
+
+        // Formats that can't store a run of pixels on their own use full-width tiles
+        const size_t runBytes = GetRunBytes(dest.format);
+        const size_t tileWidth = (runBytes) ? c_tileWidth : width;
+
+        return ForEachTile(width, dest.height, tileWidth, c_tileHeight, statusCallback,
+            [&](const Rect& rect, XMVECTOR* buffer) -> HRESULT
+            {
+                const HRESULT hr = root.Read(rect, buffer, rect.w);
+                if (FAILED(hr))
+                    return hr;
+
+                for (size_t y = 0; y < rect.h; ++y)
+                {
+                    if (!StoreRow(dest, info, runBytes, buffer + rect.w * y, rect.w, rect.x, rect.y + y))
+                        return E_FAIL;
+                }
+
+                return S_OK;
+            });
+    }
+
+    HRESULT CompressImage(
+        const Stage& root,
+        const OutputInfo& info,
+        uint32_t bcflags,
+        const Image& dest,
+        const std::function<bool __cdecl(size_t, size_t)>& statusCallback)
+    {
+        assert(root.GetWidth() == dest.width && root.GetHeight() == dest.height);
+
+        BC_ENCODE pfEncode;
+        size_t blocksize;
+        TEX_FILTER_FLAGS cflags;
+        if (!GetEncoder(dest.format, pfEncode, blocksize, cflags))
+            return HRESULT_E_NOT_SUPPORTED;
+
+        cflags |= info.filter;
+
+        // BC7 blocks can optionally be gathered and encoded as a batch
+        const bool batch = (pfEncode == D3DXEncodeBC7) && (bcflags & BC_FLAGS_BC7_BATCH);
+
+        return ForEachTile(dest.width, dest.height, c_tileWidth, c_tileHeight, statusCallback,
+            [&](const Rect& rect, XMVECTOR* buffer) -> HRESULT
+            {
+                const HRESULT hr = root.Read(rect, buffer, rect.w);
+                if (FAILED(hr))
+                    return hr;
+
+                XM_ALIGNED_DATA(16) XMVECTOR batchTemp[NUM_PIXELS_PER_BLOCK * BC7_BATCH_SIZE];
+                uint8_t* batchDest[BC7_BATCH_SIZE] = {};
+                size_t nbatch = 0;
+
+                // Partial blocks replicate pixels the same way as Compress
+                static const size_t uSrc[] = { 0, 0, 0, 1 };
+
+                for (size_t by = 0; by < rect.h; by += 4)
+                {
+                    const size_t ph = std::min<size_t>(4, rect.h - by);
+                    uint8_t* dptr = dest.pixels + dest.rowPitch * ((rect.y + by) >> 2) + blocksize * (rect.x >> 2);
+
+                    for (size_t bx = 0; bx < rect.w; bx += 4, dptr += blocksize)
+                    {
+                        const size_t pw = std::min<size_t>(4, rect.w - bx);
+
+                        XMVECTOR* temp = &batchTemp[nbatch * NUM_PIXELS_PER_BLOCK];
+                        for (size_t t = 0; t < 4; ++t)
+                        {
+                            const size_t row = (t < ph) ? t : ((uSrc[t] < ph) ? uSrc[t] : 0);
+                            const XMVECTOR* sptr = buffer + rect.w * (by + row) + bx;
+                            for (size_t s = 0; s < 4; ++s)
+                            {
+                                temp[(t << 2) | s] = sptr[(s < pw) ? s : ((uSrc[s] < pw) ? uSrc[s] : 0)];
+                            }
+                        }
+
+                        ConvertScanline(temp, NUM_PIXELS_PER_BLOCK, dest.format, info.workFormat, cflags);
+
+                        if (batch)
+                        {
+                            batchDest[nbatch++] = dptr;
+                            if (nbatch == BC7_BATCH_SIZE)
+                            {
+                                D3DXEncodeBC7Batch(batchDest, batchTemp, nbatch, bcflags);
+                                nbatch = 0;
+                            }
+                        }
+                        else if (pfEncode)
+                            pfEncode(dptr, temp, bcflags);
+                        else
+                            D3DXEncodeBC1(dptr, temp, info.threshold, bcflags);
+                    }
+                }
+
+                if (nbatch > 0)
+                {
+                    D3DXEncodeBC7Batch(batchDest, batchTemp, nbatch, bcflags);
+                }
+
+                return S_OK;
+            });
+    }
+}
+
+
+//=====================================================================================
+// ImagePipeline
+//=====================================================================================
+
+struct ImagePipeline::Impl
+{
+    std::vector<Operation>  ops;
+
+    bool                convert;
+    DXGI_FORMAT         convertFormat;
+    TEX_FILTER_FLAGS    convertFilter;
+    float               convertThreshold;
+
+    size_t              mipLevels;          // 0 for a full chain
+    TEX_FILTER_FLAGS    mipFilter;
+
+    DXGI_FORMAT         compressFormat;     // DXGI_FORMAT_UNKNOWN if the result isn't block-compressed
+    TEX_COMPRESS_FLAGS  compressFlags;
+    float               compressThreshold;
+
+    Impl() noexcept :
+        convert(false),
+        convertFormat(DXGI_FORMAT_UNKNOWN),
+        convertFilter(TEX_FILTER_DEFAULT),
+        convertThreshold(TEX_THRESHOLD_DEFAULT),
+        mipLevels(1),
+        mipFilter(TEX_FILTER_DEFAULT),
+        compressFormat(DXGI_FORMAT_UNKNOWN),
+        compressFlags(TEX_COMPRESS_DEFAULT),
+        compressThreshold(TEX_THRESHOLD_DEFAULT)
+    {}
+
+    static HRESULT Create(Impl*& impl) noexcept
+    {
+        if (!impl)
+        {
+            impl = new (std::nothrow) Impl;
+            if (!impl)
+                return E_OUTOFMEMORY;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT AddOperation(Operation&& op) noexcept
+    {
+        if (HasOutput())
+            return E_UNEXPECTED;
+
+        try
+        {
+            ops.emplace_back(std::move(op));
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        return S_OK;
+    }
+
+    // True once the result has been described, after which no image operations can be added
+    bool HasOutput() const noexcept
+    {
+        return convert || (mipLevels != 1) || (compressFormat != DXGI_FORMAT_UNKNOWN);
+    }
+
+    // sRGB flags that apply to the source (SRGB_IN) and the result (SRGB_OUT)
+    TEX_FILTER_FLAGS GetSRGBFlags() const noexcept
+    {
+        static_assert(static_cast<int>(TEX_PMALPHA_SRGB) == static_cast<int>(TEX_FILTER_SRGB), "TEX_PMALPHA_SRGB* should match TEX_FILTER_SRGB*");
+        static_assert(static_cast<int>(TEX_COMPRESS_SRGB) == static_cast<int>(TEX_FILTER_SRGB), "TEX_COMPRESS_SRGB* should match TEX_FILTER_SRGB*");
+
+        uint32_t flags = convertFilter | compressFlags;
+        for (const auto& op : ops)
+        {
+            if (op.type == OpType::Resize
+                || (op.type == OpType::PremultiplyAlpha && !(op.flags & TEX_PMALPHA_IGNORE_SRGB)))
+            {
+                flags |= op.flags;
+            }
+        }
+
+        return static_cast<TEX_FILTER_FLAGS>(flags & TEX_FILTER_SRGB);
+    }
+
+    void GetOutputSize(size_t width, size_t height, size_t& outWidth, size_t& outHeight) const noexcept
+    {
+        for (const auto& op : ops)
+        {
+            if (op.type == OpType::Resize)
+            {
+                width = op.width;
+                height = op.height;
+            }
+            else if (op.type == OpType::FlipRotate && (op.flags & 0x1))
+            {
+                std::swap(width, height);
+            }
+        }
+
+        outWidth = width;
+        outHeight = height;
+    }
+
+    DXGI_FORMAT GetOutputFormat(DXGI_FORMAT srcFormat) const noexcept
+    {
+        if (compressFormat != DXGI_FORMAT_UNKNOWN)
+            return compressFormat;
+
+        return (convert) ? convertFormat : GetUncompressedFormat(srcFormat);
+    }
+
+    // Appends a new stage, which is freed if it can't be added
+    template<typename T>
+    static HRESULT AddStage(std::vector<std::unique_ptr<Stage>>& stages, std::unique_ptr<T>&& stage) noexcept
+    {
+        if (!stage)
+            return E_OUTOFMEMORY;
+
+        try
+        {
+            stages.emplace_back(std::move(stage));
+        }
+        catch (const std::bad_alloc&)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        return S_OK;
+    }
+
+    // Builds the stages for one source image, and returns the last one
+    HRESULT Build(
+        const Image& srcImage,
+        DXGI_FORMAT outFormat,
+        std::vector<std::unique_ptr<Stage>>& stages,
+        DXGI_FORMAT& workFormat) const
+    {
+        const TEX_FILTER_FLAGS srgb = GetSRGBFlags();
+
+        workFormat = GetWorkFormat(srcImage.format);
+        bool decoded = IsDecoded(srcImage.format, srgb);
+
+        HRESULT hr = AddStage(stages, std::unique_ptr<SourceStage>(new (std::nothrow) SourceStage(srcImage, workFormat, srgb)));
+        if (FAILED(hr))
+            return hr;
+
+        PointStage* point = nullptr;
+        for (const auto& op : ops)
+        {
+            const Stage& current = *stages.back();
+
+            if (op.type != OpType::PremultiplyAlpha && op.type != OpType::Transform)
+                point = nullptr;
+
+            switch (op.type)
+            {
+            case OpType::PremultiplyAlpha:
+            case OpType::Transform:
+                if (!point)
+                {
+                    std::unique_ptr<PointStage> stage(new (std::nothrow) PointStage(current));
+                    point = stage.get();
+                    hr = AddStage(stages, std::move(stage));
+                    if (FAILED(hr))
+                        return hr;
+                }
+                point->Add(op, decoded && (op.type == OpType::PremultiplyAlpha) && (op.flags & TEX_PMALPHA_IGNORE_SRGB));
+                break;
+
+            case OpType::FlipRotate:
+                hr = AddStage(stages, std::unique_ptr<FlipRotateStage>(new (std::nothrow) FlipRotateStage(current, op.flags)));
+                if (FAILED(hr))
+                    return hr;
+                break;
+
+            case OpType::Resize:
+                {
+                    std::unique_ptr<ResizeStage> stage(new (std::nothrow) ResizeStage(current, op.width, op.height));
+                    auto resize = stage.get();
+                    hr = AddStage(stages, std::move(stage));
+                    if (FAILED(hr))
+                        return hr;
+
+                    hr = resize->Initialize(GetResizeFilter(static_cast<TEX_FILTER_FLAGS>(op.flags),
+                        current.GetWidth(), current.GetHeight(), op.width, op.height));
+                    if (FAILED(hr))
+                        return hr;
+                }
+                break;
+
+            case OpType::NormalMap:
+                {
+                    const uint32_t convFlags = GetConvertFlags(outFormat);
+                    if (!(convFlags & (CONVF_UNORM | CONVF_SNORM | CONVF_FLOAT)))
+                        return HRESULT_E_NOT_SUPPORTED;
+
+                    hr = AddStage(stages, std::unique_ptr<NormalMapStage>(new (std::nothrow) NormalMapStage(current, op.flags, op.amplitude, (convFlags & CONVF_UNORM) != 0)));
+                    if (FAILED(hr))
+                        return hr;
+
+                    // The normals are already encoded for the result
+                    workFormat = outFormat;
+                    decoded = false;
+                }
+                break;
+
+            default:
+                return E_UNEXPECTED;
+            }
+        }
+
+        return S_OK;
+    }
+
+    // Runs the pipeline on one image and fills in the levels of (item, slice) of the result
+    HRESULT Process(
+        const Image& image,
+        const ScratchImage& result,
+        size_t item,
+        size_t slice,
+        const std::function<bool __cdecl(size_t, size_t)>& statusCallback) const
+    {
+        // Planar sources are the only ones that can't be read a piece at a time
+        ScratchImage planar;
+        const Image* srcImage = &image;
+        if (IsPlanar(image.format))
+        {
+            HRESULT hr = ConvertToSinglePlane(image, planar);
+            if (FAILED(hr))
+                return hr;
+
+            srcImage = planar.GetImage(0, 0, 0);
+            if (!srcImage)
+                return E_POINTER;
+        }
+
+        const TexMetadata& mdata = result.GetMetadata();
+        const size_t levels = (mdata.IsVolumemap()) ? 1 : mdata.mipLevels;
+
+        const Image* dest = result.GetImage(0, item, slice);
+        if (!dest)
+            return E_POINTER;
+
+        std::vector<std::unique_ptr<Stage>> stages;
+        OutputInfo info = {};
+        HRESULT hr = Build(*srcImage, dest->format, stages, info.workFormat);
+        if (FAILED(hr))
+            return hr;
+
+        const Stage& root = *stages.back();
+        if (root.GetWidth() != dest->width || root.GetHeight() != dest->height)
+            return E_UNEXPECTED;
+
+        const TEX_FILTER_FLAGS srgbOut = static_cast<TEX_FILTER_FLAGS>(GetSRGBFlags() & TEX_FILTER_SRGB_OUT);
+
+        // Mip levels are filtered in linear space like GenerateMipMaps, which also covers results that are only sRGB by flag
+        TEX_FILTER_FLAGS filter = static_cast<TEX_FILTER_FLAGS>((GetMipFilter(mipFilter, dest->width, dest->height) & ~TEX_FILTER_SRGB)
+            | ((srgbOut) ? TEX_FILTER_SRGB : TEX_FILTER_DEFAULT));
+
+        info.filter = static_cast<TEX_FILTER_FLAGS>((convertFilter & ~TEX_FILTER_SRGB) | srgbOut);
+        info.threshold = convertThreshold;
+        info.z = (mdata.IsVolumemap()) ? slice : 0;
+
+        if (compressFormat == DXGI_FORMAT_UNKNOWN)
+        {
+            hr = StoreImage(root, info, *dest, statusCallback);
+            if (FAILED(hr))
+                return hr;
+
+            if (levels > 1)
+            {
+                hr = ResampleMipChain(levels, filter, result, item);
+                if (FAILED(hr))
+                    return hr;
+            }
+
+            return S_OK;
+        }
+
+        const uint32_t bcflags = GetBCFlags(compressFlags);
+
+        OutputInfo compressInfo = info;
+        compressInfo.filter = srgbOut;
+        compressInfo.threshold = compressThreshold;
+
+        if (convert)
+        {
+            // The top level goes through convertFormat like the smaller levels below, so every
+            // level is quantized by the same conversion filter before it's compressed
+            ScratchImage top;
+            hr = top.Initialize2D(convertFormat, dest->width, dest->height, 1, 1);
+            if (FAILED(hr))
+                return hr;
+
+            const Image* topImage = top.GetImage(0, 0, 0);
+            if (!topImage)
+                return E_POINTER;
+
+            hr = StoreImage(root, info, *topImage, statusCallback);
+            if (FAILED(hr))
+                return hr;
+
+            OutputInfo topInfo = compressInfo;
+            topInfo.workFormat = GetWorkFormat(convertFormat);
+
+            SourceStage source(*topImage, topInfo.workFormat, (srgbOut) ? TEX_FILTER_SRGB_IN : TEX_FILTER_DEFAULT);
+            hr = CompressImage(source, topInfo, bcflags, *dest, nullptr);
+        }
+        else
+        {
+            hr = CompressImage(root, compressInfo, bcflags, *dest, statusCallback);
+        }
+        if (FAILED(hr) || levels <= 1)
+            return hr;
+
+        // The smaller levels are built uncompressed, starting from a second pass over the
+        // pipeline at half size, and then compressed a level at a time. That's a third of
+        // the size of the top level rather than all of it.
+        const Image* level1 = result.GetImage(1, item, slice);
+        if (!level1)
+            return E_POINTER;
+
+        ScratchImage mipChain;
+        hr = mipChain.Initialize2D((convert) ? convertFormat : GetUncompressedFormat(compressFormat), level1->width, level1->height, 1, levels - 1);
+        if (FAILED(hr))
+            return hr;
+
+        {
+            ResizeStage half(root, level1->width, level1->height);
+            hr = half.Initialize(filter);
+            if (FAILED(hr))
+                return hr;
+
+            hr = StoreImage(half, info, *mipChain.GetImage(0, 0, 0), statusCallback);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        if (levels > 2)
+        {
+            hr = ResampleMipChain(levels - 1, filter, mipChain, 0);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        for (size_t level = 1; level < levels; ++level)
+        {
+            const Image* src = mipChain.GetImage(level - 1, 0, 0);
+            const Image* cdest = result.GetImage(level, item, slice);
+            if (!src || !cdest)
+                return E_POINTER;
+
+            // Values were stored encoded if SRGB_OUT was requested, so they are read back the same way
+            OutputInfo levelInfo = compressInfo;
+            levelInfo.workFormat = GetWorkFormat(src->format);
+
+            SourceStage source(*src, levelInfo.workFormat, (srgbOut) ? TEX_FILTER_SRGB_IN : TEX_FILTER_DEFAULT);
+            hr = CompressImage(source, levelInfo, bcflags, *cdest, nullptr);
+            if (FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+    HRESULT Validate(DXGI_FORMAT srcFormat, size_t width, size_t height, DXGI_FORMAT& outFormat, size_t& outWidth, size_t& outHeight, size_t& levels) const noexcept
+    {
+        if (!IsValid(srcFormat))
+            return E_INVALIDARG;
+
+        if (IsTypeless(srcFormat) || IsPalettized(srcFormat))
+            return HRESULT_E_NOT_SUPPORTED;
+
+        if ((width > UINT32_MAX) || (height > UINT32_MAX))
+            return E_INVALIDARG;
+
+        outFormat = GetOutputFormat(srcFormat);
+        if (!IsValid(outFormat))
+            return E_INVALIDARG;
+
+        if (IsTypeless(outFormat) || IsPlanar(outFormat) || IsPalettized(outFormat))
+            return HRESULT_E_NOT_SUPPORTED;
+
+        GetOutputSize(width, height, outWidth, outHeight);
+
+        levels = mipLevels;
+        if (!CalculateMipLevels(outWidth, outHeight, levels))
+            return E_INVALIDARG;
+
+        return S_OK;
+    }
+};
+
+
+//-------------------------------------------------------------------------------------
+// Operations
+//-------------------------------------------------------------------------------------
+ImagePipeline& ImagePipeline::operator= (ImagePipeline&& moveFrom) noexcept
+{
+    if (this != &moveFrom)
+    {
+        Release();
+
+        m_impl = moveFrom.m_impl;
+        moveFrom.m_impl = nullptr;
+    }
+    return *this;
+}
+
+void ImagePipeline::Release() noexcept
+{
+    delete m_impl;
+    m_impl = nullptr;
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::PremultiplyAlpha(TEX_PMALPHA_FLAGS flags) noexcept
+{
+    Operation op = {};
+    op.type = OpType::PremultiplyAlpha;
+    op.flags = flags;
+    HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    return m_impl->AddOperation(std::move(op));
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::FlipRotate(TEX_FR_FLAGS flags) noexcept
+{
+    Operation op = {};
+    op.type = OpType::FlipRotate;
+    op.flags = flags;
+    HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    return m_impl->AddOperation(std::move(op));
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::Resize(size_t width, size_t height, TEX_FILTER_FLAGS filter) noexcept
+{
+    if (!width || !height || (width > UINT32_MAX) || (height > UINT32_MAX))
+        return E_INVALIDARG;
+
+    Operation op = {};
+    op.type = OpType::Resize;
+    op.flags = filter;
+    op.width = width;
+    op.height = height;
+    HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    return m_impl->AddOperation(std::move(op));
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::ComputeNormalMap(CNMAP_FLAGS flags, float amplitude) noexcept
+{
+    Operation op = {};
+    op.type = OpType::NormalMap;
+    op.flags = flags;
+    op.amplitude = amplitude;
+    HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    return m_impl->AddOperation(std::move(op));
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::Transform(std::function<void __cdecl(XMVECTOR*, size_t, size_t, size_t)> pixelFunc) noexcept
+{
+    if (!pixelFunc)
+        return E_INVALIDARG;
+
+    Operation op = {};
+    op.type = OpType::Transform;
+    op.pixelFunc = std::move(pixelFunc);
+    HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    return m_impl->AddOperation(std::move(op));
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::Convert(DXGI_FORMAT format, TEX_FILTER_FLAGS filter, float threshold) noexcept
+{
+    if (!IsValid(format) || IsCompressed(format))
+        return E_INVALIDARG;
+
+    if (m_impl && m_impl->HasOutput())
+        return E_UNEXPECTED;
+
+    const HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    m_impl->convert = true;
+    m_impl->convertFormat = format;
+    m_impl->convertFilter = filter;
+    m_impl->convertThreshold = threshold;
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::GenerateMipMaps(TEX_FILTER_FLAGS filter, size_t levels) noexcept
+{
+    if (levels == 1)
+        return E_INVALIDARG;
+
+    switch (filter & TEX_FILTER_MODE_MASK)
+    {
+    case 0:
+    case TEX_FILTER_BOX:
+    case TEX_FILTER_LINEAR:
+    case TEX_FILTER_CUBIC:
+    case TEX_FILTER_TRIANGLE:
+    case TEX_FILTER_LANCZOS:
+    case TEX_FILTER_KAISER:
+        break;
+
+    default:
+        return HRESULT_E_NOT_SUPPORTED;
+    }
+
+    if (m_impl && ((m_impl->mipLevels != 1) || (m_impl->compressFormat != DXGI_FORMAT_UNKNOWN)))
+        return E_UNEXPECTED;
+
+    const HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    m_impl->mipLevels = levels;
+    m_impl->mipFilter = filter;
+    return S_OK;
+}
+
+_Use_decl_annotations_
+HRESULT ImagePipeline::Compress(DXGI_FORMAT format, TEX_COMPRESS_FLAGS compress, float threshold) noexcept
+{
+    if (!IsCompressed(format) || IsTypeless(format))
+        return E_INVALIDARG;
+
+    if (m_impl && (m_impl->compressFormat != DXGI_FORMAT_UNKNOWN))
+        return E_UNEXPECTED;
+
+    const HRESULT hr = Impl::Create(m_impl);
+    if (FAILED(hr))
+        return hr;
+
+    m_impl->compressFormat = format;
+    m_impl->compressFlags = compress;
+    m_impl->compressThreshold = threshold;
+    return S_OK;
+}
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+// Run the pipeline on a single image
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT ImagePipeline::Execute(
+    const Image& srcImage,
+    ScratchImage& result,
+    std::function<bool __cdecl(size_t, size_t)> statusCallback) const
+{
+    if (!srcImage.pixels)
+        return E_POINTER;
+
+    static const Impl s_empty;
+    const Impl& impl = (m_impl) ? *m_impl : s_empty;
+
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    size_t width = 0;
+    size_t height = 0;
+    size_t levels = 0;
+    HRESULT hr = impl.Validate(srcImage.format, srcImage.width, srcImage.height, format, width, height, levels);
+    if (FAILED(hr))
+        return hr;
+
+    hr = result.Initialize2D(format, width, height, 1, levels);
+    if (FAILED(hr))
+        return hr;
+
+    hr = impl.Process(srcImage, result, 0, 0, statusCallback);
+    if (FAILED(hr))
+    {
+        result.Release();
+        return hr;
+    }
+
+    return S_OK;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Run the pipeline on every item of a texture
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT ImagePipeline::Execute(
+    const Image* srcImages,
+    size_t nimages,
+    const TexMetadata& metadata,
+    ScratchImage& result,
+    std::function<bool __cdecl(size_t, size_t)> statusCallback) const
+{
+    if (!srcImages || !nimages)
+        return E_INVALIDARG;
+
+    static const Impl s_empty;
+    const Impl& impl = (m_impl) ? *m_impl : s_empty;
+
+    TexMetadata mdata2 = metadata;
+    HRESULT hr = impl.Validate(metadata.format, metadata.width, metadata.height, mdata2.format, mdata2.width, mdata2.height, mdata2.mipLevels);
+    if (FAILED(hr))
+        return hr;
+
+    if (metadata.IsVolumemap() && mdata2.mipLevels > 1)
+        return HRESULT_E_NOT_SUPPORTED;
+
+    if (mdata2.dimension == TEX_DIMENSION_TEXTURE1D && mdata2.height > 1)
+        mdata2.dimension = TEX_DIMENSION_TEXTURE2D;
+
+    hr = result.Initialize(mdata2);
+    if (FAILED(hr))
+        return hr;
+
+    const size_t items = (metadata.IsVolumemap()) ? 1 : metadata.arraySize;
+    const size_t slices = (metadata.IsVolumemap()) ? metadata.depth : 1;
+
+    for (size_t item = 0; item < items; ++item)
+    {
+        for (size_t slice = 0; slice < slices; ++slice)
+        {
+            const size_t index = metadata.ComputeIndex(0, item, slice);
+            if (index >= nimages || !srcImages[index].pixels)
+            {
+                result.Release();
+                return E_POINTER;
+            }
+
+            const Image& src = srcImages[index];
+            if (src.format != metadata.format || src.width != metadata.width || src.height != metadata.height)
+            {
+                result.Release();
+                return E_FAIL;
+            }
+
+            hr = impl.Process(src, result, item, slice, statusCallback);
+            if (FAILED(hr))
+            {
+                result.Release();
+                return hr;
+            }
+        }
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,1027 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexResample.cpp
+//
+// DirectX Texture Library - Separable polyphase image resampling
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#include "filters.h"
+#include "resample.h"
+#include "scheduler.h"
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+using namespace DirectX;
+using namespace DirectX::Internal;
+
+namespace
+{
+    //-------------------------------------------------------------------------------------
+    // Kernels
+    //-------------------------------------------------------------------------------------
+
+    enum class Kernel : uint32_t
+    {
+        Box,
+        Tent,
+        Cubic,      // 4-tap cubic interpolation (TEX_FILTER_CUBIC)
+        Lanczos3,
+        Kaiser,
+        Triangle,   // Exact per-texel tent integration of CreateTriangleFilter (TEX_FILTER_TRIANGLE)
+    };
+
+    enum class Address : uint32_t
+    {
+        Clamp,
+        Wrap,
+        Mirror,
+    };
+
+    constexpr float c_kaiserAlpha = 4.f;
+
+    inline float Sinc(float x) noexcept
+    {
+        if (fabsf(x) < 1e-6f)
+            return 1.f;
+
+        x *= XM_PI;
+        return sinf(x) / x;
+    }
+
+    // Zeroth-order modified Bessel function of the first kind
+    inline double BesselI0(double x) noexcept
+    {
+        const double q = x * x * 0.25;
+
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 64; ++k)
+        {
+            term *= q / (double(k) * double(k));
+            sum += term;
+            if (term < sum * 1e-12)
+                break;
+        }
+
+        return sum;
+    }
+
+    constexpr double KernelRadius(Kernel kernel) noexcept
+    {
+        switch (kernel)
+        {
+        case Kernel::Box:       return 0.5;
+        case Kernel::Tent:      return 1.0;
+        case Kernel::Cubic:     return 2.0;
+        default:                return 3.0;
+        }
+    }
+
+    float EvaluateKernel(Kernel kernel, float x) noexcept
+    {
+        switch (kernel)
+        {
+        case Kernel::Box:
+            return (x >= -0.5f && x < 0.5f) ? 1.f : 0.f;
+
+        case Kernel::Tent:
+            return std::max(0.f, 1.f - fabsf(x));
+
+        case Kernel::Lanczos3:
+            return (fabsf(x) < 3.f) ? Sinc(x) * Sinc(x / 3.f) : 0.f;
+
+        case Kernel::Kaiser:
+            if (fabsf(x) < 3.f)
+            {
+                static const double s_i0Alpha = BesselI0(c_kaiserAlpha);
+
+                const double t = double(x) / 3.0;
+                return Sinc(x) * float(BesselI0(c_kaiserAlpha * sqrt(1.0 - t * t)) / s_i0Alpha);
+            }
+            return 0.f;
+
+        default:
+            return 0.f;
+        }
+    }
+
+    inline size_t BoundIndex(ptrdiff_t u, size_t size, Address address) noexcept
+    {
+        const auto n = static_cast<ptrdiff_t>(size);
+
+        switch (address)
+        {
+        case Address::Wrap:
+            u %= n;
+            if (u < 0)
+                u += n;
+            break;
+
+        case Address::Mirror:
+            u %= (n * 2);
+            if (u < 0)
+                u += n * 2;
+            if (u >= n)
+                u = n * 2 - 1 - u;
+            break;
+
+        default:
+            u = std::min<ptrdiff_t>(std::max<ptrdiff_t>(u, 0), n - 1);
+            break;
+        }
+
+        return static_cast<size_t>(u);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Per-axis weights
+    //-------------------------------------------------------------------------------------
+
+    // Fixed-point weights for 8-bit and 16-bit channels
+    constexpr int c_fixedBits = 14;
+    constexpr int c_fixedBitsWide = 20;
+
+    // Widest kernel the fixed-point path is used for; beyond this the individual weights get too small
+    constexpr size_t c_fixedMaxTaps = 64;
+
+    // Rounds weights to fixed-point so that they add up to exactly one
+    template<typename T>
+    void QuantizeWeights(const float* weight, size_t count, int bits, T* fixedWeight) noexcept
+    {
+        const float one = float(1 << bits);
+        const float minWeight = float(std::numeric_limits<T>::min());
+        const float maxWeight = float(std::numeric_limits<T>::max());
+
+        int64_t sum = 0;
+        size_t largest = 0;
+        for (size_t t = 0; t < count; ++t)
+        {
+            fixedWeight[t] = static_cast<T>(lrintf(std::min(std::max(weight[t] * one, minWeight), maxWeight)));
+            sum += fixedWeight[t];
+
+            if (fabsf(weight[t]) > fabsf(weight[largest]))
+                largest = t;
+        }
+
+        if (count > 0)
+        {
+            const int64_t adjusted = int64_t(fixedWeight[largest]) + ((int64_t(1) << bits) - sum);
+            fixedWeight[largest] = static_cast<T>(std::min<int64_t>(std::max<int64_t>(adjusted, std::numeric_limits<T>::min()), std::numeric_limits<T>::max()));
+        }
+    }
+
+    // Transposes the per-source-texel weights of CreateTriangleFilter into per-destination taps so
+    // TEX_FILTER_TRIANGLE keeps its exact weights. These are not renormalized, and mirror is the
+    // same as clamp, just as with the original triangle filter.
+    HRESULT CreateTriangleAxisFilter(
+        size_t source,
+        size_t dest,
+        bool wrap,
+        AxisFilter& af) noexcept
+    {
+        using namespace DirectX::Filters;
+
+        std::unique_ptr<Filter> tf;
+        HRESULT hr = CreateTriangleFilter(source, dest, wrap, tf);
+        if (FAILED(hr))
+            return hr;
+
+        auto fromEnd = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(tf.get()) + tf->sizeInBytes);
+
+        af.maxTaps = 0;
+        af.uniformTaps = 0;
+        af.first.reset(new (std::nothrow) size_t[dest + 1]);
+        std::unique_ptr<size_t[]> next(new (std::nothrow) size_t[dest]);
+        if (!af.first || !next)
+            return E_OUTOFMEMORY;
+
+        // Count the source texels that contribute to each destination texel
+        memset(af.first.get(), 0, sizeof(size_t) * (dest + 1));
+
+        for (const FilterFrom* from = tf->from; from < fromEnd; from = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(from) + from->sizeInBytes))
+        {
+            for (size_t j = 0; j < from->count; ++j)
+            {
+                const size_t u = from->to[j].u;
+                if (u >= dest)
+                    return E_FAIL;
+
+                ++af.first[u + 1];
+            }
+        }
+
+        for (size_t u = 0; u < dest; ++u)
+            af.first[u + 1] += af.first[u];
+
+        const size_t capacity = af.first[dest];
+
+        af.index.reset(new (std::nothrow) uint32_t[capacity]);
+        af.weight.reset(new (std::nothrow) float[capacity]);
+        af.fixedWeight.reset(new (std::nothrow) int16_t[capacity]);
+        af.fixedWeightWide.reset(new (std::nothrow) int32_t[capacity]);
+        if (!af.index || !af.weight || !af.fixedWeight || !af.fixedWeightWide)
+            return E_OUTOFMEMORY;
+
+        memcpy(next.get(), af.first.get(), sizeof(size_t) * dest);
+
+        // The from entries are in source texel order, so every destination texel gets its taps in ascending order
+        uint32_t x = 0;
+        for (const FilterFrom* from = tf->from; from < fromEnd; from = reinterpret_cast<const FilterFrom*>(reinterpret_cast<const uint8_t*>(from) + from->sizeInBytes), ++x)
+        {
+            for (size_t j = 0; j < from->count; ++j)
+            {
+                const size_t u = from->to[j].u;
+                const size_t t = next[u];
+                if (t > af.first[u] && af.index[t - 1] == x)
+                {
+                    af.weight[t - 1] += from->to[j].weight;
+                }
+                else
+                {
+                    af.index[t] = x;
+                    af.weight[t] = from->to[j].weight;
+                    ++next[u];
+                }
+            }
+        }
+
+        // Close any gaps left by merged taps and compute the fixed-point weights
+        bool uniform = true;
+
+        size_t total = 0;
+        for (size_t u = 0; u < dest; ++u)
+        {
+            const size_t start = af.first[u];
+            const size_t count = next[u] - start;
+
+            af.first[u] = total;
+            if (start != total)
+            {
+                memmove(af.index.get() + total, af.index.get() + start, sizeof(uint32_t) * count);
+                memmove(af.weight.get() + total, af.weight.get() + start, sizeof(float) * count);
+            }
+
+            QuantizeWeights(af.weight.get() + total, count, c_fixedBits, af.fixedWeight.get() + total);
+            QuantizeWeights(af.weight.get() + total, count, c_fixedBitsWide, af.fixedWeightWide.get() + total);
+
+            if (u > 0 && count != af.maxTaps)
+                uniform = false;
+
+            af.maxTaps = std::max(af.maxTaps, count);
+            total += count;
+        }
+
+        af.first[dest] = total;
+        af.uniformTaps = (uniform) ? af.maxTaps : 0;
+
+        return S_OK;
+    }
+
+    HRESULT CreateAxisFilter(
+        size_t source,
+        size_t dest,
+        Kernel kernel,
+        bool widen,
+        Address address,
+        AxisFilter& af) noexcept
+    {
+        assert(source > 0 && dest > 0);
+
+        if (kernel == Kernel::Triangle)
+            return CreateTriangleAxisFilter(source, dest, address == Address::Wrap, af);
+
+        const double scale = double(source) / double(dest);
+        const double support = (widen && scale > 1.0) ? scale : 1.0;
+        const double radius = KernelRadius(kernel) * support;
+
+        const size_t tapLimit = (!widen) ? ((kernel == Kernel::Cubic) ? 4 : 2) : (size_t(2.0 * radius) + 3);
+
+        af.maxTaps = 0;
+        af.uniformTaps = 0;
+        af.first.reset(new (std::nothrow) size_t[dest + 1]);
+        af.index.reset(new (std::nothrow) uint32_t[dest * tapLimit]);
+        af.weight.reset(new (std::nothrow) float[dest * tapLimit]);
+        af.fixedWeight.reset(new (std::nothrow) int16_t[dest * tapLimit]);
+        af.fixedWeightWide.reset(new (std::nothrow) int32_t[dest * tapLimit]);
+        if (!af.first || !af.index || !af.weight || !af.fixedWeight || !af.fixedWeightWide)
+            return E_OUTOFMEMORY;
+
+        bool uniform = true;
+
+        size_t total = 0;
+        for (size_t u = 0; u < dest; ++u)
+        {
+            af.first[u] = total;
+
+            uint32_t* index = af.index.get() + total;
+            float* weight = af.weight.get() + total;
+            size_t count = 0;
+
+            auto addTap = [&](ptrdiff_t i, float w)
+            {
+                const auto bound = static_cast<uint32_t>(BoundIndex(i, source, address));
+                if (widen && count > 0 && index[count - 1] == bound)
+                {
+                    weight[count - 1] += w;
+                }
+                else if (count < tapLimit)
+                {
+                    index[count] = bound;
+                    weight[count] = w;
+                    ++count;
+                }
+            };
+
+            if (!widen && kernel == Kernel::Tent)
+            {
+                // Same sample positions and weights as CreateLinearFilter
+                const float fscale = float(source) / float(dest);
+                const float srcB = (float(u) + 0.5f) * fscale + 0.5f;
+
+                const auto isrcB = static_cast<ptrdiff_t>(srcB);
+                const float w = 1.0f + float(isrcB) - srcB;
+
+                addTap(isrcB - 1, w);
+                addTap(isrcB, 1.0f - w);
+            }
+            else if (!widen && kernel == Kernel::Cubic)
+            {
+                // Same sample positions as CreateCubicFilter, with CUBIC_INTERPOLATE expanded into weights
+                const float fscale = float(source) / float(dest);
+                const float srcB = (float(u) + 0.5f) * fscale - 0.5f;
+
+                const auto isrcB = static_cast<ptrdiff_t>(srcB);
+                const float x = srcB - float(isrcB);
+                const float x2 = x * x;
+                const float x3 = x2 * x;
+
+                const float w0 = -x / 3.f + x2 / 2.f - x3 / 6.f;
+                const float w2 = x + x2 / 2.f - x3 / 2.f;
+                const float w3 = -x / 6.f + x3 / 6.f;
+
+                addTap(isrcB - 1, w0);
+                addTap(isrcB, 1.f - w0 - w2 - w3);
+                addTap(isrcB + 1, w2);
+                addTap(isrcB + 2, w3);
+            }
+            else
+            {
+                const double center = (double(u) + 0.5) * scale - 0.5;
+                const auto lo = static_cast<ptrdiff_t>(floor(center - radius));
+                const auto hi = static_cast<ptrdiff_t>(ceil(center + radius));
+
+                // A reducing box filter weights each texel by how much of it the destination texel covers
+                const bool area = (kernel == Kernel::Box) && (support > 1.0);
+
+                float sum = 0.f;
+                for (ptrdiff_t i = lo; i <= hi; ++i)
+                {
+                    const float w = (area)
+                        ? float(std::max(0.0, std::min(double(i) + 0.5, center + radius) - std::max(double(i) - 0.5, center - radius)))
+                        : EvaluateKernel(kernel, float((double(i) - center) / support));
+                    if (w != 0.f)
+                    {
+                        addTap(i, w);
+                        sum += w;
+                    }
+                }
+
+                if (fabsf(sum) < 1e-6f)
+                {
+                    // Degenerate kernel, so fall back to the nearest texel
+                    count = 0;
+                    addTap(static_cast<ptrdiff_t>(floor(center + 0.5)), 1.f);
+                }
+                else
+                {
+                    for (size_t t = 0; t < count; ++t)
+                        weight[t] /= sum;
+                }
+            }
+
+            QuantizeWeights(weight, count, c_fixedBits, af.fixedWeight.get() + total);
+            QuantizeWeights(weight, count, c_fixedBitsWide, af.fixedWeightWide.get() + total);
+
+            if (u > 0 && count != af.maxTaps)
+                uniform = false;
+
+            af.maxTaps = std::max(af.maxTaps, count);
+            total += count;
+        }
+
+        af.first[dest] = total;
+        af.uniformTaps = (uniform) ? af.maxTaps : 0;
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Banding
+    //-------------------------------------------------------------------------------------
+
+    // Vertical tap of a band: destination row 'row' (relative to the band) uses 'source' with weight number 'tap'
+    struct RowTap
+    {
+        uint32_t    source;
+        uint32_t    row;
+        size_t      tap;
+    };
+
+    // Lists the source rows a band of destination rows uses, sorted so that each source row is
+    // filtered horizontally once and then added into every destination row that needs it
+    std::unique_ptr<RowTap[]> GetBandTaps(const AxisFilter& fy, size_t y0, size_t y1, size_t& count) noexcept
+    {
+        count = fy.first[y1] - fy.first[y0];
+
+        std::unique_ptr<RowTap[]> taps(new (std::nothrow) RowTap[count]);
+        if (!taps)
+            return nullptr;
+
+        size_t n = 0;
+        for (size_t y = y0; y < y1; ++y)
+        {
+            for (size_t t = fy.first[y]; t < fy.first[y + 1]; ++t)
+            {
+                taps[n].source = fy.index[t];
+                taps[n].row = static_cast<uint32_t>(y - y0);
+                taps[n].tap = t;
+                ++n;
+            }
+        }
+
+        std::sort(taps.get(), taps.get() + count, [](const RowTap& a, const RowTap& b) noexcept
+            {
+                return (a.source != b.source) ? (a.source < b.source) : (a.row < b.row);
+            });
+
+        return taps;
+    }
+
+    inline size_t GetBandRows(size_t width, size_t height) noexcept
+    {
+        // Aim for a few bands per thread while keeping a band's accumulators a modest size,
+        // since the horizontal pass is repeated for source rows shared by neighbouring bands
+        constexpr size_t c_minBandRows = 16;
+        constexpr size_t c_bandBytes = 1024 * 1024;
+
+        const size_t bands = TaskScheduler::GetConcurrency() * 4;
+        size_t rows = std::max(c_minBandRows, (height + bands - 1) / bands);
+        rows = std::min(rows, std::max(c_minBandRows, c_bandBytes / (std::max<size_t>(width, 1) * sizeof(XMVECTOR))));
+        return std::min(rows, height);
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Floating-point path
+    //-------------------------------------------------------------------------------------
+
+    template<size_t Taps>
+    void FilterRowFloat(XMVECTOR* pDestination, const XMVECTOR* pSource, const AxisFilter& fx, size_t width) noexcept
+    {
+        const uint32_t* index = fx.index.get();
+        const float* weight = fx.weight.get();
+
+        for (size_t x = 0; x < width; ++x, index += Taps, weight += Taps)
+        {
+            XMVECTOR v = XMVectorScale(pSource[index[0]], weight[0]);
+            for (size_t t = 1; t < Taps; ++t)
+            {
+                v = XMVectorMultiplyAdd(pSource[index[t]], XMVectorReplicate(weight[t]), v);
+            }
+            pDestination[x] = v;
+        }
+    }
+
+    void FilterRowFloat(XMVECTOR* pDestination, const XMVECTOR* pSource, const AxisFilter& fx, size_t width) noexcept
+    {
+        switch (fx.uniformTaps)
+        {
+        case 2: FilterRowFloat<2>(pDestination, pSource, fx, width); return;
+        case 4: FilterRowFloat<4>(pDestination, pSource, fx, width); return;
+        default: break;
+        }
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            XMVECTOR v = XMVectorZero();
+            for (size_t t = fx.first[x]; t < fx.first[x + 1]; ++t)
+            {
+                v = XMVectorMultiplyAdd(pSource[fx.index[t]], XMVectorReplicate(fx.weight[t]), v);
+            }
+            pDestination[x] = v;
+        }
+    }
+
+    void AccumulateRowFloat(XMVECTOR* pAccum, const XMVECTOR* pSource, float weight, size_t width) noexcept
+    {
+    #ifdef _XM_AVX2_INTRINSICS_
+        // Two pixels at a time
+        const __m256 w = _mm256_set1_ps(weight);
+
+        auto pA = reinterpret_cast<float*>(pAccum);
+        auto pS = reinterpret_cast<const float*>(pSource);
+
+        size_t x = 0;
+        for (; x + 2 <= width; x += 2)
+        {
+            const __m256 v = _mm256_fmadd_ps(_mm256_loadu_ps(pS + x * 4), w, _mm256_loadu_ps(pA + x * 4));
+            _mm256_storeu_ps(pA + x * 4, v);
+        }
+
+        if (x < width)
+        {
+            pAccum[x] = XMVectorMultiplyAdd(pSource[x], XMVectorReplicate(weight), pAccum[x]);
+        }
+    #else
+        const XMVECTOR w = XMVectorReplicate(weight);
+        for (size_t x = 0; x < width; ++x)
+        {
+            pAccum[x] = XMVectorMultiplyAdd(pSource[x], w, pAccum[x]);
+        }
+    #endif
+    }
+
+    HRESULT ResampleBandFloat(
+        const Image& srcImage,
+        TEX_FILTER_FLAGS filter,
+        const Image& destImage,
+        const AxisFilter& fx,
+        const AxisFilter& fy,
+        bool biasAlpha,
+        size_t y0,
+        size_t y1) noexcept
+    {
+        const size_t rows = y1 - y0;
+
+        // Source scanline, horizontally filtered scanline, and an accumulator per band row
+        auto scanline = make_AlignedArrayXMVECTOR(uint64_t(srcImage.width) + uint64_t(destImage.width) * (rows + 1));
+        if (!scanline)
+            return E_OUTOFMEMORY;
+
+        XMVECTOR* sourceRow = scanline.get();
+        XMVECTOR* filtered = sourceRow + srcImage.width;
+        XMVECTOR* accum = filtered + destImage.width;
+
+        size_t tapCount = 0;
+        auto taps = GetBandTaps(fy, y0, y1, tapCount);
+        if (!taps)
+            return E_OUTOFMEMORY;
+
+        const XMVECTOR zero = XMVectorZero();
+        for (size_t j = 0; j < destImage.width * rows; ++j)
+            accum[j] = zero;
+
+        size_t current = size_t(-1);
+        for (size_t j = 0; j < tapCount; ++j)
+        {
+            const RowTap& tap = taps[j];
+
+            if (tap.source != current)
+            {
+                current = tap.source;
+
+                if (!LoadScanlineLinear(sourceRow, srcImage.width, srcImage.pixels + srcImage.rowPitch * current, srcImage.rowPitch, srcImage.format, filter))
+                    return E_FAIL;
+
+                FilterRowFloat(filtered, sourceRow, fx, destImage.width);
+            }
+
+            AccumulateRowFloat(accum + destImage.width * tap.row, filtered, fy.weight[tap.tap], destImage.width);
+        }
+
+        if (biasAlpha)
+        {
+            // Need to slightly bias results for floating-point error accumulation which can
+            // be visible with harshly quantized values
+            static const XMVECTORF32 Bias = { { { 0.f, 0.f, 0.f, 0.1f } } };
+
+            for (size_t j = 0; j < destImage.width * rows; ++j)
+                accum[j] = XMVectorAdd(accum[j], Bias);
+        }
+
+        uint8_t* pDest = destImage.pixels + destImage.rowPitch * y0;
+        for (size_t y = 0; y < rows; ++y)
+        {
+            // This performs any required clamping
+            if (!StoreScanlineLinear(pDest, destImage.rowPitch, destImage.format, accum + destImage.width * y, destImage.width, filter))
+                return E_FAIL;
+            pDest += destImage.rowPitch;
+        }
+
+        return S_OK;
+    }
+
+
+    //-------------------------------------------------------------------------------------
+    // Fixed-point path for UNORM formats
+    //-------------------------------------------------------------------------------------
+
+    // 8-bit channels use 14-bit weights and keep 7 extra bits of precision between the passes
+    struct Unorm8
+    {
+        using Channel = uint8_t;
+        using Weight = int16_t;
+        using Accum = int32_t;
+        static constexpr int c_horizontalShift = c_fixedBits - 7;
+        static constexpr int c_verticalShift = c_fixedBits + 7;
+        static constexpr int32_t c_max = UINT8_MAX;
+
+        static const Weight* GetWeights(const AxisFilter& af) noexcept { return af.fixedWeight.get(); }
+    };
+
+    // 16-bit channels use 20-bit weights, keep 4 extra bits, and accumulate in 64 bits
+    struct Unorm16
+    {
+        using Channel = uint16_t;
+        using Weight = int32_t;
+        using Accum = int64_t;
+        static constexpr int c_horizontalShift = c_fixedBitsWide - 4;
+        static constexpr int c_verticalShift = c_fixedBitsWide + 4;
+        static constexpr int32_t c_max = UINT16_MAX;
+
+        static const Weight* GetWeights(const AxisFilter& af) noexcept { return af.fixedWeightWide.get(); }
+    };
+
+    bool GetFixedPointFormat(DXGI_FORMAT format, TEX_FILTER_FLAGS filter, size_t& channels, bool& wide) noexcept
+    {
+        switch (format)
+        {
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+        case DXGI_FORMAT_B8G8R8A8_UNORM:
+            channels = 4;
+            wide = false;
+            break;
+
+        case DXGI_FORMAT_R8G8_UNORM:
+            channels = 2;
+            wide = false;
+            break;
+
+        case DXGI_FORMAT_R8_UNORM:
+            channels = 1;
+            wide = false;
+            break;
+
+        case DXGI_FORMAT_A8_UNORM:
+            // sRGB flags are ignored for alpha-only formats
+            channels = 1;
+            wide = false;
+            return true;
+
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+            channels = 4;
+            wide = true;
+            break;
+
+        case DXGI_FORMAT_R16G16_UNORM:
+            channels = 2;
+            wide = true;
+            break;
+
+        case DXGI_FORMAT_R16_UNORM:
+            channels = 1;
+            wide = true;
+            break;
+
+        default:
+            return false;
+        }
+
+        // Any sRGB conversion needs the float path
+        return (filter & TEX_FILTER_SRGB) == 0;
+    }
+
+    template<typename Traits, size_t Channels>
+    void FilterRowFixed(int32_t* pDestination, const typename Traits::Channel* pSource, const AxisFilter& fx, size_t width) noexcept
+    {
+        using Accum = typename Traits::Accum;
+        constexpr Accum c_round = Accum(1) << (Traits::c_horizontalShift - 1);
+
+        const typename Traits::Weight* weight = Traits::GetWeights(fx);
+
+        for (size_t x = 0; x < width; ++x)
+        {
+            Accum v[Channels];
+            for (size_t c = 0; c < Channels; ++c)
+                v[c] = c_round;
+
+            for (size_t t = fx.first[x]; t < fx.first[x + 1]; ++t)
+            {
+                const typename Traits::Channel* p = pSource + size_t(fx.index[t]) * Channels;
+                const Accum w = weight[t];
+                for (size_t c = 0; c < Channels; ++c)
+                    v[c] += Accum(p[c]) * w;
+            }
+
+            for (size_t c = 0; c < Channels; ++c)
+                *pDestination++ = static_cast<int32_t>(v[c] >> Traits::c_horizontalShift);
+        }
+    }
+
+    void AccumulateRowFixed(int32_t* pAccum, const int32_t* pSource, int16_t weight, size_t count) noexcept
+    {
+        size_t j = 0;
+    #ifdef _XM_AVX2_INTRINSICS_
+        const __m256i w = _mm256_set1_epi32(weight);
+        for (; j + 8 <= count; j += 8)
+        {
+            const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pSource + j));
+            const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pAccum + j));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(pAccum + j), _mm256_add_epi32(a, _mm256_mullo_epi32(s, w)));
+        }
+    #endif
+        for (; j < count; ++j)
+        {
+            pAccum[j] += pSource[j] * int32_t(weight);
+        }
+    }
+
+    void AccumulateRowFixed(int64_t* pAccum, const int32_t* pSource, int32_t weight, size_t count) noexcept
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            pAccum[j] += int64_t(pSource[j]) * int64_t(weight);
+        }
+    }
+
+    template<typename Traits, size_t Channels>
+    HRESULT ResampleBandFixed(
+        const Image& srcImage,
+        const Image& destImage,
+        const AxisFilter& fx,
+        const AxisFilter& fy,
+        size_t y0,
+        size_t y1) noexcept
+    {
+        using Channel = typename Traits::Channel;
+        using Accum = typename Traits::Accum;
+
+        const size_t rows = y1 - y0;
+        const size_t rowCount = destImage.width * Channels;
+
+        std::unique_ptr<int32_t[]> filtered(new (std::nothrow) int32_t[rowCount]);
+        std::unique_ptr<Accum[]> accum(new (std::nothrow) Accum[rowCount * rows]);
+        if (!filtered || !accum)
+            return E_OUTOFMEMORY;
+
+        size_t tapCount = 0;
+        auto taps = GetBandTaps(fy, y0, y1, tapCount);
+        if (!taps)
+            return E_OUTOFMEMORY;
+
+        const typename Traits::Weight* weight = Traits::GetWeights(fy);
+
+        memset(accum.get(), 0, sizeof(Accum) * rowCount * rows);
+
+        size_t current = size_t(-1);
+        for (size_t j = 0; j < tapCount; ++j)
+        {
+            const RowTap& tap = taps[j];
+
+            if (tap.source != current)
+            {
+                current = tap.source;
+
+                auto pSrc = reinterpret_cast<const Channel*>(srcImage.pixels + srcImage.rowPitch * current);
+                FilterRowFixed<Traits, Channels>(filtered.get(), pSrc, fx, destImage.width);
+            }
+
+            AccumulateRowFixed(accum.get() + rowCount * tap.row, filtered.get(), weight[tap.tap], rowCount);
+        }
+
+        constexpr Accum c_round = Accum(1) << (Traits::c_verticalShift - 1);
+
+        for (size_t y = 0; y < rows; ++y)
+        {
+            const Accum* pAccum = accum.get() + rowCount * y;
+            auto pDest = reinterpret_cast<Channel*>(destImage.pixels + destImage.rowPitch * (y0 + y));
+            for (size_t j = 0; j < rowCount; ++j)
+            {
+                const Accum v = (pAccum[j] + c_round) >> Traits::c_verticalShift;
+                pDest[j] = static_cast<Channel>(std::min<Accum>(std::max<Accum>(v, 0), Traits::c_max));
+            }
+        }
+
+        return S_OK;
+    }
+
+    template<typename Traits>
+    HRESULT ResampleBandFixed(
+        size_t channels,
+        const Image& srcImage,
+        const Image& destImage,
+        const AxisFilter& fx,
+        const AxisFilter& fy,
+        size_t y0,
+        size_t y1) noexcept
+    {
+        switch (channels)
+        {
+        case 1: return ResampleBandFixed<Traits, 1>(srcImage, destImage, fx, fy, y0, y1);
+        case 2: return ResampleBandFixed<Traits, 2>(srcImage, destImage, fx, fy, y0, y1);
+        case 4: return ResampleBandFixed<Traits, 4>(srcImage, destImage, fx, fy, y0, y1);
+        default: return E_UNEXPECTED;
+        }
+    }
+
+
+    //-------------------------------------------------------------------------------------
+
+    bool GetKernel(TEX_FILTER_FLAGS filter, Kernel& kernel, bool& widen) noexcept
+    {
+        static_assert(TEX_FILTER_POINT == 0x100000, "TEX_FILTER_ flag values don't match TEX_FILTER_MODE_MASK");
+
+        switch (filter & TEX_FILTER_MODE_MASK)
+        {
+        case TEX_FILTER_POINT:      kernel = Kernel::Box;       widen = false; break;
+        case TEX_FILTER_LINEAR:     kernel = Kernel::Tent;      widen = false; break;
+        case TEX_FILTER_CUBIC:      kernel = Kernel::Cubic;     widen = false; break;
+        case TEX_FILTER_BOX:        kernel = Kernel::Box;       widen = true; break;
+        case TEX_FILTER_TRIANGLE:   kernel = Kernel::Triangle;  widen = true; break;
+        case TEX_FILTER_LANCZOS:    kernel = Kernel::Lanczos3;  widen = true; break;
+        case TEX_FILTER_KAISER:     kernel = Kernel::Kaiser;    widen = true; break;
+        default:
+            return false;
+        }
+
+        return true;
+    }
+
+    inline Address GetAddress(TEX_FILTER_FLAGS filter, uint32_t wrapFlag, uint32_t mirrorFlag, Kernel kernel, bool widen) noexcept
+    {
+        if (filter & wrapFlag)
+            return Address::Wrap;
+
+        // Mirror has always been the same as clamp for linear filtering
+        if ((filter & mirrorFlag) && (widen || kernel != Kernel::Tent))
+            return Address::Mirror;
+
+        return Address::Clamp;
+    }
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+//-------------------------------------------------------------------------------------
+// Per-axis weights
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Internal::CreateResampleAxis(
+    size_t source,
+    size_t dest,
+    TEX_FILTER_FLAGS filter,
+    bool vertical,
+    AxisFilter& af) noexcept
+{
+    if (!source || !dest || (source > UINT32_MAX))
+        return E_INVALIDARG;
+
+    Kernel kernel;
+    bool widen;
+    if (!GetKernel(filter, kernel, widen))
+        return HRESULT_E_NOT_SUPPORTED;
+
+    const Address address = (vertical)
+        ? GetAddress(filter, TEX_FILTER_WRAP_V, TEX_FILTER_MIRROR_V, kernel, widen)
+        : GetAddress(filter, TEX_FILTER_WRAP_U, TEX_FILTER_MIRROR_U, kernel, widen);
+
+    return CreateAxisFilter(source, dest, kernel, widen, address, af);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Resample image
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Internal::ResampleImage(
+    const Image& srcImage,
+    TEX_FILTER_FLAGS filter,
+    const Image& destImage) noexcept
+{
+    if (!srcImage.pixels || !destImage.pixels)
+        return E_POINTER;
+
+    if (srcImage.format != destImage.format
+        || !srcImage.width || !srcImage.height
+        || !destImage.width || !destImage.height)
+        return E_INVALIDARG;
+
+    if ((srcImage.width > UINT32_MAX) || (srcImage.height > UINT32_MAX))
+        return E_INVALIDARG;
+
+    Kernel kernel;
+    bool widen;
+    if (!GetKernel(filter, kernel, widen))
+        return HRESULT_E_NOT_SUPPORTED;
+
+    AxisFilter fx;
+    HRESULT hr = CreateAxisFilter(srcImage.width, destImage.width, kernel, widen,
+        GetAddress(filter, TEX_FILTER_WRAP_U, TEX_FILTER_MIRROR_U, kernel, widen), fx);
+    if (FAILED(hr))
+        return hr;
+
+    AxisFilter fy;
+    hr = CreateAxisFilter(srcImage.height, destImage.height, kernel, widen,
+        GetAddress(filter, TEX_FILTER_WRAP_V, TEX_FILTER_MIRROR_V, kernel, widen), fy);
+    if (FAILED(hr))
+        return hr;
+
+    size_t channels = 0;
+    bool wide = false;
+    const bool fixedPoint = GetFixedPointFormat(srcImage.format, filter, channels, wide)
+        && (fx.maxTaps <= c_fixedMaxTaps) && (fy.maxTaps <= c_fixedMaxTaps);
+
+    // TEX_FILTER_TRIANGLE sums many small contributions, so 2-bit alpha keeps the bias it has always had
+    const bool biasAlpha = (kernel == Kernel::Triangle)
+        && (srcImage.format == DXGI_FORMAT_R10G10B10A2_UNORM || srcImage.format == DXGI_FORMAT_R10G10B10A2_UINT);
+
+    const size_t bandRows = GetBandRows(destImage.width, destImage.height);
+    const size_t bands = (destImage.height + bandRows - 1) / bandRows;
+
+    std::atomic<HRESULT> bandResult(S_OK);
+
+    hr = TaskScheduler::ParallelFor(bands, 1,
+        [&](size_t begin, size_t end) -> bool
+        {
+            for (size_t band = begin; band < end; ++band)
+            {
+                const size_t y0 = band * bandRows;
+                const size_t y1 = std::min(y0 + bandRows, destImage.height);
+
+                HRESULT hrBand;
+                if (!fixedPoint)
+                {
+                    hrBand = ResampleBandFloat(srcImage, filter, destImage, fx, fy, biasAlpha, y0, y1);
+                }
+                else if (wide)
+                {
+                    hrBand = ResampleBandFixed<Unorm16>(channels, srcImage, destImage, fx, fy, y0, y1);
+                }
+                else
+                {
+                    hrBand = ResampleBandFixed<Unorm8>(channels, srcImage, destImage, fx, fy, y0, y1);
+                }
+
+                if (FAILED(hrBand))
+                {
+                    bandResult = hrBand;
+                    return false;
+                }
+            }
+
+            return true;
+        });
+
+    if (FAILED(bandResult.load()))
+        return bandResult.load();
+
+    return hr;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Resample mip chain
+//-------------------------------------------------------------------------------------
+_Use_decl_annotations_
+HRESULT DirectX::Internal::ResampleMipChain(
+    size_t levels,
+    TEX_FILTER_FLAGS filter,
+    const ScratchImage& mipChain,
+    size_t item) noexcept
+{
+    if (!mipChain.GetImages())
+        return E_INVALIDARG;
+
+    // This assumes that the base image is already placed into the mipChain at the top level... (see _Setup2DMips)
+
+    assert(levels > 1);
+
+    // Each level is filtered from the one above it, which is still in cache for the smaller levels
+    for (size_t level = 1; level < levels; ++level)
+    {
+        const Image* src = mipChain.GetImage(level - 1, item, 0);
+        const Image* dest = mipChain.GetImage(level, item, 0);
+
+        if (!src || !dest)
+            return E_POINTER;
+
+        const HRESULT hr = ResampleImage(*src, filter, *dest);
+        if (FAILED(hr))
+            return hr;
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,540 @@
+//-------------------------------------------------------------------------------------
+// DirectXTexScheduler.cpp
+//
+// DirectX Texture Library - Work-stealing task scheduler
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//
+// http://go.microsoft.com/fwlink/?LinkId=248926
+//-------------------------------------------------------------------------------------
+
+#include "DirectXTexP.h"
+
+#include "scheduler.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace DirectX::Internal;
+
+#if defined(_WIN32) && !defined(_GAMING_XBOX) && !(defined(_XBOX_ONE) && defined(_TITLE))
+#define DIRECTX_TEX_PROCESSOR_GROUPS
+#endif
+
+namespace
+{
+    // Ranges are stored as a packed [begin, end) pair so that the owner and thieves can
+    // update them with a single compare-exchange.
+    constexpr uint64_t PackRange(size_t begin, size_t end) noexcept
+    {
+        return (static_cast<uint64_t>(begin) << 32) | static_cast<uint64_t>(end);
+    }
+
+    constexpr size_t RangeBegin(uint64_t range) noexcept { return static_cast<size_t>(range >> 32); }
+    constexpr size_t RangeEnd(uint64_t range) noexcept { return static_cast<size_t>(range & 0xFFFFFFFF); }
+
+    // Padded to a cache line to avoid false sharing between participants
+    struct WorkSlot
+    {
+        std::atomic<uint64_t> range;
+        uint8_t pad[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+    static_assert(sizeof(WorkSlot) == 64, "WorkSlot should be cache-line sized");
+
+    //---------------------------------------------------------------------------------
+    class Job
+    {
+    public:
+        Job(size_t count, size_t grain, size_t nslots, const TaskScheduler::RangeFunc& func) :
+            m_count(count),
+            m_grain(grain),
+            m_nslots(nslots),
+            m_func(func),
+            m_slots(new WorkSlot[nslots]),
+            m_nextSlot(0),
+            m_completed(0),
+            m_active(0),
+            m_cancelled(false),
+            m_failed(false),
+            m_exhausted(false)
+        {
+            // Initial even partitioning; stealing rebalances from here
+            const size_t perSlot = count / nslots;
+            const size_t extra = count % nslots;
+
+            size_t begin = 0;
+            for (size_t j = 0; j < nslots; ++j)
+            {
+                const size_t end = begin + perSlot + ((j < extra) ? 1u : 0u);
+                m_slots[j].range.store(PackRange(begin, end), std::memory_order_relaxed);
+                begin = end;
+            }
+            assert(begin == count);
+        }
+
+        Job(Job&&) = delete;
+        Job& operator= (Job&&) = delete;
+
+        Job(Job const&) = delete;
+        Job& operator= (Job const&) = delete;
+
+        // Runs work items until none remain or the job is cancelled
+        void Participate(const TaskScheduler::ProgressFunc* progress) noexcept
+        {
+            m_active.fetch_add(1);
+
+            const size_t slot = m_nextSlot.fetch_add(1);
+            if (slot < m_nslots && !m_cancelled.load())
+            {
+                size_t begin, end;
+                while (TakeWork(slot, begin, end))
+                {
+                    if (m_cancelled.load(std::memory_order_relaxed))
+                        break;
+
+                    bool ok;
+                    try
+                    {
+                        ok = m_func(begin, end);
+                    }
+                    catch (...)
+                    {
+                        m_failed.store(true);
+                        ok = false;
+                    }
+
+                    const size_t completed = m_completed.fetch_add(end - begin) + (end - begin);
+
+                    if (ok && progress && *progress)
+                    {
+                        try
+                        {
+                            ok = (*progress)(completed, m_count);
+                        }
+                        catch (...)
+                        {
+                            m_failed.store(true);
+                            ok = false;
+                        }
+                    }
+
+                    if (!ok)
+                    {
+                        m_cancelled.store(true);
+                        break;
+                    }
+                }
+
+                // Only a participant that owned a slot knows the work has run out
+                m_exhausted.store(true);
+            }
+
+            if (m_active.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done.notify_all();
+            }
+        }
+
+        // Blocks the caller until every participant has left the job
+        void Wait(const TaskScheduler::ProgressFunc* progress) noexcept
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                if (m_done.wait_for(lock, std::chrono::milliseconds(50), [this] { return m_active.load() == 0; }))
+                    break;
+
+                if (progress && *progress && !m_cancelled.load())
+                {
+                    lock.unlock();
+
+                    bool ok;
+                    try
+                    {
+                        ok = (*progress)(m_completed.load(), m_count);
+                    }
+                    catch (...)
+                    {
+                        m_failed.store(true);
+                        ok = false;
+                    }
+
+                    if (!ok)
+                        m_cancelled.store(true);
+
+                    lock.lock();
+                }
+            }
+        }
+
+        bool IsExhausted() const noexcept { return m_exhausted.load(); }
+
+        // True if another participant would get a slot with work in it
+        bool IsAvailable() const noexcept
+        {
+            return !m_exhausted.load() && !m_cancelled.load() && (m_nextSlot.load() < m_nslots);
+        }
+
+        HRESULT GetResult() const noexcept
+        {
+            if (m_failed.load())
+                return E_FAIL;
+
+            return m_cancelled.load() ? E_ABORT : S_OK;
+        }
+
+    private:
+        bool TakeWork(size_t slot, size_t& begin, size_t& end) noexcept
+        {
+            for (;;)
+            {
+                // Pop from the front of our own range
+                std::atomic<uint64_t>& own = m_slots[slot].range;
+                uint64_t current = own.load();
+                for (;;)
+                {
+                    const size_t b = RangeBegin(current);
+                    const size_t e = RangeEnd(current);
+                    if (b >= e)
+                        break;
+
+                    const size_t next = std::min(b + m_grain, e);
+                    if (own.compare_exchange_weak(current, PackRange(next, e)))
+                    {
+                        begin = b;
+                        end = next;
+                        return true;
+                    }
+                }
+
+                // Our range is empty, so steal the upper half of someone else's
+                bool stolen = false;
+                for (size_t k = 1; k < m_nslots && !stolen; ++k)
+                {
+                    std::atomic<uint64_t>& victim = m_slots[(slot + k) % m_nslots].range;
+                    uint64_t vcurrent = victim.load();
+                    for (;;)
+                    {
+                        const size_t b = RangeBegin(vcurrent);
+                        const size_t e = RangeEnd(vcurrent);
+                        if (b >= e)
+                            break;
+
+                        if ((e - b) <= m_grain)
+                        {
+                            if (victim.compare_exchange_weak(vcurrent, PackRange(e, e)))
+                            {
+                                begin = b;
+                                end = e;
+                                return true;
+                            }
+                        }
+                        else
+                        {
+                            const size_t mid = b + ((e - b) >> 1);
+                            if (victim.compare_exchange_weak(vcurrent, PackRange(b, mid)))
+                            {
+                                // Only the owner refills an empty slot, so a plain store is safe
+                                own.store(PackRange(mid, e));
+                                stolen = true;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                if (!stolen)
+                    return false;
+            }
+        }
+
+        const size_t                    m_count;
+        const size_t                    m_grain;
+        const size_t                    m_nslots;
+        const TaskScheduler::RangeFunc& m_func;
+        std::unique_ptr<WorkSlot[]>     m_slots;
+        std::atomic<size_t>             m_nextSlot;
+        std::atomic<size_t>             m_completed;
+        std::atomic<size_t>             m_active;
+        std::atomic<bool>               m_cancelled;
+        std::atomic<bool>               m_failed;
+        std::atomic<bool>               m_exhausted;
+        std::mutex                      m_mutex;
+        std::condition_variable         m_done;
+    };
+
+
+    //---------------------------------------------------------------------------------
+    size_t GetProcessorCount() noexcept
+    {
+    #ifdef DIRECTX_TEX_PROCESSOR_GROUPS
+        // std::thread::hardware_concurrency only reports the primary processor group
+        const DWORD count = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+        if (count > 0)
+            return static_cast<size_t>(count);
+    #endif
+
+        return std::max<size_t>(1u, std::thread::hardware_concurrency());
+    }
+
+#ifdef DIRECTX_TEX_PROCESSOR_GROUPS
+    // Systems with more than 64 logical processors split them into groups, and new threads
+    // are only scheduled within the process's primary group prior to Windows 11.
+    void AssignProcessorGroup(std::thread& thread, size_t index) noexcept
+    {
+        const WORD groups = GetActiveProcessorGroupCount();
+        if (groups <= 1)
+            return;
+
+        for (WORD group = 0; group < groups; ++group)
+        {
+            const DWORD count = GetActiveProcessorCount(group);
+            if (index < count)
+            {
+                GROUP_AFFINITY affinity = {};
+                affinity.Group = group;
+                affinity.Mask = (count >= sizeof(KAFFINITY) * 8) ? ~KAFFINITY(0) : ((KAFFINITY(1) << count) - 1);
+                std::ignore = SetThreadGroupAffinity(thread.native_handle(), &affinity, nullptr);
+                return;
+            }
+
+            index -= count;
+        }
+    }
+#endif
+
+
+    //---------------------------------------------------------------------------------
+    class ThreadPool
+    {
+    public:
+        ThreadPool() noexcept(false) :
+            m_nextJob(0),
+            m_shutdown(false)
+        {
+            const size_t count = GetProcessorCount();
+            if (count <= 1)
+                return;
+
+            // The calling thread participates in every job, so it is not counted here
+            m_threads.reserve(count - 1);
+            for (size_t j = 1; j < count; ++j)
+            {
+                try
+                {
+                    m_threads.emplace_back(&ThreadPool::WorkerThread, this);
+                }
+                catch (const std::system_error&)
+                {
+                    // Run with however many workers we managed to create
+                    break;
+                }
+
+            #ifdef DIRECTX_TEX_PROCESSOR_GROUPS
+                AssignProcessorGroup(m_threads.back(), j);
+            #endif
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_shutdown = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& it : m_threads)
+            {
+                if (it.joinable())
+                    it.join();
+            }
+        }
+
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator= (ThreadPool&&) = delete;
+
+        ThreadPool(ThreadPool const&) = delete;
+        ThreadPool& operator= (ThreadPool const&) = delete;
+
+        size_t GetWorkerCount() const noexcept { return m_threads.size(); }
+
+        void Submit(const std::shared_ptr<Job>& job)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(job);
+            }
+            m_wake.notify_all();
+        }
+
+        void Remove(const std::shared_ptr<Job>& job) noexcept
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            RemoveLocked(job.get());
+        }
+
+        static ThreadPool& Get()
+        {
+            static ThreadPool s_pool;
+            return s_pool;
+        }
+
+    private:
+        void RemoveLocked(const Job* job) noexcept
+        {
+            for (auto it = m_jobs.begin(); it != m_jobs.end(); ++it)
+            {
+                if (it->get() == job)
+                {
+                    m_jobs.erase(it);
+                    return;
+                }
+            }
+        }
+
+        // Picks the next queued job that can still use a participant, rotating through the
+        // queue so that concurrent ParallelFor callers all get help from the pool
+        std::shared_ptr<Job> FindJobLocked() noexcept
+        {
+            const size_t count = m_jobs.size();
+            for (size_t k = 0; k < count; ++k)
+            {
+                const size_t index = (m_nextJob + k) % count;
+                if (m_jobs[index]->IsAvailable())
+                {
+                    m_nextJob = index + 1;
+                    return m_jobs[index];
+                }
+            }
+
+            return nullptr;
+        }
+
+        void WorkerThread() noexcept
+        {
+            for (;;)
+            {
+                std::shared_ptr<Job> job;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this, &job]
+                        {
+                            if (m_shutdown)
+                                return true;
+
+                            job = FindJobLocked();
+                            return job != nullptr;
+                        });
+
+                    if (m_shutdown)
+                        return;
+                }
+
+                job->Participate(nullptr);
+
+                {
+                    // Once any participant finds no work left, new arrivals would only spin
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (job->IsExhausted())
+                    {
+                        RemoveLocked(job.get());
+                    }
+                }
+            }
+        }
+
+        std::mutex                          m_mutex;
+        std::condition_variable             m_wake;
+        std::vector<std::shared_ptr<Job>>   m_jobs;
+        std::vector<std::thread>            m_threads;
+        size_t                              m_nextJob;
+        bool                                m_shutdown;
+    };
+}
+
+
+//=====================================================================================
+// Entry-points
+//=====================================================================================
+
+_Use_decl_annotations_
+HRESULT TaskScheduler::ParallelFor(
+    size_t count,
+    size_t grain,
+    const RangeFunc& func,
+    const ProgressFunc& progress) noexcept
+{
+    if (!count)
+        return S_OK;
+
+    if (!func)
+        return E_INVALIDARG;
+
+    if (count > UINT32_MAX)
+        return HRESULT_E_ARITHMETIC_OVERFLOW;
+
+    grain = std::max<size_t>(1u, grain);
+
+    try
+    {
+        ThreadPool& pool = ThreadPool::Get();
+
+        const size_t nslots = pool.GetWorkerCount() + 1;
+        if (nslots == 1 || count <= grain)
+        {
+            // Nothing to share, so run serially on the calling thread
+            for (size_t begin = 0; begin < count; begin += grain)
+            {
+                const size_t end = std::min(begin + grain, count);
+                if (!func(begin, end))
+                    return E_ABORT;
+
+                if (progress && !progress(end, count))
+                    return E_ABORT;
+            }
+
+            return S_OK;
+        }
+
+        auto job = std::make_shared<Job>(count, grain, nslots, func);
+
+        pool.Submit(job);
+
+        job->Participate(&progress);
+        job->Wait(&progress);
+
+        pool.Remove(job);
+
+        return job->GetResult();
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+    catch (...)
+    {
+        return E_FAIL;
+    }
+}
+
+size_t TaskScheduler::GetConcurrency() noexcept
+{
+    try
+    {
+        return ThreadPool::Get().GetWorkerCount() + 1;
+    }
+    catch (...)
+    {
+        return 1;
+    }
+}
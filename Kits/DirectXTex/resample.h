@@ -0,0 +1,61 @@
+//-------------------------------------------------------------------------------------
+// resample.h
+//
+// Separable polyphase resampler used by the CPU resize and mip-map functions
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+namespace DirectX
+{
+    namespace Internal
+    {
+        //---------------------------------------------------------------------------------
+        // Source texels and weights for every destination texel along one axis. The taps of
+        // destination texel u are [first[u], first[u + 1]), and index[] is into the full
+        // source row or column.
+        struct AxisFilter
+        {
+            size_t                      maxTaps;
+            size_t                      uniformTaps;    // Tap count if every destination texel has the same number, otherwise 0
+            std::unique_ptr<size_t[]>   first;
+            std::unique_ptr<uint32_t[]> index;
+            std::unique_ptr<float[]>    weight;
+            std::unique_ptr<int16_t[]>  fixedWeight;
+            std::unique_ptr<int32_t[]>  fixedWeightWide;
+
+            AxisFilter() noexcept : maxTaps(0), uniformTaps(0) {}
+        };
+
+        // Computes the weights ResampleImage uses along one axis, for code that filters its
+        // own scanlines. The filter mode must be set; POINT selects the nearest texel.
+        HRESULT __cdecl CreateResampleAxis(
+            _In_ size_t source, _In_ size_t dest, _In_ TEX_FILTER_FLAGS filter, _In_ bool vertical,
+            _Out_ AxisFilter& af) noexcept;
+
+        //---------------------------------------------------------------------------------
+        // Resizes an image with a separable filter. The weights for every destination row
+        // and column are computed up front, source rows are filtered horizontally once and
+        // shared by all the destination rows that use them, and bands of destination rows
+        // are processed in parallel.
+        //
+        // LINEAR and CUBIC interpolate between neighbouring texels (as they always have);
+        // BOX, LANCZOS and KAISER widen the kernel by the reduction factor so every source
+        // texel contributes when shrinking. TRIANGLE keeps the exact per-texel weights of
+        // the original triangle filter.
+        //
+        // Non-sRGB 8-bit and 16-bit UNORM formats are filtered in fixed-point without
+        // converting to float.
+        HRESULT __cdecl ResampleImage(
+            _In_ const Image& srcImage, _In_ TEX_FILTER_FLAGS filter,
+            _In_ const Image& destImage) noexcept;
+
+        // Fills levels [1, levels) of a 2D mip chain item from the level above each one
+        HRESULT __cdecl ResampleMipChain(
+            _In_ size_t levels, _In_ TEX_FILTER_FLAGS filter,
+            _In_ const ScratchImage& mipChain, _In_ size_t item) noexcept;
+    }
+}
@@ -0,0 +1,48 @@
+//-------------------------------------------------------------------------------------
+// scheduler.h
+//
+// Work-stealing parallel-for used by the CPU texture processing functions
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace DirectX
+{
+    namespace Internal
+    {
+        //---------------------------------------------------------------------------------
+        // Splits [0, count) into per-thread ranges which are consumed 'grain' items at a
+        // time. Threads that run out of work steal the upper half of another thread's
+        // remaining range, so uneven per-item costs do not leave cores idle.
+        //
+        // The calling thread always participates, and is the only thread which invokes the
+        // progress callback. Returning false from either callback cancels the remaining
+        // work; items already started are allowed to finish before ParallelFor returns.
+        class TaskScheduler
+        {
+        public:
+            // Process items [begin, end); return false to cancel
+            using RangeFunc = std::function<bool(size_t begin, size_t end)>;
+
+            // Reports the number of completed items out of count; return false to cancel
+            using ProgressFunc = std::function<bool(size_t completed, size_t count)>;
+
+            // Returns S_OK, E_ABORT if cancelled, or E_OUTOFMEMORY if the job could not be created
+            static HRESULT __cdecl ParallelFor(
+                size_t count,
+                size_t grain,
+                const RangeFunc& func,
+                const ProgressFunc& progress = nullptr) noexcept;
+
+            // Number of threads (including the caller) which can participate in a job
+            static size_t __cdecl GetConcurrency() noexcept;
+        };
+    }
+}
@@ -197,6 +197,8 @@ struct Anchor
     constexpr Anchor(HorizontalAnchor horizontal, VerticalAnchor vertical) : Horizontal(horizontal), Vertical(vertical) {}
     constexpr Anchor(const Anchor&) = default;
     Anchor& operator=(const Anchor&) = default;
+    bool operator==(const Anchor& other) const { return Horizontal == other.Horizontal && Vertical == other.Vertical; }
+    bool operator!=(const Anchor& other) const { return !(*this == other); }
     static Anchor FromIDs(const ID& horizontal, const ID& vertical, const Anchor& defaultAnchor = Anchor());
     const static std::map<ID, int> AnchorIDMap;
     std::tuple<const char *, const char *> GetIDs() const;
@@ -278,6 +280,41 @@ public:
     }
 };
 
+/// A computed value which, unlike FrameComputedValue, stays cached across frames
+/// until it is explicitly invalidated.  used for values such as element layout
+/// whose inputs only change through setters that can invalidate them.
+template<typename TValue>
+class CachedComputedValue
+{
+    bool valid;
+    TValue value;
+
+public:
+    CachedComputedValue() : valid{}, value{} {}
+
+    template<typename TCompute>
+    TValue GetValue(TCompute&& compute)
+    {
+        if (!valid)
+        {
+            value = compute();
+            valid = true;
+        }
+
+        return value;
+    }
+
+    bool IsValid() const
+    {
+        return valid;
+    }
+
+    void InvalidateCache()
+    {
+        valid = false;
+    }
+};
+
 template<typename KeyType, typename ValueType>
 class FrameComputedEvictCache
 {
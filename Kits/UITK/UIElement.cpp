@@ -154,7 +154,7 @@ Rectangle UIElement::GetMarginedRectInRefUnits()
         }
     };
 
-    return m_screenRectInPixels.GetValue(compute);
+    return m_screenRectInRefUnits.GetValue(compute);
 }
 
 /*virtual*/ Rectangle UIElement::GetScreenRectInPixels()
@@ -164,7 +164,7 @@ Rectangle UIElement::GetMarginedRectInRefUnits()
             GetScreenRectInRefUnits(), m_uiManager.GetRefUnitsToPixelsScale());
     };
 
-    return m_screenRectInRefUnits.GetValue(compute);
+    return m_screenRectInPixels.GetValue(compute);
 }
 
 Vector2 UIElement::GetSizeInRefUnits()
@@ -182,7 +182,7 @@ Vector2 UIElement::GetSizeInRefUnits()
         }
     };
 
-    return m_sizeInPixels.GetValue(compute);
+    return m_sizeInRefUnits.GetValue(compute);
 }
 
 void UIElement::AddChild(UIElementPtr child)
@@ -223,6 +223,38 @@ bool UIElement::IsAncestorOfMe(UIElementPtr element) const
 
 /*protected:*/
 
+void UIElement::InvalidateRectangleCaches()
+{
+    // a descendant's rectangles are only ever computed from a valid padded rectangle
+    // of its parent, so if ours is already stale then so is the whole subtree.
+    const bool subtreeStale = !m_paddedRectInRefUnits.IsValid();
+
+    m_screenRectInPixels.InvalidateCache();
+    m_screenRectInRefUnits.InvalidateCache();
+    m_paddedRectInPixels.InvalidateCache();
+    m_paddedRectInRefUnits.InvalidateCache();
+    m_marginedRectInPixels.InvalidateCache();
+    m_marginedRectInRefUnits.InvalidateCache();
+    m_sizeInRefUnits.InvalidateCache();
+
+    m_uiManager.InvalidateHitTestRectangles();
+
+    if (subtreeStale)
+    {
+        return;
+    }
+
+    for (auto& child : m_children)
+    {
+        child->InvalidateRectangleCaches();
+    }
+
+    for (auto& subElement : m_subElements)
+    {
+        subElement->InvalidateRectangleCaches();
+    }
+}
+
 /*virtual*/ void UIElement::PostRender()
 {
     m_style->PostRender();
@@ -231,6 +263,9 @@ bool UIElement::IsAncestorOfMe(UIElementPtr element) const
 /*virtual*/ void UIElement::HandleStyleIdChanged()
 {
     m_style = m_uiManager.GetStyleManager().GetById(m_elementDataProperties.styleId);
+
+    // margins and padding come from the style
+    InvalidateRectangleCaches();
 }
 
 void UIElement::Clear()
@@ -304,7 +304,11 @@ public:
 
     void SetVisible(bool isVisible)
     {
-        m_elementDataProperties.visible = isVisible;
+        if (m_elementDataProperties.visible != isVisible)
+        {
+            m_elementDataProperties.visible = isVisible;
+            m_uiManager.InvalidateRenderList();
+        }
     }
 
 #pragma endregion
@@ -335,8 +339,11 @@ public:
 
     void SetPositioningAnchor(const Anchor& positioningAnchor)
     {
-        m_elementDataProperties.positioningAnchor = positioningAnchor;
-        InvalidateRectangleCaches();
+        if (m_elementDataProperties.positioningAnchor != positioningAnchor)
+        {
+            m_elementDataProperties.positioningAnchor = positioningAnchor;
+            InvalidateRectangleCaches();
+        }
     }
 
     const Anchor& GetSizingAnchor() const
@@ -346,8 +353,11 @@ public:
 
     void SetSizingAnchor(const Anchor& sizingAnchor)
     {
-        m_elementDataProperties.sizingAnchor = sizingAnchor;
-        InvalidateRectangleCaches();
+        if (m_elementDataProperties.sizingAnchor != sizingAnchor)
+        {
+            m_elementDataProperties.sizingAnchor = sizingAnchor;
+            InvalidateRectangleCaches();
+        }
     }
 
     const Vector2& GetRelativePositionInRefUnits() const
@@ -357,8 +367,11 @@ public:
 
     void SetRelativePositionInRefUnits(const Vector2& newPosition)
     {
-        m_elementDataProperties.relativePosition = newPosition;
-        InvalidateRectangleCaches();
+        if (m_elementDataProperties.relativePosition != newPosition)
+        {
+            m_elementDataProperties.relativePosition = newPosition;
+            InvalidateRectangleCaches();
+        }
     }
 
     const Vector2& GetRelativeSizeInRefUnits() const
@@ -368,21 +381,17 @@ public:
 
     void SetRelativeSizeInRefUnits(const Vector2& newSize)
     {
-        m_elementDataProperties.relativeSize = newSize;
-        InvalidateRectangleCaches();
+        if (m_elementDataProperties.relativeSize != newSize)
+        {
+            m_elementDataProperties.relativeSize = newSize;
+            InvalidateRectangleCaches();
+        }
     }
 
 protected:
-    void InvalidateRectangleCaches()
-    {
-        m_screenRectInPixels.InvalidateCache();
-        m_screenRectInRefUnits.InvalidateCache();
-        m_paddedRectInPixels.InvalidateCache();
-        m_paddedRectInRefUnits.InvalidateCache();
-        m_marginedRectInPixels.InvalidateCache();
-        m_marginedRectInRefUnits.InvalidateCache();
-        m_sizeInPixels.InvalidateCache();
-    }
+    /// layout is cached until invalidated, so this also invalidates every descendant
+    /// whose rectangles are computed from this element's rectangles.
+    void InvalidateRectangleCaches();
 
 protected:
     UIManager&                      m_uiManager;
@@ -392,13 +401,13 @@ protected:
     std::vector<UIElementPtr>       m_subElements;
     bool                            m_isSubElement;
 
-    FrameComputedValue<Rectangle>   m_screenRectInPixels;
-    FrameComputedValue<Rectangle>   m_screenRectInRefUnits;
-    FrameComputedValue<Rectangle>   m_paddedRectInPixels;
-    FrameComputedValue<Rectangle>   m_paddedRectInRefUnits;
-    FrameComputedValue<Rectangle>   m_marginedRectInPixels;
-    FrameComputedValue<Rectangle>   m_marginedRectInRefUnits;
-    FrameComputedValue<Vector2>     m_sizeInPixels;
+    CachedComputedValue<Rectangle>  m_screenRectInPixels;
+    CachedComputedValue<Rectangle>  m_screenRectInRefUnits;
+    CachedComputedValue<Rectangle>  m_paddedRectInPixels;
+    CachedComputedValue<Rectangle>  m_paddedRectInRefUnits;
+    CachedComputedValue<Rectangle>  m_marginedRectInPixels;
+    CachedComputedValue<Rectangle>  m_marginedRectInRefUnits;
+    CachedComputedValue<Vector2>    m_sizeInRefUnits;
 
     UIStylePtr                      m_style;
 
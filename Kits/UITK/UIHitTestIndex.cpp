@@ -0,0 +1,172 @@
+//--------------------------------------------------------------------------------------
+// File: UIHitTestIndex.cpp
+//
+// Authored by: ATG
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//-------------------------------------------------------------------------------------
+
+#include "pch.h"
+
+#include "UIHitTestIndex.h"
+#include "UIElement.h"
+#include "UIMath.h"
+
+NAMESPACE_ATG_UITK_BEGIN
+
+UIHitTestIndex::UIHitTestIndex() :
+    m_entries(),
+    m_cells(),
+    m_cellCountX(0),
+    m_cellCountY(0),
+    m_rectanglesInvalidated(false),
+    m_valid(false)
+{
+}
+
+void UIHitTestIndex::Rebuild(const std::vector<UIElementPtr>& depthOrderedElements, int windowWidth, int windowHeight)
+{
+    PIXScopedEvent(PIX_COLOR_DEFAULT, L"UIHitTestIndex_Rebuild");
+
+    const int cellCountX = std::max(1, (windowWidth + c_cellSizeInPixels - 1) / c_cellSizeInPixels);
+    const int cellCountY = std::max(1, (windowHeight + c_cellSizeInPixels - 1) / c_cellSizeInPixels);
+
+    if (cellCountX != m_cellCountX || cellCountY != m_cellCountY)
+    {
+        m_cellCountX = cellCountX;
+        m_cellCountY = cellCountY;
+        m_cells.clear();
+        m_cells.resize(size_t(cellCountX) * size_t(cellCountY));
+    }
+    else
+    {
+        // keep the cells' capacity so that steady state rebuilds do not allocate
+        for (auto& cell : m_cells)
+        {
+            cell.clear();
+        }
+    }
+
+    m_entries.resize(depthOrderedElements.size());
+
+    // elements are visited in depth order, so appending keeps every cell sorted
+
+    for (size_t index = 0; index < depthOrderedElements.size(); ++index)
+    {
+        m_entries[index].rect = depthOrderedElements[index]->GetScreenRectInPixels();
+        m_entries[index].inGrid = false;
+        Insert(uint32_t(index));
+    }
+
+    m_rectanglesInvalidated = false;
+    m_valid = true;
+}
+
+void UIHitTestIndex::Refresh(const std::vector<UIElementPtr>& depthOrderedElements)
+{
+    assert(m_valid && m_entries.size() == depthOrderedElements.size());
+    PIXScopedEvent(PIX_COLOR_DEFAULT, L"UIHitTestIndex_Refresh");
+
+    for (size_t index = 0; index < depthOrderedElements.size(); ++index)
+    {
+        auto rect = depthOrderedElements[index]->GetScreenRectInPixels();
+        auto& entry = m_entries[index];
+
+        if (rect != entry.rect)
+        {
+            Remove(uint32_t(index));
+            entry.rect = rect;
+            Insert(uint32_t(index));
+        }
+    }
+
+    m_rectanglesInvalidated = false;
+}
+
+/*private:*/
+
+size_t UIHitTestIndex::GetCellIndex(int x, int y) const
+{
+    // pixels outside of the window map to the nearest edge cell, which also holds
+    // any element that extends past that edge.
+    const int cellX = UIMath::Clamp(x / c_cellSizeInPixels, 0, m_cellCountX - 1);
+    const int cellY = UIMath::Clamp(y / c_cellSizeInPixels, 0, m_cellCountY - 1);
+    return size_t(cellY) * size_t(m_cellCountX) + size_t(cellX);
+}
+
+bool UIHitTestIndex::GetCellRange(const DirectX::SimpleMath::Rectangle& rect, CellRange& range) const
+{
+    if (rect.width <= 0 || rect.height <= 0)
+    {
+        return false;
+    }
+
+    range.x0 = UIMath::Clamp(int(rect.x) / c_cellSizeInPixels, 0, m_cellCountX - 1);
+    range.y0 = UIMath::Clamp(int(rect.y) / c_cellSizeInPixels, 0, m_cellCountY - 1);
+    range.x1 = UIMath::Clamp(int(rect.x + rect.width - 1) / c_cellSizeInPixels, 0, m_cellCountX - 1);
+    range.y1 = UIMath::Clamp(int(rect.y + rect.height - 1) / c_cellSizeInPixels, 0, m_cellCountY - 1);
+    return true;
+}
+
+void UIHitTestIndex::Insert(uint32_t depthIndex)
+{
+    auto& entry = m_entries[depthIndex];
+
+    CellRange range;
+    entry.inGrid = GetCellRange(entry.rect, range);
+    if (!entry.inGrid)
+    {
+        return;
+    }
+
+    for (int y = range.y0; y <= range.y1; ++y)
+    {
+        for (int x = range.x0; x <= range.x1; ++x)
+        {
+            auto& cell = m_cells[size_t(y) * size_t(m_cellCountX) + size_t(x)];
+
+            if (cell.empty() || cell.back() < depthIndex)
+            {
+                cell.push_back(depthIndex);
+            }
+            else
+            {
+                cell.insert(std::lower_bound(cell.begin(), cell.end(), depthIndex), depthIndex);
+            }
+        }
+    }
+}
+
+void UIHitTestIndex::Remove(uint32_t depthIndex)
+{
+    auto& entry = m_entries[depthIndex];
+
+    CellRange range;
+    if (!entry.inGrid || !GetCellRange(entry.rect, range))
+    {
+        return;
+    }
+
+    for (int y = range.y0; y <= range.y1; ++y)
+    {
+        for (int x = range.x0; x <= range.x1; ++x)
+        {
+            auto& cell = m_cells[size_t(y) * size_t(m_cellCountX) + size_t(x)];
+            auto iter = std::lower_bound(cell.begin(), cell.end(), depthIndex);
+
+            if (iter != cell.end() && *iter == depthIndex)
+            {
+                cell.erase(iter);
+            }
+        }
+    }
+
+    entry.inGrid = false;
+}
+
+NAMESPACE_ATG_UITK_END
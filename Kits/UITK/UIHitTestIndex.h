@@ -0,0 +1,112 @@
+//--------------------------------------------------------------------------------------
+// File: UIHitTestIndex.h
+//
+// Authored by: ATG
+//
+// THIS CODE AND INFORMATION IS PROVIDED "AS IS" WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESSED OR IMPLIED, INCLUDING BUT NOT LIMITED TO
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND/OR FITNESS FOR A
+// PARTICULAR PURPOSE.
+//
+// Copyright (c) Microsoft Corporation. All rights reserved.
+//-------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "SimpleMath.h"
+#include "UICore.h"
+
+NAMESPACE_ATG_UITK_BEGIN
+
+class UIElement;
+
+/// A uniform grid over the render window which maps pixels to the elements whose
+/// screen rectangles cover them.  Elements are identified by their index in the
+/// manager's depth ordered element list, and each grid cell keeps its element
+/// indices sorted so that queries can return hits in depth order without sorting
+/// or allocating.
+///
+/// The index only uses each element's screen rectangle in pixels, so an element
+/// overriding HitTestPixels() may narrow its hit area but not extend it beyond
+/// that rectangle.
+class UIHitTestIndex
+{
+public:
+    UIHitTestIndex();
+
+    /// marks the index as needing a full rebuild, e.g. after the element order or
+    /// the window size changes.
+    void Invalidate() { m_valid = false; }
+
+    /// marks element rectangles as needing to be re-read on the next refresh.  element
+    /// layout is cached until invalidated, so the index stays valid until this is called.
+    void InvalidateRectangles() { m_rectanglesInvalidated = true; }
+
+    bool IsValid() const { return m_valid; }
+    bool NeedsRefresh() const { return m_rectanglesInvalidated; }
+
+    /// rebuilds the whole index from the depth ordered elements.
+    void Rebuild(const std::vector<std::shared_ptr<UIElement>>& depthOrderedElements, int windowWidth, int windowHeight);
+
+    /// re-reads the screen rectangle of every element and only moves those elements
+    /// whose rectangle changed since the last rebuild or refresh.
+    void Refresh(const std::vector<std::shared_ptr<UIElement>>& depthOrderedElements);
+
+    /// calls visitor(depthIndex) for each element whose rectangle contains the pixel,
+    /// from the top-most element to the bottom-most, until the visitor returns false.
+    template <typename TVisitor>
+    void VisitElementsUnderPixel(int x, int y, TVisitor&& visitor) const
+    {
+        if (!m_valid || m_cells.empty())
+        {
+            return;
+        }
+
+        const auto& cell = m_cells[GetCellIndex(x, y)];
+
+        for (auto iter = cell.rbegin(); iter != cell.rend(); ++iter)
+        {
+            if (m_entries[*iter].rect.Contains(long(x), long(y)) && !visitor(size_t(*iter)))
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    struct Entry
+    {
+        DirectX::SimpleMath::Rectangle  rect;
+        bool                            inGrid;
+    };
+
+    struct CellRange
+    {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    size_t GetCellIndex(int x, int y) const;
+    bool GetCellRange(const DirectX::SimpleMath::Rectangle& rect, CellRange& range) const;
+
+    void Insert(uint32_t depthIndex);
+    void Remove(uint32_t depthIndex);
+
+private:
+    static constexpr int                c_cellSizeInPixels = 64;
+
+    std::vector<Entry>                  m_entries;      // indexed by depth order
+    std::vector<std::vector<uint32_t>>  m_cells;        // depth indices, sorted ascending
+    int                                 m_cellCountX;
+    int                                 m_cellCountY;
+    bool                                m_rectanglesInvalidated;
+    bool                                m_valid;
+};
+
+NAMESPACE_ATG_UITK_END
@@ -51,8 +51,11 @@ UIManager::UIManager() :
     m_styleManager(m_dataDefinitions),
     m_frameCounter(0),
     m_depthOrderedElements(),
+    m_renderList(),
     m_updated(false),
-    m_orderInvalidated(true)
+    m_orderInvalidated(true),
+    m_renderListInvalidated(true),
+    m_updating(false)
 
 {
     RegisterInternalElementFactories();
@@ -64,40 +67,46 @@ UIManager::UIManager() :
 
 UIElementPtr UIManager::GetElementUnderPixel(int x, int y)
 {
-    auto depthOrderedElements = GetDepthOrderedElements();
+    const auto& hitTestIndex = GetHitTestIndex();
+    UIElementPtr result;
 
     // NOTE: hit testing will be the exact *opposite* of the order
     // with which we would want to render the elements in.
 
-    for (auto iter = depthOrderedElements.rbegin(); iter != depthOrderedElements.rend(); ++iter)
+    hitTestIndex.VisitElementsUnderPixel(x, y, [&](size_t depthIndex)
     {
-        const auto& element = *iter;
+        const auto& element = m_depthOrderedElements[depthIndex];
         if (element->HitTestPixels(x, y))
         {
-            return element;
+            result = element;
+            return false;
         }
-    }
+        return true;
+    });
 
-    return nullptr;
+    return result;
 }
 
 UIElementPtr UIManager::GetVisibleElementUnderPixel(int x, int y)
 {
-    auto depthOrderedElements = GetDepthOrderedElements();
+    const auto& hitTestIndex = GetHitTestIndex();
+    UIElementPtr result;
 
     // NOTE: hit testing will be the exact *opposite* of the order
     // with which we would want to render the elements in.
 
-    for (auto iter = depthOrderedElements.rbegin(); iter != depthOrderedElements.rend(); ++iter)
+    hitTestIndex.VisitElementsUnderPixel(x, y, [&](size_t depthIndex)
     {
-        const auto& element = *iter;
+        const auto& element = m_depthOrderedElements[depthIndex];
         if (element->IsVisible() && element->HitTestPixels(x, y))
         {
-            return element;
+            result = element;
+            return false;
         }
-    }
+        return true;
+    });
 
-    return nullptr;
+    return result;
 }
 
 std::vector<UIElementPtr>& UIManager::GetDepthOrderedElements()
@@ -110,6 +119,8 @@ std::vector<UIElementPtr>& UIManager::GetDepthOrderedElements()
         PIXScopedEvent(PIX_COLOR_DEFAULT, L"UIManager_GetDepthOrderedElements");
         GetDepthOrderedElements(GetRootElement(), m_depthOrderedElements);
         m_orderInvalidated = false;
+        m_hitTestIndex.Invalidate();
+        m_renderListInvalidated = true;
     }
 
     return m_depthOrderedElements;
@@ -117,16 +128,27 @@ std::vector<UIElementPtr>& UIManager::GetDepthOrderedElements()
 
 std::vector<UIElementPtr> UIManager::GetDepthOrderedElementsUnderPixel(int x, int y)
 {
-    auto depthOrderedElements = GetDepthOrderedElements();
-    for (int index = int(depthOrderedElements.size() - 1); index >= 0; --index)
+    std::vector<UIElementPtr> elementsUnderPixel;
+    GetDepthOrderedElementsUnderPixel(x, y, elementsUnderPixel);
+    return elementsUnderPixel;
+}
+
+void UIManager::GetDepthOrderedElementsUnderPixel(int x, int y, std::vector<UIElementPtr>& elementsUnderPixel)
+{
+    elementsUnderPixel.clear();
+
+    GetHitTestIndex().VisitElementsUnderPixel(x, y, [&](size_t depthIndex)
     {
-        const auto& element = depthOrderedElements[size_t(index)];
-        if (!element->HitTestPixels(x, y))
+        const auto& element = m_depthOrderedElements[depthIndex];
+        if (element->HitTestPixels(x, y))
         {
-            depthOrderedElements.erase(depthOrderedElements.begin() + index);
+            elementsUnderPixel.emplace_back(element);
         }
-    }
-    return depthOrderedElements;
+        return true;
+    });
+
+    // the index visits the top-most element first
+    std::reverse(elementsUnderPixel.begin(), elementsUnderPixel.end());
 }
 
 UIElementPtr UIManager::FindById(ID id) const
@@ -167,7 +189,8 @@ void UIManager::AttachTo(UIElementPtr child, UIElementPtr parent, bool isSubElem
     }
     child->m_isSubElement = isSubElement;
     child->m_parent = parent;
-    m_orderInvalidated = true;
+    child->InvalidateRectangleCaches();
+    InsertIntoDepthOrder(child);
 }
 
 void UIManager::Detach(UIElementPtr child)
@@ -181,6 +204,8 @@ void UIManager::Detach(UIElementPtr child)
 
     auto parent = child->m_parent;
 
+    RemoveFromDepthOrder(child);
+
     if (!child->IsSubElement())
     {
         auto childIndex = parent->GetChildIndex(child);
@@ -201,7 +226,7 @@ void UIManager::Detach(UIElementPtr child)
     }
 
     child->m_parent = nullptr;
-    m_orderInvalidated = true;
+    child->InvalidateRectangleCaches();
 }
 
 void UIManager::Clear(UIElementPtr element)
@@ -224,10 +249,10 @@ void UIManager::ClearChildren(UIElementPtr parent)
 
     for (auto& child : parent->m_children)
     {
+        RemoveFromDepthOrder(child);
         child->Clear();
     }
     parent->m_children.clear();
-    m_orderInvalidated = true;
 }
 
 void UIManager::ClearAllElements()
@@ -533,62 +558,19 @@ void UIManager::Render()
 
     auto globalFontTextScaleIndex = m_styleManager.GetStyleRenderer().PushFontTextScale(m_renderScale);
 
-    std::vector<UIElementPtr>& renderQueue = GetDepthOrderedElements();
-
-    std::vector<UIElementPtr> ancestorStack;
-
-    // NOTE: we traverse forward depth-first with parents being
-    // rendered before their descendants.
-
-    UIElementPtr prevElement = nullptr;
+    // NOTE: the render list is only rebuilt when the element order or visibility
+    // changes, so on most frames this just replays the same traversal.
 
-    for (const auto& element : renderQueue)
+    for (const auto& command : GetRenderList())
     {
-        if (!element->IsVisible())
-        {
-            continue;
-        }
-
-        const auto& parent = element->GetParent();
-
-        // start a new ancestor scope if either we are the root element
-        // or the previous element we encountered was our parent
-
-        if (parent && prevElement == parent)
-        {
-            ancestorStack.emplace_back(prevElement);
-        }
-
-        // make sure to perform a PostRender() on the parent element
-        // that was in scope for the current element.
-
-        while (ancestorStack.size() > 0 && parent && ancestorStack.back() != parent)
+        if (command.postRender)
         {
-            ancestorStack.back()->PostRender();
-            ancestorStack.pop_back();
+            command.element->PostRender();
         }
-
-        // render the currently visible element...
-
-        element->Render();
-
-        // also perform a PostRender() for the element if it is a leaf
-
-        if (parent && element->GetChildCount() == 0 && element->GetSubElementCount() == 0)
+        else
         {
-            element->PostRender();
+            command.element->Render();
         }
-
-        prevElement = element;
-    }
-
-    // finally clean up any remaining ancestors in the reverse
-    // order of their stacked scopes.
-
-    while (ancestorStack.size() > 0)
-    {
-        ancestorStack.back()->PostRender();
-        ancestorStack.pop_back();
     }
 
     m_styleManager.GetStyleRenderer().PopFontTextScale(globalFontTextScaleIndex);
@@ -608,6 +590,10 @@ void UIManager::SetWindowSize(int w, int h)
 
     m_renderWindowSize[0] = w;
     m_renderWindowSize[1] = h;
+
+    // every element's layout is ultimately relative to the screen
+    m_hierarchyRoot->InvalidateRectangleCaches();
+    m_hitTestIndex.Invalidate();
 }
 
 void UIManager::Update(float elapsedTimeInS, const UIInputState& inputState)
@@ -620,6 +606,10 @@ void UIManager::Update(float elapsedTimeInS, const UIInputState& inputState)
 
     std::vector<UIElementPtr>& updateQueue = GetDepthOrderedElements();
 
+    // hierarchy changes made while updating only invalidate the element order
+    // since the update queue is being iterated.
+    m_updating = true;
+
     for (const auto& element : updateQueue)
     {
         if (element->IsEnabled())
@@ -675,6 +665,8 @@ void UIManager::Update(float elapsedTimeInS, const UIInputState& inputState)
             element->Update(elapsedTimeInS);
         }
     }
+
+    m_updating = false;
 }
 
 void UIManager::SetFocusScopeRoot(UIElementPtr focusRoot)
@@ -704,37 +696,238 @@ void UIManager::SetFocus(UIElementPtr element)
 
 /*private:*/
 
+const UIHitTestIndex& UIManager::GetHitTestIndex()
+{
+    auto& depthOrderedElements = GetDepthOrderedElements();
+
+    if (!m_hitTestIndex.IsValid())
+    {
+        m_hitTestIndex.Rebuild(depthOrderedElements, m_renderWindowSize[0], m_renderWindowSize[1]);
+    }
+    else if (m_hitTestIndex.NeedsRefresh())
+    {
+        m_hitTestIndex.Refresh(depthOrderedElements);
+    }
+
+    return m_hitTestIndex;
+}
+
+const std::vector<UIManager::RenderCommand>& UIManager::GetRenderList()
+{
+    auto& depthOrderedElements = GetDepthOrderedElements();
+
+    if (!m_renderListInvalidated)
+    {
+        return m_renderList;
+    }
+
+    UILOG_TRACE_FUNC("Recomputing render list.");
+    PIXScopedEvent(PIX_COLOR_DEFAULT, L"UIManager_GetRenderList");
+
+    m_renderList.clear();
+    m_renderListInvalidated = false;
+
+    std::vector<UIElement*> ancestorStack;
+
+    // NOTE: we traverse forward depth-first with parents being
+    // rendered before their descendants.
+
+    UIElement* prevElement = nullptr;
+
+    for (const auto& element : depthOrderedElements)
+    {
+        if (!element->IsVisible())
+        {
+            continue;
+        }
+
+        const auto parent = element->m_parent.get();
+
+        // start a new ancestor scope if either we are the root element
+        // or the previous element we encountered was our parent
+
+        if (parent && prevElement == parent)
+        {
+            ancestorStack.emplace_back(prevElement);
+        }
+
+        // make sure to perform a PostRender() on the parent element
+        // that was in scope for the current element.
+
+        while (ancestorStack.size() > 0 && parent && ancestorStack.back() != parent)
+        {
+            m_renderList.push_back(RenderCommand{ ancestorStack.back()->shared_from_this(), true });
+            ancestorStack.pop_back();
+        }
+
+        // render the currently visible element...
+
+        m_renderList.push_back(RenderCommand{ element, false });
+
+        // also perform a PostRender() for the element if it is a leaf
+
+        if (parent && element->GetChildCount() == 0 && element->GetSubElementCount() == 0)
+        {
+            m_renderList.push_back(RenderCommand{ element, true });
+        }
+
+        prevElement = element.get();
+    }
+
+    // finally clean up any remaining ancestors in the reverse
+    // order of their stacked scopes.
+
+    while (ancestorStack.size() > 0)
+    {
+        m_renderList.push_back(RenderCommand{ ancestorStack.back()->shared_from_this(), true });
+        ancestorStack.pop_back();
+    }
+
+    return m_renderList;
+}
+
 /*static*/ void UIManager::GetDepthOrderedElements(UIElementPtr root, std::vector<UIElementPtr>& depthOrderedElements)
 {
     assert(root != nullptr);
 
     depthOrderedElements.clear();
-    std::vector<UIElementPtr> elementsToProcessStack;
-    elementsToProcessStack.emplace_back(root);
+    AppendDepthOrderedElements(root, depthOrderedElements);
+}
+
+/*static*/ void UIManager::AppendDepthOrderedElements(const UIElementPtr& element, std::vector<UIElementPtr>& depthOrderedElements)
+{
+    // each element is followed by the subtrees of its children and then
+    // by the subtrees of its sub elements.
+
+    depthOrderedElements.emplace_back(element);
+
+    for (const auto& child : element->m_children)
+    {
+        AppendDepthOrderedElements(child, depthOrderedElements);
+    }
+
+    for (const auto& subElement : element->m_subElements)
+    {
+        AppendDepthOrderedElements(subElement, depthOrderedElements);
+    }
+}
+
+/*static*/ size_t UIManager::GetSubtreeSize(const UIElementPtr& element)
+{
+    size_t size = 1;
+
+    for (const auto& child : element->m_children)
+    {
+        size += GetSubtreeSize(child);
+    }
+
+    for (const auto& subElement : element->m_subElements)
+    {
+        size += GetSubtreeSize(subElement);
+    }
+
+    return size;
+}
+
+void UIManager::InsertIntoDepthOrder(const UIElementPtr& element)
+{
+    // NOTE: expects the element to already be the last child or sub element of
+    // its parent, which is where AttachTo() puts it.
+
+    const auto& parent = element->m_parent;
 
-    while (elementsToProcessStack.size() > 0)
+    if (m_orderInvalidated || !(parent == m_hierarchyRoot || parent->IsAttachedToScene()))
     {
-        auto element = elementsToProcessStack.back();
-        depthOrderedElements.emplace_back(element);
-        elementsToProcessStack.pop_back();
+        return;
+    }
+
+    if (m_updating)
+    {
+        InvalidateDepthOrder();
+        return;
+    }
+
+    auto parentIter = std::find(m_depthOrderedElements.begin(), m_depthOrderedElements.end(), parent);
+
+    if (parentIter == m_depthOrderedElements.end())
+    {
+        InvalidateDepthOrder();
+        return;
+    }
 
-        for (auto childIter = element->m_subElements.rbegin();
-            childIter != element->m_subElements.rend();
-            ++childIter)
+    // skip over the parent and the subtrees that come before the new element
+
+    size_t insertIndex = size_t(parentIter - m_depthOrderedElements.begin()) + 1;
+
+    for (const auto& child : parent->m_children)
+    {
+        if (child != element)
         {
-            elementsToProcessStack.emplace_back(*childIter);
+            insertIndex += GetSubtreeSize(child);
         }
+    }
 
-        // take the children in reverse order so that the first
-        // child is on the top of the stack
-
-        for (auto childIter = element->m_children.rbegin();
-            childIter != element->m_children.rend();
-            ++childIter)
+    if (element->IsSubElement())
+    {
+        for (const auto& subElement : parent->m_subElements)
         {
-            elementsToProcessStack.emplace_back(*childIter);
+            if (subElement != element)
+            {
+                insertIndex += GetSubtreeSize(subElement);
+            }
         }
     }
+
+    std::vector<UIElementPtr> subtree;
+    AppendDepthOrderedElements(element, subtree);
+
+    m_depthOrderedElements.insert(
+        m_depthOrderedElements.begin() + static_cast<long>(insertIndex),
+        subtree.begin(),
+        subtree.end());
+
+    m_hitTestIndex.Invalidate();
+    m_renderListInvalidated = true;
+}
+
+void UIManager::RemoveFromDepthOrder(const UIElementPtr& element)
+{
+    if (m_orderInvalidated || !element->IsAttachedToScene())
+    {
+        return;
+    }
+
+    if (m_updating)
+    {
+        InvalidateDepthOrder();
+        return;
+    }
+
+    auto elementIter = std::find(m_depthOrderedElements.begin(), m_depthOrderedElements.end(), element);
+
+    if (elementIter == m_depthOrderedElements.end())
+    {
+        InvalidateDepthOrder();
+        return;
+    }
+
+    // the element's subtree is contiguous and immediately follows it
+
+    auto subtreeSize = std::min(
+        GetSubtreeSize(element),
+        size_t(m_depthOrderedElements.end() - elementIter));
+
+    m_depthOrderedElements.erase(elementIter, elementIter + static_cast<long>(subtreeSize));
+
+    m_hitTestIndex.Invalidate();
+    m_renderListInvalidated = true;
+}
+
+void UIManager::InvalidateDepthOrder()
+{
+    m_orderInvalidated = true;
+    m_hitTestIndex.Invalidate();
+    m_renderListInvalidated = true;
 }
 
 void UIManager::MakeFocusElement(UIElementPtr element, const UIInputState& inputState)
@@ -1206,18 +1399,18 @@ void UIManager::HandleMouseInput(
 
     m_previousFocusableElementUnderPixel = m_currentFocusableElementUnderPixel;
 
-    auto elementsUnderPixel = GetDepthOrderedElementsUnderPixel(mouseState.x, mouseState.y);
     m_currentFocusableElementUnderPixel = UIElementPtr();
 
-    for (auto iter = elementsUnderPixel.rbegin(); iter != elementsUnderPixel.rend(); ++iter)
+    GetHitTestIndex().VisitElementsUnderPixel(mouseState.x, mouseState.y, [&](size_t depthIndex)
     {
-        const auto& element = *iter;
-        if (element->CanBeFocused())
+        const auto& element = m_depthOrderedElements[depthIndex];
+        if (element->HitTestPixels(mouseState.x, mouseState.y) && element->CanBeFocused())
         {
             m_currentFocusableElementUnderPixel = element;
-            break;
+            return false;
         }
-    }
+        return true;
+    });
 
     // perform mouse hover and focus related states for elements
 
@@ -21,6 +21,7 @@
 
 #include "SimpleMath.h"
 
+#include "UIHitTestIndex.h"
 #include "UIInputState.h"
 #include "UIStyleManager.h"
 #include "UILog.h"
@@ -89,6 +90,7 @@ public:
     UIElementPtr GetVisibleElementUnderPixel(int x, int y);
     std::vector<UIElementPtr>& GetDepthOrderedElements();
     std::vector<UIElementPtr> GetDepthOrderedElementsUnderPixel(int x, int y);
+    void GetDepthOrderedElementsUnderPixel(int x, int y, std::vector<UIElementPtr>& elementsUnderPixel);
 
     UIElementPtr FindById(ID id) const;
 
@@ -181,6 +183,14 @@ private:
     using UIElementLookup = std::map<ID, std::weak_ptr<UIElement>>;
     using UIPrefabLookup = std::map<ID, UIDataPtr>;
 
+    /// one step of the flattened render traversal, which is either an element's
+    /// Render() or the PostRender() that closes its scope.
+    struct RenderCommand
+    {
+        UIElementPtr element;
+        bool postRender;
+    };
+
 private:
     int                                 m_renderWindowSize[2];
     float                               m_renderScale;
@@ -207,11 +217,34 @@ private:
 
     uint32_t                            m_frameCounter;
     std::vector<UIElementPtr>           m_depthOrderedElements;
+    std::vector<RenderCommand>          m_renderList;
+    UIHitTestIndex                      m_hitTestIndex;
     bool                                m_updated;
     bool                                m_orderInvalidated;
+    bool                                m_renderListInvalidated;
+    bool                                m_updating;
 
 private:
     static void GetDepthOrderedElements(UIElementPtr root, std::vector<UIElementPtr>& orderedElements);
+    static void AppendDepthOrderedElements(const UIElementPtr& element, std::vector<UIElementPtr>& orderedElements);
+    static size_t GetSubtreeSize(const UIElementPtr& element);
+
+    /// keeps the depth ordered elements up to date without a full rebuild when an
+    /// element's subtree is attached to or detached from the scene.
+    void InsertIntoDepthOrder(const UIElementPtr& element);
+    void RemoveFromDepthOrder(const UIElementPtr& element);
+    void InvalidateDepthOrder();
+
+    /// returns the flattened render traversal of the visible elements, only
+    /// rebuilding it after the element order or an element's visibility changed.
+    const std::vector<RenderCommand>& GetRenderList();
+    void InvalidateRenderList() { m_renderListInvalidated = true; }
+
+    /// returns the hit test index, bringing it up to date with the current element
+    /// order and element rectangles.
+    const UIHitTestIndex& GetHitTestIndex();
+    void InvalidateHitTestRectangles() { m_hitTestIndex.InvalidateRectangles(); }
+
     void MakeFocusElement(UIElementPtr element, const UIInputState& inputState);
     UIElementPtr FindFocusElement(UIElementPtr root);
 
@@ -315,6 +348,7 @@ private:
 
     bool HandleGlobalInputState(const UIInputState&);
 
+    friend class UIElement;
 };
 
 NAMESPACE_ATG_UITK_END
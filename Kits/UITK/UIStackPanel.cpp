@@ -180,20 +180,20 @@ void UIStackPanel::Update(float)
         m_uiManager.SetFocus(m_children.at(m_updateFocus));
         m_updateFocus = c_noUpdate;
     }
-
-    InvalidateRectangleCaches();
 }
 
 void UIStackPanel::Reset()
 {
     m_startIndex = 0;
 
-    for (auto& child : m_children)
+    // detach through the manager so that the children also leave the depth order
+    auto children = m_children;
+    for (auto& child : children)
     {
         child->SetVisible(false);
+        m_uiManager.Detach(child);
     }
 
-    m_children.clear();
     m_numChildren = 0;
 }
 
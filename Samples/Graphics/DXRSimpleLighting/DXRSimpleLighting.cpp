@@ -725,6 +725,7 @@ void Sample::BuildGeometry(ResourceUploadBatch& upload)
     SetDebugObjectName(m_vertexBuffer.resource.Get(), L"Vertex Buffer Resource");
 
     auto finish = upload.End(m_deviceResources->GetCommandQueue());
+    finish.wait();
 
     // Vertex buffer is passed to the shader along with index buffer as a descriptor table.
     auto const StructuredByteStride = sizeof(uint16_t) * 3; // 3 UINT16 per triangle
@@ -823,6 +824,7 @@ void Sample::CreateAccelerationStructureResources(ResourceUploadBatch& upload)
     SetDebugObjectName(instanceDescs.Get(), L"Raytracing Instance Descriptions");
 
     auto finish = upload.End(m_deviceResources->GetCommandQueue());
+    finish.wait();
 
     // Bottom Level Acceleration Structure desc
     {
@@ -488,7 +488,8 @@ void Sample::BuildBottomLevelAccelerationStructure(bool buildEveryFrame)
     uploadBatch.Upload(m_IB.Get(), 0, &ibData, 1);
     uploadBatch.Transition(m_VB.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
     uploadBatch.Transition(m_IB.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE);
-    uploadBatch.End(m_deviceResources->GetCommandQueue());
+    auto uploadResourcesFinished = uploadBatch.End(m_deviceResources->GetCommandQueue());
+    uploadResourcesFinished.wait();
 
     D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC bottomLevelBuildDesc = { m_triangleBLAS->GetGPUVirtualAddress(), rtInputs, 0, m_scratch->GetGPUVirtualAddress() };
     commandList->BuildRaytracingAccelerationStructure(&bottomLevelBuildDesc, 0, nullptr);
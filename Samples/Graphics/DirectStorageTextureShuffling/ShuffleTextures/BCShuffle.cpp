@@ -0,0 +1,140 @@
+//--------------------------------------------------------------------------------------
+// BCShuffle.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "BCShuffle.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr size_t c_maxFields = 6;
+
+    // Fields of a block in the order their planes are laid out in a chunk
+    struct BlockLayout
+    {
+        size_t  blockSize;
+        size_t  chunkSize;
+        size_t  fieldCount;
+        uint8_t fieldOffset[c_maxFields];
+        uint8_t fieldSize[c_maxFields];
+    };
+
+    constexpr BlockLayout c_layouts[] =
+    {
+        // BC1: color endpoint 0, color endpoint 1, color indices
+        { 8, 16384, 3, { 0, 2, 4 }, { 2, 2, 4 } },
+        // BC3: alpha endpoint 0, alpha endpoint 1, alpha indices, then the BC1-style color block
+        { 16, 32768, 6, { 0, 1, 2, 8, 10, 12 }, { 1, 1, 6, 2, 2, 4 } },
+        // BC4: red endpoint 0, red endpoint 1, red indices
+        { 8, 32768, 3, { 0, 1, 2 }, { 1, 1, 6 } },
+        // BC5: a BC4-style block each for red and green
+        { 16, 32768, 6, { 0, 1, 2, 8, 9, 10 }, { 1, 1, 6, 1, 1, 6 } },
+    };
+
+    const BlockLayout* GetLayout(ATG::BCShuffleFormat format) noexcept
+    {
+        const auto index = static_cast<size_t>(format);
+        return (index < sizeof(c_layouts) / sizeof(c_layouts[0])) ? &c_layouts[index] : nullptr;
+    }
+
+    // Copies one field of each block between strided locations
+    template<size_t FieldSize>
+    inline void CopyField(uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t blockCount) noexcept
+    {
+        for (size_t j = 0; j < blockCount; ++j)
+        {
+            memcpy(dst, src, FieldSize);
+            dst += dstStride;
+            src += srcStride;
+        }
+    }
+
+    inline void CopyField(size_t fieldSize, uint8_t* dst, size_t dstStride, const uint8_t* src, size_t srcStride, size_t blockCount) noexcept
+    {
+        // Fixed-size copies let the compiler turn these into plain loads and stores
+        switch (fieldSize)
+        {
+        case 1: CopyField<1>(dst, dstStride, src, srcStride, blockCount); break;
+        case 2: CopyField<2>(dst, dstStride, src, srcStride, blockCount); break;
+        case 4: CopyField<4>(dst, dstStride, src, srcStride, blockCount); break;
+        case 6: CopyField<6>(dst, dstStride, src, srcStride, blockCount); break;
+        default: break;
+        }
+    }
+
+    const BlockLayout* ValidateArguments(const uint8_t* src, const uint8_t* dst, size_t size, ATG::BCShuffleFormat format) noexcept
+    {
+        const BlockLayout* layout = GetLayout(format);
+        if (!layout || ((!src || !dst) && size != 0) || (size % layout->blockSize) != 0)
+        {
+            return nullptr;
+        }
+
+        return layout;
+    }
+}
+
+size_t ATG::GetBCBlockSize(BCShuffleFormat format) noexcept
+{
+    const BlockLayout* layout = GetLayout(format);
+    return layout ? layout->blockSize : 0;
+}
+
+size_t ATG::GetBCShuffleChunkSize(BCShuffleFormat format) noexcept
+{
+    const BlockLayout* layout = GetLayout(format);
+    return layout ? layout->chunkSize : 0;
+}
+
+bool ATG::ShuffleBCBlocks(const uint8_t* src, uint8_t* dst, size_t size, BCShuffleFormat format) noexcept
+{
+    const BlockLayout* layout = ValidateArguments(src, dst, size, format);
+    if (!layout)
+    {
+        return false;
+    }
+
+    for (size_t offset = 0; offset < size; offset += layout->chunkSize)
+    {
+        const size_t blockCount = std::min(size - offset, layout->chunkSize) / layout->blockSize;
+
+        uint8_t* plane = dst + offset;
+        for (size_t field = 0; field < layout->fieldCount; ++field)
+        {
+            const size_t fieldSize = layout->fieldSize[field];
+            CopyField(fieldSize, plane, fieldSize, src + offset + layout->fieldOffset[field], layout->blockSize, blockCount);
+            plane += fieldSize * blockCount;
+        }
+    }
+
+    return true;
+}
+
+bool ATG::UnshuffleBCBlocks(const uint8_t* src, uint8_t* dst, size_t size, BCShuffleFormat format) noexcept
+{
+    const BlockLayout* layout = ValidateArguments(src, dst, size, format);
+    if (!layout)
+    {
+        return false;
+    }
+
+    for (size_t offset = 0; offset < size; offset += layout->chunkSize)
+    {
+        const size_t blockCount = std::min(size - offset, layout->chunkSize) / layout->blockSize;
+
+        const uint8_t* plane = src + offset;
+        for (size_t field = 0; field < layout->fieldCount; ++field)
+        {
+            const size_t fieldSize = layout->fieldSize[field];
+            CopyField(fieldSize, dst + offset + layout->fieldOffset[field], layout->blockSize, plane, fieldSize, blockCount);
+            plane += fieldSize * blockCount;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,50 @@
+//--------------------------------------------------------------------------------------
+// BCShuffle.h
+//
+// Portable byte-plane shuffle for BC1, BC3, BC4 and BC5 block data
+//
+// The data is processed in chunks of BC blocks. Within each chunk, every field of the block
+// (endpoints, indices) is gathered into its own plane, so similar bytes end up next to each
+// other and compress better. The plane layout is the one the Unshuffle*.hlsl shaders read
+// after DirectStorage has macro-unshuffled the data:
+//
+//   BC1 (16KB chunks):  E0[2] E1[2] Indices[4]
+//   BC3 (32KB chunks):  A0[1] A1[1] AlphaIndices[6] C0[2] C1[2] ColorIndices[4]
+//   BC4 (32KB chunks):  R0[1] R1[1] Indices[6]
+//   BC5 (32KB chunks):  R0[1] R1[1] RIndices[6] G0[1] G1[1] GIndices[6]
+//
+// A final partial chunk is shuffled the same way using the number of blocks it holds.
+// This code has no platform dependencies so it can be used from any build machine.
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ATG
+{
+    enum class BCShuffleFormat : uint32_t
+    {
+        BC1,
+        BC3,
+        BC4,
+        BC5,
+    };
+
+    // Size of a single BC block in bytes
+    size_t GetBCBlockSize(BCShuffleFormat format) noexcept;
+
+    // Size of the chunks the planes are gathered over, which matches the shaders' thread group
+    size_t GetBCShuffleChunkSize(BCShuffleFormat format) noexcept;
+
+    // Shuffles size bytes of BC blocks from src into dst. size must be a multiple of the block size,
+    // and src and dst must not overlap. Returns false on invalid arguments.
+    bool ShuffleBCBlocks(const uint8_t* src, uint8_t* dst, size_t size, BCShuffleFormat format) noexcept;
+
+    // Inverse of ShuffleBCBlocks
+    bool UnshuffleBCBlocks(const uint8_t* src, uint8_t* dst, size_t size, BCShuffleFormat format) noexcept;
+}
@@ -0,0 +1,370 @@
+//--------------------------------------------------------------------------------------
+// ChunkedCompression.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "ChunkedCompression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include <zlib.h>
+
+#if SHUFFLE_USE_LZ4
+#include <lz4.h>
+#endif
+
+using namespace ATG;
+
+namespace
+{
+    constexpr size_t c_maxChunkSize = 1u << 30;
+    constexpr size_t c_zlibHeaderSize = 2;
+    constexpr size_t c_zlibTrailerSize = 4;
+
+    struct CompressedChunk
+    {
+        std::vector<uint8_t>    data;
+        uLong                   adler;
+    };
+
+    size_t GetChunkCount(size_t size, size_t chunkSize) noexcept
+    {
+        return std::max<size_t>(1, (size + chunkSize - 1) / chunkSize);
+    }
+
+    // Runs work(index) for every index in [0, count) on up to threadCount threads, and returns false
+    // if any call did
+    template<typename T>
+    bool ParallelFor(size_t count, unsigned int threadCount, T work)
+    {
+        if (threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threadCount = static_cast<unsigned int>(std::min<size_t>(threadCount, count));
+
+        std::atomic<size_t> next(0);
+        std::atomic<bool> succeeded(true);
+        auto worker = [&]()
+        {
+            for (size_t index = next++; index < count && succeeded.load(std::memory_order_relaxed); index = next++)
+            {
+                if (!work(index))
+                {
+                    succeeded = false;
+                }
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (unsigned int j = 1; j < threadCount; ++j)
+        {
+            threads.emplace_back(worker);
+        }
+        worker();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        return succeeded;
+    }
+
+    //----------------------------------------------------------------------------------
+    // Zlib
+    //----------------------------------------------------------------------------------
+
+    bool DeflateChunk(const uint8_t* src, size_t size, int level, bool last, CompressedChunk& chunk)
+    {
+        z_stream stream = {};
+        if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return false;
+        }
+
+        // Room for the empty stored block a full flush ends with
+        chunk.data.resize(deflateBound(&stream, static_cast<uLong>(size)) + 16);
+
+        stream.next_in = const_cast<Bytef*>(src);
+        stream.avail_in = static_cast<uInt>(size);
+        stream.next_out = chunk.data.data();
+        stream.avail_out = static_cast<uInt>(chunk.data.size());
+
+        // A full flush ends the chunk on a byte boundary with no references to earlier data, so the next
+        // chunk can start a fresh deflate stream right after it
+        const int result = deflate(&stream, last ? Z_FINISH : Z_FULL_FLUSH);
+        const bool succeeded = last ? (result == Z_STREAM_END) : (result == Z_OK && stream.avail_in == 0 && stream.avail_out != 0);
+
+        chunk.data.resize(stream.total_out);
+        chunk.adler = adler32(adler32(0, nullptr, 0), src, static_cast<uInt>(size));
+
+        deflateEnd(&stream);
+        return succeeded;
+    }
+
+    bool CompressZlib(const uint8_t* src, size_t size, int level, unsigned int threadCount, CompressedBuffer& result)
+    {
+        if (level < Z_DEFAULT_COMPRESSION || level > Z_BEST_COMPRESSION)
+        {
+            return false;
+        }
+
+        const size_t chunkCount = GetChunkCount(size, result.chunkSize);
+        std::vector<CompressedChunk> chunks(chunkCount);
+        const bool succeeded = ParallelFor(chunkCount, threadCount, [&](size_t index)
+        {
+            const size_t offset = index * result.chunkSize;
+            const size_t chunkSize = std::min(result.chunkSize, size - offset);
+            return DeflateChunk(src + offset, chunkSize, level, index + 1 == chunkCount, chunks[index]);
+        });
+
+        if (!succeeded)
+        {
+            return false;
+        }
+
+        // zlib header with the compression level hint that compress2 would write
+        int levelHint = 2;
+        if (level >= 0 && level < 2)
+        {
+            levelHint = 0;
+        }
+        else if (level >= 2 && level < 6)
+        {
+            levelHint = 1;
+        }
+        else if (level > 6)
+        {
+            levelHint = 3;
+        }
+
+        const unsigned int header = (0x78u << 8) | (static_cast<unsigned int>(levelHint) << 6);
+        result.data.push_back(static_cast<uint8_t>(header >> 8));
+        result.data.push_back(static_cast<uint8_t>((header | (31 - header % 31)) & 0xFF));
+
+        uLong adler = adler32(0, nullptr, 0);
+        for (size_t index = 0; index < chunkCount; ++index)
+        {
+            const size_t chunkSize = std::min(result.chunkSize, size - index * result.chunkSize);
+            adler = adler32_combine(adler, chunks[index].adler, static_cast<z_off_t>(chunkSize));
+
+            result.chunkOffsets.push_back(result.data.size());
+            result.data.insert(result.data.end(), chunks[index].data.begin(), chunks[index].data.end());
+        }
+        result.chunkOffsets.push_back(result.data.size());
+
+        for (int shift = 24; shift >= 0; shift -= 8)
+        {
+            result.data.push_back(static_cast<uint8_t>(adler >> shift));
+        }
+
+        return true;
+    }
+
+    bool DecompressZlib(const CompressedBuffer& compressed, uint8_t* dst, unsigned int threadCount)
+    {
+        const size_t chunkCount = compressed.chunkOffsets.size() - 1;
+        if (compressed.data.size() < c_zlibHeaderSize + c_zlibTrailerSize
+            || compressed.chunkOffsets.back() + c_zlibTrailerSize != compressed.data.size())
+        {
+            return false;
+        }
+
+        std::vector<uLong> adlers(chunkCount);
+        const bool succeeded = ParallelFor(chunkCount, threadCount, [&](size_t index)
+        {
+            const size_t offset = index * compressed.chunkSize;
+            const size_t chunkSize = std::min(compressed.chunkSize, compressed.uncompressedSize - offset);
+
+            adlers[index] = adler32(0, nullptr, 0);
+            if (chunkSize == 0)
+            {
+                // Only an empty buffer has an empty chunk, and zlib won't inflate without an output buffer
+                return true;
+            }
+
+            z_stream stream = {};
+            if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+            {
+                return false;
+            }
+
+            stream.next_in = const_cast<Bytef*>(compressed.data.data() + compressed.chunkOffsets[index]);
+            stream.avail_in = static_cast<uInt>(compressed.chunkOffsets[index + 1] - compressed.chunkOffsets[index]);
+            stream.next_out = dst + offset;
+            stream.avail_out = static_cast<uInt>(chunkSize);
+
+            // Chunks other than the last end on a flush rather than the end of the stream
+            const int result = inflate(&stream, Z_SYNC_FLUSH);
+            const bool inflated = (result == Z_STREAM_END || result == Z_OK || result == Z_BUF_ERROR)
+                && stream.total_out == chunkSize;
+            inflateEnd(&stream);
+
+            adlers[index] = adler32(adlers[index], dst + offset, static_cast<uInt>(chunkSize));
+            return inflated;
+        });
+
+        if (!succeeded)
+        {
+            return false;
+        }
+
+        uLong adler = adler32(0, nullptr, 0);
+        for (size_t index = 0; index < chunkCount; ++index)
+        {
+            const size_t chunkSize = std::min(compressed.chunkSize, compressed.uncompressedSize - index * compressed.chunkSize);
+            adler = adler32_combine(adler, adlers[index], static_cast<z_off_t>(chunkSize));
+        }
+
+        const uint8_t* trailer = compressed.data.data() + compressed.data.size() - c_zlibTrailerSize;
+        const uLong expected = (uLong(trailer[0]) << 24) | (uLong(trailer[1]) << 16) | (uLong(trailer[2]) << 8) | uLong(trailer[3]);
+        return adler == expected;
+    }
+
+    //----------------------------------------------------------------------------------
+    // LZ4
+    //----------------------------------------------------------------------------------
+
+#if SHUFFLE_USE_LZ4
+    bool CompressLZ4(const uint8_t* src, size_t size, int acceleration, unsigned int threadCount, CompressedBuffer& result)
+    {
+        const size_t chunkCount = GetChunkCount(size, result.chunkSize);
+        std::vector<CompressedChunk> chunks(chunkCount);
+        const bool succeeded = ParallelFor(chunkCount, threadCount, [&](size_t index)
+        {
+            const size_t offset = index * result.chunkSize;
+            const int chunkSize = static_cast<int>(std::min(result.chunkSize, size - offset));
+
+            auto& data = chunks[index].data;
+            data.resize(static_cast<size_t>(LZ4_compressBound(chunkSize)));
+
+            const int compressedSize = LZ4_compress_fast(reinterpret_cast<const char*>(src + offset), reinterpret_cast<char*>(data.data()),
+                chunkSize, static_cast<int>(data.size()), std::max(1, acceleration));
+            if (compressedSize <= 0 && chunkSize > 0)
+            {
+                return false;
+            }
+
+            data.resize(static_cast<size_t>(std::max(0, compressedSize)));
+            return true;
+        });
+
+        if (!succeeded)
+        {
+            return false;
+        }
+
+        for (const auto& chunk : chunks)
+        {
+            result.chunkOffsets.push_back(result.data.size());
+            result.data.insert(result.data.end(), chunk.data.begin(), chunk.data.end());
+        }
+        result.chunkOffsets.push_back(result.data.size());
+
+        return true;
+    }
+
+    bool DecompressLZ4(const CompressedBuffer& compressed, uint8_t* dst, unsigned int threadCount)
+    {
+        const size_t chunkCount = compressed.chunkOffsets.size() - 1;
+        if (compressed.chunkOffsets.back() != compressed.data.size())
+        {
+            return false;
+        }
+
+        return ParallelFor(chunkCount, threadCount, [&](size_t index)
+        {
+            const size_t offset = index * compressed.chunkSize;
+            const int chunkSize = static_cast<int>(std::min(compressed.chunkSize, compressed.uncompressedSize - offset));
+            const int compressedSize = static_cast<int>(compressed.chunkOffsets[index + 1] - compressed.chunkOffsets[index]);
+
+            return LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data.data() + compressed.chunkOffsets[index]),
+                reinterpret_cast<char*>(dst + offset), compressedSize, chunkSize) == chunkSize;
+        });
+    }
+#endif
+}
+
+bool ATG::IsCodecSupported(CompressionCodec codec) noexcept
+{
+    switch (codec)
+    {
+    case CompressionCodec::Zlib:
+        return true;
+
+    case CompressionCodec::LZ4:
+        return SHUFFLE_USE_LZ4 != 0;
+
+    default:
+        return false;
+    }
+}
+
+const char* ATG::GetCodecName(CompressionCodec codec) noexcept
+{
+    switch (codec)
+    {
+    case CompressionCodec::Zlib:    return "zlib";
+    case CompressionCodec::LZ4:     return "lz4";
+    default:                        return "unknown";
+    }
+}
+
+bool ATG::CompressChunked(const uint8_t* src, size_t size, CompressionCodec codec, int level,
+    size_t chunkSize, unsigned int threadCount, CompressedBuffer& result)
+{
+    result = {};
+    result.codec = codec;
+    result.uncompressedSize = size;
+    result.chunkSize = (chunkSize != 0) ? chunkSize : c_defaultCompressionChunkSize;
+
+    if ((!src && size != 0) || result.chunkSize > c_maxChunkSize)
+    {
+        return false;
+    }
+
+    switch (codec)
+    {
+    case CompressionCodec::Zlib:
+        return CompressZlib(src, size, level, threadCount, result);
+
+#if SHUFFLE_USE_LZ4
+    case CompressionCodec::LZ4:
+        return CompressLZ4(src, size, level, threadCount, result);
+#endif
+
+    default:
+        return false;
+    }
+}
+
+bool ATG::DecompressChunked(const CompressedBuffer& compressed, uint8_t* dst, size_t dstSize, unsigned int threadCount)
+{
+    if ((!dst && dstSize != 0)
+        || dstSize != compressed.uncompressedSize
+        || compressed.chunkSize == 0
+        || compressed.chunkOffsets.size() != GetChunkCount(compressed.uncompressedSize, compressed.chunkSize) + 1)
+    {
+        return false;
+    }
+
+    switch (compressed.codec)
+    {
+    case CompressionCodec::Zlib:
+        return DecompressZlib(compressed, dst, threadCount);
+
+#if SHUFFLE_USE_LZ4
+    case CompressionCodec::LZ4:
+        return DecompressLZ4(compressed, dst, threadCount);
+#endif
+
+    default:
+        return false;
+    }
+}
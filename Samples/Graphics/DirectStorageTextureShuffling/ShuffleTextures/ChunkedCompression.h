@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// ChunkedCompression.h
+//
+// Multi-threaded compression of a buffer in independent chunks
+//
+// Zlib: every chunk is deflated on its own and ended with a full flush, and the results are
+// joined into a single standard zlib stream. It can be decompressed with uncompress() or
+// DirectStorage like any other zlib stream, and because a full flush resets the dictionary,
+// each chunk can also be inflated on its own from its offset.
+//
+// LZ4: every chunk is an LZ4 block. This is not a format DirectStorage understands; it's
+// there to evaluate a faster codec on the same data.
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Set to 0 when building without the lz4 library
+#ifndef SHUFFLE_USE_LZ4
+#define SHUFFLE_USE_LZ4 1
+#endif
+
+namespace ATG
+{
+    enum class CompressionCodec : uint32_t
+    {
+        Zlib,
+        LZ4,
+    };
+
+    struct CompressedBuffer
+    {
+        CompressionCodec        codec;
+        size_t                  uncompressedSize;
+        size_t                  chunkSize;
+        std::vector<uint8_t>    data;
+        std::vector<size_t>     chunkOffsets;   // offset of each chunk's compressed data, plus the end of the last
+    };
+
+    // Chunk size used when none is given
+    constexpr size_t c_defaultCompressionChunkSize = 256 * 1024;
+
+    bool IsCodecSupported(CompressionCodec codec) noexcept;
+    const char* GetCodecName(CompressionCodec codec) noexcept;
+
+    // level is the zlib level (0-9), or the LZ4 acceleration factor (1 is the default, higher is faster).
+    // threadCount 0 uses all hardware threads.
+    bool CompressChunked(const uint8_t* src, size_t size, CompressionCodec codec, int level,
+        size_t chunkSize, unsigned int threadCount, CompressedBuffer& result);
+
+    // dstSize must match the uncompressed size
+    bool DecompressChunked(const CompressedBuffer& compressed, uint8_t* dst, size_t dstSize, unsigned int threadCount);
+}
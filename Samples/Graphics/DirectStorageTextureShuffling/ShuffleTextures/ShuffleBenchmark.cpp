@@ -0,0 +1,600 @@
+//--------------------------------------------------------------------------------------
+// ShuffleBenchmark.cpp
+//
+// Command line tool to measure how shuffling affects the compression of BC textures
+//
+// Usage: ShuffleBenchmark [-t <threads>] [-c <chunkKB>] [-z <zlibLevel>] [-a <lz4Acceleration>] [-i <iterations>] <file or folder>...
+//        ShuffleBenchmark -check
+//
+// Every BC1, BC3, BC4 and BC5 .dds file found is compressed with each codec as is and after the
+// portable byte-plane shuffle. The compression ratio and compress/decompress throughput are reported
+// per format and for the whole corpus. All round trips are verified against the source data.
+// -check runs the shuffle and chunked compression round trips on generated data instead.
+// The tool only uses standard C++ and zlib (and optionally lz4), so it can run on any build machine.
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "BCShuffle.h"
+#include "ChunkedCompression.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <zlib.h>
+
+using namespace ATG;
+
+namespace
+{
+    struct Options
+    {
+        unsigned int    threadCount = 0;
+        size_t          chunkSize = c_defaultCompressionChunkSize;
+        int             zlibLevel = 9;
+        int             lz4Acceleration = 1;
+        unsigned int    iterations = 3;
+    };
+
+    struct Texture
+    {
+        std::filesystem::path   path;
+        BCShuffleFormat         format;
+        std::vector<uint8_t>    blocks;
+    };
+
+    // Totals for one codec, with or without shuffling
+    struct Results
+    {
+        uint64_t    uncompressedBytes = 0;
+        uint64_t    compressedBytes = 0;
+        double      compressSeconds = 0;
+        double      decompressSeconds = 0;
+        double      shuffleSeconds = 0;
+        double      unshuffleSeconds = 0;
+
+        void Add(const Results& other)
+        {
+            uncompressedBytes += other.uncompressedBytes;
+            compressedBytes += other.compressedBytes;
+            compressSeconds += other.compressSeconds;
+            decompressSeconds += other.decompressSeconds;
+            shuffleSeconds += other.shuffleSeconds;
+            unshuffleSeconds += other.unshuffleSeconds;
+        }
+    };
+
+    constexpr BCShuffleFormat c_formats[] = { BCShuffleFormat::BC1, BCShuffleFormat::BC3, BCShuffleFormat::BC4, BCShuffleFormat::BC5 };
+    constexpr CompressionCodec c_codecs[] = { CompressionCodec::Zlib, CompressionCodec::LZ4 };
+    constexpr size_t c_formatCount = sizeof(c_formats) / sizeof(c_formats[0]);
+    constexpr size_t c_codecCount = sizeof(c_codecs) / sizeof(c_codecs[0]);
+
+    const char* GetFormatName(BCShuffleFormat format)
+    {
+        switch (format)
+        {
+        case BCShuffleFormat::BC1:  return "BC1";
+        case BCShuffleFormat::BC3:  return "BC3";
+        case BCShuffleFormat::BC4:  return "BC4";
+        case BCShuffleFormat::BC5:  return "BC5";
+        default:                    return "?";
+        }
+    }
+
+    //----------------------------------------------------------------------------------
+    // DDS loading
+    //----------------------------------------------------------------------------------
+
+    constexpr uint32_t MakeFourCC(char ch0, char ch1, char ch2, char ch3)
+    {
+        return static_cast<uint32_t>(static_cast<uint8_t>(ch0))
+            | (static_cast<uint32_t>(static_cast<uint8_t>(ch1)) << 8)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(ch2)) << 16)
+            | (static_cast<uint32_t>(static_cast<uint8_t>(ch3)) << 24);
+    }
+
+    constexpr size_t c_ddsHeaderSize = 4 + 124;     // magic + DDS_HEADER
+    constexpr size_t c_ddsHeaderDXT10Size = 20;
+    constexpr size_t c_ddsPixelFormatFlagsOffset = 4 + 76;
+    constexpr size_t c_ddsFourCCOffset = 4 + 80;
+    constexpr uint32_t c_ddpfFourCC = 0x4;
+
+    uint32_t ReadUInt32(const uint8_t* data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    bool GetFormatFromFourCC(uint32_t fourCC, BCShuffleFormat& format)
+    {
+        if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+        {
+            format = BCShuffleFormat::BC1;
+        }
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '4') || fourCC == MakeFourCC('D', 'X', 'T', '5'))
+        {
+            format = BCShuffleFormat::BC3;
+        }
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '1') || fourCC == MakeFourCC('B', 'C', '4', 'U') || fourCC == MakeFourCC('B', 'C', '4', 'S'))
+        {
+            format = BCShuffleFormat::BC4;
+        }
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U') || fourCC == MakeFourCC('B', 'C', '5', 'S'))
+        {
+            format = BCShuffleFormat::BC5;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    bool GetFormatFromDXGI(uint32_t dxgiFormat, BCShuffleFormat& format)
+    {
+        // DXGI_FORMAT_BC1_TYPELESS .. DXGI_FORMAT_BC5_SNORM, skipping BC2
+        switch (dxgiFormat)
+        {
+        case 70: case 71: case 72:  format = BCShuffleFormat::BC1; return true;
+        case 76: case 77: case 78:  format = BCShuffleFormat::BC3; return true;
+        case 79: case 80: case 81:  format = BCShuffleFormat::BC4; return true;
+        case 82: case 83: case 84:  format = BCShuffleFormat::BC5; return true;
+        default:                    return false;
+        }
+    }
+
+    // Loads all the block data (every mip, face and array slice) of a BC1/3/4/5 DDS file
+    bool LoadDDS(const std::filesystem::path& path, Texture& texture)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        if (data.size() < c_ddsHeaderSize || ReadUInt32(data.data()) != MakeFourCC('D', 'D', 'S', ' '))
+        {
+            return false;
+        }
+
+        if (!(ReadUInt32(data.data() + c_ddsPixelFormatFlagsOffset) & c_ddpfFourCC))
+        {
+            return false;
+        }
+
+        size_t dataOffset = c_ddsHeaderSize;
+        const uint32_t fourCC = ReadUInt32(data.data() + c_ddsFourCCOffset);
+        if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+        {
+            if (data.size() < c_ddsHeaderSize + c_ddsHeaderDXT10Size
+                || !GetFormatFromDXGI(ReadUInt32(data.data() + c_ddsHeaderSize), texture.format))
+            {
+                return false;
+            }
+            dataOffset += c_ddsHeaderDXT10Size;
+        }
+        else if (!GetFormatFromFourCC(fourCC, texture.format))
+        {
+            return false;
+        }
+
+        const size_t blockSize = GetBCBlockSize(texture.format);
+        const size_t size = ((data.size() - dataOffset) / blockSize) * blockSize;
+
+        texture.path = path;
+        texture.blocks.assign(data.begin() + static_cast<ptrdiff_t>(dataOffset), data.begin() + static_cast<ptrdiff_t>(dataOffset + size));
+        return !texture.blocks.empty();
+    }
+
+    void FindTextures(const std::filesystem::path& path, std::vector<std::filesystem::path>& files)
+    {
+        std::error_code error;
+        if (std::filesystem::is_directory(path, error))
+        {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(path, error))
+            {
+                std::string extension = entry.path().extension().string();
+                std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+                if (entry.is_regular_file(error) && extension == ".dds")
+                {
+                    files.push_back(entry.path());
+                }
+            }
+        }
+        else
+        {
+            files.push_back(path);
+        }
+    }
+
+    //----------------------------------------------------------------------------------
+    // Measurement
+    //----------------------------------------------------------------------------------
+
+    // Shortest time a single sample runs for. Small textures are repeated until they reach it, so the
+    // clock resolution and the thread start-up don't dominate the measurement.
+    constexpr double c_minSampleSeconds = 0.05;
+
+    // Returns the time of one run of work from the fastest of several samples, which is the least
+    // disturbed by the rest of the machine, or a negative value if work failed
+    template<typename T>
+    double TimeBest(unsigned int iterations, T work)
+    {
+        double best = -1.0;
+        for (unsigned int j = 0; j < std::max(1u, iterations); ++j)
+        {
+            unsigned int runs = 0;
+            double seconds = 0;
+            const auto start = std::chrono::steady_clock::now();
+            do
+            {
+                if (!work())
+                {
+                    return -1.0;
+                }
+                ++runs;
+                seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (seconds < c_minSampleSeconds);
+
+            const double perRun = seconds / runs;
+            best = (best < 0) ? perRun : std::min(best, perRun);
+        }
+        return best;
+    }
+
+    bool Measure(const Texture& texture, CompressionCodec codec, bool shuffle, const Options& options, Results& results)
+    {
+        const size_t size = texture.blocks.size();
+        const int level = (codec == CompressionCodec::Zlib) ? options.zlibLevel : options.lz4Acceleration;
+
+        std::vector<uint8_t> shuffled;
+        const uint8_t* source = texture.blocks.data();
+        if (shuffle)
+        {
+            shuffled.resize(size);
+            results.shuffleSeconds = TimeBest(options.iterations, [&]()
+            {
+                return ShuffleBCBlocks(texture.blocks.data(), shuffled.data(), size, texture.format);
+            });
+            source = shuffled.data();
+        }
+
+        CompressedBuffer compressed;
+        results.compressSeconds = TimeBest(options.iterations, [&]()
+        {
+            return CompressChunked(source, size, codec, level, options.chunkSize, options.threadCount, compressed);
+        });
+
+        std::vector<uint8_t> decompressed(size);
+        results.decompressSeconds = TimeBest(options.iterations, [&]()
+        {
+            return DecompressChunked(compressed, decompressed.data(), size, options.threadCount);
+        });
+
+        if ((shuffle && results.shuffleSeconds <= 0) || results.compressSeconds <= 0 || results.decompressSeconds <= 0)
+        {
+            return false;
+        }
+
+        if (shuffle)
+        {
+            std::vector<uint8_t> unshuffled(size);
+            results.unshuffleSeconds = TimeBest(options.iterations, [&]()
+            {
+                return UnshuffleBCBlocks(decompressed.data(), unshuffled.data(), size, texture.format);
+            });
+            decompressed.swap(unshuffled);
+        }
+
+        results.uncompressedBytes = size;
+        results.compressedBytes = compressed.data.size();
+
+        return (!shuffle || results.unshuffleSeconds > 0) && decompressed == texture.blocks;
+    }
+
+    // Measure() fails rather than record a time of zero
+    double GetMBPerSecond(uint64_t bytes, double seconds)
+    {
+        return double(bytes) / seconds / 1e6;
+    }
+
+    void PrintResults(const char* name, CompressionCodec codec, const Results& unshuffled, const Results& shuffled)
+    {
+        if (unshuffled.uncompressedBytes == 0)
+        {
+            return;
+        }
+
+        const double savings = 100.0 * (1.0 - double(shuffled.compressedBytes) / double(unshuffled.compressedBytes));
+        printf("%-6s %-5s %-10s %12llu %12llu %7.3f %9.1f %11.1f\n", name, GetCodecName(codec), "unshuffled",
+            static_cast<unsigned long long>(unshuffled.uncompressedBytes),
+            static_cast<unsigned long long>(unshuffled.compressedBytes),
+            double(unshuffled.uncompressedBytes) / double(unshuffled.compressedBytes),
+            GetMBPerSecond(unshuffled.uncompressedBytes, unshuffled.compressSeconds),
+            GetMBPerSecond(unshuffled.uncompressedBytes, unshuffled.decompressSeconds));
+        printf("%-6s %-5s %-10s %12llu %12llu %7.3f %9.1f %11.1f  (%+.2f%% size, shuffle %.0f MB/s, unshuffle %.0f MB/s)\n", name, GetCodecName(codec), "shuffled",
+            static_cast<unsigned long long>(shuffled.uncompressedBytes),
+            static_cast<unsigned long long>(shuffled.compressedBytes),
+            double(shuffled.uncompressedBytes) / double(shuffled.compressedBytes),
+            GetMBPerSecond(shuffled.uncompressedBytes, shuffled.compressSeconds),
+            GetMBPerSecond(shuffled.uncompressedBytes, shuffled.decompressSeconds),
+            -savings,
+            GetMBPerSecond(shuffled.uncompressedBytes, shuffled.shuffleSeconds),
+            GetMBPerSecond(shuffled.uncompressedBytes, shuffled.unshuffleSeconds));
+    }
+
+    //----------------------------------------------------------------------------------
+    // Self check
+    //----------------------------------------------------------------------------------
+
+    // Block data with runs of repeated bytes between the noise, so the codecs have matches to find
+    std::vector<uint8_t> MakeTestData(size_t size)
+    {
+        std::vector<uint8_t> data(size);
+        uint32_t state = static_cast<uint32_t>(size);
+        for (size_t j = 0; j < size; ++j)
+        {
+            state = state * 1664525u + 1013904223u;
+            data[j] = ((j / 64) & 1) ? static_cast<uint8_t>(j & 0xF) : static_cast<uint8_t>(state >> 24);
+        }
+        return data;
+    }
+
+    bool CheckShuffle(BCShuffleFormat format, size_t size)
+    {
+        const auto blocks = MakeTestData(size);
+        std::vector<uint8_t> shuffled(size);
+        std::vector<uint8_t> unshuffled(size);
+        if (!ShuffleBCBlocks(blocks.data(), shuffled.data(), size, format)
+            || !UnshuffleBCBlocks(shuffled.data(), unshuffled.data(), size, format)
+            || unshuffled != blocks)
+        {
+            return false;
+        }
+
+        // A size that isn't a whole number of blocks must be rejected
+        if (size > 0 && ShuffleBCBlocks(blocks.data(), shuffled.data(), size - 1, format))
+        {
+            return false;
+        }
+
+        // The first BC1 plane holds the first endpoint of every block in the chunk, where UnshuffleBC1.hlsl reads it
+        if (format == BCShuffleFormat::BC1)
+        {
+            const size_t blockCount = std::min(size, GetBCShuffleChunkSize(format)) / GetBCBlockSize(format);
+            for (size_t j = 0; j < blockCount; ++j)
+            {
+                if (memcmp(shuffled.data() + j * 2, blocks.data() + j * GetBCBlockSize(format), 2) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool CheckCompression(CompressionCodec codec, int level, size_t chunkSize, unsigned int threadCount, size_t size)
+    {
+        const auto data = MakeTestData(size);
+        CompressedBuffer compressed;
+        std::vector<uint8_t> decompressed(size);
+        if (!CompressChunked(data.data(), size, codec, level, chunkSize, threadCount, compressed)
+            || !DecompressChunked(compressed, decompressed.data(), size, threadCount)
+            || decompressed != data)
+        {
+            return false;
+        }
+
+        if (codec == CompressionCodec::Zlib)
+        {
+            // The joined chunks must be a standard zlib stream
+            std::vector<uint8_t> inflated(size + 1);
+            uLongf inflatedSize = static_cast<uLongf>(inflated.size());
+            if (uncompress(inflated.data(), &inflatedSize, compressed.data.data(), static_cast<uLong>(compressed.data.size())) != Z_OK
+                || inflatedSize != size
+                || !std::equal(data.begin(), data.end(), inflated.begin()))
+            {
+                return false;
+            }
+
+            // and a damaged checksum must be caught
+            compressed.data.back() ^= 1;
+            if (DecompressChunked(compressed, decompressed.data(), size, threadCount))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Round trips generated data through the shuffle and the chunked codecs, covering partial chunks,
+    // chunk sizes that don't divide the data, several thread counts and an empty buffer
+    bool RunSelfCheck(const Options& options)
+    {
+        unsigned int failures = 0;
+
+        for (const auto format : c_formats)
+        {
+            const size_t blockSize = GetBCBlockSize(format);
+            const size_t shuffleChunkSize = GetBCShuffleChunkSize(format);
+            const size_t sizes[] = { 0, blockSize, shuffleChunkSize - blockSize, shuffleChunkSize, 3 * shuffleChunkSize + 5 * blockSize };
+            for (const size_t size : sizes)
+            {
+                if (!CheckShuffle(format, size))
+                {
+                    printf("FAILED: %s shuffle round trip of %zu bytes\n", GetFormatName(format), size);
+                    ++failures;
+                }
+            }
+        }
+
+        const size_t chunkSizes[] = { options.chunkSize, 4096, 1000 };
+        const size_t sizes[] = { 0, 1, 4096, 100000, 600000 };
+        const unsigned int threadCounts[] = { 1, 4 };
+        for (const auto codec : c_codecs)
+        {
+            if (!IsCodecSupported(codec))
+            {
+                continue;
+            }
+
+            const int zlibLevels[] = { 1, options.zlibLevel };
+            const int lz4Levels[] = { 1, 8 };
+            for (const int level : (codec == CompressionCodec::Zlib) ? zlibLevels : lz4Levels)
+            {
+                for (const size_t chunkSize : chunkSizes)
+                {
+                    for (const unsigned int threadCount : threadCounts)
+                    {
+                        for (const size_t size : sizes)
+                        {
+                            if (!CheckCompression(codec, level, chunkSize, threadCount, size))
+                            {
+                                printf("FAILED: %s level %d round trip of %zu bytes in %zu byte chunks on %u threads\n",
+                                    GetCodecName(codec), level, size, chunkSize, threadCount);
+                                ++failures;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        if (failures == 0)
+        {
+            printf("All round trips passed\n");
+        }
+        return failures == 0;
+    }
+
+    void PrintUsage()
+    {
+        printf("Usage: ShuffleBenchmark [-t <threads>] [-c <chunkKB>] [-z <zlibLevel>] [-a <lz4Acceleration>] [-i <iterations>] <file or folder>...\n");
+        printf("       ShuffleBenchmark -check\n\n");
+        printf("   -t <threads>          worker threads for compression, 0 for all hardware threads (default 0)\n");
+        printf("   -c <chunkKB>          size of the independently compressed chunks (default %zu)\n", c_defaultCompressionChunkSize / 1024);
+        printf("   -z <zlibLevel>        zlib compression level, 0 to 9 (default 9)\n");
+        printf("   -a <lz4Acceleration>  lz4 acceleration factor, 1 or more (default 1)\n");
+        printf("   -i <iterations>       runs of each measurement; the fastest is reported (default 3)\n");
+        printf("   -check                verify the shuffle and compression round trips on generated data\n");
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    std::vector<std::filesystem::path> files;
+    bool selfCheck = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strcmp(arg, "-check") == 0)
+        {
+            selfCheck = true;
+        }
+        else if (arg[0] == '-' && arg[1] != '\0' && arg[2] == '\0')
+        {
+            if (i + 1 >= argc)
+            {
+                PrintUsage();
+                return 1;
+            }
+
+            const long value = strtol(argv[++i], nullptr, 10);
+            switch (arg[1])
+            {
+            case 't': options.threadCount = static_cast<unsigned int>(std::max(0L, value)); break;
+            case 'c': options.chunkSize = static_cast<size_t>(std::max(1L, value)) * 1024; break;
+            case 'z': options.zlibLevel = static_cast<int>(std::min(9L, std::max(0L, value))); break;
+            case 'a': options.lz4Acceleration = static_cast<int>(std::max(1L, value)); break;
+            case 'i': options.iterations = static_cast<unsigned int>(std::max(1L, value)); break;
+            default:
+                PrintUsage();
+                return 1;
+            }
+        }
+        else
+        {
+            FindTextures(arg, files);
+        }
+    }
+
+    if (selfCheck)
+    {
+        return RunSelfCheck(options) ? 0 : 1;
+    }
+
+    if (files.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    Results totals[c_formatCount][c_codecCount][2];
+    size_t textureCount = 0;
+    for (const auto& path : files)
+    {
+        Texture texture;
+        if (!LoadDDS(path, texture))
+        {
+            printf("Skipping %s: not a BC1, BC3, BC4 or BC5 DDS file\n", path.string().c_str());
+            continue;
+        }
+
+        for (size_t codec = 0; codec < c_codecCount; ++codec)
+        {
+            if (!IsCodecSupported(c_codecs[codec]))
+            {
+                continue;
+            }
+
+            for (int shuffle = 0; shuffle < 2; ++shuffle)
+            {
+                Results results;
+                if (!Measure(texture, c_codecs[codec], shuffle != 0, options, results))
+                {
+                    printf("ERROR: %s round trip failed for %s\n", GetCodecName(c_codecs[codec]), path.string().c_str());
+                    return 1;
+                }
+
+                totals[static_cast<size_t>(texture.format)][codec][shuffle].Add(results);
+            }
+        }
+
+        ++textureCount;
+    }
+
+    printf("\n");
+    printf("%-6s %-5s %-10s %12s %12s %7s %9s %11s\n", "Format", "Codec", "Data", "Bytes", "Compressed", "Ratio", "Comp MB/s", "Decomp MB/s");
+    for (size_t codec = 0; codec < c_codecCount; ++codec)
+    {
+        Results corpus[2];
+        for (size_t format = 0; format < c_formatCount; ++format)
+        {
+            PrintResults(GetFormatName(c_formats[format]), c_codecs[codec], totals[format][codec][0], totals[format][codec][1]);
+            corpus[0].Add(totals[format][codec][0]);
+            corpus[1].Add(totals[format][codec][1]);
+        }
+        PrintResults("All", c_codecs[codec], corpus[0], corpus[1]);
+    }
+
+    printf("\n%zu textures, %zu KB chunks\n", textureCount, options.chunkSize / 1024);
+
+    return 0;
+}
@@ -20,19 +20,23 @@
 #include <vector>
 
 #include "..\\ShuffledTextureMetadata.h"
+#include "BCShuffle.h"
+#include "ChunkedCompression.h"
 
 #pragma warning(default : 4061)
 
 HRESULT LoadInputImage(DirectX::ScratchImage& image, const wchar_t* pFilePath);
 HRESULT EncodeToBCFormat(DirectX::ScratchImage& srcImage, DirectX::ScratchImage& bcImage, const DXGI_FORMAT bcFormat);
 HRESULT ShuffleData(const Xbox::XboxImage& srcImage, Xbox::XboxImage& dstImage, XG_FORMAT format, UINT32& swizzleMode);
-HRESULT CompressWithZlib(Xbox::XboxImage& srcImage, std::vector<Bytef>& compressedData, uint32_t& size);
+HRESULT PortableShuffleData(const Xbox::XboxImage& srcImage, std::vector<uint8_t>& dstData, ATG::BCShuffleFormat format);
+HRESULT CompressWithZlib(const uint8_t* pSrcData, size_t srcSize, std::vector<uint8_t>& compressedData, uint32_t& size);
 HRESULT WriteTextureDataToDisk(std::wstring& outputPath, Xbox::XboxImage& image, const uint8_t* pCompressedData, UINT32 dstorageSwizzleMode,
-                               const uint32_t shuffledCompressedSize, const uint32_t unshuffledCompressedSize);
+                               const uint32_t shuffledCompressedSize, const uint32_t unshuffledCompressedSize, const uint32_t portableShuffledCompressedSize);
 
 const int numFormats = 4;
 DXGI_FORMAT bcFormats[numFormats] = { DXGI_FORMAT_BC1_UNORM, DXGI_FORMAT_BC3_UNORM, DXGI_FORMAT_BC4_UNORM, DXGI_FORMAT_BC5_UNORM };
 XG_FORMAT   xgFormats[numFormats] = { XG_FORMAT_BC1_UNORM, XG_FORMAT_BC3_UNORM, XG_FORMAT_BC4_UNORM, XG_FORMAT_BC5_UNORM };
+ATG::BCShuffleFormat bcShuffleFormats[numFormats] = { ATG::BCShuffleFormat::BC1, ATG::BCShuffleFormat::BC3, ATG::BCShuffleFormat::BC4, ATG::BCShuffleFormat::BC5 };
 
 std::wstring dataFolder = L"../Textures/";
 
@@ -52,10 +56,12 @@ int main(int argc, char* argv[])
     DirectX::ScratchImage   bcImage;
     Xbox::XboxImage         bcXboxImage;
     Xbox::XboxImage         shuffledImage;
-    std::vector<Bytef>      compressedData;
+    std::vector<uint8_t>    portableShuffledData;
+    std::vector<uint8_t>    compressedData;
 
     uint32_t unshuffledCompressedSize = 0;
 	uint32_t shuffledCompressedSize = 0;
+    uint32_t portableShuffledCompressedSize = 0;
     uint32_t dstorageSwizzleMode = 0;
     int bcIndex = 0;
 	
@@ -111,7 +117,22 @@ int main(int argc, char* argv[])
 
         // Just for stats, determine the size of unshuffled compressed data, and shuffled compressed data
         {
-            hr = CompressWithZlib(bcXboxImage, compressedData, unshuffledCompressedSize);
+            hr = CompressWithZlib(bcXboxImage.GetPointer(), bcXboxImage.GetSize(), compressedData, unshuffledCompressedSize);
+            if (FAILED(hr))
+            {
+                wprintf(L"Failed to compress image data with Zlib.\n");
+                return 1;
+            }
+
+            // The portable shuffle produces the layout the unshuffle shaders read, without the DirectStorage macro-shuffle
+            hr = PortableShuffleData(bcXboxImage, portableShuffledData, bcShuffleFormats[bcIndex]);
+            if (FAILED(hr))
+            {
+                wprintf(L"Failed to shuffle image data.\n");
+                return 1;
+            }
+
+            hr = CompressWithZlib(portableShuffledData.data(), portableShuffledData.size(), compressedData, portableShuffledCompressedSize);
             if (FAILED(hr))
             {
                 wprintf(L"Failed to compress image data with Zlib.\n");
@@ -119,14 +140,14 @@ int main(int argc, char* argv[])
             }
         }
 
-        hr = CompressWithZlib(shuffledImage, compressedData, shuffledCompressedSize);
+        hr = CompressWithZlib(shuffledImage.GetPointer(), shuffledImage.GetSize(), compressedData, shuffledCompressedSize);
         if (FAILED(hr))
         {
             wprintf(L"Failed to compress image data with Zlib.\n");
             return 1;
         }
 
-        WriteTextureDataToDisk(dataFolder, shuffledImage, compressedData.data(), dstorageSwizzleMode, shuffledCompressedSize, unshuffledCompressedSize);
+        WriteTextureDataToDisk(dataFolder, shuffledImage, compressedData.data(), dstorageSwizzleMode, shuffledCompressedSize, unshuffledCompressedSize, portableShuffledCompressedSize);
 
         // Show some stats
         wprintf(L"\nStats:\n");
@@ -134,6 +155,7 @@ int main(int argc, char* argv[])
         wprintf(L"    BCn size:                   %d bytes\n", static_cast<uint32_t>(bcImage.GetPixelsSize()));
         wprintf(L"    Unshuffled compressed size: %d bytes\n", unshuffledCompressedSize);
         wprintf(L"    Shuffled compressed size:   %d bytes\n", shuffledCompressedSize);
+        wprintf(L"    Portable shuffled size:     %d bytes\n", portableShuffledCompressedSize);
         bcIndex++;
     }
 
@@ -185,30 +207,40 @@ HRESULT ShuffleData(const Xbox::XboxImage& srcImage, Xbox::XboxImage& dstImage,
     return S_OK;
 }
 
-HRESULT CompressWithZlib(Xbox::XboxImage& srcImage, std::vector<Bytef>& compressedData, uint32_t& size)
+HRESULT PortableShuffleData(const Xbox::XboxImage& srcImage, std::vector<uint8_t>& dstData, ATG::BCShuffleFormat format)
 {
-    wprintf(L"\nCompressing with Zlib ...");
+    wprintf(L"\nShuffling texture data (portable) ...");
+
+    dstData.resize(srcImage.GetSize());
+    if (!ATG::ShuffleBCBlocks(srcImage.GetPointer(), dstData.data(), dstData.size(), format))
+    {
+        return E_FAIL;
+    }
 
-    uLong uncompressedSize = static_cast<uLong>(srcImage.GetSize());
-    uLong compressedSize = compressBound(uncompressedSize);
-    compressedData.resize(compressedSize);
+    return S_OK;
+}
 
-    int result = compress(compressedData.data(), &compressedSize, srcImage.GetPointer(), uncompressedSize);
+HRESULT CompressWithZlib(const uint8_t* pSrcData, size_t srcSize, std::vector<uint8_t>& compressedData, uint32_t& size)
+{
+    wprintf(L"\nCompressing with Zlib ...");
 
-    if (result != Z_OK)
+    // Chunks are compressed on all cores but still form a single zlib stream, as DirectStorage expects
+    ATG::CompressedBuffer compressed;
+    if (!ATG::CompressChunked(pSrcData, srcSize, ATG::CompressionCodec::Zlib, Z_DEFAULT_COMPRESSION,
+        ATG::c_defaultCompressionChunkSize, 0, compressed))
     {
         wprintf(L"Failed to compress data with zlib");
         return E_FAIL;
     }
 
-    compressedData.resize(compressedSize);
-    size = static_cast<uint32_t>(compressedSize);
+    compressedData.swap(compressed.data);
+    size = static_cast<uint32_t>(compressedData.size());
 
     return S_OK;
 }
 
 HRESULT WriteTextureDataToDisk(std::wstring& outputPath, Xbox::XboxImage& image, const uint8_t* pCompressedData, UINT32 dstorageSwizzleMode,
-                               const uint32_t shuffledCompressedSize, const uint32_t unshuffledCompressedSize)
+                               const uint32_t shuffledCompressedSize, const uint32_t unshuffledCompressedSize, const uint32_t portableShuffledCompressedSize)
 {
     const auto& textureMetadata = image.GetMetadata();
 
@@ -225,6 +257,8 @@ HRESULT WriteTextureDataToDisk(std::wstring& outputPath, Xbox::XboxImage& image,
     shuffledTextureMetadata.uncompressedSize = static_cast<uint32_t>(image.GetSize());
     shuffledTextureMetadata.shuffledComrpessedSize = shuffledCompressedSize;
     shuffledTextureMetadata.unshuffledComrpessedSize = unshuffledCompressedSize;
+    shuffledTextureMetadata.portableShuffledCompressedSize = portableShuffledCompressedSize;
+    shuffledTextureMetadata.compressionChunkSize = static_cast<uint32_t>(ATG::c_defaultCompressionChunkSize);
 
     unsigned int bcEncoding = (textureMetadata.format - 71) / 3 + 1;
     std::wstring outputFilePath = outputPath + L"BC" + std::to_wstring(bcEncoding) + L"_" + L"shuffled_compressed.bin";
@@ -35,7 +35,9 @@ struct ShuffledTextureMetadata
     uint32_t    uncompressedSize;
     uint32_t    shuffledComrpessedSize;
     uint32_t    unshuffledComrpessedSize;
-	uint32_t	pad[5];
+    uint32_t    portableShuffledCompressedSize;     // Size with ATG::ShuffleBCBlocks instead of the XG shuffle, for comparison
+    uint32_t    compressionChunkSize;               // The zlib stream is fully flushed every this many uncompressed bytes; 0 if unknown
+	uint32_t	pad[3];
 };
 
 #endif // SHUFFLED_TEXTURE_METADATA_H
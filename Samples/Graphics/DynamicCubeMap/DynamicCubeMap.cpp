@@ -208,7 +208,7 @@ namespace
         for (size_t j = 0; j < meshletData.size(); ++j)
         {
             const MeshletSet& meshletSet = meshletData[j];
-            const std::vector<Submesh>& submeshes = meshletSet.GetSubmeshes();
+            const MeshletSpan<Submesh>& submeshes = meshletSet.GetSubmeshes();
             for (size_t k = 0; k < meshletSet.GetSubmeshCount(); ++k)
             {
                 SubMeshlet subMeshData = {};
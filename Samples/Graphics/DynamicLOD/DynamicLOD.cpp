@@ -771,7 +771,8 @@ void Sample::CreateDeviceDependentResources()
         resourceUpload.Upload(m_whiteTexture.Get(), 0, &data, 1);
         resourceUpload.Transition(m_whiteTexture.Get(), D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
 
-        resourceUpload.End(m_deviceResources->GetCommandQueue());
+        auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+        uploadResourcesFinished.wait();
     }
 
 
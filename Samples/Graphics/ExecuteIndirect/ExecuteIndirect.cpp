@@ -676,7 +676,8 @@ void Sample::CreateDeviceDependentResources()
     SpriteBatchPipelineStateDescription pipelineDescription(renderTargetState);
     m_spriteBatch = std::make_unique<SpriteBatch>(device, resourceUpload, pipelineDescription);
 
-    resourceUpload.End(commandQueue);
+    auto uploadResourcesFinished = resourceUpload.End(commandQueue);
+    uploadResourcesFinished.wait();
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
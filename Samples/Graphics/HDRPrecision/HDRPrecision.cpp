@@ -530,7 +530,8 @@ void Sample::CreateFormatDependantResources()
         auto backBufferRts = RenderTargetState(HDRBackBufferFormat[m_currentBackBufferFormat], m_deviceResources->GetDepthBufferFormat());
         auto spritePSD = SpriteBatchPipelineStateDescription(backBufferRts, &CommonStates::AlphaBlend);
         m_spriteBatch = std::make_unique<SpriteBatch>(device, resourceUpload, spritePSD);
-        resourceUpload.End(m_deviceResources->GetCommandQueue());
+        auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+        uploadResourcesFinished.wait();
     }
 
     auto const size = m_deviceResources->GetOutputSize();
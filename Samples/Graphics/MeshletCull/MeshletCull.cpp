@@ -899,7 +899,8 @@ void Sample::CreateDeviceDependentResources()
         DX::ThrowIfFailed(CreateDDSTextureFromFile(device, resourceUpload, strFilePath, &m_crosshair));
         device->CreateShaderResourceView(m_crosshair.Get(), nullptr, m_srvPile->GetCpuHandle(SRV_Crosshair));
 
-        resourceUpload.End(m_deviceResources->GetCommandQueue());
+        auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+        uploadResourcesFinished.wait();
     }
 
     // Instantiate scene objects, effects, and create per-object constant buffers
@@ -471,7 +471,8 @@ void Sample::CreateDeviceDependentResources()
 
         m_hudBatch = std::make_unique<SpriteBatch>(device, resourceUpload, spritePSD);
 
-        resourceUpload.End(m_deviceResources->GetCommandQueue());
+        auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+        uploadResourcesFinished.wait();
     }
 
     TryEnableHDR();
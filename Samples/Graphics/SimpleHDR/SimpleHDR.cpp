@@ -350,7 +350,8 @@ void Sample::CreateWindowSizeDependentResources()
         auto backBufferRts = RenderTargetState(g_hdrBackBufferFormat, m_deviceResources->GetDepthBufferFormat());
         auto spritePSD = SpriteBatchPipelineStateDescription(backBufferRts, &CommonStates::AlphaBlend);
         m_spriteBatch = std::make_unique<SpriteBatch>(device, resourceUpload, spritePSD);
-        resourceUpload.End(m_deviceResources->GetCommandQueue());
+        auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+        uploadResourcesFinished.wait();
     }
 
     // Create the HDR scene render target
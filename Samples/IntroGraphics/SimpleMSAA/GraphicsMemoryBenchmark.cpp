@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// GraphicsMemoryBenchmark.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "GraphicsMemoryBenchmark.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+    double TimeAllocations(GraphicsMemory& graphicsMemory, uint32_t threadCount, uint32_t allocationsPerThread)
+    {
+        std::atomic<uint32_t> ready(0);
+        std::atomic<bool> go(false);
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+
+        for (uint32_t i = 0; i < threadCount; ++i)
+        {
+            threads.emplace_back([&]()
+            {
+                XMFLOAT4X4 transform;
+                XMStoreFloat4x4(&transform, XMMatrixIdentity());
+
+                // Start every thread together so they contend for the allocator
+                ++ready;
+                while (!go)
+                {
+                    std::this_thread::yield();
+                }
+
+                for (uint32_t j = 0; j < allocationsPerThread; ++j)
+                {
+                    auto constants = graphicsMemory.AllocateConstant(transform);
+                }
+            });
+        }
+
+        while (ready < threadCount)
+        {
+            std::this_thread::yield();
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+        go = true;
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    }
+}
+
+GraphicsMemoryBenchmark::Results GraphicsMemoryBenchmark::Run(
+    GraphicsMemory& graphicsMemory,
+    uint32_t maxThreadCount,
+    uint32_t allocationsPerThread)
+{
+    Results results = {};
+    results.allocationsPerThread = allocationsPerThread;
+
+    maxThreadCount = std::max(maxThreadCount, 1u);
+
+    for (uint32_t threadCount = 1; results.runCount < c_maxRuns; threadCount *= 2)
+    {
+        // Always finish with a run on every thread
+        threadCount = std::min(threadCount, maxThreadCount);
+
+        const double elapsedSeconds = TimeAllocations(graphicsMemory, threadCount, allocationsPerThread);
+
+        results.threadCount[results.runCount] = threadCount;
+        results.allocationsPerSecond[results.runCount] = (elapsedSeconds > 0.0)
+            ? double(threadCount) * double(allocationsPerThread) / elapsedSeconds : 0.0;
+        ++results.runCount;
+
+        if (threadCount == maxThreadCount)
+        {
+            break;
+        }
+    }
+
+    return results;
+}
@@ -0,0 +1,31 @@
+//--------------------------------------------------------------------------------------
+// GraphicsMemoryBenchmark.h
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+// Allocates constant buffers from GraphicsMemory on several threads at once, the way
+// threads recording command lists in parallel do, and repeats the run with a doubling
+// thread count to show how allocation throughput scales.
+namespace GraphicsMemoryBenchmark
+{
+    constexpr uint32_t c_maxRuns = 8;
+
+    struct Results
+    {
+        uint32_t runCount;
+        uint32_t allocationsPerThread;
+        uint32_t threadCount[c_maxRuns];
+        double   allocationsPerSecond[c_maxRuns];
+    };
+
+    // Blocks until every run has finished. The allocations are released as they are made, so
+    // their pages are recycled by the GraphicsMemory::Commit of the following frames.
+    Results Run(
+        DirectX::GraphicsMemory& graphicsMemory,
+        uint32_t maxThreadCount,
+        uint32_t allocationsPerThread);
+}
@@ -0,0 +1,58 @@
+//--------------------------------------------------------------------------------------
+// ModelLoadBenchmark.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "ModelLoadBenchmark.h"
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace DirectX;
+
+ModelLoadBenchmark::Results ModelLoadBenchmark::Run(
+    ID3D12Device* device,
+    const uint8_t* meshData,
+    size_t dataSize,
+    IEffectFactory& fxFactory,
+    const EffectPipelineStateDescription& opaquePipelineState,
+    const EffectPipelineStateDescription& alphaPipelineState,
+    uint32_t threadCount,
+    uint32_t modelsPerThread)
+{
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+
+    const auto startTime = std::chrono::steady_clock::now();
+
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        threads.emplace_back([=, &fxFactory]()
+        {
+            for (uint32_t j = 0; j < modelsPerThread; ++j)
+            {
+                auto model = Model::CreateFromSDKMESH(device, meshData, dataSize);
+                auto effects = model->CreateEffects(fxFactory, opaquePipelineState, alphaPipelineState);
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    const double elapsedMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+
+    Results results = {};
+    results.threadCount = threadCount;
+    results.modelCount = threadCount * modelsPerThread;
+    results.elapsedMilliseconds = elapsedMilliseconds;
+    results.modelsPerSecond = (elapsedMilliseconds > 0.0) ? double(results.modelCount) * 1000.0 / elapsedMilliseconds : 0.0;
+
+    return results;
+}
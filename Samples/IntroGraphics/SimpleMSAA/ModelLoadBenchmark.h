@@ -0,0 +1,35 @@
+//--------------------------------------------------------------------------------------
+// ModelLoadBenchmark.h
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+// Loads the same SDKMESH from several threads at once and creates its effects through one
+// shared factory, which is how a streaming system hits the effect cache during level loads.
+// After the first load every effect request is a cache hit, so the result mostly measures
+// the cost of those lookups under contention. Models are parsed from a copy of the file
+// that is already in memory, so disk I/O is not part of the timing.
+namespace ModelLoadBenchmark
+{
+    struct Results
+    {
+        uint32_t threadCount;
+        uint32_t modelCount;
+        double   elapsedMilliseconds;
+        double   modelsPerSecond;
+    };
+
+    // Blocks until every thread has loaded modelsPerThread models.
+    Results Run(
+        _In_ ID3D12Device* device,
+        _In_reads_bytes_(dataSize) const uint8_t* meshData,
+        size_t dataSize,
+        DirectX::IEffectFactory& fxFactory,
+        const DirectX::EffectPipelineStateDescription& opaquePipelineState,
+        const DirectX::EffectPipelineStateDescription& alphaPipelineState,
+        uint32_t threadCount,
+        uint32_t modelsPerThread);
+}
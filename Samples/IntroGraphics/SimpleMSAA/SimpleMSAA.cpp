@@ -10,6 +10,9 @@
 
 #include "ATGColors.h"
 #include "ControllerFont.h"
+#include "ReadData.h"
+
+#include <thread>
 
 extern void ExitSample() noexcept;
 
@@ -28,11 +31,29 @@ namespace
 
     // Xbox supports 2x, 4x, or 8x MSAA
     constexpr unsigned int c_sampleCount = 4;
+
+    void FormatAllocationResults(const GraphicsMemoryBenchmark::Results& results, wchar_t* text, size_t textLength)
+    {
+        int length = swprintf_s(text, textLength, L"Allocations/s by thread count:");
+        for (uint32_t i = 0; i < results.runCount && length > 0; ++i)
+        {
+            const int written = swprintf_s(text + length, textLength - size_t(length), L"  %u: %.1fM",
+                results.threadCount[i], results.allocationsPerSecond[i] / 1000000.0);
+            if (written < 0)
+            {
+                break;
+            }
+
+            length += written;
+        }
+    }
 }
 
 Sample::Sample() noexcept(false) :
     m_msaa(true),
-    m_frame(0)
+    m_frame(0),
+    m_loadBenchmark{},
+    m_allocationBenchmark{}
 {
     unsigned int flags = 0;
 
@@ -56,6 +77,17 @@ Sample::Sample() noexcept(false) :
 
 Sample::~Sample()
 {
+    // The benchmarks use the device, the effect factory and graphics memory
+    if (m_loadBenchmarkTask.valid())
+    {
+        m_loadBenchmarkTask.wait();
+    }
+
+    if (m_allocationBenchmarkTask.valid())
+    {
+        m_allocationBenchmarkTask.wait();
+    }
+
     if (m_deviceResources)
     {
         m_deviceResources->WaitForGpu();
@@ -118,11 +150,24 @@ void Sample::Update(DX::StepTimer const& timer)
         {
             m_msaa = !m_msaa;
         }
+
+        if (m_gamePadButtons.b == GamePad::ButtonStateTracker::PRESSED)
+        {
+            StartLoadBenchmark();
+        }
+
+        if (m_gamePadButtons.x == GamePad::ButtonStateTracker::PRESSED)
+        {
+            StartAllocationBenchmark();
+        }
     }
     else
     {
         m_gamePadButtons.Reset();
     }
+
+    UpdateLoadBenchmark();
+    UpdateAllocationBenchmark();
 }
 #pragma endregion
 
@@ -211,9 +256,37 @@ void Sample::Render()
     swprintf_s(str, L"Sample count: %u", m_msaa ? c_sampleCount : 1);
     m_smallFont->DrawString(m_batch.get(), str, XMFLOAT2(float(safe.left), float(safe.top)), ATG::Colors::White);
 
+    if (m_loadBenchmarkTask.valid())
+    {
+        m_smallFont->DrawString(m_batch.get(), L"Running load benchmark...",
+            XMFLOAT2(float(safe.left), float(safe.top) + m_smallFont->GetLineSpacing()), ATG::Colors::White);
+    }
+    else if (m_loadBenchmark.modelCount > 0)
+    {
+        wchar_t benchmarkStr[128] = {};
+        swprintf_s(benchmarkStr, L"Loaded %u models on %u threads in %.1f ms (%.0f models/s)",
+            m_loadBenchmark.modelCount, m_loadBenchmark.threadCount,
+            m_loadBenchmark.elapsedMilliseconds, m_loadBenchmark.modelsPerSecond);
+        m_smallFont->DrawString(m_batch.get(), benchmarkStr,
+            XMFLOAT2(float(safe.left), float(safe.top) + m_smallFont->GetLineSpacing()), ATG::Colors::White);
+    }
+
+    if (m_allocationBenchmarkTask.valid())
+    {
+        m_smallFont->DrawString(m_batch.get(), L"Running allocation benchmark...",
+            XMFLOAT2(float(safe.left), float(safe.top) + m_smallFont->GetLineSpacing() * 2.f), ATG::Colors::White);
+    }
+    else if (m_allocationBenchmark.runCount > 0)
+    {
+        wchar_t benchmarkStr[256] = {};
+        FormatAllocationResults(m_allocationBenchmark, benchmarkStr, std::size(benchmarkStr));
+        m_smallFont->DrawString(m_batch.get(), benchmarkStr,
+            XMFLOAT2(float(safe.left), float(safe.top) + m_smallFont->GetLineSpacing() * 2.f), ATG::Colors::White);
+    }
+
     DX::DrawControllerString(m_batch.get(),
         m_smallFont.get(), m_ctrlFont.get(),
-        L"[A] Toggle MSAA   [View] Exit",
+        L"[A] Toggle MSAA   [B] Load benchmark   [X] Allocation benchmark   [View] Exit",
         XMFLOAT2(float(safe.left),
         float(safe.bottom) - m_smallFont->GetLineSpacing()),
         ATG::Colors::LightGrey);
@@ -381,6 +454,98 @@ void Sample::CreateDeviceDependentResources()
     }
 }
 
+// Loads the scene model from every hardware thread at once, creating its effects through the
+// shared factory, to measure how the effect cache holds up under parallel loading. The run
+// happens on a background task so the sample keeps rendering meanwhile.
+void Sample::StartLoadBenchmark()
+{
+    if (m_loadBenchmarkTask.valid())
+    {
+        return;
+    }
+
+    const RenderTargetState rtState(c_backBufferFormat, c_depthBufferFormat);
+
+    EffectPipelineStateDescription pd(
+        nullptr,
+        CommonStates::Opaque,
+        CommonStates::DepthDefault,
+        CommonStates::CullClockwise,
+        rtState);
+
+    EffectPipelineStateDescription pdAlpha(
+        nullptr,
+        CommonStates::AlphaBlend,
+        CommonStates::DepthDefault,
+        CommonStates::CullClockwise,
+        rtState);
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    auto device = m_deviceResources->GetD3DDevice();
+    auto fxFactory = m_fxFactory.get();
+
+    m_loadBenchmarkTask = std::async(std::launch::async, [=]()
+    {
+        // Read the file up front so the timing only covers parsing and the effect cache
+        const auto meshData = DX::ReadData(L"CityBlockConcrete.sdkmesh");
+
+        return ModelLoadBenchmark::Run(device, meshData.data(), meshData.size(),
+            *fxFactory, pd, pdAlpha, threadCount, 16);
+    });
+}
+
+void Sample::UpdateLoadBenchmark()
+{
+    if (!m_loadBenchmarkTask.valid()
+        || m_loadBenchmarkTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    m_loadBenchmark = m_loadBenchmarkTask.get();
+
+    wchar_t str[128] = {};
+    swprintf_s(str, L"Load benchmark: %u models on %u threads in %.1f ms (%.0f models/s)\n",
+        m_loadBenchmark.modelCount, m_loadBenchmark.threadCount,
+        m_loadBenchmark.elapsedMilliseconds, m_loadBenchmark.modelsPerSecond);
+    OutputDebugStringW(str);
+}
+
+// Allocates constant buffers from GraphicsMemory on a growing number of threads while the
+// sample keeps rendering and committing frames, to show how the per-thread page caches scale.
+void Sample::StartAllocationBenchmark()
+{
+    if (m_allocationBenchmarkTask.valid())
+    {
+        return;
+    }
+
+    const uint32_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+    auto graphicsMemory = m_graphicsMemory.get();
+
+    m_allocationBenchmarkTask = std::async(std::launch::async, [=]()
+    {
+        return GraphicsMemoryBenchmark::Run(*graphicsMemory, threadCount, 20000);
+    });
+}
+
+void Sample::UpdateAllocationBenchmark()
+{
+    if (!m_allocationBenchmarkTask.valid()
+        || m_allocationBenchmarkTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        return;
+    }
+
+    m_allocationBenchmark = m_allocationBenchmarkTask.get();
+
+    wchar_t str[256] = {};
+    FormatAllocationResults(m_allocationBenchmark, str, std::size(str));
+    OutputDebugStringW(str);
+    OutputDebugStringW(L"\n");
+}
+
 // Allocate all memory resources that change on a window SizeChanged event.
 void Sample::CreateWindowSizeDependentResources()
 {
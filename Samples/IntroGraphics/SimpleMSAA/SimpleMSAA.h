@@ -8,6 +8,8 @@
 #pragma once
 
 #include "DeviceResources.h"
+#include "GraphicsMemoryBenchmark.h"
+#include "ModelLoadBenchmark.h"
 #include "StepTimer.h"
 
 
@@ -48,6 +50,12 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void StartLoadBenchmark();
+    void UpdateLoadBenchmark();
+
+    void StartAllocationBenchmark();
+    void UpdateAllocationBenchmark();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>            m_deviceResources;
 
@@ -93,6 +101,12 @@ private:
     DirectX::Model::EffectCollection                m_modelMSAA;
     DirectX::Model::EffectCollection                m_modelStandard;
 
+    ModelLoadBenchmark::Results                     m_loadBenchmark;
+    std::future<ModelLoadBenchmark::Results>        m_loadBenchmarkTask;
+
+    GraphicsMemoryBenchmark::Results                m_allocationBenchmark;
+    std::future<GraphicsMemoryBenchmark::Results>   m_allocationBenchmarkTask;
+
     DirectX::SimpleMath::Matrix                     m_world;
     DirectX::SimpleMath::Matrix                     m_view;
     DirectX::SimpleMath::Matrix                     m_proj;
@@ -325,7 +325,8 @@ void Sample::CreateDeviceDependentResources()
         m_srvPile->GetCpuHandle(DescriptorHeapIndex::SRV_CtrlFont),
         m_srvPile->GetGpuHandle(DescriptorHeapIndex::SRV_CtrlFont));
 
-    resourceUpload.End(m_deviceResources->GetCommandQueue());
+    auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
+    uploadResourcesFinished.wait();
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
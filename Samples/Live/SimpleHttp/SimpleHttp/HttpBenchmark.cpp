@@ -0,0 +1,341 @@
+//--------------------------------------------------------------------------------------
+// HttpBenchmark.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#include "pch.h"
+#include "HttpBenchmark.h"
+
+#include "HttpManager.h"
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <chrono>
+
+#pragma comment(lib, "ws2_32.lib")
+
+namespace
+{
+    const char c_response[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: 2\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+        "OK";
+
+    const char c_requestTerminator[] = "\r\n\r\n";
+
+    using Clock = std::chrono::steady_clock;
+
+    double Percentile(const std::vector<double>& sortedValues, uint32_t percentile)
+    {
+        if (sortedValues.empty())
+        {
+            return 0.0;
+        }
+
+        // Nearest rank
+        size_t rank = (sortedValues.size() * percentile + 99) / 100;
+        return sortedValues[std::max<size_t>(rank, 1) - 1];
+    }
+}
+
+HttpBenchmark::HttpBenchmark() :
+    m_running(false),
+    m_listenSocket(INVALID_SOCKET),
+    m_port(0),
+    m_serverStopping(false),
+    m_winsockInitialized(false),
+    m_results{},
+    m_resultsReady(false)
+{
+}
+
+HttpBenchmark::~HttpBenchmark()
+{
+    if (m_clientThread.joinable())
+    {
+        m_clientThread.join();
+    }
+
+    StopServer();
+
+    if (m_winsockInitialized)
+    {
+        WSACleanup();
+    }
+}
+
+bool HttpBenchmark::Start(uint32_t requestCount, uint32_t concurrency)
+{
+    if (m_running || requestCount == 0 || concurrency == 0)
+    {
+        return false;
+    }
+
+    if (m_clientThread.joinable())
+    {
+        m_clientThread.join();
+    }
+
+    if (m_listenSocket == INVALID_SOCKET && !StartServer())
+    {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultsMutex);
+        m_resultsReady = false;
+    }
+
+    m_running = true;
+    m_clientThread = std::thread(&HttpBenchmark::ClientThread, this, requestCount, concurrency);
+
+    return true;
+}
+
+bool HttpBenchmark::TryGetResults(Results& results)
+{
+    std::lock_guard<std::mutex> lock(m_resultsMutex);
+
+    if (!m_resultsReady)
+    {
+        return false;
+    }
+
+    results = m_results;
+    m_resultsReady = false;
+
+    return true;
+}
+
+bool HttpBenchmark::StartServer()
+{
+    if (!m_winsockInitialized)
+    {
+        WSADATA wsaData = {};
+        if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        {
+            return false;
+        }
+
+        m_winsockInitialized = true;
+    }
+
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listenSocket == INVALID_SOCKET)
+    {
+        return false;
+    }
+
+    // Let the system pick a free port
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = 0;
+
+    int addressLength = sizeof(address);
+
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR
+        || listen(listenSocket, SOMAXCONN) == SOCKET_ERROR
+        || getsockname(listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength) == SOCKET_ERROR)
+    {
+        closesocket(listenSocket);
+        return false;
+    }
+
+    m_listenSocket = listenSocket;
+    m_port = ntohs(address.sin_port);
+    m_serverStopping = false;
+    m_serverThread = std::thread(&HttpBenchmark::ServerThread, this);
+
+    return true;
+}
+
+void HttpBenchmark::StopServer()
+{
+    if (m_listenSocket == INVALID_SOCKET)
+    {
+        return;
+    }
+
+    m_serverStopping = true;
+
+    // Closing the sockets unblocks accept() and recv()
+    closesocket(static_cast<SOCKET>(m_listenSocket));
+    m_serverThread.join();
+
+    std::vector<std::thread> connectionThreads;
+    {
+        std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+        for (uintptr_t connection : m_connections)
+        {
+            shutdown(static_cast<SOCKET>(connection), SD_BOTH);
+        }
+
+        connectionThreads.swap(m_connectionThreads);
+    }
+
+    for (auto& connectionThread : connectionThreads)
+    {
+        connectionThread.join();
+    }
+
+    m_connections.clear();
+    m_listenSocket = INVALID_SOCKET;
+}
+
+void HttpBenchmark::ServerThread()
+{
+    while (!m_serverStopping)
+    {
+        SOCKET connection = accept(static_cast<SOCKET>(m_listenSocket), nullptr, nullptr);
+        if (connection == INVALID_SOCKET)
+        {
+            continue;
+        }
+
+        int noDelay = 1;
+        setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&noDelay), sizeof(noDelay));
+
+        std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+        if (m_serverStopping)
+        {
+            closesocket(connection);
+            break;
+        }
+
+        m_connections.push_back(connection);
+        m_connectionThreads.emplace_back(&HttpBenchmark::ConnectionThread, this, static_cast<uintptr_t>(connection));
+    }
+}
+
+void HttpBenchmark::ConnectionThread(uintptr_t connection)
+{
+    const SOCKET clientSocket = static_cast<SOCKET>(connection);
+
+    std::string pending;
+    char buffer[4096];
+
+    for (;;)
+    {
+        int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+        if (received <= 0)
+        {
+            break;
+        }
+
+        pending.append(buffer, static_cast<size_t>(received));
+
+        // Answer every complete request in the buffer; the benchmark only sends GETs, so a
+        // request ends at the blank line after its headers.
+        size_t requestEnd;
+        bool failed = false;
+        while (!failed && (requestEnd = pending.find(c_requestTerminator)) != std::string::npos)
+        {
+            pending.erase(0, requestEnd + sizeof(c_requestTerminator) - 1);
+            failed = send(clientSocket, c_response, sizeof(c_response) - 1, 0) == SOCKET_ERROR;
+        }
+
+        if (failed)
+        {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_connectionMutex);
+
+    auto it = std::find(m_connections.begin(), m_connections.end(), connection);
+    if (it != m_connections.end())
+    {
+        m_connections.erase(it);
+    }
+
+    closesocket(clientSocket);
+}
+
+void HttpBenchmark::ClientThread(uint32_t requestCount, uint32_t concurrency)
+{
+    HttpManager httpManager;
+
+    const std::string url = "http://127.0.0.1:" + std::to_string(m_port) + "/benchmark";
+    const std::vector<HttpHeader> headers;
+
+    std::vector<double> latencies;
+    latencies.reserve(requestCount);
+
+    uint32_t issued = 0;
+    uint32_t completed = 0;
+    uint32_t failed = 0;
+
+    auto issueRequest = [&]()
+    {
+        const Clock::time_point sendTime = Clock::now();
+
+        HRESULT hr = httpManager.MakeHttpRequestAsync(nullptr, "GET", url, headers, nullptr, 0,
+            [&, sendTime](HttpRequestContext* context)
+            {
+                latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sendTime).count());
+
+                if (context->responseStatusCode != 200)
+                {
+                    ++failed;
+                }
+
+                ++completed;
+            });
+
+        ++issued;
+
+        if (hr != E_PENDING && FAILED(hr))
+        {
+            ++failed;
+            ++completed;
+        }
+    };
+
+    const Clock::time_point startTime = Clock::now();
+
+    while (completed < requestCount)
+    {
+        // Keep the pipeline full
+        while (issued < requestCount && issued - completed < concurrency)
+        {
+            issueRequest();
+        }
+
+        httpManager.Update();
+
+        if (completed < requestCount)
+        {
+            httpManager.WaitForActivity(10);
+        }
+    }
+
+    const double elapsedSeconds = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+    std::sort(latencies.begin(), latencies.end());
+
+    Results results = {};
+    results.requestCount = requestCount;
+    results.failedCount = failed;
+    results.elapsedSeconds = elapsedSeconds;
+    results.requestsPerSecond = (elapsedSeconds > 0.0) ? double(requestCount) / elapsedSeconds : 0.0;
+    results.p50LatencyMs = Percentile(latencies, 50);
+    results.p99LatencyMs = Percentile(latencies, 99);
+    results.maxLatencyMs = latencies.empty() ? 0.0 : latencies.back();
+
+    {
+        std::lock_guard<std::mutex> lock(m_resultsMutex);
+        m_results = results;
+        m_resultsReady = true;
+    }
+
+    m_running = false;
+}
@@ -0,0 +1,79 @@
+//--------------------------------------------------------------------------------------
+// HttpBenchmark.h
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Drives a large number of requests through an HttpManager against a minimal HTTP/1.1
+// server on the loopback interface, so that the cost of the request pipeline itself can
+// be measured without the network getting in the way.
+//
+// The server is plaintext HTTP/1.1, so this measures easy handle pooling, connection reuse
+// and multi handle overhead. It does not exercise HTTP/2 multiplexing, which XCurl only
+// negotiates over TLS.
+//
+// The benchmark runs on its own thread with its own HttpManager, so the sample only needs
+// to poll TryGetResults() from its update loop. HttpManager reference counts the XCurl
+// global state, so this is safe while the sample's own manager is alive.
+class HttpBenchmark
+{
+public:
+    struct Results
+    {
+        uint32_t requestCount;
+        uint32_t failedCount;
+        double   elapsedSeconds;
+        double   requestsPerSecond;
+        double   p50LatencyMs;
+        double   p99LatencyMs;
+        double   maxLatencyMs;
+    };
+
+    HttpBenchmark();
+    ~HttpBenchmark();
+
+    HttpBenchmark(const HttpBenchmark&) = delete;
+    HttpBenchmark& operator=(const HttpBenchmark&) = delete;
+
+    // Starts the loopback server and issues requestCount GET requests, keeping up to
+    // concurrency of them in flight. Returns false if a run is already in progress or the
+    // server could not be started.
+    bool Start(uint32_t requestCount, uint32_t concurrency);
+
+    bool IsRunning() const { return m_running; }
+
+    // Returns true once, when a run has finished.
+    bool TryGetResults(Results& results);
+
+private:
+    bool StartServer();
+    void StopServer();
+    void ServerThread();
+    void ConnectionThread(uintptr_t connection);
+    void ClientThread(uint32_t requestCount, uint32_t concurrency);
+
+    std::atomic<bool>           m_running;
+    std::thread                 m_clientThread;
+
+    // Loopback server
+    uintptr_t                   m_listenSocket;
+    uint16_t                    m_port;
+    std::atomic<bool>           m_serverStopping;
+    std::thread                 m_serverThread;
+    std::mutex                  m_connectionMutex;
+    std::vector<uintptr_t>      m_connections;
+    std::vector<std::thread>    m_connectionThreads;
+    bool                        m_winsockInitialized;
+
+    std::mutex                  m_resultsMutex;
+    Results                     m_results;
+    bool                        m_resultsReady;
+};
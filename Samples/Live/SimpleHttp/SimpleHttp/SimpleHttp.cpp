@@ -36,6 +36,10 @@ namespace
     const char* c_xblWebAddress = "https://profile.xboxlive.com/users/me/profile/settings?settings=GameDisplayName";
     const char* c_gameServiceAddress = "https://" MY_HOST "/api/getclaims";
 
+    // Loopback benchmark size
+    const uint32_t c_benchmarkRequestCount = 5000;
+    const uint32_t c_benchmarkConcurrency = 32;
+
     // Other endpoints that you can call from this client side sample
     // see the documentation for the Game Service Sample for more details
     /*
@@ -161,6 +165,7 @@ void Sample::Initialize(HWND window, int width, int height)
     m_httpRequestButton = m_uiManager.FindTypedById<UIButton>(ID("HttpRequestButton"));
     m_xblRequestButton = m_uiManager.FindTypedById<UIButton>(ID("XBLRequestButton"));
     m_gameServiceRequestButton = m_uiManager.FindTypedById<UIButton>(ID("GameServiceRequestButton"));
+    m_benchmarkButton = m_uiManager.FindTypedById<UIButton>(ID("BenchmarkButton"));
     m_exitButton = m_uiManager.FindTypedById<UIButton>(ID("ExitButton"));
 
     m_httpRequestButton->SetEnabled(false);
@@ -230,6 +235,11 @@ void Sample::InitializeUIEventHandlers()
         OnGameServiceRequestButtonPressed();
     });
 
+    m_benchmarkButton->ButtonState().AddListenerWhen(UIButton::State::Pressed, [this](UIButton*)
+    {
+        OnBenchmarkButtonPressed();
+    });
+
     m_exitButton->ButtonState().AddListenerWhen(UIButton::State::Pressed, [](UIButton*)
     {
         ExitSample();
@@ -364,6 +374,26 @@ void Sample::OnGameServiceRequestButtonPressed()
     }
 }
 
+void Sample::OnBenchmarkButtonPressed()
+{
+    Log("Sample::OnBenchmarkButtonPressed:\n");
+
+    if (m_httpBenchmark.IsRunning())
+    {
+        Log("Benchmark already running.");
+        return;
+    }
+
+    if (m_httpBenchmark.Start(c_benchmarkRequestCount, c_benchmarkConcurrency))
+    {
+        Log("Sending %u requests to a loopback server, %u at a time...", c_benchmarkRequestCount, c_benchmarkConcurrency);
+    }
+    else
+    {
+        Log("Sample::OnBenchmarkButtonPressed: failed to start the loopback server");
+    }
+}
+
 #pragma region Frame Update
 // Executes basic render loop.
 void Sample::Tick()
@@ -454,6 +484,14 @@ void Sample::Update(DX::StepTimer const& timer)
         m_httpManager->Update();
     }
 
+    HttpBenchmark::Results benchmarkResults;
+    if (m_httpBenchmark.TryGetResults(benchmarkResults))
+    {
+        Log("Benchmark: %u requests (%u failed) in %.2f s", benchmarkResults.requestCount, benchmarkResults.failedCount, benchmarkResults.elapsedSeconds);
+        Log("    %.0f requests/s, latency p50 %.3f ms, p99 %.3f ms, max %.3f ms",
+            benchmarkResults.requestsPerSecond, benchmarkResults.p50LatencyMs, benchmarkResults.p99LatencyMs, benchmarkResults.maxLatencyMs);
+    }
+
     PIXEndEvent();
 }
 #pragma endregion
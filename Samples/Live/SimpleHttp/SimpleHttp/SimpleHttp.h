@@ -14,6 +14,7 @@
 #include "UITK.h"
 #include "Debug.h"
 #include "AsyncStatusWidget.h"
+#include "HttpBenchmark.h"
 
 #pragma warning( disable : 4100 )
 
@@ -110,6 +111,7 @@ private:
     void OnHttpRequestButtonPressed();
     void OnXBLRequestButtonPressed();
     void OnGameServiceRequestButtonPressed();
+    void OnBenchmarkButtonPressed();
 
     // Device resources.
     std::unique_ptr<DX::DeviceResources>        m_deviceResources;
@@ -143,6 +145,7 @@ private:
     std::shared_ptr<ATG::UITK::UIButton> m_httpRequestButton;
     std::shared_ptr<ATG::UITK::UIButton> m_xblRequestButton;
     std::shared_ptr<ATG::UITK::UIButton> m_gameServiceRequestButton;
+    std::shared_ptr<ATG::UITK::UIButton> m_benchmarkButton;
     std::shared_ptr<ATG::UITK::UIButton> m_exitButton;
     std::unique_ptr<AsyncOpWidget> m_asyncOpWidget;
 
@@ -153,6 +156,8 @@ private:
     };
 
     class HttpManager* m_httpManager = nullptr;
+
+    HttpBenchmark m_httpBenchmark;
 };
 
 
@@ -7,55 +7,278 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "RDTSCPStopWatch.h"
 
 namespace ATG
 {
 
+// Log-linear latency histogram layout over raw RDTSCP ticks, in the style of HdrHistogram. Values below
+// 2 * c_subBucketCount ticks get a bucket each; above that, every power of two is split into c_subBucketCount
+// buckets, so any recorded value is known to within 1/c_subBucketCount (about 1.6%) of itself.
+struct LatencyBuckets
+{
+    static constexpr unsigned int c_subBucketBits = 6;
+    static constexpr unsigned int c_subBucketCount = 1u << c_subBucketBits;
+
+    // Values from 2^(c_maxExponent + 1) ticks up (over 20 minutes at typical clock rates) share the last bucket
+    static constexpr unsigned int c_maxExponent = 42;
+    static constexpr unsigned int c_bucketCount = (c_maxExponent - c_subBucketBits + 2) * c_subBucketCount;
+
+    static unsigned int GetIndex(uint64_t ticks)
+    {
+        if (ticks < 2 * c_subBucketCount)
+        {
+            return static_cast<unsigned int>(ticks);
+        }
+
+        unsigned long exponent;
+        _BitScanReverse64(&exponent, ticks);
+        if (exponent > c_maxExponent)
+        {
+            return c_bucketCount - 1;
+        }
+
+        const unsigned int shift = exponent - c_subBucketBits;
+        return shift * c_subBucketCount + static_cast<unsigned int>(ticks >> shift);
+    }
+
+    static uint64_t GetLowerBound(unsigned int index)
+    {
+        if (index < 2 * c_subBucketCount)
+        {
+            return index;
+        }
+
+        const unsigned int shift = index / c_subBucketCount - 1;
+        return static_cast<uint64_t>(index % c_subBucketCount + c_subBucketCount) << shift;
+    }
+
+    static uint64_t GetWidth(unsigned int index)
+    {
+        return (index < 2 * c_subBucketCount) ? 1 : (uint64_t(1) << (index / c_subBucketCount - 1));
+    }
+};
+
+// Merged view of a TimingAccumulator's samples at one point in time. Times are returned in seconds.
+struct LatencySnapshot
+{
+    LatencySnapshot()
+        : m_count(0)
+        , m_totalTicks(0)
+        , m_minTicks(0)
+        , m_maxTicks(0)
+        , m_buckets(LatencyBuckets::c_bucketCount, 0)
+    {
+    }
+
+    double GetAverage() const
+    {
+        return m_count ? TicksToSeconds(static_cast<double>(m_totalTicks) / static_cast<double>(m_count)) : 0.0;
+    }
+
+    double GetMin() const { return TicksToSeconds(static_cast<double>(m_minTicks)); }
+    double GetMax() const { return TicksToSeconds(static_cast<double>(m_maxTicks)); }
+
+    // Returns the value below which the given percentage (0-100) of samples fall, to within the bucket precision.
+    double GetPercentile(double percentile) const
+    {
+        if (m_count == 0)
+        {
+            return 0.0;
+        }
+
+        uint64_t target = static_cast<uint64_t>(percentile / 100.0 * static_cast<double>(m_count) + 0.5);
+        target = target < 1 ? 1 : (target > m_count ? m_count : target);
+
+        uint64_t seen = 0;
+        for (unsigned int index = 0; index < LatencyBuckets::c_bucketCount; ++index)
+        {
+            seen += m_buckets[index];
+            if (seen >= target)
+            {
+                // Report the middle of the bucket, kept within the exact range that was recorded
+                double ticks = static_cast<double>(LatencyBuckets::GetLowerBound(index)) + static_cast<double>(LatencyBuckets::GetWidth(index) - 1) * 0.5;
+                ticks = ticks < static_cast<double>(m_minTicks) ? static_cast<double>(m_minTicks) : ticks;
+                ticks = ticks > static_cast<double>(m_maxTicks) ? static_cast<double>(m_maxTicks) : ticks;
+                return TicksToSeconds(ticks);
+            }
+        }
+
+        return GetMax();
+    }
+
+    static double TicksToSeconds(double ticks)
+    {
+        return ticks / s_rdtscpFrequencySecs;
+    }
+
+    uint64_t                m_count;
+    uint64_t                m_totalTicks;
+    uint64_t                m_minTicks;
+    uint64_t                m_maxTicks;
+    std::vector<uint64_t>   m_buckets;
+};
+
 template<unsigned int numLabels, unsigned int numDuplicates = 1>
 class StopwatchProfiler
 {
 public:
 
+    // Collects timings into one histogram per recording thread, so pushing a sample never takes a lock or
+    // touches memory written by another thread. The histograms are merged when the results are read.
     struct TimingAccumulator
     {
         TimingAccumulator()
-            : m_curTotal(0.0)
-            , m_lowestVal(999999.999999)
-            , m_highestVal(0.0)
-            , m_curElements(0)
+            : m_threads(nullptr)
         {
-            InitializeCriticalSection(&m_critSection);
         }
 
         ~TimingAccumulator()
         {
-            DeleteCriticalSection(&m_critSection);
+            ThreadHistogram* histogram = m_threads.load(std::memory_order_acquire);
+            while (histogram)
+            {
+                ThreadHistogram* next = histogram->m_next;
+                delete histogram;
+                histogram = next;
+            }
         }
 
-        void PushValue(double value)
+        TimingAccumulator(const TimingAccumulator&) = delete;
+        TimingAccumulator& operator=(const TimingAccumulator&) = delete;
+
+        void PushValue(double seconds)
         {
-            // This is scope locked to ensure proper data. The timing of this function should not matter as it's only important that
-            // the number being passed to this function was as accurate as possible.
-            EnterCriticalSection(&m_critSection);
-            ++m_curElements;
-            m_curTotal += value;
-            m_lowestVal = value < m_lowestVal ? value : m_lowestVal;
-            m_highestVal = value > m_highestVal ? value : m_highestVal;
-            LeaveCriticalSection(&m_critSection);
+            const double ticks = seconds * s_rdtscpFrequencySecs + 0.5;
+            PushTicks(ticks > 0.0 ? static_cast<uint64_t>(ticks) : 0);
+        }
+
+        // Wait-free once the calling thread has pushed its first sample to this accumulator
+        void PushTicks(uint64_t ticks)
+        {
+            GetThreadHistogram()->Record(ticks);
+        }
+
+        // Merges all threads' samples. Samples pushed while this runs may or may not be included.
+        LatencySnapshot GetSnapshot() const
+        {
+            LatencySnapshot snapshot;
+            snapshot.m_minTicks = UINT64_MAX;
+
+            for (const ThreadHistogram* histogram = m_threads.load(std::memory_order_acquire); histogram; histogram = histogram->m_next)
+            {
+                const uint64_t count = histogram->m_count.load(std::memory_order_acquire);
+                if (count == 0)
+                {
+                    continue;
+                }
+
+                snapshot.m_count += count;
+                snapshot.m_totalTicks += histogram->m_totalTicks.load(std::memory_order_relaxed);
+
+                const uint64_t minTicks = histogram->m_minTicks.load(std::memory_order_relaxed);
+                const uint64_t maxTicks = histogram->m_maxTicks.load(std::memory_order_relaxed);
+                snapshot.m_minTicks = minTicks < snapshot.m_minTicks ? minTicks : snapshot.m_minTicks;
+                snapshot.m_maxTicks = maxTicks > snapshot.m_maxTicks ? maxTicks : snapshot.m_maxTicks;
+
+                for (unsigned int index = 0; index < LatencyBuckets::c_bucketCount; ++index)
+                {
+                    snapshot.m_buckets[index] += histogram->m_buckets[index].load(std::memory_order_relaxed);
+                }
+            }
+
+            if (snapshot.m_count == 0)
+            {
+                snapshot.m_minTicks = 0;
+            }
+
+            return snapshot;
         }
 
         double GetAverage(void) const
         {
-            return m_curTotal / static_cast<double>(m_curElements);
+            return GetSnapshot().GetAverage();
         }
 
-        double              m_curTotal;
-        double              m_lowestVal;
-        double              m_highestVal;
-        unsigned int        m_curElements;
+    private:
+
+        // Only the owning thread writes these, so updates are plain load/store pairs rather than read-modify-writes.
+        // They are atomics so that readers can merge at any time without seeing torn values.
+        struct ThreadHistogram
+        {
+            explicit ThreadHistogram(DWORD threadId)
+                : m_threadId(threadId)
+                , m_next(nullptr)
+                , m_count(0)
+                , m_totalTicks(0)
+                , m_minTicks(UINT64_MAX)
+                , m_maxTicks(0)
+                , m_buckets(new std::atomic<uint64_t>[LatencyBuckets::c_bucketCount]())
+            {
+            }
+
+            ThreadHistogram(const ThreadHistogram&) = delete;
+            ThreadHistogram& operator=(const ThreadHistogram&) = delete;
+
+            void Record(uint64_t ticks)
+            {
+                std::atomic<uint64_t>& bucket = m_buckets[LatencyBuckets::GetIndex(ticks)];
+                bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+                m_totalTicks.store(m_totalTicks.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+                if (ticks < m_minTicks.load(std::memory_order_relaxed))
+                {
+                    m_minTicks.store(ticks, std::memory_order_relaxed);
+                }
+                if (ticks > m_maxTicks.load(std::memory_order_relaxed))
+                {
+                    m_maxTicks.store(ticks, std::memory_order_relaxed);
+                }
+
+                // Published last, so a reader that sees the count also sees the sample
+                m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            const DWORD                                 m_threadId;
+            ThreadHistogram*                            m_next;
+            std::atomic<uint64_t>                       m_count;
+            std::atomic<uint64_t>                       m_totalTicks;
+            std::atomic<uint64_t>                       m_minTicks;
+            std::atomic<uint64_t>                       m_maxTicks;
+            std::unique_ptr<std::atomic<uint64_t>[]>    m_buckets;
+        };
+
+        ThreadHistogram* GetThreadHistogram()
+        {
+            // Histograms are only ever added at the head, so a short walk finds this thread's entry without any locking.
+            // A reused thread id picks up the histogram of the exited thread, which no longer writes to it.
+            const DWORD threadId = GetCurrentThreadId();
+            ThreadHistogram* head = m_threads.load(std::memory_order_acquire);
+            for (ThreadHistogram* histogram = head; histogram; histogram = histogram->m_next)
+            {
+                if (histogram->m_threadId == threadId)
+                {
+                    return histogram;
+                }
+            }
+
+            ThreadHistogram* histogram = new ThreadHistogram(threadId);
+            histogram->m_next = head;
+            while (!m_threads.compare_exchange_weak(histogram->m_next, histogram, std::memory_order_release, std::memory_order_acquire))
+            {
+            }
+
+            return histogram;
+        }
 
-        CRITICAL_SECTION    m_critSection;
+        std::atomic<ThreadHistogram*>   m_threads;
     };
 
 public:
@@ -97,11 +320,91 @@ public:
     FORCEINLINE void RecordCurrentTiming(unsigned int label, unsigned int duplicate = 0)
     {
         const unsigned int index = label + duplicate * numLabels;
-        m_accumulators[index].PushValue(m_stopWatches[index].GetCurrentSeconds());
+        m_accumulators[index].PushTicks(m_stopWatches[index].GetCurrentRaw());
+    }
+
+    // Exports the count, average, min, percentiles and max of every label, in microseconds, with a header row.
+    // labelNames is optional and must have numLabels entries; they are written as-is.
+    std::string ExportCSV(const char* const* labelNames = nullptr) const
+    {
+        std::string result = "label,duplicate,count,avg_us,min_us,p50_us,p90_us,p99_us,p99.9_us,max_us\n";
+
+        char buffer[512] = {};
+        char nameBuffer[32] = {};
+        for (unsigned int duplicate = 0; duplicate < numDuplicates; ++duplicate)
+        {
+            for (unsigned int label = 0; label < numLabels; ++label)
+            {
+                ExportValues values(m_accumulators[label + duplicate * numLabels]);
+                sprintf_s(buffer, 512, "%s,%u,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+                    GetLabelName(labelNames, label, nameBuffer), duplicate, values.m_count,
+                    values.m_us[0], values.m_us[1], values.m_us[2], values.m_us[3], values.m_us[4], values.m_us[5], values.m_us[6]);
+                result += buffer;
+            }
+        }
+
+        return result;
+    }
+
+    // Same contents as ExportCSV, as a JSON array with one object per label.
+    std::string ExportJSON(const char* const* labelNames = nullptr) const
+    {
+        std::string result = "[\n";
+
+        char buffer[512] = {};
+        char nameBuffer[32] = {};
+        for (unsigned int duplicate = 0; duplicate < numDuplicates; ++duplicate)
+        {
+            for (unsigned int label = 0; label < numLabels; ++label)
+            {
+                ExportValues values(m_accumulators[label + duplicate * numLabels]);
+                const bool last = (duplicate == numDuplicates - 1) && (label == numLabels - 1);
+                sprintf_s(buffer, 512, "  { \"label\": \"%s\", \"duplicate\": %u, \"count\": %llu, \"avg_us\": %.3f, \"min_us\": %.3f, "
+                    "\"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"p99.9_us\": %.3f, \"max_us\": %.3f }%s\n",
+                    GetLabelName(labelNames, label, nameBuffer), duplicate, values.m_count,
+                    values.m_us[0], values.m_us[1], values.m_us[2], values.m_us[3], values.m_us[4], values.m_us[5], values.m_us[6],
+                    last ? "" : ",");
+                result += buffer;
+            }
+        }
+
+        result += "]\n";
+        return result;
     }
 
 protected:
 
+    struct ExportValues
+    {
+        explicit ExportValues(const TimingAccumulator& accumulator)
+        {
+            const LatencySnapshot snapshot = accumulator.GetSnapshot();
+            m_count = snapshot.m_count;
+            m_us[0] = snapshot.GetAverage() * 1000000.0;
+            m_us[1] = snapshot.GetMin() * 1000000.0;
+            m_us[2] = snapshot.GetPercentile(50.0) * 1000000.0;
+            m_us[3] = snapshot.GetPercentile(90.0) * 1000000.0;
+            m_us[4] = snapshot.GetPercentile(99.0) * 1000000.0;
+            m_us[5] = snapshot.GetPercentile(99.9) * 1000000.0;
+            m_us[6] = snapshot.GetMax() * 1000000.0;
+        }
+
+        unsigned long long  m_count;
+        double              m_us[7];
+    };
+
+    // Formats a fallback name into nameBuffer when no name was given
+    static const char* GetLabelName(const char* const* labelNames, unsigned int label, char (&nameBuffer)[32])
+    {
+        if (labelNames && labelNames[label])
+        {
+            return labelNames[label];
+        }
+
+        sprintf_s(nameBuffer, "label%u", label);
+        return nameBuffer;
+    }
+
     RDTSCPStopWatch     m_stopWatches[numLabels * numDuplicates];
     TimingAccumulator   m_accumulators[numLabels * numDuplicates];
 };
@@ -216,18 +216,30 @@ void XAsyncExamples::LogTiming(StopwatchProfiler<Overhead_Total>::TimingAccumula
 {
     char buffer[512] = {};
 
-    double minTime = 0.0;
-    double maxTime = 0.0;
-    double avgTime = 0.0;
-    const char* minLabel = nullptr;
-    const char* maxLabel = nullptr;
-    const char* avgLabel = nullptr;
-
-    GetFormattedTimingInfo(accumulator->m_lowestVal, &minLabel, &minTime);
-    GetFormattedTimingInfo(accumulator->m_highestVal, &maxLabel, &maxTime);
-    GetFormattedTimingInfo(accumulator->GetAverage(), &avgLabel, &avgTime);
-
-    sprintf_s(buffer, 512, u8"%s: avg:%.3f%s min:%.3f%s max:%.3f%s", prefixLabel, avgTime, avgLabel, minTime, minLabel, maxTime, maxLabel);
+    // Merge the per-thread histograms once for all of the values below
+    const LatencySnapshot snapshot = accumulator->GetSnapshot();
+
+    const double seconds[] =
+    {
+        snapshot.GetAverage(),
+        snapshot.GetMin(),
+        snapshot.GetPercentile(50.0),
+        snapshot.GetPercentile(90.0),
+        snapshot.GetPercentile(99.0),
+        snapshot.GetPercentile(99.9),
+        snapshot.GetMax(),
+    };
+    double times[_countof(seconds)] = {};
+    const char* labels[_countof(seconds)] = {};
+    for (size_t i = 0; i < _countof(seconds); ++i)
+    {
+        GetFormattedTimingInfo(seconds[i], &labels[i], &times[i]);
+    }
+
+    sprintf_s(buffer, 512, u8"%s: n:%llu avg:%.3f%s min:%.3f%s p50:%.3f%s p90:%.3f%s p99:%.3f%s p99.9:%.3f%s max:%.3f%s", prefixLabel,
+        static_cast<unsigned long long>(snapshot.m_count),
+        times[0], labels[0], times[1], labels[1], times[2], labels[2], times[3], labels[3],
+        times[4], labels[4], times[5], labels[5], times[6], labels[6]);
     s_sample->Log(buffer);
 }
 
@@ -1130,6 +1142,25 @@ void XAsyncExamples::StartTest_OverheadCalculations()
             // Overhead_GDKAsyncStyle_WorkToCompletion
             LogTiming(overheadProfiler_DefaultProcessQueue->GetAccumulator(Overhead_GDKAsyncStyle_WorkToCompletion), u8"GDKAsyncStyle_WorkToCompletion (Process Default Task Queue)");
             LogTiming(overheadProfiler_ManualQueue->GetAccumulator(Overhead_GDKAsyncStyle_WorkToCompletion), u8"GDKAsyncStyle_WorkToCompletion (Manual Task Queue)");
+
+            // Full results for offline analysis
+            static const char* const s_overheadNames[] =
+            {
+                "XAsyncRun_InvokeToWork",
+                "XAsyncRun_WorkToCompletion",
+                "ParallelFor_InvokeToBody",
+                "ParallelFor_InvokeToReturn",
+                "GDKAsyncStyle_TimeInProviderAverage",
+                "GDKAsyncStyle_TimeInProviderOverall",
+                "GDKAsyncStyle_InvokeToWork",
+                "GDKAsyncStyle_WorkToCompletion",
+            };
+            static_assert(_countof(s_overheadNames) == Overhead_Total, "Overhead names are out of date");
+
+            OutputDebugStringA("Overhead timings (Process Default Task Queue):\n");
+            OutputDebugStringA(overheadProfiler_DefaultProcessQueue->ExportCSV(s_overheadNames).c_str());
+            OutputDebugStringA("Overhead timings (Manual Task Queue):\n");
+            OutputDebugStringA(overheadProfiler_ManualQueue->ExportCSV(s_overheadNames).c_str());
         });
 
     // Cleanup test
@@ -1210,7 +1241,6 @@ void XAsyncExamples::CalculateOverhead_ParallelFor(StopwatchProfiler<Overhead_To
     // Setup call data
     struct CallContext
     {
-        double timeInvokeToBody;
         StopwatchProfiler<Overhead_Total>* profiler;
         HANDLE completionEvent;
     };
@@ -1220,7 +1250,6 @@ void XAsyncExamples::CalculateOverhead_ParallelFor(StopwatchProfiler<Overhead_To
     for (unsigned int i = startIndex; i < endIndex; ++i)
     {
         CallContext* context = callContexts + (i - startIndex);
-        context->timeInvokeToBody = 0.0;
         context->profiler = &overheadProfiler;
         context->completionEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
         _Analysis_assume_(context->completionEvent != NULL);
@@ -1238,9 +1267,10 @@ void XAsyncExamples::CalculateOverhead_ParallelFor(StopwatchProfiler<Overhead_To
             {
                 CallContext* context = static_cast<CallContext*>(async->context);
 
-                // Store the profiler time instead of tracking it directly since the tracking has a lock and we want the
-                // most accurate timing
-                context->timeInvokeToBody = context->profiler->GetStopWatch(Overhead_ParallelFor_InvokeToBody)->GetCurrentSeconds();
+                // Recording is wait-free and per-thread, so the bodies can push their timings directly without
+                // contending with each other
+                StopwatchProfiler<Overhead_Total>* profiler = context->profiler;
+                profiler->GetAccumulator(Overhead_ParallelFor_InvokeToBody)->PushTicks(profiler->GetStopWatch(Overhead_ParallelFor_InvokeToBody)->GetCurrentRaw());
 
                 return S_OK;
             });
@@ -1252,13 +1282,7 @@ void XAsyncExamples::CalculateOverhead_ParallelFor(StopwatchProfiler<Overhead_To
         WaitForSingleObject(callContexts[i].completionEvent, INFINITE);
     }
 
-    // Record all the Invoke-To-Body times
     overheadProfiler.Stop(Overhead_ParallelFor_InvokeToBody);
-    for (unsigned int i = startIndex; i < endIndex; ++i)
-    {
-        CallContext* context = callContexts + (i - startIndex);
-        overheadProfiler.GetAccumulator(Overhead_ParallelFor_InvokeToBody)->PushValue(context->timeInvokeToBody);
-    }
 
     for (unsigned int i = 0; i < numInvocations; ++i)
     {
@@ -473,7 +473,8 @@ void Sample::CreateDeviceDependentResources()
         m_textureFactory->CreateTexture(path.c_str(), static_cast<int>(TextureDescriptors::CausticFirst) + t);
     }
 
-    m_resourceUploadBatch->End(commandQueue);
+    auto uploadResourcesFinished = m_resourceUploadBatch->End(commandQueue);
+    uploadResourcesFinished.wait();
 
     ////////////////////////////////
     //
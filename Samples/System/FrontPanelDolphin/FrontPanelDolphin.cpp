@@ -454,7 +454,8 @@ void Sample::CreateDeviceDependentResources()
         m_textureFactory->CreateTexture(path.c_str(), static_cast<int>(TextureDescriptors::CausticFirst) + int(t));
     }
 
-    m_resourceUploadBatch->End(commandQueue);
+    auto uploadResourcesFinished = m_resourceUploadBatch->End(commandQueue);
+    uploadResourcesFinished.wait();
 
     ////////////////////////////////
     //
@@ -572,7 +572,8 @@ void Sample::CreateDeviceDependentResources()
     auto styleRenderer = std::make_unique<UIStyleRendererD3D>(*this, 200, os.right, os.bottom);
     m_uiManager.GetStyleManager().InitializeStyleRenderer(std::move(styleRenderer));
 
-    upload.End(commandQueue);
+    auto uploadResourcesFinished = upload.End(commandQueue);
+    uploadResourcesFinished.wait();
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -21,7 +21,8 @@ namespace TextRenderer
         ResourceUploadBatch upload(m_d3dDevice);
         upload.Begin();
         m_spriteBatch = std::make_unique<SpriteBatch>(m_d3dDevice, upload, spritePsoDesc);
-        upload.End(commandQueue);
+        auto uploadResourcesFinished = upload.End(commandQueue);
+        uploadResourcesFinished.wait();
     }
 
     void StringRenderer::CreateWindowSizeDependentResources(D3D12_VIEWPORT viewport)
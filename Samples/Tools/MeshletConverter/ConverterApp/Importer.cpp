@@ -110,7 +110,7 @@ namespace
     }
 }
 
-bool ATG::ImportFile(const char* filename, const ImportOptions& options, std::vector<MeshletSet>& meshlets)
+bool ATG::ImportFile(const char* filename, const ImportOptions& options, MeshletPipeline& pipeline)
 {
     if (!filename)
         return false;
@@ -176,9 +176,9 @@ bool ATG::ImportFile(const char* filename, const ImportOptions& options, std::ve
 
     std::cout << "Found " << meshNodes.size() << " mesh nodes." << std::endl;
 
-    // Extract and meshletize the mesh nodes
-    meshlets.clear();
-
+    // Extract the mesh nodes and hand them off for meshletization. The FBX SDK isn't
+    // thread-safe, so extraction stays on this thread while earlier meshes are processed.
+    size_t submitCount = 0;
 
     FbxTransformer transformer(options.UnitScale, options.FlipZ);
     transformer.Initialize(scene);
@@ -186,17 +186,18 @@ bool ATG::ImportFile(const char* filename, const ImportOptions& options, std::ve
     MeshProcessor processor;
     for (auto& node : meshNodes)
     {
-        MeshletSet result;
-        if (processor.GenerateMeshlets(
+        auto job = std::make_unique<MeshletJob>();
+        if (processor.PrepareMeshletJob(
             node,
             transformer,
             options.MeshletMaxVerts,
             options.MeshletMaxPrims,
             options.FlipTriangles,
             options.Force32BitIndices,
-            result))
+            *job))
         {
-            meshlets.emplace_back(std::move(result));
+            pipeline.Submit(std::move(job));
+            ++submitCount;
         }
         else
         {
@@ -209,10 +210,10 @@ bool ATG::ImportFile(const char* filename, const ImportOptions& options, std::ve
     scene->Destroy();
     manager->Destroy();
 
-    return !meshlets.empty();
+    return submitCount > 0;
 }
 
-bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options, std::vector<MeshletSet>& meshlets)
+bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options, MeshletPipeline& pipeline)
 {
     if (!filename)
         return false;
@@ -235,9 +236,6 @@ bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options,
 
     std::cout << "Processing file \"" << filename << "\"" << std::endl;
 
-    // Extract and meshletize the mesh nodes
-    meshlets.clear();
-
     const uint8_t* meshData = data.get();
     if (!meshData)
     {
@@ -440,6 +438,7 @@ bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options,
     }
 
     // Generate meshlets
+    size_t submitCount = 0;
     for (size_t meshIndex = 0; meshIndex < header->NumMeshes; ++meshIndex)
     {
 
@@ -462,9 +461,9 @@ bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options,
         const auto& ih = ibArray[mh.IndexBuffer];
         auto indices = bufferData + (ih.DataOffset - bufferDataOffset);
 
-        MeshletSet result;
-        MeshProcessor::GenerateMeshlets(
-            result,
+        auto job = std::make_unique<MeshletJob>();
+        MeshProcessor::PrepareMeshletJob(
+            *job,
             options.MeshletMaxVerts,
             options.MeshletMaxPrims,
             verts,
@@ -475,9 +474,9 @@ bool ATG::ImportFileSDKMesh(const char* filename, const ImportOptions& options,
             ibArray[mh.IndexBuffer].IndexType == DXUT::IT_32BIT,
             meshSubsets);
 
-        meshlets.emplace_back(std::move(result));
+        pipeline.Submit(std::move(job));
+        ++submitCount;
     }
 
-
-    return !meshlets.empty();
+    return submitCount > 0;
 }
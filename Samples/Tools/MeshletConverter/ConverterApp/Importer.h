@@ -6,7 +6,7 @@
 //--------------------------------------------------------------------------------------
 #pragma once
 
-#include "MeshletSet.h"
+#include "MeshletPipeline.h"
 #include <vector>
 
 namespace ATG
@@ -20,6 +20,7 @@ namespace ATG
         bool        FlipTriangles;
         bool        Force32BitIndices;
         bool        TriangulateMeshes;
+        uint32_t    MemoryBudgetMB;
 
         ImportOptions(void)
             : MeshletMaxVerts(128)
@@ -29,10 +30,12 @@ namespace ATG
             , FlipTriangles(false)
             , Force32BitIndices(false)
             , TriangulateMeshes(false)
+            , MemoryBudgetMB(4096)
         { }
     };
 
-    // Imports an FBX or OBJ file. Returns whether any meshes were processed.
-    bool ImportFile(const char* filename, const ImportOptions& options, std::vector<MeshletSet>& meshlets);
-    bool ImportFileSDKMesh(const char* filename, const ImportOptions& options, std::vector<MeshletSet>& meshlets);
+    // Imports an FBX or OBJ file, submitting each mesh to the pipeline for meshletization.
+    // Returns whether any meshes were submitted.
+    bool ImportFile(const char* filename, const ImportOptions& options, MeshletPipeline& pipeline);
+    bool ImportFileSDKMesh(const char* filename, const ImportOptions& options, MeshletPipeline& pipeline);
 }
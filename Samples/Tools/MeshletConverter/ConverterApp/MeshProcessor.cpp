@@ -40,61 +40,48 @@ void MeshProcessor::Reset()
     m_vertexData.clear();
 }
 
-bool MeshProcessor::GenerateMeshlets(
+bool MeshProcessor::PrepareMeshletJob(
     FbxNode* node,
     const FbxTransformer& transformer,
     uint32_t meshletMaxVerts,
     uint32_t meshletMaxPrims,
-    bool flipTriangles,
+    bool /*flipTriangles*/,
     bool force32BitIndices,
-    MeshletSet& meshlet)
+    MeshletJob& job)
 {
     if (!Extract(node))
     {
+        Reset();
         return false;
     }
 
     Optimize(transformer, force32BitIndices);
 
+    job.maxVerts = meshletMaxVerts;
+    job.maxPrims = meshletMaxPrims;
+    job.indexSize = m_indexBuffer.GetIndexSize();
+    job.faceCount = m_indexBuffer.GetIndexCount() / 3;
+
     // Create a position-only buffer
-    std::vector<XMFLOAT3> positions;
-    positions.resize(m_vertexBuffer.GetVertexCount());
+    job.positions.resize(m_vertexBuffer.GetVertexCount());
 
-    for (size_t i = 0; i < positions.size(); ++i)
+    for (size_t i = 0; i < job.positions.size(); ++i)
     {
-        positions[i] = *reinterpret_cast<XMFLOAT3*>(m_vertexBuffer.GetVertex(i));
+        job.positions[i] = *reinterpret_cast<XMFLOAT3*>(m_vertexBuffer.GetVertex(i));
     }
 
-    if (m_indexBuffer.GetIndexSize() == 4)
-    {
-        Meshletize<uint32_t>(
-            meshletMaxVerts,
-            meshletMaxPrims,
-            meshlet,
-            reinterpret_cast<uint32_t*>(m_indexBuffer.GetIndexData()),
-            m_indexBuffer.GetIndexCount() / 3,
-            positions,
-            m_subsets);
-    }
-    else
-    {
-        Meshletize<uint16_t>(
-            meshletMaxVerts,
-            meshletMaxPrims,
-            meshlet,
-            reinterpret_cast<uint16_t*>(m_indexBuffer.GetIndexData()),
-            m_indexBuffer.GetIndexCount() / 3,
-            positions,
-            m_subsets);
-    }
+    const uint8_t* indexData = m_indexBuffer.GetIndexData();
+    job.indices.assign(indexData, indexData + m_indexBuffer.GetIndexDataSize());
+
+    job.subsets = m_subsets;
 
     Reset();
 
     return true;
 }
 
-bool MeshProcessor::GenerateMeshlets(
-    MeshletSet& meshlet,
+void MeshProcessor::PrepareMeshletJob(
+    MeshletJob& job,
     uint32_t meshletMaxVerts,
     uint32_t meshletMaxPrims,
     const uint8_t* verts,
@@ -105,41 +92,103 @@ bool MeshProcessor::GenerateMeshlets(
     bool indices32Bit,
     const std::vector<std::pair<size_t, size_t>>& meshSubsets)
 {
+    job.maxVerts = meshletMaxVerts;
+    job.maxPrims = meshletMaxPrims;
+    job.indexSize = indices32Bit ? 4 : 2;
+    job.faceCount = nFaces;
+
     // Create a position-only buffer
-    std::vector<XMFLOAT3> positions;
-    positions.resize(numVerts);
+    job.positions.resize(numVerts);
+
+    for (size_t i = 0; i < job.positions.size(); ++i)
+    {
+        job.positions[i] = *reinterpret_cast<const XMFLOAT3*>(verts + i * vertexStride);
+    }
+
+    job.indices.assign(indices, indices + nFaces * 3 * job.indexSize);
 
-    for (size_t i = 0; i < positions.size(); ++i)
+    job.subsets = meshSubsets;
+}
+
+void MeshProcessor::MeshletizeSubset(const MeshletJob& job, size_t subsetIndex, MeshletSet& result)
+{
+    const auto& subset = job.subsets[subsetIndex];
+    if (subset.first > job.faceCount || subset.second > job.faceCount - subset.first)
     {
-        positions[i] = *reinterpret_cast<const XMFLOAT3*>(verts + i * vertexStride);
+        throw std::exception("Subset out of range!");
     }
 
-    if (indices32Bit)
+    // Only this subset's triangles are passed in; its indices still reference the whole vertex buffer.
+    const uint8_t* indices = job.indices.data() + subset.first * 3 * job.indexSize;
+
+    if (job.indexSize == 4)
     {
-        const uint32_t* indexBuffer = reinterpret_cast<const uint32_t*>(indices);
-        Meshletize(
-            meshletMaxVerts,
-            meshletMaxPrims,
-            meshlet,
-            indexBuffer,
-            nFaces,
-            positions,
-            meshSubsets);
+        Meshletize<uint32_t>(
+            job.maxVerts,
+            job.maxPrims,
+            result,
+            reinterpret_cast<const uint32_t*>(indices),
+            subset.second,
+            job.positions);
     }
     else
     {
-        const uint16_t* indexBuffer = reinterpret_cast<const uint16_t*>(indices);
-        Meshletize(
-            meshletMaxVerts,
-            meshletMaxPrims,
-            meshlet,
-            indexBuffer,
-            nFaces,
-            positions,
-            meshSubsets);
+        Meshletize<uint16_t>(
+            job.maxVerts,
+            job.maxPrims,
+            result,
+            reinterpret_cast<const uint16_t*>(indices),
+            subset.second,
+            job.positions);
     }
+}
 
-    return true;
+void MeshProcessor::MergeSubsets(const MeshletJob& job, std::vector<MeshletSet>& parts, MeshletSet& result)
+{
+    result.maxVerts = job.maxVerts;
+    result.maxPrims = job.maxPrims;
+    result.indexSize = job.indexSize;
+
+    size_t meshletCount = 0;
+    size_t uniqueIndexBytes = 0;
+    size_t primitiveCount = 0;
+    for (auto& part : parts)
+    {
+        meshletCount += part.meshlets.size();
+        uniqueIndexBytes += part.uniqueVertexIndices.size();
+        primitiveCount += part.primitiveIndices.size();
+    }
+
+    result.subsets.reserve(parts.size());
+    result.meshlets.reserve(meshletCount);
+    result.cullData.reserve(meshletCount);
+    result.uniqueVertexIndices.reserve(uniqueIndexBytes);
+    result.primitiveIndices.reserve(primitiveCount);
+
+    for (auto& part : parts)
+    {
+        // Rebase the part's offsets onto the concatenated buffers.
+        const uint32_t vertOffset = static_cast<uint32_t>(result.uniqueVertexIndices.size() / job.indexSize);
+        const uint32_t primOffset = static_cast<uint32_t>(result.primitiveIndices.size());
+
+        Subset subset;
+        subset.Offset = static_cast<uint32_t>(result.meshlets.size());
+        subset.Count = static_cast<uint32_t>(part.meshlets.size());
+        result.subsets.push_back(subset);
+
+        for (auto meshlet : part.meshlets)
+        {
+            meshlet.VertOffset += vertOffset;
+            meshlet.PrimOffset += primOffset;
+            result.meshlets.push_back(meshlet);
+        }
+
+        result.cullData.insert(result.cullData.end(), part.cullData.begin(), part.cullData.end());
+        result.uniqueVertexIndices.insert(result.uniqueVertexIndices.end(), part.uniqueVertexIndices.begin(), part.uniqueVertexIndices.end());
+        result.primitiveIndices.insert(result.primitiveIndices.end(), part.primitiveIndices.begin(), part.primitiveIndices.end());
+
+        part = MeshletSet();
+    }
 }
 
 bool MeshProcessor::Extract(FbxNode* node)
@@ -293,10 +342,14 @@ void MeshProcessor::Optimize(const FbxTransformer& transformer, bool force32BitI
     // Apply a AttributeSort optimization
     std::stable_sort(m_rawTriangles.begin(), m_rawTriangles.end(), [](Triangle* a, Triangle* b) { return a->SubsetIndex < b->SubsetIndex; });
 
+    // Collapse the triangle verts into the final vertex list.
+    // This removes unnecessary duplicates, and retains necessary duplicates.
+    std::vector<uint32_t> cornerIndices;
+    VertexWelder::Weld(m_rawTriangles, m_dccVertexCount, m_vertexData, cornerIndices);
+
     int currentSubsetIndex = -1;
 
     m_indexData.reserve(m_rawTriangles.size() * 3);
-    m_vertexData.resize(m_dccVertexCount, nullptr);
 
     // loop through raw triangles
     for (size_t triIndex = 0; triIndex < m_rawTriangles.size(); ++triIndex)
@@ -314,11 +367,9 @@ void MeshProcessor::Optimize(const FbxTransformer& transformer, bool force32BitI
             currentSubsetIndex = tri->SubsetIndex;
         }
 
-        // Collapse the triangle verts into the final vertex list.
-        // This removes unnecessary duplicates, and retains necessary duplicates.
-        uint32_t indexA = FindOrAddVertex(m_vertexData, &tri->Vertex[0]);
-        uint32_t indexB = FindOrAddVertex(m_vertexData, &tri->Vertex[1]);
-        uint32_t indexC = FindOrAddVertex(m_vertexData, &tri->Vertex[2]);
+        uint32_t indexA = cornerIndices[triIndex * 3 + 0];
+        uint32_t indexB = cornerIndices[triIndex * 3 + 1];
+        uint32_t indexC = cornerIndices[triIndex * 3 + 2];
 
         // record final indices into the index list
         m_indexData.push_back(indexA);
@@ -360,17 +411,17 @@ void MeshProcessor::Optimize(const FbxTransformer& transformer, bool force32BitI
     {
         auto destVertex = m_vertexBuffer.GetVertex(vertIndex);
 
-        auto srcVertex = m_vertexData[vertIndex];
-        if (!srcVertex)
+        // Skip DCC vertices which no triangle references
+        if (m_vertexData.DCCVertexIndex[vertIndex] == UINT32_MAX)
         {
             continue;
         }
 
         auto dest = reinterpret_cast<XMFLOAT3*>(destVertex);
-        transformer.TransformPosition(dest, &srcVertex->Position);
+        transformer.TransformPosition(dest, &m_vertexData.Position[vertIndex]);
 
         ++dest;
-        transformer.TransformDirection(dest, &srcVertex->Normal);
+        transformer.TransformDirection(dest, &m_vertexData.Normal[vertIndex]);
     }
 }
 
@@ -381,26 +432,34 @@ void MeshProcessor::Meshletize(
     MeshletSet& m,
     const T* indexBuffer,
     size_t nFaces,
-    const std::vector<XMFLOAT3>& positions,
-    const std::vector<std::pair<size_t, size_t>>& subsets)
+    const std::vector<XMFLOAT3>& positions)
 {
     m.maxVerts = meshletMaxVerts;
     m.maxPrims = meshletMaxPrims;
     m.indexSize = sizeof(T);
 
-    std::vector<std::pair<size_t, size_t>> meshletSubsets;
-    meshletSubsets.resize(subsets.size());
+    m.subsets.resize(1);
+    m.subsets[0].Offset = 0;
+    m.subsets[0].Count = 0;
+
+    if (!nFaces)
+    {
+        return;
+    }
+
+    const std::pair<size_t, size_t> subset(0, nFaces);
+    std::pair<size_t, size_t> meshletSubset;
 
     // Meshletize our mesh and generate per-meshlet culling data
     ThrowIfFailed(ComputeMeshlets(
         indexBuffer, nFaces,
         positions.data(), positions.size(),
-        subsets.data(), subsets.size(),
+        &subset, 1,
         nullptr,
         m.meshlets,
         m.uniqueVertexIndices,
         m.primitiveIndices,
-        meshletSubsets.data(),
+        &meshletSubset,
         meshletMaxVerts,
         meshletMaxPrims
     ));
@@ -410,16 +469,12 @@ void MeshProcessor::Meshletize(
     ThrowIfFailed(ComputeCullData(
         positions.data(), positions.size(),
         m.meshlets.data(), m.meshlets.size(),
-        reinterpret_cast<T*>(m.uniqueVertexIndices.data()), m.uniqueVertexIndices.size(),
+        reinterpret_cast<const T*>(m.uniqueVertexIndices.data()), m.uniqueVertexIndices.size() / sizeof(T),
         m.primitiveIndices.data(), m.primitiveIndices.size(),
         m.cullData.data(),
         MESHLET_DEFAULT
     ));
 
-    m.subsets.resize(meshletSubsets.size());
-    for (size_t i = 0; i < meshletSubsets.size(); ++i)
-    {
-        m.subsets[i].Offset = static_cast<uint32_t>(meshletSubsets[i].first);
-        m.subsets[i].Count = static_cast<uint32_t>(meshletSubsets[i].second);
-    }
+    m.subsets[0].Offset = static_cast<uint32_t>(meshletSubset.first);
+    m.subsets[0].Count = static_cast<uint32_t>(meshletSubset.second);
 }
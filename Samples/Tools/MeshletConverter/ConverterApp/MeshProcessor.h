@@ -9,6 +9,8 @@
 #include "MeshUtilities.h"
 #include "TriangleAllocator.h"
 #include "MeshletSet.h"
+#include "MeshletPipeline.h"
+#include "VertexWelder.h"
 
 #include <memory>
 #include <vector>
@@ -30,19 +32,19 @@ namespace ATG
             : m_dccVertexCount(0)
         { }
 
-        // Generates meshlets for the given FbxNode's mesh.
+        // Extracts and optimizes the given FbxNode's mesh into a meshletization job.
         // Returns whether the operation was successful.
-        bool GenerateMeshlets(
+        bool PrepareMeshletJob(
             fbxsdk::FbxNode* node,
             const FbxTransformer& transformer,
             uint32_t meshletMaxVerts,
             uint32_t meshletMaxPrims,
             bool flipTriangles,
             bool force32BitIndices,
-            MeshletSet& meshlet);
+            MeshletJob& job);
 
-        static bool GenerateMeshlets(
-            MeshletSet& meshlet,
+        static void PrepareMeshletJob(
+            MeshletJob& job,
             uint32_t meshletMaxVerts,
             uint32_t meshletMaxPrims,
             const uint8_t* verts,
@@ -53,6 +55,13 @@ namespace ATG
             bool indices32Bit,
             const std::vector<std::pair<size_t, size_t>>& meshSubsets);
 
+        // Generates the meshlets of a single subset. Subsets are independent, so this may be
+        // called concurrently for different subsets of the same job.
+        static void MeshletizeSubset(const MeshletJob& job, size_t subsetIndex, MeshletSet& result);
+
+        // Concatenates per-subset results in subset order, consuming the parts.
+        static void MergeSubsets(const MeshletJob& job, std::vector<MeshletSet>& parts, MeshletSet& result);
+
     private:
         void Reset();
         bool Extract(fbxsdk::FbxNode* node);
@@ -65,8 +74,7 @@ namespace ATG
             MeshletSet& m,
             const T* indexBuffer,
             size_t nFaces,
-            const std::vector<DirectX::XMFLOAT3>& positions,
-            const std::vector<std::pair<size_t, size_t>>& subsets);
+            const std::vector<DirectX::XMFLOAT3>& positions);
 
     private:
         ExportVB                                m_vertexBuffer;
@@ -78,6 +86,6 @@ namespace ATG
         std::vector<std::pair<size_t, size_t>>  m_subsets;
 
         std::vector<uint32_t>                   m_indexData;
-        VertexArray                             m_vertexData;
+        VertexStore                             m_vertexData;
     };
 }
@@ -0,0 +1,304 @@
+//--------------------------------------------------------------------------------------
+// MeshletPipeline.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+#include "MeshletPipeline.h"
+
+#include "MeshProcessor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <iostream>
+
+using namespace ATG;
+using namespace DirectX;
+
+struct MeshletPipeline::MeshState
+{
+    size_t                      index;
+    size_t                      memoryEstimate;
+
+    std::unique_ptr<MeshletJob> job;
+    std::vector<MeshletSet>     parts;      // One per subset
+    MeshletSet                  result;
+
+    // Guarded by m_mutex
+    size_t                      remaining;
+    bool                        complete;
+    bool                        failed;
+};
+
+MeshletPipeline::MeshletPipeline(size_t memoryBudget)
+    : m_memoryBudget(memoryBudget)
+    , m_memoryInFlight(0)
+    , m_shutdown(false)
+    , m_submitCount(0)
+    , m_setCount(0)
+    , m_failed(false)
+{
+    const unsigned int threadCount = std::max<unsigned int>(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        m_workers.emplace_back(&MeshletPipeline::WorkerThread, this);
+    }
+}
+
+MeshletPipeline::~MeshletPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_workAvailable.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void MeshletPipeline::Begin(const char* filePath)
+{
+    m_filePath = filePath;
+    m_tempPath = m_filePath + ".tmp";
+    m_submitCount = 0;
+    m_setCount = 0;
+    m_failed = false;
+}
+
+void MeshletPipeline::Submit(std::unique_ptr<MeshletJob> job)
+{
+    auto mesh = std::make_unique<MeshState>();
+    mesh->index = m_submitCount++;
+    mesh->memoryEstimate = EstimateMemory(*job);
+    mesh->parts.resize(job->subsets.size());
+    mesh->remaining = job->subsets.size();
+    mesh->complete = false;
+    mesh->failed = false;
+    mesh->job = std::move(job);
+
+    if (!mesh->remaining)
+    {
+        MeshProcessor::MergeSubsets(*mesh->job, mesh->parts, mesh->result);
+        mesh->job.reset();
+        mesh->complete = true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    // Write out finished meshes until this one fits in the budget. A mesh larger than the
+    // whole budget still runs, but only once nothing else is in flight.
+    for (;;)
+    {
+        FlushCompleted(lock);
+
+        if (m_meshes.empty() || m_memoryInFlight + mesh->memoryEstimate <= m_memoryBudget)
+            break;
+
+        m_meshCompleted.wait(lock);
+    }
+
+    m_memoryInFlight += mesh->memoryEstimate;
+
+    for (size_t i = 0; i < mesh->parts.size(); ++i)
+    {
+        m_tasks.emplace_back(mesh.get(), i);
+    }
+
+    m_meshes.push_back(std::move(mesh));
+
+    lock.unlock();
+    m_workAvailable.notify_all();
+}
+
+bool MeshletPipeline::End(bool commit)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;)
+        {
+            FlushCompleted(lock);
+
+            if (m_meshes.empty())
+                break;
+
+            m_meshCompleted.wait(lock);
+        }
+    }
+
+    commit &= !m_failed;
+
+    // A committed file always gets a header, even if no set was written to it.
+    if (commit && !m_file.is_open() && !OpenFile())
+    {
+        commit = false;
+    }
+
+    if (m_file.is_open())
+    {
+        // Patch the set count now that it is known.
+        m_file.seekp(0);
+        MeshletSet::WriteHeader(m_file, static_cast<uint32_t>(m_setCount));
+        m_file.close();
+
+        if (m_file.fail())
+        {
+            std::cout << "Failed to write file \"" << m_filePath << "\"." << std::endl;
+            m_failed = true;
+            commit = false;
+        }
+
+        if (commit)
+        {
+            std::remove(m_filePath.c_str());
+            if (std::rename(m_tempPath.c_str(), m_filePath.c_str()) != 0)
+            {
+                std::cout << "Failed to write file \"" << m_filePath << "\"." << std::endl;
+                m_failed = true;
+                commit = false;
+            }
+        }
+
+        if (!commit)
+        {
+            std::remove(m_tempPath.c_str());
+        }
+    }
+
+    return commit;
+}
+
+void MeshletPipeline::WorkerThread()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    for (;;)
+    {
+        m_workAvailable.wait(lock, [this] { return m_shutdown || !m_tasks.empty(); });
+
+        if (m_tasks.empty())
+            return;
+
+        auto task = m_tasks.front();
+        m_tasks.pop_front();
+
+        lock.unlock();
+
+        MeshState* mesh = task.first;
+
+        bool failed = false;
+        try
+        {
+            MeshProcessor::MeshletizeSubset(*mesh->job, task.second, mesh->parts[task.second]);
+        }
+        catch (const std::exception&)
+        {
+            failed = true;
+        }
+
+        lock.lock();
+
+        mesh->failed |= failed;
+
+        if (--mesh->remaining == 0)
+        {
+            // Last subset of the mesh, so no other thread references it until it is complete.
+            lock.unlock();
+
+            if (!mesh->failed)
+            {
+                try
+                {
+                    MeshProcessor::MergeSubsets(*mesh->job, mesh->parts, mesh->result);
+                }
+                catch (const std::exception&)
+                {
+                    mesh->failed = true;
+                }
+            }
+
+            mesh->job.reset();
+            mesh->parts = std::vector<MeshletSet>();
+
+            lock.lock();
+
+            mesh->complete = true;
+            m_meshCompleted.notify_all();
+        }
+    }
+}
+
+void MeshletPipeline::FlushCompleted(std::unique_lock<std::mutex>& lock)
+{
+    // Meshes must be written in submission order, so stop at the first incomplete one.
+    while (!m_meshes.empty() && m_meshes.front()->complete)
+    {
+        std::unique_ptr<MeshState> mesh = std::move(m_meshes.front());
+        m_meshes.pop_front();
+
+        lock.unlock();
+
+        if (mesh->failed)
+        {
+            std::cout << "Failed to generate meshlets for mesh " << mesh->index << "." << std::endl;
+            m_failed = true;
+        }
+        else if (!WriteSet(mesh->result))
+        {
+            m_failed = true;
+        }
+
+        const size_t memoryEstimate = mesh->memoryEstimate;
+        mesh.reset();
+
+        lock.lock();
+
+        m_memoryInFlight -= memoryEstimate;
+    }
+}
+
+bool MeshletPipeline::OpenFile()
+{
+    if (m_filePath.empty())
+        return false;
+
+    m_file.clear();
+    m_file.open(m_tempPath, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open())
+    {
+        std::cout << "Failed to open file \"" << m_filePath << "\" for writing." << std::endl;
+        m_filePath.clear();
+        return false;
+    }
+
+    // The count is patched in End().
+    MeshletSet::WriteHeader(m_file, 0);
+    return true;
+}
+
+bool MeshletPipeline::WriteSet(const MeshletSet& set)
+{
+    if (!m_file.is_open() && !OpenFile())
+        return false;
+
+    set.Write(m_file);
+    ++m_setCount;
+
+    return m_file.good();
+}
+
+size_t MeshletPipeline::EstimateMemory(const MeshletJob& job)
+{
+    const size_t inputBytes = job.positions.size() * sizeof(XMFLOAT3) + job.indices.size();
+
+    const size_t meshletCount = job.faceCount / std::max<size_t>(job.maxPrims, 1) + job.subsets.size();
+    const size_t outputBytes = meshletCount * (sizeof(Meshlet) + sizeof(CullData))
+        + job.faceCount * sizeof(MeshletTriangle)
+        + std::min<size_t>(job.faceCount * 3, meshletCount * job.maxVerts) * job.indexSize;
+
+    // The per-subset results and the merged set briefly coexist.
+    return inputBytes + outputBytes * 2;
+}
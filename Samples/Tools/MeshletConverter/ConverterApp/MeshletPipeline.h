@@ -0,0 +1,99 @@
+//--------------------------------------------------------------------------------------
+// MeshletPipeline.h
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "MeshletSet.h"
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ATG
+{
+    // Everything needed to meshletize one mesh. The pipeline takes ownership once submitted.
+    struct MeshletJob
+    {
+        uint32_t                                maxVerts;
+        uint32_t                                maxPrims;
+        uint32_t                                indexSize;      // 2 or 4 bytes
+        size_t                                  faceCount;
+
+        std::vector<DirectX::XMFLOAT3>          positions;
+        std::vector<uint8_t>                    indices;
+        std::vector<std::pair<size_t, size_t>>  subsets;        // First face & face count
+
+        MeshletJob()
+            : maxVerts(0)
+            , maxPrims(0)
+            , indexSize(0)
+            , faceCount(0)
+        { }
+    };
+
+    // Meshletizes every subset of every submitted mesh as an independent job on a pool of
+    // worker threads. Finished meshes are written to the output file in submission order as
+    // soon as they and all meshes before them complete, and Submit blocks while the estimated
+    // memory of meshes in flight would exceed the budget.
+    class MeshletPipeline
+    {
+    public:
+        explicit MeshletPipeline(size_t memoryBudget);
+        ~MeshletPipeline();
+
+        MeshletPipeline(const MeshletPipeline&) = delete;
+        MeshletPipeline& operator=(const MeshletPipeline&) = delete;
+
+        // Starts a new output file. Meshes are streamed to a temporary file next to it, which
+        // only replaces filePath once End commits it.
+        void Begin(const char* filePath);
+
+        void Submit(std::unique_ptr<MeshletJob> job);
+
+        // Waits for all submitted meshes and completes the file. If commit is false, or any
+        // mesh failed, the temporary file is deleted and filePath is left untouched.
+        // Returns whether every mesh was meshletized and the file was written.
+        bool End(bool commit);
+
+        // Number of meshlet sets written to the current file
+        size_t GetSetCount() const { return m_setCount; }
+
+    private:
+        struct MeshState;
+
+        void WorkerThread();
+        void FlushCompleted(std::unique_lock<std::mutex>& lock);
+        bool OpenFile();
+        bool WriteSet(const MeshletSet& set);
+
+        static size_t EstimateMemory(const MeshletJob& job);
+
+        size_t                                      m_memoryBudget;
+        size_t                                      m_memoryInFlight;
+
+        std::mutex                                  m_mutex;
+        std::condition_variable                     m_workAvailable;
+        std::condition_variable                     m_meshCompleted;
+        std::deque<std::pair<MeshState*, size_t>>   m_tasks;        // Mesh & subset index
+        std::deque<std::unique_ptr<MeshState>>      m_meshes;       // In submission order
+        std::vector<std::thread>                    m_workers;
+        bool                                        m_shutdown;
+
+        // Only touched by the submitting thread
+        std::string                                 m_filePath;
+        std::string                                 m_tempPath;
+        std::ofstream                               m_file;
+        size_t                                      m_submitCount;
+        size_t                                      m_setCount;
+        bool                                        m_failed;
+    };
+}
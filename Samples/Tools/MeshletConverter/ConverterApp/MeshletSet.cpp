@@ -1,4 +1,5 @@
 #include "MeshletSet.h"
+#include "MeshletFormat.h"
 
 #include <fstream>
 
@@ -6,58 +7,81 @@ using namespace ATG;
 
 namespace
 {
-    struct MeshletFileHeader
+    constexpr size_t AlignUp(size_t size)
     {
-        enum
-        {
-            MESHLET_VERSION_INITIAL = 0x0,
-            MESHLET_VERSION_CULLDATA = 0x1,
-            MESHLET_VERSION_CULLDATA_UPDATE = 0x2,
-            MESHLET_VERSION_GEN_UPDATE = 0x3,
-            MESHLET_VERSION_CURRENT = MESHLET_VERSION_GEN_UPDATE
-        };
-
-        uint32_t Prolog;
-        uint32_t Version;
-        uint32_t Count;
-    };
+        return (size + c_meshletDataAlignment - 1) & ~(c_meshletDataAlignment - 1);
+    }
+
+    void WritePadding(std::ostream& stream, size_t size)
+    {
+        static const char s_zeros[c_meshletDataAlignment] = {};
+        stream.write(s_zeros, std::streamsize(AlignUp(size) - size));
+    }
 }
 
 void MeshletSet::Write(std::ostream& stream) const
 {
-    stream.write(reinterpret_cast<const char*>(&maxVerts), sizeof(maxVerts));
-    stream.write(reinterpret_cast<const char*>(&maxPrims), sizeof(maxPrims));
-
+    const size_t meshletBytes = meshlets.size() * sizeof(meshlets[0]);
+    const size_t cullDataBytes = cullData.size() * sizeof(cullData[0]);
+    const size_t submeshBytes = subsets.size() * sizeof(subsets[0]);
+    const size_t indexBytes = uniqueVertexIndices.size();
+    const size_t primBytes = primitiveIndices.size() * sizeof(primitiveIndices[0]);
+
+    MeshletSetHeader header = {};
+    header.MaxVerts = maxVerts;
+    header.MaxPrims = maxPrims;
+    header.IndexBytes = indexSize;
+    header.MeshletCount = static_cast<uint32_t>(meshlets.size());
+    header.SubmeshCount = static_cast<uint32_t>(subsets.size());
+    header.IndexCount = static_cast<uint32_t>(uniqueVertexIndices.size() / indexSize);
+    header.PrimitiveCount = static_cast<uint32_t>(primitiveIndices.size());
+
+    const size_t cullDataOffset = AlignUp(sizeof(header) + meshletBytes);
+    const size_t submeshOffset = AlignUp(cullDataOffset + cullDataBytes);
+    const size_t indexOffset = AlignUp(submeshOffset + submeshBytes);
+    const size_t primOffset = AlignUp(indexOffset + indexBytes);
+    const size_t size = AlignUp(primOffset + primBytes);
+
+    if (primOffset > UINT32_MAX)
     {
-        uint32_t meshletCount = (uint32_t)meshlets.size();
-
-        stream.write(reinterpret_cast<const char*>(&meshletCount), 4);
-        stream.write(reinterpret_cast<const char*>(meshlets.data()), meshletCount * sizeof(meshlets[0]));
-        stream.write(reinterpret_cast<const char*>(cullData.data()), meshletCount * sizeof(cullData[0]));
+        // Offsets are stored as 32 bits.
+        stream.setstate(std::ios::failbit);
+        return;
     }
 
-    {
-        uint32_t submeshCount = (uint32_t)subsets.size();
+    header.CullDataOffset = static_cast<uint32_t>(cullDataOffset);
+    header.SubmeshOffset = static_cast<uint32_t>(submeshOffset);
+    header.UniqueIndexOffset = static_cast<uint32_t>(indexOffset);
+    header.PrimitiveOffset = static_cast<uint32_t>(primOffset);
+    header.Size = size;
 
-        stream.write(reinterpret_cast<const char*>(&submeshCount), 4);
-        stream.write(reinterpret_cast<const char*>(subsets.data()), submeshCount * sizeof(subsets[0]));
-    }
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-    {
-        uint32_t indexBytes = indexSize;
-        uint32_t indexCount = (uint32_t)uniqueVertexIndices.size() / indexBytes;
+    stream.write(reinterpret_cast<const char*>(meshlets.data()), std::streamsize(meshletBytes));
+    WritePadding(stream, meshletBytes);
 
-        stream.write(reinterpret_cast<const char*>(&indexBytes), 4);
-        stream.write(reinterpret_cast<const char*>(&indexCount), 4);
-        stream.write(reinterpret_cast<const char*>(uniqueVertexIndices.data()), indexCount * indexBytes);
-    }
+    stream.write(reinterpret_cast<const char*>(cullData.data()), std::streamsize(cullDataBytes));
+    WritePadding(stream, cullDataBytes);
 
-    {
-        uint32_t primCount = (uint32_t)primitiveIndices.size();
+    stream.write(reinterpret_cast<const char*>(subsets.data()), std::streamsize(submeshBytes));
+    WritePadding(stream, submeshBytes);
 
-        stream.write(reinterpret_cast<const char*>(&primCount), 4);
-        stream.write(reinterpret_cast<const char*>(primitiveIndices.data()), primCount * sizeof(primitiveIndices[0]));
-    }
+    stream.write(reinterpret_cast<const char*>(uniqueVertexIndices.data()), std::streamsize(indexBytes));
+    WritePadding(stream, indexBytes);
+
+    stream.write(reinterpret_cast<const char*>(primitiveIndices.data()), std::streamsize(primBytes));
+    WritePadding(stream, primBytes);
+}
+
+void MeshletSet::WriteHeader(std::ostream& stream, uint32_t count)
+{
+    MeshletFileHeader header;
+    header.Prolog = c_meshletFileProlog;
+    header.Version = MeshletFileHeader::MESHLET_VERSION_CURRENT;
+    header.Count = count;
+
+    stream.write(reinterpret_cast<char*>(&header), sizeof(header));
+    WritePadding(stream, sizeof(header));
 }
 
 bool MeshletSet::Write(const wchar_t* filePath, const std::vector<MeshletSet>& meshlets)
@@ -68,12 +92,7 @@ bool MeshletSet::Write(const wchar_t* filePath, const std::vector<MeshletSet>& m
         return false;
     }
 
-    MeshletFileHeader header;
-    header.Prolog = 'MSHL';
-    header.Version = MeshletFileHeader::MESHLET_VERSION_CURRENT;
-    header.Count = static_cast<uint32_t>(meshlets.size());
-
-    file.write(reinterpret_cast<char*>(&header), sizeof(header));
+    WriteHeader(file, static_cast<uint32_t>(meshlets.size()));
 
     for (auto& m : meshlets)
     {
@@ -25,6 +25,7 @@ namespace ATG
         std::vector<DirectX::CullData>         cullData;
 
         void Write(std::ostream& stream) const;
+        static void WriteHeader(std::ostream& stream, uint32_t count);
         static bool Write(const wchar_t* filePath, const std::vector<MeshletSet>& meshlets);
         static bool Write(const char* filePath, const std::vector<MeshletSet>& meshlets);
     };
@@ -87,39 +87,3 @@ bool Vertex::Equals(const Vertex* pOtherVertex) const
 
     return true;
 }
-
-uint32_t ATG::FindOrAddVertex(VertexArray& vertsArray, Vertex* testVertex)
-{
-    uint32_t index = testVertex->DCCVertexIndex;
-    assert(index < vertsArray.size());
-
-    if (Vertex* vertex = vertsArray[index])
-    {
-        Vertex* lastVertex = nullptr;
-        while (vertex)
-        {
-            index = vertex->DCCVertexIndex;
-            if (vertex->Equals(testVertex))
-                return index;
-
-            lastVertex = vertex;
-            vertex = vertex->NextDuplicateVertex;
-        }
-        assert(vertex == nullptr);
-
-        index = static_cast<uint32_t>(vertsArray.size());
-        vertsArray.push_back(testVertex);
-        testVertex->DCCVertexIndex = index;
-
-        if (lastVertex)
-        {
-            lastVertex->NextDuplicateVertex = testVertex;
-        }
-    }
-    else
-    {
-        vertsArray[index] = testVertex;
-    }
-
-    return index;
-}
@@ -18,7 +18,6 @@ namespace ATG
         uint32_t            DCCVertexIndex;
         DirectX::XMFLOAT3   Position;
         DirectX::XMFLOAT3   Normal;
-        Vertex*             NextDuplicateVertex;
 
         Vertex()
         {
@@ -32,7 +31,6 @@ namespace ATG
 
         bool Equals(const Vertex* pOtherVertex) const;
     };
-    using VertexArray = std::vector<Vertex*>;
 
     struct Triangle
     {
@@ -86,6 +84,4 @@ namespace ATG
         uint32_t            m_totalCount;
         uint32_t            m_allocatedCount;
     };
-
-    uint32_t FindOrAddVertex(VertexArray& vertsArray, Vertex* testVertex);
 }
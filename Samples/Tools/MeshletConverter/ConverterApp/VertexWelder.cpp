@@ -0,0 +1,269 @@
+//--------------------------------------------------------------------------------------
+// VertexWelder.cpp
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+#include "VertexWelder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace ATG;
+using namespace DirectX;
+
+namespace
+{
+    // Number of triangles welded by each parallel work item
+    constexpr size_t c_blockTriangleCount = 64 * 1024;
+
+    constexpr uint32_t c_invalidIndex = UINT32_MAX;
+
+    inline uint32_t FloatBits(float f)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &f, sizeof(bits));
+
+        // -0.0 and 0.0 compare equal, so they must also hash equal.
+        return (bits == 0x80000000u) ? 0u : bits;
+    }
+
+    inline uint32_t HashVertex(uint32_t dccIndex, const XMFLOAT3& position, const XMFLOAT3& normal)
+    {
+        const uint32_t words[7] =
+        {
+            dccIndex,
+            FloatBits(position.x), FloatBits(position.y), FloatBits(position.z),
+            FloatBits(normal.x), FloatBits(normal.y), FloatBits(normal.z),
+        };
+
+        uint64_t h = 0;
+        for (uint32_t w : words)
+        {
+            h = (h ^ w) * 0x9E3779B97F4A7C15ull;
+        }
+
+        h ^= h >> 29;
+        return static_cast<uint32_t>(h ^ (h >> 32));
+    }
+
+    // Same test as Vertex::Equals; vertices are only ever welded within a single DCC vertex.
+    inline bool VertexEquals(const VertexStore& store, uint32_t index, uint32_t dccIndex, const XMFLOAT3& position, const XMFLOAT3& normal)
+    {
+        const XMFLOAT3& p = store.Position[index];
+        const XMFLOAT3& n = store.Normal[index];
+
+        return store.DCCVertexIndex[index] == dccIndex
+            && p.x == position.x && p.y == position.y && p.z == position.z
+            && n.x == normal.x && n.y == normal.y && n.z == normal.z;
+    }
+
+    // Open-addressing hash table with linear probing which maps vertices to their index in a VertexStore.
+    class WeldTable
+    {
+    public:
+        struct Slot
+        {
+            uint32_t Hash;
+            uint32_t Index;
+        };
+
+        explicit WeldTable(size_t maxEntries)
+        {
+            size_t capacity = 16;
+            while (capacity < maxEntries * 2)
+            {
+                capacity *= 2;
+            }
+
+            m_mask = capacity - 1;
+            m_slots.resize(capacity, Slot{ 0, c_invalidIndex });
+        }
+
+        // Returns the slot holding an equal vertex, or the empty slot where it should be inserted.
+        Slot& Lookup(const VertexStore& store, uint32_t hash, uint32_t dccIndex, const XMFLOAT3& position, const XMFLOAT3& normal)
+        {
+            for (size_t i = hash & m_mask; ; i = (i + 1) & m_mask)
+            {
+                Slot& slot = m_slots[i];
+                if (slot.Index == c_invalidIndex)
+                    return slot;
+
+                if (slot.Hash == hash && VertexEquals(store, slot.Index, dccIndex, position, normal))
+                    return slot;
+            }
+        }
+
+    private:
+        size_t              m_mask;
+        std::vector<Slot>   m_slots;
+    };
+
+    // Calls func(i) for every i in [0, count) on all hardware threads.
+    template<typename Func>
+    void ParallelFor(size_t count, const Func& func)
+    {
+        std::atomic<size_t> next(0);
+
+        auto worker = [&]()
+        {
+            for (size_t i = next++; i < count; i = next++)
+            {
+                func(i);
+            }
+        };
+
+        const size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; ++i)
+        {
+            threads.emplace_back(worker);
+        }
+
+        worker();
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+    }
+
+    struct WeldBlock
+    {
+        size_t                  FirstTriangle;
+        size_t                  TriangleCount;
+
+        VertexStore             Vertices;       // Unique vertices in the order first referenced
+        std::vector<uint32_t>   Hashes;
+        std::vector<uint32_t>   LocalIndices;   // Per corner index into Vertices
+        std::vector<uint32_t>   Remap;          // Vertices index to final vertex index
+    };
+}
+
+void VertexWelder::Weld(
+    const TriangleArray& triangles,
+    uint32_t dccVertexCount,
+    VertexStore& vertices,
+    std::vector<uint32_t>& cornerIndices)
+{
+    vertices.clear();
+    cornerIndices.clear();
+
+    std::vector<WeldBlock> blocks((triangles.size() + c_blockTriangleCount - 1) / c_blockTriangleCount);
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        blocks[i].FirstTriangle = i * c_blockTriangleCount;
+        blocks[i].TriangleCount = std::min(c_blockTriangleCount, triangles.size() - blocks[i].FirstTriangle);
+    }
+
+    // Weld each block of triangles independently.
+    ParallelFor(blocks.size(), [&](size_t blockIndex)
+    {
+        WeldBlock& block = blocks[blockIndex];
+        const size_t cornerCount = block.TriangleCount * 3;
+
+        block.LocalIndices.resize(cornerCount);
+        block.Vertices.DCCVertexIndex.reserve(cornerCount);
+        block.Vertices.Position.reserve(cornerCount);
+        block.Vertices.Normal.reserve(cornerCount);
+        block.Hashes.reserve(cornerCount);
+
+        WeldTable table(cornerCount);
+
+        for (size_t triIndex = 0; triIndex < block.TriangleCount; ++triIndex)
+        {
+            const Triangle* tri = triangles[block.FirstTriangle + triIndex];
+
+            for (size_t cornerIndex = 0; cornerIndex < 3; ++cornerIndex)
+            {
+                const Vertex& vertex = tri->Vertex[cornerIndex];
+                const uint32_t hash = HashVertex(vertex.DCCVertexIndex, vertex.Position, vertex.Normal);
+
+                auto& slot = table.Lookup(block.Vertices, hash, vertex.DCCVertexIndex, vertex.Position, vertex.Normal);
+                if (slot.Index == c_invalidIndex)
+                {
+                    slot.Hash = hash;
+                    slot.Index = static_cast<uint32_t>(block.Vertices.size());
+
+                    block.Vertices.DCCVertexIndex.push_back(vertex.DCCVertexIndex);
+                    block.Vertices.Position.push_back(vertex.Position);
+                    block.Vertices.Normal.push_back(vertex.Normal);
+                    block.Hashes.push_back(hash);
+                }
+
+                block.LocalIndices[triIndex * 3 + cornerIndex] = slot.Index;
+            }
+        }
+    });
+
+    // Merge the blocks in triangle order. Only each block's unique vertices are visited here,
+    // and since blocks are contiguous this assigns the same indices as a serial weld would.
+    size_t uniqueCount = 0;
+    for (auto& block : blocks)
+    {
+        uniqueCount += block.Vertices.size();
+    }
+
+    vertices.DCCVertexIndex.assign(dccVertexCount, c_invalidIndex);
+    vertices.Position.assign(dccVertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+    vertices.Normal.assign(dccVertexCount, XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+    WeldTable table(uniqueCount);
+
+    for (auto& block : blocks)
+    {
+        block.Remap.resize(block.Vertices.size());
+
+        for (size_t i = 0; i < block.Vertices.size(); ++i)
+        {
+            const uint32_t dccIndex = block.Vertices.DCCVertexIndex[i];
+            const XMFLOAT3& position = block.Vertices.Position[i];
+            const XMFLOAT3& normal = block.Vertices.Normal[i];
+
+            auto& slot = table.Lookup(vertices, block.Hashes[i], dccIndex, position, normal);
+            if (slot.Index == c_invalidIndex)
+            {
+                slot.Hash = block.Hashes[i];
+
+                // The first vertex for a DCC vertex keeps its index; other variants are appended.
+                if (vertices.DCCVertexIndex[dccIndex] == c_invalidIndex)
+                {
+                    slot.Index = dccIndex;
+
+                    vertices.DCCVertexIndex[dccIndex] = dccIndex;
+                    vertices.Position[dccIndex] = position;
+                    vertices.Normal[dccIndex] = normal;
+                }
+                else
+                {
+                    slot.Index = static_cast<uint32_t>(vertices.size());
+
+                    vertices.DCCVertexIndex.push_back(dccIndex);
+                    vertices.Position.push_back(position);
+                    vertices.Normal.push_back(normal);
+                }
+            }
+
+            block.Remap[i] = slot.Index;
+        }
+    }
+
+    // Resolve the final index of every corner.
+    cornerIndices.resize(triangles.size() * 3);
+
+    ParallelFor(blocks.size(), [&](size_t blockIndex)
+    {
+        WeldBlock& block = blocks[blockIndex];
+        uint32_t* dest = cornerIndices.data() + block.FirstTriangle * 3;
+
+        for (size_t i = 0; i < block.LocalIndices.size(); ++i)
+        {
+            dest[i] = block.Remap[block.LocalIndices[i]];
+        }
+
+        block = WeldBlock();
+    });
+}
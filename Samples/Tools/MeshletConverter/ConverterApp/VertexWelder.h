@@ -0,0 +1,54 @@
+//--------------------------------------------------------------------------------------
+// VertexWelder.h
+//
+// Advanced Technology Group (ATG)
+// Copyright (C) Microsoft Corporation. All rights reserved.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "TriangleAllocator.h"
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace ATG
+{
+    // Flat structure-of-arrays vertex storage
+    struct VertexStore
+    {
+        std::vector<uint32_t>           DCCVertexIndex;
+        std::vector<DirectX::XMFLOAT3>  Position;
+        std::vector<DirectX::XMFLOAT3>  Normal;
+
+        size_t size() const { return DCCVertexIndex.size(); }
+
+        void clear()
+        {
+            DCCVertexIndex.clear();
+            Position.clear();
+            Normal.clear();
+        }
+    };
+
+    // Collapses triangle corners which share a DCC vertex, position and normal into a single
+    // vertex, while retaining the duplicates needed for split normals.
+    //
+    // The first distinct vertex found for each DCC vertex keeps its DCC index, and further
+    // distinct vertices are appended after the DCC vertex range in the order they are first
+    // referenced. Slots of DCC vertices which are never referenced hold UINT32_MAX as their
+    // DCCVertexIndex.
+    //
+    // Triangles are welded in parallel blocks, each using a flat open-addressing hash table,
+    // and the unique vertices of each block are then merged in order. The result matches a
+    // serial weld exactly.
+    class VertexWelder
+    {
+    public:
+        // Writes one index per triangle corner (triangle * 3 + corner) into cornerIndices.
+        static void Weld(
+            const TriangleArray& triangles,
+            uint32_t dccVertexCount,
+            VertexStore& vertices,
+            std::vector<uint32_t>& cornerIndices);
+    };
+}
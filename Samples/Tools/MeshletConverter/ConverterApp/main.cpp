@@ -36,6 +36,7 @@ namespace
         std::cout << "\t-fz           -- Flips the Z axis of the scene geometry. Default is false" << std::endl;
         std::cout << "\t-ft           -- Flips the triangle winding of the scene geometry. Default is false" << std::endl;
         std::cout << "\t-t            -- Triangulates scene meshes file using FbxGeometryConverter. Default is false" << std::endl;
+        std::cout << "\t-m <int>      -- Specifies the memory budget in MB for meshes being processed concurrently. Default is 4096" << std::endl;
         std::cout << std::endl;
 
         std::cout << "Example:" << std::endl;
@@ -134,6 +135,23 @@ namespace
                 std::cout << "Flipping triangle winding order." << std::endl;
                 options.FlipTriangles = true;
             }
+            else if (std::strcmp(args[i], "-m") == 0)
+            {
+                if (i + 1 == argc)
+                {
+                    std::cout << "Must provide an integral value for memory budget if supplying -m switch." << std::endl;
+                    return false;
+                }
+
+                uint32_t budget = std::strtoul(args[++i], nullptr, 10);
+                if (budget == 0)
+                {
+                    std::cout << "Memory budget must be at least 1 MB." << std::endl;
+                    budget = 1;
+                }
+
+                options.MemoryBudgetMB = budget;
+            }
             else
             {
                 files.push_back(args[i]);
@@ -142,6 +160,7 @@ namespace
 
         std::cout << "Using meshlet size - Vertices: " << options.MeshletMaxVerts << "   Primitives: " << options.MeshletMaxPrims <<  std::endl;
         std::cout << "Using global scale factor - " << options.UnitScale << std::endl;
+        std::cout << "Using memory budget - " << options.MemoryBudgetMB << " MB" << std::endl;
 
         return true;
     }
@@ -154,7 +173,7 @@ int main(int argc, const char* args[])
     ImportOptions options;
     ParseCommandLine(argc, args, files, options);
 
-    std::vector<MeshletSet> meshlets;
+    MeshletPipeline pipeline(size_t(options.MemoryBudgetMB) * 1024 * 1024);
 
     bool allSucceeded = true;
     for (auto& filename : files)
@@ -163,28 +182,32 @@ int main(int argc, const char* args[])
 
         auto loc = filename.find_last_of(".");
         auto fileType = filename.substr(loc + 1);
+        auto path = filename.substr(0, loc) + ".bin";
+
+        // Meshlet sets are streamed to a temporary file as each mesh completes, which only
+        // replaces the output once the whole import has succeeded.
+        pipeline.Begin(path.c_str());
+
         bool success = false;
         if (fileType.compare("sdkmesh") == 0)
         {
-            success = ImportFileSDKMesh(filename.c_str(), options, meshlets);
+            success = ImportFileSDKMesh(filename.c_str(), options, pipeline);
         }
         else
         {
-            success = ImportFile(filename.c_str(), options, meshlets);
+            success = ImportFile(filename.c_str(), options, pipeline);
         }
 
+        const bool written = pipeline.End(success);
+
         if (success)
         {
-            
-            auto path = filename.substr(0, loc) + ".bin";
-
-            if (MeshletSet::Write(path.c_str(), meshlets))
+            if (written)
             {
-                std::cout << "Wrote " << meshlets.size() << " set(s) of meshlets from file \"" << filename << "\"." << std::endl;
+                std::cout << "Wrote " << pipeline.GetSetCount() << " set(s) of meshlets from file \"" << filename << "\"." << std::endl;
             }
             else
             {
-                std::cout << "Failed to open file \"" << path << "\" for writing." << std::endl;
                 allSucceeded = false;
             }
         }
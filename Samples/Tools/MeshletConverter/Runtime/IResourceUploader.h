@@ -18,7 +18,7 @@ public:
     // - Local copy from 'data' to the allocation
     // - Schedule and execute a copy operation on a command list
     // - Use a fence to manage the lifetime of the upload heap resource
-    virtual void Upload(ID3D12Resource* dest, void* data, uint32_t byteSize) = 0;
+    virtual void Upload(ID3D12Resource* dest, const void* data, uint32_t byteSize) = 0;
 
     // Helper function to transition copied resources
     virtual void Transition(ID3D12Resource* resource, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState) = 0;
@@ -39,6 +39,30 @@ namespace ATG
         uint32_t Offset;
     };
 
+    // Read-only view of an array owned by a MeshletSet, pointing either into a memory-mapped
+    // meshlet file or into arrays read from a stream.
+    template <typename T>
+    class MeshletSpan
+    {
+    public:
+        MeshletSpan() noexcept : m_data(nullptr), m_size(0) {}
+        MeshletSpan(const T* data, size_t size) noexcept : m_data(data), m_size(size) {}
+
+        const T*        data() const noexcept { return m_data; }
+        size_t          size() const noexcept { return m_size; }
+        bool            empty() const noexcept { return m_size == 0; }
+
+        const T*        begin() const noexcept { return m_data; }
+        const T*        end() const noexcept { return m_data + m_size; }
+
+        const T&        operator[](size_t index) const noexcept { return m_data[index]; }
+        const T&        back() const noexcept { return m_data[m_size - 1]; }
+
+    private:
+        const T*        m_data;
+        size_t          m_size;
+    };
+
     class MeshletSet
     {
     public:
@@ -64,8 +88,8 @@ namespace ATG
         uint32_t        InstancesPerDispatch(uint32_t groupSize) const;
 
         // Accessors for vertex index & primitive data
-        uint32_t        GetVertexIndex(uint32_t index);
-        void            GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2);
+        uint32_t        GetVertexIndex(uint32_t index) const;
+        void            GetPrimitive(uint32_t index, uint32_t& v0, uint32_t& v1, uint32_t& v2) const;
 
         void            CreateResources(ID3D12Device* device, IResourceUploader* uploader);
 
@@ -82,7 +106,12 @@ namespace ATG
         ID3D12Resource* GetPrimitiveBuffer() const { return m_primitiveBuffer.Get(); }
         ID3D12Resource* GetMeshInfoBuffer() const { return m_meshInfoBuffer.Get(); }
 
+        // Reads a set in the unaligned layout used up to MESHLET_VERSION_GEN_UPDATE into owned arrays.
         void Read(std::istream& stream);
+
+        // Current files are memory-mapped and the raw meshlet data points straight into the
+        // mapping, which stays open until the last MeshletSet referencing it is destroyed.
+        // Older files are read through a stream.
         static std::vector<MeshletSet> ReadMeshlets(const wchar_t* filePath);
 
     private:
@@ -110,11 +139,13 @@ namespace ATG
         uint32_t                    m_maxPrims;
         DXGI_FORMAT                 m_indexFormat;
 
-        std::vector<Submesh>        m_submeshes;
-        std::vector<Meshlet>        m_meshletData;
-        std::vector<CullData>       m_cullData;
-        std::vector<uint8_t>        m_uniqueIndexData;
-        std::vector<PackedIndices>  m_primitiveData;
+        std::shared_ptr<const void> m_storage;      // Keeps the arrays below alive
+
+        MeshletSpan<Submesh>        m_submeshes;
+        MeshletSpan<Meshlet>        m_meshletData;
+        MeshletSpan<CullData>       m_cullData;
+        MeshletSpan<uint8_t>        m_uniqueIndexData;
+        MeshletSpan<PackedIndices>  m_primitiveData;
 
     private:
         Microsoft::WRL::ComPtr<ID3D12Resource> m_meshletBuffer;
@@ -33,12 +33,17 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cwchar>
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <list>
 #include <locale>
 #include <memory>
 #include <set>
+#include <system_error>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #ifndef NTDDI_WIN10_FE
 #undef WINAPI_FAMILY_PARTITION
@@ -110,6 +115,8 @@ enum OPTIONS : uint32_t
     OPT_NOLOGO,
     OPT_TIMING,
     OPT_FILELIST,
+    OPT_STORED,
+    OPT_CHUNKSIZE,
     OPT_MAX
 };
 
@@ -140,6 +147,8 @@ const SValue g_pOptions[] =
     { L"nologo",    OPT_NOLOGO },
     { L"timing",    OPT_TIMING },
     { L"flist",     OPT_FILELIST },
+    { L"s",         OPT_STORED },
+    { L"chunk",     OPT_CHUNKSIZE },
     { nullptr,      0 }
 };
 
@@ -349,6 +358,9 @@ namespace
             L"   -r                  wildcard filename search is recursive\n"
             L"   -u                  uncompress files rather than compress\n"
             L"   -z                  compress with MSZIP rather than LZMS\n"
+            L"   -s                  store chunks without compression (portable test files)\n"
+            L"   -chunk <kbytes>     size of independently compressed chunks (defaults to 1024)\n"
+            L"                       0 writes a version 'A' file as a single compressed buffer\n"
             L"   -l                  force output filename to lower case\n"
             L"   -y                  overwrite existing output file (if any)\n"
             L"   -nologo             suppress copyright message\n"
@@ -456,7 +468,12 @@ namespace
     // Files generated by this tool, however, are not compatible with EXPAND.EXE or GnuWin32 MSCOMPRESS.EXE.
 
     constexpr uint8_t c_CFileSignatureLen = 8;
-    constexpr uint8_t c_CFileVersion = 0x41;
+    constexpr uint8_t c_CFileVersion = 0x41;        // Single Compression API buffer
+    constexpr uint8_t c_CFileVersionChunked = 0x42; // Independently compressed chunks with an offset table
+
+    constexpr uint8_t c_ModeStored = 0;             // Chunks are stored without compression
+
+    constexpr uint32_t c_DefaultChunkSize = 1024 * 1024;
 
     const uint8_t c_Signature[c_CFileSignatureLen] = { 0x41, 0x46, 0x43, 0x57, 0x47, 0x50, 0x53, 0x4d };
 
@@ -469,9 +486,18 @@ namespace
         wchar_t     lastChar;
         uint32_t    uncompressedSize;
     };
+
+    // Follows CFileHeader in version 'B' files, and is followed by chunkCount + 1 offsets
+    // of the compressed chunks relative to the end of the offset table.
+    struct CChunkHeader
+    {
+        uint32_t    chunkSize;                  // Uncompressed size of every chunk but the last
+        uint32_t    chunkCount;
+    };
 #pragma pack(pop)
 
     static_assert(sizeof(CFileHeader) == 16, "File header size mismatch");
+    static_assert(sizeof(CChunkHeader) == 8, "Chunk header size mismatch");
 
     PVOID SimpleAlloc(PVOID, SIZE_T Size)
     {
@@ -608,6 +634,389 @@ namespace
 
     struct decompressor_closer { void operator()(void* h) { if (h) CloseDecompressor(static_cast<DECOMPRESSOR_HANDLE>(h)); } };
 
+    //----------------------------------------------------------------------------------
+    // Version 'B' files split the data into independently compressed chunks, so they can
+    // be compressed and expanded on all cores and read back a byte range at a time.
+    //----------------------------------------------------------------------------------
+
+    // Encodes or decodes a single chunk. Encoders return ERROR_INSUFFICIENT_BUFFER if the chunk
+    // doesn't shrink, in which case it is written as-is.
+    using ChunkCodec = std::function<HRESULT(const void* src, size_t srcLen, void* dest, size_t destLen, size_t& outLen)>;
+
+    HRESULT CreateChunkCodec(uint8_t mode, bool encode, ChunkCodec& codec)
+    {
+        codec = nullptr;
+
+        switch (mode)
+        {
+        case c_ModeStored:
+            // Portable 'codec' for testing readers without the Compression API.
+            codec = [encode](const void* src, size_t srcLen, void* dest, size_t destLen, size_t& outLen) -> HRESULT
+                {
+                    outLen = 0;
+                    if (encode || srcLen > destLen)
+                        return HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER);
+
+                    memcpy(dest, src, srcLen);
+                    outLen = srcLen;
+                    return S_OK;
+                };
+            return S_OK;
+
+        case COMPRESS_ALGORITHM_MSZIP:
+        case COMPRESS_ALGORITHM_LZMS:
+            break;
+
+        default:
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        static COMPRESS_ALLOCATION_ROUTINES s_allocData = { SimpleAlloc, SimpleFree, nullptr };
+
+        if (encode)
+        {
+            COMPRESSOR_HANDLE h = nullptr;
+            if (!CreateCompressor(mode, &s_allocData, &h))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            std::shared_ptr<void> compressor(h, compressor_closer());
+
+            if (mode == COMPRESS_ALGORITHM_LZMS)
+            {
+                DWORD blockSize = 1 * 1024 * 1024; // 1 MB recommended for LZMS
+
+                if (!SetCompressorInformation(
+                    h,
+                    COMPRESS_INFORMATION_CLASS_BLOCK_SIZE,
+                    &blockSize,
+                    sizeof(DWORD)))
+                {
+                    return HRESULT_FROM_WIN32(GetLastError());
+                }
+            }
+
+            codec = [compressor](const void* src, size_t srcLen, void* dest, size_t destLen, size_t& outLen) -> HRESULT
+                {
+                    SIZE_T size = 0;
+                    if (!Compress(static_cast<COMPRESSOR_HANDLE>(compressor.get()), src, srcLen, dest, destLen, &size))
+                    {
+                        outLen = 0;
+                        return HRESULT_FROM_WIN32(GetLastError());
+                    }
+
+                    outLen = size;
+                    return S_OK;
+                };
+        }
+        else
+        {
+            DECOMPRESSOR_HANDLE h = nullptr;
+            if (!CreateDecompressor(mode, &s_allocData, &h))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            std::shared_ptr<void> decompressor(h, decompressor_closer());
+
+            codec = [decompressor](const void* src, size_t srcLen, void* dest, size_t destLen, size_t& outLen) -> HRESULT
+                {
+                    SIZE_T size = 0;
+                    if (!Decompress(static_cast<DECOMPRESSOR_HANDLE>(decompressor.get()), src, srcLen, dest, destLen, &size))
+                    {
+                        outLen = 0;
+                        return HRESULT_FROM_WIN32(GetLastError());
+                    }
+
+                    outLen = size;
+                    return S_OK;
+                };
+        }
+
+        return S_OK;
+    }
+
+    // Calls func(chunk, codec) for chunks [0, count) on all cores. Compression API handles are not
+    // thread-safe, so every worker thread creates its own codec.
+    template<typename Func>
+    HRESULT ParallelForChunks(size_t count, uint8_t mode, bool encode, const Func& func)
+    {
+        std::atomic<size_t> nextChunk(0);
+        std::atomic<HRESULT> result(S_OK);
+
+        auto worker = [&]()
+            {
+                HRESULT hr = S_OK;
+                try
+                {
+                    ChunkCodec codec;
+                    hr = CreateChunkCodec(mode, encode, codec);
+                    while (SUCCEEDED(hr))
+                    {
+                        const size_t chunk = nextChunk.fetch_add(1);
+                        if (chunk >= count || FAILED(result.load(std::memory_order_relaxed)))
+                            break;
+
+                        hr = func(chunk, codec);
+                    }
+                }
+                catch (const std::bad_alloc&)
+                {
+                    hr = E_OUTOFMEMORY;
+                }
+
+                if (FAILED(hr))
+                {
+                    HRESULT expected = S_OK;
+                    (void)result.compare_exchange_strong(expected, hr);
+                }
+            };
+
+        const size_t threadCount = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u), count);
+
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (size_t j = 1; j < threadCount; ++j)
+        {
+            try
+            {
+                threads.emplace_back(worker);
+            }
+            catch (const std::system_error&)
+            {
+                break;
+            }
+        }
+
+        // The calling thread works as well, so this still makes progress if no threads could be started.
+        worker();
+
+        for (auto& t : threads)
+        {
+            t.join();
+        }
+
+        return result;
+    }
+
+    HRESULT CompressFileChunked(
+        _In_reads_bytes_(dataLen) const void* data,
+        size_t dataLen,
+        uint8_t mode,
+        wchar_t origChar,
+        uint32_t chunkSize,
+        const wchar_t* compressFile)
+    {
+        if (!data || !dataLen || !chunkSize || !compressFile)
+            return E_INVALIDARG;
+
+        if (dataLen > UINT32_MAX)
+        {
+            return E_FAIL;
+        }
+
+        auto src = static_cast<const uint8_t*>(data);
+        const size_t chunkCount = (dataLen + chunkSize - 1) / chunkSize;
+
+        // Chunks which don't shrink are left empty here and written from the source data.
+        std::unique_ptr<std::unique_ptr<uint8_t[]>[]> chunks(new (std::nothrow) std::unique_ptr<uint8_t[]>[chunkCount]);
+        std::unique_ptr<uint32_t[]> offsets(new (std::nothrow) uint32_t[chunkCount + 1]);
+        if (!chunks || !offsets)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        HRESULT hr = ParallelForChunks(chunkCount, mode, true,
+            [&](size_t chunk, const ChunkCodec& codec) -> HRESULT
+            {
+                const size_t chunkBegin = chunk * chunkSize;
+                const size_t chunkLen = std::min<size_t>(chunkSize, dataLen - chunkBegin);
+
+                std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[chunkLen]);
+                if (!buffer)
+                {
+                    return E_OUTOFMEMORY;
+                }
+
+                size_t compressedSize = 0;
+                const HRESULT codecResult = codec(src + chunkBegin, chunkLen, buffer.get(), chunkLen, compressedSize);
+                if (codecResult == HRESULT_FROM_WIN32(ERROR_INSUFFICIENT_BUFFER) || (SUCCEEDED(codecResult) && compressedSize >= chunkLen))
+                {
+                    // Sizes are only written after all chunks finish, so store the length here for now.
+                    offsets[chunk + 1] = static_cast<uint32_t>(chunkLen);
+                    return S_OK;
+                }
+                else if (FAILED(codecResult))
+                {
+                    return codecResult;
+                }
+
+                offsets[chunk + 1] = static_cast<uint32_t>(compressedSize);
+                chunks[chunk] = std::move(buffer);
+                return S_OK;
+            });
+        if (FAILED(hr))
+            return hr;
+
+        // Convert the compressed chunk lengths into offsets.
+        uint64_t total = 0;
+        offsets[0] = 0;
+        for (size_t j = 1; j <= chunkCount; ++j)
+        {
+            total += offsets[j];
+            offsets[j] = static_cast<uint32_t>(total);
+        }
+
+        const uint64_t tableSize = sizeof(uint32_t) * (uint64_t(chunkCount) + 1);
+        if ((total + tableSize) > (UINT32_MAX - sizeof(CFileHeader) - sizeof(CChunkHeader)))
+        {
+            return E_FAIL;
+        }
+
+        // Create compressed file.
+        ScopedHandle hFile(safe_handle(CreateFile2(compressFile, GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr)));
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        auto_delete_file delonfail(hFile.get());
+
+        // Write headers and chunk offset table.
+        CFileHeader fileHeader = {};
+        memcpy(fileHeader.magic, c_Signature, c_CFileSignatureLen);
+        fileHeader.mode = mode;
+        fileHeader.version = c_CFileVersionChunked;
+        fileHeader.lastChar = origChar;
+        fileHeader.uncompressedSize = static_cast<DWORD>(dataLen);
+
+        CChunkHeader chunkHeader = {};
+        chunkHeader.chunkSize = chunkSize;
+        chunkHeader.chunkCount = static_cast<uint32_t>(chunkCount);
+
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), &fileHeader, static_cast<DWORD>(sizeof(CFileHeader)), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != sizeof(CFileHeader))
+            return E_FAIL;
+
+        if (!WriteFile(hFile.get(), &chunkHeader, static_cast<DWORD>(sizeof(CChunkHeader)), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != sizeof(CChunkHeader))
+            return E_FAIL;
+
+        if (!WriteFile(hFile.get(), offsets.get(), static_cast<DWORD>(tableSize), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != static_cast<DWORD>(tableSize))
+            return E_FAIL;
+
+        // Write compressed chunks.
+        for (size_t j = 0; j < chunkCount; ++j)
+        {
+            const DWORD chunkBytes = offsets[j + 1] - offsets[j];
+            const void* chunkData = (chunks[j]) ? chunks[j].get() : (src + j * chunkSize);
+
+            if (!WriteFile(hFile.get(), chunkData, chunkBytes, &bytesWritten, nullptr))
+                return HRESULT_FROM_WIN32(GetLastError());
+
+            if (bytesWritten != chunkBytes)
+                return E_FAIL;
+        }
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+
+    HRESULT DecompressFileChunked(
+        _In_reads_bytes_(dataLen) const void* data,
+        size_t dataLen,
+        const wchar_t* fileName)
+    {
+        if (dataLen < (sizeof(CFileHeader) + sizeof(CChunkHeader)))
+            return E_FAIL;
+
+        auto hdr = reinterpret_cast<const CFileHeader*>(data);
+        auto chunkHdr = reinterpret_cast<const CChunkHeader*>(reinterpret_cast<const uint8_t*>(data) + sizeof(CFileHeader));
+
+        const size_t expandedSize = hdr->uncompressedSize;
+        const size_t chunkSize = chunkHdr->chunkSize;
+        const size_t chunkCount = chunkHdr->chunkCount;
+        if (!expandedSize || !chunkSize || chunkCount != (expandedSize + chunkSize - 1) / chunkSize)
+            return E_FAIL;
+
+        const size_t tableSize = sizeof(uint32_t) * (chunkCount + 1);
+        if ((dataLen - sizeof(CFileHeader) - sizeof(CChunkHeader)) < tableSize)
+            return E_FAIL;
+
+        auto offsets = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(chunkHdr) + sizeof(CChunkHeader));
+        auto payload = reinterpret_cast<const uint8_t*>(offsets) + tableSize;
+        const size_t payloadLen = dataLen - sizeof(CFileHeader) - sizeof(CChunkHeader) - tableSize;
+
+        if (offsets[0] != 0 || offsets[chunkCount] > payloadLen)
+            return E_FAIL;
+
+        for (size_t j = 0; j < chunkCount; ++j)
+        {
+            if (offsets[j + 1] < offsets[j])
+                return E_FAIL;
+        }
+
+        std::unique_ptr<uint8_t[]> expandedData(new (std::nothrow) uint8_t[expandedSize]);
+        if (!expandedData)
+        {
+            return E_OUTOFMEMORY;
+        }
+
+        HRESULT hr = ParallelForChunks(chunkCount, hdr->mode, false,
+            [&](size_t chunk, const ChunkCodec& codec) -> HRESULT
+            {
+                const size_t chunkBegin = chunk * chunkSize;
+                const size_t chunkLen = std::min(chunkSize, expandedSize - chunkBegin);
+                const size_t srcLen = offsets[chunk + 1] - offsets[chunk];
+
+                if (srcLen == chunkLen)
+                {
+                    memcpy(expandedData.get() + chunkBegin, payload + offsets[chunk], chunkLen);
+                    return S_OK;
+                }
+
+                size_t outLen = 0;
+                const HRESULT codecResult = codec(payload + offsets[chunk], srcLen, expandedData.get() + chunkBegin, chunkLen, outLen);
+                if (FAILED(codecResult))
+                    return codecResult;
+
+                // Ensure our header and the compression API agree.
+                return (outLen == chunkLen) ? S_OK : E_FAIL;
+            });
+        if (FAILED(hr))
+            return hr;
+
+        // Create expanded file.
+        ScopedHandle hFile(safe_handle(CreateFile2(fileName, GENERIC_WRITE, 0, CREATE_ALWAYS, nullptr)));
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        auto_delete_file delonfail(hFile.get());
+
+        DWORD bytesWritten;
+        if (!WriteFile(hFile.get(), expandedData.get(), static_cast<DWORD>(expandedSize), &bytesWritten, nullptr))
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        if (bytesWritten != expandedSize)
+            return E_FAIL;
+
+        delonfail.clear();
+
+        return S_OK;
+    }
+
     HRESULT DecompressFile(
         _In_reads_bytes_(dataLen) const void* data,
         size_t dataLen,
@@ -623,6 +1032,9 @@ namespace
         if (memcmp(hdr, c_Signature, c_CFileSignatureLen) != 0)
             return E_FAIL;
 
+        if (hdr->version == c_CFileVersionChunked)
+            return DecompressFileChunked(data, dataLen, fileName);
+
         if (hdr->version != c_CFileVersion)
             return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
 
@@ -739,6 +1151,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
     // Process command line
     uint32_t options = 0;
+    uint32_t chunkSize = c_DefaultChunkSize;
     std::list<SConversion> conversion;
 
     for (int iArg = 1; iArg < argc; iArg++)
@@ -769,6 +1182,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             switch (dwOption)
             {
             case OPT_FILELIST:
+            case OPT_CHUNKSIZE:
                 if (!*pValue)
                 {
                     if ((iArg + 1 >= argc))
@@ -799,6 +1213,20 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 ProcessFileList(inFile, conversion);
             }
             break;
+
+            case OPT_CHUNKSIZE:
+            {
+                uint32_t chunkKB = 0;
+                if (swscanf_s(pValue, L"%u", &chunkKB) != 1 || chunkKB > (1024 * 1024))
+                {
+                    wprintf(L"Invalid value specified with -chunk (%ls)\n\n", pValue);
+                    PrintUsage(argv[0]);
+                    return 1;
+                }
+
+                chunkSize = chunkKB * 1024;
+            }
+            break;
             }
         }
         else if (wcspbrk(pArg, L"?*") != nullptr)
@@ -820,6 +1248,25 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
     }
 
+    if ((options & (1 << OPT_STORED)) && !chunkSize)
+    {
+        wprintf(L"ERROR: -s requires a non-zero -chunk size\n");
+        return 1;
+    }
+
+    uint8_t mode = COMPRESS_ALGORITHM_LZMS;
+    const wchar_t* modeName = L"LZMS";
+    if (options & (1 << OPT_STORED))
+    {
+        mode = c_ModeStored;
+        modeName = L"STORED";
+    }
+    else if (options & (1 << OPT_MSZIP))
+    {
+        mode = COMPRESS_ALGORITHM_MSZIP;
+        modeName = L"MSZIP";
+    }
+
     if (conversion.empty())
     {
         wprintf(L"ERROR: Need at least 1 file.\n\n");
@@ -877,7 +1324,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
 
             wprintf(L"compressing [%ls] %ls",
-                (options& (1 << OPT_MSZIP)) ? L"MSZIP" : L"LZMS",
+                modeName,
                 pConv->szSrc);
             fflush(stdout);
         }
@@ -913,7 +1360,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 continue;
             }
 
-            if (hdr->version != c_CFileVersion)
+            if (hdr->version != c_CFileVersion && hdr->version != c_CFileVersionChunked)
             {
                 wprintf(L" FAILED - Unknown compress header version (%u).\n", hdr->version);
                 retVal = 1;
@@ -971,11 +1418,13 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         {
             hr = DecompressFile(blob.get(), blobSize, destName);
         }
+        else if (chunkSize > 0)
+        {
+            hr = CompressFileChunked(blob.get(), blobSize, mode, origChar, chunkSize, destName);
+        }
         else
         {
-            hr = CompressFile(blob.get(), blobSize,
-                (options & (1 << OPT_MSZIP)) ? COMPRESS_ALGORITHM_MSZIP : COMPRESS_ALGORITHM_LZMS,
-                origChar, destName);
+            hr = CompressFile(blob.get(), blobSize, mode, origChar, destName);
         }
         if (FAILED(hr))
         {
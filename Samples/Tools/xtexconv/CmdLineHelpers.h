@@ -99,27 +99,26 @@ namespace Helpers
         wprintf(L"*UNKNOWN*");
     }
 
-    void PrintFormat(DXGI_FORMAT Format, const SValue<DXGI_FORMAT>* pFormatList1, const SValue<DXGI_FORMAT>* pFormatList2) noexcept
+    const wchar_t* GetFormatName(DXGI_FORMAT Format, const SValue<DXGI_FORMAT>* pFormatList1, const SValue<DXGI_FORMAT>* pFormatList2) noexcept
     {
         for (auto pFormat = pFormatList1; pFormat->name; pFormat++)
         {
             if (pFormat->value == Format)
-            {
-                wprintf(L"%ls", pFormat->name);
-                return;
-            }
+                return pFormat->name;
         }
 
         for (auto pFormat = pFormatList2; pFormat->name; pFormat++)
         {
             if (pFormat->value == Format)
-            {
-                wprintf(L"%ls", pFormat->name);
-                return;
-            }
+                return pFormat->name;
         }
 
-        wprintf(L"*UNKNOWN*");
+        return L"*UNKNOWN*";
+    }
+
+    void PrintFormat(DXGI_FORMAT Format, const SValue<DXGI_FORMAT>* pFormatList1, const SValue<DXGI_FORMAT>* pFormatList2) noexcept
+    {
+        wprintf(L"%ls", GetFormatName(Format, pFormatList1, pFormatList2));
     }
 
     template<typename T>
@@ -338,7 +337,7 @@ namespace Helpers
 
     const wchar_t* GetErrorDesc(HRESULT hr) noexcept
     {
-        static wchar_t desc[1024] = {};
+        static thread_local wchar_t desc[1024] = {};
 
         LPWSTR errorText = nullptr;
 
@@ -24,13 +24,16 @@
 #endif
 
 #include <ShlObj.h>
+#include <bcrypt.h>
 
 #if __cplusplus < 201703L
 #error Requires C++17 (and /Zc:__cplusplus with MSVC)
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdarg>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
@@ -44,9 +47,12 @@
 #include <list>
 #include <locale>
 #include <memory>
+#include <mutex>
 #include <new>
 #include <string>
+#include <thread>
 #include <tuple>
+#include <vector>
 
 #include <wrl\client.h>
 
@@ -145,6 +151,7 @@ namespace
         OPT_RECONSTRUCT_Z,
         OPT_BCNONMULT4FIX,
         OPT_IGNORE_SRGB_METADATA,
+        OPT_BENCHMARK_CONVERT,
     #ifdef USE_XBOX_EXTS
         OPT_USE_XBOX,
         OPT_XGMODE,
@@ -172,6 +179,9 @@ namespace
         OPT_ROTATE_COLOR,
         OPT_PAPER_WHITE_NITS,
         OPT_SWIZZLE,
+        OPT_JOBS,
+        OPT_CACHE,
+        OPT_TIMING_REPORT,
         OPT_VERSION,
         OPT_HELP,
     };
@@ -274,7 +284,9 @@ namespace
         { L"alpha-threshold",       OPT_ALPHA_THRESHOLD },
         { L"alpha-weight",          OPT_ALPHA_WEIGHT },
         { L"bad-tails",             OPT_DDS_BAD_DXTN_TAILS },
+        { L"benchmark-convert",     OPT_BENCHMARK_CONVERT },
         { L"block-compress",        OPT_BC_COMPRESS },
+        { L"cache",                 OPT_CACHE },
         { L"color-key",             OPT_COLORKEY },
         { L"dword-alignment",       OPT_DDS_DWORD_ALIGN },
         { L"expand-luminance",      OPT_EXPAND_LUMINANCE },
@@ -291,6 +303,7 @@ namespace
         { L"ignore-srgb",           OPT_IGNORE_SRGB_METADATA },
         { L"image-filter",          OPT_FILTER },
         { L"invert-y",              OPT_INVERT_Y },
+        { L"jobs",                  OPT_JOBS },
         { L"keep-coverage",         OPT_PRESERVE_ALPHA_COVERAGE },
         { L"mip-levels",            OPT_MIPLEVELS },
         { L"normal-map-amplitude",  OPT_NORMAL_MAP_AMPLITUDE },
@@ -310,6 +323,7 @@ namespace
         { L"swizzle",               OPT_SWIZZLE },
         { L"tga-zero-alpha",        OPT_TGAZEROALPHA },
         { L"timing",                OPT_TIMING },
+        { L"timing-report",         OPT_TIMING_REPORT },
         { L"to-lowercase",          OPT_TOLOWER },
         { L"tonemap",               OPT_TONEMAP },
         { L"typeless-unorm",        OPT_TYPELESS_UNORM },
@@ -525,18 +539,24 @@ namespace
         { L"FANT",                      TEX_FILTER_FANT },
         { L"BOX",                       TEX_FILTER_BOX },
         { L"TRIANGLE",                  TEX_FILTER_TRIANGLE },
+        { L"LANCZOS",                   TEX_FILTER_LANCZOS },
+        { L"KAISER",                    TEX_FILTER_KAISER },
         { L"POINT_DITHER",              TEX_FILTER_POINT | TEX_FILTER_DITHER },
         { L"LINEAR_DITHER",             TEX_FILTER_LINEAR | TEX_FILTER_DITHER },
         { L"CUBIC_DITHER",              TEX_FILTER_CUBIC | TEX_FILTER_DITHER },
         { L"FANT_DITHER",               TEX_FILTER_FANT | TEX_FILTER_DITHER },
         { L"BOX_DITHER",                TEX_FILTER_BOX | TEX_FILTER_DITHER },
         { L"TRIANGLE_DITHER",           TEX_FILTER_TRIANGLE | TEX_FILTER_DITHER },
+        { L"LANCZOS_DITHER",            TEX_FILTER_LANCZOS | TEX_FILTER_DITHER },
+        { L"KAISER_DITHER",             TEX_FILTER_KAISER | TEX_FILTER_DITHER },
         { L"POINT_DITHER_DIFFUSION",    TEX_FILTER_POINT | TEX_FILTER_DITHER_DIFFUSION },
         { L"LINEAR_DITHER_DIFFUSION",   TEX_FILTER_LINEAR | TEX_FILTER_DITHER_DIFFUSION },
         { L"CUBIC_DITHER_DIFFUSION",    TEX_FILTER_CUBIC | TEX_FILTER_DITHER_DIFFUSION },
         { L"FANT_DITHER_DIFFUSION",     TEX_FILTER_FANT | TEX_FILTER_DITHER_DIFFUSION },
         { L"BOX_DITHER_DIFFUSION",      TEX_FILTER_BOX | TEX_FILTER_DITHER_DIFFUSION },
         { L"TRIANGLE_DITHER_DIFFUSION", TEX_FILTER_TRIANGLE | TEX_FILTER_DITHER_DIFFUSION },
+        { L"LANCZOS_DITHER_DIFFUSION",  TEX_FILTER_LANCZOS | TEX_FILTER_DITHER_DIFFUSION },
+        { L"KAISER_DITHER_DIFFUSION",   TEX_FILTER_KAISER | TEX_FILTER_DITHER_DIFFUSION },
         { nullptr,                      TEX_FILTER_DEFAULT                              }
     };
 
@@ -663,57 +683,156 @@ namespace
         return ((x != 0) && !(x & (x - 1)));
     }
 
-    void PrintInfo(const TexMetadata& info, bool isXbox) noexcept
+    //--------------------------------------------------------------------------------------
+    // Per-file conversion state. With --jobs, files are converted in parallel and the
+    // console output of each one is kept until it's finished so lines aren't interleaved.
+    enum JOB_STAGE : uint32_t
     {
-        wprintf(L" (%zux%zu", info.width, info.height);
+        STAGE_DECODE = 0,   // Load, planar to packed, decompress
+        STAGE_PROCESS,      // Everything between decode and compress (including mips)
+        STAGE_COMPRESS,
+        STAGE_WRITE,
+        STAGE_COUNT
+    };
+
+    enum JOB_RESULT : int
+    {
+        JOB_CONVERTED = 0,
+        JOB_FAILED,
+        JOB_FATAL,          // Errors that used to end the tool (e.g. out of memory); no more files are started
+        JOB_CACHED,         // Restored from, or already matches, the --cache entry
+        JOB_NOT_RUN,
+    };
+
+    class ConversionJob
+    {
+    public:
+        ConversionJob(bool buffered, LONGLONG qpcFreq) noexcept :
+            m_buffered(buffered),
+            m_qpcFreq(qpcFreq),
+            m_seconds{},
+            m_last{}
+        {
+            std::ignore = QueryPerformanceCounter(&m_last);
+        }
+
+        void Print(_In_z_ _Printf_format_string_ const wchar_t* format, ...)
+        {
+            va_list args;
+            va_start(args, format);
+
+            if (m_buffered)
+            {
+                va_list count;
+                va_copy(count, args);
+                const int len = _vscwprintf(format, count);
+                va_end(count);
+
+                if (len > 0)
+                {
+                    const size_t pos = m_text.size();
+                    m_text.resize(pos + static_cast<size_t>(len) + 1);
+                    std::ignore = vswprintf_s(&m_text[pos], static_cast<size_t>(len) + 1, format, args);
+                    m_text.resize(pos + static_cast<size_t>(len));
+                }
+            }
+            else
+            {
+                vwprintf(format, args);
+            }
+
+            va_end(args);
+        }
+
+        void Flush() noexcept
+        {
+            if (!m_buffered)
+                fflush(stdout);
+        }
+
+        // Adds the time since the previous stage ended to this one
+        void EndStage(JOB_STAGE stage) noexcept
+        {
+            LARGE_INTEGER now = {};
+            std::ignore = QueryPerformanceCounter(&now);
+
+            m_seconds[stage] += double(now.QuadPart - m_last.QuadPart) / double(m_qpcFreq);
+            m_last = now;
+        }
+
+        const std::wstring& GetText() const noexcept { return m_text; }
+        double GetSeconds(JOB_STAGE stage) const noexcept { return m_seconds[stage]; }
+
+        std::wstring destName;
+        std::wstring cacheKey;
+
+    private:
+        bool            m_buffered;
+        LONGLONG        m_qpcFreq;
+        double          m_seconds[STAGE_COUNT];
+        LARGE_INTEGER   m_last;
+        std::wstring    m_text;
+    };
+
+    struct JobRecord
+    {
+        std::wstring    source;
+        std::wstring    dest;
+        std::wstring    cacheKey;
+        int             result;
+        double          seconds[STAGE_COUNT];
+    };
+
+    void PrintInfo(ConversionJob& job, const TexMetadata& info, bool isXbox)
+    {
+        job.Print(L" (%zux%zu", info.width, info.height);
 
         if (TEX_DIMENSION_TEXTURE3D == info.dimension)
-            wprintf(L"x%zu", info.depth);
+            job.Print(L"x%zu", info.depth);
 
         if (info.mipLevels > 1)
-            wprintf(L",%zu", info.mipLevels);
+            job.Print(L",%zu", info.mipLevels);
 
         if (info.arraySize > 1)
-            wprintf(L",%zu", info.arraySize);
+            job.Print(L",%zu", info.arraySize);
 
-        wprintf(L" ");
-        PrintFormat(info.format, g_pFormats, g_pReadOnlyFormats);
+        job.Print(L" %ls", GetFormatName(info.format, g_pFormats, g_pReadOnlyFormats));
 
         switch (info.dimension)
         {
         case TEX_DIMENSION_TEXTURE1D:
-            wprintf(L"%ls", (info.arraySize > 1) ? L" 1DArray" : L" 1D");
+            job.Print(L"%ls", (info.arraySize > 1) ? L" 1DArray" : L" 1D");
             break;
 
         case TEX_DIMENSION_TEXTURE2D:
             if (info.IsCubemap())
             {
-                wprintf(L"%ls", (info.arraySize > 6) ? L" CubeArray" : L" Cube");
+                job.Print(L"%ls", (info.arraySize > 6) ? L" CubeArray" : L" Cube");
             }
             else
             {
-                wprintf(L"%ls", (info.arraySize > 1) ? L" 2DArray" : L" 2D");
+                job.Print(L"%ls", (info.arraySize > 1) ? L" 2DArray" : L" 2D");
             }
             break;
 
         case TEX_DIMENSION_TEXTURE3D:
-            wprintf(L" 3D");
+            job.Print(L" 3D");
             break;
         }
 
         switch (info.GetAlphaMode())
         {
         case TEX_ALPHA_MODE_OPAQUE:
-            wprintf(L" \x03B1:Opaque");
+            job.Print(L" \x03B1:Opaque");
             break;
         case TEX_ALPHA_MODE_PREMULTIPLIED:
-            wprintf(L" \x03B1:PM");
+            job.Print(L" \x03B1:PM");
             break;
         case TEX_ALPHA_MODE_STRAIGHT:
-            wprintf(L" \x03B1:NonPM");
+            job.Print(L" \x03B1:NonPM");
             break;
         case TEX_ALPHA_MODE_CUSTOM:
-            wprintf(L" \x03B1:Custom");
+            job.Print(L" \x03B1:Custom");
             break;
         case TEX_ALPHA_MODE_UNKNOWN:
             break;
@@ -721,10 +840,10 @@ namespace
 
         if (isXbox)
         {
-            wprintf(L" Xbox");
+            job.Print(L" Xbox");
         }
 
-        wprintf(L")");
+        job.Print(L")");
     }
 
     _Success_(return)
@@ -845,10 +964,16 @@ namespace
             L"\n"
             L"   -nologo             suppress copyright message\n"
             L"   --timing            display elapsed processing time\n"
+            L"   --timing-report <filename>\n"
+            L"                       write per-file decode/process/compress/write times\n"
+            L"                       (JSON if the filename ends in .json, otherwise CSV)\n"
+            L"   --benchmark-convert measure format conversion throughput on a synthetic image\n"
+            L"                       (size from -w/-h, defaults to 2048 x 2048; no files needed)\n"
             L"\n"
-        #ifdef _OPENMP
             L"   --single-proc       Do not use multi-threaded compression\n"
-        #endif
+            L"   --jobs <n>          Convert up to n files at once (0 for one per core, default 1)\n"
+            L"   --cache <directory> Skip files whose source and options are unchanged since they\n"
+            L"                       were last converted, restoring the output from the cache\n"
             L"   -gpu <adapter>      Select GPU for DirectCompute-based codecs (0 is default)\n"
             L"   -nogpu              Do not use DirectCompute-based codecs\n"
             L"\n"
@@ -919,7 +1044,7 @@ namespace
     }
 
     _Success_(return)
-        bool CreateDevice(int adapter, _Outptr_ ID3D11Device** pDevice) noexcept
+        bool CreateDevice(int adapter, _Outptr_ ID3D11Device** pDevice, _In_opt_ ConversionJob* job) noexcept
     {
         if (!pDevice)
             return false;
@@ -959,7 +1084,10 @@ namespace
             {
                 if (FAILED(dxgiFactory->EnumAdapters(static_cast<UINT>(adapter), pAdapter.GetAddressOf())))
                 {
-                    wprintf(L"\nERROR: Invalid GPU adapter index (%d)!\n", adapter);
+                    if (job)
+                        job->Print(L"\nERROR: Invalid GPU adapter index (%d)!\n", adapter);
+                    else
+                        wprintf(L"\nERROR: Invalid GPU adapter index (%d)!\n", adapter);
                     return false;
                 }
             }
@@ -1004,8 +1132,11 @@ namespace
                     hr = pAdapter->GetDesc(&desc);
                     if (SUCCEEDED(hr))
                     {
-                        wprintf(L"\n[Using DirectCompute %ls on \"%ls\"]\n",
-                            (fl >= D3D_FEATURE_LEVEL_11_0) ? L"5.0" : L"4.0", desc.Description);
+                        const wchar_t* version = (fl >= D3D_FEATURE_LEVEL_11_0) ? L"5.0" : L"4.0";
+                        if (job)
+                            job->Print(L"\n[Using DirectCompute %ls on \"%ls\"]\n", version, desc.Description);
+                        else
+                            wprintf(L"\n[Using DirectCompute %ls on \"%ls\"]\n", version, desc.Description);
                     }
                 }
             }
@@ -1246,6 +1377,353 @@ namespace
 
         return true;
     }
+
+    //--------------------------------------------------------------------------------------
+    // Measures Convert throughput for common format pairs on a synthetic image
+    int RunConvertBenchmark(size_t width, size_t height, TEX_FILTER_FLAGS filter) noexcept
+    {
+        struct ConvertPair
+        {
+            DXGI_FORMAT source;
+            DXGI_FORMAT target;
+        };
+
+        static const ConvertPair s_pairs[] =
+        {
+            { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_B8G8R8A8_UNORM },
+            { DXGI_FORMAT_B8G8R8A8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM },
+            { DXGI_FORMAT_B8G8R8X8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM },
+            { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R32G32B32A32_FLOAT },
+            { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R8G8B8A8_UNORM },
+            { DXGI_FORMAT_R16G16B16A16_FLOAT,   DXGI_FORMAT_R32G32B32A32_FLOAT },
+            { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R16G16B16A16_FLOAT },
+            { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R8G8B8A8_UNORM },
+            { DXGI_FORMAT_R8G8B8A8_UNORM,       DXGI_FORMAT_R8G8B8A8_UNORM_SRGB },
+            { DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,  DXGI_FORMAT_R16G16B16A16_FLOAT },
+            { DXGI_FORMAT_R10G10B10A2_UNORM,    DXGI_FORMAT_R32G32B32A32_FLOAT },
+            { DXGI_FORMAT_R32G32B32A32_FLOAT,   DXGI_FORMAT_R10G10B10A2_UNORM },
+        };
+
+        // Random 8-bit texels, converted to each source format in turn
+        ScratchImage base;
+        HRESULT hr = base.Initialize2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height, 1, 1);
+        if (FAILED(hr))
+        {
+            wprintf(L"ERROR: Failed creating benchmark image (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return 1;
+        }
+
+        uint32_t seed = 0x12345678;
+        auto texels = reinterpret_cast<uint32_t*>(base.GetPixels());
+        for (size_t j = 0; j < base.GetPixelsSize() / sizeof(uint32_t); ++j)
+        {
+            seed = seed * 1664525u + 1013904223u;
+            texels[j] = seed;
+        }
+
+        LARGE_INTEGER qpcFreq = {};
+        std::ignore = QueryPerformanceFrequency(&qpcFreq);
+
+        wprintf(L"Convert throughput for %zu x %zu (source plus destination bytes)\n", width, height);
+
+        for (const auto& pair : s_pairs)
+        {
+            ScratchImage source;
+            if (pair.source == DXGI_FORMAT_R8G8B8A8_UNORM)
+            {
+                hr = source.InitializeFromImage(*base.GetImage(0, 0, 0));
+            }
+            else
+            {
+                hr = Convert(*base.GetImage(0, 0, 0), pair.source, TEX_FILTER_FORCE_NON_WIC, TEX_THRESHOLD_DEFAULT, source);
+            }
+
+            size_t rowPitch = 0;
+            size_t slicePitch = 0;
+            if (SUCCEEDED(hr))
+            {
+                hr = ComputePitch(pair.target, width, height, rowPitch, slicePitch);
+            }
+
+            if (FAILED(hr))
+            {
+                wprintf(L"ERROR: Failed creating benchmark image (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return 1;
+            }
+
+            const Image& image = *source.GetImage(0, 0, 0);
+
+            // Repeat until at least half a second has been measured
+            size_t iterations = 0;
+            LONGLONG elapsed = 0;
+            do
+            {
+                ScratchImage dest;
+
+                LARGE_INTEGER qpcStart = {};
+                std::ignore = QueryPerformanceCounter(&qpcStart);
+
+                hr = Convert(image, pair.target, filter | TEX_FILTER_FORCE_NON_WIC, TEX_THRESHOLD_DEFAULT, dest);
+
+                LARGE_INTEGER qpcEnd = {};
+                std::ignore = QueryPerformanceCounter(&qpcEnd);
+
+                if (FAILED(hr))
+                {
+                    wprintf(L"ERROR: Convert to %ls failed (%08X%ls)\n",
+                        LookupByValue(pair.target, g_pFormats), static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    return 1;
+                }
+
+                elapsed += qpcEnd.QuadPart - qpcStart.QuadPart;
+                ++iterations;
+            } while (iterations < 3 || elapsed < qpcFreq.QuadPart / 2);
+
+            const double seconds = double(elapsed) / double(qpcFreq.QuadPart);
+            const double bytes = double(image.slicePitch + slicePitch) * double(iterations);
+            wprintf(L"  %-20ls -> %-20ls %8.2f GB/s\n",
+                LookupByValue(pair.source, g_pFormats), LookupByValue(pair.target, g_pFormats),
+                bytes / seconds / 1e9);
+        }
+
+        return 0;
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Conversion cache (--cache). An entry is named by the SHA-256 of the source file and
+    // the options that affect the output, and holds a copy of the file written for them.
+    HRESULT ComputeCacheKey(
+        _In_z_ const wchar_t* szFile,
+        const std::wstring& options,
+        std::wstring& key)
+    {
+        key.clear();
+
+        ScopedHandle hFile(safe_handle(CreateFile2(
+            szFile,
+            GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+            nullptr)));
+        if (!hFile)
+        {
+            return HRESULT_FROM_WIN32(GetLastError());
+        }
+
+        struct alg_closer { void operator()(BCRYPT_ALG_HANDLE h) noexcept { std::ignore = BCryptCloseAlgorithmProvider(h, 0); } };
+        struct hash_closer { void operator()(BCRYPT_HASH_HANDLE h) noexcept { std::ignore = BCryptDestroyHash(h); } };
+
+        BCRYPT_ALG_HANDLE hAlgRaw = nullptr;
+        NTSTATUS status = BCryptOpenAlgorithmProvider(&hAlgRaw, BCRYPT_SHA256_ALGORITHM, nullptr, 0);
+        if (!BCRYPT_SUCCESS(status))
+            return HRESULT_FROM_NT(status);
+
+        std::unique_ptr<void, alg_closer> hAlg(hAlgRaw);
+
+        BCRYPT_HASH_HANDLE hHashRaw = nullptr;
+        status = BCryptCreateHash(hAlg.get(), &hHashRaw, nullptr, 0, nullptr, 0, 0);
+        if (!BCRYPT_SUCCESS(status))
+            return HRESULT_FROM_NT(status);
+
+        std::unique_ptr<void, hash_closer> hHash(hHashRaw);
+
+        status = BCryptHashData(hHash.get(),
+            reinterpret_cast<PUCHAR>(const_cast<wchar_t*>(options.c_str())),
+            static_cast<ULONG>(options.size() * sizeof(wchar_t)), 0);
+        if (!BCRYPT_SUCCESS(status))
+            return HRESULT_FROM_NT(status);
+
+        constexpr DWORD c_chunkSize = 1024 * 1024;
+        std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[c_chunkSize]);
+        if (!buffer)
+            return E_OUTOFMEMORY;
+
+        for (;;)
+        {
+            DWORD bytesRead = 0;
+            if (!ReadFile(hFile.get(), buffer.get(), c_chunkSize, &bytesRead, nullptr))
+            {
+                return HRESULT_FROM_WIN32(GetLastError());
+            }
+
+            if (!bytesRead)
+                break;
+
+            status = BCryptHashData(hHash.get(), buffer.get(), bytesRead, 0);
+            if (!BCRYPT_SUCCESS(status))
+                return HRESULT_FROM_NT(status);
+        }
+
+        uint8_t digest[32] = {};
+        status = BCryptFinishHash(hHash.get(), digest, sizeof(digest), 0);
+        if (!BCRYPT_SUCCESS(status))
+            return HRESULT_FROM_NT(status);
+
+        wchar_t hex[2 * sizeof(digest) + 1] = {};
+        for (size_t j = 0; j < sizeof(digest); ++j)
+        {
+            swprintf_s(&hex[j * 2], 3, L"%02x", digest[j]);
+        }
+
+        key = hex;
+        return S_OK;
+    }
+
+    bool FilesMatch(_In_z_ const wchar_t* szFileA, _In_z_ const wchar_t* szFileB)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA infoA = {};
+        WIN32_FILE_ATTRIBUTE_DATA infoB = {};
+        if (!GetFileAttributesExW(szFileA, GetFileExInfoStandard, &infoA)
+            || !GetFileAttributesExW(szFileB, GetFileExInfoStandard, &infoB))
+            return false;
+
+        if (infoA.nFileSizeHigh != infoB.nFileSizeHigh || infoA.nFileSizeLow != infoB.nFileSizeLow)
+            return false;
+
+        ScopedHandle hFileA(safe_handle(CreateFile2(szFileA, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+        ScopedHandle hFileB(safe_handle(CreateFile2(szFileB, GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr)));
+        if (!hFileA || !hFileB)
+            return false;
+
+        constexpr DWORD c_chunkSize = 1024 * 1024;
+        std::unique_ptr<uint8_t[]> buffer(new (std::nothrow) uint8_t[2 * c_chunkSize]);
+        if (!buffer)
+            return false;
+
+        uint8_t* bufferA = buffer.get();
+        uint8_t* bufferB = buffer.get() + c_chunkSize;
+
+        for (;;)
+        {
+            DWORD bytesA = 0;
+            DWORD bytesB = 0;
+            if (!ReadFile(hFileA.get(), bufferA, c_chunkSize, &bytesA, nullptr)
+                || !ReadFile(hFileB.get(), bufferB, c_chunkSize, &bytesB, nullptr))
+                return false;
+
+            if (bytesA != bytesB || memcmp(bufferA, bufferB, bytesA) != 0)
+                return false;
+
+            if (!bytesA)
+                return true;
+        }
+    }
+
+    //--------------------------------------------------------------------------------------
+    // Per-file stage times (--timing-report), written as JSON if the filename ends in
+    // .json and as CSV otherwise. Times are in seconds.
+    std::string ToUTF8(const std::wstring& str)
+    {
+        if (str.empty())
+            return std::string();
+
+        const int len = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), static_cast<int>(str.size()), nullptr, 0, nullptr, nullptr);
+        if (len <= 0)
+            return std::string();
+
+        std::string result(static_cast<size_t>(len), '\0');
+        std::ignore = WideCharToMultiByte(CP_UTF8, 0, str.c_str(), static_cast<int>(str.size()), &result[0], len, nullptr, nullptr);
+        return result;
+    }
+
+    std::string QuoteString(const std::wstring& str, bool json)
+    {
+        std::string result = "\"";
+        for (const char c : ToUTF8(str))
+        {
+            if (c == '"')
+            {
+                result += (json) ? "\\\"" : "\"\"";
+            }
+            else if (json && c == '\\')
+            {
+                result += "\\\\";
+            }
+            else
+            {
+                result += c;
+            }
+        }
+        result += '"';
+        return result;
+    }
+
+    const char* GetResultName(int result) noexcept
+    {
+        switch (result)
+        {
+        case JOB_CONVERTED: return "converted";
+        case JOB_CACHED:    return "cached";
+        case JOB_NOT_RUN:   return "not-run";
+        default:            return "failed";
+        }
+    }
+
+    bool WriteTimingReport(
+        const std::filesystem::path& path,
+        const std::vector<JobRecord>& records,
+        size_t jobs,
+        double totalSeconds)
+    {
+        std::ofstream outFile(path, std::ios::out | std::ios::trunc);
+        if (!outFile)
+            return false;
+
+        // The report is read by other tools, so numbers use the "C" locale rather than the user's one
+        outFile.imbue(std::locale::classic());
+
+        const _locale_t cLocale = _create_locale(LC_NUMERIC, "C");
+        if (!cLocale)
+            return false;
+
+        const bool json = (_wcsicmp(path.extension().c_str(), L".json") == 0);
+
+        char buff[256] = {};
+        if (json)
+        {
+            _sprintf_s_l(buff, std::size(buff), "{\n  \"jobs\": %zu,\n  \"seconds\": %.6f,\n  \"files\": [\n", cLocale, jobs, totalSeconds);
+            outFile << buff;
+        }
+        else
+        {
+            outFile << "source,dest,result,cache_key,decode,process,compress,write\n";
+        }
+
+        for (size_t j = 0; j < records.size(); ++j)
+        {
+            const auto& record = records[j];
+            if (json)
+            {
+                outFile << "    { \"source\": " << QuoteString(record.source, true)
+                    << ", \"dest\": " << QuoteString(record.dest, true)
+                    << ", \"result\": \"" << GetResultName(record.result)
+                    << "\", \"cacheKey\": \"" << ToUTF8(record.cacheKey) << "\"";
+                _sprintf_s_l(buff, std::size(buff), ", \"decode\": %.6f, \"process\": %.6f, \"compress\": %.6f, \"write\": %.6f }%s\n", cLocale,
+                    record.seconds[STAGE_DECODE], record.seconds[STAGE_PROCESS],
+                    record.seconds[STAGE_COMPRESS], record.seconds[STAGE_WRITE],
+                    (j + 1 < records.size()) ? "," : "");
+            }
+            else
+            {
+                outFile << QuoteString(record.source, false)
+                    << ',' << QuoteString(record.dest, false)
+                    << ',' << GetResultName(record.result)
+                    << ',' << ToUTF8(record.cacheKey);
+                _sprintf_s_l(buff, std::size(buff), ",%.6f,%.6f,%.6f,%.6f\n", cLocale,
+                    record.seconds[STAGE_DECODE], record.seconds[STAGE_PROCESS],
+                    record.seconds[STAGE_COMPRESS], record.seconds[STAGE_WRITE]);
+            }
+            outFile << buff;
+        }
+
+        _free_locale(cLocale);
+
+        if (json)
+        {
+            outFile << "  ]\n}\n";
+        }
+
+        outFile.close();
+        return !outFile.fail();
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -1290,16 +1768,22 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     wchar_t szPrefix[MAX_PATH] = {};
     wchar_t szSuffix[MAX_PATH] = {};
     std::filesystem::path outputDir;
+    size_t jobs = 1;
+    std::filesystem::path cacheDir;
+    std::filesystem::path timingReport;
+    uint32_t xgMode = 0;
 
     // Set locale for output since GetErrorDesc can get localized strings.
     std::locale::global(std::locale(""));
 
     // Initialize COM (needed for WIC)
-    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
-    if (FAILED(hr))
     {
-        wprintf(L"Failed to initialize COM (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-        return 1;
+        const HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        if (FAILED(hr))
+        {
+            wprintf(L"Failed to initialize COM (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return 1;
+        }
     }
 
     // Process command line
@@ -1403,6 +1887,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_ROTATE_COLOR:
             case OPT_PAPER_WHITE_NITS:
             case OPT_SWIZZLE:
+            case OPT_JOBS:
+            case OPT_CACHE:
+            case OPT_TIMING_REPORT:
                 // These don't use flag bits
                 break;
 
@@ -1451,6 +1938,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             case OPT_PAPER_WHITE_NITS:
             case OPT_PRESERVE_ALPHA_COVERAGE:
             case OPT_SWIZZLE:
+            case OPT_JOBS:
+            case OPT_CACHE:
+            case OPT_TIMING_REPORT:
             #ifdef USE_XBOX_EXTS
             case OPT_XGMODE:
             #endif
@@ -1587,6 +2077,33 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }
                 break;
 
+            case OPT_JOBS:
+                if (swscanf_s(pValue, L"%zu", &jobs) != 1)
+                {
+                    wprintf(L"Invalid value specified with --jobs (%ls)\n\n", pValue);
+                    PrintUsage();
+                    return 1;
+                }
+                if (!jobs)
+                {
+                    jobs = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+                }
+                break;
+
+            case OPT_CACHE:
+                {
+                    std::filesystem::path path(pValue);
+                    cacheDir = path.make_preferred();
+                }
+                break;
+
+            case OPT_TIMING_REPORT:
+                {
+                    std::filesystem::path path(pValue);
+                    timingReport = path.make_preferred();
+                }
+                break;
+
             case OPT_FILETYPE:
                 FileType = LookupByName(pValue, g_pSaveFileTypes);
                 if (!FileType)
@@ -1960,6 +2477,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     }
 
                     XGSetHardwareVersion(static_cast<XG_HARDWARE_VERSION>(mode));
+                    xgMode = mode;
                     break;
                 }
             #endif // USE_XBOX_EXTS
@@ -1985,6 +2503,14 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         }
     }
 
+    if (dwOptions & (UINT64_C(1) << OPT_BENCHMARK_CONVERT))
+    {
+        if (~dwOptions & (UINT64_C(1) << OPT_NOLOGO))
+            PrintLogo(false, g_ToolName, g_Description);
+
+        return RunConvertBenchmark(width ? width : 2048, height ? height : 2048, dwFilter | dwFilterOpts);
+    }
+
     if (conversion.empty())
     {
         PrintUsage();
@@ -2011,6 +2537,105 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         mipLevels = 1;
     }
 
+    ComPtr<ID3D11Device> pDevice;
+    std::mutex gpuLock;
+    bool gpuTried = false;
+
+    // Creates the DirectCompute device for the BC6H / BC7 codecs the first time it's needed, and
+    // returns the warning to show if the CPU codec is used instead. Must be called with gpuLock held,
+    // and with the job whose output the device details go to, if any.
+    auto initGPU = [&](ConversionJob* job) -> const wchar_t*
+    {
+        if (gpuTried)
+            return nullptr;
+
+        gpuTried = true;
+
+        if (dwOptions & (UINT64_C(1) << OPT_NOGPU))
+            return L"\nWARNING: using BC6H / BC7 CPU codec\n";
+
+        if (!CreateDevice(adapter, pDevice.GetAddressOf(), job))
+            return L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n";
+
+        return nullptr;
+    };
+
+    // The cache key is the source file plus everything that affects the contents of the output
+    std::wstring cacheOptions;
+    if (!cacheDir.empty())
+    {
+        std::error_code ec;
+        auto apath = std::filesystem::absolute(cacheDir, ec);
+        if (ec)
+        {
+            wprintf(L"ERROR: Invalid --cache directory (%hs)\n", ec.message().c_str());
+            return 1;
+        }
+
+        const auto err = static_cast<DWORD>(SHCreateDirectoryExW(nullptr, apath.c_str(), nullptr));
+        if (err != ERROR_SUCCESS && err != ERROR_ALREADY_EXISTS)
+        {
+            wprintf(L"ERROR: Creating --cache directory FAILED (%08X%ls)\n",
+                static_cast<unsigned int>(HRESULT_FROM_WIN32(err)), GetErrorDesc(HRESULT_FROM_WIN32(err)));
+            return 1;
+        }
+
+        constexpr uint64_t c_nameOnlyOptions = (UINT64_C(1) << OPT_RECURSIVE)
+            | (UINT64_C(1) << OPT_TOLOWER)
+            | (UINT64_C(1) << OPT_OVERWRITE)
+            | (UINT64_C(1) << OPT_NOLOGO)
+            | (UINT64_C(1) << OPT_TIMING)
+            | (UINT64_C(1) << OPT_FORCE_SINGLEPROC);
+
+        // The GPU and CPU BC6H / BC7 codecs don't produce the same bytes, so the key records which
+        // one is used. Without -f a compressed source may be recompressed to its own format.
+        wchar_t bc6hbc7Codec[16] = L"-";
+        switch (format)
+        {
+        case DXGI_FORMAT_UNKNOWN:
+        case DXGI_FORMAT_BC6H_TYPELESS:
+        case DXGI_FORMAT_BC6H_UF16:
+        case DXGI_FORMAT_BC6H_SF16:
+        case DXGI_FORMAT_BC7_TYPELESS:
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            {
+                std::lock_guard<std::mutex> lock(gpuLock);
+
+                const wchar_t* warning = initGPU(nullptr);
+                if (warning)
+                    wprintf(L"%ls", warning);
+
+                if (pDevice)
+                    swprintf_s(bc6hbc7Codec, L"gpu%d", adapter);
+                else
+                    wcscpy_s(bc6hbc7Codec, L"cpu");
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        wchar_t buff[1024] = {};
+        swprintf_s(buff,
+            L"%ls %d;w=%zu;h=%zu;m=%zu;f=%d;ft=%u;if=%08X;srgb=%08X;cv=%08X;bc=%08X;fo=%08X;fl=%u;"
+            L"at=%a;aw=%a;nmap=%08X;amp=%a;wicq=%a;c=%08X;rot=%u;nits=%a;cov=%a;fmt=%d%d%d;"
+            L"swz=%u%u%u%u,%u%u%u%u,%u%u%u%u;xg=%u;bc67=%ls;opt=%016llX;",
+            g_ToolName, DIRECTX_TEX_VERSION,
+            width, height, mipLevels, static_cast<int>(format), FileType,
+            static_cast<unsigned int>(dwFilter), static_cast<unsigned int>(dwSRGB), static_cast<unsigned int>(dwConvert),
+            static_cast<unsigned int>(dwCompress), static_cast<unsigned int>(dwFilterOpts), maxSize,
+            double(alphaThreshold), double(alphaWeight), static_cast<unsigned int>(dwNormalMap), double(nmapAmplitude),
+            double(wicQuality), colorKey, dwRotateColor, double(paperWhiteNits), double(preserveAlphaCoverageRef),
+            dxt5nm ? 1 : 0, dxt5rxgb ? 1 : 0, use24bpp ? 1 : 0,
+            swizzleElements[0], swizzleElements[1], swizzleElements[2], swizzleElements[3],
+            zeroElements[0], zeroElements[1], zeroElements[2], zeroElements[3],
+            oneElements[0], oneElements[1], oneElements[2], oneElements[3],
+            xgMode, bc6hbc7Codec, static_cast<unsigned long long>(dwOptions & ~c_nameOnlyOptions));
+        cacheOptions = buff;
+    }
+
     LARGE_INTEGER qpcFreq = {};
     std::ignore = QueryPerformanceFrequency(&qpcFreq);
 
@@ -2018,33 +2643,79 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
     std::ignore = QueryPerformanceCounter(&qpcStart);
 
     // Convert images
-    bool sizewarn = false;
-    bool nonpow2warn = false;
-    bool non4bc = false;
-    bool preserveAlphaCoverage = false;
-    ComPtr<ID3D11Device> pDevice;
+    std::atomic<bool> sizewarn(false);
+    std::atomic<bool> nonpow2warn(false);
+    std::atomic<bool> non4bc(false);
 
     int retVal = 0;
 
-    for (auto pConv = conversion.begin(); pConv != conversion.end(); ++pConv)
+    auto makeDestName = [&](const SConversion& conv, ConversionJob& job, std::wstring& destName) -> bool
     {
-        if (pConv != conversion.begin())
-            wprintf(L"\n");
+        std::filesystem::path curpath(conv.szSrc);
+        std::filesystem::path dest(outputDir);
+
+        if (keepRecursiveDirs && !conv.szFolder.empty())
+        {
+            dest.append(conv.szFolder.c_str());
+
+            std::error_code ec;
+            auto apath = std::filesystem::absolute(dest, ec);
+
+            if (ec)
+            {
+                job.Print(L" get full path FAILED (%hs)\n", ec.message().c_str());
+                return false;
+            }
+
+            const auto err = static_cast<DWORD>(SHCreateDirectoryExW(nullptr, apath.c_str(), nullptr));
+            if (err != ERROR_SUCCESS && err != ERROR_ALREADY_EXISTS)
+            {
+                job.Print(L" directory creation FAILED (%08X%ls)\n",
+                    static_cast<unsigned int>(HRESULT_FROM_WIN32(err)), GetErrorDesc(HRESULT_FROM_WIN32(err)));
+                return false;
+            }
+        }
+
+        if (*szPrefix)
+        {
+            dest.append(szPrefix);
+            dest.concat(curpath.stem().c_str());
+            dest.concat(szSuffix);
+        }
+        else
+        {
+            dest.append(curpath.stem().c_str());
+            dest.concat(szSuffix);
+        }
+
+        destName = dest.c_str();
+        if (dwOptions & (UINT64_C(1) << OPT_TOLOWER))
+        {
+            std::transform(destName.begin(), destName.end(), destName.begin(), towlower);
+        }
+
+        return true;
+    };
+
+    auto convertFile = [&](const SConversion& conv, ConversionJob& job) -> int
+    {
+        HRESULT hr = S_OK;
+        bool preserveAlphaCoverage = false;
 
         // --- Load source image -------------------------------------------------------
-        wprintf(L"reading %ls", pConv->szSrc.c_str());
-        fflush(stdout);
+        job.Print(L"reading %ls", conv.szSrc.c_str());
+        job.Flush();
 
         TexMetadata info;
         std::unique_ptr<ScratchImage> image(new (std::nothrow) ScratchImage);
 
         if (!image)
         {
-            wprintf(L"\nERROR: Memory allocation failed\n");
-            return 1;
+            job.Print(L"\nERROR: Memory allocation failed\n");
+            return JOB_FATAL;
         }
 
-        std::filesystem::path curpath(pConv->szSrc);
+        std::filesystem::path curpath(conv.szSrc);
         const auto ext = curpath.extension();
 
     #ifndef USE_XBOX_EXTS
@@ -2057,9 +2728,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = Xbox::GetMetadataFromDDSFile(curpath.c_str(), info, isXbox);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
 
             if (isXbox)
@@ -2091,9 +2761,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
 
             if (IsTypeless(info.format))
@@ -2109,9 +2778,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
                 if (IsTypeless(info.format))
                 {
-                    wprintf(L" FAILED due to Typeless format %d\n", info.format);
-                    retVal = 1;
-                    continue;
+                    job.Print(L" FAILED due to Typeless format %d\n", info.format);
+                    return JOB_FAILED;
                 }
 
                 image->OverrideFormat(info.format);
@@ -2122,9 +2790,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromBMPEx(curpath.c_str(), WIC_FLAGS_NONE | dwFilter, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
         else if (_wcsicmp(ext.c_str(), L".tga") == 0)
@@ -2142,9 +2809,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromTGAFile(curpath.c_str(), tgaFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
         else if (_wcsicmp(ext.c_str(), L".hdr") == 0)
@@ -2152,9 +2818,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromHDRFile(curpath.c_str(), &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
         else if (_wcsicmp(ext.c_str(), L".ppm") == 0)
@@ -2162,9 +2827,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromPortablePixMap(curpath.c_str(), &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
         else if (_wcsicmp(ext.c_str(), L".pfm") == 0 || _wcsicmp(ext.c_str(), L".phm") == 0)
@@ -2172,9 +2836,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromPortablePixMapHDR(curpath.c_str(), &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
     #ifdef USE_OPENEXR
@@ -2183,9 +2846,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromEXRFile(curpath.c_str(), &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
     #endif
@@ -2201,9 +2863,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromJPEGFile(curpath.c_str(), jpegFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
     #endif
@@ -2219,9 +2880,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromPNGFile(curpath.c_str(), pngFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
         }
     #endif
@@ -2248,30 +2908,29 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = LoadFromWICFile(curpath.c_str(), wicFlags, &info, *image);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
                 if (hr == static_cast<HRESULT>(0xc00d5212) /* MF_E_TOPO_CODEC_NOT_FOUND */)
                 {
                     if (_wcsicmp(ext.c_str(), L".heic") == 0 || _wcsicmp(ext.c_str(), L".heif") == 0)
                     {
-                        wprintf(L"INFO: This format requires installing the HEIF Image Extensions - https://aka.ms/heif\n");
+                        job.Print(L"INFO: This format requires installing the HEIF Image Extensions - https://aka.ms/heif\n");
                     }
                     else if (_wcsicmp(ext.c_str(), L".webp") == 0)
                     {
-                        wprintf(L"INFO: This format requires installing the WEBP Image Extensions - https://apps.microsoft.com/detail/9PG2DK419DRG\n");
+                        job.Print(L"INFO: This format requires installing the WEBP Image Extensions - https://apps.microsoft.com/detail/9PG2DK419DRG\n");
                     }
                 }
-                continue;
+                return JOB_FAILED;
             }
         }
 
-        PrintInfo(info, isXbox);
+        PrintInfo(job, info, isXbox);
 
         size_t tMips = (!mipLevels && info.mipLevels > 1) ? info.mipLevels : mipLevels;
 
         // Convert texture
-        wprintf(L" as");
-        fflush(stdout);
+        job.Print(L" as");
+        job.Flush();
 
         // --- Planar ------------------------------------------------------------------
         if (IsPlanar(info.format))
@@ -2283,17 +2942,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = ConvertToSinglePlane(img, nimg, info, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [converttosingleplane] (%08X%ls)\n",
+                job.Print(L" FAILED [converttosingleplane] (%08X%ls)\n",
                     static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                return JOB_FAILED;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2325,8 +2983,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                     if (!timage)
                     {
-                        wprintf(L"\nERROR: Memory allocation failed\n");
-                        return 1;
+                        job.Print(L"\nERROR: Memory allocation failed\n");
+                        return JOB_FATAL;
                     }
 
                     // If we started with < 4x4 then no need to generate mips
@@ -2343,9 +3001,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     hr = timage->Initialize(mdata);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [BC non-multiple-of-4 fixup] (%08X%ls)\n",
+                        job.Print(L" FAILED [BC non-multiple-of-4 fixup] (%08X%ls)\n",
                             static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        return 1;
+                        return JOB_FATAL;
                     }
 
                     if (mdata.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -2387,16 +3045,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = Decompress(img, nimg, info, DXGI_FORMAT_UNKNOWN /* picks good default */, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [decompress] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
-                continue;
+                job.Print(L" FAILED [decompress] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FAILED;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2423,6 +3080,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
+        job.EndStage(STAGE_DECODE);
+
         // --- Undo Premultiplied Alpha (if requested) ---------------------------------
         if ((dwOptions & (UINT64_C(1) << OPT_DEMUL_ALPHA))
             && HasAlpha(info.format)
@@ -2445,17 +3104,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    job.Print(L"\nERROR: Memory allocation failed\n");
+                    return JOB_FATAL;
                 }
 
                 hr = PremultiplyAlpha(img, nimg, info, TEX_PMALPHA_REVERSE | dwSRGB, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [demultiply alpha] (%08X%ls)\n",
+                    job.Print(L" FAILED [demultiply alpha] (%08X%ls)\n",
                         static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                    retVal = 1;
-                    continue;
+                    return JOB_FAILED;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -2480,8 +3138,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             TEX_FR_FLAGS dwFlags = TEX_FR_ROTATE0;
@@ -2497,8 +3155,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = FlipRotate(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwFlags, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [fliprotate] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [fliprotate] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2546,15 +3204,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = Resize(image->GetImages(), image->GetImageCount(), image->GetMetadata(), twidth, theight, dwFilter | dwFilterOpts, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [resize] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [resize] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -2594,8 +3252,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             const XMVECTOR zc = XMVectorSelectControl(zeroElements[0], zeroElements[1], zeroElements[2], zeroElements[3]);
@@ -2616,8 +3274,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [swizzle] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [swizzle] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -2645,16 +3303,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    job.Print(L"\nERROR: Memory allocation failed\n");
+                    return JOB_FATAL;
                 }
 
                 hr = Convert(image->GetImages(), image->GetImageCount(), image->GetMetadata(), DXGI_FORMAT_R16G16B16A16_FLOAT,
                     dwFilter | dwFilterOpts | dwSRGB | dwConvert, alphaThreshold, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [convert] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                    return 1;
+                    job.Print(L" FAILED [convert] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    return JOB_FATAL;
                 }
 
             #ifndef NDEBUG
@@ -2679,8 +3337,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             switch (dwRotateColor)
@@ -2885,9 +3543,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [rotate color apply] (%08X%ls)\n",
+                job.Print(L" FAILED [rotate color apply] (%08X%ls)\n",
                     static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -2913,8 +3571,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             // Compute max luminosity across all images
@@ -2937,8 +3595,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 });
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [tonemap maxlum] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [tonemap maxlum] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             // Reinhard et al, "Photographic Tone Reproduction for Digital Images"
@@ -2966,8 +3624,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [tonemap apply] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [tonemap apply] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -2993,8 +3651,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             DXGI_FORMAT nmfmt = tformat;
@@ -3021,8 +3679,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = ComputeNormalMap(image->GetImages(), image->GetImageCount(), image->GetMetadata(), dwNormalMap, nmapAmplitude, nmfmt, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [normalmap] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [normalmap] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -3046,16 +3704,16 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = Convert(image->GetImages(), image->GetImageCount(), image->GetMetadata(), tformat,
                 dwFilter | dwFilterOpts | dwSRGB | dwConvert, alphaThreshold, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [convert] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [convert] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -3082,8 +3740,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             XMVECTOR colorKeyValue = XMLoadColor(reinterpret_cast<const XMCOLOR*>(&colorKey));
@@ -3113,8 +3771,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [colorkey] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [colorkey] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -3140,8 +3798,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = TransformImage(image->GetImages(), image->GetImageCount(), image->GetMetadata(),
@@ -3162,8 +3820,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [inverty] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [inverty] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -3189,8 +3847,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             bool isunorm = (FormatDataType(info.format) == FORMAT_TYPE_UNORM) != 0;
@@ -3223,8 +3881,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 }, *timage);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [reconstructz] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [reconstructz] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
         #ifndef NDEBUG
@@ -3266,6 +3924,13 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
+        if (info.dimension == TEX_DIMENSION_TEXTURE3D
+            && ((dwFilter & TEX_FILTER_MODE_MASK) == TEX_FILTER_LANCZOS || (dwFilter & TEX_FILTER_MODE_MASK) == TEX_FILTER_KAISER))
+        {
+            // Volume mipmap generation doesn't implement the windowed-sinc filters
+            dwFilter3D = TEX_FILTER_TRIANGLE;
+        }
+
         if ((!tMips || info.mipLevels != tMips || preserveAlphaCoverage) && (info.mipLevels != 1))
         {
             // Mips generation only works on a single base image, so strip off existing mip levels
@@ -3274,8 +3939,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             TexMetadata mdata = info;
@@ -3283,9 +3948,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             hr = timage->Initialize(mdata);
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [copy to single level] (%08X%ls)\n",
+                job.Print(L" FAILED [copy to single level] (%08X%ls)\n",
                     static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                return JOB_FATAL;
             }
 
             if (info.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -3296,9 +3961,9 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         *timage->GetImage(0, 0, d), TEX_FILTER_DEFAULT, 0, 0);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [copy to single level] (%08X%ls)\n",
+                        job.Print(L" FAILED [copy to single level] (%08X%ls)\n",
                             static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        return 1;
+                        return JOB_FATAL;
                     }
                 }
             }
@@ -3310,8 +3975,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         *timage->GetImage(0, i, 0), TEX_FILTER_DEFAULT, 0, 0);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [copy to single level] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        return 1;
+                        job.Print(L" FAILED [copy to single level] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                        return JOB_FATAL;
                     }
                 }
             }
@@ -3327,8 +3992,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 hr = timage->Initialize(mdata);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [copy compressed to single level] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                    return 1;
+                    job.Print(L" FAILED [copy compressed to single level] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    return JOB_FATAL;
                 }
 
                 if (mdata.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -3365,8 +4030,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             if (info.dimension == TEX_DIMENSION_TEXTURE3D)
@@ -3379,8 +4044,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [mipmaps] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [mipmaps] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             auto& tinfo = timage->GetMetadata();
@@ -3404,15 +4069,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
             if (!timage)
             {
-                wprintf(L"\nERROR: Memory allocation failed\n");
-                return 1;
+                job.Print(L"\nERROR: Memory allocation failed\n");
+                return JOB_FATAL;
             }
 
             hr = timage->Initialize(image->GetMetadata());
             if (FAILED(hr))
             {
-                wprintf(L" FAILED [keepcoverage] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                return 1;
+                job.Print(L" FAILED [keepcoverage] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                return JOB_FATAL;
             }
 
             const size_t items = image->GetMetadata().arraySize;
@@ -3424,8 +4089,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 hr = ScaleMipMapsAlphaForCoverage(img, info.mipLevels, info, item, preserveAlphaCoverageRef, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [keepcoverage] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                    return 1;
+                    job.Print(L" FAILED [keepcoverage] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    return JOB_FATAL;
                 }
             }
 
@@ -3463,16 +4128,15 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    job.Print(L"\nERROR: Memory allocation failed\n");
+                    return JOB_FATAL;
                 }
 
                 hr = PremultiplyAlpha(img, nimg, info, TEX_PMALPHA_DEFAULT | dwSRGB, *timage);
                 if (FAILED(hr))
                 {
-                    wprintf(L" FAILED [premultiply alpha] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                    retVal = 1;
-                    continue;
+                    job.Print(L" FAILED [premultiply alpha] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    return JOB_FAILED;
                 }
 
                 auto& tinfo = timage->GetMetadata();
@@ -3491,6 +4155,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             }
         }
 
+        job.EndStage(STAGE_PROCESS);
+
         // --- Compress ----------------------------------------------------------------
         if (FileType == CODEC_DDS)
         {
@@ -3502,8 +4168,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                 std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                 if (!timage)
                 {
-                    wprintf(L"\nERROR: Memory allocation failed\n");
-                    return 1;
+                    job.Print(L"\nERROR: Memory allocation failed\n");
+                    return JOB_FATAL;
                 }
 
                 if (dxt5nm)
@@ -3520,8 +4186,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         }, *timage);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [DXT5nm] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        return 1;
+                        job.Print(L" FAILED [DXT5nm] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                        return JOB_FATAL;
                     }
                 }
                 else
@@ -3538,8 +4204,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         }, *timage);
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [DXT5 RXGB] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        return 1;
+                        job.Print(L" FAILED [DXT5 RXGB] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                        return JOB_FATAL;
                     }
                 }
 
@@ -3594,8 +4260,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     std::unique_ptr<ScratchImage> timage(new (std::nothrow) ScratchImage);
                     if (!timage)
                     {
-                        wprintf(L"\nERROR: Memory allocation failed\n");
-                        return 1;
+                        job.Print(L"\nERROR: Memory allocation failed\n");
+                        return JOB_FATAL;
                     }
 
                     bool bc6hbc7 = false;
@@ -3610,22 +4276,11 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                         bc6hbc7 = true;
 
                         {
-                            static bool s_tryonce = false;
-
-                            if (!s_tryonce)
-                            {
-                                s_tryonce = true;
+                            std::lock_guard<std::mutex> lock(gpuLock);
 
-                                if (!(dwOptions & (UINT64_C(1) << OPT_NOGPU)))
-                                {
-                                    if (!CreateDevice(adapter, pDevice.GetAddressOf()))
-                                        wprintf(L"\nWARNING: DirectCompute is not available, using BC6H / BC7 CPU codec\n");
-                                }
-                                else
-                                {
-                                    wprintf(L"\nWARNING: using BC6H / BC7 CPU codec\n");
-                                }
-                            }
+                            const wchar_t* warning = initGPU(&job);
+                            if (warning)
+                                job.Print(L"%ls", warning);
                         }
                         break;
 
@@ -3634,12 +4289,10 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     }
 
                     TEX_COMPRESS_FLAGS cflags = dwCompress;
-                #ifdef _OPENMP
                     if (!(dwOptions & (UINT64_C(1) << OPT_FORCE_SINGLEPROC)))
                     {
                         cflags |= TEX_COMPRESS_PARALLEL;
                     }
-                #endif
 
                     if ((img->width % 4) != 0 || (img->height % 4) != 0)
                     {
@@ -3648,6 +4301,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
                     if (bc6hbc7 && pDevice)
                     {
+                        // The immediate context isn't thread-safe, so jobs take turns on the GPU
+                        std::lock_guard<std::mutex> lock(gpuLock);
                         hr = Compress(pDevice.Get(), img, nimg, info, tformat, dwCompress | dwSRGB, alphaWeight, *timage);
                     }
                     else
@@ -3656,9 +4311,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
                     }
                     if (FAILED(hr))
                     {
-                        wprintf(L" FAILED [compress] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                        retVal = 1;
-                        continue;
+                        job.Print(L" FAILED [compress] (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                        return JOB_FAILED;
                     }
 
                     auto& tinfo = timage->GetMetadata();
@@ -3709,6 +4363,8 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
             info.SetAlphaMode(TEX_ALPHA_MODE_UNKNOWN);
         }
 
+        job.EndStage(STAGE_COMPRESS);
+
         // --- Save result -------------------------------------------------------------
         {
             auto img = image->GetImage(0, 0, 0);
@@ -3720,65 +4376,26 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
         #else
             constexpr bool isXboxOut = false;
         #endif
-            PrintInfo(info, isXboxOut);
-            wprintf(L"\n");
+            PrintInfo(job, info, isXboxOut);
+            job.Print(L"\n");
 
             // Figure out dest filename
-            std::filesystem::path dest(outputDir);
-
-            if (keepRecursiveDirs && !pConv->szFolder.empty())
-            {
-                dest.append(pConv->szFolder.c_str());
-
-                std::error_code ec;
-                auto apath = std::filesystem::absolute(dest, ec);
-
-                if (ec)
-                {
-                    wprintf(L" get full path FAILED (%hs)\n", ec.message().c_str());
-                    retVal = 1;
-                    continue;
-                }
+            std::wstring destName;
+            if (!makeDestName(conv, job, destName))
+                return JOB_FAILED;
 
-                const auto err = static_cast<DWORD>(SHCreateDirectoryExW(nullptr, apath.c_str(), nullptr));
-                if (err != ERROR_SUCCESS && err != ERROR_ALREADY_EXISTS)
-                {
-                    wprintf(L" directory creation FAILED (%08X%ls)\n",
-                        static_cast<unsigned int>(HRESULT_FROM_WIN32(err)), GetErrorDesc(HRESULT_FROM_WIN32(err)));
-                    retVal = 1;
-                    continue;
-                }
-            }
-
-            if (*szPrefix)
-            {
-                dest.append(szPrefix);
-                dest.concat(curpath.stem().c_str());
-                dest.concat(szSuffix);
-            }
-            else
-            {
-                dest.append(curpath.stem().c_str());
-                dest.concat(szSuffix);
-            }
-
-            std::wstring destName = dest.c_str();
-            if (dwOptions & (UINT64_C(1) << OPT_TOLOWER))
-            {
-                std::transform(destName.begin(), destName.end(), destName.begin(), towlower);
-            }
+            job.destName = destName;
 
             // Write texture
-            wprintf(L"writing %ls", destName.c_str());
-            fflush(stdout);
+            job.Print(L"writing %ls", destName.c_str());
+            job.Flush();
 
             if (~dwOptions & (UINT64_C(1) << OPT_OVERWRITE))
             {
                 if (GetFileAttributesW(destName.c_str()) != INVALID_FILE_ATTRIBUTES)
                 {
-                    wprintf(L"\nERROR: Output file already exists, use -y to overwrite:\n");
-                    retVal = 1;
-                    continue;
+                    job.Print(L"\nERROR: Output file already exists, use -y to overwrite:\n");
+                    return JOB_FAILED;
                 }
             }
 
@@ -3952,18 +4569,204 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
             if (FAILED(hr))
             {
-                wprintf(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
-                retVal = 1;
+                job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
                 if ((hr == static_cast<HRESULT>(0xc00d5212) /* MF_E_TOPO_CODEC_NOT_FOUND */) && (FileType == WIC_CODEC_HEIF))
                 {
-                    wprintf(L"INFO: This format requires installing the HEIF Image Extensions - https://aka.ms/heif\n");
+                    job.Print(L"INFO: This format requires installing the HEIF Image Extensions - https://aka.ms/heif\n");
+                }
+                return JOB_FAILED;
+            }
+            job.Print(L"\n");
+
+            job.EndStage(STAGE_WRITE);
+        }
+
+        return JOB_CONVERTED;
+    };
+
+    auto runJob = [&](const SConversion& conv, ConversionJob& job) -> int
+    {
+        if (cacheDir.empty())
+            return convertFile(conv, job);
+
+        std::wstring destName;
+        if (!makeDestName(conv, job, destName))
+            return JOB_FAILED;
+
+        std::wstring ext = std::filesystem::path(conv.szSrc).extension().native();
+        std::transform(ext.begin(), ext.end(), ext.begin(), towlower);
+
+        HRESULT hr = ComputeCacheKey(conv.szSrc.c_str(), cacheOptions + ext, job.cacheKey);
+        if (FAILED(hr))
+        {
+            job.Print(L"reading %ls FAILED (%08X%ls)\n", conv.szSrc.c_str(), static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return JOB_FAILED;
+        }
+
+        std::filesystem::path entry(cacheDir);
+        entry.append(job.cacheKey);
+        entry.concat(std::filesystem::path(destName).extension().c_str());
+
+        if (GetFileAttributesW(entry.c_str()) == INVALID_FILE_ATTRIBUTES)
+        {
+            const int result = convertFile(conv, job);
+            if (result == JOB_CONVERTED)
+            {
+                // Copied under a temporary name first so that other processes sharing the cache never see a partial entry
+                wchar_t tempSuffix[64] = {};
+                swprintf_s(tempSuffix, L".%lu.%lu.tmp", GetCurrentProcessId(), GetCurrentThreadId());
+
+                std::filesystem::path temp(entry);
+                temp.concat(tempSuffix);
+
+                if (!CopyFileW(job.destName.c_str(), temp.c_str(), FALSE)
+                    || !MoveFileExW(temp.c_str(), entry.c_str(), MOVEFILE_REPLACE_EXISTING))
+                {
+                    hr = HRESULT_FROM_WIN32(GetLastError());
+                    job.Print(L"WARNING: Adding %ls to the cache FAILED (%08X%ls)\n",
+                        job.destName.c_str(), static_cast<unsigned int>(hr), GetErrorDesc(hr));
+                    std::ignore = DeleteFileW(temp.c_str());
                 }
-                continue;
             }
-            wprintf(L"\n");
+            return result;
+        }
+
+        job.destName = destName;
+        job.EndStage(STAGE_DECODE);
+
+        if (FilesMatch(entry.c_str(), destName.c_str()))
+        {
+            job.Print(L"%ls is up to date\n", destName.c_str());
+            return JOB_CACHED;
+        }
+
+        job.Print(L"writing %ls from cache", destName.c_str());
+
+        if (~dwOptions & (UINT64_C(1) << OPT_OVERWRITE))
+        {
+            if (GetFileAttributesW(destName.c_str()) != INVALID_FILE_ATTRIBUTES)
+            {
+                job.Print(L"\nERROR: Output file already exists, use -y to overwrite:\n");
+                return JOB_FAILED;
+            }
+        }
+
+        if (!CopyFileW(entry.c_str(), destName.c_str(), FALSE))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            job.Print(L" FAILED (%08X%ls)\n", static_cast<unsigned int>(hr), GetErrorDesc(hr));
+            return JOB_FAILED;
         }
+
+        job.Print(L"\n");
+        job.EndStage(STAGE_WRITE);
+        return JOB_CACHED;
+    };
+
+    // Files are handed out to the workers in order. Each worker runs one file through all
+    // of the stages, so with several jobs the decode, processing, compression and writing
+    // of different files overlap.
+    std::vector<const SConversion*> files;
+    files.reserve(conversion.size());
+    for (const auto& conv : conversion)
+    {
+        files.push_back(&conv);
     }
 
+    std::vector<JobRecord> records(files.size());
+    for (size_t j = 0; j < files.size(); ++j)
+    {
+        records[j].source = files[j]->szSrc;
+        records[j].result = JOB_NOT_RUN;
+    }
+
+    jobs = std::min(jobs, files.size());
+    const bool buffered = (jobs > 1);
+
+    std::atomic<size_t> nextFile(0);
+    std::atomic<bool> fatal(false);
+    std::mutex consoleLock;
+    bool firstOutput = true;
+
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            const size_t index = nextFile++;
+            if (index >= files.size() || fatal)
+                break;
+
+            if (!buffered && index > 0)
+                wprintf(L"\n");
+
+            ConversionJob job(buffered, qpcFreq.QuadPart);
+            const int result = runJob(*files[index], job);
+
+            auto& record = records[index];
+            record.dest = job.destName;
+            record.cacheKey = job.cacheKey;
+            record.result = result;
+            for (uint32_t stage = 0; stage < STAGE_COUNT; ++stage)
+            {
+                record.seconds[stage] = job.GetSeconds(static_cast<JOB_STAGE>(stage));
+            }
+
+            if (buffered)
+            {
+                std::lock_guard<std::mutex> lock(consoleLock);
+                wprintf(L"%ls%ls", firstOutput ? L"" : L"\n", job.GetText().c_str());
+                fflush(stdout);
+                firstOutput = false;
+            }
+
+            if (result == JOB_FATAL)
+                fatal = true;
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t j = 1; j < jobs; ++j)
+    {
+        threads.emplace_back([&]()
+            {
+                // WIC is used from every worker
+                const HRESULT hrCOM = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+                worker();
+                if (SUCCEEDED(hrCOM))
+                    CoUninitialize();
+            });
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    LARGE_INTEGER qpcEnd = {};
+    std::ignore = QueryPerformanceCounter(&qpcEnd);
+
+    const double totalSeconds = double(qpcEnd.QuadPart - qpcStart.QuadPart) / double(qpcFreq.QuadPart);
+
+    for (const auto& record : records)
+    {
+        if (record.result == JOB_FAILED || record.result == JOB_FATAL)
+            retVal = 1;
+    }
+
+    if (!timingReport.empty())
+    {
+        if (!WriteTimingReport(timingReport, records, jobs, totalSeconds))
+        {
+            wprintf(L"\nERROR: Failed writing timing report %ls\n", timingReport.c_str());
+            retVal = 1;
+        }
+    }
+
+    if (fatal)
+        return 1;
+
     if (sizewarn)
     {
         wprintf(L"\nWARNING: Target size exceeds maximum size for feature level (%u)\n", maxSize);
@@ -3980,11 +4783,7 @@ int __cdecl wmain(_In_ int argc, _In_z_count_(argc) wchar_t* argv[])
 
     if (dwOptions & (UINT64_C(1) << OPT_TIMING))
     {
-        LARGE_INTEGER qpcEnd = {};
-        std::ignore = QueryPerformanceCounter(&qpcEnd);
-
-        const LONGLONG delta = qpcEnd.QuadPart - qpcStart.QuadPart;
-        wprintf(L"\n Processing time: %f seconds\n", double(delta) / double(qpcFreq.QuadPart));
+        wprintf(L"\n Processing time: %f seconds\n", totalSeconds);
     }
 
     return retVal;